@@ -5,6 +5,7 @@ using namespace DirectX;
 
 // Constructor
 Camera::Camera(DirectX::XMFLOAT3 position, float moveSpeed, float mouseLookSpeed, float fieldOfView, float aspectRatio, float nearClip, float farClip) :
+		velocity(0.0f, 0.0f, 0.0f),
 		movementSpeed(moveSpeed),
 		mouseLookSpeed(mouseLookSpeed),
 		fieldOfView(fieldOfView),
@@ -20,6 +21,7 @@ Camera::Camera(DirectX::XMFLOAT3 position, float moveSpeed, float mouseLookSpeed
 
 // Constructor
 Camera::Camera(float x, float y, float z, float moveSpeed, float mouseLookSpeed, float fieldOfView, float aspectRatio, float nearClip, float farClip) :
+		velocity(0.0f, 0.0f, 0.0f),
 		movementSpeed(moveSpeed),
 		mouseLookSpeed(mouseLookSpeed),
 		fieldOfView(fieldOfView),
@@ -88,6 +90,12 @@ float Camera::GetFarClip()
 	return farClip;
 }
 
+// Get velocity from the last update
+DirectX::XMFLOAT3 Camera::GetVelocity()
+{
+	return velocity;
+}
+
 
 // --= Setters =--
 
@@ -135,10 +143,11 @@ void Camera::Update(float dt)
 
 	// Get current speed
 	float speed = dt * movementSpeed;
+	XMFLOAT3 start = transform.GetPosition();
 
 	// Increase or decrease speed
 	if (input.KeyDown(VK_SHIFT)) { speed *= 5; }
-	if (input.KeyDown(VK_CONTROL)) { speed != 0.1f; }
+	if (input.KeyDown(VK_CONTROL)) { speed *= 0.1f; }
 
 	// Movement
 	if (input.KeyDown('W')) { transform.MoveRelative(0.0f, 0.0f, speed); }
@@ -148,6 +157,11 @@ void Camera::Update(float dt)
 	if (input.KeyDown('X')) { transform.MoveRelative(0.0f, -speed, 0.0f); }
 	if (input.KeyDown(' ')) { transform.MoveRelative(0.0f, speed, 0.0f); }
 
+	// Velocity from how far that moved (so streaming can look ahead)
+	XMFLOAT3 end = transform.GetPosition();
+	if (dt > 0.0f)
+		XMStoreFloat3(&velocity, XMVectorScale(XMVectorSubtract(XMLoadFloat3(&end), XMLoadFloat3(&start)), 1.0f / dt));
+
 	// Handle mouse movement only when left clicking
 	if (input.MouseLeftDown())
 	{
@@ -38,6 +38,7 @@ public:
 	float GetMouseLookSpeed();
 	float GetNearClip();
 	float GetFarClip();
+	DirectX::XMFLOAT3 GetVelocity();
 	
 	// Setters
 	void SetFieldOfView(float fov);
@@ -58,6 +59,10 @@ private:
 
 	Transform transform;
 
+	// How fast input moved the camera in the last update, in
+	// units per second
+	DirectX::XMFLOAT3 velocity;
+
 	float movementSpeed;
 	float mouseLookSpeed;
 	float fieldOfView;
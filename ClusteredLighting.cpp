@@ -0,0 +1,121 @@
+#include "ClusteredLighting.h"
+
+#include <cmath>
+
+using namespace DirectX;
+
+// Spot cones are culled where their falloff drops below this
+#define SPOT_CUTOFF_INTENSITY (1.0f / 256.0f)
+
+// Clusters closer than this all share the first slice, so
+// a tiny camera near clip doesn't waste slices
+#define CLUSTER_MIN_NEAR_Z 0.1f
+
+// Constructor
+ClusteredLighting::ClusteredLighting(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	std::shared_ptr<JobSystem> jobs,
+	LightClusterConfig config)
+	:
+	device(device),
+	context(context),
+	config(config),
+	builder(jobs),
+	shaderInfo{},
+	lightBuffer(device, context),
+	rangeBuffer(device, context),
+	indexBuffer(device, context)
+{
+}
+
+// Destructor
+ClusteredLighting::~ClusteredLighting()
+{
+}
+
+// --------------------------------------------------------
+// Converts the lights to view space, builds the clusters
+// and uploads everything the shader needs
+// --------------------------------------------------------
+void ClusteredLighting::Update(const std::vector<Light>& lights, Camera& camera, unsigned int screenWidth, unsigned int screenHeight, int shadowLightIndex)
+{
+	// Match the clusters to the camera's frustum
+	XMFLOAT4X4 projection = camera.GetProjection();
+	config.TanHalfFovX = 1.0f / projection._11;
+	config.TanHalfFovY = 1.0f / projection._22;
+	config.NearZ = std::fmax(camera.GetNearClip(), CLUSTER_MIN_NEAR_Z);
+	config.FarZ = std::fmax(camera.GetFarClip(), config.NearZ * 2.0f);
+
+	// View space lights
+	XMFLOAT4X4 viewFloats = camera.GetView();
+	XMMATRIX view = XMLoadFloat4x4(&viewFloats);
+
+	viewSpaceLights.resize(lights.size());
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		const Light& light = lights[i];
+		ClusterLight& clusterLight = viewSpaceLights[i];
+		clusterLight = ClusterLight();
+
+		if (light.Type == LIGHT_TYPE_DIRECTIONAL)
+		{
+			clusterLight.Global = true;
+			continue;
+		}
+
+		XMFLOAT3 position;
+		XMStoreFloat3(&position, XMVector3TransformCoord(XMLoadFloat3(&light.Position), view));
+		clusterLight.Position[0] = position.x;
+		clusterLight.Position[1] = position.y;
+		clusterLight.Position[2] = position.z;
+		clusterLight.Range = light.Range;
+
+		// Spot lights fade with pow(cos, falloff), so find the
+		// angle where that's too dim to matter
+		if (light.Type == LIGHT_TYPE_SPOT && light.SpotFalloff > 0.0f)
+		{
+			XMFLOAT3 direction;
+			XMStoreFloat3(&direction, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&light.Direction), view)));
+			clusterLight.Direction[0] = direction.x;
+			clusterLight.Direction[1] = direction.y;
+			clusterLight.Direction[2] = direction.z;
+			clusterLight.SpotCosCutoff = powf(SPOT_CUTOFF_INTENSITY, 1.0f / light.SpotFalloff);
+		}
+	}
+
+	builder.Build(config, viewSpaceLights.data(), (unsigned int)viewSpaceLights.size());
+
+	// Upload the results
+	const std::vector<uint32_t>& ranges = builder.GetClusterRanges();
+	const std::vector<uint32_t>& indices = builder.GetLightIndices();
+	lightBuffer.Upload(lights.data(), (unsigned int)lights.size(), sizeof(Light));
+	rangeBuffer.Upload(ranges.data(), (unsigned int)ranges.size() / 2, sizeof(uint32_t) * 2);
+	indexBuffer.Upload(indices.data(), (unsigned int)indices.size(), sizeof(uint32_t));
+
+	// Shader side parameters
+	float logDepthRange = logf(config.FarZ / config.NearZ);
+	XMFLOAT3 forward = camera.GetTransform().GetForward();
+
+	shaderInfo.Counts[0] = config.CountX;
+	shaderInfo.Counts[1] = config.CountY;
+	shaderInfo.Counts[2] = config.CountZ;
+	shaderInfo.NearZ = config.NearZ;
+	shaderInfo.TileSize = XMFLOAT2((float)screenWidth / config.CountX, (float)screenHeight / config.CountY);
+	shaderInfo.DepthScale = config.CountZ / logDepthRange;
+	shaderInfo.DepthBias = config.CountZ * logf(config.NearZ) / logDepthRange;
+	shaderInfo.CameraForward = forward;
+	shaderInfo.GlobalLightCount = builder.GetGlobalLightCount();
+	shaderInfo.ShadowLightIndex = shadowLightIndex;
+}
+
+// --------------------------------------------------------
+// Binds the cluster buffers to a (clustered) pixel shader
+// --------------------------------------------------------
+void ClusteredLighting::SetShaderData(std::shared_ptr<SimplePixelShader> pixelShader, const SimpleShaderHandle& clusterInfoHandle, ID3D11DeviceContext* context)
+{
+	pixelShader->SetData(clusterInfoHandle, &shaderInfo, sizeof(ClusterShaderInfo));
+	pixelShader->SetShaderResourceView("Lights", lightBuffer.GetSRV(), context);
+	pixelShader->SetShaderResourceView("ClusterRanges", rangeBuffer.GetSRV(), context);
+	pixelShader->SetShaderResourceView("ClusterLightIndices", indexBuffer.GetSRV(), context);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <DirectXMath.h>
+#include <memory>
+#include <vector>
+
+#include "Camera.h"
+#include "DynamicStructuredBuffer.h"
+#include "Lights.h"
+#include "LightClusters.h"
+#include "SimpleShader.h"
+
+// Per-frame cluster parameters, matching ClusterInfo in UberPS.hlsli
+struct ClusterShaderInfo
+{
+	unsigned int Counts[3];
+	float NearZ;
+
+	DirectX::XMFLOAT2 TileSize;	// In pixels
+	float DepthScale;			// slice = log(z) * DepthScale - DepthBias
+	float DepthBias;
+
+	DirectX::XMFLOAT3 CameraForward;
+	unsigned int GlobalLightCount;
+
+	int ShadowLightIndex;
+	DirectX::XMFLOAT3 Padding;
+};
+
+// --------------------------------------------------------
+// Runs the CPU light cluster builder for the current camera
+// and uploads the results as structured buffers for the
+// clustered permutations of the uber shader:
+//
+//  - Lights              : every light, as-is
+//  - ClusterRanges       : (offset, count) per cluster
+//  - ClusterLightIndices : global lights, then per-cluster lists
+// --------------------------------------------------------
+class ClusteredLighting
+{
+public:
+	ClusteredLighting(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		std::shared_ptr<JobSystem> jobs = 0,
+		LightClusterConfig config = LightClusterConfig());
+	~ClusteredLighting();
+
+	// Rebuilds the clusters - call once per frame, before drawing
+	void Update(const std::vector<Light>& lights, Camera& camera, unsigned int screenWidth, unsigned int screenHeight, int shadowLightIndex);
+
+	// Binds the buffers and cluster info to a pixel shader
+	void SetShaderData(std::shared_ptr<SimplePixelShader> pixelShader, const SimpleShaderHandle& clusterInfoHandle, ID3D11DeviceContext* context = 0);
+
+	// Getters
+	const ClusterShaderInfo& GetShaderInfo() { return shaderInfo; }
+	LightClusterBuilder& GetBuilder() { return builder; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+	LightClusterConfig config;
+	LightClusterBuilder builder;
+	std::vector<ClusterLight> viewSpaceLights;
+	ClusterShaderInfo shaderInfo;
+
+	DynamicStructuredBuffer lightBuffer;
+	DynamicStructuredBuffer rangeBuffer;
+	DynamicStructuredBuffer indexBuffer;
+};
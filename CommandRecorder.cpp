@@ -0,0 +1,55 @@
+#include "CommandRecorder.h"
+
+CommandRecorder::CommandRecorder(std::shared_ptr<CommandBackend> backend, std::shared_ptr<JobSystem> jobs) :
+	backend(backend),
+	jobs(jobs),
+	parallel(true),
+	ranParallel(false)
+{
+}
+
+CommandRecorder::~CommandRecorder()
+{
+}
+
+void CommandRecorder::Add(CommandRecordFunction record)
+{
+	chunks.push_back(record);
+}
+
+// --------------------------------------------------------
+// Records the queued chunks, in parallel when possible, and
+// submits them in order.  Every job has finished with the
+// chunks by the time this returns.
+// --------------------------------------------------------
+void CommandRecorder::Run()
+{
+	uint32_t count = (uint32_t)chunks.size();
+	chunkThreads.assign(count, 0);
+	ranParallel = parallel && jobs->GetWorkerCount() > 0 && count > 1 && backend->BeginRecording(count);
+
+	if (!ranParallel)
+	{
+		CommandContext* immediate = backend->GetImmediateContext();
+		for (CommandRecordFunction& record : chunks)
+			record(*immediate);
+		chunks.clear();
+		return;
+	}
+
+	// One job per chunk, and help out while they run
+	JobCounter recorded;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		jobs->Run([this, i](uint32_t thread) {
+			chunks[i](*backend->GetRecordingContext(i));
+			backend->FinishRecording(i);
+			chunkThreads[i] = thread;
+		}, &recorded);
+	}
+	jobs->Wait(recorded);
+
+	for (uint32_t i = 0; i < count; i++)
+		backend->Submit(i);
+	chunks.clear();
+}
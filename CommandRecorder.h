@@ -0,0 +1,98 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "JobSystem.h"
+
+// --------------------------------------------------------
+// Somewhere commands can be recorded.  Backends derive from
+// this with whatever their API records into.
+// --------------------------------------------------------
+class CommandContext
+{
+public:
+	virtual ~CommandContext() {}
+};
+
+// --------------------------------------------------------
+// What a CommandRecorder needs from a graphics API.  Lists
+// are numbered by the order they'll be submitted in.
+//
+// This stays separate from the RHI: an RHIContext issues
+// draws, but has no idea of lists that are recorded on
+// other threads and submitted later, which is all this is.
+// Chunks that draw through the RHI wrap their backend's
+// context in one (like D3D11RHIContext around a deferred
+// context).
+// --------------------------------------------------------
+class CommandBackend
+{
+public:
+	virtual ~CommandBackend() {}
+
+	// The context that runs commands right away (main thread only)
+	virtual CommandContext* GetImmediateContext() = 0;
+
+	// Gets contexts ready for recording count lists (main
+	// thread), or returns false if lists can't be recorded
+	virtual bool BeginRecording(uint32_t count) = 0;
+
+	// The context list index is recorded into, and closing
+	// it once recorded.  Each index is only used by one
+	// thread at a time, but different ones run in parallel.
+	virtual CommandContext* GetRecordingContext(uint32_t index) = 0;
+	virtual void FinishRecording(uint32_t index) = 0;
+
+	// Runs a finished list on the immediate context (main thread)
+	virtual void Submit(uint32_t index) = 0;
+};
+
+typedef std::function<void(CommandContext& context)> CommandRecordFunction;
+
+// --------------------------------------------------------
+// Records chunks of commands as jobs, each into its own
+// list, then submits the lists in the order the chunks
+// were added - so the results match recording them one
+// after the other on the immediate context.
+//
+// The calling thread records chunks too while it waits.
+// Chunks are numbered with the job system's thread numbers
+// (the caller is 0), which is what per-thread state like
+// SimpleShader's thread slots should be set up with.
+//
+// With parallel recording off (or no workers, or a backend
+// that can't record lists), chunks run in order straight on
+// the immediate context.
+// --------------------------------------------------------
+class CommandRecorder
+{
+public:
+	CommandRecorder(std::shared_ptr<CommandBackend> backend, std::shared_ptr<JobSystem> jobs);
+	~CommandRecorder();
+
+	// Queues a chunk for the next Run()
+	void Add(CommandRecordFunction record);
+
+	// Records & submits everything queued, then clears the queue
+	void Run();
+
+	void SetParallel(bool parallel) { this->parallel = parallel; }
+	bool IsParallel() const { return parallel; }
+
+	// Stats about the last Run()
+	uint32_t GetWorkerCount() const { return jobs->GetWorkerCount(); }
+	uint32_t GetChunkCount() const { return (uint32_t)chunkThreads.size(); }
+	uint32_t GetChunkThread(uint32_t chunk) const { return chunkThreads[chunk]; }
+	bool WasParallel() const { return ranParallel; }
+
+private:
+	std::shared_ptr<CommandBackend> backend;
+	std::shared_ptr<JobSystem> jobs;
+	std::vector<CommandRecordFunction> chunks;
+	std::vector<uint32_t> chunkThreads;
+	bool parallel;
+	bool ranParallel;
+};
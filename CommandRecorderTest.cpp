@@ -0,0 +1,122 @@
+// --------------------------------------------------------
+// Tests CommandRecorder with MemoryCommandBackend.  Chunks
+// of different sizes are recorded by several job system
+// workers at once, and what the backend ran must be every
+// chunk's commands in the order the chunks were added -
+// the same as recording them one after the other on the
+// immediate context, which serial recording (and a job
+// system without workers) must also match.
+// --------------------------------------------------------
+#include <vector>
+
+#include "CommandRecorder.h"
+#include "MemoryCommandBackend.h"
+#include "TestCheck.h"
+
+#define CHUNK_COUNT 48
+#define RUN_COUNT 50
+
+// Chunk i records i * 1000 + 0, 1, 2... with some made-up
+// work between commands, so chunks finish out of order
+static void AddChunks(CommandRecorder& recorder)
+{
+	for (uint32_t i = 0; i < CHUNK_COUNT; i++)
+	{
+		recorder.Add([i](CommandContext& context) {
+			MemoryCommandContext& memory = static_cast<MemoryCommandContext&>(context);
+			uint32_t count = 1 + (i * 7919) % 37;
+			volatile uint32_t work = 0;
+			for (uint32_t c = 0; c < count; c++)
+			{
+				for (uint32_t w = 0; w < ((CHUNK_COUNT - i) * 200); w++)
+					work = work + w;
+				memory.Record(i * 1000 + c);
+			}
+		});
+	}
+}
+
+// What recording the chunks in order produces
+static std::vector<uint32_t> ExpectedCommands()
+{
+	std::vector<uint32_t> expected;
+	for (uint32_t i = 0; i < CHUNK_COUNT; i++)
+	{
+		uint32_t count = 1 + (i * 7919) % 37;
+		for (uint32_t c = 0; c < count; c++)
+			expected.push_back(i * 1000 + c);
+	}
+	return expected;
+}
+
+static void TestParallelOrder()
+{
+	std::shared_ptr<MemoryCommandBackend> backend = std::make_shared<MemoryCommandBackend>();
+	std::shared_ptr<JobSystem> jobs = std::make_shared<JobSystem>(4);
+	CommandRecorder recorder(backend, jobs);
+	std::vector<uint32_t> expected = ExpectedCommands();
+
+	// Which threads record what is up to the scheduler, so
+	// run it enough times for the workers to join in
+	bool usedWorkers = false;
+	for (uint32_t run = 0; run < RUN_COUNT; run++)
+	{
+		backend->ClearExecuted();
+		uint32_t submitted = backend->GetSubmitCount();
+		AddChunks(recorder);
+		recorder.Run();
+
+		CHECK(recorder.WasParallel());
+		CHECK(recorder.GetChunkCount() == CHUNK_COUNT);
+		CHECK(backend->GetSubmitCount() - submitted == CHUNK_COUNT);
+		CHECK(backend->GetExecuted() == expected);
+
+		for (uint32_t i = 0; i < recorder.GetChunkCount(); i++)
+		{
+			CHECK(recorder.GetChunkThread(i) < jobs->GetThreadCount());
+			usedWorkers |= recorder.GetChunkThread(i) != 0;
+		}
+	}
+	CHECK(usedWorkers);
+
+	// The queue was cleared, so running again does nothing
+	backend->ClearExecuted();
+	recorder.Run();
+	CHECK(recorder.GetChunkCount() == 0);
+	CHECK(backend->GetExecuted().empty());
+}
+
+static void TestSerialOrder()
+{
+	std::shared_ptr<MemoryCommandBackend> backend = std::make_shared<MemoryCommandBackend>();
+	std::shared_ptr<JobSystem> jobs = std::make_shared<JobSystem>(4);
+	CommandRecorder recorder(backend, jobs);
+	recorder.SetParallel(false);
+
+	AddChunks(recorder);
+	recorder.Run();
+	CHECK(!recorder.WasParallel());
+	CHECK(backend->GetSubmitCount() == 0);
+	CHECK(backend->GetExecuted() == ExpectedCommands());
+}
+
+static void TestNoWorkers()
+{
+	std::shared_ptr<MemoryCommandBackend> backend = std::make_shared<MemoryCommandBackend>();
+	std::shared_ptr<JobSystem> jobs = std::make_shared<JobSystem>(0);
+	CommandRecorder recorder(backend, jobs);
+
+	AddChunks(recorder);
+	recorder.Run();
+	CHECK(!recorder.WasParallel());
+	CHECK(backend->GetContextCount() == 0);
+	CHECK(backend->GetExecuted() == ExpectedCommands());
+}
+
+int main()
+{
+	TestParallelOrder();
+	TestSerialOrder();
+	TestNoWorkers();
+	return TestResult();
+}
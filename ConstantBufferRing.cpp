@@ -0,0 +1,239 @@
+#include "ConstantBufferRing.h"
+
+#include <string.h>
+
+// Offsets passed to *SetConstantBuffers1() are in 16-byte
+// constants and must be multiples of 16 constants (256 bytes)
+#define CONSTANT_SIZE 16
+#define CONSTANT_BLOCK_ALIGNMENT 256
+
+// Private data key a deferred context keeps its ring under
+static const GUID RingContextKey = { 0x6f3c2a91, 0x52d4, 0x4b1e, { 0x9a, 0x07, 0x3e, 0xc8, 0x41, 0x5b, 0xd2, 0x6e } };
+
+// --------------------------------------------------------
+// Constructor - Creates the dynamic buffer if the device
+// supports binding constant buffers at an offset
+// --------------------------------------------------------
+ConstantBufferRing::ConstantBufferRing(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	unsigned int sizeInBytes)
+	:
+	supported(false),
+	deferred(context->GetType() == D3D11_DEVICE_CONTEXT_DEFERRED),
+	mappedSinceDiscard(false),
+	frameFenceValue(0),
+	generation(0),
+	allocator(sizeInBytes, CONSTANT_BLOCK_ALIGNMENT),
+	device(device)
+{
+	// Offset binding lives on the 11.1 context
+	if (FAILED(context.As(&context1)))
+		return;
+
+	// The driver must allow both offsets and NO_OVERWRITE on constant buffers
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+	if (!options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer)
+		return;
+
+	// Create the ring's backing buffer
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.ByteWidth = allocator.GetCapacity();
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.MiscFlags = 0;
+	desc.StructureByteStride = 0;
+	supported = SUCCEEDED(device->CreateBuffer(&desc, 0, buffer.GetAddressOf()));
+
+	// Let shaders recording on a deferred context find its ring
+	if (supported && deferred)
+	{
+		ConstantBufferRing* ring = this;
+		context1->SetPrivateData(RingContextKey, sizeof(ring), &ring);
+	}
+}
+
+// Destructor
+ConstantBufferRing::~ConstantBufferRing()
+{
+	if (supported && deferred)
+		context1->SetPrivateData(RingContextKey, 0, 0);
+}
+
+// Is offset binding available on this device?
+bool ConstantBufferRing::IsSupported()
+{
+	return supported;
+}
+
+// --------------------------------------------------------
+// Retires every frame whose fence the GPU has passed,
+// freeing up its portion of the ring
+// --------------------------------------------------------
+void ConstantBufferRing::BeginFrame()
+{
+	if (!supported || deferred) return;
+
+	while (!pendingFences.empty())
+	{
+		// Check without flushing - we don't want to stall here
+		BOOL done = FALSE;
+		HRESULT hr = context1->GetData(
+			pendingFences.front().Query.Get(),
+			&done,
+			sizeof(done),
+			D3D11_ASYNC_GETDATA_DONOTFLUSH);
+
+		if (hr != S_OK || !done)
+			break;
+
+		// Fences complete in order, so everything up to here is free
+		allocator.ReleaseCompletedFrames(pendingFences.front().FenceValue);
+		freeQueries.push_back(pendingFences.front().Query);
+		pendingFences.pop_front();
+	}
+}
+
+// --------------------------------------------------------
+// Issues a fence for everything written this frame
+// --------------------------------------------------------
+void ConstantBufferRing::EndFrame()
+{
+	if (!supported || deferred) return;
+
+	// Reuse a query if we can
+	Microsoft::WRL::ComPtr<ID3D11Query> query;
+	if (!freeQueries.empty())
+	{
+		query = freeQueries.back();
+		freeQueries.pop_back();
+	}
+	else
+	{
+		D3D11_QUERY_DESC queryDesc = {};
+		queryDesc.Query = D3D11_QUERY_EVENT;
+		device->CreateQuery(&queryDesc, query.GetAddressOf());
+	}
+
+	frameFenceValue++;
+	generation++;
+	allocator.EndFrame(frameFenceValue);
+
+	// Without a query we can't know when the GPU is done, so
+	// treat the frame as complete (the wrap DISCARD still
+	// protects the data, at the cost of a driver rename)
+	if (!query)
+	{
+		allocator.ReleaseCompletedFrames(frameFenceValue);
+		return;
+	}
+
+	context1->End(query.Get());
+	pendingFences.push_back({ frameFenceValue, query });
+}
+
+// --------------------------------------------------------
+// Starts a deferred ring over for the next command list,
+// whose first write discards.  The finished list keeps the
+// copy of the buffer it wrote, so nothing is overwritten.
+// --------------------------------------------------------
+void ConstantBufferRing::FinishList()
+{
+	if (!supported || !deferred) return;
+
+	allocator.Reset();
+	mappedSinceDiscard = false;
+	generation++;
+}
+
+// --------------------------------------------------------
+// Finds the ring attached to a deferred context, or null
+// --------------------------------------------------------
+ConstantBufferRing* ConstantBufferRing::FromContext(ID3D11DeviceContext* context)
+{
+	ConstantBufferRing* ring = 0;
+	UINT size = sizeof(ring);
+	if (!context || FAILED(context->GetPrivateData(RingContextKey, &size, &ring)) || size != sizeof(ring))
+		return 0;
+	return ring;
+}
+
+// --------------------------------------------------------
+// Copies data into the next free block of the ring
+//
+// data          - The constant data to copy
+// size          - Size of the data in bytes
+// firstConstant - Receives the offset to bind with, in constants
+// constantCount - Receives the number of constants to bind
+//
+// Returns false if the ring is unsupported or full, in which
+// case the caller should fall back to its own buffer
+// --------------------------------------------------------
+bool ConstantBufferRing::Write(const void* data, unsigned int size, unsigned int* firstConstant, unsigned int* constantCount)
+{
+	if (!supported) return false;
+
+	unsigned int offset = 0;
+	bool wrapped = false;
+	if (!allocator.Allocate(size, &offset, &wrapped))
+	{
+		// A list that fills a deferred ring starts over with a
+		// discard, which leaves its earlier draws their copy
+		if (!deferred)
+			return false;
+
+		allocator.Reset();
+		if (!allocator.Allocate(size, &offset, &wrapped))
+			return false;
+		wrapped = true;
+	}
+
+	// Discard when starting over (and on the very first map),
+	// otherwise promise the driver we won't touch in-flight data
+	D3D11_MAP mapType = (wrapped || !mappedSinceDiscard) ?
+		D3D11_MAP_WRITE_DISCARD :
+		D3D11_MAP_WRITE_NO_OVERWRITE;
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context1->Map(buffer.Get(), 0, mapType, 0, &mapped)))
+		return false;
+
+	// Earlier blocks don't survive a discard
+	if (mapType == D3D11_MAP_WRITE_DISCARD)
+		generation++;
+
+	memcpy((unsigned char*)mapped.pData + offset, data, size);
+	context1->Unmap(buffer.Get(), 0);
+	mappedSinceDiscard = true;
+
+	*firstConstant = offset / CONSTANT_SIZE;
+	*constantCount = RingAllocator::AlignUp(size, CONSTANT_BLOCK_ALIGNMENT) / CONSTANT_SIZE;
+	return true;
+}
+
+// Get the ring's buffer
+ID3D11Buffer* ConstantBufferRing::GetBuffer()
+{
+	return buffer.Get();
+}
+
+// Get the 11.1 context used for offset binding
+Microsoft::WRL::ComPtr<ID3D11DeviceContext1> ConstantBufferRing::GetContext1()
+{
+	return context1;
+}
+
+// Get the number of bytes currently in use
+unsigned int ConstantBufferRing::GetUsedBytes()
+{
+	return allocator.GetUsedBytes();
+}
+
+// Get the current generation, which changes every frame and on
+// every discard - blocks from older generations may be stale
+unsigned long long ConstantBufferRing::GetGeneration()
+{
+	return generation;
+}
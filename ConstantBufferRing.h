@@ -0,0 +1,84 @@
+#pragma once
+
+#include <d3d11_1.h>
+#include <wrl/client.h> // Used for ComPtr
+#include <deque>
+#include <vector>
+
+#include "RingAllocator.h"
+
+// --------------------------------------------------------
+// One large dynamic constant buffer that per-draw constants
+// are sub-allocated from, instead of every shader owning a
+// buffer that's updated with UpdateSubresource.
+//
+// - Writes use MAP_WRITE_NO_OVERWRITE until the ring wraps,
+//   and MAP_WRITE_DISCARD when it does
+// - Blocks are bound with the *SetConstantBuffers1() offset
+//   variants, which requires Direct3D 11.1
+// - Event queries act as per-frame fences, so space is only
+//   reused once the GPU has finished the frame that used it
+//
+// A ring made on a deferred context works per command list
+// instead: the first write of each list discards, which
+// gives the list its own copy of the buffer, so it needs no
+// fences and starts over once FinishList() is called.  It's
+// attached to its context, so shaders recording there can
+// find it with FromContext().
+// --------------------------------------------------------
+class ConstantBufferRing
+{
+public:
+	ConstantBufferRing(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		unsigned int sizeInBytes);
+	~ConstantBufferRing();
+
+	// Is offset binding available on this device?
+	bool IsSupported();
+
+	// Frame fencing - call once at the start and end of each frame
+	void BeginFrame();
+	void EndFrame();
+
+	// Deferred rings only - call after each FinishCommandList()
+	void FinishList();
+
+	// The ring attached to a deferred context, if it has one
+	static ConstantBufferRing* FromContext(ID3D11DeviceContext* context);
+
+	// Copies data into the ring and returns where it landed,
+	// in units of 16-byte constants, or false if there's no room
+	bool Write(const void* data, unsigned int size, unsigned int* firstConstant, unsigned int* constantCount);
+
+	// Getters
+	ID3D11Buffer* GetBuffer();
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> GetContext1();
+	unsigned int GetUsedBytes();
+	unsigned long long GetGeneration();
+
+private:
+
+	// A fence that has been issued but not yet reached
+	struct PendingFence
+	{
+		unsigned long long FenceValue;
+		Microsoft::WRL::ComPtr<ID3D11Query> Query;
+	};
+
+	bool supported;
+	bool deferred;
+	bool mappedSinceDiscard;
+	unsigned long long frameFenceValue;
+	unsigned long long generation;
+
+	RingAllocator allocator;
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> context1;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+
+	std::deque<PendingFence> pendingFences;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11Query>> freeQueries;
+};
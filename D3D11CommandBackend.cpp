@@ -0,0 +1,92 @@
+#include "D3D11CommandBackend.h"
+
+D3D11CommandBackend::D3D11CommandBackend(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) :
+	device(device),
+	ringSize(0),
+	driverCommandLists(false)
+{
+	immediate.Context = context;
+
+	D3D11_FEATURE_DATA_THREADING threading = {};
+	if (SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_THREADING, &threading, sizeof(threading))))
+		driverCommandLists = threading.DriverCommandLists == TRUE;
+}
+
+D3D11CommandBackend::~D3D11CommandBackend()
+{
+}
+
+CommandContext* D3D11CommandBackend::GetImmediateContext()
+{
+	return &immediate;
+}
+
+// --------------------------------------------------------
+// Makes deferred contexts until there's one per list
+// --------------------------------------------------------
+bool D3D11CommandBackend::BeginRecording(uint32_t count)
+{
+	while (deferred.size() < count)
+	{
+		D3D11CommandContext entry;
+		if (FAILED(device->CreateDeferredContext(0, entry.Context.GetAddressOf())))
+			return false;
+		CreateRing(entry);
+		deferred.push_back(entry);
+	}
+	return true;
+}
+
+CommandContext* D3D11CommandBackend::GetRecordingContext(uint32_t index)
+{
+	return &deferred[index];
+}
+
+void D3D11CommandBackend::FinishRecording(uint32_t index)
+{
+	D3D11CommandContext& entry = deferred[index];
+	entry.List.Reset();
+	entry.Context->FinishCommandList(FALSE, entry.List.GetAddressOf());
+	if (entry.Ring)
+		entry.Ring->FinishList();
+}
+
+void D3D11CommandBackend::Submit(uint32_t index)
+{
+	D3D11CommandContext& entry = deferred[index];
+	if (!entry.List)
+		return;
+
+	immediate.Context->ExecuteCommandList(entry.List.Get(), TRUE);
+	entry.List.Reset();
+}
+
+// --------------------------------------------------------
+// Swaps every deferred context's ring for one of the new
+// size (and any made later get one too)
+// --------------------------------------------------------
+void D3D11CommandBackend::SetConstantBufferRingSize(unsigned int sizeInBytes)
+{
+	ringSize = sizeInBytes;
+	for (D3D11CommandContext& entry : deferred)
+		CreateRing(entry);
+}
+
+// Unsupported rings are dropped, so shaders fall back to their own buffers
+void D3D11CommandBackend::CreateRing(D3D11CommandContext& entry)
+{
+	entry.Ring.reset();
+	if (ringSize == 0)
+		return;
+
+	std::shared_ptr<ConstantBufferRing> ring = std::make_shared<ConstantBufferRing>(device, entry.Context, ringSize);
+	if (ring->IsSupported())
+		entry.Ring = ring;
+}
+
+ID3D11DeviceContext* D3D11CommandBackend::GetContext(CommandContext& context)
+{
+	return static_cast<D3D11CommandContext&>(context).Context.Get();
+}
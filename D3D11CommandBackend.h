@@ -0,0 +1,73 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <vector>
+
+#include "CommandRecorder.h"
+#include "ConstantBufferRing.h"
+
+// --------------------------------------------------------
+// A Direct3D 11 context to record into: the immediate one,
+// or a deferred one along with the list it last finished
+// and the constant buffer ring it uploads through
+// --------------------------------------------------------
+class D3D11CommandContext : public CommandContext
+{
+public:
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> Context;
+	Microsoft::WRL::ComPtr<ID3D11CommandList> List;
+	std::shared_ptr<ConstantBufferRing> Ring;
+};
+
+// --------------------------------------------------------
+// Records lists with deferred contexts (made as needed and
+// kept for reuse), and plays them back on the immediate one.
+//
+// Deferred contexts start with default state every list, so
+// chunks bind everything they use - targets, viewport &
+// topology included.  The immediate context's state is put
+// back after each list, so code after a Run() carries on as
+// if the chunks had been recorded on it directly.
+//
+// With a ring size set, each deferred context gets its own
+// ConstantBufferRing, which SimpleShader finds and uploads
+// through when recording there (the immediate context's
+// ring can't be mapped from other threads).
+// --------------------------------------------------------
+class D3D11CommandBackend : public CommandBackend
+{
+public:
+	D3D11CommandBackend(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	~D3D11CommandBackend();
+
+	// CommandBackend
+	CommandContext* GetImmediateContext();
+	bool BeginRecording(uint32_t count);
+	CommandContext* GetRecordingContext(uint32_t index);
+	void FinishRecording(uint32_t index);
+	void Submit(uint32_t index);
+
+	// Gives every deferred context a constant buffer ring of
+	// this size, or none with 0 (main thread, between Run()s)
+	void SetConstantBufferRingSize(unsigned int sizeInBytes);
+
+	// The D3D context a chunk should record into
+	static ID3D11DeviceContext* GetContext(CommandContext& context);
+
+	// Does the driver record lists itself (otherwise the
+	// runtime emulates them, which still works)?
+	bool HasDriverCommandLists() { return driverCommandLists; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	D3D11CommandContext immediate;
+	std::vector<D3D11CommandContext> deferred;
+	unsigned int ringSize;
+	bool driverCommandLists;
+
+	void CreateRing(D3D11CommandContext& entry);
+};
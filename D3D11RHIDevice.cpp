@@ -0,0 +1,412 @@
+#include "D3D11RHIDevice.h"
+
+#include <cstring>
+
+// --------------------------------------------------------
+// Pipeline states are the only handles that need more than
+// one native object
+// --------------------------------------------------------
+struct D3D11RHIPipelineState
+{
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> Rasterizer;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> Depth;
+	Microsoft::WRL::ComPtr<ID3D11BlendState> Blend;
+};
+
+// RHI_COMPARISON_* to Direct3D's
+static const D3D11_COMPARISON_FUNC comparisonFuncs[] =
+{
+	D3D11_COMPARISON_NEVER,
+	D3D11_COMPARISON_LESS,
+	D3D11_COMPARISON_EQUAL,
+	D3D11_COMPARISON_LESS_EQUAL,
+	D3D11_COMPARISON_GREATER,
+	D3D11_COMPARISON_GREATER_EQUAL,
+	D3D11_COMPARISON_ALWAYS,
+};
+
+static UINT GetD3DBindFlags(uint32_t bindFlags)
+{
+	UINT flags = 0;
+	if (bindFlags & RHI_BIND_VERTEX_BUFFER) flags |= D3D11_BIND_VERTEX_BUFFER;
+	if (bindFlags & RHI_BIND_INDEX_BUFFER) flags |= D3D11_BIND_INDEX_BUFFER;
+	if (bindFlags & RHI_BIND_CONSTANT_BUFFER) flags |= D3D11_BIND_CONSTANT_BUFFER;
+	if (bindFlags & RHI_BIND_SHADER_RESOURCE) flags |= D3D11_BIND_SHADER_RESOURCE;
+	if (bindFlags & RHI_BIND_RENDER_TARGET) flags |= D3D11_BIND_RENDER_TARGET;
+	if (bindFlags & RHI_BIND_DEPTH_STENCIL) flags |= D3D11_BIND_DEPTH_STENCIL;
+	if (bindFlags & RHI_BIND_UNORDERED_ACCESS) flags |= D3D11_BIND_UNORDERED_ACCESS;
+	return flags;
+}
+
+// --------------------------------------------------------
+// Depth buffers that shaders also read need typeless
+// textures, with the views picking the real format
+// --------------------------------------------------------
+static DXGI_FORMAT GetTextureFormat(DXGI_FORMAT format, uint32_t bindFlags)
+{
+	if (!(bindFlags & RHI_BIND_DEPTH_STENCIL) || !(bindFlags & RHI_BIND_SHADER_RESOURCE))
+		return format;
+	if (format == DXGI_FORMAT_D32_FLOAT) return DXGI_FORMAT_R32_TYPELESS;
+	if (format == DXGI_FORMAT_D24_UNORM_S8_UINT) return DXGI_FORMAT_R24G8_TYPELESS;
+	return format;
+}
+
+static DXGI_FORMAT GetViewFormat(DXGI_FORMAT textureFormat, uint32_t type)
+{
+	bool depth = type == RHI_VIEW_DEPTH_STENCIL;
+	if (textureFormat == DXGI_FORMAT_R32_TYPELESS) return depth ? DXGI_FORMAT_D32_FLOAT : DXGI_FORMAT_R32_FLOAT;
+	if (textureFormat == DXGI_FORMAT_R24G8_TYPELESS) return depth ? DXGI_FORMAT_D24_UNORM_S8_UINT : DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+	return DXGI_FORMAT_UNKNOWN;
+}
+
+static D3D11_USAGE GetD3DUsage(uint32_t usage)
+{
+	if (usage == RHI_USAGE_IMMUTABLE) return D3D11_USAGE_IMMUTABLE;
+	if (usage == RHI_USAGE_DYNAMIC) return D3D11_USAGE_DYNAMIC;
+	return D3D11_USAGE_DEFAULT;
+}
+
+// --------------------------------------------------------
+// Context
+// --------------------------------------------------------
+D3D11RHIContext::D3D11RHIContext(ID3D11DeviceContext* context) :
+	context(context)
+{
+}
+
+D3D11RHIContext::~D3D11RHIContext()
+{
+}
+
+// --------------------------------------------------------
+// An empty handle puts back Direct3D's default states
+// --------------------------------------------------------
+void D3D11RHIContext::SetPipelineState(RHIPipelineState state)
+{
+	D3D11RHIPipelineState* pipeline = (D3D11RHIPipelineState*)state.Id;
+	if (!pipeline)
+	{
+		context->RSSetState(0);
+		context->OMSetDepthStencilState(0, 0);
+		context->OMSetBlendState(0, 0, 0xFFFFFFFF);
+		return;
+	}
+
+	context->RSSetState(pipeline->Rasterizer.Get());
+	context->OMSetDepthStencilState(pipeline->Depth.Get(), 0);
+	context->OMSetBlendState(pipeline->Blend.Get(), 0, 0xFFFFFFFF);
+}
+
+void D3D11RHIContext::SetViewport(const RHIViewport& viewport)
+{
+	D3D11_VIEWPORT vp = {};
+	vp.TopLeftX = viewport.X;
+	vp.TopLeftY = viewport.Y;
+	vp.Width = viewport.Width;
+	vp.Height = viewport.Height;
+	vp.MinDepth = viewport.MinDepth;
+	vp.MaxDepth = viewport.MaxDepth;
+	context->RSSetViewports(1, &vp);
+}
+
+void D3D11RHIContext::SetRenderTargets(const RHIView* colors, uint32_t colorCount, RHIView depth)
+{
+	ID3D11RenderTargetView* rtvs[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] = {};
+	if (colorCount > D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT)
+		colorCount = D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT;
+	for (uint32_t i = 0; i < colorCount; i++)
+		rtvs[i] = static_cast<ID3D11RenderTargetView*>(D3D11RHIDevice::GetView(colors[i]));
+
+	context->OMSetRenderTargets(
+		colorCount,
+		rtvs,
+		static_cast<ID3D11DepthStencilView*>(D3D11RHIDevice::GetView(depth)));
+}
+
+void D3D11RHIContext::SetVertexBuffer(RHIBuffer buffer, uint32_t stride, uint32_t offset)
+{
+	ID3D11Buffer* vb = D3D11RHIDevice::GetBuffer(buffer);
+	UINT strides[] = { stride };
+	UINT offsets[] = { offset };
+	context->IASetVertexBuffers(0, 1, &vb, strides, offsets);
+}
+
+void D3D11RHIContext::SetIndexBuffer(RHIBuffer buffer, uint32_t format)
+{
+	context->IASetIndexBuffer(
+		D3D11RHIDevice::GetBuffer(buffer),
+		format == RHI_INDEX_UINT16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT,
+		0);
+}
+
+void D3D11RHIContext::ClearRenderTarget(RHIView view, const float color[4])
+{
+	context->ClearRenderTargetView(static_cast<ID3D11RenderTargetView*>(D3D11RHIDevice::GetView(view)), color);
+}
+
+void D3D11RHIContext::ClearDepthStencil(RHIView view, float depth)
+{
+	context->ClearDepthStencilView(
+		static_cast<ID3D11DepthStencilView*>(D3D11RHIDevice::GetView(view)),
+		D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL,
+		depth,
+		0);
+}
+
+// --------------------------------------------------------
+// Dynamic buffers are mapped & discarded, default ones are
+// updated in place
+// --------------------------------------------------------
+void D3D11RHIContext::UpdateBuffer(RHIBuffer buffer, const void* data, uint32_t size)
+{
+	ID3D11Buffer* native = D3D11RHIDevice::GetBuffer(buffer);
+	if (!native)
+		return;
+
+	D3D11_BUFFER_DESC desc = {};
+	native->GetDesc(&desc);
+	if (desc.Usage == D3D11_USAGE_DYNAMIC)
+	{
+		D3D11_MAPPED_SUBRESOURCE mapped = {};
+		if (FAILED(context->Map(native, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+			return;
+		memcpy(mapped.pData, data, size < desc.ByteWidth ? size : desc.ByteWidth);
+		context->Unmap(native, 0);
+	}
+	else
+	{
+		context->UpdateSubresource(native, 0, 0, data, 0, 0);
+	}
+}
+
+void D3D11RHIContext::Draw(uint32_t vertexCount, uint32_t firstVertex)
+{
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context->Draw(vertexCount, firstVertex);
+}
+
+void D3D11RHIContext::DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex)
+{
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context->DrawIndexed(indexCount, firstIndex, baseVertex);
+}
+
+// --------------------------------------------------------
+// Device
+// --------------------------------------------------------
+D3D11RHIDevice::D3D11RHIDevice(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) :
+	device(device),
+	context(context),
+	immediate(context.Get())
+{
+}
+
+D3D11RHIDevice::~D3D11RHIDevice()
+{
+}
+
+bool D3D11RHIDevice::CreateBuffer(const RHIBufferDesc& desc, const void* initialData, RHIBuffer& buffer)
+{
+	D3D11_BUFFER_DESC bd = {};
+	bd.ByteWidth = desc.Size;
+	bd.BindFlags = GetD3DBindFlags(desc.BindFlags);
+	bd.Usage = GetD3DUsage(desc.Usage);
+	bd.CPUAccessFlags = desc.Usage == RHI_USAGE_DYNAMIC ? D3D11_CPU_ACCESS_WRITE : 0;
+	bd.MiscFlags = desc.Stride > 0 ? D3D11_RESOURCE_MISC_BUFFER_STRUCTURED : 0;
+	bd.StructureByteStride = desc.Stride;
+
+	D3D11_SUBRESOURCE_DATA data = {};
+	data.pSysMem = initialData;
+
+	ID3D11Buffer* native = 0;
+	if (FAILED(device->CreateBuffer(&bd, initialData ? &data : 0, &native)))
+		return false;
+
+	// The handle keeps the reference
+	buffer.Id = (uint64_t)native;
+	return true;
+}
+
+bool D3D11RHIDevice::CreateTexture(const RHITextureDesc& desc, const void* initialData, uint32_t rowPitch, RHITexture& texture)
+{
+	// Initial data only covers one mip of one slice
+	if (initialData && (desc.MipLevels != 1 || desc.ArraySize != 1))
+		return false;
+
+	D3D11_TEXTURE2D_DESC td = {};
+	td.Width = desc.Width;
+	td.Height = desc.Height;
+	td.ArraySize = desc.ArraySize;
+	td.MipLevels = desc.MipLevels;
+	td.Format = GetTextureFormat((DXGI_FORMAT)desc.Format, desc.BindFlags);
+	td.BindFlags = GetD3DBindFlags(desc.BindFlags);
+	td.Usage = GetD3DUsage(desc.Usage);
+	td.CPUAccessFlags = desc.Usage == RHI_USAGE_DYNAMIC ? D3D11_CPU_ACCESS_WRITE : 0;
+	td.SampleDesc.Count = 1;
+
+	D3D11_SUBRESOURCE_DATA data = {};
+	data.pSysMem = initialData;
+	data.SysMemPitch = rowPitch;
+
+	ID3D11Texture2D* native = 0;
+	if (FAILED(device->CreateTexture2D(&td, initialData ? &data : 0, &native)))
+		return false;
+
+	texture.Id = (uint64_t)native;
+	return true;
+}
+
+// --------------------------------------------------------
+// Views see the whole texture, in its own format (or the
+// real one, for typeless depth buffers)
+// --------------------------------------------------------
+bool D3D11RHIDevice::CreateView(RHITexture texture, uint32_t type, RHIView& view)
+{
+	ID3D11Texture2D* native = GetTexture(texture);
+	if (!native)
+		return false;
+
+	D3D11_TEXTURE2D_DESC td = {};
+	native->GetDesc(&td);
+	DXGI_FORMAT viewFormat = GetViewFormat(td.Format, type);
+	bool array = td.ArraySize > 1;
+
+	ID3D11View* nativeView = 0;
+	HRESULT hr = E_INVALIDARG;
+	switch (type)
+	{
+	case RHI_VIEW_SHADER_RESOURCE:
+	{
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = viewFormat;
+		srvDesc.ViewDimension = array ? D3D11_SRV_DIMENSION_TEXTURE2DARRAY : D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2DArray.MipLevels = td.MipLevels;
+		srvDesc.Texture2DArray.ArraySize = td.ArraySize;
+
+		ID3D11ShaderResourceView* srv = 0;
+		hr = device->CreateShaderResourceView(native, viewFormat != DXGI_FORMAT_UNKNOWN ? &srvDesc : 0, &srv);
+		nativeView = srv;
+		break;
+	}
+	case RHI_VIEW_RENDER_TARGET:
+	{
+		ID3D11RenderTargetView* rtv = 0;
+		hr = device->CreateRenderTargetView(native, 0, &rtv);
+		nativeView = rtv;
+		break;
+	}
+	case RHI_VIEW_DEPTH_STENCIL:
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+		dsvDesc.Format = viewFormat;
+		dsvDesc.ViewDimension = array ? D3D11_DSV_DIMENSION_TEXTURE2DARRAY : D3D11_DSV_DIMENSION_TEXTURE2D;
+		dsvDesc.Texture2DArray.ArraySize = td.ArraySize;
+
+		ID3D11DepthStencilView* dsv = 0;
+		hr = device->CreateDepthStencilView(native, viewFormat != DXGI_FORMAT_UNKNOWN ? &dsvDesc : 0, &dsv);
+		nativeView = dsv;
+		break;
+	}
+	case RHI_VIEW_UNORDERED_ACCESS:
+	{
+		ID3D11UnorderedAccessView* uav = 0;
+		hr = device->CreateUnorderedAccessView(native, 0, &uav);
+		nativeView = uav;
+		break;
+	}
+	}
+
+	if (FAILED(hr) || !nativeView)
+		return false;
+
+	view.Id = (uint64_t)nativeView;
+	return true;
+}
+
+bool D3D11RHIDevice::CreatePipelineState(const RHIPipelineStateDesc& desc, RHIPipelineState& state)
+{
+	D3D11RHIPipelineState* pipeline = new D3D11RHIPipelineState();
+
+	D3D11_RASTERIZER_DESC rastDesc = {};
+	rastDesc.FillMode = desc.Wireframe ? D3D11_FILL_WIREFRAME : D3D11_FILL_SOLID;
+	rastDesc.CullMode =
+		desc.CullMode == RHI_CULL_NONE ? D3D11_CULL_NONE :
+		desc.CullMode == RHI_CULL_FRONT ? D3D11_CULL_FRONT : D3D11_CULL_BACK;
+	rastDesc.DepthBias = desc.DepthBias;
+	rastDesc.SlopeScaledDepthBias = desc.SlopeScaledDepthBias;
+	rastDesc.DepthClipEnable = true;
+	rastDesc.ScissorEnable = desc.ScissorEnable;
+	HRESULT hr = device->CreateRasterizerState(&rastDesc, pipeline->Rasterizer.GetAddressOf());
+
+	D3D11_DEPTH_STENCIL_DESC depthDesc = {};
+	depthDesc.DepthEnable = desc.DepthEnable;
+	depthDesc.DepthWriteMask = desc.DepthWrite ? D3D11_DEPTH_WRITE_MASK_ALL : D3D11_DEPTH_WRITE_MASK_ZERO;
+	depthDesc.DepthFunc = comparisonFuncs[desc.DepthFunc <= RHI_COMPARISON_ALWAYS ? desc.DepthFunc : RHI_COMPARISON_LESS];
+	if (SUCCEEDED(hr))
+		hr = device->CreateDepthStencilState(&depthDesc, pipeline->Depth.GetAddressOf());
+
+	// Opaque is the default (null) blend state
+	if (SUCCEEDED(hr) && desc.BlendMode != RHI_BLEND_OPAQUE)
+	{
+		D3D11_BLEND_DESC blendDesc = {};
+		D3D11_RENDER_TARGET_BLEND_DESC& rt = blendDesc.RenderTarget[0];
+		rt.BlendEnable = true;
+		rt.SrcBlend = desc.BlendMode == RHI_BLEND_ALPHA ? D3D11_BLEND_SRC_ALPHA : D3D11_BLEND_ONE;
+		rt.DestBlend = desc.BlendMode == RHI_BLEND_ALPHA ? D3D11_BLEND_INV_SRC_ALPHA : D3D11_BLEND_ONE;
+		rt.BlendOp = D3D11_BLEND_OP_ADD;
+		rt.SrcBlendAlpha = D3D11_BLEND_ONE;
+		rt.DestBlendAlpha = D3D11_BLEND_ONE;
+		rt.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+		rt.RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+		hr = device->CreateBlendState(&blendDesc, pipeline->Blend.GetAddressOf());
+	}
+
+	if (FAILED(hr))
+	{
+		delete pipeline;
+		return false;
+	}
+
+	state.Id = (uint64_t)pipeline;
+	return true;
+}
+
+void D3D11RHIDevice::Destroy(RHIBuffer buffer)
+{
+	if (ID3D11Buffer* native = GetBuffer(buffer))
+		native->Release();
+}
+
+void D3D11RHIDevice::Destroy(RHITexture texture)
+{
+	if (ID3D11Texture2D* native = GetTexture(texture))
+		native->Release();
+}
+
+void D3D11RHIDevice::Destroy(RHIView view)
+{
+	if (ID3D11View* native = GetView(view))
+		native->Release();
+}
+
+void D3D11RHIDevice::Destroy(RHIPipelineState state)
+{
+	delete (D3D11RHIPipelineState*)state.Id;
+}
+
+ID3D11Buffer* D3D11RHIDevice::GetBuffer(RHIBuffer buffer)
+{
+	return (ID3D11Buffer*)buffer.Id;
+}
+
+ID3D11Texture2D* D3D11RHIDevice::GetTexture(RHITexture texture)
+{
+	return (ID3D11Texture2D*)texture.Id;
+}
+
+ID3D11View* D3D11RHIDevice::GetView(RHIView view)
+{
+	return (ID3D11View*)view.Id;
+}
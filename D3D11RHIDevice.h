@@ -0,0 +1,70 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+#include "RHI.h"
+
+// --------------------------------------------------------
+// Wraps a Direct3D 11 context (immediate or deferred).
+// Cheap to make, so code handed a raw context - like a
+// chunk on a worker thread - can wrap it on the stack.
+// --------------------------------------------------------
+class D3D11RHIContext : public RHIContext
+{
+public:
+	D3D11RHIContext(ID3D11DeviceContext* context);
+	~D3D11RHIContext();
+
+	// RHIContext
+	void SetPipelineState(RHIPipelineState state);
+	void SetViewport(const RHIViewport& viewport);
+	void SetRenderTargets(const RHIView* colors, uint32_t colorCount, RHIView depth);
+	void SetVertexBuffer(RHIBuffer buffer, uint32_t stride, uint32_t offset = 0);
+	void SetIndexBuffer(RHIBuffer buffer, uint32_t format);
+	void ClearRenderTarget(RHIView view, const float color[4]);
+	void ClearDepthStencil(RHIView view, float depth);
+	void UpdateBuffer(RHIBuffer buffer, const void* data, uint32_t size);
+	void Draw(uint32_t vertexCount, uint32_t firstVertex = 0);
+	void DrawIndexed(uint32_t indexCount, uint32_t firstIndex = 0, int32_t baseVertex = 0);
+
+	ID3D11DeviceContext* GetContext() { return context; }
+
+private:
+	ID3D11DeviceContext* context;
+};
+
+// --------------------------------------------------------
+// The Direct3D 11 backend.  Handles hold (AddRef'd) COM
+// pointers, so the native objects are a cast away for code
+// that still talks to Direct3D directly.
+// --------------------------------------------------------
+class D3D11RHIDevice : public RHIDevice
+{
+public:
+	D3D11RHIDevice(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	~D3D11RHIDevice();
+
+	// RHIDevice
+	bool CreateBuffer(const RHIBufferDesc& desc, const void* initialData, RHIBuffer& buffer);
+	bool CreateTexture(const RHITextureDesc& desc, const void* initialData, uint32_t rowPitch, RHITexture& texture);
+	bool CreateView(RHITexture texture, uint32_t type, RHIView& view);
+	bool CreatePipelineState(const RHIPipelineStateDesc& desc, RHIPipelineState& state);
+	void Destroy(RHIBuffer buffer);
+	void Destroy(RHITexture texture);
+	void Destroy(RHIView view);
+	void Destroy(RHIPipelineState state);
+	RHIContext* GetImmediateContext() { return &immediate; }
+
+	// Native objects behind handles (not AddRef'd)
+	static ID3D11Buffer* GetBuffer(RHIBuffer buffer);
+	static ID3D11Texture2D* GetTexture(RHITexture texture);
+	static ID3D11View* GetView(RHIView view);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	D3D11RHIContext immediate;
+};
@@ -0,0 +1,108 @@
+#include "D3D11RenderGraphDevice.h"
+
+// Shader resource slots checked when a texture becomes an output
+#define D3D11_RENDER_GRAPH_SRV_SLOTS 16
+
+D3D11RenderGraphDevice::D3D11RenderGraphDevice(
+	std::shared_ptr<D3D11RHIDevice> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) :
+	RHIRenderGraphDevice(device),
+	context(context)
+{
+}
+
+D3D11RenderGraphDevice::~D3D11RenderGraphDevice()
+{
+}
+
+// --------------------------------------------------------
+// Imports.  A D3D11 RHI handle is just the native pointer,
+// so the views are wrapped as they are.
+// --------------------------------------------------------
+void D3D11RenderGraphDevice::ClearImports()
+{
+	RHIRenderGraphDevice::ClearImports();
+	importedViews.clear();
+}
+
+uint32_t D3D11RenderGraphDevice::Import(
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> rtv,
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv,
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> dsv,
+	unsigned int width,
+	unsigned int height)
+{
+	if (rtv) importedViews.push_back(rtv);
+	if (srv) importedViews.push_back(srv);
+	if (dsv) importedViews.push_back(dsv);
+
+	RHIView rtvHandle, srvHandle, dsvHandle;
+	rtvHandle.Id = (uint64_t)static_cast<ID3D11View*>(rtv.Get());
+	srvHandle.Id = (uint64_t)static_cast<ID3D11View*>(srv.Get());
+	dsvHandle.Id = (uint64_t)static_cast<ID3D11View*>(dsv.Get());
+	return RHIRenderGraphDevice::Import(rtvHandle, srvHandle, dsvHandle, width, height);
+}
+
+// --------------------------------------------------------
+// Unbinds a texture from the stage it's about to stop
+// being used in
+// --------------------------------------------------------
+void D3D11RenderGraphDevice::Transition(uint32_t texture, uint32_t before, uint32_t after)
+{
+	Entry* entry = Find(texture);
+	if (!entry)
+		return;
+
+	// Any view will do for finding the resource
+	ID3D11View* view = D3D11RHIDevice::GetView(entry->RTV);
+	if (!view) view = D3D11RHIDevice::GetView(entry->SRV);
+	if (!view) view = D3D11RHIDevice::GetView(entry->DSV);
+	if (!view)
+		return;
+
+	Microsoft::WRL::ComPtr<ID3D11Resource> textureResource;
+	view->GetResource(textureResource.GetAddressOf());
+
+	if (after == RENDER_GRAPH_STATE_SHADER_RESOURCE)
+	{
+		// Becoming an input - the previous pass's targets are done
+		context->OMSetRenderTargets(0, 0, 0);
+		return;
+	}
+
+	// Becoming an output - clear out any pixel shader slots it's in
+	ID3D11ShaderResourceView* srvs[D3D11_RENDER_GRAPH_SRV_SLOTS] = {};
+	context->PSGetShaderResources(0, D3D11_RENDER_GRAPH_SRV_SLOTS, srvs);
+	for (unsigned int i = 0; i < D3D11_RENDER_GRAPH_SRV_SLOTS; i++)
+	{
+		if (!srvs[i])
+			continue;
+
+		Microsoft::WRL::ComPtr<ID3D11Resource> resource;
+		srvs[i]->GetResource(resource.GetAddressOf());
+		if (resource == textureResource)
+		{
+			ID3D11ShaderResourceView* nullSRV = 0;
+			context->PSSetShaderResources(i, 1, &nullSRV);
+		}
+		srvs[i]->Release();
+	}
+}
+
+// --------------------------------------------------------
+// Getters
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11RenderTargetView> D3D11RenderGraphDevice::GetRTV(uint32_t texture)
+{
+	return static_cast<ID3D11RenderTargetView*>(D3D11RHIDevice::GetView(GetView(texture, RHI_VIEW_RENDER_TARGET)));
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> D3D11RenderGraphDevice::GetSRV(uint32_t texture)
+{
+	return static_cast<ID3D11ShaderResourceView*>(D3D11RHIDevice::GetView(GetView(texture, RHI_VIEW_SHADER_RESOURCE)));
+}
+
+Microsoft::WRL::ComPtr<ID3D11DepthStencilView> D3D11RenderGraphDevice::GetDSV(uint32_t texture)
+{
+	return static_cast<ID3D11DepthStencilView*>(D3D11RHIDevice::GetView(GetView(texture, RHI_VIEW_DEPTH_STENCIL)));
+}
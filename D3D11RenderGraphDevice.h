@@ -0,0 +1,50 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+
+#include "D3D11RHIDevice.h"
+#include "RHIRenderGraphDevice.h"
+
+// --------------------------------------------------------
+// Runs a RenderGraph on Direct3D 11.  Textures, views and
+// target binding all go through the RHI; this adds imports
+// of native views and the transitions D3D11 needs.
+//
+// D3D11 tracks hazards itself, so transitions just make sure
+// a texture isn't bound as an input and an output at once
+// (which D3D would otherwise fix by silently unbinding one).
+// Shaders bind their inputs outside the RHI, so that's done
+// on the native context.
+// --------------------------------------------------------
+class D3D11RenderGraphDevice : public RHIRenderGraphDevice
+{
+public:
+	D3D11RenderGraphDevice(
+		std::shared_ptr<D3D11RHIDevice> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	~D3D11RenderGraphDevice();
+
+	// Native views of textures owned elsewhere (kept alive
+	// until the imports are cleared) - any view can be null
+	void ClearImports();
+	uint32_t Import(
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView> rtv,
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv,
+		Microsoft::WRL::ComPtr<ID3D11DepthStencilView> dsv,
+		unsigned int width,
+		unsigned int height);
+
+	// RenderGraphDevice
+	void Transition(uint32_t texture, uint32_t before, uint32_t after);
+
+	// Native views of a texture, for use inside passes
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> GetRTV(uint32_t texture);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetSRV(uint32_t texture);
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> GetDSV(uint32_t texture);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11View>> importedViews;
+};
@@ -59,7 +59,8 @@ DXCore::DXCore(
 	deltaTime(0),
 	startTime(0),
 	totalTime(0),
-	hWnd(0)
+	hWnd(0),
+	fixedTimestep(60.0f, 4)
 {
 	// Save a static reference to this object.
 	//  - Since the OS-level message function must be a non-member (global) function, 
@@ -412,8 +413,11 @@ HRESULT DXCore::Run()
 	currentTime = now;
 	previousTime = now;
 
-	// Give subclass a chance to initialize
-	Init();
+	// Give subclass a chance to initialize (and stop
+	// before the loop if it can't)
+	HRESULT hr = Init();
+	if (FAILED(hr))
+		return hr;
 
 	// Our overall game and message loop
 	MSG msg = {};
@@ -438,8 +442,21 @@ HRESULT DXCore::Run()
 			Input::GetInstance().Update();
 
 			// The game loop
-			Update(deltaTime, totalTime);
-			Draw(deltaTime, totalTime);
+			if (framePipeline)
+			{
+				framePipeline->RunFrame(
+					[this]() { UpdateFrame(); },
+					[this]() { PublishFrame(); },
+					[this]() { Draw(deltaTime, totalTime); },
+					[this]() { Present(); });
+			}
+			else
+			{
+				UpdateFrame();
+				PublishFrame();
+				Draw(deltaTime, totalTime);
+				Present();
+			}
 
 			// Frame is over, notify the input manager
 			Input::GetInstance().EndOfFrame();
@@ -452,6 +469,20 @@ HRESULT DXCore::Run()
 }
 
 
+// --------------------------------------------------------
+// A frame's update: the fixed simulation steps the time
+// since last frame calls for, then the once a frame Update
+// --------------------------------------------------------
+void DXCore::UpdateFrame()
+{
+	uint32_t steps = fixedTimestep.Advance(deltaTime);
+	for (uint32_t s = 0; s < steps; s++)
+		FixedUpdate(fixedTimestep.GetStep(), (float)fixedTimestep.GetStepTime(s));
+
+	Update(deltaTime, totalTime);
+}
+
+
 // --------------------------------------------------------
 // Sends an OS-level window close message to our process, which
 // will be handled by our message processing function
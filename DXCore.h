@@ -5,6 +5,9 @@
 #include <string>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 
+#include "FixedTimestep.h"
+#include "FramePipeline.h"
+
 // We can include the correct library files here
 // instead of in Visual Studio settings if we want
 #pragma comment(lib, "d3d11.lib")
@@ -42,10 +45,15 @@ public:
 	virtual void OnResize();
 
 	// Pure virtual methods for setup and game functionality
-	virtual void Init() = 0;
+	virtual HRESULT Init() = 0;
 	virtual void Update(float deltaTime, float totalTime) = 0;
 	virtual void Draw(float deltaTime, float totalTime) = 0;
 
+	// Simulation that runs at a fixed rate (see FixedTimestep),
+	// as often as the time since last frame calls for, before
+	// each frame's Update
+	virtual void FixedUpdate(float step, float time) {}
+
 protected:
 	HINSTANCE		hInstance;		// The handle to the application
 	HWND			hWnd;			// The handle to the window itself
@@ -75,6 +83,21 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> backBufferRTV;
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> depthBufferDSV;
 
+	// Turns frame times into fixed simulation steps
+	FixedTimestep fixedTimestep;
+
+	// Runs Update and Draw, overlapping them when pipelined
+	// (set by the game - without one they run back to back)
+	std::shared_ptr<FramePipeline> framePipeline;
+
+	// Called between Update and Draw, with neither running, to
+	// hand Update's results over to Draw (see FramePipeline)
+	virtual void PublishFrame() {}
+
+	// Called after Draw, on the thread that pumps the window's
+	// messages, to put what Draw drew on the screen
+	virtual void Present() {}
+
 	// Helper function for allocating a console window
 	void CreateConsoleWindow(int bufferLines, int bufferColumns, int windowLines, int windowColumns);
 
@@ -92,6 +115,7 @@ private:
 	float fpsTimeElapsed;
 
 	void UpdateTimer();			// Updates the timer for this frame
+	void UpdateFrame();			// Fixed steps, then Update
 	void UpdateTitleBarStats();	// Puts debug info in the title bar
 };
 
@@ -0,0 +1,98 @@
+#include "ShaderIncludes.hlsli"
+#include "GBufferPacking.hlsli"
+#include "ShadowCascades.hlsli"
+#include "ShadowAtlas.hlsli"
+
+// Per-frame tile parameters - matches TiledShaderInfo in TiledDeferredRenderer.h
+struct TileInfo
+{
+	float2	ScreenSize;
+	uint	TileSize;
+	uint	TileCountX;
+
+	float2	TanHalfFov;
+	uint	GlobalLightCount;
+	int		ShadowLightIndex;
+};
+
+cbuffer ExternalData : register(b0)
+{
+	matrix invView;
+
+	float3 cameraPosition;
+	float3 ambientColor;
+	TileInfo tileInfo;
+	ShadowCascadeInfo shadowCascades;
+}
+
+struct VertexToPixel_Fullscreen
+{
+	float4 position	: SV_POSITION;
+	float2 uv		: TEXCOORD0;
+};
+
+Texture2D GBufferAlbedo						: register(t0);
+Texture2D GBufferNormal						: register(t1);
+Texture2D GBufferMaterial					: register(t2);
+Texture2D GBufferDepth						: register(t3);
+Texture2DArray ShadowMap					: register(t4);
+StructuredBuffer<Light> Lights				: register(t5);
+StructuredBuffer<uint2> TileRanges			: register(t6); // (offset, count)
+StructuredBuffer<uint> TileLightIndices		: register(t7);
+Texture2D ShadowAtlasMap					: register(t8);
+StructuredBuffer<ShadowAtlasFace> ShadowAtlasFaces	: register(t9);
+StructuredBuffer<int2> LightShadowFaces		: register(t10); // (first face, count) per light
+SamplerComparisonState ShadowSampler		: register(s0);
+
+// --------------------------------------------------------
+// Shades one pixel of the G-buffer with the lights that
+// touch its screen tile
+// --------------------------------------------------------
+float4 main(VertexToPixel_Fullscreen input) : SV_TARGET
+{
+	int3 pixel = int3(input.position.xy, 0);
+	float viewDepth = GBufferDepth.Load(pixel).r;
+	if (viewDepth <= 0)
+		discard;	// Nothing drawn here - leave it for the sky
+
+	// Rebuild the world position from the linear depth
+	float2 ndc = float2(
+		input.position.x / tileInfo.ScreenSize.x * 2 - 1,
+		1 - input.position.y / tileInfo.ScreenSize.y * 2);
+	float3 viewPos = float3(ndc * tileInfo.TanHalfFov, 1) * viewDepth;
+	float3 worldPos = mul(invView, float4(viewPos, 1)).xyz;
+
+	float3 surfaceColor = GBufferAlbedo.Load(pixel).rgb;
+	float3 normal = DecodeOctahedral(GBufferNormal.Load(pixel).rg);
+	float2 material = GBufferMaterial.Load(pixel).rg;
+	float roughness = material.r;
+	float metalness = material.g;
+	float3 specularColor = lerp(F0_NON_METAL, surfaceColor, metalness);
+
+	// Shadow mapping, as in the forward path
+	float shadowAmount = SampleShadowCascades(ShadowMap, ShadowSampler, shadowCascades, worldPos, viewDepth);
+
+	float3 total = surfaceColor * ambientColor;
+
+	// Global lights first, then this tile's list
+	uint2 tile = (uint2)input.position.xy / tileInfo.TileSize;
+	uint2 range = TileRanges[tile.x + tile.y * tileInfo.TileCountX];
+	uint globalCount = tileInfo.GlobalLightCount;
+
+	for (uint i = 0; i < globalCount + range.y; i++)
+	{
+		uint lightIndex = TileLightIndices[i < globalCount ? i : range.x + (i - globalCount)];
+		Light light = Lights[lightIndex];
+		light.Direction = normalize(light.Direction);
+
+		float3 lightResult = CalcLight(light, normal, worldPos, cameraPosition, roughness, metalness, surfaceColor, specularColor);
+		if ((int)lightIndex == tileInfo.ShadowLightIndex)
+			lightResult *= shadowAmount;
+		else if (any(lightResult))
+			lightResult *= SampleShadowAtlas(ShadowAtlasMap, ShadowSampler, ShadowAtlasFaces, LightShadowFaces[lightIndex], light, worldPos);
+
+		total += lightResult;
+	}
+
+	return float4(pow(total, 1.0f / 2.2f), 1);
+}
@@ -0,0 +1,315 @@
+// --------------------------------------------------------
+// Builds a frame's draw list from lots of entities, the way
+// the game used to and the way it does now, and prints how
+// long each takes:
+//
+//  - shared:   entities in a list of shared_ptrs, each with
+//              shared_ptrs to its mesh & material, and the
+//              camera passed to each draw by shared_ptr
+//  - shuffled: the same, after entities have come and gone
+//              so the list's order no longer matches where
+//              they are in memory
+//  - handles:  entities copied into one array (as the game's
+//              frames have them), with handles into pools of
+//              meshes & materials
+//
+// Every build makes the same list - world matrix, mesh,
+// material, camera distance and sort key per entity - and
+// the lists are checked against each other.  After timing,
+// some meshes are destroyed to show stale handles being
+// caught rather than followed.
+//
+// Meshes & materials are stand-ins, as the real ones need a
+// device.  Built by CMakeLists.txt:
+//
+//   DrawListBenchmarkMain --entities 100000 --runs 50
+// --------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "HandlePool.h"
+#include "Transform.h"
+
+using namespace DirectX;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Distinct meshes & materials the entities share
+#define BENCH_MESH_COUNT		64
+#define BENCH_MATERIAL_COUNT	32
+
+struct BenchMesh
+{
+	uint32_t Id;
+	uint32_t IndexCount;
+	XMFLOAT3 BoundsCenter;
+	float BoundsRadius;
+};
+
+struct BenchMaterial
+{
+	uint32_t Id;
+	XMFLOAT3 ColorTint;
+	float Roughness;
+};
+
+struct BenchCamera
+{
+	XMFLOAT3 Position;
+	XMFLOAT4X4 View;
+	XMFLOAT4X4 Projection;
+};
+
+// What each build makes per entity
+struct BenchDraw
+{
+	XMFLOAT4X4 World;
+	const BenchMesh* Mesh;
+	const BenchMaterial* Material;
+	float Distance;
+	uint64_t SortKey;
+};
+
+// The old entity: everything held by shared_ptr, and handed
+// out by value
+class SharedEntity
+{
+public:
+	SharedEntity(std::shared_ptr<BenchMesh> mesh, std::shared_ptr<BenchMaterial> material) : mesh(mesh), material(material) {}
+
+	std::shared_ptr<BenchMesh> GetMesh() { return mesh; }
+	std::shared_ptr<BenchMaterial> GetMaterial() { return material; }
+	Transform& GetTransform() { return transform; }
+
+private:
+	Transform transform;
+	std::shared_ptr<BenchMesh> mesh;
+	std::shared_ptr<BenchMaterial> material;
+};
+
+// The new one: a transform and two handles
+class HandleEntity
+{
+public:
+	HandleEntity(Handle<BenchMesh> mesh, Handle<BenchMaterial> material) : mesh(mesh), material(material) {}
+
+	Handle<BenchMesh> GetMesh() { return mesh; }
+	Handle<BenchMaterial> GetMaterial() { return material; }
+	Transform& GetTransform() { return transform; }
+
+private:
+	Transform transform;
+	Handle<BenchMesh> mesh;
+	Handle<BenchMaterial> material;
+};
+
+// Material first, then mesh, then front to back
+static uint64_t SortKey(const BenchMesh& mesh, const BenchMaterial& material, float distance)
+{
+	uint32_t depth = (uint32_t)(distance * 64.0f);
+	return ((uint64_t)material.Id << 48) | ((uint64_t)mesh.Id << 32) | depth;
+}
+
+static void AddDraw(Transform& transform, const BenchMesh& mesh, const BenchMaterial& material, const XMFLOAT3& cameraPosition, std::vector<BenchDraw>& draws)
+{
+	BenchDraw draw;
+	draw.World = transform.GetWorldMatrix();
+	draw.Mesh = &mesh;
+	draw.Material = &material;
+
+	XMFLOAT3 position = transform.GetPosition();
+	XMVECTOR offset = XMLoadFloat3(&position) - XMLoadFloat3(&cameraPosition);
+	draw.Distance = XMVectorGetX(XMVector3Length(offset));
+	draw.SortKey = SortKey(mesh, material, draw.Distance);
+	draws.push_back(draw);
+}
+
+// The old way: shared_ptrs copied out of each entity, and
+// the camera passed down by value
+static void AddSharedDraw(SharedEntity& entity, std::shared_ptr<BenchCamera> camera, std::vector<BenchDraw>& draws)
+{
+	std::shared_ptr<BenchMesh> mesh = entity.GetMesh();
+	std::shared_ptr<BenchMaterial> material = entity.GetMaterial();
+	AddDraw(entity.GetTransform(), *mesh, *material, camera->Position, draws);
+}
+
+static void BuildShared(std::vector<std::shared_ptr<SharedEntity>>& entities, std::shared_ptr<BenchCamera> camera, std::vector<BenchDraw>& draws)
+{
+	draws.clear();
+	for (const std::shared_ptr<SharedEntity>& entity : entities)
+		AddSharedDraw(*entity, camera, draws);
+}
+
+// The new way: handles followed once per entity, and an
+// entity whose mesh or material is gone isn't drawn
+static void BuildHandles(
+	std::vector<HandleEntity>& entities,
+	HandlePool<BenchMesh>& meshes,
+	HandlePool<BenchMaterial>& materials,
+	const BenchCamera& camera,
+	std::vector<BenchDraw>& draws)
+{
+	draws.clear();
+	for (HandleEntity& entity : entities)
+	{
+		const BenchMesh* mesh = meshes.Get(entity.GetMesh());
+		const BenchMaterial* material = materials.Get(entity.GetMaterial());
+		if (mesh && material)
+			AddDraw(entity.GetTransform(), *mesh, *material, camera.Position, draws);
+	}
+}
+
+// Best and average milliseconds per build
+struct BenchTime
+{
+	double BestMs;
+	double AverageMs;
+};
+
+template<typename Build>
+static BenchTime Time(uint32_t runs, const Build& build)
+{
+	// Once to warm up (and size the list)
+	build();
+
+	BenchTime time = { 1e30, 0 };
+	for (uint32_t r = 0; r < runs; r++)
+	{
+		auto start = Clock::now();
+		build();
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		time.BestMs = ms < time.BestMs ? ms : time.BestMs;
+		time.AverageMs += ms / runs;
+	}
+	return time;
+}
+
+// Lists match if they draw the same things in the same places
+static bool SameDraws(const std::vector<BenchDraw>& a, const std::vector<BenchDraw>& b)
+{
+	if (a.size() != b.size())
+		return false;
+
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (memcmp(&a[i].World, &b[i].World, sizeof(XMFLOAT4X4)) != 0 ||
+			a[i].Mesh->Id != b[i].Mesh->Id ||
+			a[i].Material->Id != b[i].Material->Id ||
+			a[i].SortKey != b[i].SortKey)
+			return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t entityCount = 100000;
+	uint32_t runs = 50;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string name = argv[i];
+		if (name == "--entities") entityCount = (uint32_t)atoi(argv[i + 1]);
+		else if (name == "--runs") runs = (uint32_t)atoi(argv[i + 1]);
+	}
+	if (entityCount == 0 || runs == 0)
+	{
+		printf("Usage: DrawListBenchmarkMain [--entities count] [--runs count]\n");
+		return 1;
+	}
+
+	// The same meshes & materials both ways
+	std::vector<std::shared_ptr<BenchMesh>> sharedMeshes;
+	std::vector<std::shared_ptr<BenchMaterial>> sharedMaterials;
+	HandlePool<BenchMesh> meshes;
+	HandlePool<BenchMaterial> materials;
+	std::vector<Handle<BenchMesh>> meshHandles;
+	std::vector<Handle<BenchMaterial>> materialHandles;
+	for (uint32_t i = 0; i < BENCH_MESH_COUNT; i++)
+	{
+		BenchMesh mesh = { i, 36 + i * 6, XMFLOAT3(0, 0, 0), 1.0f };
+		sharedMeshes.push_back(std::make_shared<BenchMesh>(mesh));
+		meshHandles.push_back(meshes.Create(mesh));
+	}
+	for (uint32_t i = 0; i < BENCH_MATERIAL_COUNT; i++)
+	{
+		BenchMaterial material = { i, XMFLOAT3(1, 1, 1), i / (float)BENCH_MATERIAL_COUNT };
+		sharedMaterials.push_back(std::make_shared<BenchMaterial>(material));
+		materialHandles.push_back(materials.Create(material));
+	}
+
+	// Entities spread over a grid, both ways, each with its
+	// world matrix worked out (as the game's frames have)
+	std::mt19937 random(1234);
+	std::vector<std::shared_ptr<SharedEntity>> sharedEntities;
+	HandlePool<HandleEntity> entities;
+	for (uint32_t i = 0; i < entityCount; i++)
+	{
+		uint32_t mesh = random() % BENCH_MESH_COUNT;
+		uint32_t material = random() % BENCH_MATERIAL_COUNT;
+		float x = (float)(i % 317) * 2.0f;
+		float z = (float)(i / 317) * 2.0f;
+		float yaw = (float)(random() % 628) * 0.01f;
+
+		std::shared_ptr<SharedEntity> shared = std::make_shared<SharedEntity>(sharedMeshes[mesh], sharedMaterials[material]);
+		shared->GetTransform().SetPosition(x, 0, z);
+		shared->GetTransform().SetRotation(0, yaw, 0);
+		shared->GetTransform().GetWorldMatrix();
+		sharedEntities.push_back(shared);
+
+		HandleEntity* entity = entities.Get(entities.Create(meshHandles[mesh], materialHandles[material]));
+		entity->GetTransform().SetPosition(x, 0, z);
+		entity->GetTransform().SetRotation(0, yaw, 0);
+		entity->GetTransform().GetWorldMatrix();
+	}
+
+	std::vector<std::shared_ptr<SharedEntity>> shuffledEntities = sharedEntities;
+	std::shuffle(shuffledEntities.begin(), shuffledEntities.end(), random);
+
+	// What a frame holds: a copy of each live entity
+	std::vector<HandleEntity> frameEntities;
+	entities.ForEach([&](Handle<HandleEntity> handle, HandleEntity& entity) { frameEntities.push_back(entity); });
+
+	std::shared_ptr<BenchCamera> camera = std::make_shared<BenchCamera>();
+	camera->Position = XMFLOAT3(300, 20, -10);
+
+	std::vector<BenchDraw> sharedDraws;
+	std::vector<BenchDraw> shuffledDraws;
+	std::vector<BenchDraw> handleDraws;
+	BenchTime sharedTime = Time(runs, [&]() { BuildShared(sharedEntities, camera, sharedDraws); });
+	BenchTime shuffledTime = Time(runs, [&]() { BuildShared(shuffledEntities, camera, shuffledDraws); });
+	BenchTime handleTime = Time(runs, [&]() { BuildHandles(frameEntities, meshes, materials, *camera, handleDraws); });
+
+	printf("%u entities, %u meshes, %u materials, best of %u runs\n\n", entityCount, BENCH_MESH_COUNT, BENCH_MATERIAL_COUNT, runs);
+	printf("layout     best ms  average ms  ns/entity\n");
+	printf("shared    %8.3f  %10.3f  %9.1f\n", sharedTime.BestMs, sharedTime.AverageMs, sharedTime.BestMs * 1e6 / entityCount);
+	printf("shuffled  %8.3f  %10.3f  %9.1f\n", shuffledTime.BestMs, shuffledTime.AverageMs, shuffledTime.BestMs * 1e6 / entityCount);
+	printf("handles   %8.3f  %10.3f  %9.1f\n", handleTime.BestMs, handleTime.AverageMs, handleTime.BestMs * 1e6 / entityCount);
+
+	bool same = SameDraws(sharedDraws, handleDraws);
+	printf("\nDraw lists %s\n", same ? "match" : "DIFFER");
+
+	// Destroy a mesh and reuse its slot: entities still
+	// holding the old handle are left out, not drawn with
+	// the new mesh
+	uint32_t stale = 0;
+	for (HandleEntity& entity : frameEntities)
+		stale += entity.GetMesh() == meshHandles[0] ? 1 : 0;
+	meshes.Destroy(meshHandles[0]);
+	Handle<BenchMesh> reused = meshes.Create(BenchMesh{ 999, 3, XMFLOAT3(0, 0, 0), 1.0f });
+	BuildHandles(frameEntities, meshes, materials, *camera, handleDraws);
+
+	bool caught = reused.Index == meshHandles[0].Index &&
+		!meshes.IsAlive(meshHandles[0]) &&
+		handleDraws.size() == frameEntities.size() - stale;
+	printf("Stale handles: %u entities lost their mesh, %zu of %zu drawn (%s)\n",
+		stale, handleDraws.size(), frameEntities.size(), caught ? "caught" : "NOT CAUGHT");
+
+	return same && caught ? 0 : 1;
+}
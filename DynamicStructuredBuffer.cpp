@@ -0,0 +1,90 @@
+#include "DynamicStructuredBuffer.h"
+
+#include <string.h>
+
+// Smallest buffer ever created, in elements
+#define DYNAMIC_STRUCTURED_BUFFER_MIN_CAPACITY 64
+
+// Constructor
+DynamicStructuredBuffer::DynamicStructuredBuffer(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+	:
+	device(device),
+	context(context),
+	capacity(0),
+	stride(0)
+{
+}
+
+// Destructor
+DynamicStructuredBuffer::~DynamicStructuredBuffer()
+{
+}
+
+// --------------------------------------------------------
+// Copies the data to the GPU, recreating the buffer first
+// if it's too small or the element size changed
+// --------------------------------------------------------
+bool DynamicStructuredBuffer::Upload(const void* data, unsigned int count, unsigned int elementStride)
+{
+	if (elementStride == 0)
+		return false;
+
+	if (count > capacity || elementStride != stride || !buffer)
+	{
+		if (!Grow(count, elementStride))
+			return false;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return false;
+
+	if (count > 0 && data)
+		memcpy(mapped.pData, data, (size_t)count * elementStride);
+
+	context->Unmap(buffer.Get(), 0);
+	return true;
+}
+
+// --------------------------------------------------------
+// Recreates the buffer and view with room for at least
+// the given number of elements
+// --------------------------------------------------------
+bool DynamicStructuredBuffer::Grow(unsigned int count, unsigned int elementStride)
+{
+	unsigned int newCapacity = DYNAMIC_STRUCTURED_BUFFER_MIN_CAPACITY;
+	while (newCapacity < count)
+		newCapacity *= 2;
+
+	buffer.Reset();
+	srv.Reset();
+	capacity = 0;
+	stride = 0;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = newCapacity * elementStride;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	desc.StructureByteStride = elementStride;
+	if (FAILED(device->CreateBuffer(&desc, 0, buffer.GetAddressOf())))
+		return false;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = newCapacity;
+	if (FAILED(device->CreateShaderResourceView(buffer.Get(), &srvDesc, srv.GetAddressOf())))
+	{
+		buffer.Reset();
+		return false;
+	}
+
+	capacity = newCapacity;
+	stride = elementStride;
+	return true;
+}
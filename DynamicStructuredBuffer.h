@@ -0,0 +1,38 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+
+// --------------------------------------------------------
+// A CPU-written structured buffer (plus SRV) that's fully
+// replaced every upload.  It grows by powers of two, so a
+// slowly increasing element count doesn't recreate it
+// every frame.
+// --------------------------------------------------------
+class DynamicStructuredBuffer
+{
+public:
+	DynamicStructuredBuffer(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	~DynamicStructuredBuffer();
+
+	// Replaces the contents - an empty upload still leaves a
+	// valid (one element) buffer bound, as D3D needs one
+	bool Upload(const void* data, unsigned int count, unsigned int stride);
+
+	// Getters
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetSRV() { return srv; }
+	unsigned int GetCapacity() { return capacity; }
+
+private:
+	bool Grow(unsigned int count, unsigned int stride);
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	unsigned int capacity;
+	unsigned int stride;
+};
@@ -0,0 +1,63 @@
+#include "FixedTimestep.h"
+
+#include <cmath>
+
+FixedTimestep::FixedTimestep(float tickRate, uint32_t maxStepsPerFrame) :
+	step(1.0f / 60.0f),
+	maxSteps(1),
+	accumulator(0),
+	time(0),
+	ticks(0),
+	lastSteps(0),
+	droppedTime(0)
+{
+	SetTickRate(tickRate);
+	SetMaxStepsPerFrame(maxStepsPerFrame);
+}
+
+uint32_t FixedTimestep::Advance(float deltaTime)
+{
+	if (deltaTime > 0)
+		accumulator += deltaTime;
+
+	lastSteps = 0;
+	while (accumulator >= step && lastSteps < maxSteps)
+	{
+		accumulator -= step;
+		lastSteps++;
+	}
+
+	// Out of steps for this frame: drop the whole steps still
+	// owed, but keep the fraction so interpolation stays smooth
+	if (accumulator >= step)
+	{
+		double dropped = accumulator - fmod(accumulator, (double)step);
+		accumulator -= dropped;
+		droppedTime += dropped;
+	}
+
+	ticks += lastSteps;
+	time += (double)lastSteps * step;
+	return lastSteps;
+}
+
+double FixedTimestep::GetStepTime(uint32_t stepIndex) const
+{
+	return time - (double)(lastSteps - stepIndex) * step;
+}
+
+void FixedTimestep::SetTickRate(float tickRate)
+{
+	if (tickRate <= 0)
+		return;
+
+	// Keep the same fraction of a step waiting
+	float newStep = 1.0f / tickRate;
+	accumulator = accumulator / step * newStep;
+	step = newStep;
+}
+
+void FixedTimestep::SetMaxStepsPerFrame(uint32_t maxStepsPerFrame)
+{
+	maxSteps = maxStepsPerFrame > 0 ? maxStepsPerFrame : 1;
+}
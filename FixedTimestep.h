@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+// --------------------------------------------------------
+// Turns variable frame times into simulation steps of a
+// fixed length.  Each frame's time goes into an accumulator
+// and a step runs for every whole step's worth in it, up to
+// a maximum per frame - past that the extra time is dropped,
+// as a slow frame would otherwise need more steps next
+// frame and be slower still.
+//
+// What's left in the accumulator is how far real time has
+// got between the last step and the next one, so rendering
+// can interpolate the last two states by GetAlpha().
+// --------------------------------------------------------
+class FixedTimestep
+{
+public:
+	FixedTimestep(float tickRate, uint32_t maxStepsPerFrame);
+
+	// Adds a frame's time, and returns how many steps to run
+	uint32_t Advance(float deltaTime);
+
+	// Simulation time at the start of one of the steps the
+	// last Advance() asked for (0 is the first of them)
+	double GetStepTime(uint32_t step) const;
+
+	// Fraction of a step since the last one (0 to 1)
+	float GetAlpha() const { return (float)(accumulator / step); }
+
+	float GetStep() const { return step; }
+	float GetTickRate() const { return 1.0f / step; }
+	uint32_t GetMaxStepsPerFrame() const { return maxSteps; }
+	uint64_t GetTickCount() const { return ticks; }
+	double GetTime() const { return time; }
+	double GetDroppedTime() const { return droppedTime; }
+
+	void SetTickRate(float tickRate);
+	void SetMaxStepsPerFrame(uint32_t maxStepsPerFrame);
+
+private:
+	float step;
+	uint32_t maxSteps;
+
+	double accumulator;
+	double time;			// At the end of the last step
+	uint64_t ticks;
+	uint32_t lastSteps;		// From the last Advance()
+	double droppedTime;
+};
@@ -0,0 +1,129 @@
+// --------------------------------------------------------
+// Tests FixedTimestep:
+//
+//  - a step runs for every whole step's worth of frame
+//    time, whatever the frames' lengths, and the fraction
+//    left over is the interpolation alpha
+//  - past the per frame maximum, whole steps are dropped
+//    but the fraction is kept
+//  - changing the tick rate keeps the same fraction of a
+//    step waiting, so interpolation doesn't jump
+//
+// Tick rates are powers of two, so every step (and sum of
+// them) is exact and the checks can be too.
+// --------------------------------------------------------
+#include "FixedTimestep.h"
+#include "TestCheck.h"
+
+static void TestStepCounting()
+{
+	FixedTimestep timestep(64.0f, 8);
+	const float step = 1.0f / 64.0f;
+	CHECK(timestep.GetStep() == step);
+	CHECK(timestep.GetTickRate() == 64.0f);
+	CHECK(timestep.GetMaxStepsPerFrame() == 8);
+	CHECK(timestep.GetAlpha() == 0.0f);
+
+	CHECK(timestep.Advance(step) == 1);
+	CHECK(timestep.GetAlpha() == 0.0f);
+
+	// Half a step twice is one step
+	CHECK(timestep.Advance(step * 0.5f) == 0);
+	CHECK(timestep.GetAlpha() == 0.5f);
+	CHECK(timestep.Advance(step * 0.5f) == 1);
+	CHECK(timestep.GetAlpha() == 0.0f);
+
+	// Several in one frame, with a remainder
+	CHECK(timestep.Advance(step * 3.25f) == 3);
+	CHECK(timestep.GetAlpha() == 0.25f);
+	CHECK(timestep.GetTickCount() == 5);
+	CHECK(timestep.GetTime() == 5.0 * step);
+
+	// Each of the frame's steps starts one step after the last,
+	// with the last ending where the simulation is now
+	CHECK(timestep.GetStepTime(0) == 2.0 * step);
+	CHECK(timestep.GetStepTime(1) == 3.0 * step);
+	CHECK(timestep.GetStepTime(2) == 4.0 * step);
+
+	// Time never runs backwards
+	CHECK(timestep.Advance(-1.0f) == 0);
+	CHECK(timestep.GetAlpha() == 0.25f);
+
+	// Lots of short frames add up to the same steps as one long one
+	FixedTimestep shortFrames(64.0f, 8);
+	uint32_t steps = 0;
+	for (int frame = 0; frame < 1000; frame++)
+		steps += shortFrames.Advance(step / 8.0f);
+	CHECK(steps == 125);
+	CHECK(shortFrames.GetTickCount() == 125);
+	CHECK(shortFrames.GetTime() == 125.0 * step);
+	CHECK(shortFrames.GetDroppedTime() == 0.0);
+}
+
+static void TestMaxSteps()
+{
+	FixedTimestep timestep(64.0f, 4);
+	const float step = 1.0f / 64.0f;
+
+	// A long frame only runs the maximum, and drops the other
+	// whole steps without losing the fraction
+	CHECK(timestep.Advance(step * 10.75f) == 4);
+	CHECK(timestep.GetAlpha() == 0.75f);
+	CHECK(timestep.GetDroppedTime() == 6.0 * step);
+	CHECK(timestep.GetTickCount() == 4);
+	CHECK(timestep.GetTime() == 4.0 * step);
+
+	// So the next frame carries on from there, not six steps behind
+	CHECK(timestep.Advance(step * 0.25f) == 1);
+	CHECK(timestep.GetAlpha() == 0.0f);
+	CHECK(timestep.GetDroppedTime() == 6.0 * step);
+
+	// Exactly the maximum drops nothing
+	CHECK(timestep.Advance(step * 4.0f) == 4);
+	CHECK(timestep.GetDroppedTime() == 6.0 * step);
+
+	// At least one step a frame
+	timestep.SetMaxStepsPerFrame(0);
+	CHECK(timestep.GetMaxStepsPerFrame() == 1);
+	CHECK(FixedTimestep(64.0f, 0).GetMaxStepsPerFrame() == 1);
+	CHECK(timestep.Advance(step * 2.5f) == 1);
+	CHECK(timestep.GetAlpha() == 0.5f);
+	CHECK(timestep.GetDroppedTime() == 7.0 * step);
+}
+
+static void TestTickRateChange()
+{
+	FixedTimestep timestep(64.0f, 8);
+	CHECK(timestep.Advance(0.5f / 64.0f) == 0);
+	CHECK(timestep.GetAlpha() == 0.5f);
+
+	// Still half way to the next step, now a longer one
+	timestep.SetTickRate(32.0f);
+	CHECK(timestep.GetStep() == 1.0f / 32.0f);
+	CHECK(timestep.GetAlpha() == 0.5f);
+	CHECK(timestep.Advance(0.25f / 32.0f) == 0);
+	CHECK(timestep.GetAlpha() == 0.75f);
+	CHECK(timestep.Advance(0.25f / 32.0f) == 1);
+	CHECK(timestep.GetAlpha() == 0.0f);
+
+	// And faster again
+	CHECK(timestep.Advance(0.25f / 32.0f) == 0);
+	timestep.SetTickRate(128.0f);
+	CHECK(timestep.GetAlpha() == 0.25f);
+	CHECK(timestep.Advance(0.75f / 128.0f) == 1);
+	CHECK(timestep.GetTime() == 1.0 / 32.0 + 1.0 / 128.0);
+
+	// Rates that make no sense are ignored
+	timestep.SetTickRate(0.0f);
+	timestep.SetTickRate(-30.0f);
+	CHECK(timestep.GetTickRate() == 128.0f);
+	CHECK(FixedTimestep(0.0f, 4).GetStep() == 1.0f / 60.0f);
+}
+
+int main()
+{
+	TestStepCounting();
+	TestMaxSteps();
+	TestTickRateChange();
+	return TestResult();
+}
@@ -0,0 +1,146 @@
+#include "FrameArena.h"
+
+#include <cstring>
+
+LinearArena::LinearArena(size_t blockSize) :
+	blockSize(blockSize > 0 ? blockSize : LINEAR_ARENA_BLOCK_SIZE),
+	offset(0),
+	usedBytes(0),
+	peakBytes(0),
+	heapAllocations(0)
+{
+}
+
+LinearArena::~LinearArena()
+{
+	for (Block& block : blocks)
+		delete[] block.Memory;
+}
+
+// --------------------------------------------------------
+// Bumps the offset in the last block, adding a block when
+// the allocation doesn't fit
+// --------------------------------------------------------
+void* LinearArena::Allocate(size_t size, size_t alignment)
+{
+	if (size == 0)
+		size = 1;
+
+	if (!blocks.empty())
+	{
+		Block& block = blocks.back();
+		uintptr_t start = ((uintptr_t)block.Memory + offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		size_t end = (size_t)(start - (uintptr_t)block.Memory) + size;
+		if (end <= block.Size)
+		{
+			offset = end;
+			peakBytes = GetUsedBytes() > peakBytes ? GetUsedBytes() : peakBytes;
+			return (void*)start;
+		}
+	}
+
+	// Room for the worst case alignment, too
+	AddBlock(size + alignment);
+	return Allocate(size, alignment);
+}
+
+const char* LinearArena::CopyString(const char* str)
+{
+	size_t length = strlen(str) + 1;
+	char* copy = (char*)Allocate(length, 1);
+	memcpy(copy, str, length);
+	return copy;
+}
+
+void LinearArena::Free(void* memory, size_t size)
+{
+	if (blocks.empty() || !memory)
+		return;
+
+	Block& block = blocks.back();
+	if ((uint8_t*)memory + size == block.Memory + offset)
+		offset = (size_t)((uint8_t*)memory - block.Memory);
+}
+
+// --------------------------------------------------------
+// Back to the start.  A frame that needed more than one
+// block gets a single block that fits all of it instead
+// (with some room to spare, for alignment & growth).
+// --------------------------------------------------------
+void LinearArena::Reset()
+{
+	if (blocks.size() > 1)
+	{
+		for (Block& block : blocks)
+			delete[] block.Memory;
+		blocks.clear();
+		AddBlock(peakBytes + peakBytes / 4);
+	}
+
+	offset = 0;
+	usedBytes = 0;
+}
+
+size_t LinearArena::GetCapacity() const
+{
+	size_t capacity = 0;
+	for (const Block& block : blocks)
+		capacity += block.Size;
+	return capacity;
+}
+
+void LinearArena::AddBlock(size_t minSize)
+{
+	Block block;
+	block.Size = minSize > blockSize ? minSize : blockSize;
+	block.Memory = new uint8_t[block.Size];
+
+	usedBytes += offset;
+	offset = 0;
+	blocks.push_back(block);
+	heapAllocations++;
+}
+
+// --------------------------------------------------------
+// Frame arenas
+// --------------------------------------------------------
+FrameArena::FrameArena(uint32_t threadCount, size_t blockSize)
+{
+	for (uint32_t i = 0; i < threadCount + 1; i++)
+		arenas.emplace_back(new LinearArena(blockSize));
+}
+
+LinearArena& FrameArena::Get(uint32_t thread)
+{
+	return thread < arenas.size() ? *arenas[thread] : *arenas.back();
+}
+
+void FrameArena::Reset()
+{
+	for (std::unique_ptr<LinearArena>& arena : arenas)
+		arena->Reset();
+}
+
+size_t FrameArena::GetUsedBytes() const
+{
+	size_t total = 0;
+	for (const std::unique_ptr<LinearArena>& arena : arenas)
+		total += arena->GetUsedBytes();
+	return total;
+}
+
+size_t FrameArena::GetCapacity() const
+{
+	size_t total = 0;
+	for (const std::unique_ptr<LinearArena>& arena : arenas)
+		total += arena->GetCapacity();
+	return total;
+}
+
+uint64_t FrameArena::GetHeapAllocationCount() const
+{
+	uint64_t total = 0;
+	for (const std::unique_ptr<LinearArena>& arena : arenas)
+		total += arena->GetHeapAllocationCount();
+	return total;
+}
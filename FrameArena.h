@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+// Size of each block an arena gets from the heap
+#define LINEAR_ARENA_BLOCK_SIZE (64 * 1024)
+
+// --------------------------------------------------------
+// Bump allocator for data that only lives until the next
+// Reset(): allocating moves a pointer along a block, and
+// nothing is freed on its own.  Running out of room adds
+// another block, and the next Reset() swaps them all for
+// one block big enough for the lot - so once a few frames
+// have shown how much a frame needs, allocating never
+// touches the heap.
+//
+// Not thread safe - give each thread its own (see
+// FrameArena).
+// --------------------------------------------------------
+class LinearArena
+{
+public:
+	LinearArena(size_t blockSize = LINEAR_ARENA_BLOCK_SIZE);
+	~LinearArena();
+
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	// Allocation (alignment must be a power of two)
+	void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+	template<typename T> T* AllocateArray(size_t count) { return (T*)Allocate(sizeof(T) * count, alignof(T)); }
+	const char* CopyString(const char* str);
+
+	// Hands back the most recent allocation (anything else
+	// just stays until the reset)
+	void Free(void* memory, size_t size);
+
+	// Everything allocated is gone after this
+	void Reset();
+
+	// Getters
+	size_t GetUsedBytes() const { return usedBytes + offset; }
+	size_t GetPeakBytes() const { return peakBytes; }
+	size_t GetCapacity() const;
+	uint32_t GetBlockCount() const { return (uint32_t)blocks.size(); }
+	uint64_t GetHeapAllocationCount() const { return heapAllocations; }
+
+private:
+	struct Block
+	{
+		uint8_t* Memory;
+		size_t Size;
+	};
+
+	void AddBlock(size_t minSize);
+
+	std::vector<Block> blocks;
+	size_t blockSize;
+
+	// Position in the last block, and what the blocks before
+	// it had in use when it was added
+	size_t offset;
+	size_t usedBytes;
+
+	size_t peakBytes;
+	uint64_t heapAllocations;
+};
+
+// --------------------------------------------------------
+// A frame's arenas: one per job system thread, so jobs can
+// allocate without locking, plus one more for a caller
+// from outside the pool.  Get() takes the thread number
+// jobs are given, with anything past the pool (like
+// JOB_SYSTEM_NO_THREAD) getting the extra arena.
+//
+// Reset() once everything that used last frame's data is
+// done with it.
+// --------------------------------------------------------
+class FrameArena
+{
+public:
+	FrameArena(uint32_t threadCount, size_t blockSize = LINEAR_ARENA_BLOCK_SIZE);
+
+	LinearArena& Get(uint32_t thread = 0);
+	void Reset();
+
+	// Totals across every thread
+	size_t GetUsedBytes() const;
+	size_t GetCapacity() const;
+	uint64_t GetHeapAllocationCount() const;
+	uint32_t GetThreadCount() const { return (uint32_t)arenas.size() - 1; }
+
+private:
+	// Separate allocations, so threads don't share cache lines
+	std::vector<std::unique_ptr<LinearArena>> arenas;
+};
+
+// --------------------------------------------------------
+// Standard allocator that allocates from an arena, for
+// containers that only live for a frame.  Deallocating
+// does nothing (but the most recent allocation), so
+// reserve() up front where the size is known rather than
+// letting a vector grow.  Containers must be destroyed
+// before the arena's reset (clear() keeps the memory).
+// --------------------------------------------------------
+template<typename T>
+class FrameAllocator
+{
+public:
+	typedef T value_type;
+
+	FrameAllocator(LinearArena* arena) : arena(arena) {}
+	template<typename U> FrameAllocator(const FrameAllocator<U>& other) : arena(other.GetArena()) {}
+
+	T* allocate(size_t count) { return arena->AllocateArray<T>(count); }
+	void deallocate(T* memory, size_t count) { arena->Free(memory, sizeof(T) * count); }
+
+	LinearArena* GetArena() const { return arena; }
+
+	template<typename U> bool operator==(const FrameAllocator<U>& other) const { return arena == other.GetArena(); }
+	template<typename U> bool operator!=(const FrameAllocator<U>& other) const { return arena != other.GetArena(); }
+
+private:
+	LinearArena* arena;
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
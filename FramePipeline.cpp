@@ -0,0 +1,80 @@
+#include "FramePipeline.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static double SecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+FramePipeline::FramePipeline(std::shared_ptr<JobSystem> jobs) :
+	jobs(jobs),
+	pipelined(false),
+	published(false),
+	overlapped(false),
+	updateTime(0),
+	renderTime(0),
+	frameTime(0)
+{
+}
+
+// --------------------------------------------------------
+// Runs one frame's stages, overlapping update and render
+// when pipelined.  Everything has finished by the time this
+// returns, so the caller can handle window messages (and
+// resizes) between frames as usual.
+// --------------------------------------------------------
+void FramePipeline::RunFrame(std::function<void()> update, std::function<void()> publish, std::function<void()> render, std::function<void()> present)
+{
+	Clock::time_point frameStart = Clock::now();
+
+	// One after the other - also how a pipeline starts, as
+	// there's nothing published for render to work on yet
+	overlapped = pipelined && published && jobs && jobs->GetWorkerCount() > 0;
+	if (!overlapped)
+	{
+		update();
+		updateTime = SecondsSince(frameStart);
+		publish();
+		published = true;
+
+		Clock::time_point renderStart = Clock::now();
+		render();
+		present();
+		renderTime = SecondsSince(renderStart);
+		frameTime = SecondsSince(frameStart);
+		return;
+	}
+
+	// The last frame renders on a worker...
+	std::atomic<bool> renderStarted(false);
+	JobCounter rendered;
+	jobs->Run([&](uint32_t thread)
+	{
+		renderStarted.store(true, std::memory_order_release);
+		render();
+		renderTime = SecondsSince(frameStart);
+	}, &rendered);
+
+	// ...once one has taken it, as this thread would run it
+	// itself if update waited on jobs while it was queued
+	while (!renderStarted.load(std::memory_order_acquire))
+		std::this_thread::yield();
+
+	// ...while this thread runs the next frame's update
+	update();
+	updateTime = SecondsSince(frameStart);
+
+	// Helps with render's jobs until it's done, then shows it
+	jobs->Wait(rendered);
+	Clock::time_point presentStart = Clock::now();
+	present();
+	renderTime += SecondsSince(presentStart);
+
+	publish();
+	frameTime = SecondsSince(frameStart);
+}
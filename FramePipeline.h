@@ -0,0 +1,84 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <stdint.h>
+
+#include "JobSystem.h"
+
+// --------------------------------------------------------
+// Two copies of whatever a frame's render stage reads.  The
+// update stage fills the write copy while render reads the
+// other, and Publish() swaps them once both are done - so
+// they never touch the same one.
+//
+// The write copy is two frames old when update gets it, so
+// update should fill in all of it, not just what changed.
+// --------------------------------------------------------
+template<typename T>
+class FrameSnapshots
+{
+public:
+	FrameSnapshots() : writeIndex(0) {}
+
+	T& GetWrite() { return buffers[writeIndex]; }
+	T& GetRead() { return buffers[writeIndex ^ 1]; }
+
+	void Publish() { writeIndex ^= 1; }
+
+private:
+	T buffers[2];
+	uint32_t writeIndex;
+};
+
+// --------------------------------------------------------
+// Runs the stages of a frame: update, then publish (which
+// hands update's results to render), then render and
+// present.
+//
+// Pipelined, the frame published last time renders as a
+// job while the calling thread runs the next frame's
+// update, then presents it once both are done, and then
+// publishes.  A frame then takes as long as the slower
+// stage instead of the two added together, at the cost of
+// a frame of extra latency.  Update and render must only
+// share what publish hands over (see FrameSnapshots).
+//
+// Update and present always stay on the calling thread -
+// update as it reads the window and input state, and
+// present because swap chains want presenting from the
+// thread that pumps the window's messages.  Update doesn't
+// start until a worker has taken the render job, so a wait
+// inside update can't end up running render underneath it.
+// Without workers, frames run one stage after another.
+// --------------------------------------------------------
+class FramePipeline
+{
+public:
+	FramePipeline(std::shared_ptr<JobSystem> jobs);
+
+	void RunFrame(std::function<void()> update, std::function<void()> publish, std::function<void()> render, std::function<void()> present);
+
+	void SetPipelined(bool pipelined) { this->pipelined = pipelined; }
+	bool IsPipelined() const { return pipelined; }
+
+	// Whether the last frame actually overlapped its stages
+	// (the first pipelined frame can't - nothing's published -
+	// and nor can any without workers)
+	bool DidOverlap() const { return overlapped; }
+
+	// Last frame's timings, in seconds (render includes present)
+	double GetUpdateTime() const { return updateTime; }
+	double GetRenderTime() const { return renderTime; }
+	double GetFrameTime() const { return frameTime; }
+
+private:
+	std::shared_ptr<JobSystem> jobs;
+	bool pipelined;
+	bool published;
+	bool overlapped;
+
+	double updateTime;
+	double renderTime;
+	double frameTime;
+};
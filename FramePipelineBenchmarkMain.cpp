@@ -0,0 +1,189 @@
+// --------------------------------------------------------
+// Runs a frame loop with synthetic update and render loads,
+// one after the other and then pipelined, and prints the
+// throughput and latency of each:
+//
+//  - frame:   time between frames finishing
+//  - latency: time from a frame's update starting to that
+//             same frame finishing its render
+//
+// Render checks every snapshot it reads against a checksum
+// update wrote last, so a snapshot that changed under it
+// shows up as torn.
+//
+// Built by CMakeLists.txt:
+//
+//   FramePipelineBenchmarkMain --frames 300 --threads 4
+// --------------------------------------------------------
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FramePipeline.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Stand-in for entity transforms: enough math per value that
+// the load is CPU bound
+#define BENCH_VALUES_PER_FRAME 1024
+
+struct BenchFrame
+{
+	uint64_t Index = 0;
+	Clock::time_point UpdateStart;
+	std::vector<float> Values;
+	float Checksum = 0;
+};
+
+static float Work(float x, uint32_t rounds)
+{
+	for (uint32_t i = 0; i < rounds; i++)
+		x = sinf(x) * 0.5f + cosf(x * 0.25f);
+	return x;
+}
+
+// Rounds of Work() per value that take about a millisecond
+// for a whole frame's values
+static uint32_t Calibrate()
+{
+	uint32_t rounds = 64;
+	for (;;)
+	{
+		auto start = Clock::now();
+		float sink = 0;
+		for (uint32_t v = 0; v < BENCH_VALUES_PER_FRAME; v++)
+			sink += Work((float)v, rounds);
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		if (sink == 12345.0f)
+			printf("unexpected result\n");
+		if (ms > 20.0)
+			return (uint32_t)(rounds / ms) > 0 ? (uint32_t)(rounds / ms) : 1;
+		rounds *= 2;
+	}
+}
+
+struct BenchResult
+{
+	double FrameMs;
+	double LatencyMs;
+	double MaxLatencyMs;
+	uint32_t TornFrames;
+	uint32_t RepeatedFrames;
+};
+
+static BenchResult RunLoop(std::shared_ptr<JobSystem> jobs, bool pipelined, uint32_t frames, uint32_t updateRounds, uint32_t renderRounds)
+{
+	FramePipeline pipeline(jobs);
+	pipeline.SetPipelined(pipelined);
+	FrameSnapshots<BenchFrame> snapshots;
+	uint64_t frameIndex = 0;
+	uint64_t lastRendered = 0;
+	BenchResult result = {};
+	double latencyTotal = 0;
+	uint32_t rendered = 0;
+
+	auto update = [&]()
+	{
+		BenchFrame& frame = snapshots.GetWrite();
+		frame.Index = ++frameIndex;
+		frame.UpdateStart = Clock::now();
+		frame.Values.resize(BENCH_VALUES_PER_FRAME);
+
+		float checksum = 0;
+		for (uint32_t v = 0; v < BENCH_VALUES_PER_FRAME; v++)
+		{
+			frame.Values[v] = Work((float)(frame.Index + v), updateRounds);
+			checksum += frame.Values[v];
+		}
+		frame.Checksum = checksum;
+	};
+
+	auto publish = [&]() { snapshots.Publish(); };
+	auto present = [&]() {};
+
+	auto render = [&]()
+	{
+		BenchFrame& frame = snapshots.GetRead();
+		float checksum = 0;
+		float sink = 0;
+		for (uint32_t v = 0; v < BENCH_VALUES_PER_FRAME; v++)
+		{
+			checksum += frame.Values[v];
+			sink += Work(frame.Values[v], renderRounds);
+		}
+		if (sink == 12345.0f)
+			printf("unexpected result\n");
+
+		// A snapshot update wrote to while this read it won't add up
+		if (checksum != frame.Checksum || frame.Values.size() != BENCH_VALUES_PER_FRAME)
+			result.TornFrames++;
+		if (frame.Index == lastRendered)
+			result.RepeatedFrames++;
+		lastRendered = frame.Index;
+
+		double latency = std::chrono::duration<double, std::milli>(Clock::now() - frame.UpdateStart).count();
+		latencyTotal += latency;
+		result.MaxLatencyMs = latency > result.MaxLatencyMs ? latency : result.MaxLatencyMs;
+		rendered++;
+	};
+
+	// A few frames to fill the pipeline before timing
+	for (uint32_t f = 0; f < 4; f++)
+		pipeline.RunFrame(update, publish, render, present);
+	latencyTotal = 0;
+	rendered = 0;
+	result = {};
+
+	auto start = Clock::now();
+	for (uint32_t f = 0; f < frames; f++)
+		pipeline.RunFrame(update, publish, render, present);
+	double totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	result.FrameMs = totalMs / frames;
+	result.LatencyMs = latencyTotal / rendered;
+	return result;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned int cores = std::thread::hardware_concurrency();
+	uint32_t threads = cores > 0 ? cores : 1;
+	uint32_t frames = 300;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string name = argv[i];
+		if (name == "--threads") threads = (uint32_t)atoi(argv[i + 1]);
+		else if (name == "--frames") frames = (uint32_t)atoi(argv[i + 1]);
+	}
+	if (threads == 0 || frames == 0)
+	{
+		printf("Usage: FramePipelineBenchmarkMain [--threads count] [--frames count]\n");
+		return 1;
+	}
+
+	std::shared_ptr<JobSystem> jobs = std::make_shared<JobSystem>(threads - 1);
+	uint32_t roundsPerMs = Calibrate();
+	printf("%u hardware threads, %u in the pool, %u frames per run\n\n", cores, threads, frames);
+
+	// Update & render loads in milliseconds, from update
+	// bound to render bound
+	const float loads[][2] = { { 6, 2 }, { 4, 4 }, { 2, 6 }, { 1, 8 } };
+
+	printf("update  render  mode        frame ms  frames/s  latency ms  max latency  torn  repeated\n");
+	for (const float* load : loads)
+	{
+		for (int mode = 0; mode < 2; mode++)
+		{
+			BenchResult r = RunLoop(jobs, mode == 1, frames, (uint32_t)(load[0] * roundsPerMs), (uint32_t)(load[1] * roundsPerMs));
+			printf("%6.1f  %6.1f  %-9s  %8.2f  %8.1f  %10.2f  %11.2f  %4u  %8u\n",
+				load[0], load[1], mode == 1 ? "pipelined" : "serial",
+				r.FrameMs, 1000.0 / r.FrameMs, r.LatencyMs, r.MaxLatencyMs, r.TornFrames, r.RepeatedFrames);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,43 @@
+#include "ShaderIncludes.hlsli"
+#include "GBufferPacking.hlsli"
+
+// Fills the G-buffer for the tiled deferred path, from the
+// same textures the forward PBR shaders use
+cbuffer ExternalData : register(b0)
+{
+	float3 colorTint;
+	float3 cameraPosition;
+	float3 cameraForward;
+}
+
+Texture2D Albedo			: register(t0);
+Texture2D RoughnessMap		: register(t1);
+Texture2D MetalnessMap		: register(t2);
+Texture2D NormalMap			: register(t3);
+SamplerState BasicSampler	: register(s0);
+
+// --------------------------------------------------------
+// The entry point (main method) for our pixel shader
+// --------------------------------------------------------
+GBufferOutput main(VertexToPixel input)
+{
+	// Normal mapping
+	float3 unpackedNormal = normalize(NormalMap.Sample(BasicSampler, input.uv).rgb * 2 - 1);
+	float3 N = normalize(input.normal);
+	float3 T = normalize(input.tangent);
+	T = normalize(T - N * dot(T, N));
+	float3 B = cross(T, N);
+	float3x3 TBN = float3x3(T, B, N);
+	float3 normal = normalize(mul(unpackedNormal, TBN));
+
+	float3 surfaceColor = pow(Albedo.Sample(BasicSampler, input.uv).rgb, 2.2f) * colorTint;
+
+	GBufferOutput output;
+	output.albedo = float4(surfaceColor, 1);	// Encoded by the sRGB target
+	output.normal = EncodeOctahedral(normal);
+	output.material = float2(
+		RoughnessMap.Sample(BasicSampler, input.uv).r,
+		MetalnessMap.Sample(BasicSampler, input.uv).r);
+	output.viewDepth = dot(input.worldPos - cameraPosition, cameraForward);
+	return output;
+}
@@ -0,0 +1,160 @@
+#include "GBufferPacking.h"
+
+#include <cmath>
+
+// Clamps to [low, high]
+static float Clamp(float value, float low, float high)
+{
+	return value < low ? low : (value > high ? high : value);
+}
+
+// Sign that treats zero as positive (matches the shader)
+static float SignNotZero(float value)
+{
+	return value >= 0.0f ? 1.0f : -1.0f;
+}
+
+// --------------------------------------------------------
+// Packs a surface the same way GBufferPS + the render
+// target formats do
+// --------------------------------------------------------
+GBufferTexel GBufferPacking::Pack(const GBufferSurface& surface)
+{
+	GBufferTexel texel;
+
+	// Albedo goes to an sRGB target, alpha unused (written as 1)
+	texel.Albedo =
+		(uint32_t)FloatToUnorm8(LinearToSRGB(surface.Albedo[0])) |
+		((uint32_t)FloatToUnorm8(LinearToSRGB(surface.Albedo[1])) << 8) |
+		((uint32_t)FloatToUnorm8(LinearToSRGB(surface.Albedo[2])) << 16) |
+		(0xFFu << 24);
+
+	float encoded[2];
+	EncodeOctahedral(surface.Normal, encoded);
+	texel.Normal =
+		(uint32_t)(uint16_t)FloatToSnorm16(encoded[0]) |
+		((uint32_t)(uint16_t)FloatToSnorm16(encoded[1]) << 16);
+
+	texel.Material = (uint16_t)(
+		FloatToUnorm8(surface.Roughness) |
+		(FloatToUnorm8(surface.Metalness) << 8));
+
+	texel.ViewDepth = surface.ViewDepth;
+	return texel;
+}
+
+// --------------------------------------------------------
+// Unpacks a texel the same way DeferredLightingPS does
+// --------------------------------------------------------
+GBufferSurface GBufferPacking::Unpack(const GBufferTexel& texel)
+{
+	GBufferSurface surface;
+
+	for (int i = 0; i < 3; i++)
+		surface.Albedo[i] = SRGBToLinear(Unorm8ToFloat((uint8_t)(texel.Albedo >> (i * 8))));
+
+	float encoded[2] =
+	{
+		Snorm16ToFloat((int16_t)(uint16_t)(texel.Normal & 0xFFFF)),
+		Snorm16ToFloat((int16_t)(uint16_t)(texel.Normal >> 16))
+	};
+	DecodeOctahedral(encoded, surface.Normal);
+
+	surface.Roughness = Unorm8ToFloat((uint8_t)(texel.Material & 0xFF));
+	surface.Metalness = Unorm8ToFloat((uint8_t)(texel.Material >> 8));
+	surface.ViewDepth = texel.ViewDepth;
+	return surface;
+}
+
+// --------------------------------------------------------
+// Projects the normal onto an octahedron and unfolds the
+// lower half over the upper half's corners
+// --------------------------------------------------------
+void GBufferPacking::EncodeOctahedral(const float normal[3], float encoded[2])
+{
+	float l1 = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+	if (l1 <= 0.0f)
+	{
+		encoded[0] = 0.0f;
+		encoded[1] = 0.0f;
+		return;
+	}
+
+	float x = normal[0] / l1;
+	float y = normal[1] / l1;
+	if (normal[2] < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+		float foldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	encoded[0] = x;
+	encoded[1] = y;
+}
+
+// --------------------------------------------------------
+// Inverse of EncodeOctahedral, returning a unit vector
+// --------------------------------------------------------
+void GBufferPacking::DecodeOctahedral(const float encoded[2], float normal[3])
+{
+	float x = encoded[0];
+	float y = encoded[1];
+	float z = 1.0f - fabsf(x) - fabsf(y);
+	if (z < 0.0f)
+	{
+		float unfoldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+		float unfoldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+		x = unfoldedX;
+		y = unfoldedY;
+	}
+
+	float length = sqrtf(x * x + y * y + z * z);
+	normal[0] = x / length;
+	normal[1] = y / length;
+	normal[2] = z / length;
+}
+
+// Float -> UNORM8, round to nearest
+uint8_t GBufferPacking::FloatToUnorm8(float value)
+{
+	return (uint8_t)floorf(Clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+// UNORM8 -> float
+float GBufferPacking::Unorm8ToFloat(uint8_t value)
+{
+	return value / 255.0f;
+}
+
+// Float -> SNORM16, round to nearest
+int16_t GBufferPacking::FloatToSnorm16(float value)
+{
+	float scaled = Clamp(value, -1.0f, 1.0f) * 32767.0f;
+	return (int16_t)(scaled >= 0.0f ? floorf(scaled + 0.5f) : ceilf(scaled - 0.5f));
+}
+
+// SNORM16 -> float (both -32768 and -32767 map to -1)
+float GBufferPacking::Snorm16ToFloat(int16_t value)
+{
+	return Clamp(value / 32767.0f, -1.0f, 1.0f);
+}
+
+// The exact sRGB curve, as used by _SRGB formats
+float GBufferPacking::LinearToSRGB(float value)
+{
+	value = Clamp(value, 0.0f, 1.0f);
+	return value <= 0.0031308f ?
+		value * 12.92f :
+		1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// Inverse of LinearToSRGB
+float GBufferPacking::SRGBToLinear(float value)
+{
+	value = Clamp(value, 0.0f, 1.0f);
+	return value <= 0.04045f ?
+		value / 12.92f :
+		powf((value + 0.055f) / 1.055f, 2.4f);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+// --------------------------------------------------------
+// G-buffer layout for the tiled deferred path.  The shader
+// side lives in GBufferPacking.hlsli - these must match.
+//
+//  RT0  R8G8B8A8_UNORM_SRGB : linear albedo (sRGB encoded by the hardware)
+//  RT1  R16G16_SNORM        : octahedral world space normal
+//  RT2  R8G8_UNORM          : roughness, metalness
+//  RT3  R32_FLOAT           : linear view depth (0 = nothing drawn)
+// --------------------------------------------------------
+#define GBUFFER_TARGET_COUNT 4
+
+// An unpacked G-buffer sample
+struct GBufferSurface
+{
+	float Albedo[3] = { 0, 0, 0 };
+	float Normal[3] = { 0, 0, 1 };
+	float Roughness = 0;
+	float Metalness = 0;
+	float ViewDepth = 0;
+};
+
+// One pixel's worth of packed G-buffer data, bit for bit
+// what ends up in each render target
+struct GBufferTexel
+{
+	uint32_t Albedo = 0;		// RGBA8, R in the low byte
+	uint32_t Normal = 0;		// Two SNORM16s, X in the low half
+	uint16_t Material = 0;		// Two UNORM8s, roughness in the low byte
+	float ViewDepth = 0;
+};
+
+// --------------------------------------------------------
+// CPU reference of the G-buffer encoding, so the packing
+// can be checked (and used by tools) without a GPU
+// --------------------------------------------------------
+class GBufferPacking
+{
+public:
+	static GBufferTexel Pack(const GBufferSurface& surface);
+	static GBufferSurface Unpack(const GBufferTexel& texel);
+
+	// Octahedral normal mapping: unit vector <-> [-1, 1]^2
+	static void EncodeOctahedral(const float normal[3], float encoded[2]);
+	static void DecodeOctahedral(const float encoded[2], float normal[3]);
+
+	// Format conversions, rounding the way D3D does
+	static uint8_t FloatToUnorm8(float value);
+	static float Unorm8ToFloat(uint8_t value);
+	static int16_t FloatToSnorm16(float value);
+	static float Snorm16ToFloat(int16_t value);
+	static float LinearToSRGB(float value);
+	static float SRGBToLinear(float value);
+};
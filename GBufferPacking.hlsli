@@ -0,0 +1,46 @@
+#ifndef __GGP__GBUFFER__PACKING__
+#define __GGP__GBUFFER__PACKING__
+
+// --------------------------------------------------------
+// G-buffer layout for the tiled deferred path - matches
+// GBufferPacking.h (which has a CPU reference of all this)
+//
+//  RT0  R8G8B8A8_UNORM_SRGB : linear albedo
+//  RT1  R16G16_SNORM        : octahedral world space normal
+//  RT2  R8G8_UNORM          : roughness, metalness
+//  RT3  R32_FLOAT           : linear view depth (0 = nothing drawn)
+// --------------------------------------------------------
+struct GBufferOutput
+{
+	float4 albedo		: SV_TARGET0;
+	float2 normal		: SV_TARGET1;
+	float2 material		: SV_TARGET2;
+	float viewDepth		: SV_TARGET3;
+};
+
+// Sign that treats zero as positive
+float2 SignNotZero(float2 v)
+{
+	return float2(v.x >= 0 ? 1.0f : -1.0f, v.y >= 0 ? 1.0f : -1.0f);
+}
+
+// Unit vector -> [-1, 1]^2
+float2 EncodeOctahedral(float3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	float2 encoded = n.xy;
+	if (n.z < 0)
+		encoded = (1.0f - abs(n.yx)) * SignNotZero(n.xy);
+	return encoded;
+}
+
+// [-1, 1]^2 -> unit vector
+float3 DecodeOctahedral(float2 encoded)
+{
+	float3 n = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	if (n.z < 0)
+		n.xy = (1.0f - abs(n.yx)) * SignNotZero(n.xy);
+	return normalize(n);
+}
+
+#endif
@@ -0,0 +1,302 @@
+// --------------------------------------------------------
+// Tests the tiled deferred path's CPU halves:
+//
+//  - GBufferPacking's octahedral normals round trip to
+//    within float error, and to within a bound through the
+//    SNORM16 target - over both Z hemispheres, the seam
+//    between them and the six axes, which come back exact
+//  - the other targets' conversions and a whole texel
+//  - TileLightCuller's lists match testing every light
+//    against every tile, with and without per-tile depth
+//    bounds, and no tile misses a light that covers one of
+//    its pixels
+// --------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "GBufferPacking.h"
+#include "TileLightCulling.h"
+#include "TestCheck.h"
+
+// Repeatable random numbers in [0, 1)
+static uint32_t seed = 2024;
+static float Random()
+{
+	seed = seed * 1664525u + 1013904223u;
+	return (seed >> 8) / 16777216.0f;
+}
+
+// Angle between two unit vectors, in radians
+static float AngleBetween(const float a[3], const float b[3])
+{
+	float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	float cross[3] =
+	{
+		a[1] * b[2] - a[2] * b[1],
+		a[2] * b[0] - a[0] * b[2],
+		a[0] * b[1] - a[1] * b[0]
+	};
+	return atan2f(sqrtf(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]), dot);
+}
+
+static void RandomDirection(float direction[3])
+{
+	float z = Random() * 2.0f - 1.0f;
+	float angle = Random() * 6.2831853f;
+	float r = sqrtf(1.0f - z * z);
+	direction[0] = r * cosf(angle);
+	direction[1] = r * sinf(angle);
+	direction[2] = z;
+}
+
+// Worst angle a normal is off after the trip, and how much
+// off unit length it comes back, straight or through a texel
+struct RoundTripError
+{
+	float Angle = 0;
+	float Length = 0;
+	bool InRange = true;
+};
+
+static void RoundTrip(const float normal[3], bool packed, RoundTripError& error)
+{
+	float decoded[3];
+	if (packed)
+	{
+		GBufferSurface surface;
+		for (int i = 0; i < 3; i++)
+			surface.Normal[i] = normal[i];
+		GBufferSurface unpacked = GBufferPacking::Unpack(GBufferPacking::Pack(surface));
+		for (int i = 0; i < 3; i++)
+			decoded[i] = unpacked.Normal[i];
+	}
+	else
+	{
+		float encoded[2];
+		GBufferPacking::EncodeOctahedral(normal, encoded);
+		error.InRange &= fabsf(encoded[0]) <= 1.0f && fabsf(encoded[1]) <= 1.0f;
+		GBufferPacking::DecodeOctahedral(encoded, decoded);
+	}
+
+	error.Angle = std::max(error.Angle, AngleBetween(normal, decoded));
+	error.Length = std::max(error.Length, fabsf(sqrtf(decoded[0] * decoded[0] + decoded[1] * decoded[1] + decoded[2] * decoded[2]) - 1.0f));
+}
+
+static void TestOctahedral()
+{
+	// The six axes come back as they went in
+	const float axes[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+	for (const float* axis : axes)
+	{
+		float encoded[2];
+		float decoded[3];
+		GBufferPacking::EncodeOctahedral(axis, encoded);
+		GBufferPacking::DecodeOctahedral(encoded, decoded);
+		CHECK(decoded[0] == axis[0] && decoded[1] == axis[1] && decoded[2] == axis[2]);
+
+		GBufferSurface surface;
+		for (int i = 0; i < 3; i++)
+			surface.Normal[i] = axis[i];
+		GBufferSurface unpacked = GBufferPacking::Unpack(GBufferPacking::Pack(surface));
+		CHECK(unpacked.Normal[0] == axis[0] && unpacked.Normal[1] == axis[1] && unpacked.Normal[2] == axis[2]);
+	}
+
+	// Random directions, split by hemisphere (the -Z one is
+	// the folded half), plus the equator between them
+	RoundTripError exact[3], packed[3];
+	for (int i = 0; i < 20000; i++)
+	{
+		float normal[3];
+		RandomDirection(normal);
+		int half = normal[2] >= 0.0f ? 0 : 1;
+		RoundTrip(normal, false, exact[half]);
+		RoundTrip(normal, true, packed[half]);
+
+		float angle = Random() * 6.2831853f;
+		float equator[3] = { cosf(angle), sinf(angle), 0.0f };
+		RoundTrip(equator, false, exact[2]);
+		RoundTrip(equator, true, packed[2]);
+	}
+
+	for (int half = 0; half < 3; half++)
+	{
+		CHECK(exact[half].InRange);
+		CHECK(exact[half].Angle < 1e-3f);
+		CHECK(exact[half].Length < 1e-5f);
+
+		// Octahedral texels are at most ~1.5x the size of the
+		// SNORM16 step on the sphere, so that's the bound
+		CHECK(packed[half].Angle < 1.5f * 3.1415927f / 32767.0f);
+		CHECK(packed[half].Length < 1e-5f);
+	}
+}
+
+static void TestConversions()
+{
+	CHECK(GBufferPacking::FloatToUnorm8(0.0f) == 0);
+	CHECK(GBufferPacking::FloatToUnorm8(1.0f) == 255);
+	CHECK(GBufferPacking::FloatToUnorm8(2.0f) == 255);
+	CHECK(GBufferPacking::FloatToUnorm8(-1.0f) == 0);
+	CHECK(GBufferPacking::FloatToUnorm8(0.5f) == 128);
+	CHECK(GBufferPacking::FloatToSnorm16(1.0f) == 32767);
+	CHECK(GBufferPacking::FloatToSnorm16(-1.0f) == -32767);
+	CHECK(GBufferPacking::Snorm16ToFloat(-32768) == -1.0f);
+
+	bool roundTrips = true;
+	for (int value = 0; value < 256; value++)
+	{
+		roundTrips &= GBufferPacking::FloatToUnorm8(GBufferPacking::Unorm8ToFloat((uint8_t)value)) == value;
+		float linear = GBufferPacking::SRGBToLinear(value / 255.0f);
+		roundTrips &= fabsf(GBufferPacking::LinearToSRGB(linear) - value / 255.0f) < 1e-5f;
+	}
+	CHECK(roundTrips);
+
+	// A whole texel
+	GBufferSurface surface;
+	surface.Albedo[0] = 0.8f;
+	surface.Albedo[1] = 0.2f;
+	surface.Albedo[2] = 0.01f;
+	surface.Normal[0] = 0.6f;
+	surface.Normal[1] = 0.0f;
+	surface.Normal[2] = -0.8f;
+	surface.Roughness = 0.35f;
+	surface.Metalness = 1.0f;
+	surface.ViewDepth = 12.5f;
+	GBufferSurface unpacked = GBufferPacking::Unpack(GBufferPacking::Pack(surface));
+
+	// sRGB spends its bits on the darks, so relative error
+	for (int i = 0; i < 3; i++)
+		CHECK(fabsf(unpacked.Albedo[i] - surface.Albedo[i]) <= surface.Albedo[i] * 0.02f + 1e-4f);
+	CHECK(fabsf(unpacked.Roughness - 0.35f) <= 0.5f / 255.0f);
+	CHECK(unpacked.Metalness == 1.0f);
+	CHECK(unpacked.ViewDepth == 12.5f);
+	CHECK(AngleBetween(unpacked.Normal, surface.Normal) < 1e-4f);
+}
+
+// Sorted lights each tile got, from the culler
+static std::vector<std::vector<uint32_t>> GetTileLists(TileLightCuller& culler)
+{
+	const std::vector<uint32_t>& ranges = culler.GetTileRanges();
+	const std::vector<uint32_t>& indices = culler.GetLightIndices();
+	std::vector<std::vector<uint32_t>> lists(ranges.size() / 2);
+	for (size_t tile = 0; tile < lists.size(); tile++)
+	{
+		for (uint32_t i = 0; i < ranges[tile * 2 + 1]; i++)
+			lists[tile].push_back(indices[ranges[tile * 2] + i]);
+	}
+	return lists;
+}
+
+static void TestTileCulling()
+{
+	// A screen that doesn't divide into whole tiles
+	TileCullingConfig config;
+	config.TileSize = 16;
+	config.ScreenWidth = 300;
+	config.ScreenHeight = 170;
+	config.NearZ = 0.5f;
+	config.FarZ = 60.0f;
+	config.TanHalfFovY = tanf(0.6f);
+	config.TanHalfFovX = config.TanHalfFovY * 300.0f / 170.0f;
+	uint32_t tileCountX = config.GetTileCountX();
+	uint32_t tileCount = config.GetTileCount();
+	CHECK(tileCountX == 19 && config.GetTileCountY() == 11);
+
+	// Lights all over (and off) the screen, a few big enough
+	// to reach the near plane, and two global ones
+	std::vector<ClusterLight> lights(300);
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		ClusterLight& light = lights[i];
+		light.Position[2] = Random() * 70.0f - 5.0f;
+		float spread = std::max(light.Position[2], 1.0f);
+		light.Position[0] = (Random() * 2.6f - 1.3f) * config.TanHalfFovX * spread;
+		light.Position[1] = (Random() * 2.6f - 1.3f) * config.TanHalfFovY * spread;
+		light.Range = i % 25 == 0 ? 6.0f : 0.2f + Random() * 2.5f;
+		light.Global = i == 7 || i == 150;
+	}
+
+	// Per-tile depth bounds, like a depth buffer's
+	std::vector<float> tileMinZ(tileCount), tileMaxZ(tileCount);
+	for (uint32_t tile = 0; tile < tileCount; tile++)
+	{
+		tileMinZ[tile] = config.NearZ + Random() * 20.0f;
+		tileMaxZ[tile] = tileMinZ[tile] + Random() * 30.0f;
+	}
+
+	TileLightCuller culler;
+	for (int depthBounds = 0; depthBounds < 2; depthBounds++)
+	{
+		culler.Build(config, lights.data(), (unsigned int)lights.size(),
+			depthBounds ? tileMinZ.data() : nullptr,
+			depthBounds ? tileMaxZ.data() : nullptr);
+
+		// Globals go first, in order
+		CHECK(culler.GetGlobalLightCount() == 2);
+		CHECK(culler.GetLightIndices()[0] == 7 && culler.GetLightIndices()[1] == 150);
+
+		// Every light against every tile's whole frustum
+		std::vector<std::vector<uint32_t>> lists = GetTileLists(culler);
+		bool matches = true;
+		size_t hits = 0;
+		for (uint32_t tile = 0; tile < tileCount; tile++)
+		{
+			TileFrustum frustum;
+			TileLightCuller::GetTileFrustum(config, tile % tileCountX, tile / tileCountX,
+				depthBounds ? tileMinZ[tile] : config.NearZ,
+				depthBounds ? tileMaxZ[tile] : config.FarZ,
+				frustum);
+
+			std::vector<uint32_t> expected;
+			for (uint32_t i = 0; i < lights.size(); i++)
+			{
+				if (!lights[i].Global && TileLightCuller::SphereIntersectsTile(frustum, lights[i].Position, lights[i].Range))
+					expected.push_back(i);
+			}
+			matches &= lists[tile] == expected;
+			hits += expected.size();
+		}
+		CHECK(matches);
+		CHECK(hits > tileCount);
+	}
+
+	// Points inside lights land in tiles that list them
+	culler.Build(config, lights.data(), (unsigned int)lights.size());
+	std::vector<std::vector<uint32_t>> lists = GetTileLists(culler);
+	bool covered = true;
+	for (uint32_t i = 0; i < lights.size(); i++)
+	{
+		if (lights[i].Global)
+			continue;
+
+		for (int sample = 0; sample < 64; sample++)
+		{
+			float offset[3];
+			RandomDirection(offset);
+			float distance = lights[i].Range * sqrtf(Random());
+			float point[3];
+			for (int axis = 0; axis < 3; axis++)
+				point[axis] = lights[i].Position[axis] + offset[axis] * distance;
+			if (point[2] < config.NearZ || point[2] > config.FarZ)
+				continue;
+
+			float pixelX = (point[0] / (point[2] * config.TanHalfFovX) * 0.5f + 0.5f) * config.ScreenWidth;
+			float pixelY = (0.5f - point[1] / (point[2] * config.TanHalfFovY) * 0.5f) * config.ScreenHeight;
+			if (pixelX < 0.0f || pixelY < 0.0f || pixelX >= config.ScreenWidth || pixelY >= config.ScreenHeight)
+				continue;
+
+			uint32_t tile = (uint32_t)pixelX / config.TileSize + (uint32_t)pixelY / config.TileSize * tileCountX;
+			covered &= std::find(lists[tile].begin(), lists[tile].end(), i) != lists[tile].end();
+		}
+	}
+	CHECK(covered);
+}
+
+int main()
+{
+	TestOctahedral();
+	TestConversions();
+	TestTileCulling();
+	return TestResult();
+}
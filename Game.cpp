@@ -2,6 +2,8 @@
 #include "Vertex.h"
 #include "Input.h"
 #include "PathHelpers.h"
+#include "SceneFile.h"
+#include <algorithm>
 #include <cmath>
 
 // ImGui
@@ -15,6 +17,9 @@
 #pragma comment(lib, "d3dcompiler.lib")
 #include <d3dcompiler.h>
 
+// Entities a job takes at a time when updating them in parallel
+#define ENTITIES_PER_JOB 64
+
 // For the DirectX Math library
 using namespace DirectX;
 
@@ -34,7 +39,13 @@ Game::Game(HINSTANCE hInstance)
 		720,				// Height of the window's client area
 		false,				// Sync the framerate to the monitor refresh? (lock framerate)
 		true),				// Show extra stats (fps) in title bar?
-	ambientColor(0.0f, 0.0f, 0.0f)
+	ambientColor(0.0f, 0.0f, 0.0f),
+	useClusteredLighting(true),
+	renderPath(RENDER_PATH_FORWARD),
+	useShadowCache(true),
+	clusteredMaterials(false),
+	fixedStep(0.0f),
+	fixedTime(0.0f)
 {
 #if defined(DEBUG) || defined(_DEBUG)
 	// Do we want a console window?  Probably only in debug mode
@@ -65,9 +76,10 @@ Game::~Game()
 
 // --------------------------------------------------------
 // Called once per program, after Direct3D and the window
-// are initialized but before the game loop.
+// are initialized but before the game loop.  Failing stops
+// the program before anything is drawn.
 // --------------------------------------------------------
-void Game::Init()
+HRESULT Game::Init()
 {
 	// Initialize ImGui &platform/renderer backends
 	IMGUI_CHECKVERSION();
@@ -80,11 +92,60 @@ void Game::Init()
 	// ImGui::StyleColorsClassic();
 	// mGui::StyleColorsLight();
 
+	// Worker threads for jobs, leaving a core for this one.  Every
+	// thread that runs jobs can record draws, so shaders get a
+	// thread slot for each (before any are loaded).
+	unsigned int workerCount = std::thread::hardware_concurrency();
+	workerCount = workerCount > 1 ? workerCount - 1 : 0;
+	jobSystem = std::make_shared<JobSystem>(workerCount,
+		[](uint32_t thread) { ISimpleShader::SetThreadSlot(thread); });
+	ISimpleShader::SetThreadSlotCount(jobSystem->GetThreadCount());
+	frameArena = std::make_shared<FrameArena>(jobSystem->GetThreadCount());
+
+	// Update & Draw can overlap, the last frame drawing as a job
+	// while this thread updates the next (off until switched on
+	// in the UI)
+	framePipeline = std::make_shared<FramePipeline>(jobSystem);
+
 	// Helper method for loading shaders
 	LoadShaders();
 
-	// Helper method to create basic geometry
-	CreateGeometry();
+	// Meshes & the sky make their resources through the RHI
+	rhiDevice = std::make_shared<D3D11RHIDevice>(device, context);
+
+	// Everything in the scene comes from its file, and there's
+	// nothing to draw without it
+	if (!LoadScene(FixPath(L"../../Assets/Scenes/DemoScene.scene")))
+		return E_FAIL;
+
+	// Systems for each fixed step: everything's transform is
+	// remembered before anything moves, so rendering can
+	// interpolate from it
+	SceneComponentMask entityMask = GetSceneComponentMask<GameEntity>();
+	fixedSystems.AddSystem("Remember Transforms", entityMask, GetSceneComponentMask<PreviousTransform>(),
+		[](const SceneChunkView& chunk, uint32_t thread) {
+			GameEntity* entities = chunk.Get<GameEntity>();
+			PreviousTransform* previous = chunk.Get<PreviousTransform>();
+			for (uint32_t i = 0; i < chunk.Count; i++)
+				previous[i].Value = entities[i].GetTransform();
+		});
+	fixedSystems.AddSystem("Move Entities", GetSceneComponentMask<EntityMotion>(), entityMask,
+		[this](const SceneChunkView& chunk, uint32_t thread) {
+			GameEntity* entities = chunk.Get<GameEntity>();
+			const EntityMotion* motion = chunk.Get<EntityMotion>();
+			// The bob is an offset from where the entity started, so
+			// it's the same at a given time whatever the tick rate
+			float bob = sin(fixedTime);
+			for (uint32_t i = 0; i < chunk.Count; i++)
+			{
+				Transform& transform = entities[i].GetTransform();
+				transform.Rotate(0.0f, motion[i].SpinSpeed * fixedStep, 0.0f);
+				transform.SetPosition(
+					motion[i].Center.x + motion[i].Bob.x * bob,
+					motion[i].Center.y + motion[i].Bob.y * bob,
+					motion[i].Center.z + motion[i].Bob.z * bob);
+			}
+		});
 	
 	// Set initial graphics API state
 	//  - These settings persist until we change them
@@ -96,60 +157,19 @@ void Game::Init()
 		// Essentially: "What kind of shape should the GPU draw with our vertices?"
 		context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	}
-
-	// Create the camera
-	std::shared_ptr<Camera> camera1 = std::make_shared<Camera>(
-		0.0f,		// x
-		0.0f,		// y
-		-10.0f,		// z
-		5.0f,		// move speed
-		0.002f,		// look speed
-		XM_PIDIV4,	// fov
-		(float)windowWidth / windowHeight,	// Aspect ratio
-		0.01f,		// near clip
-		300.0f);	// far clip
-
-	std::shared_ptr<Camera> camera2 = std::make_shared<Camera>(
-		0.0f,		// x
-		0.0f,		// y
-		-50.0f,		// z
-		5.0f,		// move speed
-		0.002f,		// look speed
-		1.2f,		// fov
-		(float)windowWidth / windowHeight,	// Aspect ratio
-		0.01f,		// near clip
-		300.0f);	// far clip
-
-	std::shared_ptr<Camera> camera3 = std::make_shared<Camera>(
-		0.0f,		// x
-		15.0f,		// y
-		-15.0f,		// z
-		5.0f,		// move speed
-		0.002f,		// look speed
-		XM_PIDIV2,	// fov
-		(float)windowWidth / windowHeight,	// Aspect ratio
-		0.01f,		// near clip
-		300.0f);	// far clip
-
-	camera3->GetTransform().Rotate(1.0f, 0.0f, 0.0f);
-
-	cameras.push_back(camera1);
-	cameras.push_back(camera2);
-	cameras.push_back(camera3);
-
-	camera = cameras[0];
 	
 	// Create Shadow Resources
 
 	// Variables
-	shadowMapResolution = 1024;
-	float lightProjectionSize = 30.0f; 
+	shadowMapResolution = 2048;
+	shadowCascadeConfig.Resolution = shadowMapResolution;
+	shadowCascadeConfig.CascadeCount = MAX_SHADOW_CASCADES;
 	
-	// Create the actual texture that will be the shadow map
+	// Create the actual texture that will be the shadow map - one slice per cascade
 	D3D11_TEXTURE2D_DESC shadowDesc = {};
 	shadowDesc.Width = shadowMapResolution; // Ideally a power of 2 (like 1024)
 	shadowDesc.Height = shadowMapResolution; // Ideally a power of 2 (like 1024)
-	shadowDesc.ArraySize = 1;
+	shadowDesc.ArraySize = MAX_SHADOW_CASCADES;
 	shadowDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
 	shadowDesc.CPUAccessFlags = 0;
 	shadowDesc.Format = DXGI_FORMAT_R32_TYPELESS;
@@ -161,27 +181,82 @@ void Game::Init()
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> shadowTexture;
 	device->CreateTexture2D(&shadowDesc, 0, shadowTexture.GetAddressOf());
 
-	// Create the depth/stencil view
-	D3D11_DEPTH_STENCIL_VIEW_DESC shadowDSDesc = {};
-	shadowDSDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	shadowDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	shadowDSDesc.Texture2D.MipSlice = 0;
-	device->CreateDepthStencilView(
-		shadowTexture.Get(),
-		&shadowDSDesc,
-		shadowDSV.GetAddressOf());
+	// Create a depth/stencil view for each cascade's slice
+	for (unsigned int i = 0; i < MAX_SHADOW_CASCADES; i++)
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC shadowDSDesc = {};
+		shadowDSDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		shadowDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+		shadowDSDesc.Texture2DArray.MipSlice = 0;
+		shadowDSDesc.Texture2DArray.FirstArraySlice = i;
+		shadowDSDesc.Texture2DArray.ArraySize = 1;
+		device->CreateDepthStencilView(
+			shadowTexture.Get(),
+			&shadowDSDesc,
+			shadowDSVs[i].GetAddressOf());
+	}
 
-	// Create the SRV for the shadow map
+	// Create the SRV for the whole shadow map array
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MipLevels = 1;
-	srvDesc.Texture2D.MostDetailedMip = 0;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MipLevels = 1;
+	srvDesc.Texture2DArray.MostDetailedMip = 0;
+	srvDesc.Texture2DArray.FirstArraySlice = 0;
+	srvDesc.Texture2DArray.ArraySize = MAX_SHADOW_CASCADES;
 	device->CreateShaderResourceView(
 		shadowTexture.Get(),
 		&srvDesc,
 		shadowSRV.GetAddressOf());
 
+	// A matching array that only ever holds static casters
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> staticShadowTexture;
+	device->CreateTexture2D(&shadowDesc, 0, staticShadowTexture.GetAddressOf());
+	for (unsigned int i = 0; i < MAX_SHADOW_CASCADES; i++)
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC staticDSDesc = {};
+		staticDSDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		staticDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+		staticDSDesc.Texture2DArray.MipSlice = 0;
+		staticDSDesc.Texture2DArray.FirstArraySlice = i;
+		staticDSDesc.Texture2DArray.ArraySize = 1;
+		device->CreateDepthStencilView(
+			staticShadowTexture.Get(),
+			&staticDSDesc,
+			staticShadowDSVs[i].GetAddressOf());
+	}
+	device->CreateShaderResourceView(
+		staticShadowTexture.Get(),
+		&srvDesc,
+		staticShadowSRV.GetAddressOf());
+	shadowCache.Invalidate();
+
+	// One big depth texture shared by all point & spot light shadows
+	D3D11_TEXTURE2D_DESC atlasDesc = shadowDesc;
+	atlasDesc.Width = shadowAtlasConfig.AtlasSize;
+	atlasDesc.Height = shadowAtlasConfig.AtlasSize;
+	atlasDesc.ArraySize = 1;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> atlasTexture;
+	device->CreateTexture2D(&atlasDesc, 0, atlasTexture.GetAddressOf());
+
+	D3D11_DEPTH_STENCIL_VIEW_DESC atlasDSDesc = {};
+	atlasDSDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	atlasDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+	atlasDSDesc.Texture2D.MipSlice = 0;
+	device->CreateDepthStencilView(atlasTexture.Get(), &atlasDSDesc, shadowAtlasDSV.GetAddressOf());
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC atlasSRVDesc = {};
+	atlasSRVDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	atlasSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	atlasSRVDesc.Texture2D.MipLevels = 1;
+	atlasSRVDesc.Texture2D.MostDetailedMip = 0;
+	device->CreateShaderResourceView(atlasTexture.Get(), &atlasSRVDesc, shadowAtlasSRV.GetAddressOf());
+
+	// Nothing is in shadow until a light has been rendered
+	context->ClearDepthStencilView(shadowAtlasDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+	shadowAtlasFaceBuffer = std::make_shared<DynamicStructuredBuffer>(device, context);
+	lightShadowFaceBuffer = std::make_shared<DynamicStructuredBuffer>(device, context);
+
 	// Create a shadow rasterizer state
 	D3D11_RASTERIZER_DESC shadowRastDesc = {};
 	shadowRastDesc.FillMode = D3D11_FILL_SOLID;
@@ -189,8 +264,23 @@ void Game::Init()
 	shadowRastDesc.DepthClipEnable = true;
 	shadowRastDesc.DepthBias = 1000; // Min. precision units, not world units!
 	shadowRastDesc.SlopeScaledDepthBias = 1.0f; // Bias more based on slope
+	shadowRastDesc.ScissorEnable = true; // Cached maps only redraw dirty regions
 	device->CreateRasterizerState(&shadowRastDesc, &shadowRasterizer);
 
+	// Restoring cached depth copies it exactly - no culling or bias
+	D3D11_RASTERIZER_DESC restoreRastDesc = {};
+	restoreRastDesc.FillMode = D3D11_FILL_SOLID;
+	restoreRastDesc.CullMode = D3D11_CULL_NONE;
+	restoreRastDesc.DepthClipEnable = true;
+	restoreRastDesc.ScissorEnable = true;
+	device->CreateRasterizerState(&restoreRastDesc, &shadowRestoreRasterizer);
+
+	D3D11_DEPTH_STENCIL_DESC restoreDepthDesc = {};
+	restoreDepthDesc.DepthEnable = true;
+	restoreDepthDesc.DepthFunc = D3D11_COMPARISON_ALWAYS;
+	restoreDepthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+	device->CreateDepthStencilState(&restoreDepthDesc, &shadowRestoreDepthState);
+
 	// Create a shadow sampler
 	D3D11_SAMPLER_DESC shadowSampDesc = {};
 	shadowSampDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR;
@@ -201,21 +291,6 @@ void Game::Init()
 	shadowSampDesc.BorderColor[0] = 1.0f; // Only need the first component
 	device->CreateSamplerState(&shadowSampDesc, &shadowSampler);
 	
-	// Light view matrix
-	XMMATRIX lightView = XMMatrixLookToLH(
-		-XMVectorSet(-0.5f, -0.5f, 0.5f, 0) * 20, // Position: "Backing up" 20 units from origin
-		XMVectorSet(-0.5f, -0.5f, 0.5f, 0), // Direction: light's direction
-		XMVectorSet(0, 1, 0, 0)); // Up: World up vector (Y axis)
-	XMStoreFloat4x4(&lightViewMatrix, lightView);
-
-	// Light projection matrix
-	XMMATRIX lightProjection = XMMatrixOrthographicLH(
-		lightProjectionSize,
-		lightProjectionSize,
-		1.0f,
-		100.0f);
-	XMStoreFloat4x4(&lightProjectionMatrix, lightProjection);
-
 	// Sampler state for post processing
 	D3D11_SAMPLER_DESC ppSampDesc = {};
 	ppSampDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
@@ -225,39 +300,40 @@ void Game::Init()
 	ppSampDesc.MaxLOD = D3D11_FLOAT32_MAX;
 	device->CreateSamplerState(&ppSampDesc, ppSampler.GetAddressOf());
 
-	// Blur Render Target Creation
-	D3D11_TEXTURE2D_DESC textureDesc = {};
-	textureDesc.Width = windowWidth;
-	textureDesc.Height = windowHeight;
-	textureDesc.ArraySize = 1;
-	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	textureDesc.CPUAccessFlags = 0;
-	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	textureDesc.MipLevels = 1;
-	textureDesc.MiscFlags = 0;
-	textureDesc.SampleDesc.Count = 1;
-	textureDesc.SampleDesc.Quality = 0;
-	textureDesc.Usage = D3D11_USAGE_DEFAULT;
-
-	// Create the resource (no need to track it after views created)
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> ppBlurTexture;
-	device->CreateTexture2D(&textureDesc, 0, ppBlurTexture.GetAddressOf());
-
-	// Create the render target view
-	D3D11_RENDER_TARGET_VIEW_DESC rtvBlurDesc = {};
-	rtvBlurDesc.Format = textureDesc.Format;
-	rtvBlurDesc.Texture2D.MipSlice = 0;
-	rtvBlurDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	device->CreateRenderTargetView(
-		ppBlurTexture.Get(),
-		&rtvBlurDesc,
-		ppBlurRTV.ReleaseAndGetAddressOf());
-	device->CreateShaderResourceView(
-		ppBlurTexture.Get(),
-		0,
-		ppBlurSRV.ReleaseAndGetAddressOf());
+	// Post process targets are transients in the frame's render graph,
+	// borrowed from a pool that keeps them across frames & resizes
+	renderGraphDevice = std::make_shared<D3D11RenderGraphDevice>(rhiDevice, context);
+	renderTargetPool = std::make_shared<RenderTargetPool>(renderGraphDevice);
+
+	// Draws are recorded as jobs
+	commandBackend = std::make_shared<D3D11CommandBackend>(device, context);
+	commandRecorder = std::make_shared<CommandRecorder>(commandBackend, jobSystem);
+	parallelRecording = true;
+	sceneChunkSize = 4;
 
 	blurRadius = 20;
+	blurTapRadius = -1;
+	blurTapLevel = -1;
+	blurTapCount = 0;
+	blurTapBuffer = std::make_shared<DynamicStructuredBuffer>(device, context);
+
+	// Bloom's upsample adds each level onto the one above
+	D3D11_BLEND_DESC blendDesc = {};
+	blendDesc.RenderTarget[0].BlendEnable = true;
+	blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
+	blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_ONE;
+	blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+	blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ONE;
+	blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	device->CreateBlendState(&blendDesc, additiveBlendState.GetAddressOf());
+
+	postEffect = POST_EFFECT_BLUR;
+	bloomThreshold = 0.8f;
+	bloomKnee = 0.2f;
+	bloomIntensity = 0.3f;
+	return S_OK;
 }
 
 // --------------------------------------------------------
@@ -274,29 +350,110 @@ void Game::LoadShaders()
 	pixelShader = std::make_shared<SimplePixelShader>(device, context, FixPath(L"PixelShader.cso").c_str());
 	patternShader = std::make_shared<SimplePixelShader>(device, context, FixPath(L"PatternPS.cso").c_str());
 	normalShader = std::make_shared<SimplePixelShader>(device, context, FixPath(L"NormalPS.cso").c_str());
+
+	// Lit materials pick permutations of the uber shader, falling
+	// back to the full-featured NormalPS if one fails to build
+	shaderPermutations = std::make_shared<ShaderPermutations>(
+		device,
+		context,
+		FixPath(L"../../UberPS.hlsli"),
+		FixPath(L"UberPS"),
+		normalShader);
 	ppVS = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"PostVS.cso").c_str());
 	ppBlurPS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"PostBlurPS.cso").c_str());
+	ppBlurTapCountHandle = ppBlurPS->GetVariableHandle("tapCount");
+	ppBlurPixelStepHandle = ppBlurPS->GetVariableHandle("pixelStep");
+	ppDownsamplePS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"PostDownsamplePS.cso").c_str());
+	ppDownsamplePixelSizeHandle = ppDownsamplePS->GetVariableHandle("sourcePixelSize");
+	ppDownsampleApplyThresholdHandle = ppDownsamplePS->GetVariableHandle("applyThreshold");
+	ppDownsampleThresholdHandle = ppDownsamplePS->GetVariableHandle("threshold");
+	ppDownsampleKneeHandle = ppDownsamplePS->GetVariableHandle("knee");
+	ppUpsamplePS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"PostUpsamplePS.cso").c_str());
+	ppUpsamplePixelSizeHandle = ppUpsamplePS->GetVariableHandle("sourcePixelSize");
+	ppUpsampleIntensityHandle = ppUpsamplePS->GetVariableHandle("intensity");
+	ppCompositePS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"PostCompositePS.cso").c_str());
+	ppCompositeBloomPixelSizeHandle = ppCompositePS->GetVariableHandle("bloomPixelSize");
+	ppCompositeBloomIntensityHandle = ppCompositePS->GetVariableHandle("bloomIntensity");
+
+	// Tiled deferred shaders
+	gBufferPS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"GBufferPS.cso").c_str());
+	deferredLightingPS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"DeferredLightingPS.cso").c_str());
 
 	// Shadow maps
 	shadowVS = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"ShadowVS.cso").c_str());
+	shadowWorldHandle = shadowVS->GetVariableHandle("world");
+	shadowViewHandle = shadowVS->GetVariableHandle("view");
+	shadowProjectionHandle = shadowVS->GetVariableHandle("projection");
+	shadowRestorePS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"ShadowRestorePS.cso").c_str());
+	shadowRestoreSliceHandle = shadowRestorePS->GetVariableHandle("slice");
 
 	// Sky shaders
 	skyBoxVS = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"SkyBoxVS.cso").c_str());
 	skyBoxPS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"SkyBoxPS.cso").c_str());
+
+	// Per-draw constants go through one shared ring buffer when the
+	// device supports it (shaders fall back to their own buffers if not)
+	constantBufferRing = std::make_shared<ConstantBufferRing>(device, context, 4 * 1024 * 1024);
+	if (constantBufferRing->IsSupported())
+	{
+		vertexShader->SetConstantBufferRing(constantBufferRing);
+		pixelShader->SetConstantBufferRing(constantBufferRing);
+		patternShader->SetConstantBufferRing(constantBufferRing);
+		normalShader->SetConstantBufferRing(constantBufferRing);
+		shaderPermutations->SetConstantBufferRing(constantBufferRing);
+		ppVS->SetConstantBufferRing(constantBufferRing);
+		ppBlurPS->SetConstantBufferRing(constantBufferRing);
+		ppDownsamplePS->SetConstantBufferRing(constantBufferRing);
+		ppUpsamplePS->SetConstantBufferRing(constantBufferRing);
+		ppCompositePS->SetConstantBufferRing(constantBufferRing);
+		gBufferPS->SetConstantBufferRing(constantBufferRing);
+		deferredLightingPS->SetConstantBufferRing(constantBufferRing);
+		shadowVS->SetConstantBufferRing(constantBufferRing);
+		shadowRestorePS->SetConstantBufferRing(constantBufferRing);
+		skyBoxVS->SetConstantBufferRing(constantBufferRing);
+		skyBoxPS->SetConstantBufferRing(constantBufferRing);
+
+		// Worker threads can't map the immediate context's ring,
+		// so each deferred context gets a smaller one of its own
+		commandBackend->SetConstantBufferRingSize(1 * 1024 * 1024);
+	}
+
+	// Per-cluster light lists for the clustered uber shader permutations
+	clusteredLighting = std::make_shared<ClusteredLighting>(device, context, jobSystem);
+
+	// The deferred path shares the post process fullscreen triangle
+	tiledDeferred = std::make_shared<TiledDeferredRenderer>(device, context, gBufferPS, ppVS, deferredLightingPS);
+	tiledDeferred->Resize(windowWidth, windowHeight);
 }
 
 // --------------------------------------------------------
-// Creates the geometry we're going to draw - a single triangle for now
+// Loads the scene - meshes, textures, materials, the sky,
+// entities, lights and cameras - from its file.  Returns
+// false if the file's missing or broken (a loaded scene
+// always has a camera and a light).
 // --------------------------------------------------------
-void Game::CreateGeometry()
+bool Game::LoadScene(const std::wstring& path)
 {
-	// Create meshes
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/sphere.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/cube.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/helix.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/cylinder.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/torus.obj").c_str(), device, context));
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/quad.obj").c_str(), device, context));
+	// The file is mapped, not parsed, and only lives as long
+	// as loading does
+	SceneFile scene;
+	if (!scene.Load(WideToNarrow(path)))
+	{
+		printf("Couldn't load the scene: %s\n", scene.GetError().c_str());
+		return false;
+	}
+	const SceneFileHeader& header = scene.GetHeader();
+
+	// Create meshes - each is parsed as a job (Direct3D devices are
+	// thread safe), while the textures below load on this thread.
+	// They're moved into the pool after, as it isn't thread safe.
+	JobCounter meshesLoaded;
+	std::vector<std::optional<Mesh>> loadedMeshes(header.Meshes.Count);
+	for (uint32_t i = 0; i < header.Meshes.Count; i++)
+	{
+		std::wstring meshPath = FixPath(L"../../Assets/" + NarrowToWide(scene.GetString(header.Meshes[i].Path)));
+		jobSystem->Run([this, &loadedMeshes, i, meshPath](uint32_t thread) { loadedMeshes[i].emplace(meshPath, rhiDevice); }, &meshesLoaded);
+	}
 
 	// Creating the textures
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler;
@@ -309,247 +466,772 @@ void Game::CreateGeometry()
 	sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
 	device->CreateSamplerState(&sampDesc, sampler.GetAddressOf());
 
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedRoughSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedMetalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchedNormalSRV;
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorRoughSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorMetalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> floorNormalSRV;
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeRoughSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeMetalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> bronzeNormalSRV;
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneRoughSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneMetalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneNormalSRV;
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> paintSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> paintRoughSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> paintMetalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> paintNormalSRV;
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodRoughSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodMetalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodNormalSRV;
-
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/scratched_albedo.png").c_str(), 0, scratchedSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/scratched_roughness.png").c_str(), 0, scratchedRoughSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/scratched_metal.png").c_str(), 0, scratchedMetalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/scratched_normals.png").c_str(), 0, scratchedNormalSRV.GetAddressOf());
-
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/floor_albedo.png").c_str(), 0, floorSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/floor_roughness.png").c_str(), 0, floorRoughSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/floor_metalness.png").c_str(), 0, floorMetalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/floor_normals.png").c_str(), 0, floorNormalSRV.GetAddressOf());
-
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/bronze_albedo.png").c_str(), 0, bronzeSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/bronze_roughness.png").c_str(), 0, bronzeRoughSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/bronze_metal.png").c_str(), 0, bronzeMetalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/bronze_normals.png").c_str(), 0, bronzeNormalSRV.GetAddressOf());
-
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/cobblestone_albedo.png").c_str(), 0, cobblestoneSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/cobblestone_roughness.png").c_str(), 0, cobblestoneRoughSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/cobblestone_metal.png").c_str(), 0, cobblestoneMetalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/cobblestone_normals.png").c_str(), 0, cobblestoneNormalSRV.GetAddressOf());
-
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/paint_albedo.png").c_str(), 0, paintSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/paint_roughness.png").c_str(), 0, paintRoughSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/paint_metal.png").c_str(), 0, paintMetalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/paint_normals.png").c_str(), 0, paintNormalSRV.GetAddressOf());
-
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/wood_albedo.png").c_str(), 0, woodSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/wood_roughness.png").c_str(), 0, woodRoughSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/wood_metal.png").c_str(), 0, woodMetalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/wood_normals.png").c_str(), 0, woodNormalSRV.GetAddressOf());
+	std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textureSRVs(header.Textures.Count);
+	for (uint32_t i = 0; i < header.Textures.Count; i++)
+	{
+		std::wstring texturePath = FixPath(L"../../Assets/" + NarrowToWide(scene.GetString(header.Textures[i].Path)));
+		CreateWICTextureFromFile(device.Get(), context.Get(), texturePath.c_str(), 0, textureSRVs[i].GetAddressOf());
+	}
+
+	// The sky and entities need the meshes
+	jobSystem->Wait(meshesLoaded);
+	for (std::optional<Mesh>& mesh : loadedMeshes)
+		sceneMeshes.push_back(meshes.Create(std::move(*mesh)));
 
 	// Creating the SkyBox
-	skyBox = std::make_shared<Sky>(
-		FixPath(L"../../Assets/Skies/CloudsPink/right.png").c_str(),
-		FixPath(L"../../Assets/Skies/CloudsPink/left.png").c_str(),
-		FixPath(L"../../Assets/Skies/CloudsPink/up.png").c_str(),
-		FixPath(L"../../Assets/Skies/CloudsPink/down.png").c_str(),
-		FixPath(L"../../Assets/Skies/CloudsPink/front.png").c_str(),
-		FixPath(L"../../Assets/Skies/CloudsPink/back.png").c_str(),
-		sampler,
-		meshes[1],
-		skyBoxVS,
-		skyBoxPS,
-		context,
-		device);
+	if (header.Skies.Count > 0)
+	{
+		const SceneFileSky& sky = header.Skies[0];
+		std::wstring faces[6];
+		for (int face = 0; face < 6; face++)
+			faces[face] = FixPath(L"../../Assets/" + NarrowToWide(scene.GetString(sky.Faces[face])));
+
+		skyBox = std::make_shared<Sky>(
+			faces[0].c_str(),
+			faces[1].c_str(),
+			faces[2].c_str(),
+			faces[3].c_str(),
+			faces[4].c_str(),
+			faces[5].c_str(),
+			sampler,
+			meshes.Get(sceneMeshes[sky.Mesh]),
+			skyBoxVS,
+			skyBoxPS,
+			context,
+			device,
+			rhiDevice);
+	}
 
 	// Creating the materials
-	std::shared_ptr<Material> mat1 = std::make_shared<Material>(XMFLOAT3(1.0f, 1.0f, 1.0f), vertexShader, normalShader, 0.95f);
-	std::shared_ptr<Material> mat2 = std::make_shared<Material>(XMFLOAT3(1.0f, 1.0f, 1.0f), vertexShader, normalShader, 0.95f);
-	std::shared_ptr<Material> mat3 = std::make_shared<Material>(XMFLOAT3(1.0f, 1.0f, 1.0f), vertexShader, normalShader, 0.95f);
-	std::shared_ptr<Material> mat4 = std::make_shared<Material>(XMFLOAT3(1.0f, 1.0f, 1.0f), vertexShader, normalShader, 0.95f);
-	std::shared_ptr<Material> mat5 = std::make_shared<Material>(XMFLOAT3(1.0f, 1.0f, 1.0f), vertexShader, normalShader, 0.95f);
-	std::shared_ptr<Material> mat6 = std::make_shared<Material>(XMFLOAT3(1.0f, 1.0f, 1.0f), vertexShader, normalShader, 0.95f);
-
-	mat1->AddSampler("BasicSampler", sampler);
-	mat1->AddTextureSRV("Albedo", scratchedSRV);
-	mat1->AddTextureSRV("RoughnessMap", scratchedRoughSRV);
-	mat1->AddTextureSRV("MetalnessMap", scratchedMetalSRV);
-	mat1->AddTextureSRV("NormalMap", scratchedNormalSRV);
-
-	mat2->AddSampler("BasicSampler", sampler);
-	mat2->AddTextureSRV("Albedo", floorSRV);
-	mat2->AddTextureSRV("RoughnessMap", floorRoughSRV);
-	mat2->AddTextureSRV("MetalnessMap", floorMetalSRV);
-	mat2->AddTextureSRV("NormalMap", floorNormalSRV);
-
-	mat3->AddSampler("BasicSampler", sampler);
-	mat3->AddTextureSRV("Albedo", bronzeSRV);
-	mat3->AddTextureSRV("RoughnessMap", bronzeRoughSRV);
-	mat3->AddTextureSRV("MetalnessMap", bronzeMetalSRV);
-	mat3->AddTextureSRV("NormalMap", bronzeNormalSRV);
-
-	mat4->AddSampler("BasicSampler", sampler);
-	mat4->AddTextureSRV("Albedo", cobblestoneSRV);
-	mat4->AddTextureSRV("RoughnessMap", cobblestoneRoughSRV);
-	mat4->AddTextureSRV("MetalnessMap", cobblestoneMetalSRV);
-	mat4->AddTextureSRV("NormalMap", cobblestoneNormalSRV);
-
-	mat5->AddSampler("BasicSampler", sampler);
-	mat5->AddTextureSRV("Albedo", paintSRV);
-	mat5->AddTextureSRV("RoughnessMap", paintRoughSRV);
-	mat5->AddTextureSRV("MetalnessMap", paintMetalSRV);
-	mat5->AddTextureSRV("NormalMap", paintNormalSRV); 
-
-	mat6->AddSampler("BasicSampler", sampler);
-	mat6->AddTextureSRV("Albedo", woodSRV);
-	mat6->AddTextureSRV("RoughnessMap", woodRoughSRV);
-	mat6->AddTextureSRV("MetalnessMap", woodMetalSRV);
-	mat6->AddTextureSRV("NormalMap", woodNormalSRV);
-
-	materials.push_back(mat1);
-	materials.push_back(mat2);
-	materials.push_back(mat3);
-	materials.push_back(mat4);
-	materials.push_back(mat5);
-	materials.push_back(mat6);
-
-	// Create entities and initial positions 
-	entities.push_back(std::make_shared<GameEntity>(meshes[0], materials[0]));
-	entities.push_back(std::make_shared<GameEntity>(meshes[1], materials[1]));
-	entities.push_back(std::make_shared<GameEntity>(meshes[2], materials[2]));
-	entities.push_back(std::make_shared<GameEntity>(meshes[3], materials[3]));
-	entities.push_back(std::make_shared<GameEntity>(meshes[4], materials[4]));
-	entities.push_back(std::make_shared<GameEntity>(meshes[5], materials[5]));
-
-	// Adjust scale of the floor
-	entities[5]->GetTransform().MoveAbsolute(0, -10, 0);
-	entities[5]->GetTransform().SetScale(50.0f, 1.0f, 50.0f);
-
-	// Adjust initial positions
-	entities[0]->GetTransform().MoveAbsolute(-6, 0, 0);
-	entities[1]->GetTransform().MoveAbsolute(-3, 0, 0);
-	entities[2]->GetTransform().MoveAbsolute(0, 0, 0);
-	entities[3]->GetTransform().MoveAbsolute(3, 0, 0);
-	entities[4]->GetTransform().MoveAbsolute(6, 0, 0);
-
-	// Create the lights
-	Light pointLight1 = {};
-	pointLight1.Color = XMFLOAT3(1.0f, 1.0f, 1.0f);
-	pointLight1.Type = LIGHT_TYPE_POINT;
-	pointLight1.Intensity = 1.0f;
-	pointLight1.Position = XMFLOAT3(-6.0f, 5.0f, -5.0f);
-	pointLight1.Range = 10.0f;
-
-	Light pointLight2 = {};
-	pointLight2.Color = XMFLOAT3(1.0f, 1.0f, 1.0f);
-	pointLight2.Type = LIGHT_TYPE_POINT;
-	pointLight2.Intensity = 1.0f;
-	pointLight2.Position = XMFLOAT3(-3.0f, 5.0f, 5.0f);
-	pointLight2.Range = 10.0f;
-
-	Light dirLight3 = {};
-	dirLight3.Color = XMFLOAT3(1.0f, 1.0f, 1.0f);
-	dirLight3.Type = LIGHT_TYPE_DIRECTIONAL;
-	dirLight3.Intensity = 0.4f;
-	dirLight3.Direction = XMFLOAT3(0.0f, -0.5f, -0.5f);
-
-	Light pointLight4 = {};
-	pointLight4.Color = XMFLOAT3(1.0f, 1.0f, 1.0f);
-	pointLight4.Type = LIGHT_TYPE_POINT;
-	pointLight4.Intensity = 1.0f;
-	pointLight4.Position = XMFLOAT3(3.0f, 5.0f, 5.0f);
-	pointLight4.Range = 10.0f;
-
-	Light pointLight5 = {};
-	pointLight5.Color = XMFLOAT3(1.0f, 1.0f, 1.0f);
-	pointLight5.Type = LIGHT_TYPE_POINT;
-	pointLight5.Intensity = 1.0f;
-	pointLight5.Position = XMFLOAT3(6.0f, 5.0f, -5.0f);
-	pointLight5.Range = 10.0f;
-
-	Light sunLight = {};
-	sunLight.Color = XMFLOAT3(1.0f, 1.0f, 1.0f);
-	sunLight.Type = LIGHT_TYPE_DIRECTIONAL;
-	sunLight.Intensity = 1.0f;
-	sunLight.Direction = XMFLOAT3(-0.5f, -0.5f, 0.5f);
-
-	// Add all lights to the 
-	lights.push_back(pointLight1);
-	lights.push_back(pointLight2);
-	lights.push_back(dirLight3);
-	lights.push_back(pointLight4);
-	lights.push_back(pointLight5);
-	lights.push_back(sunLight);
+	//  - The light count is filled in once the lights exist
+	//  - Slots without a texture take their features away
+	ShaderFeatureSet litFeatures(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_SHADOWS | SHADER_FEATURE_PBR, 0);
+	const char* textureNames[SCENE_FILE_TEXTURE_SLOTS] = { "Albedo", "RoughnessMap", "MetalnessMap", "NormalMap" };
+	for (uint32_t i = 0; i < header.Materials.Count; i++)
+	{
+		const SceneFileMaterial& fileMaterial = header.Materials[i];
+		sceneMaterials.push_back(materials.Create(fileMaterial.ColorTint, vertexShader, shaderPermutations, litFeatures, fileMaterial.Roughness));
+
+		Material* material = materials.Get(sceneMaterials.back());
+		material->AddSampler("BasicSampler", sampler);
+		for (uint32_t slot = 0; slot < SCENE_FILE_TEXTURE_SLOTS; slot++)
+		{
+			if (fileMaterial.Textures[slot] != SCENE_FILE_NONE)
+				material->AddTextureSRV(textureNames[slot], textureSRVs[fileMaterial.Textures[slot]]);
+		}
+	}
+
+	// Create the entities, unless they're split into cells -
+	// then they're streamed in around the camera as it moves,
+	// each costing its components in the world
+	if (header.Cells.Count == 0)
+	{
+		for (uint32_t i = 0; i < header.Entities.Count; i++)
+			entityHandles.push_back(CreateSceneEntity(header.Entities[i]));
+	}
+	else
+	{
+		worldStreamer = std::make_shared<WorldStreamer>(jobSystem);
+		worldStreamer->GetConfig().ResidentBytesPerEntity = sizeof(GameEntity) + sizeof(PreviousTransform) + sizeof(EntityMotion);
+		if (!worldStreamer->Open(WideToNarrow(path), [this](SceneWorld&, const SceneFileEntity& fileEntity) { return CreateSceneEntity(fileEntity); }))
+		{
+			printf("Couldn't stream the scene: %s\n", worldStreamer->GetError().c_str());
+			return false;
+		}
+	}
+
+	// Create the lights (in the scene's order, so the sun stays last)
+	for (uint32_t i = 0; i < header.Lights.Count; i++)
+		lightHandles.push_back(world.Create(header.Lights[i]));
+
+	// Create the cameras, with the first one active
+	for (uint32_t i = 0; i < header.Cameras.Count; i++)
+	{
+		const SceneFileCamera& fileCamera = header.Cameras[i];
+		SceneEntity camera = world.Create(Camera(
+			fileCamera.Position,
+			fileCamera.MoveSpeed,
+			fileCamera.LookSpeed,
+			fileCamera.FieldOfView,
+			(float)windowWidth / windowHeight,	// Aspect ratio
+			fileCamera.NearClip,
+			fileCamera.FarClip));
+
+		world.Get<Camera>(camera)->GetTransform().SetRotation(fileCamera.PitchYawRoll);
+		cameraHandles.push_back(camera);
+	}
+	activeCamera = cameraHandles[0];
+
+	UpdateLightingFeatures(useClusteredLighting || lightHandles.size() > SHADER_MAX_LIGHTS, (unsigned int)lightHandles.size());
+	return true;
+}
+
+// --------------------------------------------------------
+// Creates an entity where the scene puts it.  Static ones
+// never move, so their shadows are cached, and the rest
+// spin and bob if the scene says they do.
+// --------------------------------------------------------
+SceneEntity Game::CreateSceneEntity(const SceneFileEntity& fileEntity)
+{
+	GameEntity entity(sceneMeshes[fileEntity.Mesh], sceneMaterials[fileEntity.Material]);
+	entity.GetTransform().SetPosition(fileEntity.Position);
+	entity.GetTransform().SetRotation(fileEntity.PitchYawRoll);
+	entity.GetTransform().SetScale(fileEntity.Scale);
+
+	bool moves = fileEntity.SpinSpeed != 0.0f || fileEntity.Bob.x != 0.0f || fileEntity.Bob.y != 0.0f || fileEntity.Bob.z != 0.0f;
+	if (fileEntity.Flags & SCENE_FILE_ENTITY_STATIC)
+	{
+		entity.SetStatic(true);
+		return world.Create(entity, PreviousTransform{ entity.GetTransform() });
+	}
+	if (!moves)
+		return world.Create(entity, PreviousTransform{ entity.GetTransform() });
+	return world.Create(entity, PreviousTransform{ entity.GetTransform() }, EntityMotion{ fileEntity.SpinSpeed, fileEntity.Bob, fileEntity.Position });
 }
 
-void Game::ResizeAllPostProcessResources()
+// --------------------------------------------------------
+// Switches the lit materials between clustered lighting and
+// a fixed light array with one slot per light
+// --------------------------------------------------------
+void Game::UpdateLightingFeatures(bool clustered, unsigned int lightCount)
 {
-	ResizeOnePostProcessResource(ppBlurRTV, ppBlurSRV, 1.0f, DXGI_FORMAT_R8G8B8A8_UNORM);
+	materials.ForEach([&](MaterialHandle handle, Material& m) {
+		ShaderFeatureSet features = m.GetFeatures();
+		uint32_t flags = clustered ?
+			features.Flags | SHADER_FEATURE_CLUSTERED :
+			features.Flags & ~SHADER_FEATURE_CLUSTERED;
+
+		m.SetFeatures(ShaderFeatureSet(flags, lightCount));
+	});
+	clusteredMaterials = clustered;
 }
 
-void Game::ResizeOnePostProcessResource(
-		Microsoft::WRL::ComPtr<ID3D11RenderTargetView>& rtv, 
-		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv, 
-		float renderTargetScale, 
-		DXGI_FORMAT format)
+// --------------------------------------------------------
+// Draws depth only for some of the entities (indices into
+// the frame's entity draws) into whatever depth buffer is bound
+// --------------------------------------------------------
+void Game::DrawShadowCasters(ID3D11DeviceContext* drawContext, const uint32_t* casterIndices, size_t casterCount, const XMFLOAT4X4& view, const XMFLOAT4X4& projection)
 {
-	// Reset resources
-	rtv.Reset();
-	srv.Reset();
-
-	// Blur Render Target Creation
-	D3D11_TEXTURE2D_DESC textureDesc = {};
-	textureDesc.Width = (int)(windowWidth * renderTargetScale);
-	textureDesc.Height = (int)(windowHeight * renderTargetScale);
-	textureDesc.ArraySize = 1;
-	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	textureDesc.CPUAccessFlags = 0;
-	textureDesc.Format = format;
-	textureDesc.MipLevels = 1;
-	textureDesc.MiscFlags = 0;
-	textureDesc.SampleDesc.Count = 1;
-	textureDesc.SampleDesc.Quality = 0;
-	textureDesc.Usage = D3D11_USAGE_DEFAULT;
-
-	// Create the resource (no need to track it after views created)
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> ppTexture;
-	device->CreateTexture2D(&textureDesc, 0, ppTexture.GetAddressOf());
-
-	// Create the render target view and shader resourve view
-	D3D11_RENDER_TARGET_VIEW_DESC rtvDesc = {};
-	rtvDesc.Format = textureDesc.Format;
-	rtvDesc.Texture2D.MipSlice = 0;
-	rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	device->CreateRenderTargetView(
-		ppTexture.Get(),
-		&rtvDesc,
-		rtv.ReleaseAndGetAddressOf());
-	device->CreateShaderResourceView(
-		ppTexture.Get(),
-		0,
-		srv.ReleaseAndGetAddressOf());
+	if (casterCount == 0)
+		return;
+
+	// Depth only, so no pixel shader
+	shadowVS->SetShader(drawContext);
+	drawContext->PSSetShader(0, 0, 0);
+	shadowVS->SetMatrix4x4(shadowViewHandle, view);
+	shadowVS->SetMatrix4x4(shadowProjectionHandle, projection);
+
+	D3D11RHIContext rhiContext(drawContext);
+	for (size_t i = 0; i < casterCount; i++)
+	{
+		const EntityDraw& draw = entityDraws[casterIndices[i]];
+		shadowVS->SetMatrix4x4(shadowWorldHandle, draw.Entity->GetTransform().GetWorldMatrix());
+		shadowVS->CopyAllBufferData(drawContext);
+
+		// Draw the mesh directly to avoid the entity's material
+		draw.EntityMesh->Draw(&rhiContext);
+	}
+}
+
+// --------------------------------------------------------
+// Draws the work the shadow cache found for each cascade:
+// the static casters when they're stale, then the cached
+// static depth and the dynamic casters in each dirty region.
+// Each cascade is recorded as its own chunk.
+// --------------------------------------------------------
+void Game::RenderShadowCascades()
+{
+	commandRecorder->SetParallel(frames.GetRead().ParallelRecording);
+	for (unsigned int c = 0; c < shadowCache.GetSliceCount(); c++)
+	{
+		const ShadowCacheSliceWork& work = shadowCache.GetWork(c);
+		if (work.RebuildStatic)
+			renderStats.ShadowCasterCounts[c] += (unsigned int)work.StaticCasters.size();
+		for (const ShadowCacheRegion& region : work.Regions)
+			renderStats.ShadowCasterCounts[c] += (unsigned int)region.Casters.size();
+		renderStats.ShadowRegionCounts[c] = (unsigned int)work.Regions.size();
+
+		commandRecorder->Add([=, this](CommandContext& recordContext) {
+			RenderShadowCascade(D3D11CommandBackend::GetContext(recordContext), c);
+		});
+	}
+	commandRecorder->Run();
+
+	// Unbind the static cache so it can be drawn to next time
+	ID3D11ShaderResourceView* nullSRV{};
+	context->PSSetShaderResources(0, 1, &nullSRV);
+
+	// Reset the pipeline
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = (float)this->windowWidth;
+	viewport.Height = (float)this->windowHeight;
+	viewport.MaxDepth = 1.0f;
+	context->RSSetViewports(1, &viewport);
+	context->RSSetState(0);
+}
+
+// --------------------------------------------------------
+// Records one cascade's shadow work, setting all the state
+// it needs (a deferred context starts with none)
+// --------------------------------------------------------
+void Game::RenderShadowCascade(ID3D11DeviceContext* drawContext, unsigned int cascade)
+{
+	const ShadowCacheSliceWork& work = shadowCache.GetWork(cascade);
+	const ShadowCascade& cascadeInfo = shadowCascades.GetCascade(cascade);
+	XMFLOAT4X4 cascadeView;
+	XMFLOAT4X4 cascadeProjection;
+	memcpy(&cascadeView, cascadeInfo.View, sizeof(XMFLOAT4X4));
+	memcpy(&cascadeProjection, cascadeInfo.Projection, sizeof(XMFLOAT4X4));
+
+	drawContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	drawContext->RSSetState(shadowRasterizer.Get());
+
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = (float)shadowMapResolution;
+	viewport.Height = (float)shadowMapResolution;
+	viewport.MaxDepth = 1.0f;
+	drawContext->RSSetViewports(1, &viewport);
+
+	D3D11_RECT fullScissor = { 0, 0, (LONG)shadowMapResolution, (LONG)shadowMapResolution };
+	ID3D11RenderTargetView* nullRTV{};
+
+	// Static casters go into the cache only when it's stale
+	if (work.RebuildStatic)
+	{
+		drawContext->ClearDepthStencilView(staticShadowDSVs[cascade].Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+		drawContext->OMSetRenderTargets(1, &nullRTV, staticShadowDSVs[cascade].Get());
+		drawContext->RSSetScissorRects(1, &fullScissor);
+		DrawShadowCasters(drawContext, work.StaticCasters.data(), work.StaticCasters.size(), cascadeView, cascadeProjection);
+	}
+
+	// Each dirty region gets the cached static depth back,
+	// then the dynamic casters that touch it on top
+	drawContext->OMSetRenderTargets(1, &nullRTV, shadowDSVs[cascade].Get());
+	for (const ShadowCacheRegion& region : work.Regions)
+	{
+		D3D11_RECT scissor = { (LONG)region.Rect.MinX, (LONG)region.Rect.MinY, (LONG)region.Rect.MaxX, (LONG)region.Rect.MaxY };
+		drawContext->RSSetScissorRects(1, &scissor);
+
+		drawContext->RSSetState(shadowRestoreRasterizer.Get());
+		drawContext->OMSetDepthStencilState(shadowRestoreDepthState.Get(), 0);
+		ppVS->SetShader(drawContext);
+		shadowRestorePS->SetShader(drawContext);
+		shadowRestorePS->SetShaderResourceView("StaticShadowMap", staticShadowSRV.Get(), drawContext);
+		shadowRestorePS->SetInt(shadowRestoreSliceHandle, cascade);
+		shadowRestorePS->CopyAllBufferData(drawContext);
+		drawContext->Draw(3, 0);
+
+		drawContext->RSSetState(shadowRasterizer.Get());
+		drawContext->OMSetDepthStencilState(0, 0);
+		DrawShadowCasters(drawContext, region.Casters.data(), region.Casters.size(), cascadeView, cascadeProjection);
+	}
+
+	// Don't leave the static cache bound for the next cascade's
+	// static pass (which draws into the same array)
+	ID3D11ShaderResourceView* nullSRV{};
+	drawContext->PSSetShaderResources(0, 1, &nullSRV);
+}
+
+// --------------------------------------------------------
+// Packs the point & spot light shadows into the atlas and
+// redraws only the visible ones that are out of date
+// --------------------------------------------------------
+void Game::RenderShadowAtlas(const ShadowCascadeCamera& cascadeCamera)
+{
+	// This frame's lists go in the frame arena (this runs on
+	// the thread running Draw)
+	LinearArena& arena = frameArena->Get(jobSystem->GetThreadIndex());
+
+	// Which entities moved since last frame (shadowCasters
+	// was filled in by the cascade pass)
+	FrameVector<bool> casterMoved(shadowCasters.size(), false, &arena);
+	for (size_t i = 0; i < shadowCasters.size(); i++)
+	{
+		casterMoved[i] = i >= shadowAtlasPreviousCasters.size() ||
+			memcmp(shadowCasters[i].World, shadowAtlasPreviousCasters[i].World, sizeof(float) * 16) != 0;
+	}
+	shadowAtlasPreviousCasters = shadowCasters;
+
+	// Every point & spot light casts shadows (the directional
+	// lights are handled by the cascades)
+	const std::vector<Light>& lights = frames.GetRead().Lights;
+	shadowAtlasLights.clear();
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		const Light& light = lights[i];
+		if (light.Type != LIGHT_TYPE_POINT && light.Type != LIGHT_TYPE_SPOT)
+			continue;
+
+		ShadowAtlasLight atlasLight;
+		atlasLight.Id = (uint32_t)i;
+		atlasLight.Point = light.Type == LIGHT_TYPE_POINT;
+		memcpy(atlasLight.Position, &light.Position, sizeof(float) * 3);
+		atlasLight.Range = light.Range;
+		if (!atlasLight.Point)
+		{
+			// The cone ends where pow(cos, falloff) gets too dim to see
+			memcpy(atlasLight.Direction, &light.Direction, sizeof(float) * 3);
+			float cosCutoff = light.SpotFalloff > 0.0f ? powf(1.0f / 256.0f, 1.0f / light.SpotFalloff) : 0.0f;
+			atlasLight.SpotAngle = 2.0f * acosf(cosCutoff);
+		}
+
+		// Only dynamic casters within range can change its shadow
+		for (size_t e = 0; e < shadowCasters.size(); e++)
+		{
+			const ShadowCaster& caster = shadowCasters[e];
+			if (!casterMoved[e])
+				continue;
+
+			XMVECTOR offset = XMLoadFloat3((const XMFLOAT3*)caster.Center) - XMLoadFloat3(&light.Position);
+			if (XMVectorGetX(XMVector3Length(offset)) <= light.Range + caster.Radius)
+			{
+				atlasLight.CastersChanged = true;
+				break;
+			}
+		}
+
+		shadowAtlasLights.push_back(atlasLight);
+	}
+
+	shadowAtlas.Update(shadowAtlasConfig, cascadeCamera, shadowAtlasLights.data(), (uint32_t)shadowAtlasLights.size());
+
+	// Cube faces, in the order the shaders expect: +X, -X, +Y, -Y, +Z, -Z
+	static const XMFLOAT3 faceForward[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+	static const XMFLOAT3 faceUp[6] = { { 0, 1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 }, { 0, 1, 0 }, { 0, 1, 0 } };
+
+	// Shader data for every light with a tile, and the render
+	// list for the ones that need redrawing
+	struct FaceRender
+	{
+		ShadowAtlasTile Tile;
+		XMFLOAT4X4 View;
+		XMFLOAT4X4 Projection;
+		const uint32_t* Casters;	// Shared by a light's faces
+		uint32_t CasterCount;
+	};
+	FrameVector<FaceRender> renders(&arena);
+	renders.reserve(shadowAtlas.GetSlots().size() * SHADOW_ATLAS_MAX_FACES);
+
+	shadowAtlasFaces.clear();
+	lightShadowFaces.assign(lights.size() * 2, 0);
+	float atlasSize = (float)shadowAtlasConfig.AtlasSize;
+
+	for (const ShadowAtlasSlot& slot : shadowAtlas.GetSlots())
+	{
+		const ShadowAtlasLight& atlasLight = shadowAtlasLights[slot.LightIndex];
+		XMVECTOR position = XMLoadFloat3((const XMFLOAT3*)atlasLight.Position);
+		float nearClip = atlasLight.Range * 0.01f;
+
+		lightShadowFaces[atlasLight.Id * 2 + 0] = (int)shadowAtlasFaces.size();
+		lightShadowFaces[atlasLight.Id * 2 + 1] = (int)slot.FaceCount;
+
+		// Casters in range, if this light is being redrawn
+		uint32_t* casters = 0;
+		uint32_t casterCount = 0;
+		if (slot.NeedsRender)
+		{
+			casters = arena.AllocateArray<uint32_t>(shadowCasters.size());
+			for (size_t e = 0; e < shadowCasters.size(); e++)
+			{
+				XMVECTOR offset = XMLoadFloat3((const XMFLOAT3*)shadowCasters[e].Center) - position;
+				if (XMVectorGetX(XMVector3Length(offset)) <= atlasLight.Range + shadowCasters[e].Radius)
+					casters[casterCount++] = (uint32_t)e;
+			}
+		}
+
+		for (uint32_t f = 0; f < slot.FaceCount; f++)
+		{
+			XMMATRIX view;
+			XMMATRIX projection;
+			if (atlasLight.Point)
+			{
+				view = XMMatrixLookToLH(position, XMLoadFloat3(&faceForward[f]), XMLoadFloat3(&faceUp[f]));
+				projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, nearClip, atlasLight.Range);
+			}
+			else
+			{
+				XMVECTOR direction = XMVector3Normalize(XMLoadFloat3((const XMFLOAT3*)atlasLight.Direction));
+				XMVECTOR up = fabsf(XMVectorGetY(direction)) > 0.99f ? XMVectorSet(0, 0, 1, 0) : XMVectorSet(0, 1, 0, 0);
+				float fov = atlasLight.SpotAngle < 0.2f ? 0.2f : (atlasLight.SpotAngle > 2.6f ? 2.6f : atlasLight.SpotAngle);
+				view = XMMatrixLookToLH(position, direction, up);
+				projection = XMMatrixPerspectiveFovLH(fov, 1.0f, nearClip, atlasLight.Range);
+			}
+
+			const ShadowAtlasTile& tile = slot.Faces[f];
+			ShadowAtlasShaderFace face;
+			XMStoreFloat4x4((XMFLOAT4X4*)face.ViewProjection, view * projection);
+			face.AtlasRect[0] = tile.X / atlasSize;
+			face.AtlasRect[1] = tile.Y / atlasSize;
+			face.AtlasRect[2] = tile.Size / atlasSize;
+			face.AtlasRect[3] = tile.Size / atlasSize;
+			shadowAtlasFaces.push_back(face);
+
+			if (slot.NeedsRender)
+			{
+				FaceRender render;
+				render.Tile = tile;
+				XMStoreFloat4x4(&render.View, view);
+				XMStoreFloat4x4(&render.Projection, projection);
+				render.Casters = casters;
+				render.CasterCount = casterCount;
+				renders.push_back(render);
+			}
+		}
+	}
+
+	shadowAtlasFaceBuffer->Upload(shadowAtlasFaces.data(), (unsigned int)shadowAtlasFaces.size(), sizeof(ShadowAtlasShaderFace));
+	lightShadowFaceBuffer->Upload(lightShadowFaces.data(), (unsigned int)lights.size(), sizeof(int) * 2);
+	renderStats.AtlasRenderCount = (unsigned int)renders.size();
+	if (renders.empty())
+		return;
+
+	// Redraw each out of date face within its own tile
+	ID3D11RenderTargetView* nullRTV{};
+	context->OMSetRenderTargets(1, &nullRTV, shadowAtlasDSV.Get());
+	for (const FaceRender& render : renders)
+	{
+		D3D11_VIEWPORT viewport = {};
+		viewport.TopLeftX = (float)render.Tile.X;
+		viewport.TopLeftY = (float)render.Tile.Y;
+		viewport.Width = (float)render.Tile.Size;
+		viewport.Height = (float)render.Tile.Size;
+		D3D11_RECT scissor = { (LONG)render.Tile.X, (LONG)render.Tile.Y, (LONG)(render.Tile.X + render.Tile.Size), (LONG)(render.Tile.Y + render.Tile.Size) };
+		context->RSSetScissorRects(1, &scissor);
+
+		// Clearing only part of a depth buffer means drawing the
+		// far plane over it - a viewport with depth range 1 to 1
+		// puts the fullscreen triangle there
+		viewport.MinDepth = 1.0f;
+		viewport.MaxDepth = 1.0f;
+		context->RSSetViewports(1, &viewport);
+		context->RSSetState(shadowRestoreRasterizer.Get());
+		context->OMSetDepthStencilState(shadowRestoreDepthState.Get(), 0);
+		ppVS->SetShader();
+		context->PSSetShader(0, 0, 0);
+		context->Draw(3, 0);
+
+		viewport.MinDepth = 0.0f;
+		context->RSSetViewports(1, &viewport);
+		context->RSSetState(shadowRasterizer.Get());
+		context->OMSetDepthStencilState(0, 0);
+		DrawShadowCasters(context.Get(), render.Casters, render.CasterCount, render.View, render.Projection);
+	}
+
+	// Reset the pipeline
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = (float)this->windowWidth;
+	viewport.Height = (float)this->windowHeight;
+	viewport.MaxDepth = 1.0f;
+	context->RSSetViewports(1, &viewport);
+	context->RSSetState(0);
+}
+
+// --------------------------------------------------------
+// Draws the lit entities and the sky into the scene target
+// (the render graph has already bound and cleared it, along
+// with the depth buffer)
+// --------------------------------------------------------
+void Game::DrawScene(ID3D11RenderTargetView* target)
+{
+	GameFrame& frame = frames.GetRead();
+	if (frame.RenderPath == RENDER_PATH_TILED_DEFERRED)
+	{
+		// G-buffer, then one lighting pass into the scene target
+		tiledDeferred->RenderGBuffer(entityDraws, *frame.ViewCamera, depthBufferDSV.Get());
+
+		DeferredShadowInputs shadows = {};
+		shadows.ShadowMap = shadowSRV;
+		shadows.ShadowSampler = shadowSampler;
+		shadows.Cascades = shadowCascadeInfo;
+		shadows.ShadowLightIndex = (int)frame.Lights.size() - 1;
+		shadows.AtlasMap = shadowAtlasSRV;
+		shadows.AtlasFaces = shadowAtlasFaceBuffer->GetSRV();
+		shadows.LightShadowFaces = lightShadowFaceBuffer->GetSRV();
+		tiledDeferred->RenderLighting(frame.Lights, *frame.ViewCamera, frame.AmbientColor, shadows, target, depthBufferDSV.Get());
+	}
+	else
+	{
+		// Assign lights to clusters for this camera (the sun, added last, casts shadows)
+		if (frame.UseClusteredLighting)
+			clusteredLighting->Update(frame.Lights, *frame.ViewCamera, this->windowWidth, this->windowHeight, (int)frame.Lights.size() - 1);
+
+		// Anything worked out on first use (shader variants, world
+		// matrices) is worked out here, before threads share it
+		for (const EntityDraw& draw : entityDraws)
+		{
+			draw.EntityMaterial->GetPixelShader();
+			draw.Entity->GetTransform().GetWorldMatrix();
+		}
+
+		// Chunks of entities, each recorded on whichever thread is free
+		size_t chunkSize = frame.SceneChunkSize > 0 ? (size_t)frame.SceneChunkSize : entityDraws.size();
+		commandRecorder->SetParallel(frame.ParallelRecording);
+		for (size_t first = 0; first < entityDraws.size(); first += chunkSize)
+		{
+			size_t count = entityDraws.size() - first < chunkSize ? entityDraws.size() - first : chunkSize;
+			commandRecorder->Add([=, this](CommandContext& recordContext) {
+				DrawSceneEntities(D3D11CommandBackend::GetContext(recordContext), target, first, count);
+			});
+		}
+		commandRecorder->Run();
+	}
+
+	// (A scene needn't have a sky)
+	if (skyBox)
+		skyBox->Draw(*frame.ViewCamera);
+}
+
+// --------------------------------------------------------
+// Draws some of the entities with forward lighting, binding
+// everything they need (a deferred context starts with none)
+// --------------------------------------------------------
+void Game::DrawSceneEntities(ID3D11DeviceContext* drawContext, ID3D11RenderTargetView* target, size_t first, size_t count)
+{
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = (float)this->windowWidth;
+	viewport.Height = (float)this->windowHeight;
+	viewport.MaxDepth = 1.0f;
+	drawContext->RSSetViewports(1, &viewport);
+	drawContext->OMSetRenderTargets(1, &target, depthBufferDSV.Get());
+	drawContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	GameFrame& frame = frames.GetRead();
+	for (size_t i = first; i < first + count; i++)
+	{
+		const EntityDraw& draw = entityDraws[i];
+		Material* material = draw.EntityMaterial;
+		const std::shared_ptr<SimplePixelShader>& ps = material->GetPixelShader();
+		const MaterialShaderHandles& handles = material->GetShaderHandles();
+
+		// Setting shader inputs
+		ps->SetFloat3(handles.ambientColor, frame.AmbientColor);
+		ps->SetData(handles.shadowCascades, &shadowCascadeInfo, sizeof(ShadowCascadeShaderInfo));
+		// (Checking the handle covers the fallback shader, which isn't clustered)
+		if (frame.UseClusteredLighting && handles.clusterInfo.IsValid())
+			clusteredLighting->SetShaderData(ps, handles.clusterInfo, drawContext);
+		else if (frame.Lights.size() * sizeof(Light) <= handles.lights.Size)
+			ps->SetData(handles.lights, &frame.Lights[0], sizeof(Light) * (int)frame.Lights.size());
+		else
+		{
+			// More lights than the array holds (the fallback
+			// shader's is small), so the first that fit and the
+			// sun, in the last slot where the shadows look for it
+			Light fitted[SHADER_MAX_LIGHTS];
+			size_t fit = std::min<size_t>(handles.lights.Size / sizeof(Light), SHADER_MAX_LIGHTS);
+			if (fit > 0)
+			{
+				std::copy(frame.Lights.begin(), frame.Lights.begin() + (fit - 1), fitted);
+				fitted[fit - 1] = frame.Lights.back();
+				ps->SetData(handles.lights, fitted, sizeof(Light) * (int)fit);
+			}
+		}
+
+		// Set shadow map and sampler
+		ps->SetShaderResourceView("ShadowMap", shadowSRV, drawContext);
+		ps->SetShaderResourceView("ShadowAtlasMap", shadowAtlasSRV, drawContext);
+		ps->SetShaderResourceView("ShadowAtlasFaces", shadowAtlasFaceBuffer->GetSRV(), drawContext);
+		ps->SetShaderResourceView("LightShadowFaces", lightShadowFaceBuffer->GetSRV(), drawContext);
+		ps->SetSamplerState("ShadowSampler", shadowSampler, drawContext);
+
+		draw.Entity->DrawEntity(drawContext, *draw.EntityMesh, *material, *frame.ViewCamera);
+	}
+}
+
+// --------------------------------------------------------
+// Post process targets are graph transients, sized to a
+// pyramid level (0 = full resolution)
+// --------------------------------------------------------
+RenderGraphTextureDesc Game::GetPostProcessDesc(int level, DXGI_FORMAT format)
+{
+	int width, height;
+	PostPyramid::GetLevelSize(windowWidth, windowHeight, level, width, height);
+
+	RenderGraphTextureDesc desc;
+	desc.Width = width;
+	desc.Height = height;
+	desc.Format = format;
+	desc.BindFlags = RENDER_GRAPH_BIND_RENDER_TARGET | RENDER_GRAPH_BIND_SHADER_RESOURCE;
+	return desc;
+}
+
+// --------------------------------------------------------
+// Fills pyramid levels 1 to levelCount from levels[0] (the
+// scene), with bloom's bright pass on the first
+// --------------------------------------------------------
+void Game::AddPyramidDownsamplePasses(RenderGraphResource levels[], int levelCount, bool threshold)
+{
+	static const char* names[POST_PYRAMID_MAX_LEVELS + 1] = { "", "Pyramid 1", "Pyramid 2", "Pyramid 3", "Pyramid 4", "Pyramid 5", "Pyramid 6" };
+
+	for (int level = 1; level <= levelCount; level++)
+	{
+		int sourceWidth, sourceHeight;
+		PostPyramid::GetLevelSize(windowWidth, windowHeight, level - 1, sourceWidth, sourceHeight);
+		RenderGraphResource source = levels[level - 1];
+		bool applyThreshold = threshold && level == 1;
+		float bloomThreshold = frames.GetRead().BloomThreshold;
+		float bloomKnee = frames.GetRead().BloomKnee;
+
+		uint32_t pass = renderGraph.AddPass("Downsample", [=, this](const RenderGraphPassResources& resources) {
+			ppVS->SetShader();
+			ppDownsamplePS->SetShader();
+			ppDownsamplePS->SetSamplerState("ClampSampler", ppSampler.Get());
+			ppDownsamplePS->SetShaderResourceView("Pixels", renderGraphDevice->GetSRV(resources.GetTexture(source)));
+			ppDownsamplePS->SetFloat2(ppDownsamplePixelSizeHandle, XMFLOAT2(1.0f / sourceWidth, 1.0f / sourceHeight));
+			ppDownsamplePS->SetInt(ppDownsampleApplyThresholdHandle, applyThreshold);
+			ppDownsamplePS->SetFloat(ppDownsampleThresholdHandle, bloomThreshold);
+			ppDownsamplePS->SetFloat(ppDownsampleKneeHandle, bloomKnee);
+			ppDownsamplePS->CopyAllBufferData();
+			context->Draw(3, 0);
+		});
+		renderGraph.Read(pass, source);
+		levels[level] = renderGraph.CreateTexture(names[level], GetPostProcessDesc(level, DXGI_FORMAT_R16G16B16A16_FLOAT));
+		levels[level] = renderGraph.WriteRenderTarget(pass, levels[level], RENDER_GRAPH_LOAD_DISCARD);
+	}
+}
+
+// --------------------------------------------------------
+// Separable Gaussian blur.  Small radii run at full
+// resolution; larger ones move down the pyramid so the tap
+// count stays bounded, then get upsampled back to the screen.
+// --------------------------------------------------------
+void Game::AddPostBlurPasses(RenderGraphResource scene, RenderGraphResource backBuffer, int levelCount)
+{
+	int blurRadius = frames.GetRead().BlurRadius;
+	int levelRadius;
+	float levelSigma;
+	int level = PostPyramid::GetBlurLevel(blurRadius, levelCount, levelRadius, levelSigma);
+
+	// Gaussian weights only change with the radius
+	if (blurRadius != blurTapRadius || level != blurTapLevel)
+	{
+		std::vector<float> weights;
+		std::vector<GaussianTap> taps;
+		GaussianKernel::ComputeWeights(levelRadius, levelSigma, weights);
+		GaussianKernel::ComputeLinearTaps(weights, taps);
+
+		blurTapBuffer->Upload(taps.data(), (unsigned int)taps.size(), sizeof(GaussianTap));
+		blurTapCount = (unsigned int)taps.size();
+		blurTapRadius = blurRadius;
+		blurTapLevel = level;
+	}
+
+	RenderGraphResource levels[POST_PYRAMID_MAX_LEVELS + 1];
+	levels[0] = scene;
+	AddPyramidDownsamplePasses(levels, level, false);
+
+	int width, height;
+	PostPyramid::GetLevelSize(windowWidth, windowHeight, level, width, height);
+
+	// Horizontal then vertical, back into the level (or to the screen)
+	RenderGraphResource horizontal = renderGraph.CreateTexture("Blur Horizontal",
+		GetPostProcessDesc(level, level == 0 ? DXGI_FORMAT_R8G8B8A8_UNORM : DXGI_FORMAT_R16G16B16A16_FLOAT));
+	for (int direction = 0; direction < 2; direction++)
+	{
+		RenderGraphResource source = direction == 0 ? levels[level] : horizontal;
+		XMFLOAT2 pixelStep = direction == 0 ? XMFLOAT2(1.0f / width, 0.0f) : XMFLOAT2(0.0f, 1.0f / height);
+
+		uint32_t pass = renderGraph.AddPass(direction == 0 ? "Blur Horizontal" : "Blur Vertical", [=, this](const RenderGraphPassResources& resources) {
+			ppVS->SetShader();
+			ppBlurPS->SetShader();
+			ppBlurPS->SetSamplerState("ClampSampler", ppSampler.Get());
+			ppBlurPS->SetShaderResourceView("Pixels", renderGraphDevice->GetSRV(resources.GetTexture(source)));
+			ppBlurPS->SetShaderResourceView("GaussianTaps", blurTapBuffer->GetSRV());
+			ppBlurPS->SetInt(ppBlurTapCountHandle, blurTapCount);
+			ppBlurPS->SetFloat2(ppBlurPixelStepHandle, pixelStep);
+			ppBlurPS->CopyAllBufferData();
+			context->Draw(3, 0);
+		});
+		renderGraph.Read(pass, source);
+
+		if (direction == 0)
+			horizontal = renderGraph.WriteRenderTarget(pass, horizontal, RENDER_GRAPH_LOAD_DISCARD);
+		else if (level == 0)
+			renderGraph.WriteRenderTarget(pass, backBuffer, RENDER_GRAPH_LOAD_DISCARD);
+		else
+			levels[level] = renderGraph.WriteRenderTarget(pass, levels[level], RENDER_GRAPH_LOAD_DISCARD);
+	}
+
+	// Back up, replacing each level with the one below it
+	for (int i = level - 1; i >= 0; i--)
+	{
+		int sourceWidth, sourceHeight;
+		PostPyramid::GetLevelSize(windowWidth, windowHeight, i + 1, sourceWidth, sourceHeight);
+		RenderGraphResource source = levels[i + 1];
+
+		uint32_t pass = renderGraph.AddPass("Upsample", [=, this](const RenderGraphPassResources& resources) {
+			ppVS->SetShader();
+			ppUpsamplePS->SetShader();
+			ppUpsamplePS->SetSamplerState("ClampSampler", ppSampler.Get());
+			ppUpsamplePS->SetShaderResourceView("Pixels", renderGraphDevice->GetSRV(resources.GetTexture(source)));
+			ppUpsamplePS->SetFloat2(ppUpsamplePixelSizeHandle, XMFLOAT2(1.0f / sourceWidth, 1.0f / sourceHeight));
+			ppUpsamplePS->SetFloat(ppUpsampleIntensityHandle, 1.0f);
+			ppUpsamplePS->CopyAllBufferData();
+			context->Draw(3, 0);
+		});
+		renderGraph.Read(pass, source);
+
+		if (i == 0)
+			renderGraph.WriteRenderTarget(pass, backBuffer, RENDER_GRAPH_LOAD_DISCARD);
+		else
+			levels[i] = renderGraph.WriteRenderTarget(pass, levels[i], RENDER_GRAPH_LOAD_DISCARD);
+	}
+}
+
+// --------------------------------------------------------
+// Bright pass down the whole pyramid, then each level added
+// onto the one above it, and the top level onto the scene
+// --------------------------------------------------------
+void Game::AddPostBloomPasses(RenderGraphResource scene, RenderGraphResource backBuffer, int levelCount)
+{
+	RenderGraphResource levels[POST_PYRAMID_MAX_LEVELS + 1];
+	levels[0] = scene;
+	AddPyramidDownsamplePasses(levels, levelCount, true);
+
+	for (int level = levelCount - 1; level >= 1; level--)
+	{
+		int sourceWidth, sourceHeight;
+		PostPyramid::GetLevelSize(windowWidth, windowHeight, level + 1, sourceWidth, sourceHeight);
+		RenderGraphResource source = levels[level + 1];
+
+		uint32_t pass = renderGraph.AddPass("Bloom Upsample", [=, this](const RenderGraphPassResources& resources) {
+			ppVS->SetShader();
+			ppUpsamplePS->SetShader();
+			ppUpsamplePS->SetSamplerState("ClampSampler", ppSampler.Get());
+			ppUpsamplePS->SetShaderResourceView("Pixels", renderGraphDevice->GetSRV(resources.GetTexture(source)));
+			ppUpsamplePS->SetFloat2(ppUpsamplePixelSizeHandle, XMFLOAT2(1.0f / sourceWidth, 1.0f / sourceHeight));
+			ppUpsamplePS->SetFloat(ppUpsampleIntensityHandle, 1.0f);
+			ppUpsamplePS->CopyAllBufferData();
+
+			context->OMSetBlendState(additiveBlendState.Get(), 0, 0xFFFFFFFF);
+			context->Draw(3, 0);
+			context->OMSetBlendState(0, 0, 0xFFFFFFFF);
+		});
+		renderGraph.Read(pass, source);
+
+		// Added on top of what the downsample left there
+		levels[level] = renderGraph.WriteRenderTarget(pass, levels[level], RENDER_GRAPH_LOAD_KEEP);
+	}
+
+	// A window too small for any levels just gets the scene
+	int bloomWidth, bloomHeight;
+	PostPyramid::GetLevelSize(windowWidth, windowHeight, 1, bloomWidth, bloomHeight);
+	RenderGraphResource bloom = levels[levelCount > 0 ? 1 : 0];
+	float intensity = levelCount > 0 ? frames.GetRead().BloomIntensity : 0.0f;
+
+	uint32_t pass = renderGraph.AddPass("Bloom Composite", [=, this](const RenderGraphPassResources& resources) {
+		ppVS->SetShader();
+		ppCompositePS->SetShader();
+		ppCompositePS->SetSamplerState("ClampSampler", ppSampler.Get());
+		ppCompositePS->SetShaderResourceView("Pixels", renderGraphDevice->GetSRV(resources.GetTexture(scene)));
+		ppCompositePS->SetShaderResourceView("Bloom", renderGraphDevice->GetSRV(resources.GetTexture(bloom)));
+		ppCompositePS->SetFloat2(ppCompositeBloomPixelSizeHandle, XMFLOAT2(1.0f / bloomWidth, 1.0f / bloomHeight));
+		ppCompositePS->SetFloat(ppCompositeBloomIntensityHandle, intensity);
+		ppCompositePS->CopyAllBufferData();
+		context->Draw(3, 0);
+	});
+	renderGraph.Read(pass, scene);
+	renderGraph.Read(pass, bloom);
+	renderGraph.WriteRenderTarget(pass, backBuffer, RENDER_GRAPH_LOAD_DISCARD);
 }
 
 // --------------------------------------------------------
@@ -564,13 +1246,26 @@ void Game::OnResize()
 
 	// Update camera projection matrix
 	
-	for (unsigned int i = 0; i < cameras.size(); i++)
-	{
-		cameras[i]->UpdateProjectionMatrix((float)windowWidth / windowHeight);
-	}
+	world.ForEach<Camera>([&](Camera& camera) {
+		camera.UpdateProjectionMatrix((float)windowWidth / windowHeight);
+	});
+
+	// Update all render targets (post process ones follow the
+	// window size through the render graph)
+	if (tiledDeferred)
+		tiledDeferred->Resize(windowWidth, windowHeight);
+}
 
-	// Update all render targets
-	ResizeAllPostProcessResources();
+// --------------------------------------------------------
+// Moves the entities by one fixed step of the simulation,
+// so they move the same however fast frames are drawn
+// --------------------------------------------------------
+void Game::FixedUpdate(float step, float time)
+{
+	// Each system's chunks are split across the job system
+	fixedStep = step;
+	fixedTime = time;
+	fixedSystems.Run(world, jobSystem.get());
 }
 
 // --------------------------------------------------------
@@ -597,26 +1292,15 @@ void Game::Update(float deltaTime, float totalTime)
 	// Show demo window
 	//ImGui::ShowDemoWindow();
 	
-	// --= Update entities =--
-	
-	// Transform and rotate the entities
-	for (int i = 0; i < 5; i++)
+	// Update camera (every frame, so it answers input right away),
+	// and stream in the world around where it's headed
+	if (Camera* camera = world.Get<Camera>(activeCamera))
 	{
-		entities[i]->GetTransform().Rotate(0.0f, 0.5f * deltaTime, 0.0f);
-
-		if (i % 2 == 0)
-		{
-			entities[i]->GetTransform().MoveAbsolute(0.0f, 0.01f * sin(totalTime), 0.0f);
-		}
-		else
-		{
-			entities[i]->GetTransform().MoveAbsolute(0.0f, 0.0f, 0.05f * sin(totalTime));
-		}
+		camera->Update(deltaTime);
+		if (worldStreamer && worldStreamer->IsOpen())
+			worldStreamer->Update(world, camera->GetTransform().GetPosition(), camera->GetVelocity(), totalTime);
 	}
 
-	// Update camera
-	camera->Update(deltaTime);
-
 	// Graphics Interface
 	ImGui::Begin("Graphics Interface");
 
@@ -625,47 +1309,44 @@ void Game::Update(float deltaTime, float totalTime)
 	{
 		ImGui::Text("FrameRate: %.0f", io.Framerate);
 		ImGui::Text("Window Dimensions: %0.f by %.0f", io.DisplaySize.x, io.DisplaySize.y);
+
+		// Next frame's update alongside this frame's draw
+		bool pipelined = framePipeline->IsPipelined();
+		if (ImGui::Checkbox("Pipelined Update & Draw", &pipelined))
+			framePipeline->SetPipelined(pipelined);
+		ImGui::Text("Update %.2f ms, draw %.2f ms, frame %.2f ms",
+			shownStats.UpdateTime, shownStats.DrawTime, shownStats.FrameTime);
+
+		// Fixed simulation steps, drawn interpolated
+		float tickRate = fixedTimestep.GetTickRate();
+		int maxSteps = (int)fixedTimestep.GetMaxStepsPerFrame();
+		if (ImGui::DragFloat("Tick Rate (Hz)", &tickRate, 1.0f, 10.0f, 240.0f))
+			fixedTimestep.SetTickRate(tickRate);
+		if (ImGui::SliderInt("Max Steps per Frame", &maxSteps, 1, 16))
+			fixedTimestep.SetMaxStepsPerFrame((uint32_t)maxSteps);
+		ImGui::Text("Ticks: %llu (%.2f s dropped)",
+			(unsigned long long)fixedTimestep.GetTickCount(), fixedTimestep.GetDroppedTime());
 	}
 
 	if (ImGui::CollapsingHeader("Cameras"))
 	{
-		if (ImGui::TreeNode("Camera 1"))
+		for (size_t i = 0; i < cameraHandles.size(); i++)
 		{
-			XMFLOAT3 camPosition = cameras[0]->GetTransform().GetPosition();
-			float fov = cameras[0]->GetFieldOfView();
-
-			if (ImGui::Button("Activate")) camera = cameras[0];
-			ImGui::DragFloat3("Position", &camPosition.x);
-			ImGui::DragFloat("Field of View", &fov, 0.01f, 0.01f, 2.0f);
-
-			cameras[0]->GetTransform().SetPosition(camPosition);
-			cameras[0]->SetFieldOfView(fov);
-			ImGui::TreePop();
-		}
-		if (ImGui::TreeNode("Camera 2"))
-		{
-			XMFLOAT3 camPosition = cameras[1]->GetTransform().GetPosition();
-			float fov = cameras[1]->GetFieldOfView();
-
-			if (ImGui::Button("Activate")) camera = cameras[1];
-			ImGui::DragFloat3("Position", &camPosition.x);
-			ImGui::DragFloat("Field of View", &fov, 0.01f, 0.01f, 2.0f);
+			char label[32];
+			snprintf(label, sizeof(label), "Camera %zu", i + 1);
+			if (!ImGui::TreeNode(label))
+				continue;
 
-			cameras[1]->GetTransform().SetPosition(camPosition);
-			cameras[1]->SetFieldOfView(fov);
-			ImGui::TreePop();
-		}
-		if (ImGui::TreeNode("Camera 3"))
-		{
-			XMFLOAT3 camPosition = cameras[2]->GetTransform().GetPosition();
-			float fov = cameras[2]->GetFieldOfView();
+			Camera* camera = world.Get<Camera>(cameraHandles[i]);
+			XMFLOAT3 camPosition = camera->GetTransform().GetPosition();
+			float fov = camera->GetFieldOfView();
 
-			if (ImGui::Button("Activate")) camera = cameras[2];
+			if (ImGui::Button("Activate")) activeCamera = cameraHandles[i];
 			ImGui::DragFloat3("Position", &camPosition.x);
 			ImGui::DragFloat("Field of View", &fov, 0.01f, 0.01f, 2.0f);
 
-			cameras[2]->GetTransform().SetPosition(camPosition);
-			cameras[2]->SetFieldOfView(fov);
+			camera->GetTransform().SetPosition(camPosition);
+			camera->SetFieldOfView(fov);
 			ImGui::TreePop();
 		}
 	}
@@ -673,120 +1354,166 @@ void Game::Update(float deltaTime, float totalTime)
 	if (ImGui::CollapsingHeader("Lights"))
 	{
 		ImGui::DragFloat3("Ambient Term", &ambientColor.x, 0.01f, 0.0f, 1.0f);
-		if (ImGui::TreeNode("Light 1"))
+		ImGui::Checkbox("Clustered Lighting", &useClusteredLighting);
+		if (useClusteredLighting)
 		{
-			ImGui::DragFloat3("Color", &lights[0].Color.x, 0.01f, 0.0f, 1.0f);
-			ImGui::DragFloat("Intensity", &lights[0].Intensity, 0.01f, 0.0f, 1.0f);
-			ImGui::TreePop();
+			ImGui::Text("Clusters: %u x %u x %u", shownStats.ClusterCounts[0], shownStats.ClusterCounts[1], shownStats.ClusterCounts[2]);
+			ImGui::Text("Light indices: %u", shownStats.ClusterLightIndices);
 		}
-		if (ImGui::TreeNode("Light 2"))
+		for (size_t i = 0; i < lightHandles.size(); i++)
 		{
-			ImGui::DragFloat3("Color", &lights[1].Color.x);
-			ImGui::DragFloat("Intensity", &lights[1].Intensity, 0.01f, 0.0f, 1.0f);
+			Light* light = world.Get<Light>(lightHandles[i]);
+			bool spot = light->Type == LIGHT_TYPE_SPOT;
+
+			char label[32];
+			snprintf(label, sizeof(label), spot ? "Light %zu (Spot)" : "Light %zu", i + 1);
+			if (!ImGui::TreeNode(label))
+				continue;
+
+			ImGui::DragFloat3("Color", &light->Color.x, 0.01f, 0.0f, 1.0f);
+			ImGui::DragFloat("Intensity", &light->Intensity, 0.01f, 0.0f, spot ? 5.0f : 1.0f);
+			if (spot)
+			{
+				ImGui::DragFloat3("Position", &light->Position.x, 0.05f);
+				ImGui::DragFloat3("Direction", &light->Direction.x, 0.01f, -1.0f, 1.0f);
+			}
 			ImGui::TreePop();
 		}
-		if (ImGui::TreeNode("Light 3"))
+	}
+
+	if (worldStreamer && worldStreamer->IsOpen() && ImGui::CollapsingHeader("World Streaming"))
+	{
+		WorldStreamConfig& config = worldStreamer->GetConfig();
+		const WorldStreamStats& stats = worldStreamer->GetStats();
+		int budget = (int)(config.MemoryBudget / (1024 * 1024));
+
+		ImGui::DragFloat("Load Radius", &config.LoadRadius, 1.0f, config.RequiredRadius, 2000.0f);
+		ImGui::DragFloat("Required Radius", &config.RequiredRadius, 1.0f, 0.0f, config.LoadRadius);
+		ImGui::SliderFloat("Predict (s)", &config.PredictSeconds, 0.0f, 5.0f);
+		if (ImGui::SliderInt("Memory Budget (MB)", &budget, 1, 2048))
+			config.MemoryBudget = (uint64_t)budget * 1024 * 1024;
+		ImGui::Checkbox("Keep Cells Until Needed", &config.RetainUnwanted);
+
+		ImGui::Text("Cells: %u resident, %u wanted, %u reading, %u missing (of %u)",
+			stats.ResidentCells, stats.WantedCells, stats.ReadsInFlight, stats.MissingCells, stats.CellCount);
+		ImGui::Text("Memory: %.1f MB (peak %.1f MB)%s",
+			stats.ResidentBytes / (1024.0f * 1024.0f), stats.PeakResidentBytes / (1024.0f * 1024.0f), stats.OverBudget ? ", over budget" : "");
+		ImGui::Text("Loaded %llu cells (%llu again), evicted %llu, %.1f MB read",
+			(unsigned long long)stats.CellsLoaded, (unsigned long long)stats.CellsReloaded, (unsigned long long)stats.CellsEvicted, stats.BytesRead / (1024.0f * 1024.0f));
+	}
+
+	if (ImGui::CollapsingHeader("Entities"))
+	{
+		// Static entities promise not to move, so they're left out
+		for (size_t i = 0; i < entityHandles.size(); i++)
 		{
-			ImGui::DragFloat3("Color", &lights[2].Color.x, 0.01f, 0.0f, 1.0f);
-			ImGui::DragFloat("Intensity", &lights[2].Intensity, 0.01f, 0.0f, 1.0f);
+			GameEntity* entity = world.Get<GameEntity>(entityHandles[i]);
+			if (entity->IsStatic())
+				continue;
+
+			char label[32];
+			snprintf(label, sizeof(label), "Entity %zu", i + 1);
+			if (!ImGui::TreeNode(label))
+				continue;
+
+			Transform& transform = entity->GetTransform();
+			XMFLOAT3 position = transform.GetPosition();
+			XMFLOAT3 scale = transform.GetScale();
+			XMFLOAT3 rotation = transform.GetPitchYawRoll();
+
+			ImGui::DragFloat3("Position", &position.x, 0.05f);
+			ImGui::DragFloat3("Scale", &scale.x, 0.05f);
+			ImGui::DragFloat3("Rotation", &rotation.x, 0.05f);
+
+			transform.SetPosition(position);
+			transform.SetScale(scale);
+			transform.SetRotation(rotation);
 			ImGui::TreePop();
 		}
-		if (ImGui::TreeNode("Light 4"))
+	}
+	if (ImGui::CollapsingHeader("Shadows"))
+	{
+		ImGui::SliderFloat("Split Lambda", &shadowCascadeConfig.SplitLambda, 0.0f, 1.0f);
+		ImGui::DragFloat("Max Distance", &shadowCascadeConfig.MaxDistance, 1.0f, 1.0f, 1000.0f);
+		ImGui::DragFloat("Caster Distance", &shadowCascadeConfig.CasterDistance, 1.0f, 0.0f, 500.0f);
+		ImGui::Checkbox("Cache Static Casters", &useShadowCache);
+		ImGui::Text(shownStats.ShadowPassSkipped ? "Shadow pass skipped (nothing changed)" : "Shadow pass drawn");
+		for (unsigned int c = 0; c < shownStats.CascadeCount; c++)
 		{
-			ImGui::DragFloat3("Color", &lights[3].Color.x, 0.01f, 0.0f, 1.0f);
-			ImGui::DragFloat("Intensity", &lights[3].Intensity, 0.01f, 0.0f, 1.0f);
-			ImGui::TreePop();
+			ImGui::Text("Cascade %u: %.2f - %.2f, %u draws in %u regions", c, shownStats.CascadeSplits[c][0], shownStats.CascadeSplits[c][1],
+				shownStats.ShadowCasterCounts[c], shownStats.ShadowRegionCounts[c]);
 		}
-		if (ImGui::TreeNode("Light 5"))
+
+		// Point & spot light atlas
+		ImGui::Text("Atlas: %u lights, %u faces redrawn%s",
+			(unsigned int)shownStats.AtlasSlots.size(),
+			shownStats.AtlasRenderCount,
+			shownStats.AtlasRepacked ? " (repacked)" : "");
+		for (const ShadowAtlasSlot& slot : shownStats.AtlasSlots)
 		{
-			ImGui::DragFloat3("Color", &lights[4].Color.x, 0.01f, 0.0f, 1.0f);
-			ImGui::DragFloat("Intensity", &lights[4].Intensity, 0.01f, 0.0f, 1.0f);
-			ImGui::TreePop();
+			ImGui::Text("Light %u: %ux%u x%u, importance %.2f%s",
+				slot.LightId, slot.Faces[0].Size, slot.Faces[0].Size, slot.FaceCount, slot.Importance,
+				slot.Visible ? "" : " (off screen)");
 		}
 	}
-
-	if (ImGui::CollapsingHeader("Entities"))
+	if (ImGui::CollapsingHeader("Render Path"))
 	{
-		if (ImGui::TreeNode("Entity 1"))
+		ImGui::RadioButton("Forward", &renderPath, RENDER_PATH_FORWARD);
+		ImGui::RadioButton("Tiled Deferred", &renderPath, RENDER_PATH_TILED_DEFERRED);
+		if (renderPath == RENDER_PATH_TILED_DEFERRED)
 		{
-			XMFLOAT3 e1position = entities[0]->GetTransform().GetPosition();
-			XMFLOAT3 e1scale = entities[0]->GetTransform().GetScale();
-			XMFLOAT3 e1rotation = entities[0]->GetTransform().GetPitchYawRoll();
-
-			ImGui::DragFloat3("Position", &e1position.x, 0.05f);
-			ImGui::DragFloat3("Scale", &e1scale.x, 0.05f);
-			ImGui::DragFloat3("Rotation", &e1rotation.x, 0.05f);
-
-			entities[0]->GetTransform().SetPosition(e1position);
-			entities[0]->GetTransform().SetScale(e1scale);
-			entities[0]->GetTransform().SetRotation(e1rotation);
-			ImGui::TreePop();
+			ImGui::Text("Tiles: %u x %u", shownStats.TileCounts[0], shownStats.TileCounts[1]);
+			ImGui::Text("Light indices: %u", shownStats.TileLightIndices);
 		}
-		if (ImGui::TreeNode("Entity 2"))
+		else
 		{
-			XMFLOAT3 e2position = entities[1]->GetTransform().GetPosition();
-			XMFLOAT3 e2scale = entities[1]->GetTransform().GetScale();
-			XMFLOAT3 e2rotation = entities[1]->GetTransform().GetPitchYawRoll();
-
-			ImGui::DragFloat3("Position", &e2position.x, 0.05f);
-			ImGui::DragFloat3("Scale", &e2scale.x, 0.05f);
-			ImGui::DragFloat3("Rotation", &e2rotation.x, 0.05f);
-
-			entities[1]->GetTransform().SetPosition(e2position);
-			entities[1]->GetTransform().SetScale(e2scale);
-			entities[1]->GetTransform().SetRotation(e2rotation);
-			ImGui::TreePop();
+			ImGui::SliderInt("Entities per chunk", &sceneChunkSize, 1, 64);
 		}
-		if (ImGui::TreeNode("Entity 3"))
-		{
-			XMFLOAT3 e3position = entities[2]->GetTransform().GetPosition();
-			XMFLOAT3 e3scale = entities[2]->GetTransform().GetScale();
-			XMFLOAT3 e3rotation = entities[2]->GetTransform().GetPitchYawRoll();
-
-			ImGui::DragFloat3("Position", &e3position.x, 0.05f);
-			ImGui::DragFloat3("Scale", &e3scale.x, 0.05f);
-			ImGui::DragFloat3("Rotation", &e3rotation.x, 0.05f);
 
-			entities[2]->GetTransform().SetPosition(e3position);
-			entities[2]->GetTransform().SetScale(e3scale);
-			entities[2]->GetTransform().SetRotation(e3rotation);
-			ImGui::TreePop();
-		}
-		if (ImGui::TreeNode("Entity 4"))
+		// Shadow cascades & forward chunks go to worker threads
+		ImGui::Checkbox("Parallel recording", &parallelRecording);
+		ImGui::Text("Recording threads: %u workers + main%s", commandRecorder->GetWorkerCount(),
+			commandBackend->HasDriverCommandLists() ? "" : " (lists emulated by the runtime)");
+		ImGui::Text("Jobs run: %llu (%llu stolen)",
+			(unsigned long long)jobSystem->GetExecutedCount(), (unsigned long long)jobSystem->GetStolenCount());
+		ImGui::Text("Frame arena: %.1f of %.1f KB (%llu heap blocks so far)",
+			shownStats.FrameArenaUsed / 1024.0f, shownStats.FrameArenaCapacity / 1024.0f,
+			(unsigned long long)shownStats.FrameArenaHeapAllocations);
+	}
+	if (ImGui::CollapsingHeader("Render Graph"))
+	{
+		// (From last frame, as the graph is built in Draw)
+		ImGui::Text("Passes: %u (%u culled)", shownStats.PassCount, shownStats.CulledPassCount);
+		ImGui::Text("Transient textures: %u in %u device textures",
+			shownStats.TransientTextureCount, shownStats.PhysicalTextureCount);
+		ImGui::Text("Pooled targets: %u (%.1f MB)",
+			shownStats.PooledTargetCount, shownStats.PooledTargetMemory / (1024.0f * 1024.0f));
+		ImGui::Text("Targets created: %u, released: %u",
+			shownStats.CreatedTargetCount, shownStats.ReleasedTargetCount);
+		for (const std::string& name : shownStats.PassNames)
+			ImGui::BulletText("%s", name.c_str());
+	}
+	if (ImGui::CollapsingHeader("Post Processing"))
+	{
+		ImGui::RadioButton("Blur", &postEffect, POST_EFFECT_BLUR);
+		ImGui::SameLine();
+		ImGui::RadioButton("Bloom", &postEffect, POST_EFFECT_BLOOM);
+		if (postEffect == POST_EFFECT_BLUR)
 		{
-			XMFLOAT3 e4position = entities[3]->GetTransform().GetPosition();
-			XMFLOAT3 e4scale = entities[3]->GetTransform().GetScale();
-			XMFLOAT3 e4rotation = entities[3]->GetTransform().GetPitchYawRoll();
-
-			ImGui::DragFloat3("Position", &e4position.x, 0.05f);
-			ImGui::DragFloat3("Scale", &e4scale.x, 0.05f);
-			ImGui::DragFloat3("Rotation", &e4rotation.x, 0.05f);
+			ImGui::DragInt("Blur Radius", &blurRadius, 1, 0, 300);
 
-			entities[3]->GetTransform().SetPosition(e4position);
-			entities[3]->GetTransform().SetScale(e4scale);
-			entities[3]->GetTransform().SetRotation(e4rotation);
-			ImGui::TreePop();
+			int levelRadius;
+			float levelSigma;
+			int level = PostPyramid::GetBlurLevel(blurRadius, PostPyramid::GetLevelCount(windowWidth, windowHeight), levelRadius, levelSigma);
+			ImGui::Text("Blurring at 1/%d resolution, radius %d", 1 << level, levelRadius);
 		}
-		if (ImGui::TreeNode("Entity 5"))
+		else
 		{
-			XMFLOAT3 e5position = entities[4]->GetTransform().GetPosition();
-			XMFLOAT3 e5scale = entities[4]->GetTransform().GetScale();
-			XMFLOAT3 e5rotation = entities[4]->GetTransform().GetPitchYawRoll();
-
-			ImGui::DragFloat3("Position", &e5position.x, 0.05f);
-			ImGui::DragFloat3("Scale", &e5scale.x, 0.05f);
-			ImGui::DragFloat3("Rotation", &e5rotation.x, 0.05f);
-
-			entities[4]->GetTransform().SetPosition(e5position);
-			entities[4]->GetTransform().SetScale(e5scale);
-			entities[4]->GetTransform().SetRotation(e5rotation);
-			ImGui::TreePop();
+			ImGui::DragFloat("Threshold", &bloomThreshold, 0.01f, 0.0f, 4.0f);
+			ImGui::DragFloat("Knee", &bloomKnee, 0.01f, 0.0f, 1.0f);
+			ImGui::DragFloat("Intensity", &bloomIntensity, 0.01f, 0.0f, 4.0f);
 		}
 	}
-	if (ImGui::CollapsingHeader("Post Processing"))
-	{
-		ImGui::DragInt("Blur Radius", &blurRadius, 1, 0, 50);
-	}
 	
 	// Shadow depth map image
 	// ImGui::Image(shadowSRV.Get(), ImVec2(512, 512));
@@ -796,6 +1523,156 @@ void Game::Update(float deltaTime, float totalTime)
 	// Example input checking: Quit if the escape key is pressed
 	if (Input::GetInstance().KeyDown(VK_ESCAPE))
 		Quit();
+
+	// Everything Draw needs from this frame
+	WriteFrame(frames.GetWrite());
+}
+
+// --------------------------------------------------------
+// Copies an ImGui vector, keeping the memory it already has
+// --------------------------------------------------------
+template<typename T>
+static void CopyImVector(ImVector<T>& to, const ImVector<T>& from)
+{
+	to.resize(from.Size);
+	if (from.Size > 0)
+		memcpy(to.Data, from.Data, from.size_in_bytes());
+}
+
+// --------------------------------------------------------
+// Copies everything Draw reads into a frame, finishing the
+// UI on the way.  This is the end of Update, so when frames
+// are pipelined it overlaps the last frame's Draw (which
+// only reads the other frame).
+// --------------------------------------------------------
+void Game::WriteFrame(GameFrame& frame)
+{
+	// Entities are copied into the frame's list, which keeps
+	// its memory, so this only allocates for new entities.  They're drawn part way
+	// from their last step to their current one, as far as
+	// real time has got, and their world matrices are worked
+	// out here so Update pays for them and not Draw.
+	float alpha = fixedTimestep.GetAlpha();
+	frame.Entities.clear();
+	world.ForEach<GameEntity, PreviousTransform>([&](GameEntity& entity, PreviousTransform& previous) {
+		frame.Entities.push_back(entity);
+
+		Transform& transform = frame.Entities.back().GetTransform();
+		transform.SetInterpolated(previous.Value, entity.GetTransform(), alpha);
+		transform.GetWorldMatrix();
+	});
+
+	// A camera or light whose entity is gone is left out, so
+	// Draw sees it's missing rather than last frame's copy
+	if (Camera* camera = world.Get<Camera>(activeCamera))
+		frame.ViewCamera = *camera;
+	else
+		frame.ViewCamera.reset();
+
+	frame.Lights.clear();
+	for (SceneEntity handle : lightHandles)
+	{
+		if (Light* light = world.Get<Light>(handle))
+			frame.Lights.push_back(*light);
+	}
+	frame.AmbientColor = ambientColor;
+
+	// Past the most a light array holds, only clusters fit them all
+	frame.UseClusteredLighting = useClusteredLighting || frame.Lights.size() > SHADER_MAX_LIGHTS;
+	frame.UseShadowCache = useShadowCache;
+	frame.ParallelRecording = parallelRecording;
+	frame.RenderPath = renderPath;
+	frame.SceneChunkSize = sceneChunkSize;
+	frame.CascadeConfig = shadowCascadeConfig;
+	frame.PostEffect = postEffect;
+	frame.BlurRadius = blurRadius;
+	frame.BloomThreshold = bloomThreshold;
+	frame.BloomKnee = bloomKnee;
+	frame.BloomIntensity = bloomIntensity;
+
+	// ImGui reuses its lists next frame, so Draw gets copies
+	ImGui::Render();
+	const ImDrawData* ui = ImGui::GetDrawData();
+	ImDrawData& uiCopy = frame.UiDrawData;
+	uiCopy.Valid = ui->Valid;
+	uiCopy.CmdListsCount = ui->CmdListsCount;
+	uiCopy.TotalIdxCount = ui->TotalIdxCount;
+	uiCopy.TotalVtxCount = ui->TotalVtxCount;
+	uiCopy.DisplayPos = ui->DisplayPos;
+	uiCopy.DisplaySize = ui->DisplaySize;
+	uiCopy.FramebufferScale = ui->FramebufferScale;
+	uiCopy.OwnerViewport = ui->OwnerViewport;
+	uiCopy.CmdLists.resize(ui->CmdListsCount);
+	for (int i = 0; i < ui->CmdListsCount; i++)
+	{
+		if ((size_t)i == frame.UiLists.size())
+			frame.UiLists.push_back(std::make_shared<ImDrawList>(ImGui::GetDrawListSharedData()));
+
+		const ImDrawList* source = ui->CmdLists[i];
+		ImDrawList* list = frame.UiLists[i].get();
+		list->Flags = source->Flags;
+		CopyImVector(list->CmdBuffer, source->CmdBuffer);
+		CopyImVector(list->IdxBuffer, source->IdxBuffer);
+		CopyImVector(list->VtxBuffer, source->VtxBuffer);
+		uiCopy.CmdLists[i] = list;
+	}
+}
+
+// --------------------------------------------------------
+// Hands the frame Update just wrote to Draw, and what Draw
+// last found to the UI.  Neither is running when this is.
+// --------------------------------------------------------
+void Game::PublishFrame()
+{
+	frames.Publish();
+
+	shownStats = renderStats;
+	shownStats.UpdateTime = (float)(framePipeline->GetUpdateTime() * 1000.0);
+	shownStats.DrawTime = (float)(framePipeline->GetRenderTime() * 1000.0);
+	shownStats.FrameTime = (float)(framePipeline->GetFrameTime() * 1000.0);
+}
+
+// --------------------------------------------------------
+// Copies out the numbers the UI shows from the objects Draw
+// owns, as the UI can't look at them while Draw runs
+// --------------------------------------------------------
+void Game::GatherRenderStats()
+{
+	renderStats.CascadeCount = shadowCascades.GetCascadeCount();
+	for (unsigned int c = 0; c < renderStats.CascadeCount; c++)
+	{
+		renderStats.CascadeSplits[c][0] = shadowCascades.GetCascade(c).SplitNear;
+		renderStats.CascadeSplits[c][1] = shadowCascades.GetCascade(c).SplitFar;
+	}
+	renderStats.AtlasSlots = shadowAtlas.GetSlots();
+	renderStats.AtlasRepacked = shadowAtlas.WasFullyRepacked();
+
+	const ClusterShaderInfo& clusters = clusteredLighting->GetShaderInfo();
+	memcpy(renderStats.ClusterCounts, clusters.Counts, sizeof(renderStats.ClusterCounts));
+	renderStats.ClusterLightIndices = (unsigned int)clusteredLighting->GetBuilder().GetLightIndices().size();
+
+	const TileCullingConfig& tiles = tiledDeferred->GetCuller().GetConfig();
+	renderStats.TileCounts[0] = tiles.GetTileCountX();
+	renderStats.TileCounts[1] = tiles.GetTileCountY();
+	renderStats.TileLightIndices = (unsigned int)tiledDeferred->GetCuller().GetLightIndices().size();
+
+	renderStats.PassCount = renderGraph.GetPassCount();
+	renderStats.CulledPassCount = renderGraph.GetCulledPassCount();
+	renderStats.TransientTextureCount = renderGraph.GetTransientTextureCount();
+	renderStats.PhysicalTextureCount = renderGraph.GetPhysicalTextureCount();
+	const std::vector<uint32_t>& passOrder = renderGraph.GetPassOrder();
+	renderStats.PassNames.resize(passOrder.size());
+	for (size_t i = 0; i < passOrder.size(); i++)
+		renderStats.PassNames[i] = renderGraph.GetPassName(passOrder[i]);
+
+	renderStats.PooledTargetCount = renderTargetPool->GetTextureCount();
+	renderStats.PooledTargetMemory = renderTargetPool->GetMemoryUsage();
+	renderStats.CreatedTargetCount = renderTargetPool->GetCreatedCount();
+	renderStats.ReleasedTargetCount = renderTargetPool->GetReleasedCount();
+
+	renderStats.FrameArenaUsed = frameArena->GetUsedBytes();
+	renderStats.FrameArenaCapacity = frameArena->GetCapacity();
+	renderStats.FrameArenaHeapAllocations = frameArena->GetHeapAllocationCount();
 }
 
 // --------------------------------------------------------
@@ -803,113 +1680,197 @@ void Game::Update(float deltaTime, float totalTime)
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
+	// Everything from Update comes from the published frame
+	GameFrame& frame = frames.GetRead();
+
 	// Frame START
 	// - These things should happen ONCE PER FRAME
 	// - At the beginning of Game::Draw() before drawing *anything*
 	{
-		// Clear the back buffer (erases what's on the screen)
-		const float bgColor[4] = { 0.4f, 0.6f, 0.75f, 1.0f }; // Cornflower Blue
-		context->ClearRenderTargetView(backBufferRTV.Get(), bgColor);
+		// Reclaim constant ring space the GPU is done with
+		constantBufferRing->BeginFrame();
+
+		// Last frame's scratch memory is free again
+		frameArena->Reset();
+
+		// Start this frame's graph with the textures it doesn't own
+		renderGraph.Reset();
+		renderGraphDevice->ClearImports();
 
-		// Clear the depth buffer (resets per-pixel occlusion information)
-		context->ClearDepthStencilView(depthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+		// Switched here rather than in the UI, so materials never
+		// change under a frame that's drawing
+		if (frame.UseClusteredLighting != clusteredMaterials)
+			UpdateLightingFeatures(frame.UseClusteredLighting, (unsigned int)frame.Lights.size());
+
+		// Follow the entities' handles once, for every pass below
+		BuildEntityDraws(frame.Entities, meshes, materials, entityDraws);
 	}
 
-	// Pre Draw Post Process
+	// Nothing to look through, or no sun for the shadows (an
+	// empty world, or the entity is gone), so just the UI
+	if (!frame.ViewCamera || frame.Lights.empty() || frame.Lights.back().Type != LIGHT_TYPE_DIRECTIONAL)
 	{
 		const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f }; // Black
-		context->ClearRenderTargetView(ppBlurRTV.Get(), clearColor);
-
-		// Change the render target 
-		context->OMSetRenderTargets(1, ppBlurRTV.GetAddressOf(), depthBufferDSV.Get());
+		context->ClearRenderTargetView(backBufferRTV.Get(), clearColor);
+		PresentFrame(frame);
+		return;
 	}
 
+	RenderGraphTextureDesc screenDesc = GetPostProcessDesc(0, DXGI_FORMAT_R8G8B8A8_UNORM);
+	RenderGraphResource backBuffer = renderGraph.ImportTexture("Back Buffer", screenDesc,
+		renderGraphDevice->Import(backBufferRTV, 0, 0, windowWidth, windowHeight));
+
+	RenderGraphTextureDesc depthDesc = screenDesc;
+	depthDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	depthDesc.BindFlags = RENDER_GRAPH_BIND_DEPTH_STENCIL;
+	RenderGraphResource depth = renderGraph.ImportTexture("Depth", depthDesc,
+		renderGraphDevice->Import(0, 0, depthBufferDSV, windowWidth, windowHeight));
+
+	// Shadow maps are imported too, as they're cached across frames
+	RenderGraphTextureDesc shadowDesc;
+	shadowDesc.Width = shadowMapResolution;
+	shadowDesc.Height = shadowMapResolution;
+	shadowDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	shadowDesc.BindFlags = RENDER_GRAPH_BIND_DEPTH_STENCIL | RENDER_GRAPH_BIND_SHADER_RESOURCE;
+	RenderGraphResource shadowMap = renderGraph.ImportTexture("Shadow Cascades", shadowDesc,
+		renderGraphDevice->Import(0, shadowSRV, 0, shadowMapResolution, shadowMapResolution),
+		RENDER_GRAPH_STATE_SHADER_RESOURCE);
+
+	RenderGraphTextureDesc atlasDesc = shadowDesc;
+	atlasDesc.Width = shadowAtlasConfig.AtlasSize;
+	atlasDesc.Height = shadowAtlasConfig.AtlasSize;
+	RenderGraphResource atlasMap = renderGraph.ImportTexture("Shadow Atlas", atlasDesc,
+		renderGraphDevice->Import(0, shadowAtlasSRV, 0, shadowAtlasConfig.AtlasSize, shadowAtlasConfig.AtlasSize),
+		RENDER_GRAPH_STATE_SHADER_RESOURCE);
+
 	// Render shadows
 	{
-		// Clear the shadow map
-		context->ClearDepthStencilView(shadowDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
-
-		// Set the output merger stage
-		ID3D11RenderTargetView* nullRTV{};
-		context->OMSetRenderTargets(1, &nullRTV, shadowDSV.Get());
-
-		// Set Rasterizer
-		context->RSSetState(shadowRasterizer.Get());
-
-		// Deactivate pixel shader
-		context->PSSetShader(0, 0, 0);
+		// Fit the cascades to this frame's camera, along the sun's direction
+		// (the last light, which is the one that casts shadows)
+		Transform& cameraTransform = frame.ViewCamera->GetTransform();
+		XMFLOAT3 cameraPosition = cameraTransform.GetPosition();
+		XMFLOAT3 cameraRight = cameraTransform.GetRight();
+		XMFLOAT3 cameraUp = cameraTransform.GetUp();
+		XMFLOAT3 cameraForward = cameraTransform.GetForward();
+		XMFLOAT4X4 cameraProjection = frame.ViewCamera->GetProjection();
+
+		ShadowCascadeCamera cascadeCamera;
+		memcpy(cascadeCamera.Position, &cameraPosition, sizeof(float) * 3);
+		memcpy(cascadeCamera.Right, &cameraRight, sizeof(float) * 3);
+		memcpy(cascadeCamera.Up, &cameraUp, sizeof(float) * 3);
+		memcpy(cascadeCamera.Forward, &cameraForward, sizeof(float) * 3);
+		cascadeCamera.NearZ = frame.ViewCamera->GetNearClip();
+		cascadeCamera.FarZ = frame.ViewCamera->GetFarClip();
+		cascadeCamera.TanHalfFovX = 1.0f / cameraProjection._11;
+		cascadeCamera.TanHalfFovY = 1.0f / cameraProjection._22;
+
+		XMFLOAT3 sunDirection = frame.Lights.back().Direction;
+		shadowCascades.Update(frame.CascadeConfig, cascadeCamera, &sunDirection.x);
+		shadowCascades.GetShaderInfo(shadowCascadeInfo);
+
+		// Work out what actually changed since last frame
+		ShadowCacheView cacheViews[MAX_SHADOW_CASCADES];
+		for (unsigned int c = 0; c < shadowCascades.GetCascadeCount(); c++)
+		{
+			memcpy(cacheViews[c].ViewProjection, shadowCascades.GetCascade(c).ViewProjection, sizeof(float) * 16);
+			cacheViews[c].Resolution = shadowMapResolution;
+		}
 
-		// Change viewport
-		D3D11_VIEWPORT viewport = {};
-		viewport.Width = (float)shadowMapResolution;
-		viewport.Height = (float)shadowMapResolution;
-		viewport.MaxDepth = 1.0f;
-		context->RSSetViewports(1, &viewport);
+		shadowCasters.resize(entityDraws.size());
+		jobSystem->ParallelFor((uint32_t)entityDraws.size(), ENTITIES_PER_JOB, [&](uint32_t first, uint32_t end, uint32_t thread) {
+			for (uint32_t i = first; i < end; i++)
+			{
+				const EntityDraw& draw = entityDraws[i];
+				ShadowCaster& caster = shadowCasters[i];
+				XMFLOAT4X4 world = draw.Entity->GetTransform().GetWorldMatrix();
+				XMFLOAT3 boundsCenter;
+				draw.Entity->GetWorldBoundingSphere(*draw.EntityMesh, boundsCenter, caster.Radius);
+
+				caster.Id = i;
+				caster.Static = draw.Entity->IsStatic();
+				memcpy(caster.World, &world, sizeof(float) * 16);
+				memcpy(caster.Center, &boundsCenter, sizeof(float) * 3);
+			}
+		});
+
+		if (!frame.UseShadowCache)
+			shadowCache.Invalidate();
+		shadowCache.Update(cacheViews, shadowCascades.GetCascadeCount(), shadowCasters.data(), (uint32_t)shadowCasters.size());
+
+		// Nothing moved, so last frame's maps are still right
+		renderStats.ShadowPassSkipped = shadowCache.IsIdle();
+		for (unsigned int c = 0; c < MAX_SHADOW_CASCADES; c++)
+		{
+			renderStats.ShadowCasterCounts[c] = 0;
+			renderStats.ShadowRegionCounts[c] = 0;
+		}
 
-		// Entity render loop
-		shadowVS->SetShader();
-		shadowVS->SetMatrix4x4("view", lightViewMatrix);
-		shadowVS->SetMatrix4x4("projection", lightProjectionMatrix);
-		// Loop and draw all entities
-		for (auto& e : entities)
+		if (!renderStats.ShadowPassSkipped)
 		{
-			shadowVS->SetMatrix4x4("world", e->GetTransform().GetWorldMatrix());
-			shadowVS->CopyAllBufferData();
-			// Draw the mesh directly to avoid the entity's material
-			// Note: Your code may differ significantly here!
-			e->GetMesh()->Draw();
+			// The pass binds each cascade's slice itself
+			uint32_t pass = renderGraph.AddPass("Shadow Cascades", [this](const RenderGraphPassResources& resources) { RenderShadowCascades(); });
+			shadowMap = renderGraph.Write(pass, shadowMap, RENDER_GRAPH_STATE_DEPTH_WRITE);
 		}
 
-		// Reset the pipeline
-		viewport.Width = (float)this->windowWidth;
-		viewport.Height = (float)this->windowHeight;
-		context->RSSetViewports(1, &viewport);
-		context->OMSetRenderTargets(1, ppBlurRTV.GetAddressOf(), depthBufferDSV.Get());
+		// Point & spot lights
+		uint32_t pass = renderGraph.AddPass("Shadow Atlas", [=, this](const RenderGraphPassResources& resources) { RenderShadowAtlas(cascadeCamera); });
+		atlasMap = renderGraph.Write(pass, atlasMap, RENDER_GRAPH_STATE_DEPTH_WRITE);
 	}
 
-	for (unsigned int i = 0; i < entities.size(); i++)
+	// Lit entities & sky, into the texture the post process reads
+	RenderGraphResource scene = renderGraph.CreateTexture("Scene", screenDesc);
 	{
-		// Set shadow inputs
-		entities[i]->GetMaterial()->GetVertexShader()->SetMatrix4x4("lightView", lightViewMatrix);
-		entities[i]->GetMaterial()->GetVertexShader()->SetMatrix4x4("lightProjection", lightProjectionMatrix);
-
-		// Setting shader inputs
-		entities[i]->GetMaterial()->GetPixelShader()->SetFloat3("ambientColor", ambientColor);
-		entities[i]->GetMaterial()->GetPixelShader()->SetData("lights", &lights[0], sizeof(Light) * (int)lights.size());
-
-		// Set shadow map and sampler
-		entities[i]->GetMaterial()->GetPixelShader()->SetShaderResourceView("ShadowMap", shadowSRV);
-		entities[i]->GetMaterial()->GetPixelShader()->SetSamplerState("ShadowSampler", shadowSampler);
+		uint32_t pass = renderGraph.AddPass("Scene", [=, this](const RenderGraphPassResources& resources) {
+			DrawScene(renderGraphDevice->GetRTV(resources.GetTexture(scene)).Get());
+		});
+		renderGraph.Read(pass, shadowMap);
+		renderGraph.Read(pass, atlasMap);
 
-		entities[i]->DrawEntity(context, camera);
+		const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f }; // Black
+		scene = renderGraph.WriteRenderTarget(pass, scene, RENDER_GRAPH_LOAD_CLEAR, clearColor);
+		renderGraph.WriteDepthStencil(pass, depth, RENDER_GRAPH_LOAD_CLEAR, 1.0f);
 	}
 
-	skyBox->Draw(camera);
-
 	//  Post Draw Post Process
 	{
-		context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), 0);
+		int levelCount = PostPyramid::GetLevelCount(windowWidth, windowHeight);
+		if (frame.PostEffect == POST_EFFECT_BLOOM)
+			AddPostBloomPasses(scene, backBuffer, levelCount);
+		else
+			AddPostBlurPasses(scene, backBuffer, levelCount);
+	}
 
-		// Activate shaders and bind resources
-		// Also set any required cbuffer data (not shown)
-		ppVS->SetShader();
-		ppBlurPS->SetShader();
-		
-		ppBlurPS->SetShaderResourceView("Pixels", ppBlurSRV.Get());
-		ppBlurPS->SetSamplerState("ClampSampler", ppSampler.Get());
+	// Run it all
+	if (renderGraph.Compile(renderTargetPool.get()))
+		renderGraph.Execute(renderGraphDevice.get());
+	else
+		printf("Render graph error: %s\n", renderGraph.GetError().c_str());
 
-		ppBlurPS->SetInt("blurRadius", blurRadius);
-		ppBlurPS->SetFloat("pixelWidth", 1.0f / windowWidth);
-		ppBlurPS->SetFloat("pixelHeight", 1.0f / windowHeight);
-		ppBlurPS->CopyAllBufferData();
+	// Let go of targets nothing has wanted in a while
+	renderTargetPool->EndFrame();
+	GatherRenderStats();
+}
 
-		// Present tot he user
-		context->Draw(3, 0);
+// --------------------------------------------------------
+// Draws the UI over the back buffer and presents it (on the
+// main thread, after Draw - see FramePipeline)
+// --------------------------------------------------------
+void Game::Present()
+{
+	GameFrame& frame = frames.GetRead();
+
+	// Back to the full screen for the UI
+	{
+		D3D11_VIEWPORT viewport = {};
+		viewport.Width = (float)this->windowWidth;
+		viewport.Height = (float)this->windowHeight;
+		viewport.MaxDepth = 1.0f;
+		context->RSSetViewports(1, &viewport);
+		context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), 0);
 	}
 
-	// ImGui rendering
-	ImGui::Render();
-	ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+	// ImGui rendering (from the lists Update copied out)
+	ImGui_ImplDX11_RenderDrawData(&frame.UiDrawData);
 
 	// Frame END
 	// - These should happen exactly ONCE PER FRAME
@@ -923,6 +1884,9 @@ void Game::Draw(float deltaTime, float totalTime)
 			vsyncNecessary ? 1 : 0,
 			vsyncNecessary ? 0 : DXGI_PRESENT_ALLOW_TEARING);
 
+		// Fence this frame's constant ring allocations
+		constantBufferRing->EndFrame();
+
 		// Must re-bind buffers after presenting, as they become unbound
 		context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthBufferDSV.Get());
 
@@ -3,16 +3,126 @@
 #include "DXCore.h"
 #include <DirectXMath.h>
 #include "SimpleShader.h"
+#include "ConstantBufferRing.h"
+#include "ShaderPermutations.h"
+#include "ClusteredLighting.h"
+#include "TiledDeferredRenderer.h"
+#include "ShadowCascades.h"
+#include "ShadowCache.h"
+#include "ShadowAtlas.h"
+#include "DynamicStructuredBuffer.h"
+#include "GaussianKernel.h"
+#include "PostPyramid.h"
+#include "RenderGraph.h"
+#include "RenderTargetPool.h"
+#include "D3D11RenderGraphDevice.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+#include "CommandRecorder.h"
+#include "D3D11CommandBackend.h"
+#include "D3D11RHIDevice.h"
 #include "Mesh.h"
 #include "Material.h"
 #include "Lights.h"
 #include "Camera.h"
 #include "GameEntity.h"
+#include "HandlePool.h"
+#include "SceneWorld.h"
+#include "WorldStreamer.h"
 #include "Sky.h"
+#include "imgui/imgui.h"
+#include <optional>
+#include <string>
 #include <vector>
 #include <memory>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 
+// How the lit entities are drawn
+#define RENDER_PATH_FORWARD			0
+#define RENDER_PATH_TILED_DEFERRED	1
+
+// What the post process pyramid is used for
+#define POST_EFFECT_BLUR	0
+#define POST_EFFECT_BLOOM	1
+
+// --------------------------------------------------------
+// Everything Draw reads that Update can change.  Update
+// fills one in at the end of every frame and Draw only reads
+// the published one, so the two can run at the same time
+// (see FramePipeline).
+// --------------------------------------------------------
+struct GameFrame
+{
+	// Copies of the live entities & active camera (the meshes
+	// & materials the entities' handles find aren't made or
+	// destroyed while the game runs, so Draw reads the pools)
+	std::vector<GameEntity> Entities;
+	std::optional<Camera> ViewCamera;
+	std::vector<Light> Lights;
+	DirectX::XMFLOAT3 AmbientColor;
+
+	// Settings from the UI
+	bool UseClusteredLighting;
+	bool UseShadowCache;
+	bool ParallelRecording;
+	int RenderPath;
+	int SceneChunkSize;
+	ShadowCascadeConfig CascadeConfig;
+	int PostEffect;
+	int BlurRadius;
+	float BloomThreshold;
+	float BloomKnee;
+	float BloomIntensity;
+
+	// The UI, copied out of ImGui into lists the frame keeps
+	ImDrawData UiDrawData;
+	std::vector<std::shared_ptr<ImDrawList>> UiLists;
+};
+
+// --------------------------------------------------------
+// What Draw did, for the UI to show.  Draw fills it in and
+// it's copied for Update when the frame is published.
+// --------------------------------------------------------
+struct GameRenderStats
+{
+	// Shadows
+	bool ShadowPassSkipped = false;
+	unsigned int CascadeCount = 0;
+	float CascadeSplits[MAX_SHADOW_CASCADES][2] = {};	// Near, far
+	unsigned int ShadowCasterCounts[MAX_SHADOW_CASCADES] = {};
+	unsigned int ShadowRegionCounts[MAX_SHADOW_CASCADES] = {};
+	std::vector<ShadowAtlasSlot> AtlasSlots;
+	unsigned int AtlasRenderCount = 0;
+	bool AtlasRepacked = false;
+
+	// Light assignment
+	unsigned int ClusterCounts[3] = {};
+	unsigned int ClusterLightIndices = 0;
+	unsigned int TileCounts[2] = {};
+	unsigned int TileLightIndices = 0;
+
+	// Render graph & the targets it borrows
+	unsigned int PassCount = 0;
+	unsigned int CulledPassCount = 0;
+	unsigned int TransientTextureCount = 0;
+	unsigned int PhysicalTextureCount = 0;
+	std::vector<std::string> PassNames;
+	unsigned int PooledTargetCount = 0;
+	uint64_t PooledTargetMemory = 0;
+	unsigned int CreatedTargetCount = 0;
+	unsigned int ReleasedTargetCount = 0;
+
+	// Draw's frame arena
+	uint64_t FrameArenaUsed = 0;
+	uint64_t FrameArenaCapacity = 0;
+	uint64_t FrameArenaHeapAllocations = 0;
+
+	// Stage times from the frame pipeline, in milliseconds
+	float UpdateTime = 0;
+	float DrawTime = 0;
+	float FrameTime = 0;
+};
+
 class Game 
 	: public DXCore
 {
@@ -23,50 +133,108 @@ public:
 
 	// Overridden setup and game loop methods, which
 	// will be called automatically
-	void Init();
+	HRESULT Init();
 	void OnResize();
+	void FixedUpdate(float step, float time);
 	void Update(float deltaTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
+	void PublishFrame();
+	void Present();
 
 private:
 
 	// Initialization helper methods - feel free to customize, combine, remove, etc.
 	void LoadShaders(); 
-	void CreateGeometry();
+	bool LoadScene(const std::wstring& path);
+	SceneEntity CreateSceneEntity(const SceneFileEntity& fileEntity);
+	void UpdateLightingFeatures(bool clustered, unsigned int lightCount);
+
+	// Frame hand over
+	void WriteFrame(GameFrame& frame);
+	void GatherRenderStats();
+
+	// Frame passes
+	void DrawScene(ID3D11RenderTargetView* target);
+	void DrawSceneEntities(ID3D11DeviceContext* drawContext, ID3D11RenderTargetView* target, size_t first, size_t count);
 
-	// Post Process Functions
-	void ResizeAllPostProcessResources();
-	void ResizeOnePostProcessResource(
-		Microsoft::WRL::ComPtr<ID3D11RenderTargetView>& rtv,
-		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv,
-		float renderTargetScale = 1.0f,
-		DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM);
+	// Shadow map helpers
+	void RenderShadowCascades();
+	void RenderShadowAtlas(const ShadowCascadeCamera& cascadeCamera);
+	void RenderShadowCascade(ID3D11DeviceContext* drawContext, unsigned int cascade);
+	void DrawShadowCasters(
+		ID3D11DeviceContext* drawContext,
+		const uint32_t* casterIndices,
+		size_t casterCount,
+		const DirectX::XMFLOAT4X4& view,
+		const DirectX::XMFLOAT4X4& projection);
+
+	// Post process passes
+	RenderGraphTextureDesc GetPostProcessDesc(int level, DXGI_FORMAT format);
+	void AddPyramidDownsamplePasses(RenderGraphResource levels[], int levelCount, bool threshold);
+	void AddPostBlurPasses(RenderGraphResource scene, RenderGraphResource backBuffer, int levelCount);
+	void AddPostBloomPasses(RenderGraphResource scene, RenderGraphResource backBuffer, int levelCount);
 
 	// Note the usage of ComPtr below
 	//  - This is a smart pointer for objects that abide by the
 	//     Component Object Model, which DirectX objects do
 	//  - More info here: https://github.com/Microsoft/DirectXTK/wiki/ComPtr
 
-	// Objects
-	std::vector<std::shared_ptr<Mesh>> meshes;
-	std::vector<std::shared_ptr<GameEntity>> entities;
+	// Backend-agnostic device that meshes & the sky are made with
+	std::shared_ptr<D3D11RHIDevice> rhiDevice;
+
+	// Meshes & materials, in pools and referred to by handle
+	HandlePool<Mesh> meshes;
+	HandlePool<Material> materials;
+	std::vector<MeshHandle> sceneMeshes;			// By index in the scene file
+	std::vector<MaterialHandle> sceneMaterials;
+
+	// Entities, cameras & lights are entities in the scene
+	// world, made of components (see GameEntity.h)
+	SceneWorld world;
+	std::vector<SceneEntity> entityHandles;	// In demo scene order
+	std::vector<SceneEntity> cameraHandles;
+	std::vector<SceneEntity> lightHandles;		// In the order the lights are drawn (the sun last)
+	SceneEntity activeCamera;
+
+	// Streamed scenes' entities come and go around the camera
+	// (and aren't in entityHandles)
+	std::shared_ptr<WorldStreamer> worldStreamer;
 
-	// Resources
-	std::vector<std::shared_ptr<Material>> materials;
+	// Systems run over the world by every fixed step, and the
+	// step they're running for
+	SceneSchedule fixedSystems;
+	float fixedStep;
+	float fixedTime;
 
-	// Camera
-	std::shared_ptr<Camera> camera;
-	std::vector<std::shared_ptr<Camera>> cameras;
+	// This frame's entities with their meshes & materials
+	// looked up, for every pass that draws them (rebuilt as
+	// each Draw starts)
+	std::vector<EntityDraw> entityDraws;
 
 	// Lights
-	std::vector<Light> lights;
+	std::shared_ptr<ClusteredLighting> clusteredLighting;
+	bool useClusteredLighting;
+	bool clusteredMaterials;	// What Draw last switched the materials to
 
 	// Shaders and shader-related constructs
 	std::shared_ptr<SimpleVertexShader> vertexShader;
 	std::shared_ptr<SimplePixelShader> pixelShader;
 	std::shared_ptr<SimplePixelShader> patternShader;
 	std::shared_ptr<SimplePixelShader> normalShader;
+	std::shared_ptr<ShaderPermutations> shaderPermutations;
 	std::shared_ptr<SimpleVertexShader> shadowVS;
+	SimpleShaderHandle shadowWorldHandle;
+	SimpleShaderHandle shadowViewHandle;
+	SimpleShaderHandle shadowProjectionHandle;
+
+	// Tiled deferred path
+	std::shared_ptr<SimplePixelShader> gBufferPS;
+	std::shared_ptr<SimplePixelShader> deferredLightingPS;
+	std::shared_ptr<TiledDeferredRenderer> tiledDeferred;
+	int renderPath;
+
+	// Shared ring for per-draw constant data
+	std::shared_ptr<ConstantBufferRing> constantBufferRing;
 
 	// Sky
 	std::shared_ptr<SimpleVertexShader> skyBoxVS;
@@ -76,27 +244,107 @@ private:
 	// Ambient term
 	DirectX::XMFLOAT3 ambientColor;
 
-	// Shadow mapping resources
-	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowDSV;
+	// Shadow mapping resources (one array slice per cascade)
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowDSVs[MAX_SHADOW_CASCADES];
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowSRV;
 	Microsoft::WRL::ComPtr<ID3D11RasterizerState> shadowRasterizer;
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> shadowSampler;
-	DirectX::XMFLOAT4X4 lightViewMatrix;
-	DirectX::XMFLOAT4X4 lightProjectionMatrix;
+
+	// Cascades, refit to the camera every frame
+	ShadowCascades shadowCascades;
+	ShadowCascadeConfig shadowCascadeConfig;
+	ShadowCascadeShaderInfo shadowCascadeInfo;
+
+	// Static casters are cached in their own depth array and
+	// restored under whatever the dynamic casters dirtied
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> staticShadowDSVs[MAX_SHADOW_CASCADES];
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> staticShadowSRV;
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> shadowRestoreRasterizer;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> shadowRestoreDepthState;
+	std::shared_ptr<SimplePixelShader> shadowRestorePS;
+	SimpleShaderHandle shadowRestoreSliceHandle;
+	ShadowCache shadowCache;
+	std::vector<ShadowCaster> shadowCasters;
+	bool useShadowCache;
+
+	// Point & spot light shadows, packed into one depth atlas
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowAtlasDSV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowAtlasSRV;
+	ShadowAtlas shadowAtlas;
+	ShadowAtlasConfig shadowAtlasConfig;
+	std::vector<ShadowAtlasLight> shadowAtlasLights;
+	std::vector<ShadowCaster> shadowAtlasPreviousCasters;
+	std::vector<ShadowAtlasShaderFace> shadowAtlasFaces;
+	std::vector<int> lightShadowFaces;	// (first face, count) per light
+	std::shared_ptr<DynamicStructuredBuffer> shadowAtlasFaceBuffer;
+	std::shared_ptr<DynamicStructuredBuffer> lightShadowFaceBuffer;
 
 	// Shadow helper variables
 	unsigned int shadowMapResolution;
 
+	// The frame's passes, and the textures they pass between them
+	// (borrowed from the pool, which is declared first so the
+	// graph can hand its textures back on the way out)
+	std::shared_ptr<D3D11RenderGraphDevice> renderGraphDevice;
+	std::shared_ptr<RenderTargetPool> renderTargetPool;
+	RenderGraph renderGraph;
+
+	// Worker threads for everything that can run in parallel
+	std::shared_ptr<JobSystem> jobSystem;
+
+	// Draw's scratch memory (and its jobs', by thread), reset
+	// as each Draw starts.  Only Draw uses it, as Update can
+	// run alongside when the frame is pipelined.
+	std::shared_ptr<FrameArena> frameArena;
+
+	// What Update hands Draw each frame, and what Draw hands
+	// back (written by Draw, then shown by the UI)
+	FrameSnapshots<GameFrame> frames;
+	GameRenderStats renderStats;
+	GameRenderStats shownStats;
+
+	// Shadow cascades and chunks of the scene are recorded as
+	// jobs into deferred contexts
+	std::shared_ptr<D3D11CommandBackend> commandBackend;
+	std::shared_ptr<CommandRecorder> commandRecorder;
+	bool parallelRecording;
+	int sceneChunkSize;
+
 	// Post Process Resources
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> ppSampler;
 	std::shared_ptr<SimpleVertexShader> ppVS;
 
 	// Resources that are tied to a particular post process
 	std::shared_ptr<SimplePixelShader> ppBlurPS;
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> ppBlurRTV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ppBlurSRV;
+	SimpleShaderHandle ppBlurTapCountHandle;
+	SimpleShaderHandle ppBlurPixelStepHandle;
 
-	// Blur level
+	// Blur level, and the Gaussian taps last uploaded for it
 	int blurRadius;
+	int blurTapRadius;
+	int blurTapLevel;
+	unsigned int blurTapCount;
+	std::shared_ptr<DynamicStructuredBuffer> blurTapBuffer;
+
+	// Half resolution chain for wide blurs and bloom (its levels
+	// are render graph transients)
+	std::shared_ptr<SimplePixelShader> ppDownsamplePS;
+	SimpleShaderHandle ppDownsamplePixelSizeHandle;
+	SimpleShaderHandle ppDownsampleApplyThresholdHandle;
+	SimpleShaderHandle ppDownsampleThresholdHandle;
+	SimpleShaderHandle ppDownsampleKneeHandle;
+	std::shared_ptr<SimplePixelShader> ppUpsamplePS;
+	SimpleShaderHandle ppUpsamplePixelSizeHandle;
+	SimpleShaderHandle ppUpsampleIntensityHandle;
+	std::shared_ptr<SimplePixelShader> ppCompositePS;
+	SimpleShaderHandle ppCompositeBloomPixelSizeHandle;
+	SimpleShaderHandle ppCompositeBloomIntensityHandle;
+	Microsoft::WRL::ComPtr<ID3D11BlendState> additiveBlendState;
+
+	// Bloom settings
+	int postEffect;
+	float bloomThreshold;
+	float bloomKnee;
+	float bloomIntensity;
 };
 
@@ -1,9 +1,11 @@
 #include "GameEntity.h"
+#include "D3D11RHIDevice.h"
 
 // Constructor
-GameEntity::GameEntity(std::shared_ptr<Mesh> _mesh, std::shared_ptr<Material> _material) :
+GameEntity::GameEntity(MeshHandle _mesh, MaterialHandle _material) :
 	mesh(_mesh),
-	material(_material)
+	material(_material),
+	isStatic(false)
 {
     transform = Transform();
 }
@@ -14,7 +16,7 @@ GameEntity::~GameEntity()
 }
 
 // Mesh getter
-std::shared_ptr<Mesh> GameEntity::GetMesh()
+MeshHandle GameEntity::GetMesh()
 {
     return mesh;
 }
@@ -26,46 +28,95 @@ Transform& GameEntity::GetTransform()
 }
 
 // Material getter
-std::shared_ptr<Material> GameEntity::GetMaterial()
+MaterialHandle GameEntity::GetMaterial()
 {
 	return material;
 }
 
+// World space bounding sphere - the mesh's sphere (found
+// with this entity's handle), moved and scaled (by the
+// largest axis) with the transform
+void GameEntity::GetWorldBoundingSphere(Mesh& mesh, DirectX::XMFLOAT3& center, float& radius)
+{
+	DirectX::XMFLOAT3 localCenter = mesh.GetBoundsCenter();
+	DirectX::XMFLOAT4X4 world = transform.GetWorldMatrix();
+	DirectX::XMStoreFloat3(&center, DirectX::XMVector3TransformCoord(
+		DirectX::XMLoadFloat3(&localCenter),
+		DirectX::XMLoadFloat4x4(&world)));
+
+	DirectX::XMFLOAT3 scale = transform.GetScale();
+	float maxScale = fabsf(scale.x);
+	if (fabsf(scale.y) > maxScale) maxScale = fabsf(scale.y);
+	if (fabsf(scale.z) > maxScale) maxScale = fabsf(scale.z);
+	radius = mesh.GetBoundsRadius() * maxScale;
+}
+
 // Material setter
-void GameEntity::SetMaterial(std::shared_ptr<Material> _material)
+void GameEntity::SetMaterial(MaterialHandle _material)
 {
 	material = _material;
 }
 
+// Static flag getter & setter
+bool GameEntity::IsStatic()
+{
+	return isStatic;
+}
+
+void GameEntity::SetStatic(bool _isStatic)
+{
+	isStatic = _isStatic;
+}
+
 
 // Draw method
-void GameEntity::DrawEntity(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera)
+void GameEntity::DrawEntity(ID3D11DeviceContext* context, Mesh& mesh, Material& material, Camera& camera)
 {
 	// Update constant buffer
-	std::shared_ptr<SimpleVertexShader> vs = material->GetVertexShader();
-	std::shared_ptr<SimplePixelShader> ps = material->GetPixelShader();
+	const std::shared_ptr<SimpleVertexShader>& vs = material.GetVertexShader();
+	const std::shared_ptr<SimplePixelShader>& ps = material.GetPixelShader();
+	const MaterialShaderHandles& handles = material.GetShaderHandles();
 
-	ps->SetFloat3("colorTint", material->GetColorTint());
-	ps->SetFloat("roughness", material->GetRoughness());
-	ps->SetFloat3("cameraPosition", camera->GetTransform().GetPosition());
+	ps->SetFloat3(handles.colorTint, material.GetColorTint());
+	ps->SetFloat(handles.roughness, material.GetRoughness());
+	ps->SetFloat3(handles.cameraPosition, camera.GetTransform().GetPosition());
 
-	vs->SetMatrix4x4("world", transform.GetWorldMatrix());
-	vs->SetMatrix4x4("worldInvTranspose", transform.GetWorldInverseTransposeMatrix());
-	vs->SetMatrix4x4("view", camera->GetView());
-	vs->SetMatrix4x4("projection", camera->GetProjection());
+	vs->SetMatrix4x4(handles.world, transform.GetWorldMatrix());
+	vs->SetMatrix4x4(handles.worldInvTranspose, transform.GetWorldInverseTransposeMatrix());
+	vs->SetMatrix4x4(handles.view, camera.GetView());
+	vs->SetMatrix4x4(handles.projection, camera.GetProjection());
 
 	// Prepares the textures
-	material->PrepareTextures();
+	material.PrepareTextures(context);
 	
 	// Map the data
-	vs->CopyAllBufferData();
-	ps->CopyAllBufferData();
+	vs->CopyAllBufferData(context);
+	ps->CopyAllBufferData(context);
 
 	// Activate the shaders
-	material->GetVertexShader()->SetShader();
-	material->GetPixelShader()->SetShader();
+	vs->SetShader(context);
+	ps->SetShader(context);
 
 	// Draw the mesh
-	mesh->Draw();
+	D3D11RHIContext rhiContext(context);
+	mesh.Draw(&rhiContext);
 }
 
+// --------------------------------------------------------
+// Follows the handles of a frame's entities, once for all
+// the passes that draw them.  Draws aren't made for an
+// entity whose mesh or material has been destroyed.
+// --------------------------------------------------------
+void BuildEntityDraws(std::vector<GameEntity>& entities, HandlePool<Mesh>& meshes, HandlePool<Material>& materials, std::vector<EntityDraw>& draws)
+{
+	draws.clear();
+	for (GameEntity& entity : entities)
+	{
+		EntityDraw draw;
+		draw.Entity = &entity;
+		draw.EntityMesh = meshes.Get(entity.GetMesh());
+		draw.EntityMaterial = materials.Get(entity.GetMaterial());
+		if (draw.EntityMesh && draw.EntityMaterial)
+			draws.push_back(draw);
+	}
+}
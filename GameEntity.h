@@ -6,34 +6,87 @@
 #include "Transform.h"
 #include "DXCore.h"
 #include "Camera.h"
+#include "HandlePool.h"
 #include <d3d11.h>
 #include <memory>
+#include <vector>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 
+class GameEntity;
+
+// Handles into the game's pools
+typedef Handle<Mesh> MeshHandle;
+typedef Handle<Material> MaterialHandle;
+
 class GameEntity
 {
 public:
-	GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material);
+	GameEntity(MeshHandle mesh, MaterialHandle material);
 	~GameEntity();
 
 	// --= Methods =--
 
 	// Getters
-	std::shared_ptr<Mesh> GetMesh();
+	MeshHandle GetMesh();
 	Transform& GetTransform();
-	std::shared_ptr<Material> GetMaterial();
+	MaterialHandle GetMaterial();
+	void GetWorldBoundingSphere(Mesh& mesh, DirectX::XMFLOAT3& center, float& radius);
+	bool IsStatic();
 
 	// Setters
-	void SetMaterial(std::shared_ptr<Material> material);
+	void SetMaterial(MaterialHandle material);
+	void SetStatic(bool isStatic);
 
-	// Draw method
-	void DrawEntity(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
-					std::shared_ptr<Camera> camera);
+	// Draw method (with the mesh & material its handles find)
+	void DrawEntity(ID3D11DeviceContext* context, Mesh& mesh, Material& material, Camera& camera);
 
 private:
 	// --= Fields =--
 	Transform transform;
-	std::shared_ptr<Mesh> mesh;
-	std::shared_ptr<Material> material;
+	MeshHandle mesh;
+	MaterialHandle material;
+
+	// Static entities promise not to move, so systems like
+	// the shadow cache can keep their results between frames
+	bool isStatic;
+};
+
+// --------------------------------------------------------
+// Scene world components that go with GameEntity (which is
+// one too, as are Camera and Light)
+// --------------------------------------------------------
+
+// Where the entity was as of the step before last, so it
+// can be drawn part way between steps
+struct PreviousTransform
+{
+	Transform Value;
+};
+
+// Spins the entity about its up axis and bobs it back and
+// forth along an axis every fixed step
+struct EntityMotion
+{
+	float SpinSpeed;			// Radians per second
+	DirectX::XMFLOAT3 Bob;		// Scaled by sin(time)
+	DirectX::XMFLOAT3 Center;	// Where it bobs around
+};
+
+// --------------------------------------------------------
+// An entity with its mesh & material looked up, so a frame
+// only follows the handles once however many passes draw it
+// --------------------------------------------------------
+struct EntityDraw
+{
+	GameEntity* Entity;
+	Mesh* EntityMesh;
+	Material* EntityMaterial;
 };
 
+// Looks up every entity's mesh & material, leaving out any
+// entity with a stale handle to either
+void BuildEntityDraws(
+	std::vector<GameEntity>& entities,
+	HandlePool<Mesh>& meshes,
+	HandlePool<Material>& materials,
+	std::vector<EntityDraw>& draws);
@@ -0,0 +1,145 @@
+#include "GaussianKernel.h"
+
+#include <cmath>
+
+// Clamped texel fetch and bilinear sample along one axis
+// (stride is the distance between neighbouring texels)
+static float Fetch(const float* line, int count, int stride, int index)
+{
+	if (index < 0) index = 0;
+	if (index > count - 1) index = count - 1;
+	return line[index * stride];
+}
+
+static float SampleLinear(const float* line, int count, int stride, float position)
+{
+	float base = floorf(position);
+	float t = position - base;
+	int index = (int)base;
+	return Fetch(line, count, stride, index) * (1.0f - t) + Fetch(line, count, stride, index + 1) * t;
+}
+
+// --------------------------------------------------------
+// Three standard deviations covers 99.7% of the curve, so
+// the weights past the radius are negligible
+// --------------------------------------------------------
+float GaussianKernel::GetDefaultSigma(int radius)
+{
+	return radius > 0 ? radius / 3.0f : 1.0f;
+}
+
+// --------------------------------------------------------
+// Samples the Gaussian at whole texel offsets and normalizes
+// --------------------------------------------------------
+void GaussianKernel::ComputeWeights(int radius, float sigma, std::vector<float>& weights)
+{
+	if (radius < 0) radius = 0;
+	if (radius > GAUSSIAN_MAX_RADIUS) radius = GAUSSIAN_MAX_RADIUS;
+
+	weights.resize(radius + 1);
+	float total = 0.0f;
+	for (int i = 0; i <= radius; i++)
+	{
+		weights[i] = expf(-(float)(i * i) / (2.0f * sigma * sigma));
+		total += i == 0 ? weights[i] : weights[i] * 2.0f;
+	}
+
+	for (float& weight : weights)
+		weight /= total;
+}
+
+// --------------------------------------------------------
+// Texels i and i+1 with weights a and b are covered by one
+// bilinear sample at i + b / (a + b), weighted a + b
+// --------------------------------------------------------
+void GaussianKernel::ComputeLinearTaps(const std::vector<float>& weights, std::vector<GaussianTap>& taps)
+{
+	taps.clear();
+	if (weights.empty())
+		return;
+
+	taps.push_back({ 0.0f, weights[0] });
+	for (size_t i = 1; i < weights.size(); i += 2)
+	{
+		// An odd one out at the end is sampled on its own
+		if (i + 1 >= weights.size())
+		{
+			taps.push_back({ (float)i, weights[i] });
+			break;
+		}
+
+		float weight = weights[i] + weights[i + 1];
+		float offset = i + weights[i + 1] / weight;
+		taps.push_back({ offset, weight });
+	}
+}
+
+// --------------------------------------------------------
+// Two passes of bilinear taps, exactly as the shader does
+// --------------------------------------------------------
+void GaussianKernel::BlurSeparable(const float* source, int width, int height, int channels, const std::vector<GaussianTap>& taps, float* result)
+{
+	std::vector<float> horizontal((size_t)width * height * channels);
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		const float* input = pass == 0 ? source : horizontal.data();
+		float* output = pass == 0 ? horizontal.data() : result;
+
+		// Horizontal lines run along rows, vertical along columns
+		int lineCount = pass == 0 ? height : width;
+		int lineLength = pass == 0 ? width : height;
+		int stride = (pass == 0 ? 1 : width) * channels;
+		int lineStep = (pass == 0 ? width : 1) * channels;
+
+		for (int line = 0; line < lineCount; line++)
+		{
+			for (int c = 0; c < channels; c++)
+			{
+				const float* in = input + (size_t)line * lineStep + c;
+				float* out = output + (size_t)line * lineStep + c;
+
+				for (int i = 0; i < lineLength; i++)
+				{
+					float total = in[(size_t)i * stride] * taps[0].Weight;
+					for (size_t t = 1; t < taps.size(); t++)
+					{
+						total += taps[t].Weight * (
+							SampleLinear(in, lineLength, stride, i + taps[t].Offset) +
+							SampleLinear(in, lineLength, stride, i - taps[t].Offset));
+					}
+					out[(size_t)i * stride] = total;
+				}
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// The brute force version: every texel in the square,
+// weighted by the product of the 1D weights
+// --------------------------------------------------------
+void GaussianKernel::Convolve2D(const float* source, int width, int height, int channels, const std::vector<float>& weights, float* result)
+{
+	int radius = (int)weights.size() - 1;
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			for (int c = 0; c < channels; c++)
+			{
+				double total = 0.0;
+				for (int dy = -radius; dy <= radius; dy++)
+				{
+					int sy = y + dy < 0 ? 0 : (y + dy > height - 1 ? height - 1 : y + dy);
+					for (int dx = -radius; dx <= radius; dx++)
+					{
+						int sx = x + dx < 0 ? 0 : (x + dx > width - 1 ? width - 1 : x + dx);
+						total += (double)weights[abs(dx)] * weights[abs(dy)] * source[((size_t)sy * width + sx) * channels + c];
+					}
+				}
+				result[((size_t)y * width + x) * channels + c] = (float)total;
+			}
+		}
+	}
+}
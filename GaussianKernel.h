@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+// Largest radius the blur supports (the UI caps it lower)
+#define GAUSSIAN_MAX_RADIUS 64
+
+// One bilinear tap: sampled at +Offset and -Offset texels
+// (just once for the center tap, at offset 0)
+struct GaussianTap
+{
+	float Offset;
+	float Weight;
+};
+
+// --------------------------------------------------------
+// Weights for a separable Gaussian blur, and a CPU version
+// of the blur to check the GPU one against.
+//
+// A 2D Gaussian is the product of two 1D ones, so blurring
+// horizontally then vertically costs 2 * (2r + 1) samples
+// instead of (2r + 1)^2.  Bilinear filtering halves that
+// again: two neighbouring taps can be read with one sample
+// placed between them, weighted so the hardware's lerp gives
+// each texel its own weight.
+// --------------------------------------------------------
+class GaussianKernel
+{
+public:
+	// Sigma that puts the radius at three standard deviations
+	static float GetDefaultSigma(int radius);
+
+	// One-sided weights for offsets 0..radius, normalized so the
+	// full kernel (both sides) sums to 1
+	static void ComputeWeights(int radius, float sigma, std::vector<float>& weights);
+
+	// Merges pairs of weights into bilinear taps (the center
+	// stays on its own)
+	static void ComputeLinearTaps(const std::vector<float>& weights, std::vector<GaussianTap>& taps);
+
+	// CPU reference blurs over interleaved float images, with
+	// clamp-to-edge addressing like the post process sampler
+	static void BlurSeparable(const float* source, int width, int height, int channels, const std::vector<GaussianTap>& taps, float* result);
+	static void Convolve2D(const float* source, int width, int height, int channels, const std::vector<float>& weights, float* result);
+};
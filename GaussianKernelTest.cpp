@@ -0,0 +1,140 @@
+// --------------------------------------------------------
+// Tests GaussianKernel: the separable blur with bilinear taps
+// must give the same image as Convolve2D, the brute force
+// square of weights, for every radius the blur supports and
+// for images smaller than the kernel (where clamping at the
+// edges does most of the work).  Also checks the weights and
+// taps themselves.
+// --------------------------------------------------------
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "GaussianKernel.h"
+#include "TestCheck.h"
+
+// Repeatable noise, so edges and gradients all get blurred
+static std::vector<float> MakeImage(int width, int height, int channels, uint32_t seed)
+{
+	std::vector<float> image((size_t)width * height * channels);
+	for (float& value : image)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		value = (seed >> 8) / 16777216.0f;
+	}
+	return image;
+}
+
+// Largest difference between the two blurs of one image
+static float CompareBlurs(int width, int height, int channels, int radius, float sigma, uint32_t seed)
+{
+	std::vector<float> weights;
+	std::vector<GaussianTap> taps;
+	GaussianKernel::ComputeWeights(radius, sigma, weights);
+	GaussianKernel::ComputeLinearTaps(weights, taps);
+
+	std::vector<float> source = MakeImage(width, height, channels, seed);
+	std::vector<float> separable(source.size());
+	std::vector<float> reference(source.size());
+	GaussianKernel::BlurSeparable(source.data(), width, height, channels, taps, separable.data());
+	GaussianKernel::Convolve2D(source.data(), width, height, channels, weights, reference.data());
+
+	float worst = 0.0f;
+	for (size_t i = 0; i < source.size(); i++)
+		worst = fmaxf(worst, fabsf(separable[i] - reference[i]));
+	return worst;
+}
+
+static void TestWeights()
+{
+	for (int radius = 0; radius <= GAUSSIAN_MAX_RADIUS; radius++)
+	{
+		std::vector<float> weights;
+		GaussianKernel::ComputeWeights(radius, GaussianKernel::GetDefaultSigma(radius), weights);
+		CHECK(weights.size() == (size_t)radius + 1);
+
+		// Both sides sum to one, falling away from the center
+		double total = weights[0];
+		bool falling = true;
+		for (size_t i = 1; i < weights.size(); i++)
+		{
+			total += weights[i] * 2.0;
+			falling &= weights[i] <= weights[i - 1];
+		}
+		CHECK(fabs(total - 1.0) < 1e-5);
+		CHECK(falling);
+
+		// The taps carry the same total, half the samples
+		std::vector<GaussianTap> taps;
+		GaussianKernel::ComputeLinearTaps(weights, taps);
+		CHECK(taps.size() == (size_t)(radius + 1) / 2 + 1);
+		double tapTotal = taps[0].Weight;
+		for (size_t t = 1; t < taps.size(); t++)
+		{
+			tapTotal += taps[t].Weight * 2.0;
+			CHECK(taps[t].Offset > taps[t - 1].Offset);
+			CHECK(taps[t].Offset <= (float)radius);
+		}
+		CHECK(taps[0].Offset == 0.0f);
+		CHECK(fabs(tapTotal - 1.0) < 1e-5);
+	}
+
+	// Out of range radii are clamped
+	std::vector<float> weights;
+	GaussianKernel::ComputeWeights(-3, 1.0f, weights);
+	CHECK(weights.size() == 1 && weights[0] == 1.0f);
+	GaussianKernel::ComputeWeights(GAUSSIAN_MAX_RADIUS * 2, 10.0f, weights);
+	CHECK(weights.size() == GAUSSIAN_MAX_RADIUS + 1);
+}
+
+static void TestMatchesConvolve2D()
+{
+	static const int radii[] = { 0, 1, 2, 3, 4, 7, 12, 25 };
+	for (int radius : radii)
+	{
+		float sigma = GaussianKernel::GetDefaultSigma(radius);
+		CHECK(CompareBlurs(37, 23, 4, radius, sigma, radius * 31 + 1) < 1e-5f);
+
+		// Wider and narrower curves than the default
+		CHECK(CompareBlurs(19, 17, 1, radius, sigma * 2.0f, radius + 5) < 1e-5f);
+		CHECK(CompareBlurs(19, 17, 1, radius, sigma * 0.5f, radius + 9) < 1e-5f);
+	}
+
+	// The largest radius, on a small image to keep it quick
+	CHECK(CompareBlurs(24, 20, 1, GAUSSIAN_MAX_RADIUS, GaussianKernel::GetDefaultSigma(GAUSSIAN_MAX_RADIUS), 77) < 1e-5f);
+}
+
+static void TestSmallImages()
+{
+	// Images no bigger than the kernel, down to one texel
+	static const int sizes[][2] = { { 1, 1 }, { 1, 9 }, { 9, 1 }, { 2, 3 }, { 5, 5 } };
+	for (const int* size : sizes)
+	{
+		for (int radius : { 1, 4, 9 })
+			CHECK(CompareBlurs(size[0], size[1], 3, radius, GaussianKernel::GetDefaultSigma(radius), radius + size[0] * 10 + size[1]) < 1e-5f);
+	}
+
+	// A flat image stays flat, edges included
+	int width = 13;
+	int height = 6;
+	std::vector<float> weights;
+	std::vector<GaussianTap> taps;
+	GaussianKernel::ComputeWeights(8, GaussianKernel::GetDefaultSigma(8), weights);
+	GaussianKernel::ComputeLinearTaps(weights, taps);
+
+	std::vector<float> flat((size_t)width * height, 0.25f);
+	std::vector<float> result(flat.size());
+	GaussianKernel::BlurSeparable(flat.data(), width, height, 1, taps, result.data());
+	float worst = 0.0f;
+	for (float value : result)
+		worst = fmaxf(worst, fabsf(value - 0.25f));
+	CHECK(worst < 1e-6f);
+}
+
+int main()
+{
+	TestWeights();
+	TestMatchesConvolve2D();
+	TestSmallImages();
+	return TestResult();
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <memory>
+#include <new>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+// Items in each page of a pool
+#define HANDLE_POOL_PAGE_SIZE 256
+
+// Marks the end of a pool's free slot list
+#define HANDLE_POOL_NO_SLOT 0xFFFFFFFF
+
+// --------------------------------------------------------
+// Refers to an item in a HandlePool.  The generation says
+// which of the items its slot has held this one is, so a
+// handle to something destroyed (even if the slot has been
+// reused since) finds nothing rather than the wrong thing.
+// Handles are typed, so a mesh handle can't be passed where
+// a material's is wanted.
+//
+// A default handle is null - IsValid() only says a handle
+// isn't null, not that what it refers to is still alive
+// (ask the pool for that).
+// --------------------------------------------------------
+template<typename T>
+struct Handle
+{
+	uint32_t Index = 0;
+	uint32_t Generation = 0;
+
+	bool IsValid() const { return Generation != 0; }
+	bool operator==(const Handle& other) const { return Index == other.Index && Generation == other.Generation; }
+	bool operator!=(const Handle& other) const { return !(*this == other); }
+};
+
+// --------------------------------------------------------
+// Owns items of one type, made in place in pages of slots
+// and looked up by handle.  Items never move once made, so
+// pointers to them stay good until they're destroyed, and
+// types that can't be copied or moved can live in a pool.
+// Destroyed slots are reused, with the next generation.
+//
+// Not thread safe: reading items from several threads is
+// fine, but nothing may create or destroy while they do.
+// --------------------------------------------------------
+template<typename T>
+class HandlePool
+{
+public:
+	HandlePool() : count(0), firstFree(HANDLE_POOL_NO_SLOT) {}
+	~HandlePool() { Clear(); }
+
+	HandlePool(const HandlePool&) = delete;
+	HandlePool& operator=(const HandlePool&) = delete;
+
+	// Makes an item from the arguments (as T's constructor takes them)
+	template<typename... Args>
+	Handle<T> Create(Args&&... args)
+	{
+		uint32_t index = firstFree;
+		if (index != HANDLE_POOL_NO_SLOT)
+			firstFree = slots[index].NextFree;
+		else
+		{
+			// Generations start at 1, so null handles never match
+			index = (uint32_t)slots.size();
+			if (index % HANDLE_POOL_PAGE_SIZE == 0)
+				pages.push_back(std::unique_ptr<Page>(new Page));
+			slots.push_back(Slot{ 1, HANDLE_POOL_NO_SLOT, false });
+		}
+
+		new (GetItem(index)) T(std::forward<Args>(args)...);
+
+		Slot& slot = slots[index];
+		slot.Alive = true;
+		count++;
+		return Handle<T>{ index, slot.Generation };
+	}
+
+	// False if the handle was already stale
+	bool Destroy(Handle<T> handle)
+	{
+		if (!IsAlive(handle))
+			return false;
+
+		GetItem(handle.Index)->~T();
+
+		// The next item in this slot gets a new generation,
+		// skipping 0 (null) if it ever wraps around
+		Slot& slot = slots[handle.Index];
+		slot.Alive = false;
+		if (++slot.Generation == 0)
+			slot.Generation = 1;
+		slot.NextFree = firstFree;
+		firstFree = handle.Index;
+		count--;
+		return true;
+	}
+
+	// Destroys everything (old handles stay stale)
+	void Clear()
+	{
+		for (uint32_t i = 0; i < (uint32_t)slots.size(); i++)
+		{
+			if (slots[i].Alive)
+				Destroy(Handle<T>{ i, slots[i].Generation });
+		}
+	}
+
+	// Null if the handle is stale (or null)
+	T* Get(Handle<T> handle) { return IsAlive(handle) ? GetItem(handle.Index) : 0; }
+	const T* Get(Handle<T> handle) const { return IsAlive(handle) ? GetItem(handle.Index) : 0; }
+
+	bool IsAlive(Handle<T> handle) const
+	{
+		return handle.Index < slots.size() &&
+			slots[handle.Index].Alive &&
+			slots[handle.Index].Generation == handle.Generation;
+	}
+
+	// Calls function(handle, item) for every live item, in slot order
+	template<typename Function>
+	void ForEach(const Function& function)
+	{
+		for (uint32_t i = 0; i < (uint32_t)slots.size(); i++)
+		{
+			if (slots[i].Alive)
+				function(Handle<T>{ i, slots[i].Generation }, *GetItem(i));
+		}
+	}
+
+	// Slots by index, for loops that split the pool up (null
+	// for slots with nothing in them)
+	T* GetSlot(uint32_t index) { return index < slots.size() && slots[index].Alive ? GetItem(index) : 0; }
+	uint32_t GetSlotCount() const { return (uint32_t)slots.size(); }
+
+	// Getters
+	uint32_t GetCount() const { return count; }
+
+private:
+	// Lets HandlePoolTest put a slot near the end of its
+	// generations, rather than reusing it 4 billion times
+	friend struct HandlePoolTestAccess;
+
+	struct Slot
+	{
+		uint32_t Generation;
+		uint32_t NextFree;	// While it's free
+		bool Alive;
+	};
+
+	// Raw storage, constructed into as items are made
+	struct Page
+	{
+		alignas(T) unsigned char Items[sizeof(T) * HANDLE_POOL_PAGE_SIZE];
+	};
+
+	T* GetItem(uint32_t index) const
+	{
+		return (T*)pages[index / HANDLE_POOL_PAGE_SIZE]->Items + index % HANDLE_POOL_PAGE_SIZE;
+	}
+
+	std::vector<std::unique_ptr<Page>> pages;
+	std::vector<Slot> slots;
+	uint32_t count;
+	uint32_t firstFree;
+};
@@ -0,0 +1,163 @@
+// --------------------------------------------------------
+// Tests HandlePool:
+//
+//  - handles find what they made until it's destroyed, and
+//    nothing after - even once the slot holds something new
+//  - destroying twice, null handles and handles from Clear()
+//    are all turned away
+//  - items stay put as the pool grows past a page, and are
+//    destroyed exactly once
+//  - a slot's generation wraps around without ever being 0,
+//    so null handles never match
+// --------------------------------------------------------
+#include <vector>
+
+#include "HandlePool.h"
+#include "TestCheck.h"
+
+// Counts live items, and can't be copied or moved
+struct Tracked
+{
+	static int Alive;
+	int Value;
+
+	Tracked(int value) : Value(value) { Alive++; }
+	~Tracked() { Alive--; }
+	Tracked(const Tracked&) = delete;
+	Tracked& operator=(const Tracked&) = delete;
+};
+int Tracked::Alive = 0;
+
+struct HandlePoolTestAccess
+{
+	template<typename T>
+	static void SetGeneration(HandlePool<T>& pool, uint32_t index, uint32_t generation)
+	{
+		pool.slots[index].Generation = generation;
+	}
+};
+
+static void TestStaleHandles()
+{
+	HandlePool<Tracked> pool;
+	Handle<Tracked> first = pool.Create(1);
+	Handle<Tracked> second = pool.Create(2);
+	CHECK(first.IsValid() && second.IsValid());
+	CHECK(first != second);
+	CHECK(pool.GetCount() == 2);
+	CHECK(pool.Get(first)->Value == 1);
+	CHECK(pool.Get(second)->Value == 2);
+
+	// Gone once destroyed, and only destroyed once
+	CHECK(pool.Destroy(first));
+	CHECK(!pool.IsAlive(first));
+	CHECK(pool.Get(first) == 0);
+	CHECK(!pool.Destroy(first));
+	CHECK(pool.GetCount() == 1);
+	CHECK(Tracked::Alive == 1);
+
+	// The slot is reused, but the old handle still finds nothing
+	Handle<Tracked> reused = pool.Create(3);
+	CHECK(reused.Index == first.Index);
+	CHECK(reused.Generation != first.Generation);
+	CHECK(pool.Get(first) == 0);
+	CHECK(!pool.Destroy(first));
+	CHECK(pool.Get(reused)->Value == 3);
+	CHECK(pool.Get(second)->Value == 2);
+
+	// Null, and out of range
+	Handle<Tracked> null;
+	CHECK(!null.IsValid());
+	CHECK(pool.Get(null) == 0);
+	CHECK(!pool.Destroy(null));
+	CHECK(pool.Get(Handle<Tracked>{ 1000, 1 }) == 0);
+	CHECK(pool.GetSlot(1000) == 0);
+
+	// Clear destroys everything, and leaves every handle stale
+	pool.Clear();
+	CHECK(pool.GetCount() == 0);
+	CHECK(Tracked::Alive == 0);
+	CHECK(pool.Get(reused) == 0 && pool.Get(second) == 0);
+	CHECK(pool.GetSlot(second.Index) == 0);
+	Handle<Tracked> afterClear = pool.Create(4);
+	CHECK(afterClear != reused && afterClear != second);
+	CHECK(pool.Get(afterClear)->Value == 4);
+}
+
+static void TestGrowth()
+{
+	{
+		HandlePool<Tracked> pool;
+		std::vector<Handle<Tracked>> handles;
+		std::vector<Tracked*> items;
+		for (int i = 0; i < HANDLE_POOL_PAGE_SIZE * 3 + 5; i++)
+		{
+			handles.push_back(pool.Create(i));
+			items.push_back(pool.Get(handles.back()));
+		}
+
+		// Nothing moved as pages were added
+		bool stayed = true;
+		for (size_t i = 0; i < handles.size(); i++)
+			stayed &= pool.Get(handles[i]) == items[i] && items[i]->Value == (int)i;
+		CHECK(stayed);
+		CHECK(pool.GetSlotCount() == handles.size());
+
+		// Free every other one, then refill - without new slots
+		for (size_t i = 0; i < handles.size(); i += 2)
+			pool.Destroy(handles[i]);
+		int visited = 0;
+		bool odd = true;
+		pool.ForEach([&](Handle<Tracked> handle, Tracked& item) {
+			odd &= (item.Value % 2) == 1 && pool.Get(handle) == &item;
+			visited++;
+		});
+		CHECK(odd);
+		CHECK(visited == (int)handles.size() / 2);
+
+		for (size_t i = 0; i < handles.size(); i += 2)
+			pool.Create(-1);
+		CHECK(pool.GetSlotCount() == handles.size());
+		CHECK(pool.GetCount() == handles.size());
+		CHECK(Tracked::Alive == (int)handles.size());
+	}
+
+	// The pool destroys what's left when it goes
+	CHECK(Tracked::Alive == 0);
+}
+
+static void TestGenerationWrap()
+{
+	HandlePool<Tracked> pool;
+	Handle<Tracked> first = pool.Create(1);
+	pool.Destroy(first);
+
+	// The slot's on its last generation...
+	HandlePoolTestAccess::SetGeneration(pool, first.Index, 0xFFFFFFFF);
+	Handle<Tracked> last = pool.Create(2);
+	CHECK(last.Index == first.Index);
+	CHECK(last.Generation == 0xFFFFFFFF);
+	CHECK(pool.Get(last)->Value == 2);
+
+	// ...so the next one wraps around to 1, not to null's 0
+	CHECK(pool.Destroy(last));
+	Handle<Tracked> wrapped = pool.Create(3);
+	CHECK(wrapped.Index == first.Index);
+	CHECK(wrapped.Generation == 1);
+	CHECK(wrapped.IsValid());
+	CHECK(pool.Get(wrapped)->Value == 3);
+	CHECK(pool.Get(last) == 0);
+
+	// A null handle to the slot never matches what's in it
+	CHECK(pool.Get(Handle<Tracked>{ first.Index, 0 }) == 0);
+	CHECK(!pool.Destroy(Handle<Tracked>{ first.Index, 0 }));
+	CHECK(pool.GetCount() == 1);
+}
+
+int main()
+{
+	TestStaleHandles();
+	TestGrowth();
+	TestGenerationWrap();
+	return TestResult();
+}
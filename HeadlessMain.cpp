@@ -0,0 +1,501 @@
+// --------------------------------------------------------
+// Renders the demo scene with the software rasterizer - no
+// window, GPU or Direct3D - and saves it as a PNG, timing
+// each frame along the way.
+//
+// Built by CMakeLists.txt, anywhere DirectXMath builds:
+//
+//   HeadlessMain --assets Assets --out scene.png
+//                --scene Scenes/DemoScene.scene
+//                --width 1280 --height 720
+//                --frames 10 --threads 7
+//
+// It draws the scene's entities and sky from its first
+// camera.
+//
+// The image only depends on the options, not on the thread
+// count or timing.  Shadows and post processing are left out.
+//
+// It also counts heap allocations (it replaces operator new
+// and delete for the whole program), to check that frames
+// after the first one don't allocate at all.
+// --------------------------------------------------------
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+#include "Mesh.h"
+#include "PNGImage.h"
+#include "SceneFile.h"
+#include "SoftwareRHIDevice.h"
+#include "SoftwareShaders.h"
+#include "Transform.h"
+
+using namespace DirectX;
+
+static_assert(sizeof(PBRLight) == sizeof(Light), "PBRLight must match Light");
+static_assert(SOFTWARE_VERTEX_STRIDE == sizeof(Vertex), "Software shaders must match Vertex");
+
+// --------------------------------------------------------
+// Allocation counting: every form of new bumps the count.
+// The whole family is replaced together, so each delete
+// frees with whatever its new allocated with - the sized
+// deletes just forward to the unsized ones, and aligned
+// memory has its own pair (Windows' CRT can't free it with
+// free()).
+//
+// The frees are kept out of line, or GCC sees free() inlined
+// against a call to operator new and warns they don't match.
+// --------------------------------------------------------
+#ifdef _MSC_VER
+#define HEADLESS_NOINLINE __declspec(noinline)
+#else
+#define HEADLESS_NOINLINE __attribute__((noinline))
+#endif
+
+static std::atomic<uint64_t> heapAllocations(0);
+
+static void* CountedAllocate(size_t size)
+{
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	return malloc(size > 0 ? size : 1);
+}
+
+static void* CountedAllocateAligned(size_t size, std::align_val_t alignment)
+{
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	size_t align = (size_t)alignment;
+	size = size > 0 ? size : 1;
+#ifdef _WIN32
+	return _aligned_malloc(size, align);
+#else
+	// aligned_alloc() wants a whole number of alignments
+	return aligned_alloc(align, (size + align - 1) & ~(align - 1));
+#endif
+}
+
+HEADLESS_NOINLINE static void CountedFree(void* memory)
+{
+	free(memory);
+}
+
+HEADLESS_NOINLINE static void CountedFreeAligned(void* memory)
+{
+#ifdef _WIN32
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+void* operator new(size_t size)
+{
+	void* memory = CountedAllocate(size);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	void* memory = CountedAllocateAligned(size, alignment);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return CountedAllocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return CountedAllocateAligned(size, alignment);
+}
+
+void operator delete(void* memory) noexcept
+{
+	CountedFree(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	CountedFree(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	operator delete[](memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	operator delete[](memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+	CountedFreeAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+	CountedFreeAligned(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(memory, alignment);
+}
+
+void operator delete[](void* memory, size_t, std::align_val_t alignment) noexcept
+{
+	operator delete[](memory, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	operator delete(memory, alignment);
+}
+
+void operator delete[](void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	operator delete[](memory, alignment);
+}
+
+// Options
+struct HeadlessOptions
+{
+	std::string Assets = "Assets";
+	std::string Output = "scene.png";
+	std::string Scene = "Scenes/DemoScene.scene";	// In the assets
+	uint32_t Width = 1280;
+	uint32_t Height = 720;
+	uint32_t Frames = 10;
+	uint32_t Threads = 0;
+};
+
+static bool ParseOptions(int argc, char* argv[], HeadlessOptions& options)
+{
+	unsigned int cores = std::thread::hardware_concurrency();
+	options.Threads = cores > 1 ? cores - 1 : 0;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string name = argv[i];
+		const char* value = argv[i + 1];
+		if (name == "--assets") options.Assets = value;
+		else if (name == "--out") options.Output = value;
+		else if (name == "--scene") options.Scene = value;
+		else if (name == "--width") options.Width = (uint32_t)atoi(value);
+		else if (name == "--height") options.Height = (uint32_t)atoi(value);
+		else if (name == "--frames") options.Frames = (uint32_t)atoi(value);
+		else if (name == "--threads") options.Threads = (uint32_t)atoi(value);
+		else return false;
+	}
+
+	return (argc % 2) == 1 && options.Width > 0 && options.Height > 0 && options.Frames > 0;
+}
+
+// A missing texture stays empty, and reads as zero (like a null SRV)
+static void LoadTexture(const std::string& path, PNGImage& image)
+{
+	if (!LoadPNG(path, image))
+		printf("Couldn't load %s\n", path.c_str());
+}
+
+static uint64_t HashPixels(const std::vector<uint8_t>& pixels)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (uint8_t p : pixels)
+	{
+		hash ^= p;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+int main(int argc, char* argv[])
+{
+	HeadlessOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		printf("Usage: %s [--assets dir] [--out file.png] [--scene file] [--width w] [--height h] [--frames n] [--threads n]\n", argv[0]);
+		return 1;
+	}
+
+	std::shared_ptr<JobSystem> jobs = std::make_shared<JobSystem>(options.Threads);
+	std::shared_ptr<SoftwareRHIDevice> device = std::make_shared<SoftwareRHIDevice>(jobs);
+	SoftwareRHIContext& context = device->GetSoftwareContext();
+
+	SceneFile scene;
+	if (!scene.Load(options.Assets + "/" + options.Scene))
+	{
+		printf("Couldn't load %s: %s\n", options.Scene.c_str(), scene.GetError().c_str());
+		return 1;
+	}
+	const SceneFileHeader& header = scene.GetHeader();
+	if (header.Cameras.Count == 0 || header.Skies.Count == 0)
+	{
+		printf("%s needs a camera and a sky\n", options.Scene.c_str());
+		return 1;
+	}
+
+	// Every entity is drawn, so a streamed scene's cells (only
+	// checked as they stream in) are all checked now
+	if (header.Cells.Count > 0 && !scene.CheckEntities(header.Entities.Get(), header.Entities.Count))
+	{
+		printf("%s has an entity using a mesh or material that isn't there\n", options.Scene.c_str());
+		return 1;
+	}
+	uint32_t entityCount = header.Entities.Count;
+	const SceneFileSky& sceneSky = header.Skies[0];
+
+	// Textures & the sky decode as jobs while the meshes load
+	// (the device itself isn't thread safe)
+	JobCounter texturesLoaded;
+	std::vector<PNGImage> textures(header.Textures.Count);
+	for (uint32_t i = 0; i < header.Textures.Count; i++)
+	{
+		std::string path = options.Assets + "/" + scene.GetString(header.Textures[i].Path);
+		jobs->Run([&textures, path, i](uint32_t thread) { LoadTexture(path, textures[i]); }, &texturesLoaded);
+	}
+
+	SoftwareCubeMap sky;
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		std::string path = options.Assets + "/" + scene.GetString(sceneSky.Faces[face]);
+		jobs->Run([&sky, path, face](uint32_t thread) { LoadTexture(path, sky.Faces[face]); }, &texturesLoaded);
+	}
+
+	std::vector<std::shared_ptr<Mesh>> meshes;
+	for (uint32_t i = 0; i < header.Meshes.Count; i++)
+	{
+		std::string meshPath = options.Assets + "/" + scene.GetString(header.Meshes[i].Path);
+		meshes.push_back(std::make_shared<Mesh>(std::wstring(meshPath.begin(), meshPath.end()), device));
+		if (meshes.back()->GetIndexCount() == 0)
+		{
+			printf("Couldn't load %s\n", meshPath.c_str());
+			jobs->Wait(texturesLoaded);
+			return 1;
+		}
+	}
+	jobs->Wait(texturesLoaded);
+
+	// The scene, placed just like the game's
+	std::vector<Transform> transforms(entityCount);
+	for (uint32_t i = 0; i < entityCount; i++)
+	{
+		const SceneFileEntity& entity = header.Entities[i];
+		transforms[i].SetPosition(entity.Position);
+		transforms[i].SetRotation(entity.PitchYawRoll);
+		transforms[i].SetScale(entity.Scale);
+	}
+
+	std::vector<Light> lights(header.Lights.Get(), header.Lights.Get() + header.Lights.Count);
+
+	// The scene's first camera
+	const SceneFileCamera& sceneCamera = header.Cameras[0];
+	Transform cameraTransform;
+	cameraTransform.SetRotation(sceneCamera.PitchYawRoll);
+	XMFLOAT3 cameraPosition = sceneCamera.Position;
+	XMFLOAT3 cameraForward = cameraTransform.GetForward();
+	XMFLOAT4X4 view;
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&view, XMMatrixLookToLH(XMLoadFloat3(&cameraPosition), XMLoadFloat3(&cameraForward), XMVectorSet(0, 1, 0, 0)));
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(sceneCamera.FieldOfView, (float)options.Width / options.Height, sceneCamera.NearClip, sceneCamera.FarClip));
+
+	// Missing textures read as zero
+	PNGImage noTexture;
+
+	// Targets
+	RHITextureDesc colorDesc;
+	colorDesc.Width = options.Width;
+	colorDesc.Height = options.Height;
+	colorDesc.Format = 28;	// R8G8B8A8_UNORM
+	colorDesc.BindFlags = RHI_BIND_RENDER_TARGET;
+	RHITextureDesc depthDesc = colorDesc;
+	depthDesc.Format = 40;	// D32_FLOAT
+	depthDesc.BindFlags = RHI_BIND_DEPTH_STENCIL;
+
+	RHITexture colorTexture, depthTexture;
+	RHIView colorView, depthView;
+	device->CreateTexture(colorDesc, 0, 0, colorTexture);
+	device->CreateTexture(depthDesc, 0, 0, depthTexture);
+	device->CreateView(colorTexture, RHI_VIEW_RENDER_TARGET, colorView);
+	device->CreateView(depthTexture, RHI_VIEW_DEPTH_STENCIL, depthView);
+
+	// Same states as Sky
+	RHIPipelineStateDesc skyStateDesc;
+	skyStateDesc.CullMode = RHI_CULL_FRONT;
+	skyStateDesc.DepthFunc = RHI_COMPARISON_LESS_EQUAL;
+	skyStateDesc.DepthWrite = false;
+	RHIPipelineState skyState;
+	device->CreatePipelineState(skyStateDesc, skyState);
+
+	// Per entity constants don't change, so they're made once
+	std::vector<SoftwareVertexConstants> vertexConstants(entityCount);
+	std::vector<SoftwareLitPixelConstants> pixelConstants(entityCount);
+	for (uint32_t i = 0; i < entityCount; i++)
+	{
+		XMFLOAT4X4 world = transforms[i].GetWorldMatrix();
+		XMFLOAT4X4 worldInvTranspose = transforms[i].GetWorldInverseTransposeMatrix();
+		memcpy(vertexConstants[i].World, &world, sizeof(world));
+		memcpy(vertexConstants[i].WorldInvTranspose, &worldInvTranspose, sizeof(worldInvTranspose));
+		memcpy(vertexConstants[i].View, &view, sizeof(view));
+		memcpy(vertexConstants[i].Projection, &projection, sizeof(projection));
+
+		const SceneFileMaterial& material = header.Materials[header.Entities[i].Material];
+		SoftwareLitPixelConstants& ps = pixelConstants[i];
+		memset(&ps, 0, sizeof(ps));
+		ps.Roughness = material.Roughness;
+		memcpy(ps.ColorTint, &material.ColorTint, sizeof(material.ColorTint));
+		memcpy(ps.CameraPosition, &cameraPosition, sizeof(cameraPosition));
+		ps.LightCount = (uint32_t)(lights.size() < SOFTWARE_MAX_LIGHTS ? lights.size() : SOFTWARE_MAX_LIGHTS);
+		memcpy(ps.Lights, lights.data(), ps.LightCount * sizeof(Light));
+
+		const PNGImage* slots[SCENE_FILE_TEXTURE_SLOTS];
+		for (uint32_t slot = 0; slot < SCENE_FILE_TEXTURE_SLOTS; slot++)
+			slots[slot] = material.Textures[slot] == SCENE_FILE_NONE ? &noTexture : &textures[material.Textures[slot]];
+		ps.Albedo = slots[SCENE_FILE_TEXTURE_ALBEDO];
+		ps.RoughnessMap = slots[SCENE_FILE_TEXTURE_ROUGHNESS];
+		ps.MetalnessMap = slots[SCENE_FILE_TEXTURE_METALNESS];
+		ps.NormalMap = slots[SCENE_FILE_TEXTURE_NORMAL];
+	}
+
+	SoftwareSkyVertexConstants skyVertexConstants;
+	memcpy(skyVertexConstants.View, &view, sizeof(view));
+	memcpy(skyVertexConstants.Projection, &projection, sizeof(projection));
+	SoftwareSkyPixelConstants skyPixelConstants = { &sky };
+
+	// Frames
+	RHIViewport viewport;
+	viewport.Width = (float)options.Width;
+	viewport.Height = (float)options.Height;
+	const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	// (Reserved, so recording a frame's numbers doesn't allocate)
+	std::vector<double> frameTimes;
+	std::vector<uint64_t> frameAllocations;
+	frameTimes.reserve(options.Frames);
+	frameAllocations.reserve(options.Frames);
+	for (uint32_t frame = 0; frame < options.Frames; frame++)
+	{
+		uint64_t allocationsBefore = heapAllocations.load(std::memory_order_relaxed);
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		context.GetRasterizer().ResetStats();
+
+		context.ClearRenderTarget(colorView, clearColor);
+		context.ClearDepthStencil(depthView, 1.0f);
+		context.SetRenderTargets(&colorView, 1, depthView);
+		context.SetViewport(viewport);
+
+		// Entities
+		context.SetPipelineState(RHIPipelineState());
+		for (uint32_t i = 0; i < entityCount; i++)
+		{
+			context.SetShaders(
+				SoftwareVertexShaderMain, &vertexConstants[i],
+				SoftwareNormalPSMain, &pixelConstants[i], sizeof(SoftwareLitPixelConstants),
+				SOFTWARE_LIT_VARYING_COUNT);
+			meshes[header.Entities[i].Mesh]->Draw(&context);
+		}
+
+		// Sky
+		context.SetPipelineState(skyState);
+		context.SetShaders(
+			SoftwareSkyBoxVSMain, &skyVertexConstants,
+			SoftwareSkyBoxPSMain, &skyPixelConstants, sizeof(skyPixelConstants),
+			SOFTWARE_SKY_VARYING_COUNT);
+		meshes[sceneSky.Mesh]->Draw(&context);
+		context.Flush();
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		frameTimes.push_back(elapsed.count());
+		frameAllocations.push_back(heapAllocations.load(std::memory_order_relaxed) - allocationsBefore);
+	}
+
+	// Results
+	PNGImage image;
+	image.Width = options.Width;
+	image.Height = options.Height;
+	device->ReadTexture(colorTexture, image.Pixels);
+	if (!SavePNG(options.Output, image))
+	{
+		printf("Couldn't save %s\n", options.Output.c_str());
+		return 1;
+	}
+
+	double total = 0.0;
+	double fastest = frameTimes[0];
+	double slowest = frameTimes[0];
+	for (double t : frameTimes)
+	{
+		total += t;
+		fastest = t < fastest ? t : fastest;
+		slowest = t > slowest ? t : slowest;
+	}
+
+	// The first frame sizes the rasterizer's lists and the jobs' free lists
+	uint64_t laterAllocations = 0;
+	for (size_t f = 1; f < frameAllocations.size(); f++)
+		laterAllocations += frameAllocations[f];
+
+	SoftwareRasterizer& rasterizer = context.GetRasterizer();
+	printf("%ux%u, %u threads, %s coverage\n", options.Width, options.Height, rasterizer.GetThreadCount(), SoftwareRasterizer::HasSIMD() ? "SSE2" : "scalar");
+	printf("Frame: %.2f ms average, %.2f fastest, %.2f slowest (%u frames)\n", total / frameTimes.size(), fastest, slowest, options.Frames);
+	printf("Last frame: %llu triangles, %llu tile bins, %llu pixels shaded, %llu jobs stolen\n",
+		(unsigned long long)rasterizer.GetTriangleCount(),
+		(unsigned long long)rasterizer.GetBinnedCount(),
+		(unsigned long long)rasterizer.GetPixelCount(),
+		(unsigned long long)rasterizer.GetStolenCount());
+	printf("Heap allocations: %llu in the first frame, %llu in the %u after it\n",
+		(unsigned long long)frameAllocations[0], (unsigned long long)laterAllocations, options.Frames - 1);
+	printf("Wrote %s (pixel hash %016llx)\n", options.Output.c_str(), (unsigned long long)HashPixels(image.Pixels));
+
+	device->Destroy(skyState);
+	device->Destroy(colorView);
+	device->Destroy(depthView);
+	device->Destroy(colorTexture);
+	device->Destroy(depthTexture);
+	return 0;
+}
@@ -0,0 +1,514 @@
+#include "JobSystem.h"
+
+// Finished jobs each thread keeps for reuse
+#define JOB_SYSTEM_FREE_JOBS 256
+
+// Tries an idle worker makes before going to sleep
+#define JOB_SYSTEM_IDLE_SPINS 64
+
+// --------------------------------------------------------
+// A queued job: a function, or a run of a ParallelFor
+// --------------------------------------------------------
+struct Job
+{
+	JobFunction Function;
+	const JobRangeFunction* Range;
+	uint32_t First;
+	uint32_t End;
+	uint32_t MinRun;
+	JobCounter* Counter;
+
+	// The thread that made it, which gets it back to reuse
+	uint32_t Owner;
+	Job* NextFree;
+};
+
+thread_local const JobSystem* JobSystem::threadSystem = 0;
+thread_local uint32_t JobSystem::threadIndex = JOB_SYSTEM_NO_THREAD;
+
+// --------------------------------------------------------
+// Deque
+// --------------------------------------------------------
+JobDeque::JobDeque() :
+	top(0),
+	bottom(0),
+	jobs(new std::atomic<Job*>[JOB_SYSTEM_DEQUE_CAPACITY])
+{
+	for (uint32_t i = 0; i < JOB_SYSTEM_DEQUE_CAPACITY; i++)
+		jobs[i].store(0, std::memory_order_relaxed);
+}
+
+bool JobDeque::Push(Job* job)
+{
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+	if (b - t >= JOB_SYSTEM_DEQUE_CAPACITY)
+		return false;
+
+	jobs[b & (JOB_SYSTEM_DEQUE_CAPACITY - 1)].store(job, std::memory_order_relaxed);
+	bottom.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+Job* JobDeque::Pop()
+{
+	// Claim the bottom job before looking at what thieves took
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_seq_cst);
+
+	if (t > b)
+	{
+		bottom.store(b + 1, std::memory_order_release);
+		return 0;
+	}
+
+	Job* job = jobs[b & (JOB_SYSTEM_DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (t == b)
+	{
+		// The last one - race the thieves for it
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			job = 0;
+		bottom.store(b + 1, std::memory_order_release);
+	}
+	return job;
+}
+
+Job* JobDeque::Steal()
+{
+	int64_t t = top.load(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_seq_cst);
+	if (t >= b)
+		return 0;
+
+	Job* job = jobs[t & (JOB_SYSTEM_DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return 0;
+
+	return job;
+}
+
+bool JobDeque::IsEmpty() const
+{
+	return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------
+// Job system
+// --------------------------------------------------------
+JobSystem::JobSystem(uint32_t workerCount, JobThreadStart threadStart) :
+	threadStart(threadStart),
+	mainThread(std::this_thread::get_id()),
+	sharedCount(0),
+	queuedJobs(0),
+	sleepingWorkers(0),
+	quitting(false)
+{
+	for (uint32_t i = 0; i < workerCount + 1; i++)
+	{
+		threads.emplace_back(new ThreadState());
+		threads[i]->FreeJobs.reserve(JOB_SYSTEM_FREE_JOBS);
+		threads[i]->ReturnedJobs = 0;
+		threads[i]->Executed = 0;
+		threads[i]->Stolen = 0;
+		threads[i]->Random = 0x9E3779B9u * (i + 1);
+	}
+
+	for (uint32_t i = 0; i < workerCount; i++)
+		workers.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		quitting = true;
+	}
+	sleepCondition.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+
+	// Anything nobody waited for is dropped
+	for (std::unique_ptr<ThreadState>& state : threads)
+	{
+		while (Job* job = state->Deque.Pop())
+			delete job;
+		for (Job* job : state->FreeJobs)
+			delete job;
+		for (Job* job = state->ReturnedJobs.load(); job;)
+		{
+			Job* next = job->NextFree;
+			delete job;
+			job = next;
+		}
+	}
+	for (Job* job : sharedJobs)
+		delete job;
+}
+
+void JobSystem::Run(JobFunction job, JobCounter* counter)
+{
+	uint32_t thread = GetThreadIndex();
+	Job* queued = AllocateJob(thread);
+	queued->Function = std::move(job);
+	queued->Counter = counter;
+	if (counter)
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+	Push(queued, thread);
+}
+
+// --------------------------------------------------------
+// Parks the job on the dependency, unless it's already done.
+// Finish() pushes parked jobs when the count hits zero.
+// --------------------------------------------------------
+void JobSystem::RunAfter(JobCounter& dependency, JobFunction job, JobCounter* counter)
+{
+	uint32_t thread = GetThreadIndex();
+	Job* queued = AllocateJob(thread);
+	queued->Function = std::move(job);
+	queued->Counter = counter;
+	if (counter)
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+	{
+		std::lock_guard<std::mutex> lock(continuationMutex);
+		if (dependency.pending.load(std::memory_order_acquire) != 0)
+		{
+			dependency.continuations.push_back(queued);
+			return;
+		}
+	}
+	Push(queued, thread);
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	uint32_t thread = GetThreadIndex();
+	while (!counter.IsDone())
+	{
+		Job* job = FindJob(thread);
+		if (job)
+			Execute(job, thread);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t minRun, JobRangeFunction body)
+{
+	if (count == 0)
+		return;
+
+	// The caller runs the whole range, handing halves off as it goes
+	uint32_t thread = GetThreadIndex();
+	JobCounter counter;
+	counter.pending = 1;
+	ExecuteRange(0, count, minRun > 0 ? minRun : 1, &body, &counter, thread);
+	Finish(&counter, thread);
+	Wait(counter);
+}
+
+uint32_t JobSystem::GetThreadIndex() const
+{
+	if (threadSystem == this)
+		return threadIndex;
+
+	return std::this_thread::get_id() == mainThread ? 0 : JOB_SYSTEM_NO_THREAD;
+}
+
+uint64_t JobSystem::GetExecutedCount() const
+{
+	uint64_t total = 0;
+	for (const std::unique_ptr<ThreadState>& state : threads)
+		total += state->Executed.load(std::memory_order_relaxed);
+	return total;
+}
+
+uint64_t JobSystem::GetStolenCount() const
+{
+	uint64_t total = 0;
+	for (const std::unique_ptr<ThreadState>& state : threads)
+		total += state->Stolen.load(std::memory_order_relaxed);
+	return total;
+}
+
+// --------------------------------------------------------
+// Jobs are recycled, so steady work doesn't touch the heap.
+// A job goes back to the thread that made it: straight onto
+// its free list when it finished there, or onto its returned
+// stack from other threads, which the owner takes all of
+// when its list runs out.  (Otherwise threads that mostly
+// run jobs would pile them up while the ones that mostly
+// add jobs kept making new ones.)
+// --------------------------------------------------------
+Job* JobSystem::AllocateJob(uint32_t thread)
+{
+	Job* job = 0;
+	if (thread != JOB_SYSTEM_NO_THREAD)
+	{
+		std::vector<Job*>& freeJobs = threads[thread]->FreeJobs;
+		if (freeJobs.empty())
+		{
+			for (Job* returned = threads[thread]->ReturnedJobs.exchange(0, std::memory_order_acquire); returned;)
+			{
+				Job* next = returned->NextFree;
+				FreeJob(returned, thread);
+				returned = next;
+			}
+		}
+
+		if (!freeJobs.empty())
+		{
+			job = freeJobs.back();
+			freeJobs.pop_back();
+		}
+	}
+
+	if (!job)
+	{
+		job = new Job();
+		job->Owner = thread;
+	}
+	job->Range = 0;
+	job->Counter = 0;
+	return job;
+}
+
+void JobSystem::FreeJob(Job* job, uint32_t thread)
+{
+	// Let go of whatever the function captured now
+	job->Function = nullptr;
+
+	if (job->Owner == JOB_SYSTEM_NO_THREAD)
+	{
+		delete job;
+	}
+	else if (job->Owner != thread)
+	{
+		// Lock free push onto the owner's returned stack
+		std::atomic<Job*>& returned = threads[job->Owner]->ReturnedJobs;
+		job->NextFree = returned.load(std::memory_order_relaxed);
+		while (!returned.compare_exchange_weak(job->NextFree, job, std::memory_order_release, std::memory_order_relaxed));
+	}
+	else if (threads[thread]->FreeJobs.size() < JOB_SYSTEM_FREE_JOBS)
+	{
+		threads[thread]->FreeJobs.push_back(job);
+	}
+	else
+	{
+		delete job;
+	}
+}
+
+void JobSystem::Push(Job* job, uint32_t thread)
+{
+	// Counted first, so a worker never sleeps through a job
+	queuedJobs.fetch_add(1, std::memory_order_seq_cst);
+
+	if (thread != JOB_SYSTEM_NO_THREAD)
+	{
+		if (!threads[thread]->Deque.Push(job))
+		{
+			// Full - just run it
+			queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			Execute(job, thread);
+			return;
+		}
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(sharedMutex);
+		sharedJobs.push_back(job);
+		sharedCount.fetch_add(1, std::memory_order_release);
+	}
+
+	if (sleepingWorkers.load(std::memory_order_seq_cst) > 0)
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		sleepCondition.notify_one();
+	}
+}
+
+// --------------------------------------------------------
+// This thread's own jobs first, then outside jobs, then
+// steal, starting from a random thread
+// --------------------------------------------------------
+Job* JobSystem::FindJob(uint32_t thread)
+{
+	Job* job = 0;
+	if (thread != JOB_SYSTEM_NO_THREAD)
+		job = threads[thread]->Deque.Pop();
+
+	if (!job && sharedCount.load(std::memory_order_acquire) > 0)
+	{
+		std::lock_guard<std::mutex> lock(sharedMutex);
+		if (!sharedJobs.empty())
+		{
+			job = sharedJobs.front();
+			sharedJobs.pop_front();
+			sharedCount.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+
+	if (!job)
+	{
+		uint32_t count = (uint32_t)threads.size();
+		uint32_t start = 0;
+		if (thread != JOB_SYSTEM_NO_THREAD)
+		{
+			// xorshift
+			uint32_t& random = threads[thread]->Random;
+			random ^= random << 13;
+			random ^= random >> 17;
+			random ^= random << 5;
+			start = random % count;
+		}
+
+		for (uint32_t i = 0; i < count && !job; i++)
+		{
+			uint32_t victim = (start + i) % count;
+			if (victim != thread)
+				job = threads[victim]->Deque.Steal();
+		}
+
+		if (job && thread != JOB_SYSTEM_NO_THREAD)
+		{
+			std::atomic<uint64_t>& stolen = threads[thread]->Stolen;
+			stolen.store(stolen.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+	}
+
+	if (job)
+		queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	return job;
+}
+
+void JobSystem::Execute(Job* job, uint32_t thread)
+{
+	JobCounter* counter = job->Counter;
+	if (job->Range)
+		ExecuteRange(job->First, job->End, job->MinRun, job->Range, counter, thread);
+	else
+		job->Function(thread);
+
+	if (thread != JOB_SYSTEM_NO_THREAD)
+	{
+		std::atomic<uint64_t>& executed = threads[thread]->Executed;
+		executed.store(executed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	// Free before finishing, so captures are gone by the time a waiter wakes
+	FreeJob(job, thread);
+	Finish(counter, thread);
+}
+
+// --------------------------------------------------------
+// Runs [first, end) minRun items at a time, pushing the top
+// half back out whenever this thread's queue runs dry
+// --------------------------------------------------------
+void JobSystem::ExecuteRange(uint32_t first, uint32_t end, uint32_t minRun, const JobRangeFunction* body, JobCounter* counter, uint32_t thread)
+{
+	while (end - first > minRun)
+	{
+		if (IsHungry(thread))
+		{
+			uint32_t middle = first + (end - first) / 2;
+
+			Job* half = AllocateJob(thread);
+			half->Range = body;
+			half->First = middle;
+			half->End = end;
+			half->MinRun = minRun;
+			half->Counter = counter;
+			counter->pending.fetch_add(1, std::memory_order_relaxed);
+			Push(half, thread);
+
+			end = middle;
+			continue;
+		}
+
+		(*body)(first, first + minRun, thread);
+		first += minRun;
+	}
+
+	if (first < end)
+		(*body)(first, end, thread);
+}
+
+// --------------------------------------------------------
+// Counts a job off.  The last one takes the continuations
+// under the lock before the counter reads as done, as a
+// waiter may destroy the counter as soon as it does.
+// --------------------------------------------------------
+void JobSystem::Finish(JobCounter* counter, uint32_t thread)
+{
+	if (!counter)
+		return;
+
+	uint32_t pending = counter->pending.load(std::memory_order_relaxed);
+	while (pending > 1)
+	{
+		if (counter->pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+			return;
+	}
+
+	std::vector<Job*> ready;
+	{
+		std::lock_guard<std::mutex> lock(continuationMutex);
+		ready.swap(counter->continuations);
+		counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+	}
+
+	for (Job* job : ready)
+		Push(job, thread);
+}
+
+// Whether anything's queued here for other threads to steal
+bool JobSystem::IsHungry(uint32_t thread) const
+{
+	if (threads.size() < 2)
+		return false;
+
+	if (thread != JOB_SYSTEM_NO_THREAD)
+		return threads[thread]->Deque.IsEmpty();
+
+	return sharedCount.load(std::memory_order_relaxed) == 0;
+}
+
+void JobSystem::WorkerLoop(uint32_t thread)
+{
+	threadSystem = this;
+	threadIndex = thread;
+	if (threadStart)
+		threadStart(thread);
+
+	uint32_t idle = 0;
+	while (true)
+	{
+		Job* job = FindJob(thread);
+		if (job)
+		{
+			Execute(job, thread);
+			idle = 0;
+			continue;
+		}
+
+		if (quitting.load(std::memory_order_acquire))
+			return;
+
+		if (++idle < JOB_SYSTEM_IDLE_SPINS)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		idle = 0;
+
+		// Nothing to steal for a while, so sleep until something's queued
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+		sleepCondition.wait(lock, [&] { return quitting.load() || queuedJobs.load(std::memory_order_seq_cst) > 0; });
+		sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
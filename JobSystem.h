@@ -0,0 +1,179 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+// Returned by GetThreadIndex() on threads outside the pool
+#define JOB_SYSTEM_NO_THREAD 0xFFFFFFFF
+
+// Jobs each thread's deque holds before Run() just runs
+// new ones on the spot (must be a power of two)
+#define JOB_SYSTEM_DEQUE_CAPACITY 4096
+
+struct Job;
+
+typedef std::function<void(uint32_t thread)> JobFunction;
+typedef std::function<void(uint32_t first, uint32_t end, uint32_t thread)> JobRangeFunction;
+typedef std::function<void(uint32_t thread)> JobThreadStart;
+
+// --------------------------------------------------------
+// Counts jobs that haven't finished yet.  Run() adds one
+// and the job takes it away again when it's done, so one
+// counter can track any number of jobs; Wait() on it, or
+// RunAfter() it for a job that depends on all of them.
+//
+// Don't add jobs to a counter that has jobs waiting on it
+// (until they've started), or they'll start early.
+// --------------------------------------------------------
+class JobCounter
+{
+public:
+	JobCounter() : pending(0) {}
+
+	bool IsDone() const { return pending.load(std::memory_order_acquire) == 0; }
+	uint32_t GetPending() const { return pending.load(std::memory_order_relaxed); }
+
+private:
+	friend class JobSystem;
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	std::atomic<uint32_t> pending;
+
+	// Jobs to run once this reaches zero (guarded by the
+	// job system's continuation lock)
+	std::vector<Job*> continuations;
+};
+
+// --------------------------------------------------------
+// A single-owner, many-thief job queue (Chase & Lev, with
+// the memory orders from Le et al. 2013).  The owning
+// thread pushes and pops at the bottom, so its own work
+// stays LIFO and cache warm, while other threads steal the
+// oldest (and usually biggest) jobs from the top.
+// --------------------------------------------------------
+class JobDeque
+{
+public:
+	JobDeque();
+
+	// Owner only.  Push fails when the deque is full.
+	bool Push(Job* job);
+	Job* Pop();
+
+	// Any thread
+	Job* Steal();
+	bool IsEmpty() const;
+
+private:
+	std::atomic<int64_t> top;
+	std::atomic<int64_t> bottom;
+	std::unique_ptr<std::atomic<Job*>[]> jobs;
+};
+
+// --------------------------------------------------------
+// A fixed pool of worker threads that run small jobs.
+//
+// Every pool thread has its own deque: jobs are pushed onto
+// the deque of the thread that adds them, and threads with
+// nothing left steal from the others.  Threads are numbered
+// with the one that made the system as 0 and workers from
+// 1, and the thread start callback runs once on each worker
+// when it starts (for setting up per-thread state, like
+// SimpleShader's thread slots).
+//
+// Threads outside the pool can add jobs too (they go in a
+// shared queue) and wait on them, but only pool threads
+// keep their own deques.
+//
+// Waiting never blocks: the waiting thread runs other jobs
+// until its counter is done, so jobs can wait on jobs.
+// Wait on everything before destroying the system.
+// --------------------------------------------------------
+class JobSystem
+{
+public:
+	JobSystem(uint32_t workerCount, JobThreadStart threadStart = 0);
+	~JobSystem();
+
+	// Queues a job, adding it to the counter (if any)
+	void Run(JobFunction job, JobCounter* counter = 0);
+
+	// Queues a job that starts once dependency is done
+	void RunAfter(JobCounter& dependency, JobFunction job, JobCounter* counter = 0);
+
+	// Runs jobs on this thread until the counter is done
+	void Wait(JobCounter& counter);
+
+	// --------------------------------------------------------
+	// Calls body on runs of [0, count) across every thread and
+	// waits for them all.  A run is only split in half when
+	// its thread's deque is empty - so there's a half ready to
+	// steal whenever a thread runs dry, and ranges stay whole
+	// when everyone's busy.  Runs are never split below
+	// minRun items.
+	// --------------------------------------------------------
+	void ParallelFor(uint32_t count, uint32_t minRun, JobRangeFunction body);
+
+	// This thread's number (JOB_SYSTEM_NO_THREAD outside the pool)
+	uint32_t GetThreadIndex() const;
+
+	uint32_t GetThreadCount() const { return (uint32_t)threads.size(); }
+	uint32_t GetWorkerCount() const { return (uint32_t)workers.size(); }
+
+	// Totals since the system started
+	uint64_t GetExecutedCount() const;
+	uint64_t GetStolenCount() const;
+
+private:
+	struct alignas(64) ThreadState
+	{
+		JobDeque Deque;
+		std::vector<Job*> FreeJobs;
+		std::atomic<Job*> ReturnedJobs;		// Its jobs other threads finished
+		std::atomic<uint64_t> Executed;
+		std::atomic<uint64_t> Stolen;
+		uint32_t Random;
+	};
+
+	Job* AllocateJob(uint32_t thread);
+	void FreeJob(Job* job, uint32_t thread);
+	void Push(Job* job, uint32_t thread);
+	Job* FindJob(uint32_t thread);
+	void Execute(Job* job, uint32_t thread);
+	void ExecuteRange(uint32_t first, uint32_t end, uint32_t minRun, const JobRangeFunction* body, JobCounter* counter, uint32_t thread);
+	void Finish(JobCounter* counter, uint32_t thread);
+	bool IsHungry(uint32_t thread) const;
+	void WorkerLoop(uint32_t thread);
+
+	std::vector<std::unique_ptr<ThreadState>> threads;
+	std::vector<std::thread> workers;
+	JobThreadStart threadStart;
+	std::thread::id mainThread;
+
+	// Jobs from threads outside the pool
+	std::mutex sharedMutex;
+	std::deque<Job*> sharedJobs;
+	std::atomic<uint32_t> sharedCount;
+
+	// Guards every counter's continuations
+	std::mutex continuationMutex;
+
+	// Idle workers sleep until there are jobs queued
+	std::atomic<int32_t> queuedJobs;
+	std::atomic<uint32_t> sleepingWorkers;
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+	std::atomic<bool> quitting;
+
+	static thread_local const JobSystem* threadSystem;
+	static thread_local uint32_t threadIndex;
+};
@@ -0,0 +1,180 @@
+// --------------------------------------------------------
+// Measures the job system: what a job costs on its own, and
+// how three kinds of work speed up as workers are added -
+//
+//  - parallel for: one big loop of independent math
+//  - fork / join:  a recursive split where jobs wait on jobs
+//  - many jobs:    lots of small independent jobs from one thread
+//
+// Built by CMakeLists.txt:
+//
+//   JobSystemBenchmarkMain --threads 16 --repeats 5
+// --------------------------------------------------------
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Enough math per item that the loop isn't memory bound
+static float Work(uint32_t item)
+{
+	float x = (float)item * 0.001f;
+	for (int i = 0; i < 64; i++)
+		x = sinf(x) * 0.5f + cosf(x * 0.25f);
+	return x;
+}
+
+static uint64_t Fib(JobSystem& jobs, uint32_t n)
+{
+	if (n < 16)
+	{
+		uint64_t a = 0, b = 1;
+		for (uint32_t i = 0; i < n; i++)
+		{
+			uint64_t next = a + b;
+			a = b;
+			b = next;
+		}
+
+		// Some work at the leaves, so jobs aren't all overhead
+		float x = 0;
+		for (uint32_t i = 0; i < 256; i++)
+			x += Work(i);
+		return x == 12345.0f ? 0 : a;
+	}
+
+	uint64_t left = 0;
+	JobCounter counter;
+	jobs.Run([&](uint32_t thread) { left = Fib(jobs, n - 1); }, &counter);
+	uint64_t right = Fib(jobs, n - 2);
+	jobs.Wait(counter);
+	return left + right;
+}
+
+// Best time of a few runs, in seconds
+template<typename F>
+static double Time(uint32_t repeats, F run)
+{
+	double best = 1e30;
+	for (uint32_t r = 0; r < repeats; r++)
+	{
+		auto start = Clock::now();
+		run();
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		best = seconds < best ? seconds : best;
+	}
+	return best;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned int cores = std::thread::hardware_concurrency();
+	uint32_t maxThreads = cores > 0 ? cores : 1;
+	uint32_t repeats = 5;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string name = argv[i];
+		if (name == "--threads") maxThreads = (uint32_t)atoi(argv[i + 1]);
+		else if (name == "--repeats") repeats = (uint32_t)atoi(argv[i + 1]);
+	}
+	if (maxThreads == 0 || repeats == 0)
+	{
+		printf("Usage: JobSystemBenchmarkMain [--threads count] [--repeats count]\n");
+		return 1;
+	}
+
+	printf("%u hardware threads, best of %u runs\n\n", cores, repeats);
+
+	// --------------------------------------------------------
+	// Overhead: empty jobs, start to finish, per job
+	// --------------------------------------------------------
+	const uint32_t emptyJobs = 1 << 18;
+	printf("Overhead per job (ns)\n");
+	printf("threads  run+wait  parallel for item\n");
+	for (uint32_t threads : { 1u, maxThreads })
+	{
+		JobSystem jobs(threads - 1);
+		double runWait = Time(repeats, [&]()
+		{
+			JobCounter counter;
+			for (uint32_t i = 0; i < emptyJobs; i++)
+				jobs.Run([](uint32_t thread) {}, &counter);
+			jobs.Wait(counter);
+		});
+		double forItem = Time(repeats, [&]()
+		{
+			jobs.ParallelFor(emptyJobs, 1, [](uint32_t first, uint32_t end, uint32_t thread) {});
+		});
+		printf("%7u  %8.1f  %17.1f\n", threads, runWait * 1e9 / emptyJobs, forItem * 1e9 / emptyJobs);
+
+		if (threads == maxThreads)
+			break;
+	}
+
+	// --------------------------------------------------------
+	// Speedup, against one thread
+	// --------------------------------------------------------
+	std::vector<uint32_t> threadCounts;
+	for (uint32_t t = 1; t < maxThreads; t *= 2)
+		threadCounts.push_back(t);
+	threadCounts.push_back(maxThreads);
+
+	const uint32_t loopItems = 1 << 16;
+	const uint32_t fibN = 24;
+	const uint32_t smallJobs = 1 << 14;
+	std::vector<float> results(loopItems);
+
+	printf("\nSpeedup (ms, and x over one thread)\n");
+	printf("threads  parallel for        fork / join         many jobs           stolen\n");
+	double baseline[3] = {};
+	for (uint32_t threads : threadCounts)
+	{
+		JobSystem jobs(threads - 1);
+		uint64_t stolenBefore = jobs.GetStolenCount();
+
+		double times[3];
+		times[0] = Time(repeats, [&]()
+		{
+			jobs.ParallelFor(loopItems, 16, [&](uint32_t first, uint32_t end, uint32_t thread)
+			{
+				for (uint32_t i = first; i < end; i++)
+					results[i] = Work(i);
+			});
+		});
+
+		uint64_t fib = 0;
+		times[1] = Time(repeats, [&]() { fib = Fib(jobs, fibN); });
+
+		times[2] = Time(repeats, [&]()
+		{
+			JobCounter counter;
+			for (uint32_t i = 0; i < smallJobs; i++)
+				jobs.Run([&results, i](uint32_t thread) { results[i] = Work(i); }, &counter);
+			jobs.Wait(counter);
+		});
+
+		if (threads == 1)
+		{
+			for (int k = 0; k < 3; k++)
+				baseline[k] = times[k];
+		}
+
+		printf("%7u", threads);
+		for (int k = 0; k < 3; k++)
+			printf("  %8.2f (%5.2fx)", times[k] * 1e3, baseline[k] / times[k]);
+		printf("  %llu\n", (unsigned long long)(jobs.GetStolenCount() - stolenBefore));
+
+		// (Keeps the work from being optimized away)
+		if (fib == 0 || results[1] == 12345.0f)
+			printf("unexpected result\n");
+	}
+
+	return 0;
+}
@@ -0,0 +1,325 @@
+// --------------------------------------------------------
+// Tests JobSystem and its work-stealing deque:
+//
+//  - the deque pops its owner's newest job and lets thieves
+//    take the oldest, and with thieves stealing while the
+//    owner pushes and pops, every job comes out exactly once
+//  - every job runs exactly once, whichever thread adds it
+//    (workers, the main thread, or one outside the pool),
+//    and jobs can add and wait on jobs of their own
+//  - RunAfter() jobs start only once everything their
+//    counter tracks has finished
+//  - ParallelFor covers every index exactly once, for any
+//    count and run length
+//
+// Each runs with and without workers.
+// --------------------------------------------------------
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+#include "TestCheck.h"
+
+#define DEQUE_JOB_COUNT 200000
+#define DEQUE_THIEF_COUNT 3
+
+// The deque only moves pointers around, so these tests hand
+// it pointers to counters rather than real jobs
+static Job* AsJob(std::atomic<uint32_t>& taken) { return reinterpret_cast<Job*>(&taken); }
+static std::atomic<uint32_t>* AsTaken(Job* job) { return reinterpret_cast<std::atomic<uint32_t>*>(job); }
+
+// Is every count exactly one?
+static bool AllOnce(const std::vector<std::atomic<uint32_t>>& counts)
+{
+	for (const std::atomic<uint32_t>& count : counts)
+	{
+		if (count.load() != 1)
+			return false;
+	}
+	return true;
+}
+
+static void TestDequeOrder()
+{
+	std::vector<std::atomic<uint32_t>> slots(4);
+	JobDeque deque;
+	CHECK(deque.IsEmpty());
+	CHECK(deque.Pop() == 0);
+	CHECK(deque.Steal() == 0);
+
+	// The owner gets the newest, thieves the oldest
+	for (std::atomic<uint32_t>& slot : slots)
+		CHECK(deque.Push(AsJob(slot)));
+	CHECK(!deque.IsEmpty());
+	CHECK(deque.Pop() == AsJob(slots[3]));
+	CHECK(deque.Steal() == AsJob(slots[0]));
+	CHECK(deque.Pop() == AsJob(slots[2]));
+	CHECK(deque.Steal() == AsJob(slots[1]));
+	CHECK(deque.IsEmpty());
+	CHECK(deque.Pop() == 0);
+	CHECK(deque.Steal() == 0);
+
+	// Full is full, and stays usable afterwards
+	std::atomic<uint32_t> slot(0);
+	for (uint32_t i = 0; i < JOB_SYSTEM_DEQUE_CAPACITY; i++)
+		CHECK(deque.Push(AsJob(slot)));
+	CHECK(!deque.Push(AsJob(slot)));
+	CHECK(deque.Steal() == AsJob(slot));
+	CHECK(deque.Push(AsJob(slot)));
+	uint32_t popped = 0;
+	while (deque.Pop())
+		popped++;
+	CHECK(popped == JOB_SYSTEM_DEQUE_CAPACITY);
+}
+
+static void TestDequeStealing()
+{
+	std::vector<std::atomic<uint32_t>> taken(DEQUE_JOB_COUNT);
+	JobDeque deque;
+	std::atomic<bool> pushing(true);
+	std::atomic<uint32_t> stolen(0);
+
+	std::vector<std::thread> thieves;
+	for (uint32_t t = 0; t < DEQUE_THIEF_COUNT; t++)
+	{
+		thieves.emplace_back([&]()
+		{
+			for (;;)
+			{
+				bool done = !pushing.load();
+				if (Job* job = deque.Steal())
+				{
+					AsTaken(job)->fetch_add(1);
+					stolen.fetch_add(1);
+				}
+				else if (done && deque.IsEmpty())
+				{
+					return;
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+			}
+		});
+	}
+
+	// The owner pushes bursts of different sizes, popping some
+	// of each back - racing the thieves for the last one
+	uint32_t next = 0;
+	uint32_t ownerPopped = 0;
+	for (uint32_t burst = 0; next < DEQUE_JOB_COUNT; burst++)
+	{
+		uint32_t pushes = 1 + (burst * 37) % 300;
+		for (uint32_t i = 0; i < pushes && next < DEQUE_JOB_COUNT; i++)
+		{
+			if (deque.Push(AsJob(taken[next])))
+				next++;
+		}
+
+		uint32_t pops = (burst * 53) % 400;
+		for (uint32_t i = 0; i < pops; i++)
+		{
+			Job* job = deque.Pop();
+			if (!job)
+				break;
+			AsTaken(job)->fetch_add(1);
+			ownerPopped++;
+		}
+	}
+	while (Job* job = deque.Pop())
+	{
+		AsTaken(job)->fetch_add(1);
+		ownerPopped++;
+	}
+
+	pushing = false;
+	for (std::thread& thief : thieves)
+		thief.join();
+
+	CHECK(ownerPopped + stolen.load() == DEQUE_JOB_COUNT);
+	CHECK(AllOnce(taken));
+}
+
+static void TestRunOnce(uint32_t workers)
+{
+	JobSystem jobs(workers);
+	CHECK(jobs.GetWorkerCount() == workers);
+	CHECK(jobs.GetThreadCount() == workers + 1);
+	CHECK(jobs.GetThreadIndex() == 0);
+
+	// Lots of little jobs from the main thread
+	std::vector<std::atomic<uint32_t>> ran(20000);
+	JobCounter counter;
+	for (uint32_t i = 0; i < ran.size(); i++)
+		jobs.Run([&ran, i](uint32_t thread) { ran[i].fetch_add(1); }, &counter);
+	jobs.Wait(counter);
+	CHECK(counter.IsDone());
+	CHECK(AllOnce(ran));
+
+	// Jobs that add jobs (onto their own thread's deque, for
+	// the others to steal) and wait on them
+	std::vector<std::atomic<uint32_t>> children(64 * 64);
+	std::atomic<uint32_t> badThreads(0);
+	JobCounter parents;
+	for (uint32_t p = 0; p < 64; p++)
+	{
+		jobs.Run([&, p](uint32_t thread)
+		{
+			if (thread != jobs.GetThreadIndex() || thread > workers)
+				badThreads++;
+
+			JobCounter mine;
+			for (uint32_t c = 0; c < 64; c++)
+				jobs.Run([&children, p, c](uint32_t thread) { children[p * 64 + c].fetch_add(1); }, &mine);
+			jobs.Wait(mine);
+		}, &parents);
+	}
+	jobs.Wait(parents);
+	CHECK(AllOnce(children));
+	CHECK(badThreads.load() == 0);
+	CHECK(jobs.GetExecutedCount() == ran.size() + 64 + children.size());
+
+	// A thread outside the pool goes through the shared queue
+	std::vector<std::atomic<uint32_t>> outside(5000);
+	uint32_t outsideIndex = 0;
+	std::thread stranger([&]()
+	{
+		outsideIndex = jobs.GetThreadIndex();
+		JobCounter theirs;
+		for (uint32_t i = 0; i < outside.size(); i++)
+			jobs.Run([&outside, i](uint32_t thread) { outside[i].fetch_add(1); }, &theirs);
+		jobs.Wait(theirs);
+	});
+	stranger.join();
+	CHECK(outsideIndex == JOB_SYSTEM_NO_THREAD);
+	CHECK(AllOnce(outside));
+}
+
+static void TestDependencies(uint32_t workers)
+{
+	JobSystem jobs(workers);
+
+	// Three stages, each only started once the last is done
+	std::vector<std::atomic<uint32_t>> first(500);
+	std::vector<std::atomic<uint32_t>> second(3);
+	std::atomic<uint32_t> early(0);
+	std::atomic<uint32_t> lastRan(0);
+	JobCounter firstDone, secondDone, lastDone;
+
+	for (uint32_t i = 0; i < first.size(); i++)
+	{
+		jobs.Run([&first, i](uint32_t thread)
+		{
+			// Slow enough that the stages would overlap if they could
+			volatile uint32_t work = 0;
+			for (uint32_t w = 0; w < 2000; w++)
+				work = work + w;
+			first[i].fetch_add(1);
+		}, &firstDone);
+	}
+
+	// Several jobs can wait on one counter
+	for (uint32_t i = 0; i < second.size(); i++)
+	{
+		jobs.RunAfter(firstDone, [&, i](uint32_t thread)
+		{
+			if (!AllOnce(first))
+				early++;
+			second[i].fetch_add(1);
+		}, &secondDone);
+	}
+
+	jobs.RunAfter(secondDone, [&](uint32_t thread)
+	{
+		if (!AllOnce(second))
+			early++;
+		lastRan++;
+	}, &lastDone);
+
+	// Only the last stage is waited on - the rest must have
+	// finished for it to run
+	jobs.Wait(lastDone);
+	CHECK(lastRan.load() == 1);
+	CHECK(early.load() == 0);
+	CHECK(firstDone.IsDone() && secondDone.IsDone());
+	CHECK(AllOnce(first) && AllOnce(second));
+
+	// A counter that's already done doesn't hold anything up
+	std::atomic<uint32_t> afterDone(0);
+	JobCounter none, afterDoneCounter;
+	jobs.RunAfter(none, [&](uint32_t thread) { afterDone++; }, &afterDoneCounter);
+	jobs.Wait(afterDoneCounter);
+	CHECK(afterDone.load() == 1);
+
+	// Jobs can chain further jobs off counters of their own
+	std::atomic<uint32_t> chained(0);
+	JobCounter outer;
+	jobs.Run([&](uint32_t thread)
+	{
+		JobCounter inner, after;
+		for (uint32_t i = 0; i < 10; i++)
+			jobs.Run([&](uint32_t thread) { chained++; }, &inner);
+		jobs.RunAfter(inner, [&](uint32_t thread) { chained += chained.load() == 10 ? 100 : 0; }, &after);
+		jobs.Wait(after);
+	}, &outer);
+	jobs.Wait(outer);
+	CHECK(chained.load() == 110);
+}
+
+static void TestParallelFor(uint32_t workers)
+{
+	JobSystem jobs(workers);
+
+	const uint32_t counts[] = { 0, 1, 7, 1000, 100003 };
+	const uint32_t minRuns[] = { 0, 1, 16, 4096 };
+	for (uint32_t count : counts)
+	{
+		for (uint32_t minRun : minRuns)
+		{
+			std::vector<std::atomic<uint32_t>> hits(count);
+			std::atomic<uint32_t> badRuns(0);
+			jobs.ParallelFor(count, minRun, [&](uint32_t first, uint32_t end, uint32_t thread)
+			{
+				if (first >= end || end > count || thread > workers)
+					badRuns++;
+				for (uint32_t i = first; i < end; i++)
+					hits[i].fetch_add(1);
+			});
+			CHECK(badRuns.load() == 0);
+			CHECK(AllOnce(hits));
+		}
+	}
+
+	// Nested, as in a job that splits its own work up
+	std::vector<std::atomic<uint32_t>> cells(64 * 256);
+	jobs.ParallelFor(64, 1, [&](uint32_t first, uint32_t end, uint32_t thread)
+	{
+		for (uint32_t row = first; row < end; row++)
+		{
+			jobs.ParallelFor(256, 8, [&, row](uint32_t first, uint32_t end, uint32_t thread)
+			{
+				for (uint32_t column = first; column < end; column++)
+					cells[row * 256 + column].fetch_add(1);
+			});
+		}
+	});
+	CHECK(AllOnce(cells));
+}
+
+int main()
+{
+	TestDequeOrder();
+	TestDequeStealing();
+
+	const uint32_t workerCounts[] = { 0, 3 };
+	for (uint32_t workers : workerCounts)
+	{
+		TestRunOnce(workers);
+		TestDependencies(workers);
+		TestParallelFor(workers);
+	}
+	return TestResult();
+}
@@ -0,0 +1,332 @@
+#include "LightClusters.h"
+
+#include <algorithm>
+#include <cmath>
+
+// SSE is always available on x86/x64 - anything else takes the scalar path
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define LIGHT_CLUSTERS_SSE 1
+#endif
+
+// Below this many lights a single thread is faster than splitting the work
+#define LIGHT_CLUSTERS_MIN_LIGHTS_PER_THREAD 32
+
+// --------------------------------------------------------
+// Tests four spheres (structure-of-arrays) against one box
+// and returns a 4-bit mask of the ones that overlap
+// --------------------------------------------------------
+static unsigned int SpheresTouchBounds4(
+	const float* x, const float* y, const float* z, const float* rangeSq,
+	const float boundsMin[3], const float boundsMax[3])
+{
+#ifdef LIGHT_CLUSTERS_SSE
+	__m128 zero = _mm_setzero_ps();
+	__m128 cx = _mm_loadu_ps(x);
+	__m128 cy = _mm_loadu_ps(y);
+	__m128 cz = _mm_loadu_ps(z);
+
+	// Distance outside the box along each axis (zero when inside)
+	__m128 dx = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_set1_ps(boundsMin[0]), cx), _mm_sub_ps(cx, _mm_set1_ps(boundsMax[0]))));
+	__m128 dy = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_set1_ps(boundsMin[1]), cy), _mm_sub_ps(cy, _mm_set1_ps(boundsMax[1]))));
+	__m128 dz = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_set1_ps(boundsMin[2]), cz), _mm_sub_ps(cz, _mm_set1_ps(boundsMax[2]))));
+
+	__m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+	return (unsigned int)_mm_movemask_ps(_mm_cmple_ps(distSq, _mm_loadu_ps(rangeSq)));
+#else
+	unsigned int mask = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		float dx = std::max(0.0f, std::max(boundsMin[0] - x[i], x[i] - boundsMax[0]));
+		float dy = std::max(0.0f, std::max(boundsMin[1] - y[i], y[i] - boundsMax[1]));
+		float dz = std::max(0.0f, std::max(boundsMin[2] - z[i], z[i] - boundsMax[2]));
+		if (dx * dx + dy * dy + dz * dz <= rangeSq[i])
+			mask |= 1u << i;
+	}
+	return mask;
+#endif
+}
+
+// --------------------------------------------------------
+// Cone vs. sphere test for spot lights, using the box's
+// bounding sphere (conservative - it never culls a cluster
+// the cone actually touches)
+// --------------------------------------------------------
+static bool ConeTouchesBounds(const ClusterLight& light, const float boundsMin[3], const float boundsMax[3])
+{
+	float center[3];
+	float radiusSq = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		center[i] = (boundsMin[i] + boundsMax[i]) * 0.5f;
+		float half = (boundsMax[i] - boundsMin[i]) * 0.5f;
+		radiusSq += half * half;
+	}
+	float radius = sqrtf(radiusSq);
+
+	// Vector from the light to the sphere, and its projection on the cone axis
+	float v[3] = { center[0] - light.Position[0], center[1] - light.Position[1], center[2] - light.Position[2] };
+	float lengthSq = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+	float alongAxis = v[0] * light.Direction[0] + v[1] * light.Direction[1] + v[2] * light.Direction[2];
+
+	// Distance from the sphere's center to the cone's surface
+	float cosAngle = light.SpotCosCutoff;
+	float sinAngle = sqrtf(std::max(0.0f, 1.0f - cosAngle * cosAngle));
+	float distToCone = cosAngle * sqrtf(std::max(0.0f, lengthSq - alongAxis * alongAxis)) - alongAxis * sinAngle;
+
+	bool outsideAngle = distToCone > radius;
+	bool pastRange = alongAxis > radius + light.Range;
+	bool behind = alongAxis < -radius;
+	return !(outsideAngle || pastRange || behind);
+}
+
+
+// Constructor - without a job system everything's built on the calling thread
+LightClusterBuilder::LightClusterBuilder(std::shared_ptr<JobSystem> jobs) :
+	jobs(jobs),
+	globalLightCount(0),
+	lights(0),
+	lightCount(0)
+{
+	threadCount = jobs ? jobs->GetThreadCount() : 1;
+	workers.resize(threadCount);
+}
+
+// Destructor
+LightClusterBuilder::~LightClusterBuilder()
+{
+}
+
+// --------------------------------------------------------
+// Assigns every light to the clusters it touches
+// --------------------------------------------------------
+void LightClusterBuilder::Build(const LightClusterConfig& config, const ClusterLight* lights, unsigned int lightCount)
+{
+	this->config = config;
+	this->lights = lights;
+	this->lightCount = lights ? lightCount : 0;
+
+	uint32_t clusterCount = config.GetClusterCount();
+	localRanges.assign(clusterCount * 2, 0);
+	clusterWorker.assign(clusterCount, 0);
+	ranges.assign(clusterCount * 2, 0);
+	indices.clear();
+
+	// Global lights go first
+	for (unsigned int i = 0; i < this->lightCount; i++)
+	{
+		if (lights[i].Global)
+			indices.push_back(i);
+	}
+	globalLightCount = (unsigned int)indices.size();
+
+	// Only use as many threads as there's work for
+	uint32_t workerCount = std::min<uint32_t>(threadCount, config.CountZ);
+	workerCount = std::min<uint32_t>(workerCount, this->lightCount / LIGHT_CLUSTERS_MIN_LIGHTS_PER_THREAD);
+	workerCount = std::max<uint32_t>(workerCount, 1);
+
+	// Split the slices evenly, one batch per job
+	for (uint32_t w = 0; w < workerCount; w++)
+		workers[w].Indices.clear();
+
+	auto buildBatches = [&](uint32_t firstBatch, uint32_t endBatch, uint32_t thread) {
+		for (uint32_t w = firstBatch; w < endBatch; w++)
+			BuildSlices(config.CountZ * w / workerCount, config.CountZ * (w + 1) / workerCount, &workers[w]);
+	};
+	if (workerCount > 1)
+		jobs->ParallelFor(workerCount, 1, buildBatches);
+	else
+		buildBatches(0, 1, 0);
+
+	// Pack everything into one list, in cluster order
+	for (uint32_t c = 0; c < clusterCount; c++)
+	{
+		const std::vector<uint32_t>& local = workers[clusterWorker[c]].Indices;
+		uint32_t offset = localRanges[c * 2];
+		uint32_t count = localRanges[c * 2 + 1];
+
+		ranges[c * 2] = (uint32_t)indices.size();
+		ranges[c * 2 + 1] = count;
+		indices.insert(indices.end(), local.begin() + offset, local.begin() + offset + count);
+	}
+}
+
+// --------------------------------------------------------
+// Builds the light lists for slices [firstSlice, lastSlice)
+//
+// Each cluster belongs to exactly one slice, so workers
+// never write to the same cluster
+// --------------------------------------------------------
+void LightClusterBuilder::BuildSlices(uint32_t firstSlice, uint32_t lastSlice, WorkerOutput* output)
+{
+	uint32_t workerIndex = (uint32_t)(output - workers.data());
+	LightSoA& sliceLights = output->SliceLights;
+	LightSoA& rowLights = output->RowLights;
+
+	for (uint32_t z = firstSlice; z < lastSlice; z++)
+	{
+		// Lights whose spheres reach into this slice's depth range
+		float nearZ = GetSliceNearZ(config, z);
+		float farZ = GetSliceNearZ(config, z + 1);
+
+		sliceLights.Clear();
+		for (unsigned int i = 0; i < lightCount; i++)
+		{
+			const ClusterLight& light = lights[i];
+			if (!light.Global &&
+				light.Position[2] - light.Range <= farZ &&
+				light.Position[2] + light.Range >= nearZ)
+				sliceLights.Add(light, i);
+		}
+
+		for (uint32_t y = 0; y < config.CountY; y++)
+		{
+			// Narrow down to the lights touching this row (the
+			// row's bounds are the union of all its clusters)
+			float rowMin[3], rowMax[3], unused[3];
+			GetClusterBounds(config, 0, y, z, rowMin, rowMax);
+			GetClusterBounds(config, config.CountX - 1, y, z, unused, rowMax);
+
+			rowLights.Clear();
+			for (size_t i = 0; i < sliceLights.Index.size(); i++)
+			{
+				float dy = std::max(0.0f, std::max(rowMin[1] - sliceLights.Y[i], sliceLights.Y[i] - rowMax[1]));
+				float dz = std::max(0.0f, std::max(rowMin[2] - sliceLights.Z[i], sliceLights.Z[i] - rowMax[2]));
+				if (dy * dy + dz * dz <= sliceLights.RangeSq[i])
+					rowLights.Add(lights[sliceLights.Index[i]], sliceLights.Index[i]);
+			}
+			rowLights.Pad();
+
+			for (uint32_t x = 0; x < config.CountX; x++)
+			{
+				float boundsMin[3], boundsMax[3];
+				GetClusterBounds(config, x, y, z, boundsMin, boundsMax);
+
+				uint32_t start = (uint32_t)output->Indices.size();
+				for (size_t group = 0; group < rowLights.Index.size(); group += 4)
+				{
+					unsigned int mask = SpheresTouchBounds4(
+						&rowLights.X[group], &rowLights.Y[group], &rowLights.Z[group], &rowLights.RangeSq[group],
+						boundsMin, boundsMax);
+
+					for (unsigned int lane = 0; mask; lane++, mask >>= 1)
+					{
+						if (!(mask & 1)) continue;
+
+						// Spot lights get a second, tighter test
+						uint32_t lightIndex = rowLights.Index[group + lane];
+						const ClusterLight& light = lights[lightIndex];
+						if (light.SpotCosCutoff > -1.0f && !ConeTouchesBounds(light, boundsMin, boundsMax))
+							continue;
+
+						output->Indices.push_back(lightIndex);
+					}
+				}
+
+				uint32_t cluster = x + y * config.CountX + z * config.CountX * config.CountY;
+				localRanges[cluster * 2] = start;
+				localRanges[cluster * 2 + 1] = (uint32_t)output->Indices.size() - start;
+				clusterWorker[cluster] = workerIndex;
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// View space depth where a slice starts.  Slice 0 reaches
+// all the way to the camera and the last slice ends at FarZ.
+// --------------------------------------------------------
+float LightClusterBuilder::GetSliceNearZ(const LightClusterConfig& config, uint32_t slice)
+{
+	if (slice == 0) return 0.0f;
+	if (slice >= config.CountZ) return config.FarZ;
+
+	return config.NearZ * powf(config.FarZ / config.NearZ, (float)slice / config.CountZ);
+}
+
+// --------------------------------------------------------
+// The slice a view space depth falls in - this must match
+// the pixel shader's calculation
+// --------------------------------------------------------
+uint32_t LightClusterBuilder::GetSliceForDepth(const LightClusterConfig& config, float viewZ)
+{
+	if (viewZ <= config.NearZ)
+		return 0;
+
+	float slice = logf(viewZ / config.NearZ) / logf(config.FarZ / config.NearZ) * config.CountZ;
+	return std::min((uint32_t)slice, config.CountZ - 1);
+}
+
+// --------------------------------------------------------
+// Axis aligned view space bounds of a single cluster
+// --------------------------------------------------------
+void LightClusterBuilder::GetClusterBounds(const LightClusterConfig& config, uint32_t x, uint32_t y, uint32_t z, float boundsMin[3], float boundsMax[3])
+{
+	float nearZ = GetSliceNearZ(config, z);
+	float farZ = GetSliceNearZ(config, z + 1);
+
+	// Tile edges as view space slopes (x/z and y/z), with y = 0 at the top
+	float slopeX0 = (2.0f * x / config.CountX - 1.0f) * config.TanHalfFovX;
+	float slopeX1 = (2.0f * (x + 1) / config.CountX - 1.0f) * config.TanHalfFovX;
+	float slopeY0 = (1.0f - 2.0f * (y + 1) / config.CountY) * config.TanHalfFovY;
+	float slopeY1 = (1.0f - 2.0f * y / config.CountY) * config.TanHalfFovY;
+
+	// The frustum widens with depth, so pick the depth that pushes each edge out furthest
+	boundsMin[0] = slopeX0 * (slopeX0 < 0 ? farZ : nearZ);
+	boundsMax[0] = slopeX1 * (slopeX1 > 0 ? farZ : nearZ);
+	boundsMin[1] = slopeY0 * (slopeY0 < 0 ? farZ : nearZ);
+	boundsMax[1] = slopeY1 * (slopeY1 > 0 ? farZ : nearZ);
+	boundsMin[2] = nearZ;
+	boundsMax[2] = farZ;
+}
+
+// --------------------------------------------------------
+// The same test the builder runs, one light at a time
+// --------------------------------------------------------
+bool LightClusterBuilder::LightTouchesBounds(const ClusterLight& light, const float boundsMin[3], const float boundsMax[3])
+{
+	if (light.Global)
+		return true;
+
+	float x[4] = { light.Position[0] };
+	float y[4] = { light.Position[1] };
+	float z[4] = { light.Position[2] };
+	float rangeSq[4] = { light.Range * light.Range, -1, -1, -1 };
+	if (!(SpheresTouchBounds4(x, y, z, rangeSq, boundsMin, boundsMax) & 1))
+		return false;
+
+	return light.SpotCosCutoff <= -1.0f || ConeTouchesBounds(light, boundsMin, boundsMax);
+}
+
+
+// SoA helpers
+void LightClusterBuilder::LightSoA::Clear()
+{
+	X.clear();
+	Y.clear();
+	Z.clear();
+	RangeSq.clear();
+	Index.clear();
+}
+
+void LightClusterBuilder::LightSoA::Add(const ClusterLight& light, uint32_t index)
+{
+	X.push_back(light.Position[0]);
+	Y.push_back(light.Position[1]);
+	Z.push_back(light.Position[2]);
+	RangeSq.push_back(light.Range * light.Range);
+	Index.push_back(index);
+}
+
+// Rounds up to a multiple of four with lights that can't touch anything
+void LightClusterBuilder::LightSoA::Pad()
+{
+	while (Index.size() % 4 != 0)
+	{
+		X.push_back(0);
+		Y.push_back(0);
+		Z.push_back(0);
+		RangeSq.push_back(-1.0f);
+		Index.push_back(0);
+	}
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+#include "JobSystem.h"
+
+// --------------------------------------------------------
+// A light as seen by the cluster builder, in VIEW space
+// (left handed, +Z forward, as with the rest of the engine)
+// --------------------------------------------------------
+struct ClusterLight
+{
+	float Position[3] = { 0, 0, 0 };
+	float Range = 0;
+
+	// Spot lights only - normalized direction and the cosine
+	// of the cone's half angle (use -1 for point lights)
+	float Direction[3] = { 0, 0, 1 };
+	float SpotCosCutoff = -1.0f;
+
+	// Lights without a position (directional) touch every
+	// cluster, so they go in a separate global list
+	bool Global = false;
+};
+
+// --------------------------------------------------------
+// How the view frustum is split into clusters ("froxels")
+//
+// - X & Y split the screen into equal tiles
+// - Z is split exponentially between NearZ and FarZ, so
+//   clusters stay roughly cube shaped.  Everything closer
+//   than NearZ belongs to the first slice.
+// --------------------------------------------------------
+struct LightClusterConfig
+{
+	uint32_t CountX = 16;
+	uint32_t CountY = 9;
+	uint32_t CountZ = 24;
+
+	float NearZ = 0.1f;
+	float FarZ = 100.0f;
+
+	// From the projection matrix: 1/_11 and 1/_22
+	float TanHalfFovX = 1.0f;
+	float TanHalfFovY = 1.0f;
+
+	uint32_t GetClusterCount() const { return CountX * CountY * CountZ; }
+};
+
+// --------------------------------------------------------
+// Assigns lights to the clusters they can affect and packs
+// the results into two flat arrays for the GPU:
+//
+// - Ranges:  (offset, count) pairs, one per cluster, into...
+// - Indices: light indices.  The global lights come first
+//            (GetGlobalLightCount() of them), followed by
+//            each cluster's list.
+//
+// Clusters are indexed x + y * CountX + z * CountX * CountY,
+// with y = 0 being the TOP row of the screen.
+//
+// Slices are split between jobs, and the per-cluster
+// light tests run on four lights at a time with SSE where
+// it's available.  There's no Direct3D dependency here.
+// --------------------------------------------------------
+class LightClusterBuilder
+{
+public:
+	LightClusterBuilder(std::shared_ptr<JobSystem> jobs = 0);
+	~LightClusterBuilder();
+
+	// Rebuilds every cluster's light list
+	void Build(const LightClusterConfig& config, const ClusterLight* lights, unsigned int lightCount);
+
+	// Results
+	const std::vector<uint32_t>& GetClusterRanges() { return ranges; }
+	const std::vector<uint32_t>& GetLightIndices() { return indices; }
+	unsigned int GetGlobalLightCount() { return globalLightCount; }
+	unsigned int GetThreadCount() { return threadCount; }
+	const LightClusterConfig& GetConfig() { return config; }
+
+	// Cluster geometry helpers (shared with the shader's math)
+	static float GetSliceNearZ(const LightClusterConfig& config, uint32_t slice);
+	static uint32_t GetSliceForDepth(const LightClusterConfig& config, float viewZ);
+	static void GetClusterBounds(const LightClusterConfig& config, uint32_t x, uint32_t y, uint32_t z, float boundsMin[3], float boundsMax[3]);
+
+	// Exact per-light test against one cluster's bounds
+	static bool LightTouchesBounds(const ClusterLight& light, const float boundsMin[3], const float boundsMax[3]);
+
+private:
+
+	// Lights in structure-of-arrays form for the SIMD tests
+	struct LightSoA
+	{
+		std::vector<float> X, Y, Z, RangeSq;
+		std::vector<uint32_t> Index;
+		void Clear();
+		void Add(const ClusterLight& light, uint32_t index);
+		void Pad();
+	};
+
+	// Per-thread output, merged once every thread is done
+	struct WorkerOutput
+	{
+		std::vector<uint32_t> Indices;
+		LightSoA SliceLights;
+		LightSoA RowLights;
+	};
+
+	void BuildSlices(uint32_t firstSlice, uint32_t lastSlice, WorkerOutput* output);
+
+	std::shared_ptr<JobSystem> jobs;
+	unsigned int threadCount;
+	unsigned int globalLightCount;
+
+	LightClusterConfig config;
+	const ClusterLight* lights;
+	unsigned int lightCount;
+
+	// Per-cluster (offset, count) into the owning worker's indices
+	std::vector<uint32_t> localRanges;
+	std::vector<uint32_t> clusterWorker;
+	std::vector<WorkerOutput> workers;
+
+	// Final packed results
+	std::vector<uint32_t> ranges;
+	std::vector<uint32_t> indices;
+};
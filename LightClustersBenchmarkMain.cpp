@@ -0,0 +1,154 @@
+// --------------------------------------------------------
+// Times building the light clusters for a range of light
+// counts, three ways:
+//
+//  - brute:    every light tested against every cluster
+//              with LightTouchesBounds(), one light at a time
+//  - builder:  LightClusterBuilder on one thread (culling by
+//              slice and row, then four lights at a time)
+//  - threaded: LightClusterBuilder with a job system
+//
+// Every way's cluster lists are checked against the brute
+// force ones.  Lights are a repeatable mix of point and
+// spot lights spread through the default cluster grid.
+//
+// Built by CMakeLists.txt:
+//
+//   LightClustersBenchmarkMain --threads 8 --repeats 5
+// --------------------------------------------------------
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+#include "LightClusters.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Repeatable lights, about half of them spots
+static std::vector<ClusterLight> MakeLights(uint32_t count, float farZ)
+{
+	uint32_t seed = 12345;
+	auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+
+	std::vector<ClusterLight> lights(count);
+	for (ClusterLight& light : lights)
+	{
+		float z = random() * farZ;
+		light.Position[0] = (random() * 2 - 1) * z;
+		light.Position[1] = (random() * 2 - 1) * z;
+		light.Position[2] = z;
+		light.Range = 1.0f + random() * 9.0f;
+
+		if (random() < 0.5f)
+		{
+			float d[3] = { random() * 2 - 1, random() * 2 - 1, random() * 2 - 1 };
+			float length = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) + 1e-6f;
+			for (int i = 0; i < 3; i++)
+				light.Direction[i] = d[i] / length;
+			light.SpotCosCutoff = cosf(0.2f + random() * 0.8f);
+		}
+	}
+	return lights;
+}
+
+// Packs the lists the same way the builder does, testing
+// every light against every cluster
+static void BuildBruteForce(const LightClusterConfig& config, const std::vector<ClusterLight>& lights,
+	std::vector<uint32_t>& ranges, std::vector<uint32_t>& indices)
+{
+	uint32_t clusterCount = config.GetClusterCount();
+	ranges.assign(clusterCount * 2, 0);
+	indices.clear();
+
+	for (uint32_t i = 0; i < lights.size(); i++)
+	{
+		if (lights[i].Global)
+			indices.push_back(i);
+	}
+
+	for (uint32_t c = 0; c < clusterCount; c++)
+	{
+		uint32_t x = c % config.CountX;
+		uint32_t y = c / config.CountX % config.CountY;
+		uint32_t z = c / (config.CountX * config.CountY);
+		float boundsMin[3], boundsMax[3];
+		LightClusterBuilder::GetClusterBounds(config, x, y, z, boundsMin, boundsMax);
+
+		ranges[c * 2] = (uint32_t)indices.size();
+		for (uint32_t i = 0; i < lights.size(); i++)
+		{
+			if (!lights[i].Global && LightClusterBuilder::LightTouchesBounds(lights[i], boundsMin, boundsMax))
+				indices.push_back(i);
+		}
+		ranges[c * 2 + 1] = (uint32_t)indices.size() - ranges[c * 2];
+	}
+}
+
+// Best time of a few runs, in milliseconds
+template<typename F>
+static double Time(uint32_t repeats, F run)
+{
+	double best = 1e30;
+	for (uint32_t r = 0; r < repeats; r++)
+	{
+		auto start = Clock::now();
+		run();
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		best = ms < best ? ms : best;
+	}
+	return best;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned int cores = std::thread::hardware_concurrency();
+	uint32_t threads = cores > 0 ? cores : 1;
+	uint32_t repeats = 5;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string name = argv[i];
+		if (name == "--threads") threads = (uint32_t)atoi(argv[i + 1]);
+		else if (name == "--repeats") repeats = (uint32_t)atoi(argv[i + 1]);
+	}
+	if (threads == 0 || repeats == 0)
+	{
+		printf("Usage: LightClustersBenchmarkMain [--threads count] [--repeats count]\n");
+		return 1;
+	}
+
+	LightClusterConfig config;
+	std::shared_ptr<JobSystem> jobs = std::make_shared<JobSystem>(threads - 1);
+	LightClusterBuilder single;
+	LightClusterBuilder threaded(jobs);
+
+	printf("%ux%ux%u clusters, %u threads, best of %u runs\n\n", config.CountX, config.CountY, config.CountZ, threads, repeats);
+	printf("lights    brute ms  builder ms  threaded ms  speedup  indices\n");
+
+	bool same = true;
+	for (uint32_t lightCount : { 64u, 256u, 1024u, 4096u })
+	{
+		std::vector<ClusterLight> lights = MakeLights(lightCount, config.FarZ);
+		std::vector<uint32_t> ranges;
+		std::vector<uint32_t> indices;
+
+		double bruteMs = Time(repeats, [&]() { BuildBruteForce(config, lights, ranges, indices); });
+		double singleMs = Time(repeats, [&]() { single.Build(config, lights.data(), lightCount); });
+		double threadedMs = Time(repeats, [&]() { threaded.Build(config, lights.data(), lightCount); });
+
+		same = same &&
+			single.GetClusterRanges() == ranges && single.GetLightIndices() == indices &&
+			threaded.GetClusterRanges() == ranges && threaded.GetLightIndices() == indices;
+
+		printf("%6u  %10.3f  %10.3f  %11.3f  %6.1fx  %7zu\n",
+			lightCount, bruteMs, singleMs, threadedMs, bruteMs / threadedMs, indices.size());
+	}
+
+	printf("\nCluster lists %s the brute force ones\n", same ? "match" : "DIFFER from");
+	return same ? 0 : 1;
+}
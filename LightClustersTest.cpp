@@ -0,0 +1,208 @@
+// --------------------------------------------------------
+// Tests LightClusterBuilder against the brute-force answer:
+// every light tested against every cluster with
+// LightTouchesBounds().  The builder's culling (slices, then
+// rows, then four lights at a time) must give exactly the
+// same lists, on one thread or many, for point, spot and
+// global lights.  Also checks the slice math.
+// --------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "JobSystem.h"
+#include "LightClusters.h"
+#include "TestCheck.h"
+
+// Repeatable lights spread through (and around) the frustum
+static std::vector<ClusterLight> MakeLights(uint32_t count, uint32_t seed, float farZ)
+{
+	auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+
+	std::vector<ClusterLight> lights(count);
+	for (ClusterLight& light : lights)
+	{
+		float z = random() * farZ * 1.2f - farZ * 0.1f;
+		light.Position[0] = (random() * 2 - 1) * (z > 1 ? z : 1);
+		light.Position[1] = (random() * 2 - 1) * (z > 1 ? z : 1);
+		light.Position[2] = z;
+		light.Range = 0.5f + random() * farZ * 0.1f;
+
+		float kind = random();
+		if (kind < 0.05f)
+			light.Global = true;
+		else if (kind < 0.5f)
+		{
+			float d[3] = { random() * 2 - 1, random() * 2 - 1, random() * 2 - 1 };
+			float length = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) + 1e-6f;
+			for (int i = 0; i < 3; i++)
+				light.Direction[i] = d[i] / length;
+			light.SpotCosCutoff = cosf(0.1f + random() * 1.2f);
+		}
+	}
+	return lights;
+}
+
+// Checks the builder's output against testing every light
+// against every cluster, and returns how many lists differed
+static uint32_t CompareWithBruteForce(LightClusterBuilder& builder, const std::vector<ClusterLight>& lights)
+{
+	const LightClusterConfig& config = builder.GetConfig();
+	const std::vector<uint32_t>& ranges = builder.GetClusterRanges();
+	const std::vector<uint32_t>& indices = builder.GetLightIndices();
+
+	// Global lights first
+	std::vector<uint32_t> expected;
+	for (uint32_t i = 0; i < lights.size(); i++)
+	{
+		if (lights[i].Global)
+			expected.push_back(i);
+	}
+	uint32_t globalCount = builder.GetGlobalLightCount();
+	uint32_t differences = 0;
+	if (globalCount != expected.size() || !std::equal(expected.begin(), expected.end(), indices.begin()))
+		differences++;
+
+	for (uint32_t z = 0; z < config.CountZ; z++)
+	{
+		for (uint32_t y = 0; y < config.CountY; y++)
+		{
+			for (uint32_t x = 0; x < config.CountX; x++)
+			{
+				float boundsMin[3], boundsMax[3];
+				LightClusterBuilder::GetClusterBounds(config, x, y, z, boundsMin, boundsMax);
+
+				expected.clear();
+				for (uint32_t i = 0; i < lights.size(); i++)
+				{
+					if (!lights[i].Global && LightClusterBuilder::LightTouchesBounds(lights[i], boundsMin, boundsMax))
+						expected.push_back(i);
+				}
+
+				uint32_t cluster = x + y * config.CountX + z * config.CountX * config.CountY;
+				uint32_t offset = ranges[cluster * 2];
+				uint32_t count = ranges[cluster * 2 + 1];
+				if (offset < globalCount || offset + count > indices.size() || count != expected.size() ||
+					!std::equal(expected.begin(), expected.end(), indices.begin() + offset))
+					differences++;
+			}
+		}
+	}
+	return differences;
+}
+
+static void TestMatchesBruteForce()
+{
+	std::shared_ptr<JobSystem> jobs = std::make_shared<JobSystem>(3);
+
+	LightClusterConfig configs[3];
+	configs[1].CountX = 8;
+	configs[1].CountY = 8;
+	configs[1].CountZ = 16;
+	configs[1].FarZ = 300.0f;
+	configs[1].TanHalfFovX = 1.7f;
+	configs[1].TanHalfFovY = 0.6f;
+	configs[2].CountX = 1;
+	configs[2].CountY = 1;
+	configs[2].CountZ = 1;
+
+	static const uint32_t lightCounts[] = { 0, 1, 3, 31, 200, 1000 };
+	for (const LightClusterConfig& config : configs)
+	{
+		for (uint32_t lightCount : lightCounts)
+		{
+			std::vector<ClusterLight> lights = MakeLights(lightCount, lightCount * 7 + config.CountZ, config.FarZ);
+
+			LightClusterBuilder single;
+			single.Build(config, lights.data(), lightCount);
+			CHECK(CompareWithBruteForce(single, lights) == 0);
+
+			// Threads split the slices, but the result's the same
+			LightClusterBuilder threaded(jobs);
+			threaded.Build(config, lights.data(), lightCount);
+			CHECK(CompareWithBruteForce(threaded, lights) == 0);
+			CHECK(threaded.GetLightIndices() == single.GetLightIndices());
+			CHECK(threaded.GetClusterRanges() == single.GetClusterRanges());
+
+			// Building again reuses everything without leftovers
+			threaded.Build(config, lights.data(), lightCount);
+			CHECK(threaded.GetLightIndices() == single.GetLightIndices());
+		}
+	}
+}
+
+static void TestLightPlacement()
+{
+	LightClusterConfig config;
+	LightClusterBuilder builder;
+
+	// A small point light dead ahead lands in the middle of
+	// the screen and in its own depth slice, nowhere else
+	ClusterLight light;
+	light.Position[2] = 12.0f;
+	light.Range = 0.01f;
+	builder.Build(config, &light, 1);
+
+	uint32_t slice = LightClusterBuilder::GetSliceForDepth(config, 12.0f);
+	uint32_t clustersWithLight = 0;
+	bool wrongSlice = false;
+	for (uint32_t c = 0; c < config.GetClusterCount(); c++)
+	{
+		if (builder.GetClusterRanges()[c * 2 + 1] == 0)
+			continue;
+		clustersWithLight++;
+		wrongSlice |= c / (config.CountX * config.CountY) != slice;
+	}
+	CHECK(clustersWithLight >= 1 && clustersWithLight <= 4);
+	CHECK(!wrongSlice);
+
+	// Behind the camera, out of reach
+	light.Position[2] = -10.0f;
+	builder.Build(config, &light, 1);
+	CHECK(builder.GetLightIndices().empty());
+
+	// A spot light pointing away from the frustum touches
+	// less than the same light as a point light
+	light.Position[2] = 5.0f;
+	light.Range = 20.0f;
+	builder.Build(config, &light, 1);
+	size_t asPoint = builder.GetLightIndices().size();
+	light.Direction[2] = -1.0f;
+	light.SpotCosCutoff = cosf(0.3f);
+	builder.Build(config, &light, 1);
+	CHECK(builder.GetLightIndices().size() < asPoint);
+}
+
+static void TestSlices()
+{
+	LightClusterConfig config;
+
+	// Slices run from the camera to FarZ, and only get deeper
+	CHECK(LightClusterBuilder::GetSliceNearZ(config, 0) == 0.0f);
+	CHECK(LightClusterBuilder::GetSliceNearZ(config, config.CountZ) == config.FarZ);
+	bool increasing = true;
+	for (uint32_t z = 1; z <= config.CountZ; z++)
+		increasing &= LightClusterBuilder::GetSliceNearZ(config, z) > LightClusterBuilder::GetSliceNearZ(config, z - 1);
+	CHECK(increasing);
+
+	// Depths land in the slice that holds them
+	bool inside = true;
+	for (float depth = 0.0f; depth < config.FarZ; depth += 0.37f)
+	{
+		uint32_t z = LightClusterBuilder::GetSliceForDepth(config, depth);
+		inside &= z < config.CountZ;
+		inside &= depth >= LightClusterBuilder::GetSliceNearZ(config, z) * 0.999f;
+		inside &= depth <= LightClusterBuilder::GetSliceNearZ(config, z + 1) * 1.001f;
+	}
+	CHECK(inside);
+	CHECK(LightClusterBuilder::GetSliceForDepth(config, config.FarZ * 10.0f) == config.CountZ - 1);
+}
+
+int main()
+{
+	TestMatchesBruteForce();
+	TestLightPlacement();
+	TestSlices();
+	return TestResult();
+}
@@ -5,8 +5,22 @@ Material::Material(DirectX::XMFLOAT3 colorTint, std::shared_ptr<SimpleVertexShad
     colorTint(colorTint),
     vertexShader(vertexShader),
     pixelShader(pixelShader),
-    roughness(rough)
+    roughness(rough),
+    variantDirty(false)
 {
+    ResolveShaderHandles();
+}
+
+// Constructor - pixel shader comes from a set of permutations
+Material::Material(DirectX::XMFLOAT3 colorTint, std::shared_ptr<SimpleVertexShader> vertexShader, std::shared_ptr<ShaderPermutations> permutations, ShaderFeatureSet features, float rough) :
+    colorTint(colorTint),
+    vertexShader(vertexShader),
+    roughness(rough),
+    permutations(permutations),
+    features(features),
+    variantDirty(true)
+{
+    // The variant is picked on first use, once textures are added
 }
 
 // Destructor
@@ -21,14 +35,15 @@ DirectX::XMFLOAT3 Material::GetColorTint()
 }
 
 // Get method - vertex shader
-std::shared_ptr<SimpleVertexShader> Material::GetVertexShader()
+const std::shared_ptr<SimpleVertexShader>& Material::GetVertexShader()
 {
     return vertexShader;
 }
 
 // Get method - pixel shader
-std::shared_ptr<SimplePixelShader> Material::GetPixelShader()
+const std::shared_ptr<SimplePixelShader>& Material::GetPixelShader()
 {
+    UpdatePixelShaderVariant();
     return pixelShader;
 }
 
@@ -64,6 +79,34 @@ Microsoft::WRL::ComPtr<ID3D11SamplerState> Material::GetSampler(std::string name
     return it->second;
 }
 
+// Get method - shader variable handles
+const MaterialShaderHandles& Material::GetShaderHandles()
+{
+    UpdatePixelShaderVariant();
+    return shaderHandles;
+}
+
+// Get method - requested shader features
+ShaderFeatureSet Material::GetFeatures()
+{
+    return features;
+}
+
+// Get method - the features actually used, which drops
+// anything the material has no textures for
+ShaderFeatureSet Material::GetEffectiveFeatures()
+{
+    uint32_t flags = features.Flags;
+
+    if (!GetTextureSRV("NormalMap"))
+        flags &= ~SHADER_FEATURE_NORMAL_MAP;
+
+    if (!GetTextureSRV("RoughnessMap") || !GetTextureSRV("MetalnessMap"))
+        flags &= ~SHADER_FEATURE_PBR;
+
+    return ShaderFeatureSet(flags, features.LightCount);
+}
+
 // Set method - color tint XMFFLOAT4
 void Material::SetColorTint(DirectX::XMFLOAT3 _colorTint)
 {
@@ -80,12 +123,18 @@ void Material::SetColorTint(float r, float g, float b)
 void Material::SetVertexShader(std::shared_ptr<SimpleVertexShader> _vertexShader)
 {
     vertexShader = _vertexShader;
+    ResolveShaderHandles();
 }
 
 // Set method - pixel shader
 void Material::SetPixelShader(std::shared_ptr<SimplePixelShader> _pixelShader)
 {
+    // An explicit shader replaces any permutation selection
+    permutations.reset();
+    variantDirty = false;
+
     pixelShader = _pixelShader;
+    ResolveShaderHandles();
 }
 
 // Set method - roughness
@@ -94,9 +143,19 @@ void Material::SetRoughness(float rough)
     roughness = rough;
 }
 
+// Set method - shader features (only used with permutations)
+void Material::SetFeatures(ShaderFeatureSet _features)
+{
+    features = _features;
+    variantDirty = true;
+}
+
 void Material::AddTextureSRV(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
     textureSRVs.insert({ name,srv });
+
+    // New textures may enable a more complete permutation
+    variantDirty = true;
 }
 
 void Material::AddSampler(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler)
@@ -104,8 +163,59 @@ void Material::AddSampler(std::string name, Microsoft::WRL::ComPtr<ID3D11Sampler
     samplers.insert({ name, sampler });
 }
 
-void Material::PrepareTextures()
+void Material::PrepareTextures(ID3D11DeviceContext* context)
 {
-    for (auto& t : textureSRVs) { pixelShader->SetShaderResourceView(t.first.c_str(), t.second.Get()); }
-    for (auto& s : samplers) { pixelShader->SetSamplerState(s.first.c_str(), s.second.Get()); }
+    UpdatePixelShaderVariant();
+    PrepareTextures(pixelShader, context);
+}
+
+// Binds this material's textures & samplers to some other
+// pixel shader (like the deferred G-buffer shader)
+void Material::PrepareTextures(std::shared_ptr<SimplePixelShader> targetShader, ID3D11DeviceContext* context)
+{
+    for (auto& t : textureSRVs) { targetShader->SetShaderResourceView(t.first.c_str(), t.second.Get(), context); }
+    for (auto& s : samplers) { targetShader->SetSamplerState(s.first.c_str(), s.second.Get(), context); }
+}
+
+// Looks up the per-draw variables once, so drawing doesn't
+// need to hash variable names every frame
+void Material::ResolveShaderHandles()
+{
+    shaderHandles = {};
+
+    if (vertexShader)
+    {
+        shaderHandles.world = vertexShader->GetVariableHandle("world");
+        shaderHandles.worldInvTranspose = vertexShader->GetVariableHandle("worldInvTranspose");
+        shaderHandles.view = vertexShader->GetVariableHandle("view");
+        shaderHandles.projection = vertexShader->GetVariableHandle("projection");
+    }
+
+    if (pixelShader)
+    {
+        shaderHandles.colorTint = pixelShader->GetVariableHandle("colorTint");
+        shaderHandles.roughness = pixelShader->GetVariableHandle("roughness");
+        shaderHandles.cameraPosition = pixelShader->GetVariableHandle("cameraPosition");
+        shaderHandles.ambientColor = pixelShader->GetVariableHandle("ambientColor");
+        shaderHandles.lights = pixelShader->GetVariableHandle("lights");
+        shaderHandles.clusterInfo = pixelShader->GetVariableHandle("clusterInfo");
+        shaderHandles.shadowCascades = pixelShader->GetVariableHandle("shadowCascades");
+    }
+}
+
+// Swaps in the cheapest permutation that covers this
+// material's features, if anything has changed
+void Material::UpdatePixelShaderVariant()
+{
+    if (!variantDirty || !permutations)
+        return;
+
+    variantDirty = false;
+
+    std::shared_ptr<SimplePixelShader> variant = permutations->GetPixelShader(GetEffectiveFeatures());
+    if (variant != pixelShader)
+    {
+        pixelShader = variant;
+        ResolveShaderHandles();
+    }
 }
@@ -1,10 +1,31 @@
 #pragma once
 
 #include "SimpleShader.h"
+#include "ShaderPermutations.h"
 #include <DirectXMath.h>
 #include <memory>
 #include <unordered_map>
 
+// Pre-resolved handles for the per-draw shader variables
+// used by entities and the main render pass
+struct MaterialShaderHandles
+{
+	// Vertex shader
+	SimpleShaderHandle world;
+	SimpleShaderHandle worldInvTranspose;
+	SimpleShaderHandle view;
+	SimpleShaderHandle projection;
+
+	// Pixel shader
+	SimpleShaderHandle colorTint;
+	SimpleShaderHandle roughness;
+	SimpleShaderHandle cameraPosition;
+	SimpleShaderHandle ambientColor;
+	SimpleShaderHandle lights;
+	SimpleShaderHandle clusterInfo;
+	SimpleShaderHandle shadowCascades;
+};
+
 class Material
 {
 public:
@@ -14,15 +35,27 @@ public:
 		std::shared_ptr<SimplePixelShader> pixelShader,
 		float roughness);
 
+	// Uses whichever uber shader permutation fits the features
+	// (minus any whose textures the material doesn't have)
+	Material(
+		DirectX::XMFLOAT3 colorTint,
+		std::shared_ptr<SimpleVertexShader> vertexShader,
+		std::shared_ptr<ShaderPermutations> permutations,
+		ShaderFeatureSet features,
+		float roughness);
+
 	~Material();
 
 	// Getters
 	DirectX::XMFLOAT3 GetColorTint();
-	std::shared_ptr<SimpleVertexShader> GetVertexShader();
-	std::shared_ptr<SimplePixelShader> GetPixelShader();
+	const std::shared_ptr<SimpleVertexShader>& GetVertexShader();
+	const std::shared_ptr<SimplePixelShader>& GetPixelShader();
 	float GetRoughness();
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetTextureSRV(std::string name);
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> GetSampler(std::string name);
+	const MaterialShaderHandles& GetShaderHandles();
+	ShaderFeatureSet GetFeatures();
+	ShaderFeatureSet GetEffectiveFeatures();
 
 	// Setters
 	void SetColorTint(DirectX::XMFLOAT3 colorTint);
@@ -30,14 +63,22 @@ public:
 	void SetVertexShader(std::shared_ptr<SimpleVertexShader> vertexShader);
 	void SetPixelShader(std::shared_ptr<SimplePixelShader> pixelShader);
 	void SetRoughness(float rough);
+	void SetFeatures(ShaderFeatureSet features);
 
 	void AddTextureSRV(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	void AddSampler(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
 
-	void PrepareTextures();
+	void PrepareTextures(ID3D11DeviceContext* context = 0);
+	void PrepareTextures(std::shared_ptr<SimplePixelShader> targetShader, ID3D11DeviceContext* context = 0);
 
 private:
 
+	// Re-resolves the shader handles whenever a shader changes
+	void ResolveShaderHandles();
+
+	// Picks the permutation for the current features & textures
+	void UpdatePixelShaderVariant();
+
 	// Properties
 	DirectX::XMFLOAT3 colorTint;
 	float roughness;
@@ -45,6 +86,12 @@ private:
 	// Shaders
 	std::shared_ptr<SimpleVertexShader> vertexShader;
 	std::shared_ptr<SimplePixelShader> pixelShader;
+	MaterialShaderHandles shaderHandles;
+
+	// Permutation selection (unused with a fixed pixel shader)
+	std::shared_ptr<ShaderPermutations> permutations;
+	ShaderFeatureSet features;
+	bool variantDirty;
 
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textureSRVs;
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>> samplers;
@@ -0,0 +1,51 @@
+#include "MemoryCommandBackend.h"
+
+MemoryCommandBackend::MemoryCommandBackend() :
+	submitCount(0)
+{
+}
+
+MemoryCommandBackend::~MemoryCommandBackend()
+{
+}
+
+CommandContext* MemoryCommandBackend::GetImmediateContext()
+{
+	return &immediate;
+}
+
+// --------------------------------------------------------
+// Makes sure there's a context (and a finished list slot)
+// for each list, before any threads start recording
+// --------------------------------------------------------
+bool MemoryCommandBackend::BeginRecording(uint32_t count)
+{
+	while (contexts.size() < count)
+		contexts.push_back(std::make_unique<MemoryCommandContext>());
+
+	lists.resize(contexts.size());
+	for (uint32_t i = 0; i < count; i++)
+	{
+		contexts[i]->Commands.clear();
+		lists[i].clear();
+	}
+	return true;
+}
+
+CommandContext* MemoryCommandBackend::GetRecordingContext(uint32_t index)
+{
+	return contexts[index].get();
+}
+
+void MemoryCommandBackend::FinishRecording(uint32_t index)
+{
+	lists[index].swap(contexts[index]->Commands);
+	contexts[index]->Commands.clear();
+}
+
+void MemoryCommandBackend::Submit(uint32_t index)
+{
+	immediate.Commands.insert(immediate.Commands.end(), lists[index].begin(), lists[index].end());
+	lists[index].clear();
+	submitCount++;
+}
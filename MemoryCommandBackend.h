@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "CommandRecorder.h"
+
+// --------------------------------------------------------
+// A list of plain numbers standing in for commands
+// --------------------------------------------------------
+class MemoryCommandContext : public CommandContext
+{
+public:
+	void Record(uint32_t command) { Commands.push_back(command); }
+
+	std::vector<uint32_t> Commands;
+};
+
+// --------------------------------------------------------
+// A CommandBackend that records into memory, so recording
+// and submission order can be checked without a GPU.
+// Submitted lists are appended to the immediate context's
+// commands, which is everything "run" so far.
+// --------------------------------------------------------
+class MemoryCommandBackend : public CommandBackend
+{
+public:
+	MemoryCommandBackend();
+	~MemoryCommandBackend();
+
+	// CommandBackend
+	CommandContext* GetImmediateContext();
+	bool BeginRecording(uint32_t count);
+	CommandContext* GetRecordingContext(uint32_t index);
+	void FinishRecording(uint32_t index);
+	void Submit(uint32_t index);
+
+	// Everything run so far, in order
+	const std::vector<uint32_t>& GetExecuted() const { return immediate.Commands; }
+	void ClearExecuted() { immediate.Commands.clear(); }
+
+	uint32_t GetContextCount() const { return (uint32_t)contexts.size(); }
+	uint32_t GetSubmitCount() const { return submitCount; }
+
+private:
+	MemoryCommandContext immediate;
+	std::vector<std::unique_ptr<MemoryCommandContext>> contexts;
+	std::vector<std::vector<uint32_t>> lists;
+	uint32_t submitCount;
+};
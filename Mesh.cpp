@@ -3,6 +3,12 @@
 #include <fstream>
 #include <vector>
 
+// The OBJ patterns below only read numbers, so the bounds
+// checked version isn't needed where it doesn't exist
+#ifndef _WIN32
+#define sscanf_s sscanf
+#endif
+
 // For the DirectX Math library
 using namespace DirectX;
 
@@ -15,59 +21,28 @@ Mesh::Mesh(
 	int vertexCount, 
 	unsigned int* indices, 
 	int _indexCount, 
-	Microsoft::WRL::ComPtr<ID3D11Device> device,
-	Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context)
+	std::shared_ptr<RHIDevice> device)
 	:
-	indexCount(_indexCount),
-	context(_context)
+	device(device),
+	indexCount(_indexCount)
 {
-	// Create the vertex buffer
-	{
-		// Describe the vertex buffer
-		D3D11_BUFFER_DESC vbd = {};
-		vbd.Usage = D3D11_USAGE_IMMUTABLE;	// Will NEVER change
-		vbd.ByteWidth = sizeof(Vertex) * vertexCount;       // number of vertices in the buffer
-		vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Tells Direct3D this is a vertex buffer
-		vbd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
-		vbd.MiscFlags = 0;
-		vbd.StructureByteStride = 0;
-
-		// Create the proper struct to hold the vertex data
-		D3D11_SUBRESOURCE_DATA res_VertexData = {};
-		res_VertexData.pSysMem = vertices; // pSysMem = Pointer to System Memory
-
-		// Actually create the vertex buffer on the GPU (Output to check HRESULT Flag)
-		std::cout << device->CreateBuffer(&vbd, &res_VertexData, vertexBuffer.GetAddressOf()) <<std::endl;
-	}
-	
-	// Create the index buffer
-	{
-		// Describe the index buffer
-		D3D11_BUFFER_DESC ibd = {};
-		ibd.Usage = D3D11_USAGE_IMMUTABLE;	// Will NEVER change
-		ibd.ByteWidth = sizeof(unsigned int) * _indexCount;	// number of indices in the buffer
-		ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;	// Tells Direct3D this is an index buffer
-		ibd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
-		ibd.MiscFlags = 0;
-		ibd.StructureByteStride = 0;
-
-		// Create the proper struct to hold the index data
-		D3D11_SUBRESOURCE_DATA res_IndexData = {};
-		res_IndexData.pSysMem = indices; // pSysMem = Pointer to System Memory
-
-		// Actually create the vertex buffer on the GPU (Output to check HRESULT Flag)
-		std::cout << device->CreateBuffer(&ibd, &res_IndexData, indexBuffer.GetAddressOf()) << std::endl;
-	}
+	CalculateBounds(vertices, vertexCount);
+	CreateBuffers(vertices, vertexCount, indices, _indexCount);
 }
 
-Mesh::Mesh(const std::wstring& objFile, Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) :
-	context(context)
+Mesh::Mesh(const std::wstring& objFile, std::shared_ptr<RHIDevice> device) :
+	device(device)
 {
 	// In case file read fails
 	indexCount = 0;
 
-	// File input object
+	// File input object (only MSVC opens wide paths, so
+	// elsewhere they're narrowed - fine for ASCII paths)
+#ifdef _WIN32
 	std::ifstream obj(objFile);
+#else
+	std::ifstream obj(std::string(objFile.begin(), objFile.end()));
+#endif
 
 	// Check for successful open
 	if (!obj.is_open())
@@ -78,7 +53,7 @@ Mesh::Mesh(const std::wstring& objFile, Microsoft::WRL::ComPtr<ID3D11Device> dev
 	std::vector<XMFLOAT3> normals;		// Normals from the file
 	std::vector<XMFLOAT2> uvs;		// UVs from the file
 	std::vector<Vertex> verts;		// Verts we're assembling
-	std::vector<UINT> indices;		// Indices of these verts
+	std::vector<unsigned int> indices;	// Indices of these verts
 	int vertCounter = 0;			// Count of vertices
 	int indexCounter = 0;			// Count of indices
 	char chars[100];			// String for line reading
@@ -261,6 +236,7 @@ Mesh::Mesh(const std::wstring& objFile, Microsoft::WRL::ComPtr<ID3D11Device> dev
 	indexCount = indexCounter;
 
 	CalculateTangents(&verts[0], vertCounter, &indices[0], indexCounter);
+	CalculateBounds(&verts[0], vertCounter);
 
 	// - At this point, "verts" is a vector of Vertex structs, and can be used
 	//    directly to create a vertex buffer:  &verts[0] is the address of the first vert
@@ -275,43 +251,47 @@ Mesh::Mesh(const std::wstring& objFile, Microsoft::WRL::ComPtr<ID3D11Device> dev
 	//    and detect duplicate vertices, but at that point it would be better to use a more
 	//    sophisticated model loading library like TinyOBJLoader or The Open Asset Importer Library
 
+	CreateBuffers(&verts[0], vertCounter, &indices[0], indexCounter);
+}
+
+// --------------------------------------------------------
+// Puts the vertices & indices in immutable GPU buffers
+// --------------------------------------------------------
+void Mesh::CreateBuffers(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+{
 	// Create the vertex buffer
-	{
-		// Describe the vertex buffer
-		D3D11_BUFFER_DESC vbd = {};
-		vbd.Usage = D3D11_USAGE_IMMUTABLE;	// Will NEVER change
-		vbd.ByteWidth = sizeof(Vertex) * vertCounter;       // number of vertices in the buffer
-		vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Tells Direct3D this is a vertex buffer
-		vbd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
-		vbd.MiscFlags = 0;
-		vbd.StructureByteStride = 0;
-
-		// Create the proper struct to hold the vertex data
-		D3D11_SUBRESOURCE_DATA res_VertexData = {};
-		res_VertexData.pSysMem = &verts[0]; // pSysMem = Pointer to System Memory
-
-		// Actually create the vertex buffer on the GPU (Output to check HRESULT Flag)
-		std::cout << device->CreateBuffer(&vbd, &res_VertexData, vertexBuffer.GetAddressOf()) << std::endl;
-	}
+	RHIBufferDesc vbd = {};
+	vbd.Size = sizeof(Vertex) * numVerts;		// number of vertices in the buffer
+	vbd.BindFlags = RHI_BIND_VERTEX_BUFFER;
+	vbd.Usage = RHI_USAGE_IMMUTABLE;			// Will NEVER change
+	if (!device->CreateBuffer(vbd, verts, vertexBuffer))
+		std::cout << "Couldn't create a vertex buffer" << std::endl;
 
 	// Create the index buffer
-	{
-		// Describe the index buffer
-		D3D11_BUFFER_DESC ibd = {};
-		ibd.Usage = D3D11_USAGE_IMMUTABLE;	// Will NEVER change
-		ibd.ByteWidth = sizeof(unsigned int) * indexCounter;	// number of indices in the buffer
-		ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;	// Tells Direct3D this is an index buffer
-		ibd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
-		ibd.MiscFlags = 0;
-		ibd.StructureByteStride = 0;
-
-		// Create the proper struct to hold the index data
-		D3D11_SUBRESOURCE_DATA res_IndexData = {};
-		res_IndexData.pSysMem = &indices[0]; // pSysMem = Pointer to System Memory
-
-		// Actually create the vertex buffer on the GPU (Output to check HRESULT Flag)
-		std::cout << device->CreateBuffer(&ibd, &res_IndexData, indexBuffer.GetAddressOf()) << std::endl;
-	}
+	RHIBufferDesc ibd = {};
+	ibd.Size = sizeof(unsigned int) * numIndices;	// number of indices in the buffer
+	ibd.BindFlags = RHI_BIND_INDEX_BUFFER;
+	ibd.Usage = RHI_USAGE_IMMUTABLE;
+	if (!device->CreateBuffer(ibd, indices, indexBuffer))
+		std::cout << "Couldn't create an index buffer" << std::endl;
+}
+
+// --------------------------------------------------------
+// Move constructor - Take over another Mesh's buffers
+//  - The other is left empty, so its destructor frees nothing
+// --------------------------------------------------------
+Mesh::Mesh(Mesh&& other) :
+	device(std::move(other.device)),
+	indexCount(other.indexCount),
+	boundsCenter(other.boundsCenter),
+	boundsRadius(other.boundsRadius),
+	vertexBuffer(other.vertexBuffer),
+	indexBuffer(other.indexBuffer)
+{
+	// Leave the other with nothing to destroy
+	other.indexCount = 0;
+	other.vertexBuffer = RHIBuffer();
+	other.indexBuffer = RHIBuffer();
 }
 
 // --------------------------------------------------------
@@ -324,14 +304,18 @@ Mesh::~Mesh()
 	// Call delete or delete[] on any objects or arrays 
 	//  - Unnecessary if using smart pointers
 
-	// Call Release() on any Direct3D objects made within this class
-	// - Unnecessary for D3D objects stored in ComPtrs
+	// The buffers belong to the device, so hand them back
+	// (unless they were moved to another mesh)
+	if (!device)
+		return;
+	device->Destroy(vertexBuffer);
+	device->Destroy(indexBuffer);
 }
 
 // ----------------------------------
 // Getter funciton for Vertex buffer
 // ----------------------------------
-Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer()
+RHIBuffer Mesh::GetVertexBuffer()
 {
 	return vertexBuffer;
 }
@@ -339,7 +323,7 @@ Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer()
 // ---------------------------------
 // Getter function for Index buffer
 // ---------------------------------
-Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetIndexBuffer()
+RHIBuffer Mesh::GetIndexBuffer()
 {
 	return indexBuffer;
 }
@@ -352,6 +336,51 @@ int Mesh::GetIndexCount()
 	return indexCount;
 }
 
+// ---------------------------------
+// Getter functions for the bounding sphere
+// ---------------------------------
+DirectX::XMFLOAT3 Mesh::GetBoundsCenter()
+{
+	return boundsCenter;
+}
+
+float Mesh::GetBoundsRadius()
+{
+	return boundsRadius;
+}
+
+// --------------------------------------------------------
+// Finds a bounding sphere around the vertices: centered on
+// their bounding box, reaching the furthest vertex
+// --------------------------------------------------------
+void Mesh::CalculateBounds(Vertex* verts, int numVerts)
+{
+	boundsCenter = XMFLOAT3(0, 0, 0);
+	boundsRadius = 0.0f;
+	if (!verts || numVerts <= 0)
+		return;
+
+	XMVECTOR boxMin = XMLoadFloat3(&verts[0].position);
+	XMVECTOR boxMax = boxMin;
+	for (int i = 1; i < numVerts; i++)
+	{
+		XMVECTOR position = XMLoadFloat3(&verts[i].position);
+		boxMin = XMVectorMin(boxMin, position);
+		boxMax = XMVectorMax(boxMax, position);
+	}
+
+	XMVECTOR center = (boxMin + boxMax) * 0.5f;
+	XMVECTOR radiusSq = XMVectorZero();
+	for (int i = 0; i < numVerts; i++)
+	{
+		XMVECTOR toVertex = XMLoadFloat3(&verts[i].position) - center;
+		radiusSq = XMVectorMax(radiusSq, XMVector3LengthSq(toVertex));
+	}
+
+	XMStoreFloat3(&boundsCenter, center);
+	boundsRadius = sqrtf(XMVectorGetX(radiusSq));
+}
+
 // --------------------------------------------------------
 // Author: Chris Cascioli
 // Purpose: Calculates the tangents of the vertices in a mesh
@@ -445,20 +474,15 @@ void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices,
 // --------------
 // Draw function
 // --------------
-void Mesh::Draw()
+void Mesh::Draw(RHIContext* drawContext)
 {
-	// Initial values
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	{
-		// Set buffers in the input assembler (IA) stage
-		context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-		context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-
-		// Tell Direct3D to draw
-		context->DrawIndexed(
-			indexCount,     // The number of indices to use
-			0,     // Offset to the first index we want to use
-			0);    // Offset to add to each index when looking up vertices
-	}
+	if (!drawContext)
+		drawContext = device->GetImmediateContext();
+
+	// Set buffers in the input assembler (IA) stage
+	drawContext->SetVertexBuffer(vertexBuffer, sizeof(Vertex));
+	drawContext->SetIndexBuffer(indexBuffer, RHI_INDEX_UINT32);
+
+	// Draw every index, from the start of both buffers
+	drawContext->DrawIndexed(indexCount);
 }
\ No newline at end of file
@@ -1,10 +1,9 @@
 #pragma once
 
-#include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
-#include <d3d11.h>
-#include "DXCore.h"
+#include <memory>
 #include <string>
 #include "Vertex.h"
+#include "RHI.h"
 #include <DirectXMath.h>
 
 class Mesh
@@ -16,31 +15,49 @@ public:
 		int vertexCount,
 		unsigned int* indices,
 		int indexCount,
-		Microsoft::WRL::ComPtr<ID3D11Device> device,
-		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+		std::shared_ptr<RHIDevice> device);
 	Mesh(
 		const std::wstring& objFile,
-		Microsoft::WRL::ComPtr<ID3D11Device> device,
-		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+		std::shared_ptr<RHIDevice> device);
 	~Mesh();
+
+	// The buffers go with the mesh when it's moved, and can't
+	// be shared by a copy (both would destroy them)
+	Mesh(Mesh&& other);
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
 	
 	// Functions
-	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
-	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
+	RHIBuffer GetVertexBuffer();
+	RHIBuffer GetIndexBuffer();
 	int GetIndexCount();
+	DirectX::XMFLOAT3 GetBoundsCenter();
+	float GetBoundsRadius();
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
-	void Draw();
+
+	// Draws with the device's immediate context, unless another is given
+	void Draw(RHIContext* drawContext = 0);
 
 private:
 
-	// Context
-	Microsoft::WRL::ComPtr<ID3D11DeviceContext>	context;
+	// Local space bounding sphere, from the vertex positions
+	void CalculateBounds(Vertex* verts, int numVerts);
+
+	// Makes the (immutable) vertex & index buffers
+	void CreateBuffers(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+
+	// Device that owns the buffers
+	std::shared_ptr<RHIDevice> device;
 
 	// Counts
 	int indexCount;
 
+	// Bounds
+	DirectX::XMFLOAT3 boundsCenter;
+	float boundsRadius;
+
 	// Buffers
-	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
-	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+	RHIBuffer vertexBuffer;
+	RHIBuffer indexBuffer;
 };
 
@@ -0,0 +1,205 @@
+#include "NullRHIDevice.h"
+#include "RenderTargetPool.h"
+
+#include <cstring>
+
+// What each id refers to
+#define NULL_RHI_RESOURCE_BUFFER			0
+#define NULL_RHI_RESOURCE_TEXTURE			1
+#define NULL_RHI_RESOURCE_VIEW				2
+#define NULL_RHI_RESOURCE_PIPELINE_STATE	3
+
+// --------------------------------------------------------
+// Context
+// --------------------------------------------------------
+NullRHIContext::NullRHIContext() :
+	logging(false)
+{
+	Reset();
+}
+
+NullRHIContext::~NullRHIContext()
+{
+}
+
+void NullRHIContext::Reset()
+{
+	log.clear();
+	memset(callCounts, 0, sizeof(callCounts));
+	vertexCount = 0;
+	uploadBytes = 0;
+	errorCount = 0;
+	indexBuffer = RHIBuffer();
+}
+
+void NullRHIContext::Record(uint32_t type, uint64_t resource, uint32_t count)
+{
+	callCounts[type]++;
+	if (logging)
+		log.push_back(NullRHICall{ type, resource, count });
+}
+
+void NullRHIContext::SetPipelineState(RHIPipelineState state)
+{
+	Record(NULL_RHI_CALL_SET_PIPELINE_STATE, state.Id, 0);
+}
+
+void NullRHIContext::SetViewport(const RHIViewport& viewport)
+{
+	Record(NULL_RHI_CALL_SET_VIEWPORT, 0, 0);
+}
+
+void NullRHIContext::SetRenderTargets(const RHIView* colors, uint32_t colorCount, RHIView depth)
+{
+	Record(NULL_RHI_CALL_SET_RENDER_TARGETS, depth.Id, colorCount);
+}
+
+void NullRHIContext::SetVertexBuffer(RHIBuffer buffer, uint32_t stride, uint32_t offset)
+{
+	Record(NULL_RHI_CALL_SET_VERTEX_BUFFER, buffer.Id, stride);
+}
+
+void NullRHIContext::SetIndexBuffer(RHIBuffer buffer, uint32_t format)
+{
+	indexBuffer = buffer;
+	Record(NULL_RHI_CALL_SET_INDEX_BUFFER, buffer.Id, format);
+}
+
+void NullRHIContext::ClearRenderTarget(RHIView view, const float color[4])
+{
+	Record(NULL_RHI_CALL_CLEAR, view.Id, 0);
+}
+
+void NullRHIContext::ClearDepthStencil(RHIView view, float depth)
+{
+	Record(NULL_RHI_CALL_CLEAR, view.Id, 0);
+}
+
+void NullRHIContext::UpdateBuffer(RHIBuffer buffer, const void* data, uint32_t size)
+{
+	uploadBytes += size;
+	Record(NULL_RHI_CALL_UPDATE_BUFFER, buffer.Id, size);
+}
+
+void NullRHIContext::Draw(uint32_t vertexCount, uint32_t firstVertex)
+{
+	this->vertexCount += vertexCount;
+	Record(NULL_RHI_CALL_DRAW, 0, vertexCount);
+}
+
+void NullRHIContext::DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex)
+{
+	// Would draw garbage (or nothing) on a real device
+	if (!indexBuffer.IsValid())
+		errorCount++;
+
+	vertexCount += indexCount;
+	Record(NULL_RHI_CALL_DRAW_INDEXED, indexBuffer.Id, indexCount);
+}
+
+// --------------------------------------------------------
+// Device
+// --------------------------------------------------------
+NullRHIDevice::NullRHIDevice() :
+	nextId(1),
+	bufferBytes(0),
+	textureBytes(0),
+	peakBytes(0),
+	invalidDestroyCount(0)
+{
+}
+
+NullRHIDevice::~NullRHIDevice()
+{
+}
+
+bool NullRHIDevice::CreateBuffer(const RHIBufferDesc& desc, const void* initialData, RHIBuffer& buffer)
+{
+	// Same rules as Direct3D
+	if (desc.Size == 0 || (desc.Usage == RHI_USAGE_IMMUTABLE && !initialData))
+		return false;
+
+	buffer.Id = Add(NULL_RHI_RESOURCE_BUFFER, desc.Size);
+	return true;
+}
+
+bool NullRHIDevice::CreateTexture(const RHITextureDesc& desc, const void* initialData, uint32_t rowPitch, RHITexture& texture)
+{
+	if (desc.Width == 0 || desc.Height == 0 || desc.ArraySize == 0 || (desc.Usage == RHI_USAGE_IMMUTABLE && !initialData))
+		return false;
+
+	// Initial data only covers one mip of one slice
+	if (initialData && (desc.MipLevels != 1 || desc.ArraySize != 1))
+		return false;
+
+	texture.Id = Add(NULL_RHI_RESOURCE_TEXTURE, GetTextureBytes(desc));
+	return true;
+}
+
+bool NullRHIDevice::CreateView(RHITexture texture, uint32_t type, RHIView& view)
+{
+	auto it = resources.find(texture.Id);
+	if (it == resources.end() || it->second.Type != NULL_RHI_RESOURCE_TEXTURE)
+		return false;
+
+	view.Id = Add(NULL_RHI_RESOURCE_VIEW, 0);
+	return true;
+}
+
+bool NullRHIDevice::CreatePipelineState(const RHIPipelineStateDesc& desc, RHIPipelineState& state)
+{
+	state.Id = Add(NULL_RHI_RESOURCE_PIPELINE_STATE, 0);
+	return true;
+}
+
+void NullRHIDevice::Destroy(RHIBuffer buffer) { Remove(NULL_RHI_RESOURCE_BUFFER, buffer.Id); }
+void NullRHIDevice::Destroy(RHITexture texture) { Remove(NULL_RHI_RESOURCE_TEXTURE, texture.Id); }
+void NullRHIDevice::Destroy(RHIView view) { Remove(NULL_RHI_RESOURCE_VIEW, view.Id); }
+void NullRHIDevice::Destroy(RHIPipelineState state) { Remove(NULL_RHI_RESOURCE_PIPELINE_STATE, state.Id); }
+
+uint64_t NullRHIDevice::Add(uint32_t type, uint64_t bytes)
+{
+	uint64_t id = nextId++;
+	resources[id] = Resource{ type, bytes };
+
+	if (type == NULL_RHI_RESOURCE_BUFFER) bufferBytes += bytes;
+	if (type == NULL_RHI_RESOURCE_TEXTURE) textureBytes += bytes;
+	if (bufferBytes + textureBytes > peakBytes)
+		peakBytes = bufferBytes + textureBytes;
+	return id;
+}
+
+// --------------------------------------------------------
+// Destroying nothing is fine (like releasing a null COM
+// pointer), but destroying something that isn't there, or
+// isn't what the caller thinks it is, gets counted
+// --------------------------------------------------------
+void NullRHIDevice::Remove(uint32_t type, uint64_t id)
+{
+	if (id == 0)
+		return;
+
+	auto it = resources.find(id);
+	if (it == resources.end() || it->second.Type != type)
+	{
+		invalidDestroyCount++;
+		return;
+	}
+
+	if (type == NULL_RHI_RESOURCE_BUFFER) bufferBytes -= it->second.Bytes;
+	if (type == NULL_RHI_RESOURCE_TEXTURE) textureBytes -= it->second.Bytes;
+	resources.erase(it);
+}
+
+uint64_t NullRHIDevice::GetTextureBytes(const RHITextureDesc& desc)
+{
+	uint64_t bytes = 0;
+	uint32_t mips = desc.MipLevels > 0 ? desc.MipLevels : 1;
+	for (uint32_t mip = 0; mip < mips; mip++)
+	{
+		uint64_t width = desc.Width >> mip > 0 ? desc.Width >> mip : 1;
+		uint64_t height = desc.Height >> mip > 0 ? desc.Height >> mip : 1;
+		bytes += width * height * RenderTargetPool::GetBytesPerPixel(desc.Format);
+	}
+	return bytes * desc.ArraySize;
+}
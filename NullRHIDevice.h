@@ -0,0 +1,131 @@
+#pragma once
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "RHI.h"
+
+// Calls the null contexts count (and log)
+#define NULL_RHI_CALL_SET_PIPELINE_STATE	0
+#define NULL_RHI_CALL_SET_VIEWPORT			1
+#define NULL_RHI_CALL_SET_RENDER_TARGETS	2
+#define NULL_RHI_CALL_SET_VERTEX_BUFFER		3
+#define NULL_RHI_CALL_SET_INDEX_BUFFER		4
+#define NULL_RHI_CALL_CLEAR					5
+#define NULL_RHI_CALL_UPDATE_BUFFER			6
+#define NULL_RHI_CALL_DRAW					7
+#define NULL_RHI_CALL_DRAW_INDEXED			8
+#define NULL_RHI_CALL_TYPE_COUNT			9
+
+// --------------------------------------------------------
+// One logged call: what was bound, or how many vertices,
+// indices or bytes were involved
+// --------------------------------------------------------
+struct NullRHICall
+{
+	uint32_t Type;
+	uint64_t Resource;
+	uint32_t Count;
+};
+
+// --------------------------------------------------------
+// A context that draws nothing, but counts what it's asked
+// to do (and optionally logs every call).  Make one per
+// thread when recording in parallel.
+// --------------------------------------------------------
+class NullRHIContext : public RHIContext
+{
+public:
+	NullRHIContext();
+	~NullRHIContext();
+
+	// RHIContext
+	void SetPipelineState(RHIPipelineState state);
+	void SetViewport(const RHIViewport& viewport);
+	void SetRenderTargets(const RHIView* colors, uint32_t colorCount, RHIView depth);
+	void SetVertexBuffer(RHIBuffer buffer, uint32_t stride, uint32_t offset = 0);
+	void SetIndexBuffer(RHIBuffer buffer, uint32_t format);
+	void ClearRenderTarget(RHIView view, const float color[4]);
+	void ClearDepthStencil(RHIView view, float depth);
+	void UpdateBuffer(RHIBuffer buffer, const void* data, uint32_t size);
+	void Draw(uint32_t vertexCount, uint32_t firstVertex = 0);
+	void DrawIndexed(uint32_t indexCount, uint32_t firstIndex = 0, int32_t baseVertex = 0);
+
+	// Logging every call costs memory, so it's off by default
+	void SetLogging(bool logging) { this->logging = logging; }
+	const std::vector<NullRHICall>& GetLog() const { return log; }
+
+	// Stats since the last Reset()
+	uint32_t GetCallCount(uint32_t type) const { return type < NULL_RHI_CALL_TYPE_COUNT ? callCounts[type] : 0; }
+	uint32_t GetDrawCount() const { return callCounts[NULL_RHI_CALL_DRAW] + callCounts[NULL_RHI_CALL_DRAW_INDEXED]; }
+	uint64_t GetVertexCount() const { return vertexCount; }
+	uint64_t GetUploadBytes() const { return uploadBytes; }
+	uint32_t GetErrorCount() const { return errorCount; }
+	void Reset();
+
+private:
+	void Record(uint32_t type, uint64_t resource, uint32_t count);
+
+	bool logging;
+	std::vector<NullRHICall> log;
+	uint32_t callCounts[NULL_RHI_CALL_TYPE_COUNT];
+	uint64_t vertexCount;
+	uint64_t uploadBytes;
+	uint32_t errorCount;
+
+	// Bound state, for catching draws that can't work
+	RHIBuffer indexBuffer;
+};
+
+// --------------------------------------------------------
+// A device with no GPU behind it.  Resources are just ids
+// and the memory they'd take up, so CPU-side code can run
+// (and be measured) at full scale anywhere.
+// --------------------------------------------------------
+class NullRHIDevice : public RHIDevice
+{
+public:
+	NullRHIDevice();
+	~NullRHIDevice();
+
+	// RHIDevice
+	bool CreateBuffer(const RHIBufferDesc& desc, const void* initialData, RHIBuffer& buffer);
+	bool CreateTexture(const RHITextureDesc& desc, const void* initialData, uint32_t rowPitch, RHITexture& texture);
+	bool CreateView(RHITexture texture, uint32_t type, RHIView& view);
+	bool CreatePipelineState(const RHIPipelineStateDesc& desc, RHIPipelineState& state);
+	void Destroy(RHIBuffer buffer);
+	void Destroy(RHITexture texture);
+	void Destroy(RHIView view);
+	void Destroy(RHIPipelineState state);
+	RHIContext* GetImmediateContext() { return &immediate; }
+	NullRHIContext& GetNullContext() { return immediate; }
+
+	// Memory a texture would take, including mips & slices
+	static uint64_t GetTextureBytes(const RHITextureDesc& desc);
+
+	// Stats
+	uint32_t GetLiveResourceCount() const { return (uint32_t)resources.size(); }
+	uint64_t GetBufferBytes() const { return bufferBytes; }
+	uint64_t GetTextureBytes() const { return textureBytes; }
+	uint64_t GetPeakBytes() const { return peakBytes; }
+	uint32_t GetInvalidDestroyCount() const { return invalidDestroyCount; }
+
+private:
+	struct Resource
+	{
+		uint32_t Type;
+		uint64_t Bytes;
+	};
+
+	uint64_t Add(uint32_t type, uint64_t bytes);
+	void Remove(uint32_t type, uint64_t id);
+
+	NullRHIContext immediate;
+	std::unordered_map<uint64_t, Resource> resources;
+	uint64_t nextId;
+	uint64_t bufferBytes;
+	uint64_t textureBytes;
+	uint64_t peakBytes;
+	uint32_t invalidDestroyCount;
+};
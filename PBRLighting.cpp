@@ -0,0 +1,280 @@
+#include "PBRLighting.h"
+#include "PBRLightingKernel.h"
+
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define PBR_LIGHTING_SSE 1
+#else
+#define PBR_LIGHTING_SSE 0
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// In PBRLightingAVX.cpp - false if it was built without AVX
+bool AccumulateLightsAVX(const PBRLight* lights, uint32_t lightCount, const float cameraPosition[3], const PBRSurfaceBatch& surfaces, PBRColorBatch& result);
+
+// --------------------------------------------------------
+// HLSL helpers
+// --------------------------------------------------------
+static float Dot(const float a[3], const float b[3])
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void Normalize(const float v[3], float result[3])
+{
+	float length = sqrtf(Dot(v, v));
+	result[0] = v[0] / length;
+	result[1] = v[1] / length;
+	result[2] = v[2] / length;
+}
+
+static float Saturate(float value)
+{
+	return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+// --------------------------------------------------------
+// ShaderIncludes.hlsli
+// --------------------------------------------------------
+float PBRLighting::Attenuate(const PBRLight& light, const float worldPos[3])
+{
+	float offset[3] = { light.Position[0] - worldPos[0], light.Position[1] - worldPos[1], light.Position[2] - worldPos[2] };
+	float dist = sqrtf(Dot(offset, offset));
+
+	float att = Saturate(1.0f - (dist * dist / (light.Range * light.Range)));
+
+	return att * att;
+}
+
+float PBRLighting::DiffusePBR(const float normal[3], const float dirToLight[3])
+{
+	return Saturate(Dot(normal, dirToLight));
+}
+
+void PBRLighting::DiffuseEnergyConserve(float diffuse, const float F[3], float metalness, float result[3])
+{
+	for (int c = 0; c < 3; c++)
+		result[c] = diffuse * (1 - F[c]) * (1 - metalness);
+}
+
+float PBRLighting::D_GGX(const float n[3], const float h[3], float roughness)
+{
+	float NdotH = Saturate(Dot(n, h));
+	float NdotH2 = NdotH * NdotH;
+	float a = roughness * roughness;
+	float a2 = a * a > PBR_MIN_ROUGHNESS ? a * a : PBR_MIN_ROUGHNESS;
+
+	float denomToSquare = NdotH2 * (a2 - 1) + 1;
+
+	return a2 / (PBR_PI * denomToSquare * denomToSquare);
+}
+
+// pow(x, 5) is written out, so the batches can match it exactly
+void PBRLighting::F_Schlick(const float v[3], const float h[3], const float f0[3], float result[3])
+{
+	float VdotH = Saturate(Dot(v, h));
+	float t = 1 - VdotH;
+	float t2 = t * t;
+	float t5 = t2 * t2 * t;
+
+	for (int c = 0; c < 3; c++)
+		result[c] = f0[c] + (1 - f0[c]) * t5;
+}
+
+float PBRLighting::G_SchlickGGX(const float n[3], const float v[3], float roughness)
+{
+	float r1 = roughness + 1;
+	float k = r1 * r1 / 8.0f;
+	float NdotV = Saturate(Dot(n, v));
+
+	return 1 / (NdotV * (1 - k) + k);
+}
+
+void PBRLighting::MicrofacetBRDF(const float n[3], const float l[3], const float v[3], float roughness, const float f0[3], float result[3], float F_out[3])
+{
+	float sum[3] = { v[0] + l[0], v[1] + l[1], v[2] + l[2] };
+	float h[3];
+	Normalize(sum, h);
+
+	float D = D_GGX(n, h, roughness);
+	float F[3];
+	F_Schlick(v, h, f0, F);
+	float G = G_SchlickGGX(n, v, roughness) * G_SchlickGGX(n, l, roughness);
+
+	float nDotL = Dot(n, l);
+	for (int c = 0; c < 3; c++)
+	{
+		F_out[c] = F[c];
+		result[c] = (D * F[c] * G) / 4 * (nDotL > 0.0f ? nDotL : 0.0f);
+	}
+}
+
+void PBRLighting::CalcLight(const PBRLight& light, const float normal[3], const float worldPos[3], const float camPos[3], float roughness, float metalness, const float surfaceColor[3], const float specColor[3], float result[3])
+{
+	result[0] = result[1] = result[2] = 0.0f;
+	if (light.Type < 0 || light.Type > 2)
+		return;
+
+	float negated[3] = { -light.Direction[0], -light.Direction[1], -light.Direction[2] };
+	float toLight[3];
+	Normalize(negated, toLight);
+
+	// SpotLight
+	if (light.Type == 2)
+	{
+		float diff = Saturate(Dot(normal, toLight));
+		for (int c = 0; c < 3; c++)
+			result[c] = diff * surfaceColor[c] * light.Color[c];
+		return;
+	}
+
+	// DirLight & PointLight
+	float atten = 1.0f;
+	if (light.Type == 1)
+	{
+		float offset[3] = { light.Position[0] - worldPos[0], light.Position[1] - worldPos[1], light.Position[2] - worldPos[2] };
+		Normalize(offset, toLight);
+		atten = Attenuate(light, worldPos);
+	}
+
+	float toCamera[3] = { camPos[0] - worldPos[0], camPos[1] - worldPos[1], camPos[2] - worldPos[2] };
+	float V[3];
+	Normalize(toCamera, V);
+
+	float diff = DiffusePBR(normal, toLight);
+	float F[3];
+	float spec[3];
+	MicrofacetBRDF(normal, toLight, V, roughness, specColor, spec, F);
+
+	float balancedDiff[3];
+	DiffuseEnergyConserve(diff, F, metalness, balancedDiff);
+
+	for (int c = 0; c < 3; c++)
+	{
+		if (light.Type == 0)
+			result[c] = (balancedDiff[c] * surfaceColor[c] + spec[c]) * light.Intensity * light.Color[c];
+		else
+			result[c] = (balancedDiff[c] * surfaceColor[c] + spec[c]) * light.Color[c] * light.Intensity * atten;
+	}
+}
+
+void PBRLighting::EvaluateLight(const PBRLight& light, const float normal[3], const float worldPos[3], const float camPos[3], float roughness, float metalness, const float surfaceColor[3], const float specColor[3], float result[3])
+{
+	PBRLight normalized = light;
+	Normalize(light.Direction, normalized.Direction);
+	CalcLight(normalized, normal, worldPos, camPos, roughness, metalness, surfaceColor, specColor, result);
+}
+
+// --------------------------------------------------------
+// Batches
+// --------------------------------------------------------
+#if PBR_LIGHTING_SSE
+namespace
+{
+	struct SSEFloat
+	{
+		static const uint32_t Lanes = 4;
+		__m128 v;
+
+		static SSEFloat Set(float value) { return SSEFloat{ _mm_set1_ps(value) }; }
+		static SSEFloat Load(const float* p) { return SSEFloat{ _mm_load_ps(p) }; }
+		static void Store(float* p, SSEFloat a) { _mm_store_ps(p, a.v); }
+		static SSEFloat Min(SSEFloat a, SSEFloat b) { return SSEFloat{ _mm_min_ps(a.v, b.v) }; }
+		static SSEFloat Max(SSEFloat a, SSEFloat b) { return SSEFloat{ _mm_max_ps(a.v, b.v) }; }
+		static SSEFloat Sqrt(SSEFloat a) { return SSEFloat{ _mm_sqrt_ps(a.v) }; }
+	};
+
+	inline SSEFloat operator+(SSEFloat a, SSEFloat b) { return SSEFloat{ _mm_add_ps(a.v, b.v) }; }
+	inline SSEFloat operator-(SSEFloat a, SSEFloat b) { return SSEFloat{ _mm_sub_ps(a.v, b.v) }; }
+	inline SSEFloat operator*(SSEFloat a, SSEFloat b) { return SSEFloat{ _mm_mul_ps(a.v, b.v) }; }
+	inline SSEFloat operator/(SSEFloat a, SSEFloat b) { return SSEFloat{ _mm_div_ps(a.v, b.v) }; }
+}
+#endif
+
+void PBRLighting::AccumulateLights(
+	const PBRLight* lights,
+	uint32_t lightCount,
+	const float cameraPosition[3],
+	const PBRSurfaceBatch& surfaces,
+	uint32_t count,
+	PBRColorBatch& result,
+	uint32_t path)
+{
+	if (count > PBR_LIGHTING_BATCH_SIZE)
+		count = PBR_LIGHTING_BATCH_SIZE;
+
+	if (path == PBR_LIGHTING_PATH_AVX && AccumulateLightsAVX(lights, lightCount, cameraPosition, surfaces, result))
+		return;
+
+#if PBR_LIGHTING_SSE
+	if (path != PBR_LIGHTING_PATH_SCALAR)
+	{
+		for (uint32_t first = 0; first < count; first += SSEFloat::Lanes)
+			PBRLightingKernel::AccumulateLights<SSEFloat>(lights, lightCount, cameraPosition, surfaces, first, result);
+		return;
+	}
+#endif
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		float normal[3] = { surfaces.NormalX[i], surfaces.NormalY[i], surfaces.NormalZ[i] };
+		float position[3] = { surfaces.PositionX[i], surfaces.PositionY[i], surfaces.PositionZ[i] };
+		float color[3] = { surfaces.ColorR[i], surfaces.ColorG[i], surfaces.ColorB[i] };
+		float specular[3] = { surfaces.SpecularR[i], surfaces.SpecularG[i], surfaces.SpecularB[i] };
+
+		for (uint32_t l = 0; l < lightCount; l++)
+		{
+			float light[3];
+			EvaluateLight(lights[l], normal, position, cameraPosition, surfaces.Roughness[i], surfaces.Metalness[i], color, specular, light);
+			result.R[i] += light[0];
+			result.G[i] += light[1];
+			result.B[i] += light[2];
+		}
+	}
+}
+
+// --------------------------------------------------------
+// AVX needs the CPU and the OS (which saves the registers)
+// --------------------------------------------------------
+static bool CPUHasAVX()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	int info[4];
+	__cpuid(info, 1);
+	bool osSaves = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	return osSaves && avx && (_xgetbv(0) & 6) == 6;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+	return __builtin_cpu_supports("avx") != 0;
+#else
+	return false;
+#endif
+}
+
+uint32_t PBRLighting::GetBestPath()
+{
+	// With no lights this just says whether the AVX file was built with AVX
+	static const PBRSurfaceBatch surfaces = {};
+	static PBRColorBatch result = {};
+	static const float origin[3] = {};
+	static const bool avx = CPUHasAVX() && AccumulateLightsAVX(0, 0, origin, surfaces, result);
+	if (avx)
+		return PBR_LIGHTING_PATH_AVX;
+
+	return PBR_LIGHTING_SSE ? PBR_LIGHTING_PATH_SSE : PBR_LIGHTING_PATH_SCALAR;
+}
+
+uint32_t PBRLighting::GetLaneCount(uint32_t path)
+{
+	switch (path)
+	{
+	case PBR_LIGHTING_PATH_AVX: return 8;
+	case PBR_LIGHTING_PATH_SSE: return 4;
+	default: return 1;
+	}
+}
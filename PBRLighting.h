@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdint.h>
+
+// --------------------------------------------------------
+// CPU mirror of the PBR lighting in ShaderIncludes.hlsli -
+// these must match.  The scalar functions follow the HLSL
+// line by line, so they double as the reference for
+// checking shader math; the batch functions light up to
+// eight pixels per call with SSE or AVX.
+// --------------------------------------------------------
+
+// Same values as ShaderIncludes.hlsli
+#define PBR_F0_NON_METAL	0.04f
+#define PBR_MIN_ROUGHNESS	0.0000001f
+#define PBR_PI				3.14159265359f
+
+// Batch code paths
+#define PBR_LIGHTING_PATH_SCALAR	0	// One pixel at a time
+#define PBR_LIGHTING_PATH_SSE		1	// Four at a time
+#define PBR_LIGHTING_PATH_AVX		2	// Eight at a time
+
+#define PBR_LIGHTING_BATCH_SIZE 8
+
+// Same layout as Light in Lights.h (and the shader's Light)
+struct PBRLight
+{
+	int Type;
+	float Direction[3];
+
+	float Range;
+	float Position[3];
+
+	float Intensity;
+	float Color[3];
+
+	float SpotFalloff;
+	float Padding[3];
+};
+
+// --------------------------------------------------------
+// Up to eight pixels' worth of surface, one array per
+// component so each loads straight into a register
+// --------------------------------------------------------
+struct alignas(32) PBRSurfaceBatch
+{
+	float NormalX[PBR_LIGHTING_BATCH_SIZE];		// Normalized
+	float NormalY[PBR_LIGHTING_BATCH_SIZE];
+	float NormalZ[PBR_LIGHTING_BATCH_SIZE];
+	float PositionX[PBR_LIGHTING_BATCH_SIZE];	// World space
+	float PositionY[PBR_LIGHTING_BATCH_SIZE];
+	float PositionZ[PBR_LIGHTING_BATCH_SIZE];
+	float ColorR[PBR_LIGHTING_BATCH_SIZE];		// Linear surface color
+	float ColorG[PBR_LIGHTING_BATCH_SIZE];
+	float ColorB[PBR_LIGHTING_BATCH_SIZE];
+	float SpecularR[PBR_LIGHTING_BATCH_SIZE];	// F0
+	float SpecularG[PBR_LIGHTING_BATCH_SIZE];
+	float SpecularB[PBR_LIGHTING_BATCH_SIZE];
+	float Roughness[PBR_LIGHTING_BATCH_SIZE];
+	float Metalness[PBR_LIGHTING_BATCH_SIZE];
+};
+
+struct alignas(32) PBRColorBatch
+{
+	float R[PBR_LIGHTING_BATCH_SIZE];
+	float G[PBR_LIGHTING_BATCH_SIZE];
+	float B[PBR_LIGHTING_BATCH_SIZE];
+};
+
+class PBRLighting
+{
+public:
+	// ShaderIncludes.hlsli, function for function
+	static float Attenuate(const PBRLight& light, const float worldPos[3]);
+	static float DiffusePBR(const float normal[3], const float dirToLight[3]);
+	static void DiffuseEnergyConserve(float diffuse, const float F[3], float metalness, float result[3]);
+	static float D_GGX(const float n[3], const float h[3], float roughness);
+	static void F_Schlick(const float v[3], const float h[3], const float f0[3], float result[3]);
+	static float G_SchlickGGX(const float n[3], const float v[3], float roughness);
+	static void MicrofacetBRDF(const float n[3], const float l[3], const float v[3], float roughness, const float f0[3], float result[3], float F_out[3]);
+	static void CalcLight(const PBRLight& light, const float normal[3], const float worldPos[3], const float camPos[3], float roughness, float metalness, const float surfaceColor[3], const float specColor[3], float result[3]);
+
+	// UberPS's EvaluateLight: CalcLight with the direction normalized first
+	static void EvaluateLight(const PBRLight& light, const float normal[3], const float worldPos[3], const float camPos[3], float roughness, float metalness, const float surfaceColor[3], const float specColor[3], float result[3]);
+
+	// --------------------------------------------------------
+	// Adds every light (via EvaluateLight) to the first count
+	// pixels of result, which usually starts out holding the
+	// ambient term.  Pixels past count are lit too (so fill
+	// them with something valid) but can be ignored.
+	// --------------------------------------------------------
+	static void AccumulateLights(
+		const PBRLight* lights,
+		uint32_t lightCount,
+		const float cameraPosition[3],
+		const PBRSurfaceBatch& surfaces,
+		uint32_t count,
+		PBRColorBatch& result,
+		uint32_t path);
+
+	// The widest path this CPU (and build) supports
+	static uint32_t GetBestPath();
+	static uint32_t GetLaneCount(uint32_t path);
+};
@@ -0,0 +1,46 @@
+#include "PBRLighting.h"
+
+// --------------------------------------------------------
+// The eight-wide batch path.  Only this file is built with
+// AVX enabled (/arch:AVX or -mavx), so nothing here runs
+// unless GetBestPath() has checked the CPU first.
+// --------------------------------------------------------
+#if defined(__AVX__)
+#include <immintrin.h>
+#include "PBRLightingKernel.h"
+
+namespace
+{
+	struct AVXFloat
+	{
+		static const uint32_t Lanes = 8;
+		__m256 v;
+
+		static AVXFloat Set(float value) { return AVXFloat{ _mm256_set1_ps(value) }; }
+		static AVXFloat Load(const float* p) { return AVXFloat{ _mm256_load_ps(p) }; }
+		static void Store(float* p, AVXFloat a) { _mm256_store_ps(p, a.v); }
+		static AVXFloat Min(AVXFloat a, AVXFloat b) { return AVXFloat{ _mm256_min_ps(a.v, b.v) }; }
+		static AVXFloat Max(AVXFloat a, AVXFloat b) { return AVXFloat{ _mm256_max_ps(a.v, b.v) }; }
+		static AVXFloat Sqrt(AVXFloat a) { return AVXFloat{ _mm256_sqrt_ps(a.v) }; }
+	};
+
+	inline AVXFloat operator+(AVXFloat a, AVXFloat b) { return AVXFloat{ _mm256_add_ps(a.v, b.v) }; }
+	inline AVXFloat operator-(AVXFloat a, AVXFloat b) { return AVXFloat{ _mm256_sub_ps(a.v, b.v) }; }
+	inline AVXFloat operator*(AVXFloat a, AVXFloat b) { return AVXFloat{ _mm256_mul_ps(a.v, b.v) }; }
+	inline AVXFloat operator/(AVXFloat a, AVXFloat b) { return AVXFloat{ _mm256_div_ps(a.v, b.v) }; }
+}
+
+bool AccumulateLightsAVX(const PBRLight* lights, uint32_t lightCount, const float cameraPosition[3], const PBRSurfaceBatch& surfaces, PBRColorBatch& result)
+{
+	PBRLightingKernel::AccumulateLights<AVXFloat>(lights, lightCount, cameraPosition, surfaces, 0, result);
+
+	// Don't pay for the switch back to SSE in the caller
+	_mm256_zeroupper();
+	return true;
+}
+#else
+bool AccumulateLightsAVX(const PBRLight*, uint32_t, const float[3], const PBRSurfaceBatch&, PBRColorBatch&)
+{
+	return false;
+}
+#endif
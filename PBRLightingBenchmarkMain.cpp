@@ -0,0 +1,152 @@
+// --------------------------------------------------------
+// Times PBRLighting's batch paths and prints how many
+// pixels each lights per second, for a range of light
+// counts.  Also reports how far the SIMD paths drift from
+// the scalar reference over the same pixels.
+//
+// Built by CMakeLists.txt:
+//
+//   PBRLightingBenchmarkMain --pixels 1048576 --repeats 5
+// --------------------------------------------------------
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "PBRLighting.h"
+
+static const char* pathNames[] = { "scalar", "sse", "avx" };
+
+// Repeatable pixels spread over a unit-ish patch of scene
+static void FillSurfaces(std::vector<PBRSurfaceBatch>& batches)
+{
+	uint32_t seed = 12345;
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f;
+	};
+
+	for (PBRSurfaceBatch& s : batches)
+	{
+		for (uint32_t i = 0; i < PBR_LIGHTING_BATCH_SIZE; i++)
+		{
+			float n[3] = { random() * 2 - 1, random() * 0.5f + 0.5f, random() * 2 - 1 };
+			float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			s.NormalX[i] = n[0] / length;
+			s.NormalY[i] = n[1] / length;
+			s.NormalZ[i] = n[2] / length;
+			s.PositionX[i] = random() * 10 - 5;
+			s.PositionY[i] = random() * 2;
+			s.PositionZ[i] = random() * 10 - 5;
+			s.ColorR[i] = random();
+			s.ColorG[i] = random();
+			s.ColorB[i] = random();
+			s.Metalness[i] = random() < 0.5f ? 0.0f : 1.0f;
+			s.SpecularR[i] = s.Metalness[i] > 0 ? s.ColorR[i] : PBR_F0_NON_METAL;
+			s.SpecularG[i] = s.Metalness[i] > 0 ? s.ColorG[i] : PBR_F0_NON_METAL;
+			s.SpecularB[i] = s.Metalness[i] > 0 ? s.ColorB[i] : PBR_F0_NON_METAL;
+			s.Roughness[i] = random();
+		}
+	}
+}
+
+// Alternates directional and point lights, like the demo scene
+static void FillLights(std::vector<PBRLight>& lights)
+{
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		PBRLight& light = lights[i];
+		light = {};
+		light.Type = i % 2;
+		light.Direction[0] = 1.0f;
+		light.Direction[1] = -1.0f - (float)i;
+		light.Direction[2] = 0.5f;
+		light.Position[0] = (float)i - 4;
+		light.Position[1] = 3.0f;
+		light.Position[2] = 2.0f - (float)i;
+		light.Range = 12.0f;
+		light.Intensity = 1.0f;
+		light.Color[0] = 1.0f;
+		light.Color[1] = 0.5f + i * 0.05f;
+		light.Color[2] = 0.75f;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t pixels = 1 << 20;
+	uint32_t repeats = 5;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string name = argv[i];
+		if (name == "--pixels") pixels = (uint32_t)atoi(argv[i + 1]);
+		else if (name == "--repeats") repeats = (uint32_t)atoi(argv[i + 1]);
+	}
+	if (pixels < PBR_LIGHTING_BATCH_SIZE || repeats == 0)
+	{
+		printf("Usage: PBRLightingBenchmarkMain [--pixels count] [--repeats count]\n");
+		return 1;
+	}
+
+	std::vector<PBRSurfaceBatch> surfaces(pixels / PBR_LIGHTING_BATCH_SIZE);
+	std::vector<PBRColorBatch> results(surfaces.size());
+	std::vector<PBRColorBatch> reference(surfaces.size());
+	FillSurfaces(surfaces);
+
+	uint32_t bestPath = PBRLighting::GetBestPath();
+	float cameraPosition[3] = { 0.0f, 2.0f, -10.0f };
+	printf("%u pixels, best path: %s\n\n", (uint32_t)surfaces.size() * PBR_LIGHTING_BATCH_SIZE, pathNames[bestPath]);
+	printf("lights  path     Mpixels/s  max rel. error\n");
+
+	const uint32_t lightCounts[] = { 1, 2, 4, 8, 16 };
+	for (uint32_t lightCount : lightCounts)
+	{
+		std::vector<PBRLight> lights(lightCount);
+		FillLights(lights);
+
+		for (uint32_t path = PBR_LIGHTING_PATH_SCALAR; path <= bestPath; path++)
+		{
+			std::vector<PBRColorBatch>& out = path == PBR_LIGHTING_PATH_SCALAR ? reference : results;
+
+			// Best of the repeats
+			double best = 1e30;
+			for (uint32_t r = 0; r < repeats; r++)
+			{
+				auto start = std::chrono::high_resolution_clock::now();
+				for (size_t b = 0; b < surfaces.size(); b++)
+				{
+					out[b] = {};
+					PBRLighting::AccumulateLights(lights.data(), lightCount, cameraPosition, surfaces[b], PBR_LIGHTING_BATCH_SIZE, out[b], path);
+				}
+				double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+				best = seconds < best ? seconds : best;
+			}
+
+			double maxError = 0;
+			if (path != PBR_LIGHTING_PATH_SCALAR)
+			{
+				for (size_t b = 0; b < surfaces.size(); b++)
+				{
+					for (uint32_t i = 0; i < PBR_LIGHTING_BATCH_SIZE; i++)
+					{
+						const float got[3] = { out[b].R[i], out[b].G[i], out[b].B[i] };
+						const float want[3] = { reference[b].R[i], reference[b].G[i], reference[b].B[i] };
+						for (int c = 0; c < 3; c++)
+						{
+							double error = fabs((double)got[c] - want[c]) / (fabs((double)want[c]) > 1e-3 ? fabs((double)want[c]) : 1e-3);
+							maxError = error > maxError ? error : maxError;
+						}
+					}
+				}
+			}
+
+			double mpixels = surfaces.size() * PBR_LIGHTING_BATCH_SIZE / best / 1e6;
+			printf("%6u  %-6s  %10.2f  %14.2e\n", lightCount, pathNames[path], mpixels, maxError);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cmath>
+
+#include "PBRLighting.h"
+
+// --------------------------------------------------------
+// The batch lighting loop, written once against a vector
+// type V and compiled for SSE in PBRLighting.cpp and for AVX
+// in PBRLightingAVX.cpp (which is built with AVX enabled).
+// Only include it from those two files.
+//
+// V needs Lanes, Set(float), Load/Store(float*), + - * /,
+// and Min, Max & Sqrt.  The math is done in the same order
+// as the scalar reference, so results match it closely.
+// --------------------------------------------------------
+namespace PBRLightingKernel
+{
+	template<typename V>
+	struct Vector3
+	{
+		V x, y, z;
+	};
+
+	template<typename V>
+	static inline V Dot(const Vector3<V>& a, const Vector3<V>& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	template<typename V>
+	static inline Vector3<V> Normalize(const Vector3<V>& a)
+	{
+		V length = V::Sqrt(Dot(a, a));
+		return Vector3<V>{ a.x / length, a.y / length, a.z / length };
+	}
+
+	template<typename V>
+	static inline V Saturate(V value)
+	{
+		return V::Min(V::Max(value, V::Set(0.0f)), V::Set(1.0f));
+	}
+
+	// Lights lanes [first, first + V::Lanes) of the batch
+	template<typename V>
+	static void AccumulateLights(
+		const PBRLight* lights,
+		uint32_t lightCount,
+		const float cameraPosition[3],
+		const PBRSurfaceBatch& s,
+		uint32_t first,
+		PBRColorBatch& result)
+	{
+		const V zero = V::Set(0.0f);
+		const V one = V::Set(1.0f);
+
+		Vector3<V> n = { V::Load(s.NormalX + first), V::Load(s.NormalY + first), V::Load(s.NormalZ + first) };
+		Vector3<V> p = { V::Load(s.PositionX + first), V::Load(s.PositionY + first), V::Load(s.PositionZ + first) };
+		Vector3<V> color = { V::Load(s.ColorR + first), V::Load(s.ColorG + first), V::Load(s.ColorB + first) };
+		Vector3<V> f0 = { V::Load(s.SpecularR + first), V::Load(s.SpecularG + first), V::Load(s.SpecularB + first) };
+		V roughness = V::Load(s.Roughness + first);
+		V metalness = V::Load(s.Metalness + first);
+
+		Vector3<V> total = { V::Load(result.R + first), V::Load(result.G + first), V::Load(result.B + first) };
+
+		// Same for every light
+		Vector3<V> toCamera = Normalize(Vector3<V>{
+			V::Set(cameraPosition[0]) - p.x,
+			V::Set(cameraPosition[1]) - p.y,
+			V::Set(cameraPosition[2]) - p.z });
+
+		V a = roughness * roughness;
+		V a2 = V::Max(a * a, V::Set(PBR_MIN_ROUGHNESS));
+		V r1 = roughness + one;
+		V k = r1 * r1 / V::Set(8.0f);
+		V gView = one / (Saturate(Dot(n, toCamera)) * (one - k) + k);
+		V diffuseScale = one - metalness;
+
+		for (uint32_t i = 0; i < lightCount; i++)
+		{
+			const PBRLight& light = lights[i];
+
+			// EvaluateLight normalizes the direction (a scalar)
+			float d[3] = { light.Direction[0], light.Direction[1], light.Direction[2] };
+			float dLength = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+			d[0] /= dLength;
+			d[1] /= dLength;
+			d[2] /= dLength;
+
+			Vector3<V> lightColor = { V::Set(light.Color[0]), V::Set(light.Color[1]), V::Set(light.Color[2]) };
+			Vector3<V> toLight;
+			V scale;
+			switch (light.Type)
+			{
+			case 0:	// LIGHT_TYPE_DIRECTIONAL
+			{
+				float l[3] = { -d[0], -d[1], -d[2] };
+				float lLength = sqrtf(l[0] * l[0] + l[1] * l[1] + l[2] * l[2]);
+				toLight = Vector3<V>{ V::Set(l[0] / lLength), V::Set(l[1] / lLength), V::Set(l[2] / lLength) };
+				scale = V::Set(light.Intensity);
+				break;
+			}
+
+			case 1:	// LIGHT_TYPE_POINT
+			{
+				Vector3<V> offset = {
+					V::Set(light.Position[0]) - p.x,
+					V::Set(light.Position[1]) - p.y,
+					V::Set(light.Position[2]) - p.z };
+				toLight = Normalize(offset);
+
+				V distanceSq = Dot(offset, offset);
+				V dist = V::Sqrt(distanceSq);
+				V att = Saturate(one - (dist * dist / V::Set(light.Range * light.Range)));
+				scale = V::Set(light.Intensity) * (att * att);
+				break;
+			}
+
+			case 2:	// LIGHT_TYPE_SPOT (just diffuse, like the shader)
+			{
+				float l[3] = { -d[0], -d[1], -d[2] };
+				float lLength = sqrtf(l[0] * l[0] + l[1] * l[1] + l[2] * l[2]);
+				toLight = Vector3<V>{ V::Set(l[0] / lLength), V::Set(l[1] / lLength), V::Set(l[2] / lLength) };
+
+				V diff = Saturate(Dot(n, toLight));
+				total.x = total.x + diff * color.x * lightColor.x;
+				total.y = total.y + diff * color.y * lightColor.y;
+				total.z = total.z + diff * color.z * lightColor.z;
+				continue;
+			}
+
+			default:
+				continue;
+			}
+
+			V nDotL = Dot(n, toLight);
+			V diff = Saturate(nDotL);
+
+			// MicrofacetBRDF
+			Vector3<V> h = Normalize(Vector3<V>{ toCamera.x + toLight.x, toCamera.y + toLight.y, toCamera.z + toLight.z });
+
+			V nDotH = Saturate(Dot(n, h));
+			V denomToSquare = nDotH * nDotH * (a2 - one) + one;
+			V D = a2 / (V::Set(PBR_PI) * denomToSquare * denomToSquare);
+
+			V t = one - Saturate(Dot(toCamera, h));
+			V t2 = t * t;
+			V t5 = t2 * t2 * t;
+			Vector3<V> F = {
+				f0.x + (one - f0.x) * t5,
+				f0.y + (one - f0.y) * t5,
+				f0.z + (one - f0.z) * t5 };
+
+			V G = gView * (one / (diff * (one - k) + k));
+			V specScale = G / V::Set(4.0f) * V::Max(nDotL, zero);
+
+			// DiffuseEnergyConserve, then combine
+			V diffuse = diff * diffuseScale;
+			total.x = total.x + (diffuse * (one - F.x) * color.x + D * F.x * specScale) * lightColor.x * scale;
+			total.y = total.y + (diffuse * (one - F.y) * color.y + D * F.y * specScale) * lightColor.y * scale;
+			total.z = total.z + (diffuse * (one - F.z) * color.z + D * F.z * specScale) * lightColor.z * scale;
+		}
+
+		V::Store(result.R + first, total.x);
+		V::Store(result.G + first, total.y);
+		V::Store(result.B + first, total.z);
+	}
+}
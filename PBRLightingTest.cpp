@@ -0,0 +1,251 @@
+// --------------------------------------------------------
+// Tests PBRLighting against values worked out by hand:
+//
+//  - D_GGX, F_Schlick and G_SchlickGGX where the formulas
+//    in ShaderIncludes.hlsli simplify (aligned and
+//    perpendicular vectors, roughness 1)
+//  - CalcLight for each light type, looking straight down
+//    a light onto a flat surface
+//
+// Then lights random batches with every path this machine
+// supports, which must stay within float rounding of the
+// scalar reference - for every light type, and for partial
+// batches.
+// --------------------------------------------------------
+#include <cmath>
+#include <vector>
+
+#include "PBRLighting.h"
+#include "TestCheck.h"
+
+static bool Near(float a, float b, float tolerance = 1e-5f)
+{
+	return fabsf(a - b) <= tolerance * (fabsf(b) > 1.0f ? fabsf(b) : 1.0f);
+}
+
+static void TestDistribution()
+{
+	const float up[3] = { 0.0f, 1.0f, 0.0f };
+	const float side[3] = { 1.0f, 0.0f, 0.0f };
+
+	// h == n: a2 / (pi * a2^2) = 1 / (pi * roughness^4)
+	CHECK(Near(PBRLighting::D_GGX(up, up, 0.5f), 1.0f / (PBR_PI * 0.0625f)));
+	CHECK(Near(PBRLighting::D_GGX(up, up, 0.5f), 5.0929582f));
+
+	// Roughness 1 is the same everywhere
+	CHECK(Near(PBRLighting::D_GGX(up, up, 1.0f), 1.0f / PBR_PI));
+	CHECK(Near(PBRLighting::D_GGX(up, side, 1.0f), 1.0f / PBR_PI));
+
+	// h at right angles to n: just a2 / pi
+	CHECK(Near(PBRLighting::D_GGX(up, side, 0.5f), 0.0625f / PBR_PI));
+
+	// Perfectly smooth stops at the minimum rather than dividing
+	// by 0 (a very sharp peak, though (a2 - 1) + 1 rounds it)
+	float smooth = PBRLighting::D_GGX(up, up, 0.0f);
+	CHECK(std::isfinite(smooth) && smooth > 1e5f);
+	CHECK(PBRLighting::D_GGX(up, side, 0.0f) < 1e-6f);
+}
+
+static void TestFresnel()
+{
+	const float up[3] = { 0.0f, 1.0f, 0.0f };
+	const float side[3] = { 1.0f, 0.0f, 0.0f };
+	const float sixty[3] = { sqrtf(3.0f) / 2.0f, 0.5f, 0.0f };	// cos = 0.5 to up
+	const float f0[3] = { 0.04f, 0.5f, 1.0f };
+	float F[3];
+
+	// Head on is just F0
+	PBRLighting::F_Schlick(up, up, f0, F);
+	CHECK(Near(F[0], 0.04f) && Near(F[1], 0.5f) && Near(F[2], 1.0f));
+
+	// Grazing is white
+	PBRLighting::F_Schlick(up, side, f0, F);
+	CHECK(Near(F[0], 1.0f) && Near(F[1], 1.0f) && Near(F[2], 1.0f));
+
+	// (1 - 0.5)^5 = 1/32 of the way to white
+	PBRLighting::F_Schlick(up, sixty, f0, F);
+	CHECK(Near(F[0], 0.04f + 0.96f / 32.0f));
+	CHECK(Near(F[1], 0.5f + 0.5f / 32.0f));
+	CHECK(Near(F[2], 1.0f));
+}
+
+static void TestGeometry()
+{
+	const float up[3] = { 0.0f, 1.0f, 0.0f };
+	const float side[3] = { 1.0f, 0.0f, 0.0f };
+	const float sixty[3] = { sqrtf(3.0f) / 2.0f, 0.5f, 0.0f };
+
+	// 1 / (NdotV * (1 - k) + k), with k = (roughness + 1)^2 / 8
+	CHECK(Near(PBRLighting::G_SchlickGGX(up, up, 1.0f), 1.0f));
+	CHECK(Near(PBRLighting::G_SchlickGGX(up, up, 0.0f), 1.0f));
+	CHECK(Near(PBRLighting::G_SchlickGGX(up, side, 1.0f), 2.0f));
+	CHECK(Near(PBRLighting::G_SchlickGGX(up, side, 0.0f), 8.0f));
+	CHECK(Near(PBRLighting::G_SchlickGGX(up, sixty, 1.0f), 1.0f / 0.75f));
+}
+
+static PBRLight MakeLight(int type)
+{
+	PBRLight light = {};
+	light.Type = type;
+	light.Direction[1] = -1.0f;
+	light.Position[1] = 2.0f;
+	light.Range = 4.0f;
+	light.Intensity = 2.0f;
+	light.Color[0] = 1.0f;
+	light.Color[1] = 0.5f;
+	light.Color[2] = 0.25f;
+	return light;
+}
+
+static void TestCalcLight()
+{
+	// A flat surface at the origin, seen and lit from straight
+	// above, so h = n = l = v and at roughness 1:
+	//   D = 1 / pi, F = f0, G = 1
+	//   spec = f0 / (4 pi), diffuse = (1 - f0) * (1 - metalness)
+	const float normal[3] = { 0.0f, 1.0f, 0.0f };
+	const float position[3] = { 0.0f, 0.0f, 0.0f };
+	const float camera[3] = { 0.0f, 5.0f, 0.0f };
+	const float color[3] = { 0.5f, 0.5f, 0.5f };
+	const float f0[3] = { PBR_F0_NON_METAL, PBR_F0_NON_METAL, PBR_F0_NON_METAL };
+	float shade = (1.0f - PBR_F0_NON_METAL) * 0.5f + PBR_F0_NON_METAL / (4.0f * PBR_PI);
+	CHECK(Near(shade, 0.48318310f));
+	float result[3];
+
+	// Directional: shade * intensity * color
+	PBRLight light = MakeLight(0);
+	PBRLighting::CalcLight(light, normal, position, camera, 1.0f, 0.0f, color, f0, result);
+	CHECK(Near(result[0], shade * 2.0f));
+	CHECK(Near(result[1], shade * 1.0f));
+	CHECK(Near(result[2], shade * 0.5f));
+
+	// Metals lose their diffuse
+	PBRLighting::CalcLight(light, normal, position, camera, 1.0f, 1.0f, color, f0, result);
+	CHECK(Near(result[0], PBR_F0_NON_METAL / (4.0f * PBR_PI) * 2.0f));
+
+	// Point, 2 away with range 4: (1 - 4 / 16)^2 = 0.5625
+	light = MakeLight(1);
+	CHECK(Near(PBRLighting::Attenuate(light, position), 0.5625f));
+	PBRLighting::CalcLight(light, normal, position, camera, 1.0f, 0.0f, color, f0, result);
+	CHECK(Near(result[0], shade * 2.0f * 0.5625f));
+	CHECK(Near(result[2], shade * 0.5f * 0.5625f));
+
+	// Out of range is dark
+	light.Range = 1.5f;
+	PBRLighting::CalcLight(light, normal, position, camera, 1.0f, 0.0f, color, f0, result);
+	CHECK(result[0] == 0.0f && result[1] == 0.0f && result[2] == 0.0f);
+
+	// Spot is still plain diffuse, without intensity
+	light = MakeLight(2);
+	PBRLighting::CalcLight(light, normal, position, camera, 1.0f, 0.0f, color, f0, result);
+	CHECK(Near(result[0], 0.5f) && Near(result[1], 0.25f) && Near(result[2], 0.125f));
+
+	// Unknown types add nothing
+	light = MakeLight(3);
+	PBRLighting::CalcLight(light, normal, position, camera, 1.0f, 0.0f, color, f0, result);
+	CHECK(result[0] == 0.0f && result[1] == 0.0f && result[2] == 0.0f);
+
+	// EvaluateLight normalizes the direction first
+	light = MakeLight(0);
+	light.Direction[1] = -7.0f;
+	PBRLighting::EvaluateLight(light, normal, position, camera, 1.0f, 0.0f, color, f0, result);
+	CHECK(Near(result[0], shade * 2.0f));
+}
+
+// Repeatable surfaces, some of them metal
+static void FillSurfaces(std::vector<PBRSurfaceBatch>& batches)
+{
+	uint32_t seed = 777;
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f;
+	};
+
+	for (PBRSurfaceBatch& s : batches)
+	{
+		for (uint32_t i = 0; i < PBR_LIGHTING_BATCH_SIZE; i++)
+		{
+			float n[3] = { random() * 2 - 1, random() * 0.5f + 0.5f, random() * 2 - 1 };
+			float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			s.NormalX[i] = n[0] / length;
+			s.NormalY[i] = n[1] / length;
+			s.NormalZ[i] = n[2] / length;
+			s.PositionX[i] = random() * 8 - 4;
+			s.PositionY[i] = random();
+			s.PositionZ[i] = random() * 8 - 4;
+			s.ColorR[i] = random();
+			s.ColorG[i] = random();
+			s.ColorB[i] = random();
+			s.Metalness[i] = random() < 0.5f ? 0.0f : 1.0f;
+			s.SpecularR[i] = s.Metalness[i] > 0 ? s.ColorR[i] : PBR_F0_NON_METAL;
+			s.SpecularG[i] = s.Metalness[i] > 0 ? s.ColorG[i] : PBR_F0_NON_METAL;
+			s.SpecularB[i] = s.Metalness[i] > 0 ? s.ColorB[i] : PBR_F0_NON_METAL;
+			s.Roughness[i] = random();
+		}
+	}
+}
+
+static void TestPathsMatchScalar()
+{
+	std::vector<PBRSurfaceBatch> surfaces(256);
+	FillSurfaces(surfaces);
+
+	// Every type, including one in range of only some pixels
+	std::vector<PBRLight> lights;
+	for (int type = 0; type < 3; type++)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			PBRLight light = MakeLight(type);
+			light.Direction[0] = 0.3f * (float)(i + 1);
+			light.Direction[2] = -0.2f * (float)type;
+			light.Position[0] = 2.0f * (float)i - 1.0f;
+			light.Position[2] = (float)type - 1.0f;
+			light.Range = 3.0f + 4.0f * (float)i;
+			lights.push_back(light);
+		}
+	}
+	const float camera[3] = { 0.0f, 2.0f, -10.0f };
+
+	uint32_t bestPath = PBRLighting::GetBestPath();
+	CHECK(PBRLighting::GetLaneCount(PBR_LIGHTING_PATH_SCALAR) == 1);
+	CHECK(PBRLighting::GetLaneCount(bestPath) >= 1);
+
+	for (uint32_t path = PBR_LIGHTING_PATH_SSE; path <= bestPath; path++)
+	{
+		for (size_t b = 0; b < surfaces.size(); b++)
+		{
+			// Partial batches too, starting from an ambient term
+			uint32_t count = b % 3 == 0 ? 1 + (uint32_t)(b % PBR_LIGHTING_BATCH_SIZE) : PBR_LIGHTING_BATCH_SIZE;
+			PBRColorBatch want, got;
+			for (uint32_t i = 0; i < PBR_LIGHTING_BATCH_SIZE; i++)
+			{
+				want.R[i] = got.R[i] = 0.1f;
+				want.G[i] = got.G[i] = 0.05f;
+				want.B[i] = got.B[i] = 0.0f;
+			}
+			PBRLighting::AccumulateLights(lights.data(), (uint32_t)lights.size(), camera, surfaces[b], count, want, PBR_LIGHTING_PATH_SCALAR);
+			PBRLighting::AccumulateLights(lights.data(), (uint32_t)lights.size(), camera, surfaces[b], count, got, path);
+
+			bool matches = true;
+			for (uint32_t i = 0; i < count; i++)
+			{
+				matches &= Near(got.R[i], want.R[i]);
+				matches &= Near(got.G[i], want.G[i]);
+				matches &= Near(got.B[i], want.B[i]);
+			}
+			CHECK(matches);
+		}
+	}
+}
+
+int main()
+{
+	TestDistribution();
+	TestFresnel();
+	TestGeometry();
+	TestCalcLight();
+	TestPathsMatchScalar();
+	return TestResult();
+}
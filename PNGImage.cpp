@@ -0,0 +1,519 @@
+#include "PNGImage.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+// --------------------------------------------------------
+// Reads a deflate stream least significant bit first.
+// Peeking past the end gives zeros, which only matters if
+// they're actually used - see Overran().
+// --------------------------------------------------------
+class BitReader
+{
+public:
+	BitReader(const uint8_t* data, size_t size) :
+		data(data), size(size), pos(0), bits(0), count(0), padding(0) {}
+
+	uint32_t Peek(uint32_t n)
+	{
+		while (count < n)
+		{
+			uint32_t byte = 0;
+			if (pos < size) byte = data[pos++];
+			else padding++;
+			bits |= byte << count;
+			count += 8;
+		}
+		return bits & ((1u << n) - 1);
+	}
+
+	void Drop(uint32_t n) { bits >>= n; count -= n; }
+	uint32_t Read(uint32_t n) { uint32_t value = Peek(n); Drop(n); return value; }
+	void AlignToByte() { Drop(count & 7); }
+	bool Overran() const { return padding * 8 > count; }
+
+private:
+	const uint8_t* data;
+	size_t size;
+	size_t pos;
+	uint32_t bits;
+	uint32_t count;
+	uint32_t padding;
+};
+
+// --------------------------------------------------------
+// A canonical Huffman code as a table indexed by the next
+// (longest code length) bits.  Entries are the symbol in
+// the low 9 bits and its code length above that.
+// --------------------------------------------------------
+struct HuffmanTable
+{
+	std::vector<uint16_t> Entries;
+	uint32_t MaxLength = 0;
+
+	bool Build(const uint8_t* lengths, uint32_t symbolCount)
+	{
+		uint32_t counts[16] = {};
+		MaxLength = 1;
+		for (uint32_t i = 0; i < symbolCount; i++)
+		{
+			counts[lengths[i]]++;
+			if (lengths[i] > MaxLength)
+				MaxLength = lengths[i];
+		}
+		counts[0] = 0;
+
+		// Too many codes of some length can't be decoded
+		int left = 1;
+		for (uint32_t len = 1; len < 16; len++)
+		{
+			left = (left << 1) - counts[len];
+			if (left < 0)
+				return false;
+		}
+
+		uint32_t nextCode[16] = {};
+		uint32_t code = 0;
+		for (uint32_t len = 1; len < 16; len++)
+		{
+			code = (code + counts[len - 1]) << 1;
+			nextCode[len] = code;
+		}
+
+		Entries.assign((size_t)1 << MaxLength, 0);
+		for (uint32_t symbol = 0; symbol < symbolCount; symbol++)
+		{
+			uint32_t len = lengths[symbol];
+			if (len == 0)
+				continue;
+
+			// Codes are stored most significant bit first
+			uint32_t c = nextCode[len]++;
+			uint32_t reversed = 0;
+			for (uint32_t i = 0; i < len; i++)
+				reversed |= ((c >> i) & 1) << (len - 1 - i);
+
+			for (uint32_t i = reversed; i < Entries.size(); i += 1u << len)
+				Entries[i] = (uint16_t)(symbol | (len << 9));
+		}
+		return true;
+	}
+
+	// Returns -1 for bits that aren't a code
+	int Decode(BitReader& reader) const
+	{
+		uint16_t entry = Entries[reader.Peek(MaxLength)];
+		uint32_t len = entry >> 9;
+		if (len == 0)
+			return -1;
+		reader.Drop(len);
+		return entry & 511;
+	}
+};
+
+static const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// --------------------------------------------------------
+// Reads the code lengths at the start of a dynamic block
+// --------------------------------------------------------
+static bool ReadDynamicTables(BitReader& reader, HuffmanTable& literals, HuffmanTable& distances)
+{
+	static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	uint32_t literalCount = reader.Read(5) + 257;
+	uint32_t distanceCount = reader.Read(5) + 1;
+	uint32_t codeLengthCount = reader.Read(4) + 4;
+	if (literalCount > 286 || distanceCount > 30)
+		return false;
+
+	uint8_t codeLengths[19] = {};
+	for (uint32_t i = 0; i < codeLengthCount; i++)
+		codeLengths[order[i]] = (uint8_t)reader.Read(3);
+
+	HuffmanTable codeLengthTable;
+	if (!codeLengthTable.Build(codeLengths, 19))
+		return false;
+
+	uint8_t lengths[286 + 30] = {};
+	uint32_t total = literalCount + distanceCount;
+	for (uint32_t i = 0; i < total;)
+	{
+		int symbol = codeLengthTable.Decode(reader);
+		if (symbol < 0)
+			return false;
+
+		if (symbol < 16)
+		{
+			lengths[i++] = (uint8_t)symbol;
+			continue;
+		}
+
+		// Runs of the previous length, or of zeros
+		uint8_t value = 0;
+		uint32_t repeat = 0;
+		if (symbol == 16)
+		{
+			if (i == 0)
+				return false;
+			value = lengths[i - 1];
+			repeat = 3 + reader.Read(2);
+		}
+		else if (symbol == 17)
+			repeat = 3 + reader.Read(3);
+		else
+			repeat = 11 + reader.Read(7);
+
+		if (i + repeat > total)
+			return false;
+		while (repeat--)
+			lengths[i++] = value;
+	}
+
+	return
+		literals.Build(lengths, literalCount) &&
+		distances.Build(lengths + literalCount, distanceCount);
+}
+
+// --------------------------------------------------------
+// Decompresses a zlib stream (deflate with a small header
+// and a checksum at the end)
+// --------------------------------------------------------
+static uint32_t Adler32(const uint8_t* data, size_t size)
+{
+	uint32_t a = 1, b = 0;
+	while (size > 0)
+	{
+		// Sums can't overflow within this many bytes
+		size_t block = size < 5552 ? size : 5552;
+		size -= block;
+		while (block--)
+		{
+			a += *data++;
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	return (b << 16) | a;
+}
+
+static bool Inflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out)
+{
+	if (size < 6 || (data[0] & 0x0F) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20))
+		return false;
+
+	BitReader reader(data + 2, size - 6);
+	HuffmanTable literals;
+	HuffmanTable distances;
+
+	bool final = false;
+	while (!final)
+	{
+		final = reader.Read(1) == 1;
+		uint32_t type = reader.Read(2);
+
+		if (type == 0)
+		{
+			// Stored
+			reader.AlignToByte();
+			uint32_t length = reader.Read(16);
+			uint32_t inverse = reader.Read(16);
+			if ((length ^ 0xFFFF) != inverse)
+				return false;
+			for (uint32_t i = 0; i < length; i++)
+				out.push_back((uint8_t)reader.Read(8));
+		}
+		else if (type == 1 || type == 2)
+		{
+			if (type == 1)
+			{
+				uint8_t lengths[288 + 30];
+				memset(lengths, 8, 144);
+				memset(lengths + 144, 9, 112);
+				memset(lengths + 256, 7, 24);
+				memset(lengths + 280, 8, 8);
+				memset(lengths + 288, 5, 30);
+				literals.Build(lengths, 288);
+				distances.Build(lengths + 288, 30);
+			}
+			else if (!ReadDynamicTables(reader, literals, distances))
+				return false;
+
+			while (true)
+			{
+				int symbol = literals.Decode(reader);
+				if (symbol < 0 || reader.Overran())
+					return false;
+				if (symbol < 256)
+				{
+					out.push_back((uint8_t)symbol);
+					continue;
+				}
+				if (symbol == 256)
+					break;
+
+				symbol -= 257;
+				if (symbol >= 29)
+					return false;
+				uint32_t length = lengthBase[symbol] + reader.Read(lengthExtra[symbol]);
+
+				int distanceSymbol = distances.Decode(reader);
+				if (distanceSymbol < 0 || distanceSymbol >= 30)
+					return false;
+				uint32_t distance = distanceBase[distanceSymbol] + reader.Read(distanceExtra[distanceSymbol]);
+				if (distance > out.size())
+					return false;
+
+				// Copies can overlap what they're writing
+				size_t from = out.size() - distance;
+				for (uint32_t i = 0; i < length; i++)
+					out.push_back(out[from + i]);
+			}
+		}
+		else
+			return false;
+
+		if (reader.Overran())
+			return false;
+	}
+
+	const uint8_t* checksum = data + size - 4;
+	uint32_t expected = ((uint32_t)checksum[0] << 24) | (checksum[1] << 16) | (checksum[2] << 8) | checksum[3];
+	return Adler32(out.data(), out.size()) == expected;
+}
+
+static uint32_t ReadBigEndian(const uint8_t* data)
+{
+	return ((uint32_t)data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+}
+
+static uint8_t Paeth(uint8_t a, uint8_t b, uint8_t c)
+{
+	int p = a + b - c;
+	int pa = p > a ? p - a : a - p;
+	int pb = p > b ? p - b : b - p;
+	int pc = p > c ? p - c : c - p;
+	if (pa <= pb && pa <= pc) return a;
+	if (pb <= pc) return b;
+	return c;
+}
+
+bool DecodePNG(const uint8_t* data, size_t size, PNGImage& image)
+{
+	static const uint8_t signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+	if (size < 8 || memcmp(data, signature, 8) != 0)
+		return false;
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t channels = 0;
+	std::vector<uint8_t> compressed;
+
+	size_t pos = 8;
+	while (pos + 12 <= size)
+	{
+		uint32_t length = ReadBigEndian(data + pos);
+		const uint8_t* type = data + pos + 4;
+		const uint8_t* chunk = data + pos + 8;
+		if (length > size - pos - 12)
+			return false;
+
+		if (memcmp(type, "IHDR", 4) == 0 && length >= 13)
+		{
+			width = ReadBigEndian(chunk);
+			height = ReadBigEndian(chunk + 4);
+			uint8_t bitDepth = chunk[8];
+			uint8_t colorType = chunk[9];
+			uint8_t interlace = chunk[12];
+			if (bitDepth != 8 || interlace != 0)
+				return false;
+
+			switch (colorType)
+			{
+			case 0: channels = 1; break;	// Gray
+			case 2: channels = 3; break;	// RGB
+			case 4: channels = 2; break;	// Gray + alpha
+			case 6: channels = 4; break;	// RGBA
+			default: return false;			// Palettes aren't supported
+			}
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		else if (memcmp(type, "IEND", 4) == 0)
+			break;
+
+		pos += 12 + (size_t)length;
+	}
+
+	if (width == 0 || height == 0 || channels == 0)
+		return false;
+
+	std::vector<uint8_t> filtered;
+	size_t stride = (size_t)width * channels;
+	filtered.reserve((stride + 1) * height);
+	if (!Inflate(compressed.data(), compressed.size(), filtered) || filtered.size() < (stride + 1) * height)
+		return false;
+
+	// Undo each row's filter, in place
+	for (uint32_t y = 0; y < height; y++)
+	{
+		uint8_t filter = filtered[y * (stride + 1)];
+		uint8_t* row = &filtered[y * (stride + 1) + 1];
+		const uint8_t* above = y > 0 ? row - (stride + 1) : 0;
+		for (size_t x = 0; x < stride; x++)
+		{
+			uint8_t left = x >= channels ? row[x - channels] : 0;
+			uint8_t up = above ? above[x] : 0;
+			uint8_t upLeft = above && x >= channels ? above[x - channels] : 0;
+			switch (filter)
+			{
+			case 0: break;
+			case 1: row[x] += left; break;
+			case 2: row[x] += up; break;
+			case 3: row[x] += (uint8_t)((left + up) / 2); break;
+			case 4: row[x] += Paeth(left, up, upLeft); break;
+			default: return false;
+			}
+		}
+	}
+
+	// Everything comes out as RGBA
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize((size_t)width * height * 4);
+	for (uint32_t y = 0; y < height; y++)
+	{
+		const uint8_t* row = &filtered[y * (stride + 1) + 1];
+		uint8_t* out = &image.Pixels[(size_t)y * width * 4];
+		for (uint32_t x = 0; x < width; x++, row += channels, out += 4)
+		{
+			switch (channels)
+			{
+			case 1: out[0] = out[1] = out[2] = row[0]; out[3] = 255; break;
+			case 2: out[0] = out[1] = out[2] = row[0]; out[3] = row[1]; break;
+			case 3: out[0] = row[0]; out[1] = row[1]; out[2] = row[2]; out[3] = 255; break;
+			case 4: memcpy(out, row, 4); break;
+			}
+		}
+	}
+	return true;
+}
+
+bool LoadPNG(const std::string& path, PNGImage& image)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return DecodePNG(data.data(), data.size(), image);
+}
+
+// --------------------------------------------------------
+// Saving
+// --------------------------------------------------------
+struct CRCTable
+{
+	uint32_t Entries[256];
+
+	CRCTable()
+	{
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			Entries[i] = c;
+		}
+	}
+};
+
+static uint32_t CRC32(const uint8_t* data, size_t size, uint32_t crc = 0)
+{
+	static const CRCTable table;
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+		crc = table.Entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+static void WriteBigEndian(std::vector<uint8_t>& data, uint32_t value)
+{
+	data.push_back((uint8_t)(value >> 24));
+	data.push_back((uint8_t)(value >> 16));
+	data.push_back((uint8_t)(value >> 8));
+	data.push_back((uint8_t)value);
+}
+
+static void WriteChunk(std::vector<uint8_t>& data, const char* type, const std::vector<uint8_t>& chunk)
+{
+	WriteBigEndian(data, (uint32_t)chunk.size());
+	size_t start = data.size();
+	data.insert(data.end(), type, type + 4);
+	data.insert(data.end(), chunk.begin(), chunk.end());
+	WriteBigEndian(data, CRC32(&data[start], data.size() - start));
+}
+
+void EncodePNG(const PNGImage& image, std::vector<uint8_t>& data)
+{
+	static const uint8_t signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+	data.assign(signature, signature + 8);
+
+	std::vector<uint8_t> header;
+	WriteBigEndian(header, image.Width);
+	WriteBigEndian(header, image.Height);
+	header.push_back(8);	// Bits per channel
+	header.push_back(6);	// RGBA
+	header.push_back(0);	// Deflate
+	header.push_back(0);	// Per-row filters
+	header.push_back(0);	// Not interlaced
+	WriteChunk(data, "IHDR", header);
+
+	// Rows with no filter, in stored (uncompressed) blocks
+	size_t stride = (size_t)image.Width * 4;
+	std::vector<uint8_t> raw;
+	raw.reserve((stride + 1) * image.Height);
+	for (uint32_t y = 0; y < image.Height; y++)
+	{
+		raw.push_back(0);
+		raw.insert(raw.end(), image.Pixels.begin() + y * stride, image.Pixels.begin() + (y + 1) * stride);
+	}
+
+	std::vector<uint8_t> compressed = { 0x78, 0x01 };
+	size_t pos = 0;
+	do
+	{
+		size_t block = raw.size() - pos < 65535 ? raw.size() - pos : 65535;
+		compressed.push_back(pos + block == raw.size() ? 1 : 0);
+		compressed.push_back((uint8_t)block);
+		compressed.push_back((uint8_t)(block >> 8));
+		compressed.push_back((uint8_t)~block);
+		compressed.push_back((uint8_t)(~block >> 8));
+		compressed.insert(compressed.end(), raw.begin() + pos, raw.begin() + pos + block);
+		pos += block;
+	} while (pos < raw.size());
+	WriteBigEndian(compressed, Adler32(raw.data(), raw.size()));
+	WriteChunk(data, "IDAT", compressed);
+
+	WriteChunk(data, "IEND", std::vector<uint8_t>());
+}
+
+bool SavePNG(const std::string& path, const PNGImage& image)
+{
+	if (image.Pixels.size() < (size_t)image.Width * image.Height * 4)
+		return false;
+
+	std::vector<uint8_t> data;
+	EncodePNG(image, data);
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+	file.write((const char*)data.data(), data.size());
+	return file.good();
+}
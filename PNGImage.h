@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Just enough PNG for the headless renderer: loads 8-bit,
+// non-interlaced gray, gray+alpha, RGB & RGBA images, and
+// saves RGBA ones.  Pixels are always RGBA8, rows top down.
+//
+// Saved files use uncompressed deflate blocks - bigger, but
+// byte-for-byte the same for the same pixels.
+// --------------------------------------------------------
+struct PNGImage
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<uint8_t> Pixels;
+};
+
+bool LoadPNG(const std::string& path, PNGImage& image);
+bool DecodePNG(const uint8_t* data, size_t size, PNGImage& image);
+
+bool SavePNG(const std::string& path, const PNGImage& image);
+void EncodePNG(const PNGImage& image, std::vector<uint8_t>& data);
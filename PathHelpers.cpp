@@ -1,4 +1,8 @@
 
+// The codecvt facets are deprecated as of C++17, but there's
+// no standard replacement for them yet
+#define _SILENCE_CXX17_CODECVT_HEADER_DEPRECATION_WARNING
+
 #include <Windows.h>
 #include <codecvt>
 #include <locale>
@@ -2,9 +2,8 @@
 
 cbuffer externalData : register(b0)
 {
-	int blurRadius;
-	float pixelWidth;
-	float pixelHeight;
+	float2 pixelStep;	// One texel along the blur direction
+	int tapCount;
 }
 
 struct VertexToPixel
@@ -14,27 +13,25 @@ struct VertexToPixel
 };
 
 Texture2D Pixels : register(t0);
+StructuredBuffer<float2> GaussianTaps : register(t1); // (offset, weight) - see GaussianKernel.h
 SamplerState ClampSampler : register(s0);
 
+// --------------------------------------------------------
+// One direction of a separable Gaussian blur.  Each tap
+// after the first sits between two texels, so bilinear
+// filtering reads both with a single sample.
+// --------------------------------------------------------
 float4 main(VertexToPixel input) : SV_TARGET
 {
-	// Track the total color and number of samples
-	float4 total = 0;
-	int sampleCount = 0;
+	float4 total = Pixels.Sample(ClampSampler, input.uv) * GaussianTaps[0].y;
 
-	// Loop through the "box"
-	for (int x = -blurRadius; x <= blurRadius; x++)
+	for (int i = 1; i < tapCount; i++)
 	{
-		for (int y = -blurRadius; y <= blurRadius; y++)
-		{
-			// Calculate the uv for this sample
-			float2 uv = input.uv;
-			uv += float2(x * pixelWidth, y * pixelHeight);
-			// Add this color to the running total
-			total += Pixels.Sample(ClampSampler, uv);
-			sampleCount++;
-		}
+		float2 tap = GaussianTaps[i];
+		float2 offset = pixelStep * tap.x;
+		total += Pixels.Sample(ClampSampler, input.uv + offset) * tap.y;
+		total += Pixels.Sample(ClampSampler, input.uv - offset) * tap.y;
 	}
-	// Return the average
-	return total / sampleCount;
-}
\ No newline at end of file
+
+	return total;
+}
@@ -0,0 +1,27 @@
+#include "PostFilters.hlsli"
+
+cbuffer externalData : register(b0)
+{
+	float2 bloomPixelSize;
+	float bloomIntensity;
+}
+
+struct VertexToPixel
+{
+	float4 position : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+
+Texture2D Pixels : register(t0);
+Texture2D Bloom : register(t1);
+SamplerState ClampSampler : register(s0);
+
+// --------------------------------------------------------
+// The scene with the top level of the bloom pyramid
+// upsampled and added on
+// --------------------------------------------------------
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	float4 scene = Pixels.Sample(ClampSampler, input.uv);
+	return scene + UpsampleTent(Bloom, ClampSampler, input.uv, bloomPixelSize) * bloomIntensity;
+}
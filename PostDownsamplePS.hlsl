@@ -0,0 +1,31 @@
+#include "PostFilters.hlsli"
+
+cbuffer externalData : register(b0)
+{
+	float2 sourcePixelSize;
+
+	// Bloom's bright pass, on the first level only
+	int applyThreshold;
+	float threshold;
+	float knee;
+}
+
+struct VertexToPixel
+{
+	float4 position : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+
+Texture2D Pixels : register(t0);
+SamplerState ClampSampler : register(s0);
+
+// --------------------------------------------------------
+// Renders the next (half resolution) level of the pyramid
+// --------------------------------------------------------
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	float4 color = Downsample13(Pixels, ClampSampler, input.uv, sourcePixelSize);
+	if (applyThreshold)
+		color = ApplyBloomThreshold(color, threshold, knee);
+	return color;
+}
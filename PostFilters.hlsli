@@ -0,0 +1,68 @@
+#ifndef __GGP__POST__FILTERS__
+#define __GGP__POST__FILTERS__
+
+// --------------------------------------------------------
+// Filters for the post process pyramid - matches
+// PostPyramid.h (which has a CPU reference of all this)
+// --------------------------------------------------------
+
+// --------------------------------------------------------
+// 13 bilinear taps, each reading a 2x2 box of the source.
+// The center box gets half the weight and the four corner
+// boxes an eighth each.  texel is one source texel in UV.
+// --------------------------------------------------------
+float4 Downsample13(Texture2D source, SamplerState clampSampler, float2 uv, float2 texel)
+{
+	float4 a = source.Sample(clampSampler, uv + texel * float2(-2, -2));
+	float4 b = source.Sample(clampSampler, uv + texel * float2( 0, -2));
+	float4 c = source.Sample(clampSampler, uv + texel * float2( 2, -2));
+	float4 d = source.Sample(clampSampler, uv + texel * float2(-1, -1));
+	float4 e = source.Sample(clampSampler, uv + texel * float2( 1, -1));
+	float4 f = source.Sample(clampSampler, uv + texel * float2(-2,  0));
+	float4 g = source.Sample(clampSampler, uv);
+	float4 h = source.Sample(clampSampler, uv + texel * float2( 2,  0));
+	float4 i = source.Sample(clampSampler, uv + texel * float2(-1,  1));
+	float4 j = source.Sample(clampSampler, uv + texel * float2( 1,  1));
+	float4 k = source.Sample(clampSampler, uv + texel * float2(-2,  2));
+	float4 l = source.Sample(clampSampler, uv + texel * float2( 0,  2));
+	float4 m = source.Sample(clampSampler, uv + texel * float2( 2,  2));
+
+	return
+		(a + c + k + m) * 0.03125f +
+		(b + f + h + l) * 0.0625f +
+		(d + e + i + j + g) * 0.125f;
+}
+
+// --------------------------------------------------------
+// 3x3 tent of bilinear taps, one source texel apart
+// --------------------------------------------------------
+float4 UpsampleTent(Texture2D source, SamplerState clampSampler, float2 uv, float2 texel)
+{
+	float4 total = 0;
+	for (int y = -1; y <= 1; y++)
+	{
+		for (int x = -1; x <= 1; x++)
+		{
+			float weight = (2 - abs(x)) * (2 - abs(y)) / 16.0f;
+			total += source.Sample(clampSampler, uv + texel * float2(x, y)) * weight;
+		}
+	}
+	return total;
+}
+
+// --------------------------------------------------------
+// Soft knee bright pass: the color fades in over
+// [threshold - knee, threshold + knee] of its brightest channel
+// --------------------------------------------------------
+float4 ApplyBloomThreshold(float4 color, float threshold, float knee)
+{
+	float brightness = max(color.r, max(color.g, color.b));
+
+	float soft = clamp(brightness - threshold + knee, 0, 2 * knee);
+	soft = soft * soft / (4 * knee + 0.00001f);
+
+	float contribution = max(soft, brightness - threshold) / max(brightness, 0.00001f);
+	return color * contribution;
+}
+
+#endif
@@ -0,0 +1,257 @@
+#include "PostPyramid.h"
+#include "GaussianKernel.h"
+
+#include <cmath>
+
+void PostPyramidImage::Resize(int width, int height, int channels)
+{
+	Width = width;
+	Height = height;
+	Channels = channels;
+	Pixels.assign((size_t)width * height * channels, 0.0f);
+}
+
+// --------------------------------------------------------
+// Halves the size per level, but never below one pixel
+// --------------------------------------------------------
+void PostPyramid::GetLevelSize(int width, int height, int level, int& levelWidth, int& levelHeight)
+{
+	levelWidth = width >> level;
+	levelHeight = height >> level;
+	if (levelWidth < 1) levelWidth = 1;
+	if (levelHeight < 1) levelHeight = 1;
+}
+
+int PostPyramid::GetLevelCount(int width, int height)
+{
+	int count = 0;
+	while (count < POST_PYRAMID_MAX_LEVELS &&
+		(width >> (count + 1)) >= POST_PYRAMID_MIN_SIZE &&
+		(height >> (count + 1)) >= POST_PYRAMID_MIN_SIZE)
+		count++;
+	return count;
+}
+
+// --------------------------------------------------------
+// Each level halves the radius needed for the same blur in
+// screen space.  Going down and back up L levels blurs by
+// itself, with a variance of 1.5 * (4^L - 1) full resolution
+// pixels, so the Gaussian only has to make up the rest.
+// --------------------------------------------------------
+int PostPyramid::GetBlurLevel(int radius, int levelCount, int& levelRadius, float& levelSigma)
+{
+	int level = 0;
+	levelRadius = radius < 0 ? 0 : radius;
+	while (levelRadius > POST_PYRAMID_LEVEL_RADIUS && level < levelCount)
+	{
+		level++;
+		levelRadius = (radius + (1 << level) / 2) >> level;
+	}
+
+	float sigma = GaussianKernel::GetDefaultSigma(radius);
+	float scale = (float)(1 << (2 * level));
+	float variance = (sigma * sigma - 1.5f * (scale - 1.0f)) / scale;
+	levelSigma = variance > 0.0625f ? sqrtf(variance) : 0.25f;
+	return level;
+}
+
+// --------------------------------------------------------
+// Bilinear sample at a UV, with clamp addressing
+// --------------------------------------------------------
+void PostPyramid::SampleBilinear(const PostPyramidImage& image, float u, float v, float* color)
+{
+	float x = u * image.Width - 0.5f;
+	float y = v * image.Height - 0.5f;
+	float baseX = floorf(x);
+	float baseY = floorf(y);
+	float tx = x - baseX;
+	float ty = y - baseY;
+
+	int x0 = (int)baseX;
+	int y0 = (int)baseY;
+	int x1 = x0 + 1;
+	int y1 = y0 + 1;
+	x0 = x0 < 0 ? 0 : (x0 > image.Width - 1 ? image.Width - 1 : x0);
+	x1 = x1 < 0 ? 0 : (x1 > image.Width - 1 ? image.Width - 1 : x1);
+	y0 = y0 < 0 ? 0 : (y0 > image.Height - 1 ? image.Height - 1 : y0);
+	y1 = y1 < 0 ? 0 : (y1 > image.Height - 1 ? image.Height - 1 : y1);
+
+	const float* p00 = &image.Pixels[((size_t)y0 * image.Width + x0) * image.Channels];
+	const float* p10 = &image.Pixels[((size_t)y0 * image.Width + x1) * image.Channels];
+	const float* p01 = &image.Pixels[((size_t)y1 * image.Width + x0) * image.Channels];
+	const float* p11 = &image.Pixels[((size_t)y1 * image.Width + x1) * image.Channels];
+	for (int c = 0; c < image.Channels; c++)
+	{
+		float top = p00[c] * (1.0f - tx) + p10[c] * tx;
+		float bottom = p01[c] * (1.0f - tx) + p11[c] * tx;
+		color[c] = top * (1.0f - ty) + bottom * ty;
+	}
+}
+
+// --------------------------------------------------------
+// Soft knee bright pass, scaling the whole color by how far
+// its brightest channel is past the threshold
+// --------------------------------------------------------
+void PostPyramid::ApplyThreshold(const PostPyramidThreshold& threshold, int channels, float* color)
+{
+	if (!threshold.Enabled)
+		return;
+
+	float brightness = 0.0f;
+	for (int c = 0; c < channels && c < 3; c++)
+		brightness = color[c] > brightness ? color[c] : brightness;
+
+	float soft = brightness - threshold.Threshold + threshold.Knee;
+	soft = soft < 0.0f ? 0.0f : (soft > 2.0f * threshold.Knee ? 2.0f * threshold.Knee : soft);
+	soft = soft * soft / (4.0f * threshold.Knee + 0.00001f);
+
+	float hard = brightness - threshold.Threshold;
+	float contribution = (soft > hard ? soft : hard) / (brightness > 0.00001f ? brightness : 0.00001f);
+	for (int c = 0; c < channels; c++)
+		color[c] *= contribution;
+}
+
+// --------------------------------------------------------
+// 13 bilinear taps, each reading a 2x2 box of the source:
+//
+//   a . b . c
+//   . d . e .
+//   f . g . h
+//   . i . j .
+//   k . l . m
+//
+// The center box (d e i j) gets half the weight and the four
+// corner boxes (a b f g, b c g h, ...) an eighth each
+// --------------------------------------------------------
+void PostPyramid::Downsample(const PostPyramidImage& source, const PostPyramidThreshold& threshold, PostPyramidImage& result)
+{
+	static const float taps[13][3] =
+	{
+		{ -2, -2, 0.03125f }, { 0, -2, 0.0625f }, { 2, -2, 0.03125f },
+		{ -1, -1, 0.125f }, { 1, -1, 0.125f },
+		{ -2,  0, 0.0625f }, { 0,  0, 0.125f }, { 2,  0, 0.0625f },
+		{ -1,  1, 0.125f }, { 1,  1, 0.125f },
+		{ -2,  2, 0.03125f }, { 0,  2, 0.0625f }, { 2,  2, 0.03125f },
+	};
+
+	int width, height;
+	GetLevelSize(source.Width, source.Height, 1, width, height);
+	result.Resize(width, height, source.Channels);
+
+	float texelU = 1.0f / source.Width;
+	float texelV = 1.0f / source.Height;
+	std::vector<float> sample(source.Channels);
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			float u = (x + 0.5f) / width;
+			float v = (y + 0.5f) / height;
+			float* out = &result.Pixels[((size_t)y * width + x) * source.Channels];
+
+			for (const float* tap : taps)
+			{
+				SampleBilinear(source, u + tap[0] * texelU, v + tap[1] * texelV, sample.data());
+				for (int c = 0; c < source.Channels; c++)
+					out[c] += sample[c] * tap[2];
+			}
+
+			ApplyThreshold(threshold, source.Channels, out);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// 3x3 tent (1 2 1 / 2 4 2 / 1 2 1) of bilinear taps, one
+// source texel apart
+// --------------------------------------------------------
+void PostPyramid::Upsample(const PostPyramidImage& source, float intensity, bool additive, PostPyramidImage& result)
+{
+	if (!additive)
+		result.Pixels.assign(result.Pixels.size(), 0.0f);
+
+	float texelU = 1.0f / source.Width;
+	float texelV = 1.0f / source.Height;
+	std::vector<float> sample(source.Channels);
+
+	for (int y = 0; y < result.Height; y++)
+	{
+		for (int x = 0; x < result.Width; x++)
+		{
+			float u = (x + 0.5f) / result.Width;
+			float v = (y + 0.5f) / result.Height;
+			float* out = &result.Pixels[((size_t)y * result.Width + x) * result.Channels];
+
+			for (int ty = -1; ty <= 1; ty++)
+			{
+				for (int tx = -1; tx <= 1; tx++)
+				{
+					float weight = (2 - abs(tx)) * (2 - abs(ty)) / 16.0f;
+					SampleBilinear(source, u + tx * texelU, v + ty * texelV, sample.data());
+					for (int c = 0; c < result.Channels; c++)
+						out[c] += sample[c] * weight * intensity;
+				}
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Down to the level the radius fits at, a Gaussian there,
+// then back up replacing each level on the way
+// --------------------------------------------------------
+void PostPyramid::Blur(const PostPyramidImage& source, int radius, PostPyramidImage& result)
+{
+	int levelRadius;
+	float levelSigma;
+	int level = GetBlurLevel(radius, GetLevelCount(source.Width, source.Height), levelRadius, levelSigma);
+
+	std::vector<float> weights;
+	std::vector<GaussianTap> taps;
+	GaussianKernel::ComputeWeights(levelRadius, levelSigma, weights);
+	GaussianKernel::ComputeLinearTaps(weights, taps);
+
+	result.Resize(source.Width, source.Height, source.Channels);
+	if (level == 0)
+	{
+		GaussianKernel::BlurSeparable(source.Pixels.data(), source.Width, source.Height, source.Channels, taps, result.Pixels.data());
+		return;
+	}
+
+	PostPyramidThreshold noThreshold;
+	std::vector<PostPyramidImage> levels(level + 1);
+	for (int i = 1; i <= level; i++)
+		Downsample(i == 1 ? source : levels[i - 1], noThreshold, levels[i]);
+
+	PostPyramidImage& bottom = levels[level];
+	std::vector<float> blurred(bottom.Pixels.size());
+	GaussianKernel::BlurSeparable(bottom.Pixels.data(), bottom.Width, bottom.Height, bottom.Channels, taps, blurred.data());
+	bottom.Pixels = blurred;
+
+	for (int i = level - 1; i >= 1; i--)
+		Upsample(levels[i + 1], 1.0f, false, levels[i]);
+	Upsample(levels[1], 1.0f, false, result);
+}
+
+// --------------------------------------------------------
+// The bright pass goes all the way down, then each level is
+// added into the one above it, and the top one onto the scene
+// --------------------------------------------------------
+void PostPyramid::Bloom(const PostPyramidImage& source, const PostPyramidThreshold& threshold, float intensity, PostPyramidImage& result)
+{
+	result = source;
+
+	int levelCount = GetLevelCount(source.Width, source.Height);
+	if (levelCount == 0)
+		return;
+
+	PostPyramidThreshold noThreshold;
+	std::vector<PostPyramidImage> levels(levelCount + 1);
+	for (int i = 1; i <= levelCount; i++)
+		Downsample(i == 1 ? source : levels[i - 1], i == 1 ? threshold : noThreshold, levels[i]);
+
+	for (int i = levelCount - 1; i >= 1; i--)
+		Upsample(levels[i + 1], 1.0f, true, levels[i]);
+	Upsample(levels[1], intensity, true, result);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+
+// Deepest level of the pyramid (level 1 is half resolution)
+#define POST_PYRAMID_MAX_LEVELS 6
+
+// Levels stop halving once they get this small
+#define POST_PYRAMID_MIN_SIZE 8
+
+// Blurs larger than this (in full resolution pixels) move down
+// the pyramid until the radius at that level fits under it
+#define POST_PYRAMID_LEVEL_RADIUS 8
+
+// --------------------------------------------------------
+// Bright pass for bloom: colors fade in over [threshold -
+// knee, threshold + knee] instead of cutting off hard
+// --------------------------------------------------------
+struct PostPyramidThreshold
+{
+	bool Enabled = false;
+	float Threshold = 0.8f;
+	float Knee = 0.2f;
+};
+
+// An interleaved float image (Channels values per pixel)
+struct PostPyramidImage
+{
+	int Width = 0;
+	int Height = 0;
+	int Channels = 0;
+	std::vector<float> Pixels;
+
+	void Resize(int width, int height, int channels);
+};
+
+// --------------------------------------------------------
+// A chain of half resolution images used for wide blurs and
+// for bloom:
+//
+//  - Each level is a 13-tap downsample of the one above it
+//    (four overlapping 2x2 boxes around a central one, which
+//    avoids the shimmering of a plain 2x2 box)
+//  - Going back up, each level is read with a 3x3 tent filter
+//    at twice its resolution, which smooths out the blockiness
+//    of the small levels
+//
+// A blur replaces each level with the upsampled one below it,
+// while bloom adds them, so every level's width of glow ends
+// up in the result.
+//
+// These are CPU versions of the shaders in PostFilters.hlsli,
+// written sample for sample the same, to diff GPU output
+// against.
+// --------------------------------------------------------
+class PostPyramid
+{
+public:
+	// Size of a level, matching the render targets Game creates
+	static void GetLevelSize(int width, int height, int level, int& levelWidth, int& levelHeight);
+
+	// How many levels below full resolution are worth making
+	static int GetLevelCount(int width, int height);
+
+	// The level a blur of this radius runs at (0 = full
+	// resolution), and the Gaussian to use there
+	static int GetBlurLevel(int radius, int levelCount, int& levelRadius, float& levelSigma);
+
+	// Single steps.  Downsample writes a result half the size of
+	// the source; Upsample writes (or adds, scaled by intensity)
+	// into a result of whatever size it's given.
+	static void Downsample(const PostPyramidImage& source, const PostPyramidThreshold& threshold, PostPyramidImage& result);
+	static void Upsample(const PostPyramidImage& source, float intensity, bool additive, PostPyramidImage& result);
+
+	// Whole chains, in the same order as Game::Draw
+	static void Blur(const PostPyramidImage& source, int radius, PostPyramidImage& result);
+	static void Bloom(const PostPyramidImage& source, const PostPyramidThreshold& threshold, float intensity, PostPyramidImage& result);
+
+private:
+	static void SampleBilinear(const PostPyramidImage& image, float u, float v, float* color);
+	static void ApplyThreshold(const PostPyramidThreshold& threshold, int channels, float* color);
+};
@@ -0,0 +1,253 @@
+// --------------------------------------------------------
+// Tests PostPyramid's CPU chain, which the post shaders are
+// diffed against:
+//
+//  - a constant image stays that constant through every
+//    step, every blur radius and (scaled by the number of
+//    levels added up) bloom
+//  - light is neither made nor lost: with everything away
+//    from the clamped edges, each step and whole chain
+//    keeps the image's total (bloom adding one copy per
+//    level), and a blur spreads a dot out rather than
+//    moving it
+//  - the bright pass only lets through what's over the
+//    threshold, fading in over the knee
+// --------------------------------------------------------
+#include <cmath>
+#include <stdint.h>
+
+#include "PostPyramid.h"
+#include "TestCheck.h"
+
+static bool Near(double a, double b, double tolerance = 1e-4)
+{
+	return fabs(a - b) <= tolerance * (fabs(b) > 1.0 ? fabs(b) : 1.0);
+}
+
+static void Fill(PostPyramidImage& image, int width, int height, const float* color)
+{
+	image.Resize(width, height, 3);
+	for (size_t i = 0; i < image.Pixels.size(); i++)
+		image.Pixels[i] = color[i % 3];
+}
+
+// Is every pixel this color?
+static bool IsConstant(const PostPyramidImage& image, const float* color, float tolerance = 1e-5f)
+{
+	for (size_t i = 0; i < image.Pixels.size(); i++)
+	{
+		if (fabsf(image.Pixels[i] - color[i % 3]) > tolerance)
+			return false;
+	}
+	return !image.Pixels.empty();
+}
+
+// Sum of a channel, scaled to full resolution pixels
+static double Energy(const PostPyramidImage& image, int channel, int fullWidth)
+{
+	double sum = 0;
+	for (size_t i = channel; i < image.Pixels.size(); i += image.Channels)
+		sum += image.Pixels[i];
+	double scale = (double)fullWidth / image.Width;
+	return sum * scale * scale;
+}
+
+// Repeatable noise, kept clear of the edges where clamping
+// would read pixels twice
+static void FillNoise(PostPyramidImage& image, int width, int height, int border)
+{
+	image.Resize(width, height, 3);
+	uint32_t seed = 4242;
+	for (int y = border; y < height - border; y++)
+	{
+		for (int x = border; x < width - border; x++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				image.Pixels[((size_t)y * width + x) * 3 + c] = (seed >> 8) / 16777216.0f * (c + 1);
+			}
+		}
+	}
+}
+
+static void TestLevels()
+{
+	int width, height;
+	PostPyramid::GetLevelSize(1280, 720, 1, width, height);
+	CHECK(width == 640 && height == 360);
+	PostPyramid::GetLevelSize(5, 3, 3, width, height);
+	CHECK(width == 1 && height == 1);
+
+	CHECK(PostPyramid::GetLevelCount(1920, 1080) == POST_PYRAMID_MAX_LEVELS);
+	CHECK(PostPyramid::GetLevelCount(64, 64) == 3);
+	CHECK(PostPyramid::GetLevelCount(15, 200) == 0);
+
+	// Small radii blur at full resolution, big ones further down
+	int levelRadius;
+	float levelSigma;
+	CHECK(PostPyramid::GetBlurLevel(POST_PYRAMID_LEVEL_RADIUS, 6, levelRadius, levelSigma) == 0);
+	CHECK(levelRadius == POST_PYRAMID_LEVEL_RADIUS);
+	int level = PostPyramid::GetBlurLevel(40, 6, levelRadius, levelSigma);
+	CHECK(level == 3 && levelRadius <= POST_PYRAMID_LEVEL_RADIUS && levelSigma > 0.0f);
+	CHECK(PostPyramid::GetBlurLevel(1000, 2, levelRadius, levelSigma) == 2);
+}
+
+static void TestConstantImage()
+{
+	const float color[3] = { 0.25f, 1.5f, 3.0f };
+	PostPyramidImage source;
+	Fill(source, 96, 64, color);
+	PostPyramidThreshold noThreshold;
+
+	PostPyramidImage down;
+	PostPyramid::Downsample(source, noThreshold, down);
+	CHECK(down.Width == 48 && down.Height == 32);
+	CHECK(IsConstant(down, color));
+
+	PostPyramidImage up;
+	up.Resize(96, 64, 3);
+	PostPyramid::Upsample(down, 1.0f, false, up);
+	CHECK(IsConstant(up, color));
+
+	// Adding scales it
+	PostPyramid::Upsample(down, 0.5f, true, up);
+	const float added[3] = { color[0] * 1.5f, color[1] * 1.5f, color[2] * 1.5f };
+	CHECK(IsConstant(up, added));
+
+	const int radii[] = { 0, 3, 8, 12, 30, 100 };
+	for (int radius : radii)
+	{
+		PostPyramidImage blurred;
+		PostPyramid::Blur(source, radius, blurred);
+		CHECK(IsConstant(blurred, color, 1e-4f));
+	}
+
+	// Every level is the same color, and each adds onto the
+	// one above it on the way up
+	int levels = PostPyramid::GetLevelCount(96, 64);
+	CHECK(levels == 3);
+	PostPyramidImage bloomed;
+	PostPyramid::Bloom(source, noThreshold, 0.1f, bloomed);
+	float scale = 1.0f + 0.1f * levels;
+	const float glowing[3] = { color[0] * scale, color[1] * scale, color[2] * scale };
+	CHECK(IsConstant(bloomed, glowing, 1e-4f));
+}
+
+static void TestEnergy()
+{
+	// Wide enough a border that nothing reaches the edges,
+	// even at the bottom of the chain
+	PostPyramidImage source;
+	FillNoise(source, 256, 192, 80);
+	PostPyramidThreshold noThreshold;
+
+	double total[3];
+	for (int c = 0; c < 3; c++)
+		total[c] = Energy(source, c, 256);
+
+	PostPyramidImage down;
+	PostPyramid::Downsample(source, noThreshold, down);
+	PostPyramidImage up;
+	up.Resize(256, 192, 3);
+	PostPyramid::Upsample(down, 1.0f, false, up);
+	for (int c = 0; c < 3; c++)
+	{
+		CHECK(Near(Energy(down, c, 256), total[c]));
+		CHECK(Near(Energy(up, c, 256), total[c]));
+	}
+
+	const int radii[] = { 4, 20, 60 };
+	for (int radius : radii)
+	{
+		PostPyramidImage blurred;
+		PostPyramid::Blur(source, radius, blurred);
+		for (int c = 0; c < 3; c++)
+			CHECK(Near(Energy(blurred, c, 256), total[c], 1e-3));
+	}
+
+	int levels = PostPyramid::GetLevelCount(256, 192);
+	PostPyramidImage bloomed;
+	PostPyramid::Bloom(source, noThreshold, 0.2f, bloomed);
+	for (int c = 0; c < 3; c++)
+		CHECK(Near(Energy(bloomed, c, 256), total[c] * (1.0 + 0.2 * levels), 1e-3));
+}
+
+static void TestBlurSpreads()
+{
+	// One bright pixel in the middle
+	PostPyramidImage dot;
+	dot.Resize(128, 128, 1);
+	dot.Pixels[64 * 128 + 64] = 1.0f;
+
+	PostPyramidImage narrow, wide;
+	PostPyramid::Blur(dot, 4, narrow);
+	PostPyramid::Blur(dot, 24, wide);
+
+	// Still all there, still centered on the dot, and spread
+	// further the bigger the radius
+	double spread[2] = {};
+	const PostPyramidImage* blurs[2] = { &narrow, &wide };
+	for (int b = 0; b < 2; b++)
+	{
+		double sum = 0, x = 0, y = 0, xx = 0;
+		for (int py = 0; py < 128; py++)
+		{
+			for (int px = 0; px < 128; px++)
+			{
+				double value = blurs[b]->Pixels[py * 128 + px];
+				double cx = px + 0.5, cy = py + 0.5;
+				sum += value;
+				x += value * cx;
+				y += value * cy;
+				xx += value * (cx - 64.5) * (cx - 64.5);
+			}
+		}
+		CHECK(Near(sum, 1.0, 1e-3));
+		CHECK(fabs(x / sum - 64.5) < 0.6 && fabs(y / sum - 64.5) < 0.6);
+		spread[b] = sqrt(xx / sum);
+	}
+	CHECK(spread[0] > 1.0 && spread[1] > spread[0] * 3.0);
+}
+
+static void TestThreshold()
+{
+	PostPyramidThreshold threshold;
+	threshold.Enabled = true;
+	threshold.Threshold = 1.0f;
+	threshold.Knee = 0.25f;
+
+	// Flat images, below, inside and above the knee
+	const float dark[3] = { 0.5f, 0.7f, 0.2f };
+	const float knee[3] = { 1.0f, 0.5f, 0.0f };
+	const float bright[3] = { 3.0f, 1.5f, 0.0f };
+	PostPyramidImage source, down;
+
+	Fill(source, 32, 32, dark);
+	PostPyramid::Downsample(source, threshold, down);
+	const float black[3] = {};
+	CHECK(IsConstant(down, black));
+
+	// At the threshold, (0.25^2 / (4 * 0.25)) of the brightest channel
+	Fill(source, 32, 32, knee);
+	PostPyramid::Downsample(source, threshold, down);
+	const float faded[3] = { 0.0625f, 0.03125f, 0.0f };
+	CHECK(IsConstant(down, faded, 1e-4f));
+
+	// Well past it, only the part over the threshold - in the
+	// same hue
+	Fill(source, 32, 32, bright);
+	PostPyramid::Downsample(source, threshold, down);
+	const float over[3] = { 2.0f, 1.0f, 0.0f };
+	CHECK(IsConstant(down, over, 1e-4f));
+}
+
+int main()
+{
+	TestLevels();
+	TestConstantImage();
+	TestEnergy();
+	TestBlurSpreads();
+	TestThreshold();
+	return TestResult();
+}
@@ -0,0 +1,25 @@
+#include "PostFilters.hlsli"
+
+cbuffer externalData : register(b0)
+{
+	float2 sourcePixelSize;
+	float intensity;
+}
+
+struct VertexToPixel
+{
+	float4 position : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+
+Texture2D Pixels : register(t0);
+SamplerState ClampSampler : register(s0);
+
+// --------------------------------------------------------
+// Reads a pyramid level into the one above it - replacing
+// it for a blur, or added on with blending for bloom
+// --------------------------------------------------------
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	return UpsampleTent(Pixels, ClampSampler, input.uv, sourcePixelSize) * intensity;
+}
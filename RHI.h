@@ -0,0 +1,186 @@
+#pragma once
+
+#include <stdint.h>
+
+// --------------------------------------------------------
+// A thin layer over the graphics API, so code that only
+// needs to make buffers & textures and issue draws doesn't
+// have to include Direct3D (and can run on the null device).
+// Formats are raw DXGI_FORMAT values.
+//
+// Layered on top: RHIRenderGraphDevice runs render graphs
+// on any device.  Not (yet) covered: shaders and their
+// inputs (SimpleShader and Material work on D3D11 objects,
+// and SimpleShader's reflection is D3D's), and the window,
+// swap chain & samplers Game sets up.
+// --------------------------------------------------------
+
+// How a resource can be used (combine with |)
+#define RHI_BIND_VERTEX_BUFFER		0x01
+#define RHI_BIND_INDEX_BUFFER		0x02
+#define RHI_BIND_CONSTANT_BUFFER	0x04
+#define RHI_BIND_SHADER_RESOURCE	0x08
+#define RHI_BIND_RENDER_TARGET		0x10
+#define RHI_BIND_DEPTH_STENCIL		0x20
+#define RHI_BIND_UNORDERED_ACCESS	0x40
+
+// Who writes a resource's contents
+#define RHI_USAGE_DEFAULT	0	// The GPU, or UpdateBuffer()
+#define RHI_USAGE_IMMUTABLE	1	// Nobody - initial data only
+#define RHI_USAGE_DYNAMIC	2	// The CPU, every frame
+
+// Kinds of texture views
+#define RHI_VIEW_SHADER_RESOURCE	0
+#define RHI_VIEW_RENDER_TARGET		1
+#define RHI_VIEW_DEPTH_STENCIL		2
+#define RHI_VIEW_UNORDERED_ACCESS	3
+
+// Index sizes
+#define RHI_INDEX_UINT16	0
+#define RHI_INDEX_UINT32	1
+
+// Pipeline state options
+#define RHI_CULL_NONE	0
+#define RHI_CULL_FRONT	1
+#define RHI_CULL_BACK	2
+
+#define RHI_COMPARISON_NEVER			0
+#define RHI_COMPARISON_LESS				1
+#define RHI_COMPARISON_EQUAL			2
+#define RHI_COMPARISON_LESS_EQUAL		3
+#define RHI_COMPARISON_GREATER			4
+#define RHI_COMPARISON_GREATER_EQUAL	5
+#define RHI_COMPARISON_ALWAYS			6
+
+#define RHI_BLEND_OPAQUE	0
+#define RHI_BLEND_ALPHA		1
+#define RHI_BLEND_ADDITIVE	2
+
+struct RHIBufferDesc
+{
+	uint32_t Size = 0;
+	uint32_t Stride = 0;		// For structured buffers
+	uint32_t BindFlags = 0;
+	uint32_t Usage = RHI_USAGE_DEFAULT;
+};
+
+struct RHITextureDesc
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t ArraySize = 1;
+	uint32_t MipLevels = 1;
+	uint32_t Format = 0;
+	uint32_t BindFlags = 0;
+	uint32_t Usage = RHI_USAGE_DEFAULT;
+};
+
+// --------------------------------------------------------
+// The fixed function state for draws (shaders are still
+// set through SimpleShader).  The defaults match Direct3D's.
+// --------------------------------------------------------
+struct RHIPipelineStateDesc
+{
+	// Rasterizer
+	uint32_t CullMode = RHI_CULL_BACK;
+	bool Wireframe = false;
+	bool ScissorEnable = false;
+	int DepthBias = 0;
+	float SlopeScaledDepthBias = 0.0f;
+
+	// Depth
+	bool DepthEnable = true;
+	bool DepthWrite = true;
+	uint32_t DepthFunc = RHI_COMPARISON_LESS;
+
+	// Blending
+	uint32_t BlendMode = RHI_BLEND_OPAQUE;
+};
+
+struct RHIViewport
+{
+	float X = 0.0f;
+	float Y = 0.0f;
+	float Width = 0.0f;
+	float Height = 0.0f;
+	float MinDepth = 0.0f;
+	float MaxDepth = 1.0f;
+};
+
+// --------------------------------------------------------
+// Handles are only meaningful to the device that made them.
+// An empty handle (Id 0) means "none", or the default state
+// for pipeline states.
+// --------------------------------------------------------
+struct RHIBuffer
+{
+	uint64_t Id = 0;
+	bool IsValid() const { return Id != 0; }
+};
+
+struct RHITexture
+{
+	uint64_t Id = 0;
+	bool IsValid() const { return Id != 0; }
+};
+
+struct RHIView
+{
+	uint64_t Id = 0;
+	bool IsValid() const { return Id != 0; }
+};
+
+struct RHIPipelineState
+{
+	uint64_t Id = 0;
+	bool IsValid() const { return Id != 0; }
+};
+
+// --------------------------------------------------------
+// Where draws are recorded - the device's immediate context,
+// or a backend's wrapper around another (like a deferred
+// context on a worker thread)
+// --------------------------------------------------------
+class RHIContext
+{
+public:
+	virtual ~RHIContext() {}
+
+	// State
+	virtual void SetPipelineState(RHIPipelineState state) = 0;
+	virtual void SetViewport(const RHIViewport& viewport) = 0;
+	virtual void SetRenderTargets(const RHIView* colors, uint32_t colorCount, RHIView depth) = 0;
+	virtual void SetVertexBuffer(RHIBuffer buffer, uint32_t stride, uint32_t offset = 0) = 0;
+	virtual void SetIndexBuffer(RHIBuffer buffer, uint32_t format) = 0;
+
+	// Data
+	virtual void ClearRenderTarget(RHIView view, const float color[4]) = 0;
+	virtual void ClearDepthStencil(RHIView view, float depth) = 0;
+	virtual void UpdateBuffer(RHIBuffer buffer, const void* data, uint32_t size) = 0;
+
+	// Drawing (triangle lists)
+	virtual void Draw(uint32_t vertexCount, uint32_t firstVertex = 0) = 0;
+	virtual void DrawIndexed(uint32_t indexCount, uint32_t firstIndex = 0, int32_t baseVertex = 0) = 0;
+};
+
+// --------------------------------------------------------
+// Makes & destroys resources.  Creation isn't thread safe,
+// so do it on the main thread, outside of recording.
+// --------------------------------------------------------
+class RHIDevice
+{
+public:
+	virtual ~RHIDevice() {}
+
+	virtual bool CreateBuffer(const RHIBufferDesc& desc, const void* initialData, RHIBuffer& buffer) = 0;
+	virtual bool CreateTexture(const RHITextureDesc& desc, const void* initialData, uint32_t rowPitch, RHITexture& texture) = 0;
+	virtual bool CreateView(RHITexture texture, uint32_t type, RHIView& view) = 0;
+	virtual bool CreatePipelineState(const RHIPipelineStateDesc& desc, RHIPipelineState& state) = 0;
+
+	virtual void Destroy(RHIBuffer buffer) = 0;
+	virtual void Destroy(RHITexture texture) = 0;
+	virtual void Destroy(RHIView view) = 0;
+	virtual void Destroy(RHIPipelineState state) = 0;
+
+	virtual RHIContext* GetImmediateContext() = 0;
+};
@@ -0,0 +1,191 @@
+#include "RHIRenderGraphDevice.h"
+
+RHIRenderGraphDevice::RHIRenderGraphDevice(std::shared_ptr<RHIDevice> device) :
+	device(device)
+{
+}
+
+RHIRenderGraphDevice::~RHIRenderGraphDevice()
+{
+	// The pool should have released everything, but just in case
+	for (Entry& entry : textures)
+		Destroy(entry);
+}
+
+// --------------------------------------------------------
+// Imports
+// --------------------------------------------------------
+void RHIRenderGraphDevice::ClearImports()
+{
+	imports.clear();
+}
+
+uint32_t RHIRenderGraphDevice::Import(RHIView rtv, RHIView srv, RHIView dsv, uint32_t width, uint32_t height)
+{
+	Entry entry;
+	entry.RTV = rtv;
+	entry.SRV = srv;
+	entry.DSV = dsv;
+	entry.Width = width;
+	entry.Height = height;
+
+	imports.push_back(entry);
+	return RHI_RENDER_GRAPH_IMPORTED | (uint32_t)(imports.size() - 1);
+}
+
+// --------------------------------------------------------
+// Makes a texture and whichever views its bind flags need
+// (the device picks view formats for depth buffers that
+// shaders also read)
+// --------------------------------------------------------
+bool RHIRenderGraphDevice::CreateTexture(const RenderGraphTextureDesc& desc, uint32_t& texture)
+{
+	RHITextureDesc textureDesc;
+	textureDesc.Width = desc.Width;
+	textureDesc.Height = desc.Height;
+	textureDesc.Format = desc.Format;
+	if (desc.BindFlags & RENDER_GRAPH_BIND_RENDER_TARGET) textureDesc.BindFlags |= RHI_BIND_RENDER_TARGET;
+	if (desc.BindFlags & RENDER_GRAPH_BIND_SHADER_RESOURCE) textureDesc.BindFlags |= RHI_BIND_SHADER_RESOURCE;
+	if (desc.BindFlags & RENDER_GRAPH_BIND_DEPTH_STENCIL) textureDesc.BindFlags |= RHI_BIND_DEPTH_STENCIL;
+
+	Entry entry;
+	entry.Width = desc.Width;
+	entry.Height = desc.Height;
+	if (!device->CreateTexture(textureDesc, 0, 0, entry.Texture))
+		return false;
+
+	bool viewsMade = true;
+	if (desc.BindFlags & RENDER_GRAPH_BIND_RENDER_TARGET)
+		viewsMade &= device->CreateView(entry.Texture, RHI_VIEW_RENDER_TARGET, entry.RTV);
+	if (desc.BindFlags & RENDER_GRAPH_BIND_DEPTH_STENCIL)
+		viewsMade &= device->CreateView(entry.Texture, RHI_VIEW_DEPTH_STENCIL, entry.DSV);
+	if (desc.BindFlags & RENDER_GRAPH_BIND_SHADER_RESOURCE)
+		viewsMade &= device->CreateView(entry.Texture, RHI_VIEW_SHADER_RESOURCE, entry.SRV);
+
+	if (!viewsMade)
+	{
+		Destroy(entry);
+		return false;
+	}
+
+	// Reuse a released slot if there is one
+	if (!freeTextures.empty())
+	{
+		texture = freeTextures.back();
+		freeTextures.pop_back();
+		textures[texture] = entry;
+	}
+	else
+	{
+		texture = (uint32_t)textures.size();
+		textures.push_back(entry);
+	}
+	return true;
+}
+
+void RHIRenderGraphDevice::ReleaseTexture(uint32_t texture)
+{
+	if ((texture & RHI_RENDER_GRAPH_IMPORTED) || texture >= textures.size() || !textures[texture].Texture.IsValid())
+		return;
+
+	Destroy(textures[texture]);
+	freeTextures.push_back(texture);
+}
+
+void RHIRenderGraphDevice::Transition(uint32_t texture, uint32_t before, uint32_t after)
+{
+}
+
+// --------------------------------------------------------
+// Binds & clears the targets, with a viewport covering
+// the first one.  Passes with no targets bind their own.
+// --------------------------------------------------------
+void RHIRenderGraphDevice::BeginPass(const RenderGraphPassTargets& targets)
+{
+	if (targets.ColorCount == 0 && !targets.HasDepth)
+		return;
+
+	RHIContext* context = device->GetImmediateContext();
+	RHIView colors[RENDER_GRAPH_MAX_COLOR_TARGETS];
+	Entry* first = 0;
+	for (uint32_t i = 0; i < targets.ColorCount; i++)
+	{
+		Entry* entry = Find(targets.Colors[i]);
+		if (!entry)
+			continue;
+
+		colors[i] = entry->RTV;
+		if (!first) first = entry;
+		if (targets.ColorLoad[i] == RENDER_GRAPH_LOAD_CLEAR)
+			context->ClearRenderTarget(colors[i], targets.ClearColors[i]);
+	}
+
+	RHIView depth;
+	if (targets.HasDepth)
+	{
+		Entry* entry = Find(targets.Depth);
+		if (entry)
+		{
+			depth = entry->DSV;
+			if (!first) first = entry;
+			if (targets.DepthLoad == RENDER_GRAPH_LOAD_CLEAR)
+				context->ClearDepthStencil(depth, targets.ClearDepth);
+		}
+	}
+
+	context->SetRenderTargets(colors, targets.ColorCount, depth);
+
+	if (first)
+	{
+		RHIViewport viewport;
+		viewport.Width = (float)first->Width;
+		viewport.Height = (float)first->Height;
+		context->SetViewport(viewport);
+	}
+}
+
+void RHIRenderGraphDevice::EndPass()
+{
+}
+
+// --------------------------------------------------------
+// Getters
+// --------------------------------------------------------
+RHIRenderGraphDevice::Entry* RHIRenderGraphDevice::Find(uint32_t texture)
+{
+	if (texture & RHI_RENDER_GRAPH_IMPORTED)
+	{
+		uint32_t index = texture & ~RHI_RENDER_GRAPH_IMPORTED;
+		return index < imports.size() ? &imports[index] : 0;
+	}
+	return texture < textures.size() ? &textures[texture] : 0;
+}
+
+void RHIRenderGraphDevice::Destroy(Entry& entry)
+{
+	device->Destroy(entry.RTV);
+	device->Destroy(entry.SRV);
+	device->Destroy(entry.DSV);
+	device->Destroy(entry.Texture);
+	entry = Entry();
+}
+
+RHIView RHIRenderGraphDevice::GetView(uint32_t texture, uint32_t type)
+{
+	Entry* entry = Find(texture);
+	if (!entry)
+		return RHIView();
+
+	switch (type)
+	{
+	case RHI_VIEW_RENDER_TARGET: return entry->RTV;
+	case RHI_VIEW_SHADER_RESOURCE: return entry->SRV;
+	case RHI_VIEW_DEPTH_STENCIL: return entry->DSV;
+	}
+	return RHIView();
+}
+
+unsigned int RHIRenderGraphDevice::GetTextureCount()
+{
+	return (unsigned int)(textures.size() - freeTextures.size());
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "RenderGraph.h"
+#include "RHI.h"
+
+// Handles for imported textures have this bit set
+#define RHI_RENDER_GRAPH_IMPORTED 0x80000000
+
+// --------------------------------------------------------
+// Runs a RenderGraph on any RHIDevice: transients are RHI
+// textures with a view for each of their bind flags, and
+// passes bind & clear their targets on the device's
+// immediate context.
+//
+// RHI contexts don't bind shader inputs (shaders still do
+// that themselves), so there's nothing for transitions to
+// unbind here.  Backends whose shaders can leave a texture
+// bound as an input override Transition().
+// --------------------------------------------------------
+class RHIRenderGraphDevice : public RenderGraphDevice
+{
+public:
+	RHIRenderGraphDevice(std::shared_ptr<RHIDevice> device);
+	virtual ~RHIRenderGraphDevice();
+
+	// Textures owned elsewhere (like the back buffer), which
+	// are registered again every frame - any view can be empty
+	void ClearImports();
+	uint32_t Import(RHIView rtv, RHIView srv, RHIView dsv, uint32_t width, uint32_t height);
+
+	// RenderGraphDevice
+	bool CreateTexture(const RenderGraphTextureDesc& desc, uint32_t& texture);
+	void ReleaseTexture(uint32_t texture);
+	void Transition(uint32_t texture, uint32_t before, uint32_t after);
+	void BeginPass(const RenderGraphPassTargets& targets);
+	void EndPass();
+
+	// A view of a texture (RHI_VIEW_*), for use inside passes
+	RHIView GetView(uint32_t texture, uint32_t type);
+
+	unsigned int GetTextureCount();
+
+protected:
+	struct Entry
+	{
+		RHITexture Texture;
+		RHIView RTV;
+		RHIView SRV;
+		RHIView DSV;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+	};
+
+	Entry* Find(uint32_t texture);
+	void Destroy(Entry& entry);
+
+	std::shared_ptr<RHIDevice> device;
+
+private:
+	std::vector<Entry> textures;
+	std::vector<uint32_t> freeTextures;
+	std::vector<Entry> imports;
+};
@@ -0,0 +1,547 @@
+#include "RenderGraph.h"
+#include "RenderTargetPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+
+uint32_t RenderGraphPassResources::GetTexture(RenderGraphResource resource) const
+{
+	return graph.GetDeviceTexture(resource);
+}
+
+RenderGraph::RenderGraph() :
+	transientCount(0),
+	compiled(false),
+	pool(0),
+	borrowed(false)
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+	ReturnTextures();
+}
+
+// --------------------------------------------------------
+// Starts a new frame's declarations
+// --------------------------------------------------------
+void RenderGraph::Reset()
+{
+	ReturnTextures();
+	textures.clear();
+	versions.clear();
+	passes.clear();
+	passOrder.clear();
+	transitions.clear();
+	transientCount = 0;
+	compiled = false;
+	error.clear();
+
+	// Nothing's using last frame's arena memory now
+	arena.Reset();
+}
+
+// --------------------------------------------------------
+// Textures start at version 0, which only imported ones
+// have contents for
+// --------------------------------------------------------
+RenderGraphResource RenderGraph::CreateTexture(const char* name, const RenderGraphTextureDesc& desc)
+{
+	Texture texture;
+	texture.Name = arena.CopyString(name);
+	texture.Desc = desc;
+	texture.LatestVersion = (uint32_t)versions.size();
+	textures.push_back(texture);
+
+	Version version(&arena);
+	version.Texture = (uint32_t)textures.size() - 1;
+	versions.push_back(version);
+
+	RenderGraphResource resource;
+	resource.Version = texture.LatestVersion;
+	return resource;
+}
+
+RenderGraphResource RenderGraph::ImportTexture(const char* name, const RenderGraphTextureDesc& desc, uint32_t deviceTexture, uint32_t state)
+{
+	RenderGraphResource resource = CreateTexture(name, desc);
+	Texture& texture = textures.back();
+	texture.Imported = true;
+	texture.ImportedTexture = deviceTexture;
+	texture.ImportedState = state;
+	return resource;
+}
+
+// --------------------------------------------------------
+// Passes
+// --------------------------------------------------------
+uint32_t RenderGraph::AddPass(const char* name, RenderGraphExecute execute)
+{
+	passes.emplace_back(&arena);
+	Pass& pass = passes.back();
+	pass.Name = arena.CopyString(name);
+	pass.Execute = std::move(execute);
+	return (uint32_t)passes.size() - 1;
+}
+
+void RenderGraph::SetSideEffects(uint32_t pass)
+{
+	passes[pass].SideEffects = true;
+}
+
+void RenderGraph::Read(uint32_t pass, RenderGraphResource resource)
+{
+	if (!resource.IsValid())
+	{
+		Fail(std::string("'") + passes[pass].Name + "' reads an invalid resource");
+		return;
+	}
+
+	Access access = {};
+	access.Version = resource.Version;
+	access.Previous = UINT32_MAX;
+	access.State = RENDER_GRAPH_STATE_SHADER_RESOURCE;
+	passes[pass].Accesses.push_back(access);
+	versions[resource.Version].Readers.push_back(pass);
+}
+
+RenderGraphResource RenderGraph::WriteRenderTarget(uint32_t pass, RenderGraphResource resource, uint32_t load, const float clearColor[4])
+{
+	return AddWrite(pass, resource, RENDER_GRAPH_STATE_RENDER_TARGET, true, load, clearColor);
+}
+
+RenderGraphResource RenderGraph::WriteDepthStencil(uint32_t pass, RenderGraphResource resource, uint32_t load, float clearDepth)
+{
+	float clear[4] = { clearDepth, 0, 0, 0 };
+	return AddWrite(pass, resource, RENDER_GRAPH_STATE_DEPTH_WRITE, true, load, clear);
+}
+
+RenderGraphResource RenderGraph::Write(uint32_t pass, RenderGraphResource resource, uint32_t state)
+{
+	return AddWrite(pass, resource, state, false, RENDER_GRAPH_LOAD_KEEP, 0);
+}
+
+// --------------------------------------------------------
+// Every write makes the next version of the texture.  Only
+// the latest version can be written - the graph would have
+// to copy the texture otherwise.
+// --------------------------------------------------------
+RenderGraphResource RenderGraph::AddWrite(uint32_t pass, RenderGraphResource resource, uint32_t state, bool bound, uint32_t load, const float* clear)
+{
+	if (!resource.IsValid())
+	{
+		Fail(std::string("'") + passes[pass].Name + "' writes an invalid resource");
+		return RenderGraphResource();
+	}
+
+	uint32_t textureIndex = versions[resource.Version].Texture;
+	if (textures[textureIndex].LatestVersion != resource.Version)
+	{
+		Fail(std::string("'") + passes[pass].Name + "' writes an old version of '" + textures[textureIndex].Name + "'");
+		return RenderGraphResource();
+	}
+
+	Version version(&arena);
+	version.Texture = textureIndex;
+	version.Producer = pass;
+	version.Previous = resource.Version;
+	versions.push_back(version);
+	textures[textureIndex].LatestVersion = (uint32_t)versions.size() - 1;
+
+	Access access = {};
+	access.Version = (uint32_t)versions.size() - 1;
+	access.Previous = resource.Version;
+	access.State = state;
+	access.Write = true;
+	access.Bound = bound;
+	access.Load = load;
+	if (clear)
+		memcpy(access.Clear, clear, sizeof(float) * 4);
+	passes[pass].Accesses.push_back(access);
+
+	RenderGraphResource result;
+	result.Version = access.Version;
+	return result;
+}
+
+bool RenderGraph::Fail(const std::string& message)
+{
+	// Keep the first error, as later ones tend to follow from it
+	if (error.empty())
+		error = message;
+	return false;
+}
+
+// --------------------------------------------------------
+// Builds everything Execute() needs, and borrows the device
+// textures for transients
+// --------------------------------------------------------
+bool RenderGraph::Compile(RenderTargetPool* pool)
+{
+	ReturnTextures();
+	this->pool = pool;
+	compiled = false;
+	passOrder.clear();
+	transitions.clear();
+	if (!error.empty())
+		return false;
+
+	if (!CullPasses() || !SortPasses())
+		return false;
+
+	if (!AssignPhysicalTextures())
+		return false;
+	RecordTransitions();
+
+	compiled = true;
+	return true;
+}
+
+// --------------------------------------------------------
+// Works back from the passes with visible results, keeping
+// whatever made the versions they read (or draw on top of)
+// --------------------------------------------------------
+bool RenderGraph::CullPasses()
+{
+	FrameVector<uint32_t> work(&arena);
+	work.reserve(passes.size());
+	for (uint32_t p = 0; p < passes.size(); p++)
+	{
+		Pass& pass = passes[p];
+		pass.Live = pass.SideEffects;
+		for (const Access& access : pass.Accesses)
+		{
+			if (access.Write && textures[versions[access.Version].Texture].Imported)
+				pass.Live = true;
+		}
+
+		if (pass.Live)
+			work.push_back(p);
+	}
+
+	while (!work.empty())
+	{
+		uint32_t p = work.back();
+		work.pop_back();
+
+		for (const Access& access : passes[p].Accesses)
+		{
+			// Clears & discards don't care what was there before
+			uint32_t needed = UINT32_MAX;
+			if (!access.Write)
+				needed = access.Version;
+			else if (access.Load == RENDER_GRAPH_LOAD_KEEP)
+				needed = access.Previous;
+			if (needed == UINT32_MAX)
+				continue;
+
+			const Version& version = versions[needed];
+			if (version.Producer == UINT32_MAX)
+			{
+				// Only imported textures have contents to start with
+				if (!access.Write && !textures[version.Texture].Imported)
+					return Fail(std::string("'") + passes[p].Name + "' reads '" + textures[version.Texture].Name + "' before anything writes it");
+				continue;
+			}
+
+			if (!passes[version.Producer].Live)
+			{
+				passes[version.Producer].Live = true;
+				work.push_back(version.Producer);
+			}
+		}
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Topological sort of the live passes.  Of the passes that
+// are ready to run, the one added first goes next.
+// --------------------------------------------------------
+bool RenderGraph::SortPasses()
+{
+	for (Pass& pass : passes)
+		pass.Before.clear();
+
+	for (uint32_t p = 0; p < passes.size(); p++)
+	{
+		Pass& pass = passes[p];
+		if (!pass.Live)
+			continue;
+
+		// A pass can't use a texture two ways at once
+		for (size_t a = 0; a < pass.Accesses.size(); a++)
+		{
+			for (size_t b = a + 1; b < pass.Accesses.size(); b++)
+			{
+				const Access& first = pass.Accesses[a];
+				const Access& second = pass.Accesses[b];
+				if (versions[first.Version].Texture == versions[second.Version].Texture && first.State != second.State)
+					return Fail(std::string("'") + pass.Name + "' uses '" + textures[versions[first.Version].Texture].Name + "' as both an input and an output");
+			}
+		}
+
+		for (const Access& access : pass.Accesses)
+		{
+			// Reads come after the write that made the version
+			if (!access.Write)
+			{
+				uint32_t producer = versions[access.Version].Producer;
+				if (producer != UINT32_MAX && producer != p && passes[producer].Live)
+					pass.Before.push_back(producer);
+				continue;
+			}
+
+			// Writes come after the last live writer, and after
+			// everything that read a version since.  Culled writers
+			// are skipped over, or their readers could run after
+			// this write has replaced what they read.
+			for (uint32_t v = access.Previous; v != UINT32_MAX; v = versions[v].Previous)
+			{
+				const Version& version = versions[v];
+				for (uint32_t reader : version.Readers)
+				{
+					if (reader != p && passes[reader].Live)
+						pass.Before.push_back(reader);
+				}
+
+				if (version.Producer == UINT32_MAX)
+					break;
+				if (passes[version.Producer].Live)
+				{
+					if (version.Producer != p)
+						pass.Before.push_back(version.Producer);
+					break;
+				}
+			}
+		}
+	}
+
+	// Kahn's algorithm
+	FrameVector<uint32_t> waitingOn(passes.size(), 0, &arena);
+	FrameVector<FrameVector<uint32_t>> after(passes.size(), FrameVector<uint32_t>(&arena), &arena);
+	for (uint32_t p = 0; p < passes.size(); p++)
+	{
+		FrameVector<uint32_t>& before = passes[p].Before;
+		std::sort(before.begin(), before.end());
+		before.erase(std::unique(before.begin(), before.end()), before.end());
+		for (uint32_t b : before)
+			after[b].push_back(p);
+		waitingOn[p] = (uint32_t)before.size();
+	}
+
+	FrameVector<uint32_t> readyStorage(&arena);
+	readyStorage.reserve(passes.size());
+	std::priority_queue<uint32_t, FrameVector<uint32_t>, std::greater<uint32_t>> ready(std::greater<uint32_t>(), std::move(readyStorage));
+	uint32_t liveCount = 0;
+	for (uint32_t p = 0; p < passes.size(); p++)
+	{
+		if (!passes[p].Live)
+			continue;
+		liveCount++;
+		if (waitingOn[p] == 0)
+			ready.push(p);
+	}
+
+	while (!ready.empty())
+	{
+		uint32_t p = ready.top();
+		ready.pop();
+		passOrder.push_back(p);
+
+		for (uint32_t next : after[p])
+		{
+			if (--waitingOn[next] == 0)
+				ready.push(next);
+		}
+	}
+
+	if (passOrder.size() != liveCount)
+		return Fail("The passes depend on each other in a cycle");
+	return true;
+}
+
+// --------------------------------------------------------
+// Lifetimes & aliasing.  Transients whose lifetimes don't
+// overlap share a device texture when their descs match,
+// and device textures come from the pool.
+// --------------------------------------------------------
+bool RenderGraph::AssignPhysicalTextures()
+{
+	for (Texture& texture : textures)
+	{
+		texture.FirstUse = UINT32_MAX;
+		texture.LastUse = 0;
+		texture.PhysicalIndex = UINT32_MAX;
+	}
+
+	for (uint32_t position = 0; position < passOrder.size(); position++)
+	{
+		for (const Access& access : passes[passOrder[position]].Accesses)
+		{
+			Texture& texture = textures[versions[access.Version].Texture];
+			if (texture.FirstUse == UINT32_MAX)
+				texture.FirstUse = position;
+			texture.LastUse = position;
+		}
+	}
+
+	// First come, first served, in order of first use
+	FrameVector<uint32_t> transients(&arena);
+	transients.reserve(textures.size());
+	for (uint32_t t = 0; t < textures.size(); t++)
+	{
+		if (!textures[t].Imported && textures[t].FirstUse != UINT32_MAX)
+			transients.push_back(t);
+	}
+	std::sort(transients.begin(), transients.end(), [&](uint32_t a, uint32_t b) { return textures[a].FirstUse < textures[b].FirstUse; });
+	transientCount = (uint32_t)transients.size();
+
+	physical.clear();
+	for (uint32_t t : transients)
+	{
+		Texture& texture = textures[t];
+		for (uint32_t s = 0; s < physical.size(); s++)
+		{
+			if (physical[s].Desc == texture.Desc && physical[s].LastUse < texture.FirstUse)
+			{
+				texture.PhysicalIndex = s;
+				break;
+			}
+		}
+
+		if (texture.PhysicalIndex == UINT32_MAX)
+		{
+			Physical slot;
+			slot.Desc = texture.Desc;
+			physical.push_back(slot);
+			texture.PhysicalIndex = (uint32_t)physical.size() - 1;
+		}
+		physical[texture.PhysicalIndex].LastUse = texture.LastUse;
+	}
+
+	borrowed = true;
+	for (uint32_t slot = 0; slot < physical.size(); slot++)
+	{
+		if (!pool->Acquire(physical[slot].Desc, physical[slot].DeviceTexture))
+		{
+			RenderGraphTextureDesc desc = physical[slot].Desc;
+			physical.resize(slot);
+			ReturnTextures();
+			return Fail("Couldn't create a " + std::to_string(desc.Width) + "x" + std::to_string(desc.Height) + " device texture");
+		}
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Hands the physical textures back to the pool.  The slots
+// themselves stay around for the stats.
+// --------------------------------------------------------
+void RenderGraph::ReturnTextures()
+{
+	if (!borrowed)
+		return;
+
+	for (const Physical& slot : physical)
+		pool->Release(slot.DeviceTexture);
+	borrowed = false;
+	compiled = false;
+}
+
+// --------------------------------------------------------
+// Walks the passes in order, tracking what each texture is
+// being used as.  A transient's first use always transitions
+// from Undefined, as its device texture held something else.
+// --------------------------------------------------------
+void RenderGraph::RecordTransitions()
+{
+	FrameVector<uint32_t> states(textures.size(), 0, &arena);
+	FrameVector<bool> started(textures.size(), false, &arena);
+	for (uint32_t t = 0; t < textures.size(); t++)
+		states[t] = textures[t].Imported ? textures[t].ImportedState : RENDER_GRAPH_STATE_UNDEFINED;
+
+	for (uint32_t p : passOrder)
+	{
+		Pass& pass = passes[p];
+		pass.Transitions.clear();
+		for (const Access& access : pass.Accesses)
+		{
+			uint32_t t = versions[access.Version].Texture;
+			bool aliased = !textures[t].Imported && !started[t];
+			started[t] = true;
+			if (states[t] == access.State && !aliased)
+				continue;
+
+			Transition transition;
+			transition.DeviceTexture = GetDeviceTexture(RenderGraphResource{ access.Version });
+			transition.Before = aliased ? RENDER_GRAPH_STATE_UNDEFINED : states[t];
+			transition.After = access.State;
+			pass.Transitions.push_back((uint32_t)transitions.size());
+			transitions.push_back(transition);
+			states[t] = access.State;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Runs the compiled passes
+// --------------------------------------------------------
+void RenderGraph::Execute(RenderGraphDevice* device)
+{
+	if (!compiled)
+		return;
+
+	RenderGraphPassResources resources(*this);
+	for (uint32_t p : passOrder)
+	{
+		Pass& pass = passes[p];
+		for (uint32_t t : pass.Transitions)
+			device->Transition(transitions[t].DeviceTexture, transitions[t].Before, transitions[t].After);
+
+		RenderGraphPassTargets targets;
+		for (const Access& access : pass.Accesses)
+		{
+			if (!access.Bound)
+				continue;
+
+			if (access.State == RENDER_GRAPH_STATE_DEPTH_WRITE)
+			{
+				targets.HasDepth = true;
+				targets.Depth = GetDeviceTexture(RenderGraphResource{ access.Version });
+				targets.DepthLoad = access.Load;
+				targets.ClearDepth = access.Clear[0];
+			}
+			else if (targets.ColorCount < RENDER_GRAPH_MAX_COLOR_TARGETS)
+			{
+				uint32_t slot = targets.ColorCount++;
+				targets.Colors[slot] = GetDeviceTexture(RenderGraphResource{ access.Version });
+				targets.ColorLoad[slot] = access.Load;
+				memcpy(targets.ClearColors[slot], access.Clear, sizeof(float) * 4);
+			}
+		}
+
+		device->BeginPass(targets);
+		if (pass.Execute)
+			pass.Execute(resources);
+		device->EndPass();
+	}
+
+	// Done with them until next frame
+	ReturnTextures();
+}
+
+uint32_t RenderGraph::GetDeviceTexture(RenderGraphResource resource) const
+{
+	if (!resource.IsValid())
+		return UINT32_MAX;
+
+	const Texture& texture = textures[versions[resource.Version].Texture];
+	if (texture.Imported)
+		return texture.ImportedTexture;
+	if (texture.PhysicalIndex == UINT32_MAX)
+		return UINT32_MAX;
+	return physical[texture.PhysicalIndex].DeviceTexture;
+}
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "FrameArena.h"
+
+// Most render targets a pass can write at once
+#define RENDER_GRAPH_MAX_COLOR_TARGETS 8
+
+// How a texture can be used (combine with |)
+#define RENDER_GRAPH_BIND_RENDER_TARGET		0x1
+#define RENDER_GRAPH_BIND_SHADER_RESOURCE	0x2
+#define RENDER_GRAPH_BIND_DEPTH_STENCIL		0x4
+
+// What a texture is being used as at a point in the frame
+#define RENDER_GRAPH_STATE_UNDEFINED		0
+#define RENDER_GRAPH_STATE_RENDER_TARGET	1
+#define RENDER_GRAPH_STATE_DEPTH_WRITE		2
+#define RENDER_GRAPH_STATE_SHADER_RESOURCE	3
+
+// What happens to a target's existing contents when a pass starts
+#define RENDER_GRAPH_LOAD_KEEP		0	// Drawn on top of
+#define RENDER_GRAPH_LOAD_CLEAR		1	// Cleared first
+#define RENDER_GRAPH_LOAD_DISCARD	2	// Fully overwritten, so don't care
+
+// --------------------------------------------------------
+// A texture's size, format & uses.  Format is the raw
+// DXGI_FORMAT value, so none of this needs Direct3D.
+// --------------------------------------------------------
+struct RenderGraphTextureDesc
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t Format = 0;
+	uint32_t BindFlags = 0;
+
+	bool operator==(const RenderGraphTextureDesc& other) const
+	{
+		return Width == other.Width && Height == other.Height && Format == other.Format && BindFlags == other.BindFlags;
+	}
+};
+
+// --------------------------------------------------------
+// One version of a texture in the graph.  Every write makes
+// a new version, and reads name the version they want - so
+// the order passes are added in doesn't matter.
+// --------------------------------------------------------
+struct RenderGraphResource
+{
+	uint32_t Version = UINT32_MAX;
+	bool IsValid() const { return Version != UINT32_MAX; }
+};
+
+// --------------------------------------------------------
+// The targets the graph binds before a pass runs, as device
+// texture handles
+// --------------------------------------------------------
+struct RenderGraphPassTargets
+{
+	uint32_t ColorCount = 0;
+	uint32_t Colors[RENDER_GRAPH_MAX_COLOR_TARGETS] = {};
+	uint32_t ColorLoad[RENDER_GRAPH_MAX_COLOR_TARGETS] = {};
+	float ClearColors[RENDER_GRAPH_MAX_COLOR_TARGETS][4] = {};
+
+	bool HasDepth = false;
+	uint32_t Depth = 0;
+	uint32_t DepthLoad = RENDER_GRAPH_LOAD_KEEP;
+	float ClearDepth = 1.0f;
+};
+
+// --------------------------------------------------------
+// What the graph needs from a graphics API.  Textures are
+// plain handles the device hands out; imported ones are
+// registered with the device by whoever owns them.
+// --------------------------------------------------------
+class RenderGraphDevice
+{
+public:
+	virtual ~RenderGraphDevice() {}
+
+	virtual bool CreateTexture(const RenderGraphTextureDesc& desc, uint32_t& texture) = 0;
+	virtual void ReleaseTexture(uint32_t texture) = 0;
+
+	// Called before a pass uses a texture differently than the
+	// last one did (Undefined before means the contents are
+	// garbage - a new texture, or another one's aliased memory)
+	virtual void Transition(uint32_t texture, uint32_t before, uint32_t after) = 0;
+
+	// Binds (and clears) a pass's targets
+	virtual void BeginPass(const RenderGraphPassTargets& targets) = 0;
+	virtual void EndPass() = 0;
+};
+
+// --------------------------------------------------------
+// Looks up the device texture behind a graph resource,
+// from inside a pass
+// --------------------------------------------------------
+class RenderGraph;
+class RenderTargetPool;
+class RenderGraphPassResources
+{
+public:
+	RenderGraphPassResources(const RenderGraph& graph) : graph(graph) {}
+	uint32_t GetTexture(RenderGraphResource resource) const;
+
+private:
+	const RenderGraph& graph;
+};
+
+typedef std::function<void(const RenderGraphPassResources&)> RenderGraphExecute;
+
+// --------------------------------------------------------
+// A frame's passes and the textures they pass between them.
+//
+// Each frame: Reset(), declare textures & passes, Compile(),
+// Execute().  Compiling:
+//
+//  - Culls passes whose results nothing uses (a pass is kept
+//    if it writes an imported texture, is marked as having
+//    side effects, or makes something a kept pass reads)
+//  - Orders passes by their dependencies, keeping the order
+//    they were added in where it's free to
+//  - Works out when each transient texture is first and last
+//    used, and lets textures that are never alive at the same
+//    time share one device texture (when their descs match)
+//  - Records the state transitions each pass needs
+//
+// Device textures for transients are borrowed from a pool
+// when compiling and handed back once the passes have run.
+//
+// Everything declared for a frame (names, accesses, the
+// compile's working lists) lives in an arena that Reset()
+// empties, so a graph the same shape as last frame's is
+// built without touching the heap.
+// --------------------------------------------------------
+class RenderGraph
+{
+public:
+	RenderGraph();
+	~RenderGraph();
+
+	// Forgets the last frame's passes
+	void Reset();
+
+	// Textures
+	RenderGraphResource CreateTexture(const char* name, const RenderGraphTextureDesc& desc);
+	RenderGraphResource ImportTexture(const char* name, const RenderGraphTextureDesc& desc, uint32_t deviceTexture, uint32_t state = RENDER_GRAPH_STATE_UNDEFINED);
+
+	// Passes
+	uint32_t AddPass(const char* name, RenderGraphExecute execute);
+	void SetSideEffects(uint32_t pass);
+	void Read(uint32_t pass, RenderGraphResource resource);
+	RenderGraphResource WriteRenderTarget(uint32_t pass, RenderGraphResource resource, uint32_t load = RENDER_GRAPH_LOAD_KEEP, const float clearColor[4] = 0);
+	RenderGraphResource WriteDepthStencil(uint32_t pass, RenderGraphResource resource, uint32_t load = RENDER_GRAPH_LOAD_KEEP, float clearDepth = 1.0f);
+
+	// A write the pass binds itself (like slices of an array)
+	RenderGraphResource Write(uint32_t pass, RenderGraphResource resource, uint32_t state);
+
+	// Building & running
+	bool Compile(RenderTargetPool* pool);
+	void Execute(RenderGraphDevice* device);
+
+	// Results of the last Compile
+	const std::string& GetError() const { return error; }
+	const std::vector<uint32_t>& GetPassOrder() const { return passOrder; }
+	const char* GetPassName(uint32_t pass) const { return passes[pass].Name; }
+	uint32_t GetPassCount() const { return (uint32_t)passes.size(); }
+	uint32_t GetCulledPassCount() const { return (uint32_t)(passes.size() - passOrder.size()); }
+	uint32_t GetTransientTextureCount() const { return transientCount; }
+	uint32_t GetPhysicalTextureCount() const { return (uint32_t)physical.size(); }
+	uint32_t GetDeviceTexture(RenderGraphResource resource) const;
+
+private:
+	struct Texture
+	{
+		const char* Name = "";
+		RenderGraphTextureDesc Desc;
+		bool Imported = false;
+		uint32_t ImportedTexture = 0;
+		uint32_t ImportedState = RENDER_GRAPH_STATE_UNDEFINED;
+		uint32_t LatestVersion = 0;
+
+		// Compile results (transients only)
+		uint32_t FirstUse = UINT32_MAX;
+		uint32_t LastUse = 0;
+		uint32_t PhysicalIndex = UINT32_MAX;
+	};
+
+	struct Version
+	{
+		Version(LinearArena* arena) : Readers(arena) {}
+
+		uint32_t Texture = 0;
+		uint32_t Producer = UINT32_MAX;
+		uint32_t Previous = UINT32_MAX;	// The version written over
+		FrameVector<uint32_t> Readers;
+	};
+
+	struct Access
+	{
+		uint32_t Version;	// Read: the version read.  Write: the version made.
+		uint32_t Previous;	// Write: the version written over
+		uint32_t State;
+		bool Write;
+		bool Bound;			// Bound by the graph as a target
+		uint32_t Load;
+		float Clear[4];
+	};
+
+	struct Pass
+	{
+		Pass(LinearArena* arena) : Accesses(arena), Before(arena), Transitions(arena) {}
+
+		const char* Name = "";
+		RenderGraphExecute Execute;
+		bool SideEffects = false;
+		FrameVector<Access> Accesses;
+
+		// Compile results
+		bool Live = false;
+		FrameVector<uint32_t> Before;	// Passes that must run first
+		FrameVector<uint32_t> Transitions;
+	};
+
+	// A device texture shared by transients
+	struct Physical
+	{
+		RenderGraphTextureDesc Desc;
+		uint32_t DeviceTexture = 0;
+		uint32_t LastUse = 0;
+		uint32_t State = RENDER_GRAPH_STATE_UNDEFINED;
+	};
+
+	struct Transition
+	{
+		uint32_t DeviceTexture;
+		uint32_t Before;
+		uint32_t After;
+	};
+
+	RenderGraphResource AddWrite(uint32_t pass, RenderGraphResource resource, uint32_t state, bool bound, uint32_t load, const float* clear);
+	bool Fail(const std::string& message);
+
+	bool CullPasses();
+	bool SortPasses();
+	bool AssignPhysicalTextures();
+	void ReturnTextures();
+	void RecordTransitions();
+
+	// First, so it outlives everything allocated from it
+	LinearArena arena;
+
+	std::vector<Texture> textures;
+	std::vector<Version> versions;
+	std::vector<Pass> passes;
+
+	std::vector<uint32_t> passOrder;
+	std::vector<Physical> physical;
+	std::vector<Transition> transitions;
+	uint32_t transientCount;
+	bool compiled;
+	std::string error;
+
+	// Where the physical textures are borrowed from (until
+	// they're handed back)
+	RenderTargetPool* pool;
+	bool borrowed;
+};
@@ -0,0 +1,667 @@
+// --------------------------------------------------------
+// Tests RenderGraph against a fake device that records what
+// it's asked to do: culling, ordering (including writes that
+// replace what a pass reads past a culled writer), aliasing
+// transients, transitions, the targets each pass binds, the
+// errors Compile reports, and borrowing from the pool, which
+// ages out unused textures and drops the oldest when over its
+// memory budget.  Also runs a graph through
+// RHIRenderGraphDevice on the null RHI.
+// --------------------------------------------------------
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "NullRHIDevice.h"
+#include "RenderGraph.h"
+#include "RenderTargetPool.h"
+#include "RHIRenderGraphDevice.h"
+#include "TestCheck.h"
+
+// Imported textures use handles from here up, so they never
+// clash with the ones the fake device creates
+#define IMPORTED_TEXTURE_BASE 1000
+
+// --------------------------------------------------------
+// Hands out numbered textures and logs everything else
+// --------------------------------------------------------
+class FakeDevice : public RenderGraphDevice
+{
+public:
+	struct TransitionCall
+	{
+		uint32_t Texture;
+		uint32_t Before;
+		uint32_t After;
+	};
+
+	bool CreateTexture(const RenderGraphTextureDesc& desc, uint32_t& texture) override
+	{
+		if (FailCreates)
+			return false;
+		texture = nextTexture++;
+		Alive++;
+		return true;
+	}
+
+	void ReleaseTexture(uint32_t texture) override
+	{
+		Released.push_back(texture);
+		Alive--;
+	}
+
+	void Transition(uint32_t texture, uint32_t before, uint32_t after) override
+	{
+		Transitions.push_back({ texture, before, after });
+	}
+
+	void BeginPass(const RenderGraphPassTargets& targets) override
+	{
+		CHECK(!InPass);
+		InPass = true;
+		Targets.push_back(targets);
+	}
+
+	void EndPass() override
+	{
+		CHECK(InPass);
+		InPass = false;
+	}
+
+	bool FailCreates = false;
+	bool InPass = false;
+	int Alive = 0;
+	std::vector<uint32_t> Released;
+	std::vector<TransitionCall> Transitions;
+	std::vector<RenderGraphPassTargets> Targets;
+
+private:
+	uint32_t nextTexture = 1;
+};
+
+static RenderGraphTextureDesc MakeDesc(uint32_t width, uint32_t height)
+{
+	RenderGraphTextureDesc desc;
+	desc.Width = width;
+	desc.Height = height;
+	desc.Format = 10;	// DXGI_FORMAT_R16G16B16A16_FLOAT
+	desc.BindFlags = RENDER_GRAPH_BIND_RENDER_TARGET | RENDER_GRAPH_BIND_SHADER_RESOURCE;
+	return desc;
+}
+
+// The compiled order as pass names, like "A B C"
+static std::string GetOrder(const RenderGraph& graph)
+{
+	std::string order;
+	for (uint32_t p : graph.GetPassOrder())
+	{
+		if (!order.empty())
+			order += ' ';
+		order += graph.GetPassName(p);
+	}
+	return order;
+}
+
+static void TestCulling()
+{
+	std::shared_ptr<FakeDevice> device = std::make_shared<FakeDevice>();
+	RenderTargetPool pool(device);
+	RenderGraph graph;
+
+	RenderGraphResource backBuffer = graph.ImportTexture("Back Buffer", MakeDesc(64, 64), IMPORTED_TEXTURE_BASE);
+	RenderGraphResource scene = graph.CreateTexture("Scene", MakeDesc(64, 64));
+	RenderGraphResource unused = graph.CreateTexture("Unused", MakeDesc(64, 64));
+	RenderGraphResource debug = graph.CreateTexture("Debug", MakeDesc(64, 64));
+
+	uint32_t draw = graph.AddPass("Draw", 0);
+	scene = graph.WriteRenderTarget(draw, scene, RENDER_GRAPH_LOAD_CLEAR);
+
+	// Nothing reads this, so it goes
+	uint32_t wasted = graph.AddPass("Wasted", 0);
+	graph.Read(wasted, scene);
+	graph.WriteRenderTarget(wasted, unused, RENDER_GRAPH_LOAD_CLEAR);
+
+	// Nothing reads this either, but it does something else
+	uint32_t capture = graph.AddPass("Capture", 0);
+	graph.Read(capture, scene);
+	graph.WriteRenderTarget(capture, debug, RENDER_GRAPH_LOAD_CLEAR);
+	graph.SetSideEffects(capture);
+
+	uint32_t present = graph.AddPass("Present", 0);
+	graph.Read(present, scene);
+	graph.WriteRenderTarget(present, backBuffer, RENDER_GRAPH_LOAD_DISCARD);
+
+	CHECK(graph.Compile(&pool));
+	CHECK(GetOrder(graph) == "Draw Capture Present");
+	CHECK(graph.GetPassCount() == 4);
+	CHECK(graph.GetCulledPassCount() == 1);
+
+	// Culled passes' textures aren't even made
+	CHECK(graph.GetTransientTextureCount() == 2);
+	CHECK(graph.GetDeviceTexture(unused) == UINT32_MAX);
+	CHECK(graph.GetDeviceTexture(backBuffer) == IMPORTED_TEXTURE_BASE);
+	graph.Execute(device.get());
+}
+
+static void TestOrdering()
+{
+	std::shared_ptr<FakeDevice> device = std::make_shared<FakeDevice>();
+	RenderTargetPool pool(device);
+	RenderGraph graph;
+
+	// Added backwards: each pass's input comes from a later one
+	RenderGraphResource backBuffer = graph.ImportTexture("Back Buffer", MakeDesc(64, 64), IMPORTED_TEXTURE_BASE);
+	RenderGraphResource a = graph.CreateTexture("A", MakeDesc(64, 64));
+	RenderGraphResource b = graph.CreateTexture("B", MakeDesc(32, 32));
+	uint32_t present = graph.AddPass("Present", 0);
+	uint32_t blur = graph.AddPass("Blur", 0);
+	uint32_t draw = graph.AddPass("Draw", 0);
+	uint32_t overlay = graph.AddPass("Overlay", 0);
+
+	a = graph.WriteRenderTarget(draw, a, RENDER_GRAPH_LOAD_CLEAR);
+	graph.Read(blur, a);
+	b = graph.WriteRenderTarget(blur, b, RENDER_GRAPH_LOAD_DISCARD);
+	graph.Read(present, b);
+	backBuffer = graph.WriteRenderTarget(present, backBuffer, RENDER_GRAPH_LOAD_DISCARD);
+
+	// Independent of the rest until it draws on top
+	graph.WriteRenderTarget(overlay, backBuffer);
+
+	CHECK(graph.Compile(&pool));
+	CHECK(GetOrder(graph) == "Draw Blur Present Overlay");
+
+	// Passes free to go anywhere keep the order they were added in
+	graph.Reset();
+	backBuffer = graph.ImportTexture("Back Buffer", MakeDesc(64, 64), IMPORTED_TEXTURE_BASE);
+	RenderGraphResource shadow = graph.CreateTexture("Shadow", MakeDesc(32, 32));
+	uint32_t first = graph.AddPass("First", 0);
+	uint32_t second = graph.AddPass("Second", 0);
+	uint32_t third = graph.AddPass("Third", 0);
+	graph.SetSideEffects(first);
+	graph.SetSideEffects(second);
+	shadow = graph.WriteRenderTarget(third, shadow, RENDER_GRAPH_LOAD_CLEAR);
+	graph.Read(second, shadow);
+	graph.WriteRenderTarget(second, backBuffer, RENDER_GRAPH_LOAD_CLEAR);
+
+	CHECK(graph.Compile(&pool));
+	CHECK(GetOrder(graph) == "First Third Second");
+}
+
+// --------------------------------------------------------
+// A write has to wait for everything that read an earlier
+// version, even past a writer that was culled.
+//
+// A clears T to v1, B reads v1 (and draws over E's output),
+// C writes v2 but is culled, D clears T to v3 and E reads
+// it.  B needs v1 after E has run, but D (before E) wipes
+// it - a cycle, whether or not C is culled.  Ignoring B
+// because only C's readers were checked gave A D E B.
+// --------------------------------------------------------
+static void TestWriteAfterCulledWriter()
+{
+	std::shared_ptr<FakeDevice> device = std::make_shared<FakeDevice>();
+	RenderTargetPool pool(device);
+	RenderGraph graph;
+
+	for (int keepC = 0; keepC < 2; keepC++)
+	{
+		graph.Reset();
+		RenderGraphResource backBuffer = graph.ImportTexture("Back Buffer", MakeDesc(64, 64), IMPORTED_TEXTURE_BASE);
+		RenderGraphResource t = graph.CreateTexture("T", MakeDesc(64, 64));
+		uint32_t a = graph.AddPass("A", 0);
+		uint32_t b = graph.AddPass("B", 0);
+		uint32_t c = graph.AddPass("C", 0);
+		uint32_t d = graph.AddPass("D", 0);
+		uint32_t e = graph.AddPass("E", 0);
+
+		RenderGraphResource v1 = graph.WriteRenderTarget(a, t, RENDER_GRAPH_LOAD_CLEAR);
+		graph.Read(b, v1);
+		RenderGraphResource v2 = graph.Write(c, v1, RENDER_GRAPH_STATE_RENDER_TARGET);
+		RenderGraphResource v3 = graph.WriteRenderTarget(d, v2, RENDER_GRAPH_LOAD_CLEAR);
+		graph.Read(e, v3);
+		backBuffer = graph.WriteRenderTarget(e, backBuffer, RENDER_GRAPH_LOAD_CLEAR);
+		graph.WriteRenderTarget(b, backBuffer);
+		if (keepC)
+			graph.SetSideEffects(c);
+
+		CHECK(!graph.Compile(&pool));
+		CHECK(graph.GetError().find("cycle") != std::string::npos);
+	}
+
+	// Without B waiting on E, D just has to wait for B
+	graph.Reset();
+	RenderGraphResource backBuffer = graph.ImportTexture("Back Buffer", MakeDesc(64, 64), IMPORTED_TEXTURE_BASE);
+	RenderGraphResource t = graph.CreateTexture("T", MakeDesc(64, 64));
+	uint32_t a = graph.AddPass("A", 0);
+	uint32_t c = graph.AddPass("C", 0);
+	uint32_t d = graph.AddPass("D", 0);
+	uint32_t e = graph.AddPass("E", 0);
+	uint32_t b = graph.AddPass("B", 0);
+
+	RenderGraphResource v1 = graph.WriteRenderTarget(a, t, RENDER_GRAPH_LOAD_CLEAR);
+	graph.Read(b, v1);
+	graph.SetSideEffects(b);
+	RenderGraphResource v2 = graph.Write(c, v1, RENDER_GRAPH_STATE_RENDER_TARGET);
+	RenderGraphResource v3 = graph.WriteRenderTarget(d, v2, RENDER_GRAPH_LOAD_CLEAR);
+	graph.Read(e, v3);
+	graph.WriteRenderTarget(e, backBuffer, RENDER_GRAPH_LOAD_CLEAR);
+
+	CHECK(graph.Compile(&pool));
+	CHECK(GetOrder(graph) == "A B D E");
+	CHECK(graph.GetCulledPassCount() == 1);
+}
+
+static void TestAliasing()
+{
+	std::shared_ptr<FakeDevice> device = std::make_shared<FakeDevice>();
+	RenderTargetPool pool(device);
+	RenderGraph graph;
+
+	// A chain of same-sized textures, each only needed by the
+	// next pass: every other one can share a device texture
+	RenderGraphResource backBuffer = graph.ImportTexture("Back Buffer", MakeDesc(64, 64), IMPORTED_TEXTURE_BASE);
+	const char* names[] = { "T0", "T1", "T2", "T3", "T4" };
+	RenderGraphResource previous;
+	RenderGraphResource chain[5];
+	for (int i = 0; i < 5; i++)
+	{
+		uint32_t pass = graph.AddPass(names[i], 0);
+		if (previous.IsValid())
+			graph.Read(pass, previous);
+		chain[i] = graph.CreateTexture(names[i], MakeDesc(64, 64));
+		chain[i] = graph.WriteRenderTarget(pass, chain[i], RENDER_GRAPH_LOAD_DISCARD);
+		previous = chain[i];
+	}
+
+	// A different size never shares
+	RenderGraphResource small = graph.CreateTexture("Small", MakeDesc(16, 16));
+	uint32_t shrink = graph.AddPass("Shrink", 0);
+	graph.Read(shrink, previous);
+	small = graph.WriteRenderTarget(shrink, small, RENDER_GRAPH_LOAD_DISCARD);
+	uint32_t present = graph.AddPass("Present", 0);
+	graph.Read(present, small);
+	graph.WriteRenderTarget(present, backBuffer, RENDER_GRAPH_LOAD_DISCARD);
+
+	CHECK(graph.Compile(&pool));
+	CHECK(graph.GetTransientTextureCount() == 6);
+	CHECK(graph.GetPhysicalTextureCount() == 3);
+	CHECK(graph.GetDeviceTexture(chain[0]) == graph.GetDeviceTexture(chain[2]));
+	CHECK(graph.GetDeviceTexture(chain[2]) == graph.GetDeviceTexture(chain[4]));
+	CHECK(graph.GetDeviceTexture(chain[1]) == graph.GetDeviceTexture(chain[3]));
+	CHECK(graph.GetDeviceTexture(chain[0]) != graph.GetDeviceTexture(chain[1]));
+	CHECK(graph.GetDeviceTexture(small) != graph.GetDeviceTexture(chain[0]));
+	CHECK(graph.GetDeviceTexture(small) != graph.GetDeviceTexture(chain[1]));
+
+	// Every pass's first use of an aliased texture starts from
+	// Undefined, as something else was in it
+	graph.Execute(device.get());
+	uint32_t fromUndefined = 0;
+	for (const FakeDevice::TransitionCall& call : device->Transitions)
+		fromUndefined += call.Before == RENDER_GRAPH_STATE_UNDEFINED && call.Texture < IMPORTED_TEXTURE_BASE ? 1 : 0;
+	CHECK(fromUndefined == 6);
+}
+
+static void TestTransitionsAndTargets()
+{
+	std::shared_ptr<FakeDevice> device = std::make_shared<FakeDevice>();
+	RenderTargetPool pool(device);
+	RenderGraph graph;
+
+	RenderGraphResource backBuffer = graph.ImportTexture("Back Buffer", MakeDesc(64, 64), IMPORTED_TEXTURE_BASE, RENDER_GRAPH_STATE_RENDER_TARGET);
+	RenderGraphTextureDesc depthDesc = MakeDesc(64, 64);
+	depthDesc.BindFlags = RENDER_GRAPH_BIND_DEPTH_STENCIL;
+	RenderGraphResource depth = graph.ImportTexture("Depth", depthDesc, IMPORTED_TEXTURE_BASE + 1, RENDER_GRAPH_STATE_DEPTH_WRITE);
+	RenderGraphResource scene = graph.CreateTexture("Scene", MakeDesc(64, 64));
+
+	std::vector<std::string> ran;
+	uint32_t sceneTexture = UINT32_MAX;
+	static const float clearColor[4] = { 0.1f, 0.2f, 0.3f, 1.0f };
+	uint32_t draw = graph.AddPass("Draw", [&](const RenderGraphPassResources& resources) {
+		ran.push_back("Draw");
+		sceneTexture = resources.GetTexture(scene);
+	});
+	scene = graph.WriteRenderTarget(draw, scene, RENDER_GRAPH_LOAD_CLEAR, clearColor);
+	graph.WriteDepthStencil(draw, depth, RENDER_GRAPH_LOAD_CLEAR, 0.5f);
+
+	uint32_t present = graph.AddPass("Present", [&](const RenderGraphPassResources& resources) { ran.push_back("Present"); });
+	graph.Read(present, scene);
+	graph.WriteRenderTarget(present, backBuffer, RENDER_GRAPH_LOAD_DISCARD);
+
+	CHECK(graph.Compile(&pool));
+	graph.Execute(device.get());
+	CHECK(ran.size() == 2 && ran[0] == "Draw" && ran[1] == "Present");
+	CHECK(sceneTexture != UINT32_MAX && sceneTexture < IMPORTED_TEXTURE_BASE);
+
+	// Scene: undefined -> target -> shader resource.  The
+	// imports are already in the states they're used in.
+	CHECK(device->Transitions.size() == 2);
+	if (device->Transitions.size() == 2)
+	{
+		CHECK(device->Transitions[0].Texture == sceneTexture);
+		CHECK(device->Transitions[0].Before == RENDER_GRAPH_STATE_UNDEFINED);
+		CHECK(device->Transitions[0].After == RENDER_GRAPH_STATE_RENDER_TARGET);
+		CHECK(device->Transitions[1].Before == RENDER_GRAPH_STATE_RENDER_TARGET);
+		CHECK(device->Transitions[1].After == RENDER_GRAPH_STATE_SHADER_RESOURCE);
+	}
+
+	CHECK(device->Targets.size() == 2);
+	if (device->Targets.size() == 2)
+	{
+		const RenderGraphPassTargets& drawTargets = device->Targets[0];
+		CHECK(drawTargets.ColorCount == 1 && drawTargets.Colors[0] == sceneTexture);
+		CHECK(drawTargets.ColorLoad[0] == RENDER_GRAPH_LOAD_CLEAR);
+		CHECK(drawTargets.ClearColors[0][1] == 0.2f);
+		CHECK(drawTargets.HasDepth && drawTargets.Depth == IMPORTED_TEXTURE_BASE + 1);
+		CHECK(drawTargets.DepthLoad == RENDER_GRAPH_LOAD_CLEAR && drawTargets.ClearDepth == 0.5f);
+
+		const RenderGraphPassTargets& presentTargets = device->Targets[1];
+		CHECK(presentTargets.ColorCount == 1 && presentTargets.Colors[0] == IMPORTED_TEXTURE_BASE);
+		CHECK(presentTargets.ColorLoad[0] == RENDER_GRAPH_LOAD_DISCARD);
+		CHECK(!presentTargets.HasDepth);
+	}
+	CHECK(!device->InPass);
+}
+
+static void TestErrors()
+{
+	std::shared_ptr<FakeDevice> device = std::make_shared<FakeDevice>();
+	RenderTargetPool pool(device);
+	RenderGraph graph;
+
+	// Reading what nothing wrote
+	RenderGraphResource backBuffer = graph.ImportTexture("Back Buffer", MakeDesc(64, 64), IMPORTED_TEXTURE_BASE);
+	RenderGraphResource empty = graph.CreateTexture("Empty", MakeDesc(64, 64));
+	uint32_t pass = graph.AddPass("Present", 0);
+	graph.Read(pass, empty);
+	graph.WriteRenderTarget(pass, backBuffer);
+	CHECK(!graph.Compile(&pool));
+	CHECK(graph.GetError().find("before anything writes it") != std::string::npos);
+
+	// Writing an old version
+	graph.Reset();
+	RenderGraphResource t = graph.CreateTexture("T", MakeDesc(64, 64));
+	uint32_t first = graph.AddPass("First", 0);
+	uint32_t second = graph.AddPass("Second", 0);
+	graph.WriteRenderTarget(first, t, RENDER_GRAPH_LOAD_CLEAR);
+	CHECK(!graph.WriteRenderTarget(second, t, RENDER_GRAPH_LOAD_CLEAR).IsValid());
+	CHECK(!graph.Compile(&pool));
+	CHECK(graph.GetError().find("old version") != std::string::npos);
+
+	// Reading and writing one texture in one pass
+	graph.Reset();
+	backBuffer = graph.ImportTexture("Back Buffer", MakeDesc(64, 64), IMPORTED_TEXTURE_BASE);
+	pass = graph.AddPass("Feedback", 0);
+	graph.Read(pass, backBuffer);
+	graph.WriteRenderTarget(pass, backBuffer);
+	CHECK(!graph.Compile(&pool));
+	CHECK(graph.GetError().find("both an input and an output") != std::string::npos);
+
+	// The device running out
+	graph.Reset();
+	backBuffer = graph.ImportTexture("Back Buffer", MakeDesc(64, 64), IMPORTED_TEXTURE_BASE);
+	t = graph.CreateTexture("T", MakeDesc(48, 48));
+	first = graph.AddPass("First", 0);
+	second = graph.AddPass("Second", 0);
+	t = graph.WriteRenderTarget(first, t, RENDER_GRAPH_LOAD_CLEAR);
+	graph.Read(second, t);
+	graph.WriteRenderTarget(second, backBuffer);
+	device->FailCreates = true;
+	CHECK(!graph.Compile(&pool));
+	CHECK(graph.GetError().find("48x48") != std::string::npos);
+	CHECK(pool.GetBorrowedCount() == 0);
+
+	// Nothing runs after a failed compile
+	graph.Execute(device.get());
+	CHECK(device->Targets.empty());
+	device->FailCreates = false;
+}
+
+static void TestPoolReuse()
+{
+	std::shared_ptr<FakeDevice> device = std::make_shared<FakeDevice>();
+	{
+		RenderTargetPool pool(device);
+		RenderGraph graph;
+
+		// The same graph frame after frame makes its textures once
+		for (int frame = 0; frame < 10; frame++)
+		{
+			graph.Reset();
+			RenderGraphResource backBuffer = graph.ImportTexture("Back Buffer", MakeDesc(64, 64), IMPORTED_TEXTURE_BASE);
+			RenderGraphResource scene = graph.CreateTexture("Scene", MakeDesc(64, 64));
+			RenderGraphResource half = graph.CreateTexture("Half", MakeDesc(32, 32));
+			uint32_t draw = graph.AddPass("Draw", 0);
+			scene = graph.WriteRenderTarget(draw, scene, RENDER_GRAPH_LOAD_CLEAR);
+			uint32_t shrink = graph.AddPass("Shrink", 0);
+			graph.Read(shrink, scene);
+			half = graph.WriteRenderTarget(shrink, half, RENDER_GRAPH_LOAD_DISCARD);
+			uint32_t present = graph.AddPass("Present", 0);
+			graph.Read(present, half);
+			graph.WriteRenderTarget(present, backBuffer, RENDER_GRAPH_LOAD_DISCARD);
+
+			CHECK(graph.Compile(&pool));
+			CHECK(pool.GetBorrowedCount() == 2);
+			graph.Execute(device.get());
+			CHECK(pool.GetBorrowedCount() == 0);
+			pool.EndFrame();
+		}
+		CHECK(pool.GetCreatedCount() == 2);
+		CHECK(device->Alive == 2);
+
+		// Compiled but never run: handed back by the next Reset()
+		graph.Reset();
+		RenderGraphResource t = graph.CreateTexture("T", MakeDesc(64, 64));
+		uint32_t pass = graph.AddPass("Side", 0);
+		graph.SetSideEffects(pass);
+		graph.WriteRenderTarget(pass, t, RENDER_GRAPH_LOAD_CLEAR);
+		CHECK(graph.Compile(&pool));
+		CHECK(pool.GetBorrowedCount() == 1);
+		graph.Reset();
+		CHECK(pool.GetBorrowedCount() == 0);
+	}
+	CHECK(device->Alive == 0);
+}
+
+static void TestPoolAging()
+{
+	std::shared_ptr<FakeDevice> device = std::make_shared<FakeDevice>();
+	RenderTargetPool pool(device, 3);
+
+	// Used on frame 0, so it's gone once 3 frames pass without it
+	uint32_t stale = 0;
+	CHECK(pool.Acquire(MakeDesc(64, 64), stale));
+	pool.Release(stale);
+	for (int frame = 0; frame < 3; frame++)
+	{
+		pool.EndFrame();
+		CHECK(pool.GetTextureCount() == 1);
+	}
+	pool.EndFrame();
+	CHECK(pool.GetTextureCount() == 0);
+	CHECK(device->Released.size() == 1 && device->Released[0] == stale);
+
+	// Using it again starts its age over
+	uint32_t kept = 0;
+	CHECK(pool.Acquire(MakeDesc(64, 64), kept));
+	pool.Release(kept);
+	for (int frame = 0; frame < 10; frame++)
+	{
+		uint32_t again = 0;
+		CHECK(pool.Acquire(MakeDesc(64, 64), again) && again == kept);
+		pool.Release(again);
+		pool.EndFrame();
+	}
+	CHECK(pool.GetTextureCount() == 1);
+	CHECK(pool.GetCreatedCount() == 2);
+
+	// Borrowed textures never age out
+	uint32_t borrowed = 0;
+	CHECK(pool.Acquire(MakeDesc(32, 32), borrowed));
+	for (int frame = 0; frame < 10; frame++)
+		pool.EndFrame();
+	CHECK(pool.GetTextureCount() == 1 && pool.GetBorrowedCount() == 1);
+	CHECK(device->Released.size() == 2 && device->Released[1] == kept);
+
+	// A shorter limit applies to what's already pooled
+	pool.Release(borrowed);
+	pool.EndFrame();
+	pool.SetMaxUnusedFrames(1);
+	pool.EndFrame();
+	CHECK(pool.GetTextureCount() == 0);
+	CHECK(pool.GetReleasedCount() == 3);
+	CHECK(device->Alive == 0);
+}
+
+static void TestPoolBudget()
+{
+	std::shared_ptr<FakeDevice> device = std::make_shared<FakeDevice>();
+	RenderTargetPool pool(device, 1000);
+
+	// Three textures (8 bytes a pixel), each last used a frame
+	// after the one before
+	RenderGraphTextureDesc descs[3] = { MakeDesc(64, 64), MakeDesc(32, 32), MakeDesc(64, 32) };
+	uint32_t textures[3] = {};
+	for (int i = 0; i < 3; i++)
+	{
+		CHECK(pool.Acquire(descs[i], textures[i]));
+		pool.Release(textures[i]);
+		pool.EndFrame();
+	}
+	CHECK(RenderTargetPool::GetTextureBytes(descs[0]) == 64 * 64 * 8);
+	CHECK(pool.GetMemoryUsage() == (64 * 64 + 32 * 32 + 64 * 32) * 8);
+
+	// Just over budget: only the oldest goes, even though
+	// dropping the small one would have been enough
+	pool.SetMemoryBudget((32 * 32 + 64 * 32) * 8 + 1);
+	pool.EndFrame();
+	CHECK(pool.GetTextureCount() == 2);
+	CHECK(device->Released.size() == 1 && device->Released[0] == textures[0]);
+
+	// Then the next oldest, until it fits
+	pool.SetMemoryBudget(64 * 32 * 8);
+	pool.EndFrame();
+	CHECK(pool.GetTextureCount() == 1);
+	CHECK(device->Released.size() == 2 && device->Released[1] == textures[1]);
+	CHECK(pool.GetMemoryUsage() == 64 * 32 * 8);
+
+	// Borrowed textures stay, even over budget
+	uint32_t borrowed = 0;
+	CHECK(pool.Acquire(descs[2], borrowed) && borrowed == textures[2]);
+	CHECK(pool.Acquire(descs[0], textures[0]));
+	pool.Release(textures[0]);
+	pool.SetMemoryBudget(1);
+	pool.EndFrame();
+	CHECK(pool.GetTextureCount() == 1 && pool.GetBorrowedCount() == 1);
+	CHECK(device->Released.size() == 3 && device->Released[2] == textures[0]);
+
+	// No budget is no limit
+	pool.Release(borrowed);
+	pool.SetMemoryBudget(0);
+	pool.EndFrame();
+	CHECK(pool.GetTextureCount() == 1);
+}
+
+static void TestOnRHIDevice()
+{
+	std::shared_ptr<NullRHIDevice> rhi = std::make_shared<NullRHIDevice>();
+	NullRHIContext& context = rhi->GetNullContext();
+	context.SetLogging(true);
+
+	// The back buffer is made outside the graph, and imported
+	RHITextureDesc backBufferDesc;
+	backBufferDesc.Width = 64;
+	backBufferDesc.Height = 32;
+	backBufferDesc.Format = 28;	// DXGI_FORMAT_R8G8B8A8_UNORM
+	backBufferDesc.BindFlags = RHI_BIND_RENDER_TARGET;
+	RHITexture backBufferTexture;
+	RHIView backBufferRTV;
+	CHECK(rhi->CreateTexture(backBufferDesc, 0, 0, backBufferTexture));
+	CHECK(rhi->CreateView(backBufferTexture, RHI_VIEW_RENDER_TARGET, backBufferRTV));
+	uint32_t importedCount = rhi->GetLiveResourceCount();
+
+	{
+		std::shared_ptr<RHIRenderGraphDevice> device = std::make_shared<RHIRenderGraphDevice>(rhi);
+		RenderTargetPool pool(device);
+		RenderGraph graph;
+
+		for (int frame = 0; frame < 3; frame++)
+		{
+			graph.Reset();
+			device->ClearImports();
+			context.Reset();
+
+			RenderGraphResource backBuffer = graph.ImportTexture("Back Buffer", MakeDesc(64, 32),
+				device->Import(backBufferRTV, RHIView(), RHIView(), 64, 32));
+			RenderGraphTextureDesc depthDesc = MakeDesc(64, 32);
+			depthDesc.Format = 40;	// DXGI_FORMAT_D32_FLOAT
+			depthDesc.BindFlags = RENDER_GRAPH_BIND_DEPTH_STENCIL | RENDER_GRAPH_BIND_SHADER_RESOURCE;
+			RenderGraphResource scene = graph.CreateTexture("Scene", MakeDesc(64, 32));
+			RenderGraphResource depth = graph.CreateTexture("Depth", depthDesc);
+
+			RHIView sceneSRV;
+			RHIView depthDSV;
+			uint32_t draw = graph.AddPass("Draw", 0);
+			static const float black[4] = { 0, 0, 0, 1 };
+			scene = graph.WriteRenderTarget(draw, scene, RENDER_GRAPH_LOAD_CLEAR, black);
+			depth = graph.WriteDepthStencil(draw, depth, RENDER_GRAPH_LOAD_CLEAR);
+
+			uint32_t present = graph.AddPass("Present", [&](const RenderGraphPassResources& resources) {
+				sceneSRV = device->GetView(resources.GetTexture(scene), RHI_VIEW_SHADER_RESOURCE);
+				depthDSV = device->GetView(resources.GetTexture(depth), RHI_VIEW_DEPTH_STENCIL);
+			});
+			graph.Read(present, scene);
+			graph.Read(present, depth);
+			graph.WriteRenderTarget(present, backBuffer, RENDER_GRAPH_LOAD_DISCARD);
+
+			CHECK(graph.Compile(&pool));
+			graph.Execute(device.get());
+			pool.EndFrame();
+
+			// Both passes bind targets and a viewport, and the
+			// draw pass clears its two
+			CHECK(context.GetCallCount(NULL_RHI_CALL_SET_RENDER_TARGETS) == 2);
+			CHECK(context.GetCallCount(NULL_RHI_CALL_SET_VIEWPORT) == 2);
+			CHECK(context.GetCallCount(NULL_RHI_CALL_CLEAR) == 2);
+			CHECK(sceneSRV.IsValid() && depthDSV.IsValid());
+			CHECK(context.GetLog().size() == 6 && context.GetLog()[2].Resource == depthDSV.Id);
+
+			// A color target and a readable depth buffer: two
+			// textures and four views, made on the first frame only
+			CHECK(rhi->GetLiveResourceCount() == importedCount + 6);
+			CHECK(device->GetTextureCount() == 2);
+		}
+		CHECK(pool.GetCreatedCount() == 2);
+
+		// Views a texture wasn't made with are empty
+		uint32_t imported = device->Import(backBufferRTV, RHIView(), RHIView(), 64, 32);
+		CHECK(device->GetView(imported, RHI_VIEW_RENDER_TARGET).Id == backBufferRTV.Id);
+		CHECK(!device->GetView(imported, RHI_VIEW_SHADER_RESOURCE).IsValid());
+
+		// A texture the device can't make leaves nothing behind
+		RenderGraphTextureDesc bad;
+		uint32_t texture = UINT32_MAX;
+		CHECK(!device->CreateTexture(bad, texture));
+		CHECK(rhi->GetLiveResourceCount() == importedCount + 6);
+	}
+
+	// The pool released everything it made, and nothing else
+	CHECK(rhi->GetLiveResourceCount() == importedCount);
+	CHECK(rhi->GetInvalidDestroyCount() == 0);
+	rhi->Destroy(backBufferRTV);
+	rhi->Destroy(backBufferTexture);
+}
+
+int main()
+{
+	TestCulling();
+	TestOrdering();
+	TestWriteAfterCulledWriter();
+	TestAliasing();
+	TestTransitionsAndTargets();
+	TestErrors();
+	TestPoolReuse();
+	TestPoolAging();
+	TestPoolBudget();
+	TestOnRHIDevice();
+	return TestResult();
+}
@@ -0,0 +1,172 @@
+#include "RenderTargetPool.h"
+
+RenderTargetPool::RenderTargetPool(std::shared_ptr<RenderGraphDevice> device, uint32_t maxUnusedFrames) :
+	device(device),
+	maxUnusedFrames(maxUnusedFrames),
+	memoryBudget(0),
+	frame(0),
+	createdCount(0),
+	releasedCount(0)
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+	// Borrowed ones too - nobody can use them after this
+	for (const Entry& entry : entries)
+		device->ReleaseTexture(entry.DeviceTexture);
+}
+
+// --------------------------------------------------------
+// Hands out a free texture with a matching desc, or makes
+// one.  Of the matches, the most recently used one is picked
+// so the rest keep aging and eventually go away.
+// --------------------------------------------------------
+bool RenderTargetPool::Acquire(const RenderGraphTextureDesc& desc, uint32_t& texture)
+{
+	Entry* best = 0;
+	for (Entry& entry : entries)
+	{
+		if (entry.Borrowed || !(entry.Desc == desc))
+			continue;
+
+		if (!best || entry.LastUsedFrame > best->LastUsedFrame)
+			best = &entry;
+	}
+
+	if (!best)
+	{
+		Entry entry;
+		entry.Desc = desc;
+		if (!device->CreateTexture(desc, entry.DeviceTexture))
+			return false;
+
+		createdCount++;
+		entries.push_back(entry);
+		best = &entries.back();
+	}
+
+	best->Borrowed = true;
+	best->LastUsedFrame = frame;
+	texture = best->DeviceTexture;
+	return true;
+}
+
+// --------------------------------------------------------
+// Returns a borrowed texture (it's free to hand out again
+// straight away, even in the same frame)
+// --------------------------------------------------------
+void RenderTargetPool::Release(uint32_t texture)
+{
+	for (Entry& entry : entries)
+	{
+		if (entry.Borrowed && entry.DeviceTexture == texture)
+		{
+			entry.Borrowed = false;
+			entry.LastUsedFrame = frame;
+			return;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Releases free textures that have sat unused for too long,
+// then the oldest free ones while over the memory budget
+// --------------------------------------------------------
+void RenderTargetPool::EndFrame()
+{
+	for (size_t i = entries.size(); i-- > 0;)
+	{
+		if (!entries[i].Borrowed && frame - entries[i].LastUsedFrame >= maxUnusedFrames)
+			ReleaseEntry(i);
+	}
+
+	if (memoryBudget > 0)
+	{
+		uint64_t usage = GetMemoryUsage();
+		while (usage > memoryBudget)
+		{
+			size_t oldest = entries.size();
+			for (size_t i = 0; i < entries.size(); i++)
+			{
+				if (!entries[i].Borrowed && (oldest == entries.size() || entries[i].LastUsedFrame < entries[oldest].LastUsedFrame))
+					oldest = i;
+			}
+
+			// Everything left is borrowed
+			if (oldest == entries.size())
+				break;
+
+			usage -= GetTextureBytes(entries[oldest].Desc);
+			ReleaseEntry(oldest);
+		}
+	}
+
+	frame++;
+}
+
+void RenderTargetPool::Trim()
+{
+	for (size_t i = entries.size(); i-- > 0;)
+	{
+		if (!entries[i].Borrowed)
+			ReleaseEntry(i);
+	}
+}
+
+void RenderTargetPool::ReleaseEntry(size_t index)
+{
+	device->ReleaseTexture(entries[index].DeviceTexture);
+	entries.erase(entries.begin() + index);
+	releasedCount++;
+}
+
+// --------------------------------------------------------
+// Sizes of the formats render targets tend to use, by their
+// DXGI_FORMAT value.  Anything else counts as 4 bytes.
+// --------------------------------------------------------
+uint32_t RenderTargetPool::GetBytesPerPixel(uint32_t format)
+{
+	switch (format)
+	{
+	case 2:		// R32G32B32A32_FLOAT
+		return 16;
+	case 10:	// R16G16B16A16_FLOAT
+	case 16:	// R32G32_FLOAT
+		return 8;
+	case 49:	// R8G8_UNORM
+	case 54:	// R16_FLOAT
+		return 2;
+	case 61:	// R8_UNORM
+		return 1;
+	default:	// R8G8B8A8, R11G11B10, R32, D24S8, D32...
+		return 4;
+	}
+}
+
+uint64_t RenderTargetPool::GetTextureBytes(const RenderGraphTextureDesc& desc)
+{
+	return (uint64_t)desc.Width * desc.Height * GetBytesPerPixel(desc.Format);
+}
+
+// --------------------------------------------------------
+// Stats
+// --------------------------------------------------------
+uint32_t RenderTargetPool::GetBorrowedCount() const
+{
+	uint32_t count = 0;
+	for (const Entry& entry : entries)
+	{
+		if (entry.Borrowed)
+			count++;
+	}
+	return count;
+}
+
+uint64_t RenderTargetPool::GetMemoryUsage() const
+{
+	uint64_t bytes = 0;
+	for (const Entry& entry : entries)
+		bytes += GetTextureBytes(entry.Desc);
+	return bytes;
+}
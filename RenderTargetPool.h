@@ -0,0 +1,79 @@
+#pragma once
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "RenderGraph.h"
+
+// Frames a pooled texture can sit unused before it's released
+#define RENDER_TARGET_POOL_MAX_UNUSED_FRAMES 60
+
+// --------------------------------------------------------
+// Device textures kept around for reuse, looked up by their
+// desc (size, format & bind flags).
+//
+// Whoever needs a target borrows one for the frame with
+// Acquire() and hands it back with Release().  Free textures
+// age each EndFrame() and are released once they've gone
+// unused for too long, or when the free ones take up more
+// memory than the budget allows (oldest first).  Textures
+// that are still borrowed are never released.
+//
+// Sizes that come and go (like while dragging the window
+// edge) get their old textures back instead of making new
+// ones, for as long as those are still pooled.
+// --------------------------------------------------------
+class RenderTargetPool
+{
+public:
+	RenderTargetPool(std::shared_ptr<RenderGraphDevice> device, uint32_t maxUnusedFrames = RENDER_TARGET_POOL_MAX_UNUSED_FRAMES);
+	~RenderTargetPool();
+
+	// Borrowing
+	bool Acquire(const RenderGraphTextureDesc& desc, uint32_t& texture);
+	void Release(uint32_t texture);
+
+	// Ages free textures & releases the stale ones
+	void EndFrame();
+
+	// Releases every texture that isn't borrowed
+	void Trim();
+
+	// Policy (a budget of 0 means no limit)
+	void SetMaxUnusedFrames(uint32_t frames) { maxUnusedFrames = frames; }
+	void SetMemoryBudget(uint64_t bytes) { memoryBudget = bytes; }
+
+	// Rough memory use of a texture (formats are DXGI_FORMAT values)
+	static uint32_t GetBytesPerPixel(uint32_t format);
+	static uint64_t GetTextureBytes(const RenderGraphTextureDesc& desc);
+
+	// Stats
+	uint32_t GetTextureCount() const { return (uint32_t)entries.size(); }
+	uint32_t GetBorrowedCount() const;
+	uint64_t GetMemoryUsage() const;
+	uint32_t GetFrame() const { return frame; }
+	uint32_t GetCreatedCount() const { return createdCount; }
+	uint32_t GetReleasedCount() const { return releasedCount; }
+
+private:
+	struct Entry
+	{
+		RenderGraphTextureDesc Desc;
+		uint32_t DeviceTexture = 0;
+		uint32_t LastUsedFrame = 0;
+		bool Borrowed = false;
+	};
+
+	void ReleaseEntry(size_t index);
+
+	std::shared_ptr<RenderGraphDevice> device;
+	std::vector<Entry> entries;
+
+	uint32_t maxUnusedFrames;
+	uint64_t memoryBudget;
+	uint32_t frame;
+
+	uint32_t createdCount;
+	uint32_t releasedCount;
+};
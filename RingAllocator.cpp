@@ -0,0 +1,135 @@
+#include "RingAllocator.h"
+
+// Constructor
+//  - Alignment must be a power of two, and the capacity is
+//    rounded down to a multiple of it
+RingAllocator::RingAllocator(unsigned int capacity, unsigned int alignment) :
+	alignment(alignment == 0 ? 1 : alignment),
+	head(0),
+	usedBytes(0),
+	currentFrameSize(0)
+{
+	this->capacity = capacity - (capacity % this->alignment);
+}
+
+// Destructor
+RingAllocator::~RingAllocator()
+{
+}
+
+// --------------------------------------------------------
+// Reserves an aligned block of the ring
+//
+// size    - Number of bytes requested
+// offset  - Receives the byte offset of the block
+// wrapped - Receives whether the ring wrapped back to zero
+//           to make room (the caller may want to discard)
+//
+// Returns false if the space is still in use by frames
+// that haven't completed, in which case nothing changes
+// --------------------------------------------------------
+bool RingAllocator::Allocate(unsigned int size, unsigned int* offset, bool* wrapped)
+{
+	if (size == 0 || capacity == 0)
+		return false;
+
+	// Everything is handed out in aligned chunks
+	unsigned int alignedSize = AlignUp(size, alignment);
+	if (alignedSize == 0 || alignedSize > capacity)
+		return false;
+
+	// If the block won't fit before the end, the tail of the
+	// ring is wasted and we start over at the beginning
+	unsigned int padding = 0;
+	bool wrap = false;
+	if (head + alignedSize > capacity)
+	{
+		padding = capacity - head;
+		wrap = true;
+	}
+
+	// Is there enough free space that the GPU is done with?
+	if (usedBytes + padding + alignedSize > capacity)
+		return false;
+
+	if (wrap)
+		head = 0;
+
+	*offset = head;
+	if (wrapped) *wrapped = wrap;
+
+	head += alignedSize;
+	usedBytes += padding + alignedSize;
+	currentFrameSize += padding + alignedSize;
+	return true;
+}
+
+// --------------------------------------------------------
+// Marks everything allocated since the last call as
+// belonging to the given fence value.  Fence values are
+// expected to increase every frame.
+// --------------------------------------------------------
+void RingAllocator::EndFrame(unsigned long long fenceValue)
+{
+	framesInFlight.push_back({ fenceValue, currentFrameSize });
+	currentFrameSize = 0;
+}
+
+// --------------------------------------------------------
+// Frees the space of every frame whose fence value has
+// been reached, oldest first
+// --------------------------------------------------------
+void RingAllocator::ReleaseCompletedFrames(unsigned long long completedFenceValue)
+{
+	while (!framesInFlight.empty() &&
+		framesInFlight.front().FenceValue <= completedFenceValue)
+	{
+		usedBytes -= framesInFlight.front().Size;
+		framesInFlight.pop_front();
+	}
+}
+
+// Forgets every allocation (only safe once the GPU is idle)
+void RingAllocator::Reset()
+{
+	framesInFlight.clear();
+	head = 0;
+	usedBytes = 0;
+	currentFrameSize = 0;
+}
+
+// Get capacity in bytes
+unsigned int RingAllocator::GetCapacity()
+{
+	return capacity;
+}
+
+// Get allocation alignment
+unsigned int RingAllocator::GetAlignment()
+{
+	return alignment;
+}
+
+// Get the current write offset
+unsigned int RingAllocator::GetHead()
+{
+	return head;
+}
+
+// Get the number of bytes not yet retired (including padding)
+unsigned int RingAllocator::GetUsedBytes()
+{
+	return usedBytes;
+}
+
+// Get the number of frames waiting on their fence
+unsigned int RingAllocator::GetFramesInFlight()
+{
+	return (unsigned int)framesInFlight.size();
+}
+
+// Rounds a value up to a power of two alignment
+unsigned int RingAllocator::AlignUp(unsigned int value, unsigned int alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <deque>
+
+// --------------------------------------------------------
+// Linear ring allocator for sub-allocating transient data
+// (like per-draw constants) out of one large buffer.
+//
+// This only handles the bookkeeping - offsets, alignment,
+// wrapping and fences - so it has no Direct3D dependency.
+// Allocations made during a frame are owned by that frame
+// until the fence value passed to EndFrame() completes.
+// --------------------------------------------------------
+class RingAllocator
+{
+public:
+	RingAllocator(unsigned int capacity, unsigned int alignment = 256);
+	~RingAllocator();
+
+	// Allocation
+	bool Allocate(unsigned int size, unsigned int* offset, bool* wrapped);
+
+	// Frame fencing
+	void EndFrame(unsigned long long fenceValue);
+	void ReleaseCompletedFrames(unsigned long long completedFenceValue);
+	void Reset();
+
+	// Getters
+	unsigned int GetCapacity();
+	unsigned int GetAlignment();
+	unsigned int GetHead();
+	unsigned int GetUsedBytes();
+	unsigned int GetFramesInFlight();
+
+	// Helpers
+	static unsigned int AlignUp(unsigned int value, unsigned int alignment);
+
+private:
+
+	// Everything allocated during one frame, retired as a unit
+	struct FrameMarker
+	{
+		unsigned long long FenceValue;
+		unsigned int Size;
+	};
+
+	unsigned int capacity;
+	unsigned int alignment;
+
+	// Current write position and total bytes not yet retired
+	unsigned int head;
+	unsigned int usedBytes;
+
+	// Bytes handed out since the last EndFrame()
+	unsigned int currentFrameSize;
+
+	std::deque<FrameMarker> framesInFlight;
+};
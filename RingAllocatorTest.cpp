@@ -0,0 +1,212 @@
+// --------------------------------------------------------
+// Tests RingAllocator's bookkeeping: alignment, wrapping
+// (and the padding it wastes), a full ring, and frames
+// being released in order as their fences complete.
+// --------------------------------------------------------
+#include "RingAllocator.h"
+#include "TestCheck.h"
+
+static void TestAlignUp()
+{
+	CHECK(RingAllocator::AlignUp(0, 256) == 0);
+	CHECK(RingAllocator::AlignUp(1, 256) == 256);
+	CHECK(RingAllocator::AlignUp(256, 256) == 256);
+	CHECK(RingAllocator::AlignUp(257, 256) == 512);
+	CHECK(RingAllocator::AlignUp(5, 1) == 5);
+	CHECK(RingAllocator::AlignUp(3, 4) == 4);
+
+	// Too big to align wraps to 0, which Allocate() refuses
+	CHECK(RingAllocator::AlignUp(0xFFFFFFFFu, 256) == 0);
+}
+
+static void TestConstruction()
+{
+	// Capacity is rounded down to the alignment
+	RingAllocator ring(1000, 256);
+	CHECK(ring.GetCapacity() == 768);
+	CHECK(ring.GetAlignment() == 256);
+
+	RingAllocator unaligned(1000, 0);
+	CHECK(unaligned.GetAlignment() == 1);
+	CHECK(unaligned.GetCapacity() == 1000);
+
+	// Smaller than one aligned block - nothing fits
+	RingAllocator tiny(100, 256);
+	unsigned int offset = 0;
+	CHECK(tiny.GetCapacity() == 0);
+	CHECK(!tiny.Allocate(1, &offset, 0));
+}
+
+static void TestAlignment()
+{
+	RingAllocator ring(4096, 256);
+	unsigned int offset = 1;
+	bool wrapped = true;
+
+	CHECK(ring.Allocate(1, &offset, &wrapped));
+	CHECK(offset == 0 && !wrapped);
+	CHECK(ring.Allocate(300, &offset, &wrapped));
+	CHECK(offset == 256 && !wrapped);
+	CHECK(ring.Allocate(256, &offset, &wrapped));
+	CHECK(offset == 768 && !wrapped);
+	CHECK(ring.GetHead() == 1024);
+	CHECK(ring.GetUsedBytes() == 1024);
+
+	// Nothing for nothing, or for more than the ring
+	CHECK(!ring.Allocate(0, &offset, &wrapped));
+	CHECK(!ring.Allocate(4097, &offset, &wrapped));
+	CHECK(!ring.Allocate(0xFFFFFFFFu, &offset, &wrapped));
+	CHECK(ring.GetUsedBytes() == 1024);
+}
+
+static void TestWrapWithPadding()
+{
+	RingAllocator ring(1024, 256);
+	unsigned int offset = 0;
+	bool wrapped = false;
+
+	// Frame 1 takes [0, 512), frame 2 [512, 768)
+	CHECK(ring.Allocate(300, &offset, &wrapped) && offset == 0);
+	ring.EndFrame(1);
+	CHECK(ring.Allocate(256, &offset, &wrapped) && offset == 512);
+	ring.EndFrame(2);
+	ring.ReleaseCompletedFrames(1);
+	CHECK(ring.GetUsedBytes() == 256);
+
+	// 512 bytes don't fit in the 256 left at the end, so that
+	// tail is wasted and the block starts over at 0
+	CHECK(ring.Allocate(512, &offset, &wrapped));
+	CHECK(offset == 0 && wrapped);
+	CHECK(ring.GetHead() == 512);
+	CHECK(ring.GetUsedBytes() == 1024);
+	ring.EndFrame(3);
+
+	// The padding belongs to the frame that wrapped, so it's
+	// only freed with that frame
+	ring.ReleaseCompletedFrames(2);
+	CHECK(ring.GetUsedBytes() == 768);
+	ring.ReleaseCompletedFrames(3);
+	CHECK(ring.GetUsedBytes() == 0);
+
+	// A block that exactly reaches the end doesn't wrap
+	CHECK(ring.Allocate(512, &offset, &wrapped));
+	CHECK(offset == 512 && !wrapped);
+	CHECK(ring.GetHead() == 1024);
+
+	// ...but the next one does, with no padding
+	CHECK(ring.Allocate(256, &offset, &wrapped));
+	CHECK(offset == 0 && wrapped);
+	CHECK(ring.GetUsedBytes() == 768);
+}
+
+static void TestFullRing()
+{
+	RingAllocator ring(1024, 256);
+	unsigned int offset = 0;
+	bool wrapped = false;
+
+	CHECK(ring.Allocate(512, &offset, &wrapped));
+	ring.EndFrame(1);
+	CHECK(ring.Allocate(512, &offset, &wrapped));
+	ring.EndFrame(2);
+	CHECK(ring.GetUsedBytes() == 1024);
+
+	// Full - fails, and changes nothing
+	offset = 12345;
+	wrapped = false;
+	CHECK(!ring.Allocate(1, &offset, &wrapped));
+	CHECK(offset == 12345 && !wrapped);
+	CHECK(ring.GetHead() == 1024);
+	CHECK(ring.GetUsedBytes() == 1024);
+
+	// Frame 1 finishing frees just enough
+	ring.ReleaseCompletedFrames(1);
+	CHECK(ring.Allocate(512, &offset, &wrapped));
+	CHECK(offset == 0 && wrapped);
+	CHECK(!ring.Allocate(1, &offset, &wrapped));
+
+	// Room that's only there if the padding isn't counted
+	// isn't enough: [256, 1024) is in use after this...
+	ring.Reset();
+	CHECK(ring.Allocate(256, &offset, &wrapped));
+	ring.EndFrame(10);
+	CHECK(ring.Allocate(512, &offset, &wrapped) && offset == 256);
+	ring.EndFrame(11);
+	ring.ReleaseCompletedFrames(10);
+
+	// ...so 256 bytes are free at the end and 256 at the start,
+	// but 512 don't fit in either
+	CHECK(!ring.Allocate(512, &offset, &wrapped));
+	CHECK(ring.Allocate(256, &offset, &wrapped) && offset == 768 && !wrapped);
+}
+
+static void TestReleaseOrder()
+{
+	RingAllocator ring(4096, 256);
+	unsigned int offset = 0;
+
+	// Frames of 1, 2 and 3 blocks
+	for (unsigned long long fence = 1; fence <= 3; fence++)
+	{
+		for (unsigned long long i = 0; i < fence; i++)
+			CHECK(ring.Allocate(256, &offset, 0));
+		ring.EndFrame(fence);
+	}
+	CHECK(ring.GetFramesInFlight() == 3);
+	CHECK(ring.GetUsedBytes() == 6 * 256);
+
+	// Nothing has finished yet
+	ring.ReleaseCompletedFrames(0);
+	CHECK(ring.GetFramesInFlight() == 3);
+	CHECK(ring.GetUsedBytes() == 6 * 256);
+
+	// Oldest first, and every frame up to the fence at once
+	ring.ReleaseCompletedFrames(2);
+	CHECK(ring.GetFramesInFlight() == 1);
+	CHECK(ring.GetUsedBytes() == 3 * 256);
+
+	// Releasing the same fence again does nothing
+	ring.ReleaseCompletedFrames(2);
+	CHECK(ring.GetFramesInFlight() == 1);
+	CHECK(ring.GetUsedBytes() == 3 * 256);
+
+	// Fences can jump
+	ring.ReleaseCompletedFrames(100);
+	CHECK(ring.GetFramesInFlight() == 0);
+	CHECK(ring.GetUsedBytes() == 0);
+
+	// A frame with nothing allocated still waits its turn
+	ring.EndFrame(101);
+	CHECK(ring.Allocate(256, &offset, 0));
+	ring.EndFrame(102);
+	ring.ReleaseCompletedFrames(101);
+	CHECK(ring.GetFramesInFlight() == 1);
+	CHECK(ring.GetUsedBytes() == 256);
+}
+
+static void TestReset()
+{
+	RingAllocator ring(1024, 256);
+	unsigned int offset = 0;
+	CHECK(ring.Allocate(700, &offset, 0));
+	ring.EndFrame(1);
+	CHECK(ring.Allocate(100, &offset, 0));
+
+	ring.Reset();
+	CHECK(ring.GetHead() == 0);
+	CHECK(ring.GetUsedBytes() == 0);
+	CHECK(ring.GetFramesInFlight() == 0);
+	CHECK(ring.Allocate(1024, &offset, 0) && offset == 0);
+}
+
+int main()
+{
+	TestAlignUp();
+	TestConstruction();
+	TestAlignment();
+	TestWrapWithPadding();
+	TestFullRing();
+	TestReleaseOrder();
+	TestReset();
+	return TestResult();
+}
@@ -0,0 +1,274 @@
+// --------------------------------------------------------
+// Moves lots of entities one step, stored the ways a scene
+// could store them, and prints how many million entities a
+// second each gets through:
+//
+//  - objects:  one big object per entity, in an array (every
+//              field an entity might have, used or not)
+//  - pointers: the same objects allocated one by one, in
+//              a shuffled list of pointers (entities made and
+//              destroyed over time end up like this)
+//  - entity:   a SceneWorld, with ForEach calling a function
+//              per entity
+//  - chunks:   a SceneWorld, with ForEachChunk looping over
+//              each chunk's columns (loops the compiler can
+//              vectorize - check with -fopt-info-vec)
+//  - schedule: a SceneSchedule running the step's systems,
+//              chunks split across the job system's threads
+//              and systems that don't conflict side by side
+//
+// A step moves everything by its velocity, and cools down
+// anything with a cooldown.  Entities are spread over a few
+// archetypes (not all have a cooldown, some have extra
+// components), so queries skip some and match several.
+// Every way's positions are summed and checked against the
+// others afterwards.
+//
+// Built by CMakeLists.txt:
+//
+//   SceneBenchmarkMain --entities 1000000 --runs 20 --threads 4
+// --------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+#include "SceneWorld.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Seconds each step moves things along by
+#define BENCH_STEP (1.0f / 60.0f)
+
+struct BenchPosition
+{
+	float X, Y, Z;
+};
+
+struct BenchVelocity
+{
+	float X, Y, Z;
+};
+
+struct BenchCooldown
+{
+	float Remaining;
+};
+
+// Components only some entities have, that no step reads
+struct BenchName
+{
+	char Text[24];
+};
+
+struct BenchBounds
+{
+	float Min[3];
+	float Max[3];
+};
+
+// Every component at once, as one object
+struct BenchObject
+{
+	BenchPosition Position;
+	BenchVelocity Velocity;
+	BenchCooldown Cooldown;
+	bool HasCooldown;
+	BenchName Name;
+	BenchBounds Bounds;
+	float World[16];
+};
+
+static void StepObject(BenchObject& object)
+{
+	object.Position.X += object.Velocity.X * BENCH_STEP;
+	object.Position.Y += object.Velocity.Y * BENCH_STEP;
+	object.Position.Z += object.Velocity.Z * BENCH_STEP;
+	if (object.HasCooldown)
+		object.Cooldown.Remaining = object.Cooldown.Remaining > BENCH_STEP ? object.Cooldown.Remaining - BENCH_STEP : 0.0f;
+}
+
+// The loops every world way runs, over one chunk's columns
+static void MoveChunk(uint32_t count, BenchPosition* positions, const BenchVelocity* velocities)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		positions[i].X += velocities[i].X * BENCH_STEP;
+		positions[i].Y += velocities[i].Y * BENCH_STEP;
+		positions[i].Z += velocities[i].Z * BENCH_STEP;
+	}
+}
+
+static void CoolChunk(uint32_t count, BenchCooldown* cooldowns)
+{
+	for (uint32_t i = 0; i < count; i++)
+		cooldowns[i].Remaining = cooldowns[i].Remaining > BENCH_STEP ? cooldowns[i].Remaining - BENCH_STEP : 0.0f;
+}
+
+// Best and average milliseconds per step
+struct BenchTime
+{
+	double BestMs;
+	double AverageMs;
+};
+
+template<typename Step>
+static BenchTime Time(uint32_t runs, const Step& step)
+{
+	// Once to warm up
+	step();
+
+	BenchTime time = { 1e30, 0 };
+	for (uint32_t r = 0; r < runs; r++)
+	{
+		auto start = Clock::now();
+		step();
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		time.BestMs = ms < time.BestMs ? ms : time.BestMs;
+		time.AverageMs += ms / runs;
+	}
+	return time;
+}
+
+static void PrintTime(const char* name, const BenchTime& time, uint32_t entityCount)
+{
+	printf("%-9s %8.3f  %10.3f  %9.2f  %10.1f\n",
+		name, time.BestMs, time.AverageMs,
+		time.BestMs * 1e6 / entityCount,
+		entityCount / (time.BestMs * 1e3));
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t entityCount = 1000000;
+	uint32_t runs = 20;
+	uint32_t threadCount = std::thread::hardware_concurrency();
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string name = argv[i];
+		if (name == "--entities") entityCount = (uint32_t)atoi(argv[i + 1]);
+		else if (name == "--runs") runs = (uint32_t)atoi(argv[i + 1]);
+		else if (name == "--threads") threadCount = (uint32_t)atoi(argv[i + 1]);
+	}
+	if (entityCount == 0 || runs == 0)
+	{
+		printf("Usage: SceneBenchmarkMain [--entities count] [--runs count] [--threads count]\n");
+		return 1;
+	}
+	if (threadCount == 0)
+		threadCount = 1;
+
+	// The same entities every way.  A quarter each: just
+	// moving, moving with a cooldown, and both of those with
+	// a name & bounds too.
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> speed(-5.0f, 5.0f);
+	std::vector<BenchObject> objects(entityCount);
+	SceneWorld world;
+	for (uint32_t i = 0; i < entityCount; i++)
+	{
+		BenchObject& object = objects[i];
+		object = BenchObject{};
+		object.Position = { (float)(i % 1000), 0.0f, (float)(i / 1000) };
+		object.Velocity = { speed(random), speed(random), speed(random) };
+		object.Cooldown = { (float)(i % 100) * 0.1f };
+		object.HasCooldown = i % 2 == 1;
+
+		switch (i % 4)
+		{
+		case 0: world.Create(object.Position, object.Velocity); break;
+		case 1: world.Create(object.Position, object.Velocity, object.Cooldown); break;
+		case 2: world.Create(object.Position, object.Velocity, object.Name, object.Bounds); break;
+		case 3: world.Create(object.Position, object.Velocity, object.Cooldown, object.Name, object.Bounds); break;
+		}
+	}
+
+	std::vector<std::unique_ptr<BenchObject>> pointers;
+	pointers.reserve(entityCount);
+	for (const BenchObject& object : objects)
+		pointers.push_back(std::make_unique<BenchObject>(object));
+	std::shuffle(pointers.begin(), pointers.end(), random);
+
+	// The step as systems: moving and cooling touch different
+	// components, so they run side by side
+	SceneSchedule schedule;
+	schedule.AddSystem("Move", GetSceneComponentMask<BenchVelocity>(), GetSceneComponentMask<BenchPosition>(),
+		[](const SceneChunkView& chunk, uint32_t thread) {
+			MoveChunk(chunk.Count, chunk.Get<BenchPosition>(), chunk.Get<BenchVelocity>());
+		});
+	schedule.AddSystem("Cool", 0, GetSceneComponentMask<BenchCooldown>(),
+		[](const SceneChunkView& chunk, uint32_t thread) {
+			CoolChunk(chunk.Count, chunk.Get<BenchCooldown>());
+		});
+	JobSystem jobs(threadCount - 1);
+
+	// Each way steps its own copy, so they all end up in the
+	// same place: the world is stepped by three of them, so
+	// the others step that many times over
+	BenchTime objectTime = Time(runs, [&]() {
+		for (BenchObject& object : objects)
+			StepObject(object);
+	});
+	BenchTime pointerTime = Time(runs, [&]() {
+		for (std::unique_ptr<BenchObject>& object : pointers)
+			StepObject(*object);
+	});
+	BenchTime entityTime = Time(runs, [&]() {
+		world.ForEach<BenchPosition, const BenchVelocity>([](BenchPosition& position, const BenchVelocity& velocity) {
+			position.X += velocity.X * BENCH_STEP;
+			position.Y += velocity.Y * BENCH_STEP;
+			position.Z += velocity.Z * BENCH_STEP;
+		});
+		world.ForEach<BenchCooldown>([](BenchCooldown& cooldown) {
+			cooldown.Remaining = cooldown.Remaining > BENCH_STEP ? cooldown.Remaining - BENCH_STEP : 0.0f;
+		});
+	});
+	BenchTime chunkTime = Time(runs, [&]() {
+		world.ForEachChunk<BenchPosition, const BenchVelocity>(MoveChunk);
+		world.ForEachChunk<BenchCooldown>(CoolChunk);
+	});
+	BenchTime scheduleTime = Time(runs, [&]() { schedule.Run(world, &jobs); });
+
+	for (uint32_t r = 0; r < (runs + 1) * 2; r++)
+	{
+		for (BenchObject& object : objects)
+			StepObject(object);
+		for (std::unique_ptr<BenchObject>& object : pointers)
+			StepObject(*object);
+	}
+
+	// Sums in a different order each way (the world's
+	// archetypes don't keep entity order), so they're summed
+	// as doubles and allowed some rounding
+	double objectSum = 0;
+	double pointerSum = 0;
+	double worldSum = 0;
+	for (const BenchObject& object : objects)
+		objectSum += (double)object.Position.X + object.Position.Y + object.Position.Z + (object.HasCooldown ? object.Cooldown.Remaining : 0.0f);
+	for (const std::unique_ptr<BenchObject>& object : pointers)
+		pointerSum += (double)object->Position.X + object->Position.Y + object->Position.Z + (object->HasCooldown ? object->Cooldown.Remaining : 0.0f);
+	world.ForEach<BenchPosition>([&](BenchPosition& position) { worldSum += (double)position.X + position.Y + position.Z; });
+	world.ForEach<BenchCooldown>([&](BenchCooldown& cooldown) { worldSum += cooldown.Remaining; });
+
+	printf("%u entities in %u archetypes, %u threads, best of %u runs\n\n", world.GetEntityCount(), world.GetArchetypeCount(), jobs.GetThreadCount(), runs);
+	printf("layout     best ms  average ms  ns/entity  M entity/s\n");
+	PrintTime("objects", objectTime, entityCount);
+	PrintTime("pointers", pointerTime, entityCount);
+	PrintTime("entity", entityTime, entityCount);
+	PrintTime("chunks", chunkTime, entityCount);
+	PrintTime("schedule", scheduleTime, entityCount);
+
+	double tolerance = 1e-6 * (objectSum < 0 ? -objectSum : objectSum) + 1.0;
+	bool same =
+		(objectSum - pointerSum) * (objectSum - pointerSum) < tolerance * tolerance &&
+		(objectSum - worldSum) * (objectSum - worldSum) < tolerance * tolerance;
+	printf("\nPositions %s (%.3f, %.3f, %.3f)\n", same ? "match" : "DIFFER", objectSum, pointerSum, worldSum);
+
+	return same ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+// --------------------------------------------------------
+// Turns a text scene (see ParseSceneText) into the binary
+// scene file the game loads, then loads the result back to
+// check it:
+//
+//   SceneExporterMain Assets/Scenes/DemoScene.txt Assets/Scenes/DemoScene.scene
+//
+// Built by CMakeLists.txt.
+// --------------------------------------------------------
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "SceneFile.h"
+#include "SceneFileWriter.h"
+
+static bool ReadText(const char* path, std::string& text)
+{
+	FILE* file = fopen(path, "rb");
+	if (!file)
+		return false;
+
+	char buffer[64 * 1024];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		text.append(buffer, read);
+
+	bool ok = !ferror(file);
+	fclose(file);
+	return ok;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc != 3)
+	{
+		printf("Usage: %s scene.txt scene.scene\n", argv[0]);
+		return 1;
+	}
+
+	std::string text;
+	if (!ReadText(argv[1], text))
+	{
+		printf("Couldn't read %s\n", argv[1]);
+		return 1;
+	}
+
+	SceneFileWriter writer;
+	std::string error;
+	if (!ParseSceneText(text.c_str(), writer, error))
+	{
+		printf("%s, %s\n", argv[1], error.c_str());
+		return 1;
+	}
+
+	if (!writer.Write(argv[2]))
+	{
+		printf("Couldn't write %s\n", argv[2]);
+		return 1;
+	}
+
+	SceneFile scene;
+	if (!scene.Load(argv[2]))
+	{
+		printf("%s doesn't load back: %s\n", argv[2], scene.GetError().c_str());
+		return 1;
+	}
+
+	const SceneFileHeader& header = scene.GetHeader();
+	printf("Wrote %s (%zu bytes): %u meshes, %u textures, %u materials, %u entities, %u lights, %u cameras, %u sky, %u cells\n",
+		argv[2], scene.GetSize(),
+		header.Meshes.Count, header.Textures.Count, header.Materials.Count,
+		header.Entities.Count, header.Lights.Count, header.Cameras.Count, header.Skies.Count, header.Cells.Count);
+	return 0;
+}
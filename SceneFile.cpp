@@ -0,0 +1,235 @@
+#include "SceneFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// The layout is the file format, so it mustn't change with
+// the compiler
+static_assert(sizeof(SceneFileMaterial) == 32, "Scene file material layout changed");
+static_assert(sizeof(SceneFileEntity) == 64, "Scene file entity layout changed");
+static_assert(sizeof(SceneFileCamera) == 44, "Scene file camera layout changed");
+static_assert(sizeof(SceneFileSky) == 28, "Scene file sky layout changed");
+static_assert(sizeof(Light) == 64, "Scene file light layout changed");
+static_assert(sizeof(SceneFileCell) == 16, "Scene file cell layout changed");
+static_assert(sizeof(SceneFileHeader) == 92, "Scene file header layout changed");
+
+SceneFile::SceneFile() :
+	header(0),
+	size(0),
+	mapping(0)
+#ifdef _WIN32
+	, fileHandle(INVALID_HANDLE_VALUE),
+	mappingHandle(0)
+#endif
+{
+}
+
+SceneFile::~SceneFile()
+{
+	Close();
+}
+
+bool SceneFile::Load(const std::string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return Fail("can't open the file");
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(SceneFileHeader) || fileSize.QuadPart > 0xFFFFFFFF)
+		return Fail("the file is the wrong size");
+
+	mappingHandle = CreateFileMappingA(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+	mapping = mappingHandle ? MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : 0;
+	if (!mapping)
+		return Fail("can't map the file");
+	size = (size_t)fileSize.QuadPart;
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return Fail("can't open the file");
+
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size < (off_t)sizeof(SceneFileHeader) || status.st_size > 0xFFFFFFFF)
+	{
+		close(file);
+		return Fail("the file is the wrong size");
+	}
+
+	// The mapping keeps the file open
+	void* memory = mmap(0, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (memory == MAP_FAILED)
+		return Fail("can't map the file");
+	mapping = memory;
+	size = (size_t)status.st_size;
+#endif
+
+	header = (const SceneFileHeader*)mapping;
+	return Validate();
+}
+
+bool SceneFile::LoadFromMemory(const void* data, size_t dataSize)
+{
+	Close();
+	if (((uintptr_t)data & 3) != 0 || dataSize < sizeof(SceneFileHeader) || dataSize > 0xFFFFFFFF)
+		return Fail("the scene is the wrong size or misaligned");
+
+	header = (const SceneFileHeader*)data;
+	size = dataSize;
+	return Validate();
+}
+
+void SceneFile::Close()
+{
+#ifdef _WIN32
+	if (mapping)
+		UnmapViewOfFile(mapping);
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+	mappingHandle = 0;
+	fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (mapping)
+		munmap(mapping, size);
+#endif
+
+	mapping = 0;
+	header = 0;
+	size = 0;
+}
+
+bool SceneFile::Fail(const char* message)
+{
+	error = message;
+	Close();
+	return false;
+}
+
+// --------------------------------------------------------
+// Checks the header, that every array is in the file, and
+// that every string and index points somewhere real, so
+// nothing using the scene has to.  This is the only pass
+// over the records, and only reads indices.
+// --------------------------------------------------------
+bool SceneFile::Validate()
+{
+	if (header->Magic != SCENE_FILE_MAGIC)
+		return Fail("not a scene file");
+	if (header->Version != SCENE_FILE_VERSION)
+		return Fail("the scene file is from another version");
+	if (header->FileSize != size || header->HeaderSize != sizeof(SceneFileHeader))
+		return Fail("the scene file is truncated");
+
+	// Each array starts on a 4 byte boundary and ends by the
+	// end of the file
+	auto inFile = [this](const void* field, uint32_t offset, uint32_t count, uint32_t stride) {
+		uint64_t start = (uint64_t)((const uint8_t*)field - (const uint8_t*)header) + offset;
+		return start % 4 == 0 && start >= sizeof(SceneFileHeader) && start + (uint64_t)count * stride <= size;
+	};
+	const SceneFileHeader& h = *header;
+	if (!inFile(&h.Strings, h.Strings.Offset, h.Strings.Count, 1) ||
+		!inFile(&h.Meshes, h.Meshes.Offset, h.Meshes.Count, sizeof(SceneFileMesh)) ||
+		!inFile(&h.Textures, h.Textures.Offset, h.Textures.Count, sizeof(SceneFileTexture)) ||
+		!inFile(&h.Materials, h.Materials.Offset, h.Materials.Count, sizeof(SceneFileMaterial)) ||
+		!inFile(&h.Entities, h.Entities.Offset, h.Entities.Count, sizeof(SceneFileEntity)) ||
+		!inFile(&h.Lights, h.Lights.Offset, h.Lights.Count, sizeof(Light)) ||
+		!inFile(&h.Cameras, h.Cameras.Offset, h.Cameras.Count, sizeof(SceneFileCamera)) ||
+		!inFile(&h.Skies, h.Skies.Offset, h.Skies.Count, sizeof(SceneFileSky)) ||
+		!inFile(&h.Cells, h.Cells.Offset, h.Cells.Count, sizeof(SceneFileCell)))
+		return Fail("an array is outside the scene file");
+
+	// Drawing needs something to look through, and the sun -
+	// the last light, which the shadow cascades follow
+	if (h.Cameras.Count == 0)
+		return Fail("the scene has no camera");
+	if (h.Lights.Count == 0)
+		return Fail("the scene has no lights");
+	if (h.Lights[h.Lights.Count - 1].Type != LIGHT_TYPE_DIRECTIONAL)
+		return Fail("the scene's last light isn't a directional sun");
+
+	// Strings are null terminated, and the table ends with one,
+	// so any offset into it is a whole string
+	if (h.Strings.Count == 0 || h.Strings[h.Strings.Count - 1] != 0)
+		return Fail("the string table isn't terminated");
+	auto validString = [&h](SceneFileString str) { return str.Offset < h.Strings.Count; };
+
+	for (uint32_t i = 0; i < h.Meshes.Count; i++)
+	{
+		if (!validString(h.Meshes[i].Path))
+			return Fail("a mesh path is outside the string table");
+	}
+	for (uint32_t i = 0; i < h.Textures.Count; i++)
+	{
+		if (!validString(h.Textures[i].Path))
+			return Fail("a texture path is outside the string table");
+	}
+	for (uint32_t i = 0; i < h.Materials.Count; i++)
+	{
+		for (uint32_t slot = 0; slot < SCENE_FILE_TEXTURE_SLOTS; slot++)
+		{
+			uint32_t texture = h.Materials[i].Textures[slot];
+			if (texture != SCENE_FILE_NONE && texture >= h.Textures.Count)
+				return Fail("a material uses a texture that isn't there");
+		}
+	}
+
+	// Cells split the entity array into runs, in order.  Their
+	// entities are checked as they're streamed in, so a big
+	// world isn't read end to end here.
+	if (h.Cells.Count > 0)
+	{
+		if (!(h.CellSize > 0.0f && h.CellSize < 1e30f))
+			return Fail("the scene's cells have no size");
+
+		uint32_t next = 0;
+		for (uint32_t i = 0; i < h.Cells.Count; i++)
+		{
+			if (h.Cells[i].FirstEntity != next || h.Cells[i].EntityCount > h.Entities.Count - next)
+				return Fail("a cell's entities are out of order");
+			next += h.Cells[i].EntityCount;
+		}
+		if (next != h.Entities.Count)
+			return Fail("some entities aren't in any cell");
+	}
+	else if (!CheckEntities(h.Entities.Get(), h.Entities.Count))
+		return Fail("an entity uses a mesh or material that isn't there");
+
+	if (h.Skies.Count > 1)
+		return Fail("a scene has one sky at most");
+	for (uint32_t i = 0; i < h.Skies.Count; i++)
+	{
+		const SceneFileSky& sky = h.Skies[i];
+		if (sky.Mesh >= h.Meshes.Count)
+			return Fail("the sky uses a mesh that isn't there");
+		for (uint32_t face = 0; face < 6; face++)
+		{
+			if (!validString(sky.Faces[face]))
+				return Fail("a sky face path is outside the string table");
+		}
+	}
+
+	error.clear();
+	return true;
+}
+
+bool SceneFile::CheckEntities(const SceneFileEntity* entities, uint32_t count) const
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (entities[i].Mesh >= header->Meshes.Count || entities[i].Material >= header->Materials.Count)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <stdint.h>
+#include <string>
+
+#include "Lights.h"
+
+// "DSCN", little endian
+#define SCENE_FILE_MAGIC	0x4E435344
+#define SCENE_FILE_VERSION	2
+
+// Marks a texture a material doesn't have, or a scene's
+// missing sky mesh
+#define SCENE_FILE_NONE 0xFFFFFFFF
+
+// Entity flags
+#define SCENE_FILE_ENTITY_STATIC	0x1		// Never moves (its shadow can be cached)
+
+// Material texture slots
+#define SCENE_FILE_TEXTURE_ALBEDO		0
+#define SCENE_FILE_TEXTURE_ROUGHNESS	1
+#define SCENE_FILE_TEXTURE_METALNESS	2
+#define SCENE_FILE_TEXTURE_NORMAL		3
+#define SCENE_FILE_TEXTURE_SLOTS		4
+
+// --------------------------------------------------------
+// A scene as one block of memory, laid out exactly as it's
+// used: a header, then arrays of fixed size records, then a
+// table of strings.  Loading maps the file and checks that
+// everything in it is in bounds - nothing is parsed, copied
+// or fixed up, and pages are only read from disk as they're
+// touched.
+//
+// Arrays are found by offsets from the field that holds
+// them, so a file means the same wherever it's mapped.
+// Strings (asset paths, relative to the Assets folder) are
+// offsets into the string table, and records refer to each
+// other by index.  Everything is 4 byte aligned.
+// --------------------------------------------------------
+
+// Where an array is, relative to this field
+template<typename T>
+struct SceneFileArray
+{
+	uint32_t Offset;
+	uint32_t Count;
+
+	const T* Get() const { return (const T*)((const uint8_t*)this + Offset); }
+	const T& operator[](uint32_t index) const { return Get()[index]; }
+};
+
+// Where a string is in the string table
+struct SceneFileString
+{
+	uint32_t Offset;
+};
+
+struct SceneFileMesh
+{
+	SceneFileString Path;
+};
+
+struct SceneFileTexture
+{
+	SceneFileString Path;
+};
+
+struct SceneFileMaterial
+{
+	DirectX::XMFLOAT3 ColorTint;
+	float Roughness;
+	uint32_t Textures[SCENE_FILE_TEXTURE_SLOTS];	// Indices, by slot
+};
+
+struct SceneFileEntity
+{
+	uint32_t Mesh;
+	uint32_t Material;
+	uint32_t Flags;
+	DirectX::XMFLOAT3 Position;
+	DirectX::XMFLOAT3 PitchYawRoll;
+	DirectX::XMFLOAT3 Scale;
+
+	// Spin about its up axis (radians per second), and how far
+	// it bobs along each axis (scaled by sin(time))
+	float SpinSpeed;
+	DirectX::XMFLOAT3 Bob;
+};
+
+struct SceneFileCamera
+{
+	DirectX::XMFLOAT3 Position;
+	DirectX::XMFLOAT3 PitchYawRoll;
+	float MoveSpeed;
+	float LookSpeed;
+	float FieldOfView;
+	float NearClip;
+	float FarClip;
+};
+
+struct SceneFileSky
+{
+	uint32_t Mesh;
+	SceneFileString Faces[6];	// Right, left, up, down, front, back
+};
+
+// A square of the world on the XZ plane, from (X, Z) *
+// CellSize to (X + 1, Z + 1) * CellSize, and the run of the
+// entity array that's in it
+struct SceneFileCell
+{
+	int32_t X;
+	int32_t Z;
+	uint32_t FirstEntity;
+	uint32_t EntityCount;
+};
+
+struct SceneFileHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t FileSize;
+	uint32_t HeaderSize;
+
+	SceneFileArray<char> Strings;
+	SceneFileArray<SceneFileMesh> Meshes;
+	SceneFileArray<SceneFileTexture> Textures;
+	SceneFileArray<SceneFileMaterial> Materials;
+	SceneFileArray<SceneFileEntity> Entities;
+	SceneFileArray<Light> Lights;	// In draw order, ending with the directional sun that casts shadows
+	SceneFileArray<SceneFileCamera> Cameras;	// At least one
+	SceneFileArray<SceneFileSky> Skies;	// None or one
+
+	// Streamed scenes split every entity into cells, which are
+	// loaded as the camera nears them (see WorldStreamer); the
+	// rest have none, and all their entities load up front
+	float CellSize;
+	SceneFileArray<SceneFileCell> Cells;
+};
+
+// --------------------------------------------------------
+// A scene file, mapped into memory.  Everything it hands
+// out points into the mapping, so it lasts until the file
+// is closed.
+// --------------------------------------------------------
+class SceneFile
+{
+public:
+	SceneFile();
+	~SceneFile();
+
+	SceneFile(const SceneFile&) = delete;
+	SceneFile& operator=(const SceneFile&) = delete;
+
+	// False (and closed) if the file can't be read or isn't a
+	// valid scene; GetError() says why
+	bool Load(const std::string& path);
+
+	// Uses a scene that's already in memory (which must stay
+	// put, and be 4 byte aligned, while it's used)
+	bool LoadFromMemory(const void* data, size_t size);
+
+	void Close();
+
+	// Getters
+	bool IsLoaded() const { return header != 0; }
+	const SceneFileHeader& GetHeader() const { return *header; }
+	const char* GetString(SceneFileString str) const { return header->Strings.Get() + str.Offset; }
+	size_t GetSize() const { return size; }
+	const std::string& GetError() const { return error; }
+
+	// Checks a streamed cell's entities once they're read
+	// (Load() leaves them alone, so they aren't all touched)
+	bool CheckEntities(const SceneFileEntity* entities, uint32_t count) const;
+
+private:
+	bool Validate();
+	bool Fail(const char* message);
+
+	const SceneFileHeader* header;
+	size_t size;
+
+	// The mapping, if Load() made one
+	void* mapping;
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#endif
+
+	std::string error;
+};
@@ -0,0 +1,333 @@
+// --------------------------------------------------------
+// Tests SceneFile and SceneFileWriter:
+//
+//  - a written scene loads back (from memory and from disk)
+//    with every record and string as it went in, and paths
+//    used twice stored once
+//  - streamed scenes group their entities into cells that
+//    cover them all, in order
+//  - text scenes parse into the same records, and a bad line
+//    is turned away
+//  - loading turns away files that are truncated or
+//    misaligned, and any array, string or index that points
+//    outside the file - including cells that don't line up
+//    with the entities - so nothing using a scene has to
+//    check it again
+// --------------------------------------------------------
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "SceneFile.h"
+#include "SceneFileWriter.h"
+#include "TestCheck.h"
+
+static Light MakeLight(int type, float intensity)
+{
+	Light light = {};
+	light.Type = type;
+	light.Direction = DirectX::XMFLOAT3(0, -1, 0);
+	light.Range = 10.0f;
+	light.Intensity = intensity;
+	light.Color = DirectX::XMFLOAT3(1, 0.5f, 0.25f);
+	return light;
+}
+
+static SceneFileEntity MakeEntity(uint32_t mesh, uint32_t material, float x, float z)
+{
+	SceneFileEntity entity = {};
+	entity.Mesh = mesh;
+	entity.Material = material;
+	entity.Position = DirectX::XMFLOAT3(x, 1.0f, z);
+	entity.Scale = DirectX::XMFLOAT3(1, 1, 1);
+	entity.SpinSpeed = x * 0.1f;
+	return entity;
+}
+
+// A small scene with one of everything
+static void BuildScene(SceneFileWriter& writer)
+{
+	uint32_t cube = writer.AddMesh("Meshes/cube.obj");
+	uint32_t sphere = writer.AddMesh("Meshes/sphere.obj");
+	uint32_t albedo = writer.AddTexture("Textures/bronze_albedo.png");
+	uint32_t normals = writer.AddTexture("Textures/bronze_normals.png");
+
+	SceneFileMaterial plain = {};
+	plain.ColorTint = DirectX::XMFLOAT3(1, 1, 1);
+	plain.Roughness = 0.5f;
+	for (uint32_t slot = 0; slot < SCENE_FILE_TEXTURE_SLOTS; slot++)
+		plain.Textures[slot] = SCENE_FILE_NONE;
+	writer.AddMaterial(plain);
+
+	SceneFileMaterial bronze = plain;
+	bronze.Roughness = 0.2f;
+	bronze.Textures[SCENE_FILE_TEXTURE_ALBEDO] = albedo;
+	bronze.Textures[SCENE_FILE_TEXTURE_NORMAL] = normals;
+	writer.AddMaterial(bronze);
+
+	for (int i = 0; i < 10; i++)
+		writer.AddEntity(MakeEntity(i % 2 ? sphere : cube, i % 2, (float)i * 7.0f - 30.0f, (float)(i % 3) * 9.0f));
+
+	writer.AddLight(MakeLight(LIGHT_TYPE_POINT, 2.0f));
+	writer.AddLight(MakeLight(LIGHT_TYPE_DIRECTIONAL, 1.0f));
+
+	SceneFileCamera camera = {};
+	camera.Position = DirectX::XMFLOAT3(0, 2, -10);
+	camera.FieldOfView = 1.0f;
+	camera.NearClip = 0.1f;
+	camera.FarClip = 500.0f;
+	writer.AddCamera(camera);
+
+	const std::string faces[6] = { "Skies/right.png", "Skies/left.png", "Skies/up.png", "Skies/down.png", "Skies/front.png", "Skies/back.png" };
+	writer.SetSky(cube, faces);
+}
+
+// Everything BuildScene() put in is there, as it was
+static void CheckScene(const SceneFile& scene, bool cells)
+{
+	const SceneFileHeader& h = scene.GetHeader();
+	CHECK(h.Meshes.Count == 2 && h.Textures.Count == 2 && h.Materials.Count == 2);
+	CHECK(h.Entities.Count == 10 && h.Lights.Count == 2 && h.Cameras.Count == 1 && h.Skies.Count == 1);
+	CHECK(strcmp(scene.GetString(h.Meshes[1].Path), "Meshes/sphere.obj") == 0);
+	CHECK(strcmp(scene.GetString(h.Textures[0].Path), "Textures/bronze_albedo.png") == 0);
+	CHECK(h.Materials[1].Roughness == 0.2f);
+	CHECK(h.Materials[1].Textures[SCENE_FILE_TEXTURE_NORMAL] == 1);
+	CHECK(h.Materials[0].Textures[SCENE_FILE_TEXTURE_ALBEDO] == SCENE_FILE_NONE);
+	CHECK(h.Lights[0].Type == LIGHT_TYPE_POINT && h.Lights[0].Intensity == 2.0f);
+	CHECK(h.Lights[1].Type == LIGHT_TYPE_DIRECTIONAL);
+	CHECK(h.Cameras[0].FarClip == 500.0f);
+	CHECK(strcmp(scene.GetString(h.Skies[0].Faces[4]), "Skies/front.png") == 0);
+
+	// The sky uses the cube mesh rather than a copy of it
+	CHECK(h.Skies[0].Mesh == 0);
+
+	// Without cells the entities stay in order; with them,
+	// they're all still there (spin was set from x)
+	float spin = 0;
+	bool same = true;
+	for (uint32_t i = 0; i < h.Entities.Count; i++)
+	{
+		const SceneFileEntity& entity = h.Entities[i];
+		same &= entity.SpinSpeed == entity.Position.x * 0.1f && entity.Mesh == entity.Material;
+		if (!cells)
+			same &= entity.Position.x == (float)i * 7.0f - 30.0f;
+		spin += entity.SpinSpeed;
+	}
+	CHECK(same);
+	CHECK(fabsf(spin - 1.5f) < 1e-4f);
+	CHECK((h.Cells.Count > 0) == cells);
+}
+
+static void TestRoundTrip()
+{
+	SceneFileWriter writer;
+	BuildScene(writer);
+
+	// Strings are pooled
+	writer.AddMesh("Meshes/cube.obj");
+	std::vector<uint32_t> data;
+	writer.Write(data);
+	SceneFile pooled;
+	CHECK(pooled.LoadFromMemory(data.data(), data.size() * 4));
+	CHECK(pooled.GetHeader().Meshes[2].Path.Offset == pooled.GetHeader().Meshes[0].Path.Offset);
+
+	SceneFileWriter plain;
+	BuildScene(plain);
+	plain.Write(data);
+	SceneFile scene;
+	CHECK(scene.LoadFromMemory(data.data(), data.size() * 4));
+	CHECK(scene.IsLoaded() && scene.GetError().empty());
+	CHECK(scene.GetSize() == data.size() * 4);
+	CheckScene(scene, false);
+
+	// Through a file, mapped
+	CHECK(plain.Write("SceneFileTest.scene"));
+	SceneFile mapped;
+	CHECK(mapped.Load("SceneFileTest.scene"));
+	if (mapped.IsLoaded())
+		CheckScene(mapped, false);
+	mapped.Close();
+	CHECK(!mapped.IsLoaded());
+	remove("SceneFileTest.scene");
+	CHECK(!mapped.Load("SceneFileTest.scene"));
+}
+
+static void TestCells()
+{
+	SceneFileWriter writer;
+	BuildScene(writer);
+	writer.SetCellSize(16.0f);
+	std::vector<uint32_t> data;
+	writer.Write(data);
+
+	SceneFile scene;
+	CHECK(scene.LoadFromMemory(data.data(), data.size() * 4));
+	CheckScene(scene, true);
+
+	// Runs in order, covering every entity, each inside its cell
+	const SceneFileHeader& h = scene.GetHeader();
+	CHECK(h.CellSize == 16.0f);
+	uint32_t next = 0;
+	bool inside = true;
+	for (uint32_t c = 0; c < h.Cells.Count; c++)
+	{
+		const SceneFileCell& cell = h.Cells[c];
+		inside &= cell.FirstEntity == next && cell.EntityCount > 0;
+		CHECK(scene.CheckEntities(&h.Entities[cell.FirstEntity], cell.EntityCount));
+		for (uint32_t i = cell.FirstEntity; i < cell.FirstEntity + cell.EntityCount; i++)
+		{
+			inside &= (int32_t)floorf(h.Entities[i].Position.x / h.CellSize) == cell.X;
+			inside &= (int32_t)floorf(h.Entities[i].Position.z / h.CellSize) == cell.Z;
+		}
+		next += cell.EntityCount;
+	}
+	CHECK(inside);
+	CHECK(next == h.Entities.Count);
+	CHECK(h.Cells.Count > 1);
+}
+
+static void TestText()
+{
+	const char* text =
+		"# A tiny scene\n"
+		"mesh cube Meshes/cube.obj\n"
+		"texture rock Textures/rock.png\n"
+		"material stone tint 0.5 0.5 0.5 roughness 0.9 albedo rock\n"
+		"entity cube stone position 1 2 3 static\n"
+		"light point intensity 3 range 8\n"
+		"light directional direction 0 -1 0\n"
+		"camera position 0 1 -5 fov 0.8\n";
+
+	SceneFileWriter writer;
+	std::string error;
+	CHECK(ParseSceneText(text, writer, error));
+	std::vector<uint32_t> data;
+	writer.Write(data);
+	SceneFile scene;
+	CHECK(scene.LoadFromMemory(data.data(), data.size() * 4));
+	if (scene.IsLoaded())
+	{
+		const SceneFileHeader& h = scene.GetHeader();
+		CHECK(h.Entities.Count == 1 && h.Entities[0].Position.z == 3.0f);
+		CHECK(h.Entities[0].Flags == SCENE_FILE_ENTITY_STATIC);
+		CHECK(h.Materials[0].Roughness == 0.9f && h.Materials[0].Textures[SCENE_FILE_TEXTURE_ALBEDO] == 0);
+		CHECK(h.Lights[0].Intensity == 3.0f && h.Lights[1].Type == LIGHT_TYPE_DIRECTIONAL);
+		CHECK(h.Cameras[0].FieldOfView == 0.8f);
+	}
+
+	// Naming something that isn't there
+	SceneFileWriter bad;
+	CHECK(!ParseSceneText("mesh cube Meshes/cube.obj\nentity cube missing\n", bad, error));
+	CHECK(!error.empty());
+}
+
+// Loads a changed copy of a good scene, which must fail
+static void ExpectRejected(const std::vector<uint32_t>& good, void (*change)(SceneFileHeader& h, std::vector<uint32_t>& data), size_t size = 0)
+{
+	std::vector<uint32_t> data = good;
+	change(*(SceneFileHeader*)data.data(), data);
+	SceneFile scene;
+	CHECK(!scene.LoadFromMemory(data.data(), size ? size : data.size() * 4));
+	CHECK(!scene.IsLoaded() && !scene.GetError().empty());
+}
+
+// The header's arrays can be written through when testing
+template<typename T>
+static T& At(SceneFileArray<T>& array, uint32_t index)
+{
+	return const_cast<T&>(array[index]);
+}
+
+static void TestRejection()
+{
+	SceneFileWriter writer;
+	BuildScene(writer);
+	std::vector<uint32_t> good;
+	writer.Write(good);
+	SceneFile scene;
+	CHECK(scene.LoadFromMemory(good.data(), good.size() * 4));
+
+	// Truncated, or not where it should be
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) {}, good.size() * 4 - 4);
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) {}, sizeof(SceneFileHeader) - 4);
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { data.resize(data.size() / 2); });
+	CHECK(!scene.LoadFromMemory((const uint8_t*)good.data() + 2, good.size() * 4 - 4));
+
+	// Not this kind of file
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { h.Magic = 0x12345678; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { h.Version++; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { h.HeaderSize -= 4; });
+
+	// Arrays outside the file (or over the header, or misaligned)
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { h.Entities.Count += 100; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { h.Lights.Offset = 0x7FFFFFF0; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { h.Meshes.Offset = 0; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { h.Materials.Offset += 2; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { h.Cameras.Count = 0xFFFFFFFF; });
+
+	// Strings outside the table, or a table without its end
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { At(h.Meshes, 0).Path.Offset = h.Strings.Count; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { At(h.Textures, 1).Path.Offset = 0xFFFFFFFF; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { At(h.Skies, 0).Faces[5].Offset = h.Strings.Count + 10; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { At(h.Strings, h.Strings.Count - 1) = 'x'; });
+
+	// Indices past the end of what they index
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { At(h.Materials, 1).Textures[SCENE_FILE_TEXTURE_ROUGHNESS] = 2; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { At(h.Entities, 9).Mesh = 2; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { At(h.Entities, 0).Material = 0xFFFFFFFF; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { At(h.Skies, 0).Mesh = 5; });
+
+	// Missing what drawing needs
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { h.Cameras.Count = 0; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { h.Lights.Count = 0; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { h.Lights.Count = 1; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { h.Skies.Count = 2; });
+
+	// None of that touched the original, which still loads
+	CHECK(scene.LoadFromMemory(good.data(), good.size() * 4));
+}
+
+static void TestCellRejection()
+{
+	SceneFileWriter writer;
+	BuildScene(writer);
+	writer.SetCellSize(16.0f);
+	std::vector<uint32_t> good;
+	writer.Write(good);
+	SceneFile scene;
+	CHECK(scene.LoadFromMemory(good.data(), good.size() * 4));
+	CHECK(scene.GetHeader().Cells.Count > 1);
+
+	// Cells that don't match up with the entities
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { At(h.Cells, 1).FirstEntity++; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { At(h.Cells, 0).EntityCount++; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { At(h.Cells, h.Cells.Count - 1).EntityCount--; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { At(h.Cells, 0).EntityCount = 0xFFFFFFFF; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { h.Cells.Count--; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { h.CellSize = 0.0f; });
+	ExpectRejected(good, [](SceneFileHeader& h, std::vector<uint32_t>& data) { h.CellSize = NAN; });
+
+	// A streamed cell's entities aren't read until it's loaded,
+	// which is when a bad one is caught
+	std::vector<uint32_t> data = good;
+	SceneFileHeader& h = *(SceneFileHeader*)data.data();
+	At(h.Entities, h.Cells[0].FirstEntity).Mesh = 7;
+	CHECK(scene.LoadFromMemory(data.data(), data.size() * 4));
+	const SceneFileCell& first = scene.GetHeader().Cells[0];
+	CHECK(!scene.CheckEntities(&scene.GetHeader().Entities[first.FirstEntity], first.EntityCount));
+	const SceneFileCell& second = scene.GetHeader().Cells[1];
+	CHECK(scene.CheckEntities(&scene.GetHeader().Entities[second.FirstEntity], second.EntityCount));
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestCells();
+	TestText();
+	TestRejection();
+	TestCellRejection();
+	return TestResult();
+}
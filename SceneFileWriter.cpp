@@ -0,0 +1,369 @@
+#include "SceneFileWriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace DirectX;
+
+SceneFileWriter::SceneFileWriter() :
+	cellSize(0.0f)
+{
+}
+
+SceneFileString SceneFileWriter::AddString(const std::string& str)
+{
+	auto it = stringOffsets.find(str);
+	if (it != stringOffsets.end())
+		return SceneFileString{ it->second };
+
+	uint32_t offset = (uint32_t)strings.size();
+	strings.insert(strings.end(), str.begin(), str.end());
+	strings.push_back(0);
+	stringOffsets[str] = offset;
+	return SceneFileString{ offset };
+}
+
+uint32_t SceneFileWriter::AddMesh(const std::string& path)
+{
+	meshes.push_back(SceneFileMesh{ AddString(path) });
+	return (uint32_t)meshes.size() - 1;
+}
+
+uint32_t SceneFileWriter::AddTexture(const std::string& path)
+{
+	textures.push_back(SceneFileTexture{ AddString(path) });
+	return (uint32_t)textures.size() - 1;
+}
+
+uint32_t SceneFileWriter::AddMaterial(const SceneFileMaterial& material)
+{
+	materials.push_back(material);
+	return (uint32_t)materials.size() - 1;
+}
+
+uint32_t SceneFileWriter::AddEntity(const SceneFileEntity& entity)
+{
+	entities.push_back(entity);
+	return (uint32_t)entities.size() - 1;
+}
+
+uint32_t SceneFileWriter::AddLight(const Light& light)
+{
+	lights.push_back(light);
+	return (uint32_t)lights.size() - 1;
+}
+
+uint32_t SceneFileWriter::AddCamera(const SceneFileCamera& camera)
+{
+	cameras.push_back(camera);
+	return (uint32_t)cameras.size() - 1;
+}
+
+void SceneFileWriter::SetSky(uint32_t mesh, const std::string faces[6])
+{
+	SceneFileSky sky;
+	sky.Mesh = mesh;
+	for (int face = 0; face < 6; face++)
+		sky.Faces[face] = AddString(faces[face]);
+
+	skies.assign(1, sky);
+}
+
+void SceneFileWriter::SetCellSize(float size)
+{
+	cellSize = size > 0.0f ? size : 0.0f;
+}
+
+// Copies an array in after what's there so far, pointing the
+// header's field at it
+template<typename T>
+static void WriteArray(std::vector<uint8_t>& bytes, size_t field, const T* items, size_t count)
+{
+	size_t start = bytes.size();
+	bytes.resize(start + ((sizeof(T) * count + 3) & ~(size_t)3));
+	if (count > 0)
+		memcpy(&bytes[start], items, sizeof(T) * count);
+
+	SceneFileArray<T> array = { (uint32_t)(start - field), (uint32_t)count };
+	memcpy(&bytes[field], &array, sizeof(array));
+}
+
+void SceneFileWriter::Write(std::vector<uint32_t>& data) const
+{
+	// Streamed entities are grouped by cell, in rows along x
+	// (keeping their order within each)
+	std::vector<SceneFileEntity> sorted;
+	std::vector<SceneFileCell> cells;
+	if (cellSize > 0.0f)
+	{
+		std::vector<std::pair<SceneFileCell, uint32_t>> cellOf(entities.size());
+		for (uint32_t i = 0; i < entities.size(); i++)
+		{
+			SceneFileCell cell = { (int32_t)floorf(entities[i].Position.x / cellSize), (int32_t)floorf(entities[i].Position.z / cellSize), 0, 0 };
+			cellOf[i] = std::make_pair(cell, i);
+		}
+		std::stable_sort(cellOf.begin(), cellOf.end(), [](const std::pair<SceneFileCell, uint32_t>& a, const std::pair<SceneFileCell, uint32_t>& b) {
+			return a.first.Z != b.first.Z ? a.first.Z < b.first.Z : a.first.X < b.first.X;
+		});
+
+		for (uint32_t i = 0; i < cellOf.size(); i++)
+		{
+			const SceneFileCell& cell = cellOf[i].first;
+			if (cells.empty() || cells.back().X != cell.X || cells.back().Z != cell.Z)
+				cells.push_back(SceneFileCell{ cell.X, cell.Z, i, 0 });
+			cells.back().EntityCount++;
+			sorted.push_back(entities[cellOf[i].second]);
+		}
+	}
+	const std::vector<SceneFileEntity>& written = cellSize > 0.0f ? sorted : entities;
+
+	std::vector<uint8_t> bytes(sizeof(SceneFileHeader));
+	WriteArray(bytes, offsetof(SceneFileHeader, Meshes), meshes.data(), meshes.size());
+	WriteArray(bytes, offsetof(SceneFileHeader, Textures), textures.data(), textures.size());
+	WriteArray(bytes, offsetof(SceneFileHeader, Materials), materials.data(), materials.size());
+	WriteArray(bytes, offsetof(SceneFileHeader, Cells), cells.data(), cells.size());
+	WriteArray(bytes, offsetof(SceneFileHeader, Entities), written.data(), written.size());
+	WriteArray(bytes, offsetof(SceneFileHeader, Lights), lights.data(), lights.size());
+	WriteArray(bytes, offsetof(SceneFileHeader, Cameras), cameras.data(), cameras.size());
+	WriteArray(bytes, offsetof(SceneFileHeader, Skies), skies.data(), skies.size());
+
+	// The string table is never empty, so it always ends in a null
+	const char empty = 0;
+	WriteArray(bytes, offsetof(SceneFileHeader, Strings), strings.empty() ? &empty : strings.data(), strings.empty() ? 1 : strings.size());
+
+	SceneFileHeader* header = (SceneFileHeader*)bytes.data();
+	header->Magic = SCENE_FILE_MAGIC;
+	header->Version = SCENE_FILE_VERSION;
+	header->FileSize = (uint32_t)bytes.size();
+	header->HeaderSize = sizeof(SceneFileHeader);
+	header->CellSize = cellSize;
+
+	data.resize(bytes.size() / 4);
+	memcpy(data.data(), bytes.data(), bytes.size());
+}
+
+bool SceneFileWriter::Write(const std::string& path) const
+{
+	std::vector<uint32_t> data;
+	Write(data);
+
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file)
+		return false;
+
+	bool written = fwrite(data.data(), sizeof(uint32_t), data.size(), file) == data.size();
+	return fclose(file) == 0 && written;
+}
+
+// --------------------------------------------------------
+// Text scenes
+// --------------------------------------------------------
+
+// Splits a line into words, and reads them as what they name
+class SceneTextLine
+{
+public:
+	SceneTextLine(const char* start, const char* end) : next(start), end(end), ok(true) {}
+
+	bool Word(std::string& word)
+	{
+		while (next < end && (*next == ' ' || *next == '\t' || *next == '\r'))
+			next++;
+		const char* start = next;
+		while (next < end && *next != ' ' && *next != '\t' && *next != '\r')
+			next++;
+
+		word.assign(start, next);
+		return !word.empty();
+	}
+
+	float Float()
+	{
+		std::string word;
+		char* wordEnd = 0;
+		float value = 0.0f;
+		if (Word(word))
+			value = strtof(word.c_str(), &wordEnd);
+		ok = ok && wordEnd && *wordEnd == 0;
+		return value;
+	}
+
+	XMFLOAT3 Float3()
+	{
+		float x = Float();
+		float y = Float();
+		float z = Float();
+		return XMFLOAT3(x, y, z);
+	}
+
+	bool IsOk() const { return ok; }
+
+private:
+	const char* next;
+	const char* end;
+	bool ok;
+};
+
+typedef std::unordered_map<std::string, uint32_t> SceneTextNames;
+
+static bool FindName(const SceneTextNames& names, const std::string& name, uint32_t& index)
+{
+	auto it = names.find(name);
+	if (it == names.end())
+		return false;
+
+	index = it->second;
+	return true;
+}
+
+bool ParseSceneText(const char* text, SceneFileWriter& writer, std::string& error)
+{
+	SceneTextNames meshNames;
+	SceneTextNames textureNames;
+	SceneTextNames materialNames;
+
+	std::string kind;
+	std::string word;
+	std::string name;
+	unsigned int lineNumber = 0;
+	const char* lineStart = text;
+	while (*lineStart)
+	{
+		lineNumber++;
+		const char* lineEnd = lineStart;
+		while (*lineEnd && *lineEnd != '\n' && *lineEnd != '#')
+			lineEnd++;
+
+		SceneTextLine line(lineStart, lineEnd);
+		bool known = true;
+		if (!line.Word(kind))
+		{
+			// Blank (or a comment)
+		}
+		else if (kind == "mesh" || kind == "texture")
+		{
+			known = line.Word(name) && line.Word(word);
+			if (known && kind == "mesh")
+				meshNames[name] = writer.AddMesh(word);
+			else if (known)
+				textureNames[name] = writer.AddTexture(word);
+		}
+		else if (kind == "material")
+		{
+			SceneFileMaterial material = { XMFLOAT3(1.0f, 1.0f, 1.0f), 1.0f, { SCENE_FILE_NONE, SCENE_FILE_NONE, SCENE_FILE_NONE, SCENE_FILE_NONE } };
+			known = line.Word(name);
+			while (known && line.Word(word))
+			{
+				int slot =
+					word == "albedo" ? SCENE_FILE_TEXTURE_ALBEDO :
+					word == "roughness_map" ? SCENE_FILE_TEXTURE_ROUGHNESS :
+					word == "metalness_map" ? SCENE_FILE_TEXTURE_METALNESS :
+					word == "normal_map" ? SCENE_FILE_TEXTURE_NORMAL : -1;
+
+				if (word == "tint") material.ColorTint = line.Float3();
+				else if (word == "roughness") material.Roughness = line.Float();
+				else if (slot >= 0) known = line.Word(word) && FindName(textureNames, word, material.Textures[slot]);
+				else known = false;
+			}
+			if (known)
+				materialNames[name] = writer.AddMaterial(material);
+		}
+		else if (kind == "entity")
+		{
+			SceneFileEntity entity = {};
+			entity.Scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+			known =
+				line.Word(word) && FindName(meshNames, word, entity.Mesh) &&
+				line.Word(word) && FindName(materialNames, word, entity.Material);
+			while (known && line.Word(word))
+			{
+				if (word == "position") entity.Position = line.Float3();
+				else if (word == "rotation") entity.PitchYawRoll = line.Float3();
+				else if (word == "scale") entity.Scale = line.Float3();
+				else if (word == "static") entity.Flags |= SCENE_FILE_ENTITY_STATIC;
+				else if (word == "spin") entity.SpinSpeed = line.Float();
+				else if (word == "bob") entity.Bob = line.Float3();
+				else known = false;
+			}
+			if (known)
+				writer.AddEntity(entity);
+		}
+		else if (kind == "light")
+		{
+			Light light = {};
+			known = line.Word(word);
+			if (word == "point") light.Type = LIGHT_TYPE_POINT;
+			else if (word == "directional") light.Type = LIGHT_TYPE_DIRECTIONAL;
+			else if (word == "spot") light.Type = LIGHT_TYPE_SPOT;
+			else known = false;
+
+			while (known && line.Word(word))
+			{
+				if (word == "color") light.Color = line.Float3();
+				else if (word == "intensity") light.Intensity = line.Float();
+				else if (word == "position") light.Position = line.Float3();
+				else if (word == "direction") light.Direction = line.Float3();
+				else if (word == "range") light.Range = line.Float();
+				else if (word == "falloff") light.SpotFalloff = line.Float();
+				else known = false;
+			}
+			if (known)
+				writer.AddLight(light);
+		}
+		else if (kind == "camera")
+		{
+			// Camera's own defaults
+			SceneFileCamera camera = { XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0), 5.0f, 0.002f, XM_PIDIV4, 0.01f, 100.0f };
+			while (known && line.Word(word))
+			{
+				if (word == "position") camera.Position = line.Float3();
+				else if (word == "rotation") camera.PitchYawRoll = line.Float3();
+				else if (word == "move") camera.MoveSpeed = line.Float();
+				else if (word == "look") camera.LookSpeed = line.Float();
+				else if (word == "fov") camera.FieldOfView = line.Float();
+				else if (word == "near") camera.NearClip = line.Float();
+				else if (word == "far") camera.FarClip = line.Float();
+				else known = false;
+			}
+			if (known)
+				writer.AddCamera(camera);
+		}
+		else if (kind == "cells")
+		{
+			float size = line.Float();
+			known = size > 0.0f;
+			if (known)
+				writer.SetCellSize(size);
+		}
+		else if (kind == "sky")
+		{
+			uint32_t mesh = 0;
+			std::string faces[6];
+			known = line.Word(word) && FindName(meshNames, word, mesh);
+			for (int face = 0; face < 6 && known; face++)
+				known = line.Word(faces[face]);
+			if (known)
+				writer.SetSky(mesh, faces);
+		}
+		else
+			known = false;
+
+		// Nothing may be left over
+		if (!known || !line.IsOk() || line.Word(word))
+		{
+			error = "line " + std::to_string(lineNumber) + ": can't read \"" + std::string(lineStart, lineEnd) + "\"";
+			return false;
+		}
+
+		// On to the next line (past any comment)
+		while (*lineEnd && *lineEnd != '\n')
+			lineEnd++;
+		lineStart = *lineEnd ? lineEnd + 1 : lineEnd;
+	}
+
+	return true;
+}
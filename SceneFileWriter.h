@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "SceneFile.h"
+
+// --------------------------------------------------------
+// Builds a scene file: records are added one at a time (by
+// index, as they refer to each other in the file), then
+// Write() lays them out.  Strings are pooled, so a path
+// used many times is stored once.
+// --------------------------------------------------------
+class SceneFileWriter
+{
+public:
+	SceneFileWriter();
+
+	// Each returns the record's index
+	uint32_t AddMesh(const std::string& path);
+	uint32_t AddTexture(const std::string& path);
+	uint32_t AddMaterial(const SceneFileMaterial& material);
+	uint32_t AddEntity(const SceneFileEntity& entity);
+	uint32_t AddLight(const Light& light);
+	uint32_t AddCamera(const SceneFileCamera& camera);
+	void SetSky(uint32_t mesh, const std::string faces[6]);
+
+	// Splits the entities into cells this big, to be streamed
+	// (0, the default, loads them all with the scene)
+	void SetCellSize(float size);
+
+	// The whole file (4 byte aligned, so it can be loaded
+	// from memory as is)
+	void Write(std::vector<uint32_t>& data) const;
+	bool Write(const std::string& path) const;
+
+	// Getters
+	uint32_t GetMeshCount() const { return (uint32_t)meshes.size(); }
+	uint32_t GetTextureCount() const { return (uint32_t)textures.size(); }
+	uint32_t GetMaterialCount() const { return (uint32_t)materials.size(); }
+	uint32_t GetEntityCount() const { return (uint32_t)entities.size(); }
+
+private:
+	SceneFileString AddString(const std::string& str);
+
+	std::vector<char> strings;
+	std::unordered_map<std::string, uint32_t> stringOffsets;
+
+	std::vector<SceneFileMesh> meshes;
+	std::vector<SceneFileTexture> textures;
+	std::vector<SceneFileMaterial> materials;
+	std::vector<SceneFileEntity> entities;
+	std::vector<Light> lights;
+	std::vector<SceneFileCamera> cameras;
+	std::vector<SceneFileSky> skies;
+	float cellSize;
+};
+
+// --------------------------------------------------------
+// Reads a scene written as text into a writer, one record
+// per line (# starts a comment).  Meshes, textures and
+// materials are named, and referred to by name after:
+//
+//   mesh <name> <path>
+//   texture <name> <path>
+//   material <name> [tint r g b] [roughness r]
+//            [albedo tex] [roughness_map tex]
+//            [metalness_map tex] [normal_map tex]
+//   entity <mesh> <material> [position x y z]
+//          [rotation pitch yaw roll] [scale x y z]
+//          [static] [spin speed] [bob x y z]
+//   light <point|directional|spot> [color r g b]
+//         [intensity i] [position x y z]
+//         [direction x y z] [range r] [falloff f]
+//   camera [position x y z] [rotation pitch yaw roll]
+//          [move speed] [look speed] [fov radians]
+//          [near distance] [far distance]
+//   sky <mesh> <right> <left> <up> <down> <front> <back>
+//   cells <size>
+//
+// Paths are relative to the Assets folder and can't have
+// spaces.  False on the first bad line, with the error
+// saying which.
+// --------------------------------------------------------
+bool ParseSceneText(const char* text, SceneFileWriter& writer, std::string& error);
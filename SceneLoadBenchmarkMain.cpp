@@ -0,0 +1,239 @@
+// --------------------------------------------------------
+// Writes a big scene (the demo scene's assets, with its
+// entities repeated over a grid) as text and as a scene
+// file, then times loading it each way:
+//
+//  - text:   reading the text and parsing it into records
+//            (what loading would cost without the exporter)
+//  - read:   reading the scene file into memory and checking
+//            it, then walking every entity
+//  - mapped: mapping the scene file and checking it, then
+//            walking every entity
+//  - cold:   the same, after asking the OS to drop the file
+//            from its cache (Linux only - elsewhere this is
+//            the same as mapped)
+//
+// Walking sums every entity's position, so every page of
+// the file is touched.  The sums are checked against each
+// other at the end.
+//
+// Built by CMakeLists.txt:
+//
+//   SceneLoadBenchmarkMain --entities 100000 --runs 10 --dir /tmp
+// --------------------------------------------------------
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "SceneFile.h"
+#include "SceneFileWriter.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Writes the scene's text, entities spread over a grid and
+// using the demo scene's meshes & materials in turn
+static std::string MakeSceneText(uint32_t entityCount)
+{
+	static const char* names[6][2] =
+	{
+		{ "sphere", "scratched" }, { "cube", "floor" }, { "helix", "bronze" },
+		{ "cylinder", "cobblestone" }, { "torus", "paint" }, { "quad", "wood" }
+	};
+
+	std::string text = "# Generated by SceneLoadBenchmarkMain\n";
+	for (int i = 0; i < 6; i++)
+	{
+		text += std::string("mesh ") + names[i][0] + " Models/" + names[i][0] + ".obj\n";
+		text += std::string("texture ") + names[i][1] + "_albedo Textures/" + names[i][1] + "_albedo.png\n";
+		text += std::string("texture ") + names[i][1] + "_normals Textures/" + names[i][1] + "_normals.png\n";
+		text += std::string("material ") + names[i][1] + " tint 1 1 1 roughness 0.95 albedo " + names[i][1] + "_albedo normal_map " + names[i][1] + "_normals\n";
+	}
+
+	char line[256];
+	for (uint32_t i = 0; i < entityCount; i++)
+	{
+		snprintf(line, sizeof(line), "entity %s %s position %.2f %.2f %.2f rotation 0 %.3f 0 scale 1 1 1%s\n",
+			names[i % 6][0], names[i % 6][1],
+			(float)(i % 500) * 3.0f, 0.0f, (float)(i / 500) * 3.0f,
+			(float)(i % 628) * 0.01f,
+			i % 4 == 0 ? " static" : " spin 0.5 bob 0 0.01 0");
+		text += line;
+	}
+
+	text += "light directional color 1 1 1 intensity 1 direction -0.5 -0.5 0.5\n";
+	text += "camera position 0 0 -10 far 300\n";
+	text += "sky cube Skies/CloudsPink/right.png Skies/CloudsPink/left.png Skies/CloudsPink/up.png Skies/CloudsPink/down.png Skies/CloudsPink/front.png Skies/CloudsPink/back.png\n";
+	return text;
+}
+
+static bool ReadFile(const std::string& path, std::vector<uint32_t>& data)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	data.resize(((size_t)size + 3) / 4);
+	bool ok = fread(data.data(), 1, (size_t)size, file) == (size_t)size;
+	fclose(file);
+	return ok;
+}
+
+static bool WriteText(const std::string& path, const std::string& text)
+{
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file)
+		return false;
+
+	bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+	return fclose(file) == 0 && ok;
+}
+
+// Drops the file from the OS's cache, so the next read of
+// it comes from the disk
+static void DropFromCache(const std::string& path)
+{
+#ifndef _WIN32
+	int file = open(path.c_str(), O_RDONLY);
+	if (file >= 0)
+	{
+		fdatasync(file);
+		posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+		close(file);
+	}
+#endif
+}
+
+static double WalkEntities(const SceneFile& scene)
+{
+	const SceneFileArray<SceneFileEntity>& entities = scene.GetHeader().Entities;
+	double sum = 0;
+	for (uint32_t i = 0; i < entities.Count; i++)
+		sum += (double)entities[i].Position.x + entities[i].Position.y + entities[i].Position.z + entities[i].Mesh;
+	return sum;
+}
+
+// Best and average milliseconds per load
+struct BenchTime
+{
+	double BestMs;
+	double AverageMs;
+};
+
+template<typename Load>
+static BenchTime Time(uint32_t runs, const Load& load)
+{
+	BenchTime time = { 1e30, 0 };
+	for (uint32_t r = 0; r < runs; r++)
+	{
+		auto start = Clock::now();
+		load();
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		time.BestMs = ms < time.BestMs ? ms : time.BestMs;
+		time.AverageMs += ms / runs;
+	}
+	return time;
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t entityCount = 100000;
+	uint32_t runs = 10;
+	std::string dir = ".";
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string name = argv[i];
+		if (name == "--entities") entityCount = (uint32_t)atoi(argv[i + 1]);
+		else if (name == "--runs") runs = (uint32_t)atoi(argv[i + 1]);
+		else if (name == "--dir") dir = argv[i + 1];
+	}
+	if (entityCount == 0 || runs == 0)
+	{
+		printf("Usage: SceneLoadBenchmarkMain [--entities count] [--runs count] [--dir scratch]\n");
+		return 1;
+	}
+
+	// Both files, made the way the exporter makes them
+	std::string textPath = dir + "/SceneLoadBenchmark.txt";
+	std::string scenePath = dir + "/SceneLoadBenchmark.scene";
+	std::string text = MakeSceneText(entityCount);
+	SceneFileWriter exported;
+	std::string error;
+	if (!WriteText(textPath, text) || !ParseSceneText(text.c_str(), exported, error) || !exported.Write(scenePath))
+	{
+		printf("Couldn't write the scenes in %s %s\n", dir.c_str(), error.c_str());
+		return 1;
+	}
+
+	double textSum = 0;
+	double readSum = 0;
+	double mappedSum = 0;
+	double coldSum = 0;
+	bool loaded = true;
+
+	BenchTime textTime = Time(runs, [&]() {
+		std::vector<uint32_t> data;
+		loaded = ReadFile(textPath, data) && loaded;
+		std::string fileText((const char*)data.data(), text.size());
+
+		SceneFileWriter writer;
+		std::vector<uint32_t> scene;
+		loaded = ParseSceneText(fileText.c_str(), writer, error) && loaded;
+		writer.Write(scene);
+
+		SceneFile parsed;
+		loaded = parsed.LoadFromMemory(scene.data(), scene.size() * 4) && loaded;
+		textSum = WalkEntities(parsed);
+	});
+	BenchTime readTime = Time(runs, [&]() {
+		std::vector<uint32_t> data;
+		SceneFile scene;
+		loaded = ReadFile(scenePath, data) && scene.LoadFromMemory(data.data(), data.size() * 4) && loaded;
+		readSum = WalkEntities(scene);
+	});
+	BenchTime mappedTime = Time(runs, [&]() {
+		SceneFile scene;
+		loaded = scene.Load(scenePath) && loaded;
+		mappedSum = WalkEntities(scene);
+	});
+
+	// Cold loads drop the file first, outside the timing
+	BenchTime coldTime = { 1e30, 0 };
+	for (uint32_t r = 0; r < runs; r++)
+	{
+		DropFromCache(scenePath);
+		BenchTime one = Time(1, [&]() {
+			SceneFile scene;
+			loaded = scene.Load(scenePath) && loaded;
+			coldSum = WalkEntities(scene);
+		});
+		coldTime.BestMs = one.BestMs < coldTime.BestMs ? one.BestMs : coldTime.BestMs;
+		coldTime.AverageMs += one.BestMs / runs;
+	}
+
+	std::vector<uint32_t> exportedData;
+	exported.Write(exportedData);
+	printf("%u entities: text %zu bytes, scene file %zu bytes, best of %u runs\n\n",
+		entityCount, text.size(), exportedData.size() * 4, runs);
+	printf("load       best ms  average ms  ns/entity\n");
+	printf("text      %8.3f  %10.3f  %9.1f\n", textTime.BestMs, textTime.AverageMs, textTime.BestMs * 1e6 / entityCount);
+	printf("read      %8.3f  %10.3f  %9.1f\n", readTime.BestMs, readTime.AverageMs, readTime.BestMs * 1e6 / entityCount);
+	printf("mapped    %8.3f  %10.3f  %9.1f\n", mappedTime.BestMs, mappedTime.AverageMs, mappedTime.BestMs * 1e6 / entityCount);
+	printf("cold      %8.3f  %10.3f  %9.1f\n", coldTime.BestMs, coldTime.AverageMs, coldTime.BestMs * 1e6 / entityCount);
+
+	bool same = loaded && textSum == readSum && readSum == mappedSum && mappedSum == coldSum;
+	printf("\nScenes %s\n", same ? "match" : "DIFFER");
+
+	remove(textPath.c_str());
+	remove(scenePath.c_str());
+	return same ? 0 : 1;
+}
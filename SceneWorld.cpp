@@ -0,0 +1,269 @@
+#include "SceneWorld.h"
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+
+// --------------------------------------------------------
+// Component types, shared by every world.  A fixed array,
+// so reading infos needs no lock while another thread adds
+// a type.
+// --------------------------------------------------------
+static SceneComponentInfo componentInfos[SCENE_MAX_COMPONENT_TYPES + 1];
+static std::atomic<uint32_t> componentCount(0);
+static std::mutex componentLock;
+
+uint32_t RegisterSceneComponent(const SceneComponentInfo& info)
+{
+	std::lock_guard<std::mutex> lock(componentLock);
+	uint32_t id = componentCount.load(std::memory_order_relaxed);
+	if (id == SCENE_MAX_COMPONENT_TYPES)
+	{
+		printf("Scene component types past %d can't be stored\n", SCENE_MAX_COMPONENT_TYPES);
+		return SCENE_MAX_COMPONENT_TYPES;
+	}
+	if (info.Alignment > SCENE_CHUNK_ALIGNMENT)
+		printf("Scene component %u wants %u byte alignment (columns only get %d)\n", id, info.Alignment, SCENE_CHUNK_ALIGNMENT);
+
+	componentInfos[id] = info;
+	componentCount.store(id + 1, std::memory_order_release);
+	return id;
+}
+
+const SceneComponentInfo& GetSceneComponentInfo(uint32_t id)
+{
+	return componentInfos[id];
+}
+
+static uint32_t AlignColumn(uint32_t offset)
+{
+	return (offset + SCENE_CHUNK_ALIGNMENT - 1) & ~(uint32_t)(SCENE_CHUNK_ALIGNMENT - 1);
+}
+
+// --------------------------------------------------------
+// Lays out a chunk: the entity column, then one for each
+// component, each starting on a cache line, with as many
+// rows as fit
+// --------------------------------------------------------
+SceneArchetype::SceneArchetype(SceneComponentMask mask) :
+	mask(mask),
+	count(0)
+{
+	uint32_t rowBytes = sizeof(SceneEntity);
+	for (uint32_t id = 0; id <= SCENE_MAX_COMPONENT_TYPES; id++)
+	{
+		offsets[id] = SCENE_NO_COLUMN;
+		sizes[id] = 0;
+		if (mask & SceneComponentBit(id))
+		{
+			components.push_back(id);
+			sizes[id] = GetSceneComponentInfo(id).Size;
+			rowBytes += sizes[id];
+		}
+	}
+
+	uint32_t padding = (uint32_t)(components.size() + 1) * SCENE_CHUNK_ALIGNMENT;
+	capacity = SCENE_CHUNK_SIZE > padding + rowBytes ? (SCENE_CHUNK_SIZE - padding) / rowBytes : 1;
+
+	uint32_t offset = AlignColumn(sizeof(SceneEntity) * capacity);
+	for (uint32_t id : components)
+	{
+		offsets[id] = offset;
+		offset = AlignColumn(offset + sizes[id] * capacity);
+	}
+	chunkBytes = offset;
+}
+
+SceneArchetype::~SceneArchetype()
+{
+	for (uint32_t row = 0; row < count; row++)
+	{
+		for (uint32_t id : components)
+			GetSceneComponentInfo(id).Destroy(GetComponent(row, id));
+	}
+
+	for (uint8_t* chunk : chunks)
+		operator delete(chunk, std::align_val_t(SCENE_CHUNK_ALIGNMENT));
+}
+
+uint32_t SceneArchetype::AddRow(SceneEntity entity)
+{
+	if (count == chunks.size() * capacity)
+		chunks.push_back((uint8_t*)operator new(chunkBytes, std::align_val_t(SCENE_CHUNK_ALIGNMENT)));
+
+	uint32_t row = count++;
+	GetEntities(row / capacity)[row % capacity] = entity;
+	return row;
+}
+
+SceneEntity SceneArchetype::RemoveRow(uint32_t row)
+{
+	uint32_t last = count - 1;
+	for (uint32_t id : components)
+	{
+		const SceneComponentInfo& info = GetSceneComponentInfo(id);
+		void* hole = GetComponent(row, id);
+		info.Destroy(hole);
+		if (row != last)
+		{
+			void* from = GetComponent(last, id);
+			info.MoveConstruct(hole, from);
+			info.Destroy(from);
+		}
+	}
+
+	SceneEntity moved;
+	if (row != last)
+	{
+		moved = GetEntities(last / capacity)[last % capacity];
+		GetEntities(row / capacity)[row % capacity] = moved;
+	}
+	count--;
+	return moved;
+}
+
+SceneWorld::SceneWorld()
+{
+}
+
+SceneWorld::~SceneWorld()
+{
+}
+
+bool SceneWorld::Destroy(SceneEntity entity)
+{
+	SceneEntityRecord* record = entities.Get(entity);
+	if (!record)
+		return false;
+
+	SceneEntity moved = archetypes[record->Archetype]->RemoveRow(record->Row);
+	if (moved.IsValid())
+		entities.Get(moved)->Row = record->Row;
+
+	entities.Destroy(entity);
+	return true;
+}
+
+void SceneWorld::GetChunks(SceneComponentMask mask, std::vector<SceneChunkView>& chunks)
+{
+	chunks.clear();
+	for (const std::unique_ptr<SceneArchetype>& archetype : archetypes)
+	{
+		if ((archetype->GetMask() & mask) != mask)
+			continue;
+
+		for (uint32_t chunk = 0; chunk < archetype->GetChunkCount(); chunk++)
+			chunks.push_back(SceneChunkView{ archetype.get(), chunk, archetype->GetChunkSize(chunk) });
+	}
+}
+
+uint32_t SceneWorld::FindArchetype(SceneComponentMask mask)
+{
+	auto it = archetypeIndices.find(mask);
+	if (it != archetypeIndices.end())
+		return it->second;
+
+	uint32_t index = (uint32_t)archetypes.size();
+	archetypes.push_back(std::make_unique<SceneArchetype>(mask));
+	archetypeIndices[mask] = index;
+	return index;
+}
+
+uint32_t SceneWorld::MoveEntity(SceneEntity entity, uint32_t to)
+{
+	SceneEntityRecord* record = entities.Get(entity);
+	SceneArchetype& source = *archetypes[record->Archetype];
+	SceneArchetype& target = *archetypes[to];
+
+	uint32_t row = target.AddRow(entity);
+	for (uint32_t id = 0; id < SCENE_MAX_COMPONENT_TYPES; id++)
+	{
+		void* moveTo = target.GetComponent(row, id);
+		void* moveFrom = source.GetComponent(record->Row, id);
+		if (moveTo && moveFrom)
+			GetSceneComponentInfo(id).MoveConstruct(moveTo, moveFrom);
+	}
+
+	// Whatever's left behind (moved from or dropped) goes
+	SceneEntity moved = source.RemoveRow(record->Row);
+	if (moved.IsValid())
+		entities.Get(moved)->Row = record->Row;
+
+	record->Archetype = to;
+	record->Row = row;
+	return row;
+}
+
+SceneSchedule::SceneSchedule() :
+	levelCount(0)
+{
+}
+
+// --------------------------------------------------------
+// Two systems conflict when either writes something the
+// other reads or writes.  A system runs the level after the
+// last earlier one it conflicts with.
+// --------------------------------------------------------
+uint32_t SceneSchedule::AddSystem(const char* name, SceneComponentMask reads, SceneComponentMask writes, SceneSystemFunction function)
+{
+	System system;
+	system.Name = name;
+	system.Reads = reads;
+	system.Writes = writes;
+	system.Level = 0;
+	system.Function = std::move(function);
+
+	for (const System& earlier : systems)
+	{
+		bool conflicts =
+			(earlier.Writes & (reads | writes)) != 0 ||
+			(writes & (earlier.Reads | earlier.Writes)) != 0;
+		if (conflicts && earlier.Level + 1 > system.Level)
+			system.Level = earlier.Level + 1;
+	}
+
+	levelCount = system.Level + 1 > levelCount ? system.Level + 1 : levelCount;
+	systems.push_back(std::move(system));
+	return (uint32_t)systems.size() - 1;
+}
+
+void SceneSchedule::Run(SceneWorld& world, JobSystem* jobs)
+{
+	// Every chunk each system touches, found before any run
+	for (System& system : systems)
+		world.GetChunks(system.Reads | system.Writes, system.Chunks);
+
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		// A level's systems run as jobs, and wait together
+		JobCounter levelDone;
+		for (System& system : systems)
+		{
+			if (system.Level != level || system.Chunks.empty())
+				continue;
+
+			if (jobs)
+				jobs->Run([this, &system, jobs](uint32_t thread) { RunSystem(system, jobs); }, &levelDone);
+			else
+				RunSystem(system, 0);
+		}
+
+		if (jobs)
+			jobs->Wait(levelDone);
+	}
+}
+
+void SceneSchedule::RunSystem(System& system, JobSystem* jobs)
+{
+	if (!jobs)
+	{
+		for (const SceneChunkView& chunk : system.Chunks)
+			system.Function(chunk, 0);
+		return;
+	}
+
+	jobs->ParallelFor((uint32_t)system.Chunks.size(), 1, [&system](uint32_t first, uint32_t end, uint32_t thread) {
+		for (uint32_t c = first; c < end; c++)
+			system.Function(system.Chunks[c], thread);
+	});
+}
@@ -0,0 +1,351 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <new>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "HandlePool.h"
+#include "JobSystem.h"
+
+// Component types there can be, across every world (one bit
+// each in a mask).  Types past this all get the id one past
+// the end, which no archetype stores.
+#define SCENE_MAX_COMPONENT_TYPES 64
+
+// Bytes in each chunk of an archetype's entities (more for
+// an archetype whose one entity is bigger than this)
+#define SCENE_CHUNK_SIZE (16 * 1024)
+
+// Columns start on cache lines (components can't need more)
+#define SCENE_CHUNK_ALIGNMENT 64
+
+// Marks a component an archetype doesn't have
+#define SCENE_NO_COLUMN 0xFFFFFFFF
+
+typedef uint64_t SceneComponentMask;
+
+// Where an entity's components are
+struct SceneEntityRecord
+{
+	uint32_t Archetype;
+	uint32_t Row;
+};
+
+// Entities are handles, so a destroyed one is caught
+typedef Handle<SceneEntityRecord> SceneEntity;
+
+// --------------------------------------------------------
+// What an archetype needs to know to move components from
+// row to row without knowing their types
+// --------------------------------------------------------
+struct SceneComponentInfo
+{
+	uint32_t Size;
+	uint32_t Alignment;
+	void (*MoveConstruct)(void* to, void* from);
+	void (*Destroy)(void* component);
+};
+
+uint32_t RegisterSceneComponent(const SceneComponentInfo& info);
+const SceneComponentInfo& GetSceneComponentInfo(uint32_t id);
+
+// --------------------------------------------------------
+// A component type's id, given out the first time the type
+// is used (const T is the same component as T).  Any
+// movable type can be a component.
+// --------------------------------------------------------
+template<typename T>
+uint32_t GetSceneComponentId()
+{
+	if constexpr (std::is_const_v<T>)
+		return GetSceneComponentId<std::remove_const_t<T>>();
+	else
+	{
+		static const uint32_t id = RegisterSceneComponent(SceneComponentInfo{
+			(uint32_t)sizeof(T),
+			(uint32_t)alignof(T),
+			[](void* to, void* from) { new (to) T(std::move(*(T*)from)); },
+			[](void* component) { ((T*)component)->~T(); } });
+		return id;
+	}
+}
+
+inline SceneComponentMask SceneComponentBit(uint32_t id)
+{
+	return id < SCENE_MAX_COMPONENT_TYPES ? (SceneComponentMask)1 << id : 0;
+}
+
+template<typename... Ts>
+SceneComponentMask GetSceneComponentMask()
+{
+	return ((SceneComponentMask)0 | ... | SceneComponentBit(GetSceneComponentId<Ts>()));
+}
+
+// --------------------------------------------------------
+// Every entity with one set of component types.  They're
+// stored in chunks, each with a column per type (and one
+// for the entities themselves), so a query walks arrays of
+// just the components it wants.  Rows stay packed: removing
+// one moves the last row into the hole.
+// --------------------------------------------------------
+class SceneArchetype
+{
+public:
+	SceneArchetype(SceneComponentMask mask);
+	~SceneArchetype();
+
+	SceneArchetype(const SceneArchetype&) = delete;
+	SceneArchetype& operator=(const SceneArchetype&) = delete;
+
+	// Adds a row for the entity, leaving its components for
+	// the caller to construct
+	uint32_t AddRow(SceneEntity entity);
+
+	// Destroys a row's components and fills the hole, giving
+	// back the entity that moved into it (if any)
+	SceneEntity RemoveRow(uint32_t row);
+
+	// Null if the archetype doesn't have the component
+	void* GetComponent(uint32_t row, uint32_t component) const
+	{
+		if (offsets[component] == SCENE_NO_COLUMN)
+			return 0;
+		return chunks[row / capacity] + offsets[component] + (size_t)(row % capacity) * sizes[component];
+	}
+	void* GetColumn(uint32_t chunk, uint32_t component) const
+	{
+		return offsets[component] == SCENE_NO_COLUMN ? 0 : chunks[chunk] + offsets[component];
+	}
+	SceneEntity* GetEntities(uint32_t chunk) const { return (SceneEntity*)chunks[chunk]; }
+
+	// Getters
+	SceneComponentMask GetMask() const { return mask; }
+	uint32_t GetCount() const { return count; }
+	uint32_t GetChunkCapacity() const { return capacity; }
+	uint32_t GetChunkCount() const { return (count + capacity - 1) / capacity; }
+	uint32_t GetChunkSize(uint32_t chunk) const { return count - chunk * capacity < capacity ? count - chunk * capacity : capacity; }
+
+private:
+	SceneComponentMask mask;
+	std::vector<uint32_t> components;
+
+	// Per component type: column offset in a chunk, and size
+	// (with a spare for types past the limit)
+	uint32_t offsets[SCENE_MAX_COMPONENT_TYPES + 1];
+	uint32_t sizes[SCENE_MAX_COMPONENT_TYPES + 1];
+
+	uint32_t capacity;	// Rows per chunk
+	uint32_t chunkBytes;
+	uint32_t count;
+	std::vector<uint8_t*> chunks;	// Kept when emptied, for reuse
+};
+
+// --------------------------------------------------------
+// Some of an archetype's entities, all in one chunk, with
+// their components as arrays
+// --------------------------------------------------------
+struct SceneChunkView
+{
+	SceneArchetype* Archetype;
+	uint32_t Chunk;
+	uint32_t Count;
+
+	template<typename T>
+	T* Get() const { return (T*)Archetype->GetColumn(Chunk, GetSceneComponentId<T>()); }
+	const SceneEntity* GetEntities() const { return Archetype->GetEntities(Chunk); }
+};
+
+// --------------------------------------------------------
+// Entities and their components, grouped by archetype.
+//
+// Entities are made with whatever components they start
+// with (one of each type), and can have more added or some
+// removed after, which moves them to another archetype.
+// Pointers to components only last until the next time an
+// entity is made, destroyed, added to or removed from, as
+// any of those can move rows.
+//
+// Not thread safe, and nothing can be made, destroyed,
+// added or removed while iterating.  Iterating (and
+// changing components in place) from several threads at
+// once is fine - SceneSchedule does that.
+// --------------------------------------------------------
+class SceneWorld
+{
+public:
+	SceneWorld();
+	~SceneWorld();
+
+	SceneWorld(const SceneWorld&) = delete;
+	SceneWorld& operator=(const SceneWorld&) = delete;
+
+	template<typename... Ts>
+	SceneEntity Create(Ts&&... components)
+	{
+		uint32_t archetype = FindArchetype(GetSceneComponentMask<std::decay_t<Ts>...>());
+		SceneEntity entity = entities.Create(SceneEntityRecord{ archetype, 0 });
+		uint32_t row = archetypes[archetype]->AddRow(entity);
+		entities.Get(entity)->Row = row;
+		(Construct(*archetypes[archetype], row, std::forward<Ts>(components)), ...);
+		return entity;
+	}
+
+	// False if the entity was already gone
+	bool Destroy(SceneEntity entity);
+	bool IsAlive(SceneEntity entity) const { return entities.IsAlive(entity); }
+
+	// Null if the entity is gone or doesn't have one
+	template<typename T>
+	T* Get(SceneEntity entity)
+	{
+		SceneEntityRecord* record = entities.Get(entity);
+		if (!record)
+			return 0;
+		return (T*)archetypes[record->Archetype]->GetComponent(record->Row, GetSceneComponentId<T>());
+	}
+
+	template<typename T>
+	bool Has(SceneEntity entity) { return Get<T>(entity) != 0; }
+
+	// Replaces the entity's component if it has one already
+	template<typename T>
+	std::decay_t<T>* Add(SceneEntity entity, T&& component)
+	{
+		typedef std::decay_t<T> Type;
+		if (Type* existing = Get<Type>(entity))
+		{
+			*existing = std::forward<T>(component);
+			return existing;
+		}
+
+		SceneEntityRecord* record = entities.Get(entity);
+		uint32_t id = GetSceneComponentId<Type>();
+		if (!record || !SceneComponentBit(id))
+			return 0;
+
+		uint32_t to = FindArchetype(archetypes[record->Archetype]->GetMask() | SceneComponentBit(id));
+		uint32_t row = MoveEntity(entity, to);
+		return new (archetypes[to]->GetComponent(row, id)) Type(std::forward<T>(component));
+	}
+
+	// False if the entity doesn't have one
+	template<typename T>
+	bool Remove(SceneEntity entity)
+	{
+		if (!Has<T>(entity))
+			return false;
+
+		SceneEntityRecord* record = entities.Get(entity);
+		MoveEntity(entity, FindArchetype(archetypes[record->Archetype]->GetMask() & ~GetSceneComponentMask<T>()));
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Calls function(count, Ts*... columns) for every chunk
+	// of entities that have all the Ts.  Loops over the
+	// columns in there are plain array loops, which the
+	// compiler can vectorize.
+	// --------------------------------------------------------
+	template<typename... Ts, typename Function>
+	void ForEachChunk(const Function& function)
+	{
+		SceneComponentMask mask = GetSceneComponentMask<Ts...>();
+		for (const std::unique_ptr<SceneArchetype>& archetype : archetypes)
+		{
+			if ((archetype->GetMask() & mask) != mask)
+				continue;
+
+			for (uint32_t chunk = 0; chunk < archetype->GetChunkCount(); chunk++)
+				function(archetype->GetChunkSize(chunk), (Ts*)archetype->GetColumn(chunk, GetSceneComponentId<Ts>())...);
+		}
+	}
+
+	// Calls function(Ts&...) for every entity that has all the Ts
+	template<typename... Ts, typename Function>
+	void ForEach(const Function& function)
+	{
+		ForEachChunk<Ts...>([&](uint32_t count, Ts*... columns) {
+			for (uint32_t i = 0; i < count; i++)
+				function(columns[i]...);
+		});
+	}
+
+	// Chunks of every entity with all of the mask's components
+	// (for splitting a query across threads)
+	void GetChunks(SceneComponentMask mask, std::vector<SceneChunkView>& chunks);
+
+	// Getters
+	uint32_t GetEntityCount() const { return entities.GetCount(); }
+	uint32_t GetArchetypeCount() const { return (uint32_t)archetypes.size(); }
+
+private:
+	template<typename T>
+	void Construct(SceneArchetype& archetype, uint32_t row, T&& component)
+	{
+		if (void* memory = archetype.GetComponent(row, GetSceneComponentId<std::decay_t<T>>()))
+			new (memory) std::decay_t<T>(std::forward<T>(component));
+	}
+
+	uint32_t FindArchetype(SceneComponentMask mask);
+
+	// Moves the components both archetypes have, leaving the
+	// new ones for the caller to construct
+	uint32_t MoveEntity(SceneEntity entity, uint32_t to);
+
+	HandlePool<SceneEntityRecord> entities;
+	std::vector<std::unique_ptr<SceneArchetype>> archetypes;
+	std::unordered_map<SceneComponentMask, uint32_t> archetypeIndices;
+};
+
+typedef std::function<void(const SceneChunkView& chunk, uint32_t thread)> SceneSystemFunction;
+
+// --------------------------------------------------------
+// Systems that run over a world's chunks, each saying which
+// components it reads and which it writes (it runs on the
+// entities that have all of them).  Systems run in the
+// order they were added, except that ones touching nothing
+// another writes run alongside it: each goes in the level
+// after the last earlier system it conflicts with, and a
+// level's systems run at once.  Each system's chunks are
+// split across the job system's threads too.
+//
+// The world can't change shape while the systems run.
+// --------------------------------------------------------
+class SceneSchedule
+{
+public:
+	SceneSchedule();
+
+	uint32_t AddSystem(const char* name, SceneComponentMask reads, SceneComponentMask writes, SceneSystemFunction function);
+
+	// Without a job system, everything runs on this thread
+	void Run(SceneWorld& world, JobSystem* jobs = 0);
+
+	// Getters
+	uint32_t GetSystemCount() const { return (uint32_t)systems.size(); }
+	uint32_t GetLevelCount() const { return levelCount; }
+	const char* GetSystemName(uint32_t system) const { return systems[system].Name.c_str(); }
+	uint32_t GetSystemLevel(uint32_t system) const { return systems[system].Level; }
+
+private:
+	struct System
+	{
+		std::string Name;
+		SceneComponentMask Reads;
+		SceneComponentMask Writes;
+		uint32_t Level;
+		SceneSystemFunction Function;
+		std::vector<SceneChunkView> Chunks;	// This run's
+	};
+
+	void RunSystem(System& system, JobSystem* jobs);
+
+	std::vector<System> systems;
+	uint32_t levelCount;
+};
@@ -0,0 +1,276 @@
+// --------------------------------------------------------
+// Tests SceneWorld's queries as entities move between
+// archetypes.  Thousands of entities (several chunks' worth
+// per archetype) have components added, replaced and
+// removed and are destroyed at random, and after every
+// round each way of reading the world must agree with a
+// plain list of what each entity should have:
+//
+//  - Get() and Has() on every entity, live or destroyed
+//  - ForEach() and ForEachChunk() over several component
+//    sets, which must visit each matching entity once
+//  - GetChunks(), whose entity columns must line up with
+//    their components
+//
+// A component that owns memory checks moves keep its value
+// and that every copy left behind is destroyed.
+// --------------------------------------------------------
+#include <memory>
+#include <vector>
+
+#include "SceneWorld.h"
+#include "TestCheck.h"
+
+#define ENTITY_COUNT 3000
+#define ROUND_COUNT 12
+
+// On every entity, saying which one it is
+struct EntityId
+{
+	uint32_t Value;
+};
+
+struct Position
+{
+	float X, Y, Z;
+};
+
+struct Velocity
+{
+	float X, Y, Z;
+};
+
+// Owns memory, and counts how many are alive
+struct Label
+{
+	static int Alive;
+	std::unique_ptr<int> Value;
+
+	Label(int value) : Value(new int(value)) { Alive++; }
+	Label(Label&& other) : Value(std::move(other.Value)) { Alive++; }
+	Label& operator=(Label&& other) { Value = std::move(other.Value); return *this; }
+	~Label() { Alive--; }
+};
+int Label::Alive = 0;
+
+// What an entity should have
+struct ModelEntity
+{
+	SceneEntity Handle;
+	bool Alive = false;
+	bool HasPosition = false;
+	bool HasVelocity = false;
+	bool HasLabel = false;
+	Position Pos = {};
+	Velocity Vel = {};
+	int LabelValue = 0;
+};
+
+static uint32_t seed = 2024;
+static uint32_t Random(uint32_t range)
+{
+	seed = seed * 1664525u + 1013904223u;
+	return (seed >> 8) % range;
+}
+
+static void Verify(SceneWorld& world, std::vector<ModelEntity>& model)
+{
+	// Get and Has, entity by entity
+	uint32_t alive = 0, positions = 0, moving = 0, labels = 0;
+	bool matches = true;
+	for (uint32_t i = 0; i < model.size(); i++)
+	{
+		const ModelEntity& m = model[i];
+		if (!m.Alive)
+		{
+			matches &= !world.IsAlive(m.Handle) && !world.Get<EntityId>(m.Handle) && !world.Has<Position>(m.Handle);
+			continue;
+		}
+
+		alive++;
+		positions += m.HasPosition;
+		moving += m.HasPosition && m.HasVelocity;
+		labels += m.HasLabel;
+
+		EntityId* id = world.Get<EntityId>(m.Handle);
+		Position* position = world.Get<Position>(m.Handle);
+		Velocity* velocity = world.Get<Velocity>(m.Handle);
+		Label* label = world.Get<Label>(m.Handle);
+		matches &= world.IsAlive(m.Handle) && id && id->Value == i;
+		matches &= (position != 0) == m.HasPosition && (!position || position->X == m.Pos.X);
+		matches &= (velocity != 0) == m.HasVelocity && (!velocity || velocity->Z == m.Vel.Z);
+		matches &= (label != 0) == m.HasLabel && (!label || (label->Value && *label->Value == m.LabelValue));
+	}
+	CHECK(matches);
+	CHECK(world.GetEntityCount() == alive);
+	CHECK(Label::Alive == (int)labels);
+
+	// Every live entity once
+	std::vector<uint32_t> visits(model.size(), 0);
+	world.ForEach<EntityId>([&](EntityId& id) { visits[id.Value]++; });
+	bool once = true;
+	for (uint32_t i = 0; i < model.size(); i++)
+		once &= visits[i] == (model[i].Alive ? 1u : 0u);
+	CHECK(once);
+
+	// Just the ones with both, with the right values
+	uint32_t visited = 0;
+	bool right = true;
+	world.ForEach<const EntityId, Position, const Velocity>([&](const EntityId& id, Position& position, const Velocity& velocity) {
+		const ModelEntity& m = model[id.Value];
+		right &= m.Alive && m.HasPosition && m.HasVelocity;
+		right &= position.Y == m.Pos.Y && velocity.X == m.Vel.X;
+		visited++;
+	});
+	CHECK(right);
+	CHECK(visited == moving);
+
+	// Chunk by chunk, adding up to the same counts
+	uint32_t chunked = 0;
+	world.ForEachChunk<Position>([&](uint32_t count, Position* column) { chunked += count; });
+	CHECK(chunked == positions);
+	uint32_t labelled = 0;
+	bool labelsRight = true;
+	world.ForEachChunk<EntityId, Label>([&](uint32_t count, EntityId* ids, Label* column) {
+		for (uint32_t i = 0; i < count; i++)
+			labelsRight &= *column[i].Value == model[ids[i].Value].LabelValue;
+		labelled += count;
+	});
+	CHECK(labelsRight);
+	CHECK(labelled == labels);
+
+	// Chunk views' entity columns line up with their components
+	std::vector<SceneChunkView> chunks;
+	world.GetChunks(GetSceneComponentMask<EntityId, Velocity>(), chunks);
+	bool lined = true;
+	uint32_t viewed = 0;
+	for (const SceneChunkView& chunk : chunks)
+	{
+		const SceneEntity* entities = chunk.GetEntities();
+		EntityId* ids = chunk.Get<EntityId>();
+		Velocity* velocities = chunk.Get<Velocity>();
+		for (uint32_t i = 0; i < chunk.Count; i++)
+		{
+			const ModelEntity& m = model[ids[i].Value];
+			lined &= entities[i] == m.Handle && m.HasVelocity && velocities[i].Y == m.Vel.Y;
+		}
+		viewed += chunk.Count;
+	}
+	CHECK(lined);
+	uint32_t withVelocity = 0;
+	for (const ModelEntity& m : model)
+		withVelocity += m.Alive && m.HasVelocity;
+	CHECK(viewed == withVelocity);
+}
+
+static void TestArchetypeMoves()
+{
+	{
+		SceneWorld world;
+		std::vector<ModelEntity> model(ENTITY_COUNT);
+
+		// Start everyone in one of a few archetypes
+		for (uint32_t i = 0; i < ENTITY_COUNT; i++)
+		{
+			ModelEntity& m = model[i];
+			m.Alive = true;
+			m.Pos = { (float)i, (float)i * 2, 0 };
+			m.Vel = { 1, (float)i, (float)i * 3 };
+			switch (i % 3)
+			{
+			case 0:
+				m.Handle = world.Create(EntityId{ i });
+				break;
+			case 1:
+				m.Handle = world.Create(EntityId{ i }, m.Pos);
+				m.HasPosition = true;
+				break;
+			default:
+				m.Handle = world.Create(EntityId{ i }, m.Pos, m.Vel);
+				m.HasPosition = m.HasVelocity = true;
+				break;
+			}
+		}
+		CHECK(world.GetArchetypeCount() == 3);
+		Verify(world, model);
+
+		for (uint32_t round = 0; round < ROUND_COUNT; round++)
+		{
+			for (uint32_t change = 0; change < ENTITY_COUNT; change++)
+			{
+				uint32_t i = Random(ENTITY_COUNT);
+				ModelEntity& m = model[i];
+				uint32_t what = Random(8);
+				if (!m.Alive)
+				{
+					// Destroying again does nothing, and neither does
+					// adding to a destroyed entity
+					CHECK(!world.Destroy(m.Handle));
+					CHECK(!world.Add(m.Handle, Position{ 1, 2, 3 }));
+					CHECK(!world.Remove<Position>(m.Handle));
+					continue;
+				}
+
+				switch (what)
+				{
+				case 0:	// Add or replace a position
+					m.Pos = { (float)(round * 10000 + change), (float)change, 0 };
+					world.Add(m.Handle, m.Pos);
+					m.HasPosition = true;
+					break;
+				case 1:	// Add or replace a velocity
+					m.Vel = { (float)change, (float)round, (float)i };
+					world.Add(m.Handle, m.Vel);
+					m.HasVelocity = true;
+					break;
+				case 2:	// Add or replace a label
+					m.LabelValue = (int)(round * 100000 + change);
+					world.Add(m.Handle, Label(m.LabelValue));
+					m.HasLabel = true;
+					break;
+				case 3:
+					CHECK(world.Remove<Position>(m.Handle) == m.HasPosition);
+					m.HasPosition = false;
+					break;
+				case 4:
+					CHECK(world.Remove<Velocity>(m.Handle) == m.HasVelocity);
+					m.HasVelocity = false;
+					break;
+				case 5:
+					CHECK(world.Remove<Label>(m.Handle) == m.HasLabel);
+					m.HasLabel = false;
+					break;
+				case 6:	// Change in place
+					if (Position* position = world.Get<Position>(m.Handle))
+					{
+						position->Y += 1;
+						m.Pos.Y += 1;
+					}
+					break;
+				default:
+					if (Random(4) == 0)
+					{
+						CHECK(world.Destroy(m.Handle));
+						m.Alive = false;
+						m.HasLabel = false;
+					}
+					break;
+				}
+			}
+
+			Verify(world, model);
+		}
+
+		// Every combination of the four has been made by now
+		CHECK(world.GetArchetypeCount() == 8);
+	}
+
+	// Whatever was left went with the world
+	CHECK(Label::Alive == 0);
+}
+
+int main()
+{
+	TestArchetypeMoves();
+	return TestResult();
+}
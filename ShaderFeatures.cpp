@@ -0,0 +1,68 @@
+#include "ShaderFeatures.h"
+
+// Constructor - Unknown flags are dropped and the light
+// count is clamped, so equal sets always produce equal keys
+ShaderFeatureSet::ShaderFeatureSet(uint32_t flags, uint32_t lightCount) :
+	Flags(flags & SHADER_FEATURE_ALL),
+	LightCount(lightCount > SHADER_MAX_LIGHTS ? SHADER_MAX_LIGHTS : lightCount)
+{
+	// Clustered shaders don't have a fixed size light array
+	if (Flags & SHADER_FEATURE_CLUSTERED)
+		LightCount = 0;
+}
+
+// --------------------------------------------------------
+// Packs the feature set into a single integer
+// --------------------------------------------------------
+uint32_t ShaderFeatureSet::GetKey() const
+{
+	ShaderFeatureSet clean(Flags, LightCount);
+	return (clean.Flags & 0xFF) | ((clean.LightCount & 0xFF) << 8);
+}
+
+// --------------------------------------------------------
+// Unpacks a key made by GetKey()
+// --------------------------------------------------------
+ShaderFeatureSet ShaderFeatureSet::FromKey(uint32_t key)
+{
+	return ShaderFeatureSet(key & 0xFF, (key >> 8) & 0xFF);
+}
+
+// --------------------------------------------------------
+// Builds the preprocessor defines for this permutation.
+// Every define is always present (as 0 or 1) so the shader
+// can use #if rather than #ifdef.
+// --------------------------------------------------------
+std::vector<ShaderDefine> ShaderFeatureSet::GetDefines() const
+{
+	ShaderFeatureSet clean(Flags, LightCount);
+
+	std::vector<ShaderDefine> defines;
+	defines.push_back({ "FEATURE_NORMAL_MAP", clean.Has(SHADER_FEATURE_NORMAL_MAP) ? "1" : "0" });
+	defines.push_back({ "FEATURE_SHADOWS", clean.Has(SHADER_FEATURE_SHADOWS) ? "1" : "0" });
+	defines.push_back({ "FEATURE_PBR", clean.Has(SHADER_FEATURE_PBR) ? "1" : "0" });
+	defines.push_back({ "FEATURE_CLUSTERED", clean.Has(SHADER_FEATURE_CLUSTERED) ? "1" : "0" });
+	defines.push_back({ "LIGHT_COUNT", std::to_string(clean.LightCount) });
+	return defines;
+}
+
+// --------------------------------------------------------
+// A short, file-name-safe description like "NRM_SHD_PBR_L6"
+// --------------------------------------------------------
+std::string ShaderFeatureSet::GetName() const
+{
+	ShaderFeatureSet clean(Flags, LightCount);
+
+	std::string name;
+	if (clean.Has(SHADER_FEATURE_NORMAL_MAP)) name += "NRM_";
+	if (clean.Has(SHADER_FEATURE_SHADOWS)) name += "SHD_";
+	name += clean.Has(SHADER_FEATURE_PBR) ? "PBR_" : "PHONG_";
+	if (clean.Has(SHADER_FEATURE_CLUSTERED))
+		name += "CLUSTERED";
+	else
+	{
+		name += "L";
+		name += std::to_string(clean.LightCount);
+	}
+	return name;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// Optional pixel shader features - each one maps to a
+// FEATURE_* define in UberPS.hlsli
+#define SHADER_FEATURE_NONE			0u
+#define SHADER_FEATURE_NORMAL_MAP	(1u << 0)
+#define SHADER_FEATURE_SHADOWS		(1u << 1)
+#define SHADER_FEATURE_PBR			(1u << 2)
+#define SHADER_FEATURE_CLUSTERED	(1u << 3)
+#define SHADER_FEATURE_ALL			(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_SHADOWS | SHADER_FEATURE_PBR | SHADER_FEATURE_CLUSTERED)
+
+// Largest light array a permutation can be built with
+#define SHADER_MAX_LIGHTS 64u
+
+// A single preprocessor define for a permutation
+struct ShaderDefine
+{
+	std::string Name;
+	std::string Value;
+};
+
+// --------------------------------------------------------
+// The set of features a material needs from its pixel
+// shader.  Every distinct set is one shader permutation,
+// identified by a compact integer key:
+//
+//   bits  0-7  : SHADER_FEATURE_* flags
+//   bits  8-15 : light count (always 0 when clustered, as
+//                the lights come from a structured buffer)
+// --------------------------------------------------------
+struct ShaderFeatureSet
+{
+	uint32_t Flags = SHADER_FEATURE_NONE;
+	uint32_t LightCount = 0;
+
+	ShaderFeatureSet() = default;
+	ShaderFeatureSet(uint32_t flags, uint32_t lightCount);
+
+	bool Has(uint32_t feature) const { return (Flags & feature) == feature; }
+
+	// Key packing
+	uint32_t GetKey() const;
+	static ShaderFeatureSet FromKey(uint32_t key);
+
+	// Defines passed to the compiler, and a readable name (for files & logs)
+	std::vector<ShaderDefine> GetDefines() const;
+	std::string GetName() const;
+
+	bool operator==(const ShaderFeatureSet& other) const { return GetKey() == other.GetKey(); }
+	bool operator!=(const ShaderFeatureSet& other) const { return GetKey() != other.GetKey(); }
+};
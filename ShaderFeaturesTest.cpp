@@ -0,0 +1,158 @@
+// --------------------------------------------------------
+// Tests ShaderFeatureSet and ShaderVariantCache:
+//
+//  - keys pack flags and light count, and every set
+//    survives FromKey(GetKey())
+//  - unknown flags are dropped, light counts clamp to
+//    SHADER_MAX_LIGHTS, and clustered sets have none
+//  - the defines and readable names
+//  - the cache only calls its factory for keys it hasn't
+//    seen, including ones that failed
+// --------------------------------------------------------
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ShaderFeatures.h"
+#include "ShaderVariantCache.h"
+#include "TestCheck.h"
+
+static void TestKeyPacking()
+{
+	ShaderFeatureSet none;
+	CHECK(none.GetKey() == 0);
+
+	ShaderFeatureSet set(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_PBR, 6);
+	CHECK(set.GetKey() == ((SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_PBR) | (6u << 8)));
+
+	// Every flag combination and light count round trips
+	for (uint32_t flags = 0; flags <= SHADER_FEATURE_ALL; flags++)
+	{
+		for (uint32_t lights = 0; lights <= SHADER_MAX_LIGHTS; lights++)
+		{
+			ShaderFeatureSet original(flags, lights);
+			ShaderFeatureSet unpacked = ShaderFeatureSet::FromKey(original.GetKey());
+			CHECK(unpacked == original);
+			CHECK(unpacked.Flags == original.Flags);
+			CHECK(unpacked.LightCount == original.LightCount);
+		}
+	}
+}
+
+static void TestClamping()
+{
+	// Unknown flags are dropped
+	ShaderFeatureSet unknown(SHADER_FEATURE_SHADOWS | (1u << 7), 2);
+	CHECK(unknown.Flags == SHADER_FEATURE_SHADOWS);
+	CHECK(unknown == ShaderFeatureSet(SHADER_FEATURE_SHADOWS, 2));
+
+	// Light counts stop at the largest array
+	CHECK(ShaderFeatureSet(0, SHADER_MAX_LIGHTS).LightCount == SHADER_MAX_LIGHTS);
+	CHECK(ShaderFeatureSet(0, SHADER_MAX_LIGHTS + 1).LightCount == SHADER_MAX_LIGHTS);
+	CHECK(ShaderFeatureSet(0, 1000).LightCount == SHADER_MAX_LIGHTS);
+	CHECK(ShaderFeatureSet(0, 1000) == ShaderFeatureSet(0, SHADER_MAX_LIGHTS));
+
+	// Clustered sets don't have a light array, so any count is the same set
+	ShaderFeatureSet clustered(SHADER_FEATURE_CLUSTERED, 12);
+	CHECK(clustered.LightCount == 0);
+	CHECK(clustered == ShaderFeatureSet(SHADER_FEATURE_CLUSTERED, 40));
+
+	// Fields changed after construction are cleaned when packed
+	ShaderFeatureSet edited;
+	edited.Flags = SHADER_FEATURE_CLUSTERED;
+	edited.LightCount = 9;
+	CHECK(edited.GetKey() == SHADER_FEATURE_CLUSTERED);
+	edited.Flags = SHADER_FEATURE_NONE;
+	edited.LightCount = 300;
+	CHECK(ShaderFeatureSet::FromKey(edited.GetKey()).LightCount == SHADER_MAX_LIGHTS);
+}
+
+// The value of a define, or "" if it's missing
+static std::string FindDefine(const std::vector<ShaderDefine>& defines, const std::string& name)
+{
+	for (const ShaderDefine& define : defines)
+	{
+		if (define.Name == name)
+			return define.Value;
+	}
+	return "";
+}
+
+static void TestDefinesAndNames()
+{
+	std::vector<ShaderDefine> defines = ShaderFeatureSet(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_PBR, 5).GetDefines();
+	CHECK(defines.size() == 5);
+	CHECK(FindDefine(defines, "FEATURE_NORMAL_MAP") == "1");
+	CHECK(FindDefine(defines, "FEATURE_SHADOWS") == "0");
+	CHECK(FindDefine(defines, "FEATURE_PBR") == "1");
+	CHECK(FindDefine(defines, "FEATURE_CLUSTERED") == "0");
+	CHECK(FindDefine(defines, "LIGHT_COUNT") == "5");
+
+	defines = ShaderFeatureSet(SHADER_FEATURE_CLUSTERED, 5).GetDefines();
+	CHECK(FindDefine(defines, "FEATURE_CLUSTERED") == "1");
+	CHECK(FindDefine(defines, "LIGHT_COUNT") == "0");
+	CHECK(FindDefine(ShaderFeatureSet(0, 500).GetDefines(), "LIGHT_COUNT") == "64");
+
+	CHECK(ShaderFeatureSet().GetName() == "PHONG_L0");
+	CHECK(ShaderFeatureSet(SHADER_FEATURE_NORMAL_MAP | SHADER_FEATURE_SHADOWS | SHADER_FEATURE_PBR, 6).GetName() == "NRM_SHD_PBR_L6");
+	CHECK(ShaderFeatureSet(SHADER_FEATURE_SHADOWS | SHADER_FEATURE_CLUSTERED, 6).GetName() == "SHD_PHONG_CLUSTERED");
+	CHECK(ShaderFeatureSet(0, 500).GetName() == "PHONG_L64");
+}
+
+static void TestCache()
+{
+	// Stands in for the compiler - "compiles" to the key, and
+	// fails for anything with shadows
+	std::vector<uint32_t> compiled;
+	ShaderVariantCache<uint32_t> cache([&](const ShaderFeatureSet& features) {
+		compiled.push_back(features.GetKey());
+		return features.Has(SHADER_FEATURE_SHADOWS) ? std::shared_ptr<uint32_t>() : std::make_shared<uint32_t>(features.GetKey());
+	});
+
+	ShaderFeatureSet pbr(SHADER_FEATURE_PBR, 4);
+	CHECK(!cache.Contains(pbr));
+	std::shared_ptr<uint32_t> first = cache.Get(pbr);
+	CHECK(first && *first == pbr.GetKey());
+	CHECK(cache.Contains(pbr));
+	CHECK(cache.GetFactoryCallCount() == 1);
+
+	// Hits, including sets that only match once cleaned
+	CHECK(cache.Get(pbr) == first);
+	CHECK(cache.Get(ShaderFeatureSet(SHADER_FEATURE_PBR | (1u << 6), 4)) == first);
+	CHECK(cache.GetFactoryCallCount() == 1);
+
+	// A miss
+	std::shared_ptr<uint32_t> other = cache.Get(ShaderFeatureSet(SHADER_FEATURE_PBR, 5));
+	CHECK(other && other != first);
+	CHECK(cache.GetFactoryCallCount() == 2);
+
+	// A failure is cached too, not retried
+	ShaderFeatureSet broken(SHADER_FEATURE_SHADOWS, 1);
+	CHECK(!cache.Get(broken));
+	CHECK(!cache.Get(broken));
+	CHECK(cache.Contains(broken));
+	CHECK(cache.GetFactoryCallCount() == 3);
+	CHECK(cache.GetVariantCount() == 3);
+
+	// The factory sees the cleaned set
+	CHECK(compiled.size() == 3 && compiled[0] == pbr.GetKey());
+
+	unsigned int visited = 0;
+	cache.ForEach([&](const std::shared_ptr<uint32_t>&) { visited++; });
+	CHECK(visited == 3);
+
+	// Clearing builds everything again
+	cache.Clear();
+	CHECK(!cache.Contains(pbr));
+	CHECK(cache.Get(pbr) != first);
+	CHECK(cache.GetFactoryCallCount() == 4);
+}
+
+int main()
+{
+	TestKeyPacking();
+	TestClamping();
+	TestDefinesAndNames();
+	TestCache();
+	return TestResult();
+}
@@ -38,7 +38,6 @@ struct VertexToPixel
 	float2 uv				: TEXCOORD;
 	float3 tangent			: TANGENT;
 	float3 worldPos			: POSITION;
-	float4 shadowMapPos		: SHADOWPOS;
 };
 
 // Special VertexToPixel for the SkyBox
@@ -0,0 +1,152 @@
+#include "ShaderPermutations.h"
+#include "PathHelpers.h"
+
+#include <d3dcompiler.h>
+#include <filesystem>
+#include <vector>
+
+// --------------------------------------------------------
+// Constructor
+//
+// sourceFile     - Full path to the uber shader source
+// variantPrefix  - Full path (minus extension) for compiled
+//                  variants, e.g. FixPath(L"UberPS")
+// fallbackShader - Returned when a variant can't be built
+// --------------------------------------------------------
+ShaderPermutations::ShaderPermutations(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	std::wstring sourceFile,
+	std::wstring variantPrefix,
+	std::shared_ptr<SimplePixelShader> fallbackShader)
+	:
+	device(device),
+	context(context),
+	sourceFile(sourceFile),
+	variantPrefix(variantPrefix),
+	fallbackShader(fallbackShader),
+	variants([this](const ShaderFeatureSet& features) { return CreateVariant(features); })
+{
+}
+
+// Destructor
+ShaderPermutations::~ShaderPermutations()
+{
+}
+
+// --------------------------------------------------------
+// Gets the variant for a feature set, or the fallback
+// shader if that variant couldn't be built
+// --------------------------------------------------------
+std::shared_ptr<SimplePixelShader> ShaderPermutations::GetPixelShader(const ShaderFeatureSet& features)
+{
+	std::shared_ptr<SimplePixelShader> variant = variants.Get(features);
+	return variant ? variant : fallbackShader;
+}
+
+// --------------------------------------------------------
+// Shares a constant buffer ring with all variants
+// --------------------------------------------------------
+void ShaderPermutations::SetConstantBufferRing(std::shared_ptr<ConstantBufferRing> ring)
+{
+	constantBufferRing = ring;
+
+	variants.ForEach([ring](const std::shared_ptr<SimplePixelShader>& variant)
+		{
+			if (variant) variant->SetConstantBufferRing(ring);
+		});
+}
+
+// Get the number of variants requested so far
+size_t ShaderPermutations::GetVariantCount()
+{
+	return variants.GetVariantCount();
+}
+
+// --------------------------------------------------------
+// Loads a previously compiled variant if it's still valid,
+// otherwise compiles it from source and saves it
+// --------------------------------------------------------
+std::shared_ptr<SimplePixelShader> ShaderPermutations::CreateVariant(const ShaderFeatureSet& features)
+{
+	std::wstring variantFile = variantPrefix + L"_" + NarrowToWide(features.GetName()) + L".cso";
+
+	if (!IsVariantUpToDate(variantFile))
+	{
+		// Build the define list (the array must be null terminated)
+		std::vector<ShaderDefine> defines = features.GetDefines();
+		std::vector<D3D_SHADER_MACRO> macros;
+		for (auto& d : defines)
+			macros.push_back({ d.Name.c_str(), d.Value.c_str() });
+		macros.push_back({ 0, 0 });
+
+		UINT flags = D3DCOMPILE_ENABLE_STRICTNESS;
+#if defined(DEBUG) || defined(_DEBUG)
+		flags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+		flags |= D3DCOMPILE_OPTIMIZATION_LEVEL3;
+#endif
+
+		Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
+		Microsoft::WRL::ComPtr<ID3DBlob> errorBlob;
+		HRESULT hr = D3DCompileFromFile(
+			sourceFile.c_str(),
+			macros.data(),
+			D3D_COMPILE_STANDARD_FILE_INCLUDE,
+			"main",
+			"ps_5_0",
+			flags,
+			0,
+			shaderBlob.GetAddressOf(),
+			errorBlob.GetAddressOf());
+
+		if (FAILED(hr))
+		{
+			if (errorBlob)
+				OutputDebugStringA((char*)errorBlob->GetBufferPointer());
+			return 0;
+		}
+
+		// Save it so the next run can skip the compile
+		hr = D3DWriteBlobToFile(shaderBlob.Get(), variantFile.c_str(), TRUE);
+		if (FAILED(hr))
+			return 0;
+	}
+
+	std::shared_ptr<SimplePixelShader> variant = std::make_shared<SimplePixelShader>(device, context, variantFile.c_str());
+	if (!variant->IsShaderValid())
+		return 0;
+
+	variant->SetConstantBufferRing(constantBufferRing);
+	return variant;
+}
+
+// --------------------------------------------------------
+// A compiled variant is valid if it's newer than the
+// source file and every .hlsli include beside it
+// --------------------------------------------------------
+bool ShaderPermutations::IsVariantUpToDate(const std::wstring& variantFile)
+{
+	std::error_code ec;
+	std::filesystem::file_time_type variantTime = std::filesystem::last_write_time(variantFile, ec);
+	if (ec)
+		return false;
+
+	// Without the source (like a shipped build) the variant is all we have
+	std::filesystem::path source(sourceFile);
+	std::filesystem::file_time_type sourceTime = std::filesystem::last_write_time(source, ec);
+	if (ec)
+		return true;
+
+	if (sourceTime > variantTime)
+		return false;
+
+	for (auto& entry : std::filesystem::directory_iterator(source.parent_path(), ec))
+	{
+		if (entry.path().extension() == L".hlsli" &&
+			entry.last_write_time(ec) > variantTime)
+			return false;
+	}
+
+	return true;
+}
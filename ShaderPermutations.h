@@ -0,0 +1,55 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <string>
+
+#include "SimpleShader.h"
+#include "ShaderFeatures.h"
+#include "ShaderVariantCache.h"
+
+// --------------------------------------------------------
+// Builds pixel shader permutations of one uber shader on
+// demand, one per ShaderFeatureSet.
+//
+// A variant is compiled the first time it's requested and
+// written next to the executable as "<prefix>_<name>.cso",
+// so later runs just load it (unless the source or one of
+// the .hlsli files beside it has been edited since).
+// --------------------------------------------------------
+class ShaderPermutations
+{
+public:
+	ShaderPermutations(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		std::wstring sourceFile,
+		std::wstring variantPrefix,
+		std::shared_ptr<SimplePixelShader> fallbackShader);
+	~ShaderPermutations();
+
+	// Gets (and creates, if necessary) the variant for a feature set
+	std::shared_ptr<SimplePixelShader> GetPixelShader(const ShaderFeatureSet& features);
+
+	// Applied to every variant, including ones created later
+	void SetConstantBufferRing(std::shared_ptr<ConstantBufferRing> ring);
+
+	size_t GetVariantCount();
+
+private:
+	std::shared_ptr<SimplePixelShader> CreateVariant(const ShaderFeatureSet& features);
+	bool IsVariantUpToDate(const std::wstring& variantFile);
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+	std::wstring sourceFile;
+	std::wstring variantPrefix;
+
+	// Used when a variant fails to compile or load
+	std::shared_ptr<SimplePixelShader> fallbackShader;
+	std::shared_ptr<ConstantBufferRing> constantBufferRing;
+
+	ShaderVariantCache<SimplePixelShader> variants;
+};
@@ -0,0 +1,327 @@
+#include "ShaderReflectionCache.h"
+
+#include <fstream>
+
+// File identification - bump the version whenever the layout changes
+#define REFLECTION_CACHE_MAGIC 0x4C465253u // "SRFL"
+#define REFLECTION_CACHE_VERSION 1u
+
+// Upper bound on any single string, to reject garbage early
+#define REFLECTION_CACHE_MAX_STRING 4096u
+
+// Cache files are tiny, so anything bigger than this is not ours
+#define REFLECTION_CACHE_MAX_FILE (16u * 1024u * 1024u)
+
+// --------------------------------------------------------
+// Appends fixed-size little-endian values to a byte array
+// --------------------------------------------------------
+struct ReflectionWriter
+{
+	std::vector<unsigned char>* bytes;
+
+	void U32(uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+			bytes->push_back((unsigned char)(value >> (i * 8)));
+	}
+
+	void U64(uint64_t value)
+	{
+		for (int i = 0; i < 8; i++)
+			bytes->push_back((unsigned char)(value >> (i * 8)));
+	}
+
+	void String(const std::string& value)
+	{
+		U32((uint32_t)value.size());
+		bytes->insert(bytes->end(), value.begin(), value.end());
+	}
+};
+
+// --------------------------------------------------------
+// Reads values back out, failing (and staying failed) the
+// moment anything would read past the end
+// --------------------------------------------------------
+struct ReflectionReader
+{
+	const unsigned char* bytes;
+	size_t size;
+	size_t position;
+	bool failed;
+
+	size_t Remaining() { return failed ? 0 : size - position; }
+
+	bool U32(uint32_t* value)
+	{
+		if (Remaining() < 4) { failed = true; return false; }
+
+		*value = 0;
+		for (int i = 0; i < 4; i++)
+			*value |= (uint32_t)bytes[position + i] << (i * 8);
+		position += 4;
+		return true;
+	}
+
+	bool U64(uint64_t* value)
+	{
+		if (Remaining() < 8) { failed = true; return false; }
+
+		*value = 0;
+		for (int i = 0; i < 8; i++)
+			*value |= (uint64_t)bytes[position + i] << (i * 8);
+		position += 8;
+		return true;
+	}
+
+	bool String(std::string* value)
+	{
+		uint32_t length = 0;
+		if (!U32(&length)) return false;
+		if (length > REFLECTION_CACHE_MAX_STRING || length > Remaining()) { failed = true; return false; }
+
+		value->assign((const char*)bytes + position, length);
+		position += length;
+		return true;
+	}
+
+	// Reads an element count, making sure the remaining data could
+	// actually hold that many elements before anything is allocated
+	bool Count(uint32_t* count, size_t minimumElementSize)
+	{
+		if (!U32(count)) return false;
+		if (*count > Remaining() / minimumElementSize) { failed = true; return false; }
+		return true;
+	}
+};
+
+// Per-type helpers, shared by both directions
+static void WriteResources(ReflectionWriter& w, const std::vector<ShaderReflectionResource>& resources)
+{
+	w.U32((uint32_t)resources.size());
+	for (auto& r : resources)
+	{
+		w.String(r.Name);
+		w.U32(r.BindIndex);
+	}
+}
+
+static bool ReadResources(ReflectionReader& r, std::vector<ShaderReflectionResource>* resources)
+{
+	uint32_t count = 0;
+	if (!r.Count(&count, 8)) return false;
+
+	resources->resize(count);
+	for (auto& res : *resources)
+	{
+		if (!r.String(&res.Name) || !r.U32(&res.BindIndex))
+			return false;
+	}
+	return true;
+}
+
+static void WriteSignature(ReflectionWriter& w, const std::vector<ShaderReflectionSignatureElement>& elements)
+{
+	w.U32((uint32_t)elements.size());
+	for (auto& e : elements)
+	{
+		w.String(e.SemanticName);
+		w.U32(e.SemanticIndex);
+		w.U32(e.Mask);
+		w.U32(e.ComponentType);
+		w.U32(e.Stream);
+	}
+}
+
+static bool ReadSignature(ReflectionReader& r, std::vector<ShaderReflectionSignatureElement>* elements)
+{
+	uint32_t count = 0;
+	if (!r.Count(&count, 20)) return false;
+
+	elements->resize(count);
+	for (auto& e : *elements)
+	{
+		if (!r.String(&e.SemanticName) ||
+			!r.U32(&e.SemanticIndex) ||
+			!r.U32(&e.Mask) ||
+			!r.U32(&e.ComponentType) ||
+			!r.U32(&e.Stream))
+			return false;
+	}
+	return true;
+}
+
+
+// --------------------------------------------------------
+// 64-bit FNV-1a hash of the shader bytecode
+// --------------------------------------------------------
+uint64_t ShaderReflectionCache::HashBytecode(const void* bytecode, size_t size)
+{
+	const unsigned char* data = (const unsigned char*)bytecode;
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// --------------------------------------------------------
+// Converts reflection data to its binary form
+// --------------------------------------------------------
+void ShaderReflectionCache::Serialize(const ShaderReflectionData& data, std::vector<unsigned char>* bytes)
+{
+	bytes->clear();
+	ReflectionWriter w = { bytes };
+
+	// Header
+	w.U32(REFLECTION_CACHE_MAGIC);
+	w.U32(REFLECTION_CACHE_VERSION);
+	w.U64(data.BytecodeHash);
+
+	// Constant buffers and their variables
+	w.U32((uint32_t)data.ConstantBuffers.size());
+	for (auto& cb : data.ConstantBuffers)
+	{
+		w.String(cb.Name);
+		w.U32(cb.Type);
+		w.U32(cb.BindIndex);
+		w.U32(cb.Size);
+		w.U32((uint32_t)cb.Variables.size());
+		for (auto& v : cb.Variables)
+		{
+			w.String(v.Name);
+			w.U32(v.ByteOffset);
+			w.U32(v.Size);
+		}
+	}
+
+	// Bound resources
+	WriteResources(w, data.Textures);
+	WriteResources(w, data.Samplers);
+	WriteResources(w, data.UnorderedAccessViews);
+
+	// Signatures
+	WriteSignature(w, data.InputElements);
+	WriteSignature(w, data.OutputElements);
+
+	// Thread group size
+	w.U32(data.ThreadsX);
+	w.U32(data.ThreadsY);
+	w.U32(data.ThreadsZ);
+}
+
+// --------------------------------------------------------
+// Parses binary reflection data
+//
+// Returns false (leaving "data" in an unspecified state) if
+// the bytes are truncated, malformed or a different version
+// --------------------------------------------------------
+bool ShaderReflectionCache::Deserialize(const unsigned char* bytes, size_t size, ShaderReflectionData* data)
+{
+	if (!bytes || !data) return false;
+	ReflectionReader r = { bytes, size, 0, false };
+
+	// Header
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	if (!r.U32(&magic) || magic != REFLECTION_CACHE_MAGIC) return false;
+	if (!r.U32(&version) || version != REFLECTION_CACHE_VERSION) return false;
+	if (!r.U64(&data->BytecodeHash)) return false;
+
+	// Constant buffers and their variables
+	uint32_t bufferCount = 0;
+	if (!r.Count(&bufferCount, 20)) return false;
+	data->ConstantBuffers.resize(bufferCount);
+	for (auto& cb : data->ConstantBuffers)
+	{
+		if (!r.String(&cb.Name) ||
+			!r.U32(&cb.Type) ||
+			!r.U32(&cb.BindIndex) ||
+			!r.U32(&cb.Size))
+			return false;
+
+		uint32_t varCount = 0;
+		if (!r.Count(&varCount, 12)) return false;
+		cb.Variables.resize(varCount);
+		for (auto& v : cb.Variables)
+		{
+			if (!r.String(&v.Name) || !r.U32(&v.ByteOffset) || !r.U32(&v.Size))
+				return false;
+
+			// Variables must live inside their buffer
+			if (v.ByteOffset > cb.Size || v.Size > cb.Size - v.ByteOffset)
+				return false;
+		}
+	}
+
+	// Bound resources
+	if (!ReadResources(r, &data->Textures)) return false;
+	if (!ReadResources(r, &data->Samplers)) return false;
+	if (!ReadResources(r, &data->UnorderedAccessViews)) return false;
+
+	// Signatures
+	if (!ReadSignature(r, &data->InputElements)) return false;
+	if (!ReadSignature(r, &data->OutputElements)) return false;
+
+	// Thread group size
+	if (!r.U32(&data->ThreadsX) || !r.U32(&data->ThreadsY) || !r.U32(&data->ThreadsZ))
+		return false;
+
+	// Trailing bytes mean this isn't something we wrote
+	return r.Remaining() == 0;
+}
+
+// --------------------------------------------------------
+// The cache lives next to the compiled shader:
+// "Shader.cso" -> "Shader.refl"
+// --------------------------------------------------------
+std::filesystem::path ShaderReflectionCache::GetCachePath(const std::filesystem::path& shaderFile)
+{
+	std::filesystem::path cacheFile = shaderFile;
+	cacheFile.replace_extension(".refl");
+	return cacheFile;
+}
+
+// --------------------------------------------------------
+// Loads cached reflection data, but only if it was made
+// from bytecode with the given hash
+// --------------------------------------------------------
+bool ShaderReflectionCache::Load(const std::filesystem::path& cacheFile, uint64_t expectedHash, ShaderReflectionData* data)
+{
+	std::ifstream file(cacheFile, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	std::streamoff size = file.tellg();
+	if (size <= 0 || size > REFLECTION_CACHE_MAX_FILE)
+		return false;
+
+	std::vector<unsigned char> bytes((size_t)size);
+	file.seekg(0);
+	if (!file.read((char*)bytes.data(), size))
+		return false;
+
+	ShaderReflectionData loaded;
+	if (!Deserialize(bytes.data(), bytes.size(), &loaded) || loaded.BytecodeHash != expectedHash)
+		return false;
+
+	*data = std::move(loaded);
+	return true;
+}
+
+// --------------------------------------------------------
+// Writes reflection data to disk, replacing any old cache
+// --------------------------------------------------------
+bool ShaderReflectionCache::Save(const std::filesystem::path& cacheFile, const ShaderReflectionData& data)
+{
+	std::vector<unsigned char> bytes;
+	Serialize(data, &bytes);
+
+	std::ofstream file(cacheFile, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	file.write((const char*)bytes.data(), bytes.size());
+	return file.good();
+}
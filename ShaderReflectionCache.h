@@ -0,0 +1,84 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// --------------------------------------------------------
+// Everything SimpleShader needs from shader reflection,
+// stored as plain data so it can be cached on disk.
+//
+// None of this depends on Direct3D - enum values (like
+// D3D_CBUFFER_TYPE) are stored as their raw integers.
+// --------------------------------------------------------
+struct ShaderReflectionVariable
+{
+	std::string Name;
+	uint32_t ByteOffset = 0;
+	uint32_t Size = 0;
+};
+
+struct ShaderReflectionBuffer
+{
+	std::string Name;
+	uint32_t Type = 0;
+	uint32_t BindIndex = 0;
+	uint32_t Size = 0;
+	std::vector<ShaderReflectionVariable> Variables;
+};
+
+struct ShaderReflectionResource
+{
+	std::string Name;
+	uint32_t BindIndex = 0;
+};
+
+struct ShaderReflectionSignatureElement
+{
+	std::string SemanticName;
+	uint32_t SemanticIndex = 0;
+	uint32_t Mask = 0;
+	uint32_t ComponentType = 0;
+	uint32_t Stream = 0;
+};
+
+struct ShaderReflectionData
+{
+	uint64_t BytecodeHash = 0;
+
+	std::vector<ShaderReflectionBuffer> ConstantBuffers;
+	std::vector<ShaderReflectionResource> Textures; // Textures & structured buffers
+	std::vector<ShaderReflectionResource> Samplers;
+	std::vector<ShaderReflectionResource> UnorderedAccessViews;
+	std::vector<ShaderReflectionSignatureElement> InputElements;
+	std::vector<ShaderReflectionSignatureElement> OutputElements;
+
+	// Compute shaders only
+	uint32_t ThreadsX = 0;
+	uint32_t ThreadsY = 0;
+	uint32_t ThreadsZ = 0;
+};
+
+// --------------------------------------------------------
+// Reads and writes reflection data in a compact binary
+// format (little-endian, explicitly sized fields) that is
+// keyed by a hash of the shader bytecode, so a stale cache
+// is simply ignored.  The reader validates every length
+// and count, and rejects anything malformed.
+// --------------------------------------------------------
+class ShaderReflectionCache
+{
+public:
+	// Hashing
+	static uint64_t HashBytecode(const void* bytecode, size_t size);
+
+	// In-memory serialization
+	static void Serialize(const ShaderReflectionData& data, std::vector<unsigned char>* bytes);
+	static bool Deserialize(const unsigned char* bytes, size_t size, ShaderReflectionData* data);
+
+	// Files
+	static std::filesystem::path GetCachePath(const std::filesystem::path& shaderFile);
+	static bool Load(const std::filesystem::path& cacheFile, uint64_t expectedHash, ShaderReflectionData* data);
+	static bool Save(const std::filesystem::path& cacheFile, const ShaderReflectionData& data);
+};
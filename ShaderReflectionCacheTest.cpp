@@ -0,0 +1,248 @@
+// --------------------------------------------------------
+// Tests ShaderReflectionCache: reflection data survives a
+// round trip (in memory and through a file), and Deserialize
+// rejects every truncation of it.  Byte flips and random
+// garbage must either be rejected or read back as something
+// that serializes to exactly the same bytes - never read out
+// of bounds or allocate what the data can't hold (build with
+// -fsanitize=address to check the former).
+// --------------------------------------------------------
+#include <cstring>
+#include <filesystem>
+
+#include "ShaderReflectionCache.h"
+#include "TestCheck.h"
+
+// Reflection data with something in every field
+static ShaderReflectionData MakeData()
+{
+	ShaderReflectionData data;
+	data.BytecodeHash = 0x0123456789ABCDEFull;
+
+	ShaderReflectionBuffer perObject;
+	perObject.Name = "perObject";
+	perObject.Type = 0;
+	perObject.BindIndex = 0;
+	perObject.Size = 144;
+	perObject.Variables.push_back({ "world", 0, 64 });
+	perObject.Variables.push_back({ "worldInvTranspose", 64, 64 });
+	perObject.Variables.push_back({ "colorTint", 128, 12 });
+	perObject.Variables.push_back({ "roughness", 140, 4 });
+	data.ConstantBuffers.push_back(perObject);
+
+	ShaderReflectionBuffer perFrame;
+	perFrame.Name = "perFrame";
+	perFrame.Type = 1;
+	perFrame.BindIndex = 1;
+	perFrame.Size = 16;
+	perFrame.Variables.push_back({ "", 0, 16 });
+	data.ConstantBuffers.push_back(perFrame);
+
+	data.Textures.push_back({ "Albedo", 0 });
+	data.Textures.push_back({ "NormalMap", 1 });
+	data.Samplers.push_back({ "BasicSampler", 0 });
+	data.UnorderedAccessViews.push_back({ "Output", 3 });
+
+	data.InputElements.push_back({ "POSITION", 0, 7, 3, 0 });
+	data.InputElements.push_back({ "TEXCOORD", 1, 3, 3, 0 });
+	data.OutputElements.push_back({ "SV_TARGET", 0, 15, 3, 0 });
+
+	data.ThreadsX = 8;
+	data.ThreadsY = 4;
+	data.ThreadsZ = 1;
+	return data;
+}
+
+static bool Same(const ShaderReflectionData& a, const ShaderReflectionData& b)
+{
+	std::vector<unsigned char> aBytes;
+	std::vector<unsigned char> bBytes;
+	ShaderReflectionCache::Serialize(a, &aBytes);
+	ShaderReflectionCache::Serialize(b, &bBytes);
+	return aBytes == bBytes;
+}
+
+static void TestRoundTrip()
+{
+	ShaderReflectionData data = MakeData();
+	std::vector<unsigned char> bytes;
+	ShaderReflectionCache::Serialize(data, &bytes);
+
+	ShaderReflectionData read;
+	CHECK(ShaderReflectionCache::Deserialize(bytes.data(), bytes.size(), &read));
+	CHECK(read.BytecodeHash == data.BytecodeHash);
+	CHECK(read.ConstantBuffers.size() == 2);
+	CHECK(read.ConstantBuffers.size() == 2 && read.ConstantBuffers[0].Name == "perObject");
+	CHECK(read.ConstantBuffers.size() == 2 && read.ConstantBuffers[0].Variables.size() == 4);
+	CHECK(read.ConstantBuffers.size() == 2 && read.ConstantBuffers[0].Variables[3].Name == "roughness");
+	CHECK(read.ConstantBuffers.size() == 2 && read.ConstantBuffers[0].Variables[3].ByteOffset == 140);
+	CHECK(read.ConstantBuffers.size() == 2 && read.ConstantBuffers[1].Type == 1);
+	CHECK(read.Textures.size() == 2 && read.Textures[1].Name == "NormalMap");
+	CHECK(read.UnorderedAccessViews.size() == 1 && read.UnorderedAccessViews[0].BindIndex == 3);
+	CHECK(read.InputElements.size() == 2 && read.InputElements[1].SemanticIndex == 1);
+	CHECK(read.ThreadsX == 8 && read.ThreadsY == 4 && read.ThreadsZ == 1);
+	CHECK(Same(data, read));
+
+	// Empty data too
+	ShaderReflectionData empty;
+	ShaderReflectionCache::Serialize(empty, &bytes);
+	CHECK(ShaderReflectionCache::Deserialize(bytes.data(), bytes.size(), &read));
+	CHECK(Same(empty, read));
+
+	// Nothing to read from, or into
+	CHECK(!ShaderReflectionCache::Deserialize(0, 0, &read));
+	CHECK(!ShaderReflectionCache::Deserialize(bytes.data(), bytes.size(), 0));
+}
+
+static void TestFiles()
+{
+	std::filesystem::path shader = std::filesystem::temp_directory_path() / "ShaderReflectionCacheTest.cso";
+	std::filesystem::path cache = ShaderReflectionCache::GetCachePath(shader);
+	CHECK(cache.extension() == ".refl");
+	CHECK(cache.stem() == "ShaderReflectionCacheTest");
+
+	ShaderReflectionData data = MakeData();
+	CHECK(ShaderReflectionCache::Save(cache, data));
+
+	ShaderReflectionData read;
+	CHECK(ShaderReflectionCache::Load(cache, data.BytecodeHash, &read));
+	CHECK(Same(data, read));
+
+	// Made from other bytecode - ignored, and nothing's changed
+	ShaderReflectionData untouched;
+	CHECK(!ShaderReflectionCache::Load(cache, data.BytecodeHash + 1, &untouched));
+	CHECK(untouched.ConstantBuffers.empty() && untouched.BytecodeHash == 0);
+
+	std::filesystem::remove(cache);
+	CHECK(!ShaderReflectionCache::Load(cache, data.BytecodeHash, &read));
+}
+
+static void TestTruncation()
+{
+	std::vector<unsigned char> bytes;
+	ShaderReflectionCache::Serialize(MakeData(), &bytes);
+
+	// Every prefix is missing something.  Each one is copied to
+	// a buffer of exactly its size, so reading on is caught.
+	int accepted = 0;
+	for (size_t size = 0; size < bytes.size(); size++)
+	{
+		std::vector<unsigned char> prefix(bytes.begin(), bytes.begin() + size);
+		ShaderReflectionData read;
+		if (ShaderReflectionCache::Deserialize(prefix.data(), prefix.size(), &read))
+			accepted++;
+	}
+	CHECK(accepted == 0);
+
+	// And anything after the end is rejected too
+	bytes.push_back(0);
+	ShaderReflectionData read;
+	CHECK(!ShaderReflectionCache::Deserialize(bytes.data(), bytes.size(), &read));
+}
+
+// Whatever Deserialize accepts must be exactly what the bytes
+// say - serializing it again gives back the same bytes
+static bool Consistent(const std::vector<unsigned char>& bytes)
+{
+	ShaderReflectionData read;
+	if (!ShaderReflectionCache::Deserialize(bytes.data(), bytes.size(), &read))
+		return true;
+
+	std::vector<unsigned char> again;
+	ShaderReflectionCache::Serialize(read, &again);
+	return again == bytes;
+}
+
+static void TestByteFlips()
+{
+	std::vector<unsigned char> bytes;
+	ShaderReflectionCache::Serialize(MakeData(), &bytes);
+
+	// Every byte, a few ways each
+	static const unsigned char flips[] = { 0x01, 0x02, 0x10, 0x80, 0xFF };
+	int inconsistent = 0;
+	int rejected = 0;
+	for (size_t i = 0; i < bytes.size(); i++)
+	{
+		for (unsigned char flip : flips)
+		{
+			std::vector<unsigned char> flipped = bytes;
+			flipped[i] ^= flip;
+
+			ShaderReflectionData read;
+			if (!ShaderReflectionCache::Deserialize(flipped.data(), flipped.size(), &read))
+				rejected++;
+			if (!Consistent(flipped))
+				inconsistent++;
+		}
+	}
+	CHECK(inconsistent == 0);
+
+	// Flips in the header, counts and lengths can't all get by
+	CHECK(rejected > 0);
+
+	// A wrong magic number or version is always rejected
+	for (size_t i = 0; i < 8; i++)
+	{
+		std::vector<unsigned char> flipped = bytes;
+		flipped[i] ^= 0x01;
+		ShaderReflectionData read;
+		CHECK(!ShaderReflectionCache::Deserialize(flipped.data(), flipped.size(), &read));
+	}
+}
+
+static void TestRandomBytes()
+{
+	std::vector<unsigned char> bytes;
+	ShaderReflectionCache::Serialize(MakeData(), &bytes);
+
+	// A fixed seed, so a failure happens every run
+	uint32_t seed = 12345;
+	auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+
+	int inconsistent = 0;
+	for (int run = 0; run < 20000; run++)
+	{
+		std::vector<unsigned char> mutated = bytes;
+
+		// A few bytes set to anything, sometimes cut short
+		uint32_t changes = 1 + random() % 4;
+		for (uint32_t c = 0; c < changes; c++)
+			mutated[random() % mutated.size()] = (unsigned char)random();
+		if (random() % 4 == 0)
+			mutated.resize(random() % mutated.size());
+
+		// Huge counts and lengths, which must not be allocated
+		if (random() % 8 == 0 && mutated.size() >= 24)
+		{
+			size_t at = 16 + random() % (mutated.size() - 20);
+			memset(&mutated[at], 0xFF, 4);
+		}
+
+		if (!Consistent(mutated))
+			inconsistent++;
+	}
+	CHECK(inconsistent == 0);
+
+	// Pure garbage, headed with the right magic and version
+	for (int run = 0; run < 2000; run++)
+	{
+		std::vector<unsigned char> garbage(bytes.begin(), bytes.begin() + 8);
+		uint32_t size = random() % 256;
+		for (uint32_t i = 0; i < size; i++)
+			garbage.push_back((unsigned char)random());
+		if (!Consistent(garbage))
+			inconsistent++;
+	}
+	CHECK(inconsistent == 0);
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestFiles();
+	TestTruncation();
+	TestByteFlips();
+	TestRandomBytes();
+	return TestResult();
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+#include "ShaderFeatures.h"
+
+// --------------------------------------------------------
+// Lazily creates and caches one object per feature key.
+//
+// The factory is only called the first time a key is seen
+// (including when it fails, so a broken permutation isn't
+// recompiled every frame).  Nothing here knows about the
+// shader compiler, so the cache works with any type.
+// --------------------------------------------------------
+template<typename T>
+class ShaderVariantCache
+{
+public:
+	typedef std::function<std::shared_ptr<T>(const ShaderFeatureSet&)> Factory;
+
+	ShaderVariantCache(Factory factory) : factory(factory), factoryCalls(0) {}
+
+	// Gets the variant for a feature set, creating it if necessary
+	std::shared_ptr<T> Get(const ShaderFeatureSet& features)
+	{
+		uint32_t key = features.GetKey();
+
+		auto result = variants.find(key);
+		if (result != variants.end())
+			return result->second;
+
+		// First request for this key
+		factoryCalls++;
+		std::shared_ptr<T> variant = factory ? factory(ShaderFeatureSet::FromKey(key)) : 0;
+		variants.insert({ key, variant });
+		return variant;
+	}
+
+	// Has this feature set been requested yet?
+	bool Contains(const ShaderFeatureSet& features) const { return variants.count(features.GetKey()) > 0; }
+
+	// Visits every variant created so far (including failed, null ones)
+	void ForEach(std::function<void(const std::shared_ptr<T>&)> visit) const
+	{
+		for (auto& v : variants)
+			visit(v.second);
+	}
+
+	// Forget everything (e.g. after editing the shader source)
+	void Clear() { variants.clear(); }
+
+	// Getters
+	size_t GetVariantCount() const { return variants.size(); }
+	unsigned int GetFactoryCallCount() const { return factoryCalls; }
+
+private:
+	Factory factory;
+	unsigned int factoryCalls;
+	std::unordered_map<uint32_t, std::shared_ptr<T>> variants;
+};
@@ -0,0 +1,502 @@
+#include "ShadowAtlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+// Light id to index in this Update()'s lights
+typedef std::unordered_map<uint32_t, uint32_t, std::hash<uint32_t>, std::equal_to<uint32_t>,
+	FrameAllocator<std::pair<const uint32_t, uint32_t>>> LightIndexMap;
+
+// --------------------------------------------------------
+// Allocator
+// --------------------------------------------------------
+
+// Constructor
+ShadowAtlasAllocator::ShadowAtlasAllocator() :
+	atlasSize(0),
+	minTileSize(0)
+{
+}
+
+// Destructor
+ShadowAtlasAllocator::~ShadowAtlasAllocator()
+{
+}
+
+// --------------------------------------------------------
+// Starts over with the whole atlas as one free block
+// --------------------------------------------------------
+void ShadowAtlasAllocator::Reset(uint32_t _atlasSize, uint32_t _minTileSize)
+{
+	atlasSize = _atlasSize;
+	minTileSize = _minTileSize;
+
+	uint32_t levels = 1;
+	for (uint32_t size = atlasSize; size > minTileSize; size /= 2)
+		levels++;
+
+	freeBlocks.clear();
+	freeBlocks.resize(levels);
+	freeBlocks[0].insert(MakeKey(0, 0));
+}
+
+// --------------------------------------------------------
+// Takes the first free block of the right size, splitting
+// the smallest larger block if there isn't one
+// --------------------------------------------------------
+bool ShadowAtlasAllocator::Allocate(uint32_t size, ShadowAtlasTile& tile)
+{
+	uint32_t level = GetLevel(size);
+	if (level == UINT32_MAX)
+		return false;
+
+	// Smallest free block that's big enough
+	int found = (int)level;
+	while (found >= 0 && freeBlocks[found].empty())
+		found--;
+	if (found < 0)
+		return false;
+
+	uint64_t key = *freeBlocks[found].begin();
+	freeBlocks[found].erase(freeBlocks[found].begin());
+	uint32_t x = (uint32_t)(key & 0xFFFFFFFF);
+	uint32_t y = (uint32_t)(key >> 32);
+
+	// Split down to size, keeping the top left quadrant
+	for (uint32_t l = (uint32_t)found; l < level; l++)
+	{
+		uint32_t half = atlasSize >> (l + 1);
+		freeBlocks[l + 1].insert(MakeKey(x + half, y));
+		freeBlocks[l + 1].insert(MakeKey(x, y + half));
+		freeBlocks[l + 1].insert(MakeKey(x + half, y + half));
+	}
+
+	tile.X = x;
+	tile.Y = y;
+	tile.Size = size;
+	return true;
+}
+
+// --------------------------------------------------------
+// Returns a block, merging it with its buddies when all
+// four quadrants of the parent are free
+// --------------------------------------------------------
+void ShadowAtlasAllocator::Free(const ShadowAtlasTile& tile)
+{
+	uint32_t level = GetLevel(tile.Size);
+	if (level == UINT32_MAX)
+		return;
+
+	uint32_t x = tile.X;
+	uint32_t y = tile.Y;
+	uint32_t size = tile.Size;
+	while (level > 0)
+	{
+		uint32_t parentSize = size * 2;
+		uint32_t px = x - x % parentSize;
+		uint32_t py = y - y % parentSize;
+
+		uint64_t quadrants[4] = {
+			MakeKey(px, py),
+			MakeKey(px + size, py),
+			MakeKey(px, py + size),
+			MakeKey(px + size, py + size) };
+
+		// Are the other three free too?
+		uint64_t self = MakeKey(x, y);
+		bool allFree = true;
+		for (uint64_t quadrant : quadrants)
+		{
+			if (quadrant != self && freeBlocks[level].count(quadrant) == 0)
+			{
+				allFree = false;
+				break;
+			}
+		}
+		if (!allFree)
+			break;
+
+		for (uint64_t quadrant : quadrants)
+			freeBlocks[level].erase(quadrant);
+
+		x = px;
+		y = py;
+		size = parentSize;
+		level--;
+	}
+
+	freeBlocks[level].insert(MakeKey(x, y));
+}
+
+// Total free texels
+uint64_t ShadowAtlasAllocator::GetFreeArea() const
+{
+	uint64_t area = 0;
+	for (size_t level = 0; level < freeBlocks.size(); level++)
+	{
+		uint64_t size = atlasSize >> level;
+		area += freeBlocks[level].size() * size * size;
+	}
+	return area;
+}
+
+// Level holding blocks of a size (UINT32_MAX if there isn't one)
+uint32_t ShadowAtlasAllocator::GetLevel(uint32_t size) const
+{
+	for (uint32_t level = 0; level < freeBlocks.size(); level++)
+	{
+		if ((atlasSize >> level) == size)
+			return level;
+	}
+	return UINT32_MAX;
+}
+
+
+// --------------------------------------------------------
+// Atlas
+// --------------------------------------------------------
+
+// Constructor
+ShadowAtlas::ShadowAtlas() :
+	frame(0),
+	fullyRepacked(false)
+{
+}
+
+// Destructor
+ShadowAtlas::~ShadowAtlas()
+{
+}
+
+// --------------------------------------------------------
+// Sizes every light's tile, frees and allocates only what
+// changed, and works out which lights need re-rendering
+// --------------------------------------------------------
+void ShadowAtlas::Update(const ShadowAtlasConfig& _config, const ShadowCascadeCamera& camera, const ShadowAtlasLight* lights, uint32_t lightCount)
+{
+	frame++;
+	fullyRepacked = false;
+	scratch.Reset();
+
+	// A different atlas layout invalidates everything
+	if (allocator.GetAtlasSize() != _config.AtlasSize ||
+		config.MinTileSize != _config.MinTileSize ||
+		config.MaxTileSize != _config.MaxTileSize)
+	{
+		allocator.Reset(_config.AtlasSize, _config.MinTileSize);
+		allocations.clear();
+	}
+	config = _config;
+
+	// Target tile sizes from screen coverage
+	FrameVector<Request> requests(lightCount, Request(), &scratch);
+	for (uint32_t i = 0; i < lightCount; i++)
+	{
+		Request& request = requests[i];
+		request.Index = i;
+		request.Importance = ComputeImportance(camera, lights[i].Position, lights[i].Range, request.Visible);
+		request.FaceCount = lights[i].Point ? 6 : 1;
+		request.TileSize = request.Visible ? GetTileSize(config, request.Importance) : 0;
+
+		// Don't shrink a tile until it's two sizes too big, so
+		// lights hovering around a threshold don't thrash
+		auto it = allocations.find(lights[i].Id);
+		if (request.Visible && it != allocations.end() &&
+			it->second.FaceCount == request.FaceCount &&
+			request.TileSize * 2 == it->second.Faces[0].Size)
+		{
+			request.TileSize = it->second.Faces[0].Size;
+		}
+	}
+
+	// Fit the budget - the least important lights shrink
+	// first, and lose their shadows only once all are minimal
+	FrameVector<uint32_t> byImportance(lightCount, 0, &scratch);
+	for (uint32_t i = 0; i < lightCount; i++)
+		byImportance[i] = i;
+	std::sort(byImportance.begin(), byImportance.end(), [&](uint32_t a, uint32_t b) {
+		if (requests[a].Importance != requests[b].Importance)
+			return requests[a].Importance < requests[b].Importance;
+		return a < b;
+	});
+
+	uint64_t atlasArea = (uint64_t)config.AtlasSize * config.AtlasSize;
+	uint64_t totalArea = 0;
+	for (const Request& request : requests)
+		totalArea += (uint64_t)request.TileSize * request.TileSize * request.FaceCount;
+
+	for (uint32_t pass = 0; pass < 2 && totalArea > atlasArea; pass++)
+	{
+		for (uint32_t i = 0; i < lightCount && totalArea > atlasArea; i++)
+		{
+			Request& request = requests[byImportance[i]];
+			while (request.TileSize > 0 && totalArea > atlasArea)
+			{
+				// First pass shrinks, second pass drops
+				if (pass == 0 && request.TileSize <= config.MinTileSize)
+					break;
+
+				uint64_t oldArea = (uint64_t)request.TileSize * request.TileSize * request.FaceCount;
+				request.TileSize = pass == 0 ? request.TileSize / 2 : 0;
+				totalArea -= oldArea - (uint64_t)request.TileSize * request.TileSize * request.FaceCount;
+			}
+		}
+	}
+
+	// Lights that are gone give their tiles back
+	LightIndexMap indexById(lightCount, std::hash<uint32_t>(), std::equal_to<uint32_t>(), &scratch);
+	for (uint32_t i = 0; i < lightCount; i++)
+		indexById[lights[i].Id] = i;
+
+	for (auto it = allocations.begin(); it != allocations.end();)
+	{
+		if (indexById.count(it->first) == 0)
+		{
+			FreeFaces(it->second);
+			it = allocations.erase(it);
+		}
+		else
+			++it;
+	}
+
+	// Visible lights whose size changed move, everything else stays put
+	FrameVector<uint32_t> pending(&scratch);
+	pending.reserve(lightCount);
+	for (const Request& request : requests)
+	{
+		auto it = allocations.find(lights[request.Index].Id);
+		if (it != allocations.end())
+		{
+			bool keep = request.Visible ?
+				it->second.FaceCount == request.FaceCount && it->second.Faces[0].Size == request.TileSize :
+				it->second.FaceCount == request.FaceCount;
+			if (keep)
+				continue;
+
+			FreeFaces(it->second);
+			allocations.erase(it);
+		}
+
+		if (request.Visible && request.TileSize > 0)
+			pending.push_back(request.Index);
+	}
+
+	// Biggest first packs best
+	std::sort(pending.begin(), pending.end(), [&](uint32_t a, uint32_t b) {
+		if (requests[a].TileSize != requests[b].TileSize)
+			return requests[a].TileSize > requests[b].TileSize;
+		if (requests[a].Importance != requests[b].Importance)
+			return requests[a].Importance > requests[b].Importance;
+		return a < b;
+	});
+
+	for (uint32_t index : pending)
+	{
+		const Request& request = requests[index];
+		Allocation allocation;
+		bool placed = AllocateFaces(allocation, request.FaceCount, request.TileSize);
+
+		// Out of room - make space by evicting lights that are
+		// off screen, longest hidden first
+		while (!placed)
+		{
+			auto oldest = allocations.end();
+			for (auto it = allocations.begin(); it != allocations.end(); ++it)
+			{
+				if (requests[indexById[it->first]].Visible)
+					continue;
+				if (oldest == allocations.end() || it->second.LastVisibleFrame < oldest->second.LastVisibleFrame)
+					oldest = it;
+			}
+			if (oldest == allocations.end())
+				break;
+
+			FreeFaces(oldest->second);
+			allocations.erase(oldest);
+			placed = AllocateFaces(allocation, request.FaceCount, request.TileSize);
+		}
+
+		// Still no room means the atlas is too fragmented - the
+		// budget guarantees everything fits when packed in order
+		if (!placed)
+		{
+			RepackAll(lights, requests);
+			break;
+		}
+
+		allocations[lights[index].Id] = allocation;
+	}
+
+	// Results
+	slots.clear();
+	for (const Request& request : requests)
+	{
+		const ShadowAtlasLight& light = lights[request.Index];
+		auto it = allocations.find(light.Id);
+		if (it == allocations.end())
+			continue;
+
+		Allocation& allocation = it->second;
+		ShadowAtlasSlot slot;
+		slot.LightId = light.Id;
+		slot.LightIndex = request.Index;
+		slot.FaceCount = allocation.FaceCount;
+		memcpy(slot.Faces, allocation.Faces, sizeof(slot.Faces));
+		slot.Importance = request.Importance;
+		slot.Visible = request.Visible;
+
+		if (request.Visible)
+		{
+			allocation.LastVisibleFrame = frame;
+			slot.NeedsRender =
+				!allocation.Rendered ||
+				light.CastersChanged ||
+				!SameLight(allocation.RenderedLight, light);
+
+			if (slot.NeedsRender)
+			{
+				allocation.Rendered = true;
+				allocation.RenderedLight = light;
+			}
+		}
+		else if (light.CastersChanged)
+		{
+			// Not drawn now, but remember it's stale for later
+			allocation.Rendered = false;
+		}
+
+		slots.push_back(slot);
+	}
+}
+
+// --------------------------------------------------------
+// Finds a light's slot from the last Update
+// --------------------------------------------------------
+const ShadowAtlasSlot* ShadowAtlas::FindSlot(uint32_t lightId) const
+{
+	for (const ShadowAtlasSlot& slot : slots)
+	{
+		if (slot.LightId == lightId)
+			return &slot;
+	}
+	return 0;
+}
+
+// --------------------------------------------------------
+// How much of the screen a light's range covers: its
+// projected radius over half the screen height, up to 1
+// (which it also is when the camera is inside the range).
+// Also tests the range against the camera's frustum.
+// --------------------------------------------------------
+float ShadowAtlas::ComputeImportance(const ShadowCascadeCamera& camera, const float position[3], float range, bool& visible)
+{
+	float offset[3] = {
+		position[0] - camera.Position[0],
+		position[1] - camera.Position[1],
+		position[2] - camera.Position[2] };
+
+	float x = offset[0] * camera.Right[0] + offset[1] * camera.Right[1] + offset[2] * camera.Right[2];
+	float y = offset[0] * camera.Up[0] + offset[1] * camera.Up[1] + offset[2] * camera.Up[2];
+	float z = offset[0] * camera.Forward[0] + offset[1] * camera.Forward[1] + offset[2] * camera.Forward[2];
+
+	// Sphere against the near, far and side planes (the side
+	// plane distances scale by the planes' normal lengths)
+	visible =
+		z + range >= camera.NearZ &&
+		z - range <= camera.FarZ &&
+		fabsf(x) - z * camera.TanHalfFovX <= range * sqrtf(1.0f + camera.TanHalfFovX * camera.TanHalfFovX) &&
+		fabsf(y) - z * camera.TanHalfFovY <= range * sqrtf(1.0f + camera.TanHalfFovY * camera.TanHalfFovY);
+	if (!visible)
+		return 0.0f;
+
+	float distance = sqrtf(x * x + y * y + z * z);
+	if (distance <= range)
+		return 1.0f;
+
+	float coverage = range / (distance * camera.TanHalfFovY);
+	return coverage > 1.0f ? 1.0f : coverage;
+}
+
+// --------------------------------------------------------
+// Tile size for an importance: MaxTileSize at full coverage,
+// halving with each halving of coverage
+// --------------------------------------------------------
+uint32_t ShadowAtlas::GetTileSize(const ShadowAtlasConfig& config, float importance)
+{
+	uint32_t size = config.MaxTileSize;
+	float coverage = importance / config.FullResolutionCoverage;
+	while (size > config.MinTileSize && coverage <= 0.5f)
+	{
+		size /= 2;
+		coverage *= 2.0f;
+	}
+	return size;
+}
+
+// Allocates every face of a light, or none of them
+bool ShadowAtlas::AllocateFaces(Allocation& allocation, uint32_t faceCount, uint32_t size)
+{
+	allocation = Allocation();
+	for (uint32_t f = 0; f < faceCount; f++)
+	{
+		if (!allocator.Allocate(size, allocation.Faces[f]))
+		{
+			FreeFaces(allocation);
+			return false;
+		}
+		allocation.FaceCount++;
+	}
+	return true;
+}
+
+void ShadowAtlas::FreeFaces(Allocation& allocation)
+{
+	for (uint32_t f = 0; f < allocation.FaceCount; f++)
+		allocator.Free(allocation.Faces[f]);
+	allocation.FaceCount = 0;
+}
+
+// --------------------------------------------------------
+// Frees everything and packs the visible lights biggest
+// first.  Power of two squares in decreasing size always
+// fill a quadtree without gaps, so anything within the
+// budget fits.
+// --------------------------------------------------------
+void ShadowAtlas::RepackAll(const ShadowAtlasLight* lights, FrameVector<Request>& requests)
+{
+	fullyRepacked = true;
+	allocator.Reset(config.AtlasSize, config.MinTileSize);
+	allocations.clear();
+
+	FrameVector<uint32_t> order(&scratch);
+	order.reserve(requests.size());
+	for (const Request& request : requests)
+	{
+		if (request.Visible && request.TileSize > 0)
+			order.push_back(request.Index);
+	}
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		if (requests[a].TileSize != requests[b].TileSize)
+			return requests[a].TileSize > requests[b].TileSize;
+		return a < b;
+	});
+
+	for (uint32_t index : order)
+	{
+		Allocation allocation;
+		if (AllocateFaces(allocation, requests[index].FaceCount, requests[index].TileSize))
+			allocations[lights[index].Id] = allocation;
+	}
+}
+
+// Exact comparison of everything that shapes a light's shadow
+bool ShadowAtlas::SameLight(const ShadowAtlasLight& a, const ShadowAtlasLight& b)
+{
+	return
+		a.Point == b.Point &&
+		memcmp(a.Position, b.Position, sizeof(a.Position)) == 0 &&
+		a.Range == b.Range &&
+		memcmp(a.Direction, b.Direction, sizeof(a.Direction)) == 0 &&
+		a.SpotAngle == b.SpotAngle;
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <stdint.h>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "FrameArena.h"
+#include "ShadowCascades.h"
+
+// Point lights render six cube faces, spot lights one
+#define SHADOW_ATLAS_MAX_FACES 6
+
+// --------------------------------------------------------
+// Atlas size and the range of tile sizes lights can get.
+// All sizes must be powers of two.
+// --------------------------------------------------------
+struct ShadowAtlasConfig
+{
+	uint32_t AtlasSize = 4096;
+	uint32_t MinTileSize = 128;
+	uint32_t MaxTileSize = 1024;
+
+	// Screen coverage (projected radius over half the screen
+	// height) that earns MaxTileSize - each halving of the
+	// coverage halves the tile size
+	float FullResolutionCoverage = 1.0f;
+};
+
+// --------------------------------------------------------
+// A shadowed point or spot light, in world space.  Id must
+// stay the same for a light from frame to frame.
+// --------------------------------------------------------
+struct ShadowAtlasLight
+{
+	uint32_t Id = 0;
+	bool Point = true;
+
+	float Position[3] = { 0, 0, 0 };
+	float Range = 0;
+
+	// Spot lights only
+	float Direction[3] = { 0, 0, 1 };
+	float SpotAngle = 0;	// Full cone angle, in radians
+
+	// Something that casts into this light has moved, so
+	// its shadow needs redrawing even if the light didn't
+	bool CastersChanged = false;
+};
+
+// --------------------------------------------------------
+// One rendered view in the atlas, as the shaders see it
+// (matches ShadowAtlasFace in ShadowAtlas.hlsli)
+// --------------------------------------------------------
+struct ShadowAtlasShaderFace
+{
+	float ViewProjection[16];	// Row-major, like XMFLOAT4X4
+	float AtlasRect[4];			// UV offset and scale
+};
+
+// A square region of the atlas, in texels
+struct ShadowAtlasTile
+{
+	uint32_t X = 0;
+	uint32_t Y = 0;
+	uint32_t Size = 0;
+};
+
+// --------------------------------------------------------
+// Where a light's shadow lives in the atlas this frame
+// --------------------------------------------------------
+struct ShadowAtlasSlot
+{
+	uint32_t LightId = 0;
+	uint32_t LightIndex = 0;	// Into the array given to Update()
+
+	uint32_t FaceCount = 0;
+	ShadowAtlasTile Faces[SHADOW_ATLAS_MAX_FACES];
+
+	float Importance = 0;
+	bool Visible = false;		// Could it light anything on screen?
+	bool NeedsRender = false;	// Is the atlas out of date for it?
+};
+
+// --------------------------------------------------------
+// Quadtree buddy allocator for square, power of two tiles.
+// A free block splits into four quadrants when something
+// smaller is needed, and merges back once all four are free.
+// --------------------------------------------------------
+class ShadowAtlasAllocator
+{
+public:
+	ShadowAtlasAllocator();
+	~ShadowAtlasAllocator();
+
+	// Frees everything
+	void Reset(uint32_t atlasSize, uint32_t minTileSize);
+
+	bool Allocate(uint32_t size, ShadowAtlasTile& tile);
+	void Free(const ShadowAtlasTile& tile);
+
+	uint64_t GetFreeArea() const;
+	uint32_t GetAtlasSize() const { return atlasSize; }
+
+private:
+	uint32_t GetLevel(uint32_t size) const;
+	static uint64_t MakeKey(uint32_t x, uint32_t y) { return ((uint64_t)y << 32) | x; }
+
+	uint32_t atlasSize;
+	uint32_t minTileSize;
+
+	// Free blocks per level (level 0 is the whole atlas),
+	// ordered top to bottom so allocations stay compact
+	std::vector<std::set<uint64_t>> freeBlocks;
+};
+
+// --------------------------------------------------------
+// Packs shadow maps for many point and spot lights into one
+// depth texture:
+//
+//  - Each light's tile size comes from how much of the
+//    screen its range covers, within a total area budget
+//  - Lights keep their tiles while their size is unchanged,
+//    so a frame's changes only move the lights involved.
+//    The atlas is only repacked from scratch when it's too
+//    fragmented to fit what's needed.
+//  - Lights outside the camera's frustum keep their tiles
+//    (while there's room) but are never re-rendered
+//
+// There's no Direct3D dependency here.
+// --------------------------------------------------------
+class ShadowAtlas
+{
+public:
+	ShadowAtlas();
+	~ShadowAtlas();
+
+	// Assigns tiles for this frame - call once per frame
+	void Update(const ShadowAtlasConfig& config, const ShadowCascadeCamera& camera, const ShadowAtlasLight* lights, uint32_t lightCount);
+
+	// Results of the last Update, in the order lights were given
+	// (lights without a tile have no slot)
+	const std::vector<ShadowAtlasSlot>& GetSlots() const { return slots; }
+	const ShadowAtlasSlot* FindSlot(uint32_t lightId) const;
+	bool WasFullyRepacked() const { return fullyRepacked; }
+	const ShadowAtlasConfig& GetConfig() const { return config; }
+
+	// Importance & resolution
+	static float ComputeImportance(const ShadowCascadeCamera& camera, const float position[3], float range, bool& visible);
+	static uint32_t GetTileSize(const ShadowAtlasConfig& config, float importance);
+
+private:
+	struct Allocation
+	{
+		uint32_t FaceCount = 0;
+		ShadowAtlasTile Faces[SHADOW_ATLAS_MAX_FACES];
+
+		// The light as it was last rendered
+		bool Rendered = false;
+		ShadowAtlasLight RenderedLight;
+
+		uint64_t LastVisibleFrame = 0;
+	};
+
+	// Per-light working data for one Update
+	struct Request
+	{
+		uint32_t Index;
+		float Importance;
+		bool Visible;
+		uint32_t TileSize;	// 0 = no shadow this frame
+		uint32_t FaceCount;
+	};
+
+	bool AllocateFaces(Allocation& allocation, uint32_t faceCount, uint32_t size);
+	void FreeFaces(Allocation& allocation);
+	void RepackAll(const ShadowAtlasLight* lights, FrameVector<Request>& requests);
+	static bool SameLight(const ShadowAtlasLight& a, const ShadowAtlasLight& b);
+
+	ShadowAtlasConfig config;
+	ShadowAtlasAllocator allocator;
+	std::unordered_map<uint32_t, Allocation> allocations;
+	std::vector<ShadowAtlasSlot> slots;
+	uint64_t frame;
+	bool fullyRepacked;
+
+	// Update()'s working lists, emptied every Update()
+	LinearArena scratch;
+};
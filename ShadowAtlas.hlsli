@@ -0,0 +1,62 @@
+#ifndef __GGP__SHADOW__ATLAS__
+#define __GGP__SHADOW__ATLAS__
+
+#include "ShaderIncludes.hlsli"
+
+// One rendered view in the atlas - matches ShadowAtlasShaderFace in ShadowAtlas.h
+struct ShadowAtlasFace
+{
+	matrix	ViewProjection;
+	float4	AtlasRect;		// UV offset (xy) and scale (zw)
+};
+
+// --------------------------------------------------------
+// How lit a pixel is by a point or spot light whose shadow
+// is in the atlas (1 = fully lit).  faceRange is the light's
+// (first face, face count) - six faces for a point light,
+// in +X, -X, +Y, -Y, +Z, -Z order.
+// --------------------------------------------------------
+float SampleShadowAtlas(
+	Texture2D atlas,
+	SamplerComparisonState shadowSampler,
+	StructuredBuffer<ShadowAtlasFace> faces,
+	int2 faceRange,
+	Light light,
+	float3 worldPos)
+{
+	if (faceRange.y == 0)
+		return 1.0f;
+
+	// Point lights pick the cube face along the major axis
+	int face = faceRange.x;
+	if (faceRange.y == 6)
+	{
+		float3 toPixel = worldPos - light.Position;
+		float3 absToPixel = abs(toPixel);
+		if (absToPixel.x >= absToPixel.y && absToPixel.x >= absToPixel.z)
+			face += toPixel.x > 0 ? 0 : 1;
+		else if (absToPixel.y >= absToPixel.z)
+			face += toPixel.y > 0 ? 2 : 3;
+		else
+			face += toPixel.z > 0 ? 4 : 5;
+	}
+
+	float4 shadowPos = mul(faces[face].ViewProjection, float4(worldPos, 1));
+	shadowPos /= shadowPos.w;
+
+	float2 shadowUV = shadowPos.xy * 0.5f + 0.5f;
+	shadowUV.y = 1 - shadowUV.y;
+	if (any(shadowUV < 0) || any(shadowUV > 1) || shadowPos.z > 1)
+		return 1.0f;
+
+	// Keep the filter footprint inside this tile
+	float2 atlasSize;
+	atlas.GetDimensions(atlasSize.x, atlasSize.y);
+	float2 halfTexel = 0.5f / atlasSize;
+	float4 rect = faces[face].AtlasRect;
+	float2 atlasUV = clamp(rect.xy + shadowUV * rect.zw, rect.xy + halfTexel, rect.xy + rect.zw - halfTexel);
+
+	return atlas.SampleCmpLevelZero(shadowSampler, atlasUV, shadowPos.z).r;
+}
+
+#endif
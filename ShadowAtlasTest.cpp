@@ -0,0 +1,464 @@
+// --------------------------------------------------------
+// Tests ShadowAtlas and its allocator.  Over a long run of
+// lights moving, coming and going and the camera turning,
+// every frame's tiles must:
+//
+//  - be inside the atlas, aligned, and never overlap
+//  - fit the budget, dropping the least important lights
+//  - stay where they were unless their size changed (or
+//    the atlas had to be repacked), and be re-rendered
+//    only when they moved or their light changed
+//
+// Also checks that still frames never re-render, that the
+// atlas is only fully repacked when it's too fragmented,
+// and the allocator's splitting and merging.
+// --------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "ShadowAtlas.h"
+#include "TestCheck.h"
+
+// Returns false if any tile is off the atlas, misaligned, a
+// size the config can't make, or overlaps another
+static bool CheckLayout(const ShadowAtlas& atlas)
+{
+	const ShadowAtlasConfig& config = atlas.GetConfig();
+	uint32_t cells = config.AtlasSize / config.MinTileSize;
+	std::vector<bool> used((size_t)cells * cells, false);
+
+	for (const ShadowAtlasSlot& slot : atlas.GetSlots())
+	{
+		if (slot.FaceCount == 0 || slot.FaceCount > SHADOW_ATLAS_MAX_FACES)
+			return false;
+
+		for (uint32_t f = 0; f < slot.FaceCount; f++)
+		{
+			const ShadowAtlasTile& tile = slot.Faces[f];
+			if (tile.Size < config.MinTileSize || tile.Size > config.MaxTileSize || (tile.Size & (tile.Size - 1)) != 0)
+				return false;
+			if (tile.X % tile.Size != 0 || tile.Y % tile.Size != 0)
+				return false;
+			if (tile.X + tile.Size > config.AtlasSize || tile.Y + tile.Size > config.AtlasSize)
+				return false;
+
+			// Mark it, in units of the smallest tile
+			for (uint32_t y = tile.Y / config.MinTileSize; y < (tile.Y + tile.Size) / config.MinTileSize; y++)
+			{
+				for (uint32_t x = tile.X / config.MinTileSize; x < (tile.X + tile.Size) / config.MinTileSize; x++)
+				{
+					if (used[(size_t)y * cells + x])
+						return false;
+					used[(size_t)y * cells + x] = true;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+static uint64_t GetArea(const ShadowAtlasSlot& slot)
+{
+	return (uint64_t)slot.Faces[0].Size * slot.Faces[0].Size * slot.FaceCount;
+}
+
+static bool SameTiles(const ShadowAtlasSlot& a, const ShadowAtlasSlot& b)
+{
+	if (a.FaceCount != b.FaceCount)
+		return false;
+	for (uint32_t f = 0; f < a.FaceCount; f++)
+	{
+		if (a.Faces[f].X != b.Faces[f].X || a.Faces[f].Y != b.Faces[f].Y || a.Faces[f].Size != b.Faces[f].Size)
+			return false;
+	}
+	return true;
+}
+
+static bool SameLight(const ShadowAtlasLight& a, const ShadowAtlasLight& b)
+{
+	return a.Point == b.Point && a.Range == b.Range && a.SpotAngle == b.SpotAngle &&
+		memcmp(a.Position, b.Position, sizeof(a.Position)) == 0 &&
+		memcmp(a.Direction, b.Direction, sizeof(a.Direction)) == 0;
+}
+
+// A camera at the origin, turned by yaw
+static ShadowCascadeCamera MakeCamera(float yaw)
+{
+	ShadowCascadeCamera camera;
+	camera.Forward[0] = sinf(yaw);
+	camera.Forward[2] = cosf(yaw);
+	camera.Right[0] = cosf(yaw);
+	camera.Right[2] = -sinf(yaw);
+	camera.FarZ = 200.0f;
+	return camera;
+}
+
+// One frame's lights, made from the frame number alone
+static void MakeLights(uint32_t frame, std::vector<ShadowAtlasLight>& lights)
+{
+	lights.clear();
+	for (uint32_t i = 0; i < 90; i++)
+	{
+		// Some come and go
+		if (i % 6 == 5 && (frame / (20 + i)) % 2 == 1)
+			continue;
+
+		ShadowAtlasLight light;
+		light.Id = 500 + i;
+		light.Point = i % 3 != 0;
+
+		// A third drift around (at different rates), the rest
+		// only step now and then
+		float angle = (float)i * 2.4f;
+		float distance = 4.0f + (float)(i % 15) * 6.0f;
+		if (i % 3 == 1)
+			distance += sinf((float)frame * 0.01f * (1 + i % 4)) * 3.0f;
+		else
+			angle += (float)(frame / 250) * 0.05f;
+
+		light.Position[0] = sinf(angle) * distance;
+		light.Position[1] = (float)(i % 5) - 2.0f;
+		light.Position[2] = cosf(angle) * distance;
+		light.Range = 3.0f + (float)(i % 7) * 2.0f;
+		light.Direction[0] = 0.0f;
+		light.Direction[1] = -1.0f;
+		light.Direction[2] = 0.0f;
+		light.SpotAngle = 0.8f;
+		light.CastersChanged = i % 10 == 0 && frame % 30 == 0;
+		lights.push_back(light);
+	}
+}
+
+static void TestLongRun()
+{
+	ShadowAtlasConfig config;
+	config.AtlasSize = 512;
+	config.MinTileSize = 64;
+	config.MaxTileSize = 256;
+
+	ShadowAtlas atlas;
+	std::vector<ShadowAtlasLight> lights;
+	std::unordered_map<uint32_t, ShadowAtlasSlot> lastSlots;
+	std::unordered_map<uint32_t, ShadowAtlasLight> lastLights;
+
+	const uint32_t frameCount = 2000;
+	uint32_t badLayouts = 0;
+	uint32_t overBudget = 0;
+	uint32_t wrongDrops = 0;
+	uint32_t movedTiles = 0;
+	uint32_t missedRenders = 0;
+	uint32_t extraRenders = 0;
+	uint32_t hiddenRenders = 0;
+	uint32_t repacks = 0;
+	uint32_t renders = 0;
+	uint32_t droppedFrames = 0;
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		MakeLights(frame, lights);
+		ShadowCascadeCamera camera = MakeCamera((float)frame * 0.004f);
+		atlas.Update(config, camera, lights.data(), (uint32_t)lights.size());
+		repacks += atlas.WasFullyRepacked() ? 1 : 0;
+
+		if (!CheckLayout(atlas))
+			badLayouts++;
+
+		// Visible lights fit the atlas, and any visible light
+		// left without a tile is no more important than the
+		// ones that got one
+		uint64_t area = 0;
+		float leastKept = 2.0f;
+		for (const ShadowAtlasSlot& slot : atlas.GetSlots())
+		{
+			area += GetArea(slot);
+			if (slot.Visible)
+				leastKept = std::min(leastKept, slot.Importance);
+		}
+		if (area > (uint64_t)config.AtlasSize * config.AtlasSize)
+			overBudget++;
+
+		bool dropped = false;
+		for (const ShadowAtlasLight& light : lights)
+		{
+			bool visible = false;
+			float importance = ShadowAtlas::ComputeImportance(camera, light.Position, light.Range, visible);
+			if (visible && !atlas.FindSlot(light.Id))
+			{
+				dropped = true;
+				if (importance > leastKept)
+					wrongDrops++;
+			}
+		}
+		droppedFrames += dropped ? 1 : 0;
+
+		for (const ShadowAtlasSlot& slot : atlas.GetSlots())
+		{
+			const ShadowAtlasLight& light = lights[slot.LightIndex];
+			renders += slot.NeedsRender ? 1 : 0;
+			if (!slot.Visible && slot.NeedsRender)
+				hiddenRenders++;
+
+			auto last = lastSlots.find(slot.LightId);
+			bool wasThere = last != lastSlots.end();
+
+			// Same size, same place (unless everything moved)
+			bool sameSize = wasThere && last->second.FaceCount == slot.FaceCount && last->second.Faces[0].Size == slot.Faces[0].Size;
+			bool sameTiles = wasThere && SameTiles(last->second, slot);
+			if (sameSize && !sameTiles && !atlas.WasFullyRepacked())
+				movedTiles++;
+
+			// Visible lights render when they're new to their
+			// tiles or changed, and not when they were drawn
+			// there last frame and nothing's changed since
+			// (a full repack starts every light over)
+			if (!slot.Visible)
+				continue;
+			bool changed = !wasThere || !sameTiles || light.CastersChanged || !SameLight(lastLights[slot.LightId], light);
+			if (changed && !slot.NeedsRender)
+				missedRenders++;
+			if (!changed && last->second.Visible && slot.NeedsRender && !atlas.WasFullyRepacked())
+				extraRenders++;
+		}
+
+		lastSlots.clear();
+		for (const ShadowAtlasSlot& slot : atlas.GetSlots())
+			lastSlots[slot.LightId] = slot;
+		lastLights.clear();
+		for (const ShadowAtlasLight& light : lights)
+			lastLights[light.Id] = light;
+	}
+
+	CHECK(badLayouts == 0);
+	CHECK(overBudget == 0);
+	CHECK(wrongDrops == 0);
+	CHECK(movedTiles == 0);
+	CHECK(missedRenders == 0);
+	CHECK(extraRenders == 0);
+	CHECK(hiddenRenders == 0);
+
+	// The run should actually push the budget, and repacking
+	// from scratch should be rare
+	CHECK(droppedFrames > 0);
+	CHECK(repacks < frameCount / 20);
+	printf("%u frames: %u renders, %u full repacks, %u frames with lights dropped\n", frameCount, renders, repacks, droppedFrames);
+}
+
+static void TestStillFrames()
+{
+	ShadowAtlasConfig config;
+	ShadowAtlas atlas;
+	std::vector<ShadowAtlasLight> lights;
+	MakeLights(0, lights);
+	for (ShadowAtlasLight& light : lights)
+		light.CastersChanged = false;
+	ShadowCascadeCamera camera = MakeCamera(0.3f);
+
+	atlas.Update(config, camera, lights.data(), (uint32_t)lights.size());
+	uint32_t firstRenders = 0;
+	for (const ShadowAtlasSlot& slot : atlas.GetSlots())
+		firstRenders += slot.NeedsRender ? 1 : 0;
+	CHECK(firstRenders > 0);
+
+	// Nothing changes, so nothing renders
+	uint32_t renders = 0;
+	for (int frame = 0; frame < 100; frame++)
+	{
+		atlas.Update(config, camera, lights.data(), (uint32_t)lights.size());
+		for (const ShadowAtlasSlot& slot : atlas.GetSlots())
+			renders += slot.NeedsRender ? 1 : 0;
+		CHECK(!atlas.WasFullyRepacked());
+	}
+	CHECK(renders == 0);
+
+	// A caster moving re-renders just its light, once
+	const ShadowAtlasSlot* visible = 0;
+	for (const ShadowAtlasSlot& slot : atlas.GetSlots())
+	{
+		if (slot.Visible)
+		{
+			visible = &slot;
+			break;
+		}
+	}
+	CHECK(visible != 0);
+	if (!visible)
+		return;
+	uint32_t id = visible->LightId;
+	lights[visible->LightIndex].CastersChanged = true;
+	atlas.Update(config, camera, lights.data(), (uint32_t)lights.size());
+	for (const ShadowAtlasSlot& slot : atlas.GetSlots())
+		CHECK(slot.NeedsRender == (slot.LightId == id));
+	for (ShadowAtlasLight& light : lights)
+		light.CastersChanged = false;
+	atlas.Update(config, camera, lights.data(), (uint32_t)lights.size());
+	for (const ShadowAtlasSlot& slot : atlas.GetSlots())
+		CHECK(!slot.NeedsRender);
+}
+
+// A spot light straight ahead of a camera at the origin
+// (looking down +Z), whose importance is about range / z
+static ShadowAtlasLight MakeSpot(uint32_t id, float x, float z, float range)
+{
+	ShadowAtlasLight light;
+	light.Id = id;
+	light.Point = false;
+	light.Position[0] = x;
+	light.Position[2] = z;
+	light.Range = range;
+	light.SpotAngle = 0.5f;
+	return light;
+}
+
+static void TestIncremental()
+{
+	ShadowAtlasConfig config;
+	config.AtlasSize = 1024;
+	config.MinTileSize = 128;
+	config.MaxTileSize = 512;
+	ShadowCascadeCamera camera = MakeCamera(0.0f);
+	ShadowAtlas atlas;
+
+	// Ten small lights
+	std::vector<ShadowAtlasLight> lights;
+	for (uint32_t i = 0; i < 10; i++)
+		lights.push_back(MakeSpot(i, (float)i - 5.0f, 50.0f, 2.0f));
+	atlas.Update(config, camera, lights.data(), (uint32_t)lights.size());
+	std::vector<ShadowAtlasSlot> before = atlas.GetSlots();
+	CHECK(before.size() == 10);
+
+	// One grows - it moves and re-renders, nothing else does
+	lights[4].Position[2] = 4.0f;
+	atlas.Update(config, camera, lights.data(), (uint32_t)lights.size());
+	CHECK(!atlas.WasFullyRepacked());
+	CHECK(atlas.GetSlots().size() == 10);
+	for (size_t i = 0; i < atlas.GetSlots().size() && i < before.size(); i++)
+	{
+		const ShadowAtlasSlot& slot = atlas.GetSlots()[i];
+		if (slot.LightId == 4)
+		{
+			CHECK(slot.Faces[0].Size > before[i].Faces[0].Size);
+			CHECK(slot.NeedsRender);
+		}
+		else
+		{
+			CHECK(SameTiles(slot, before[i]));
+			CHECK(!slot.NeedsRender);
+		}
+	}
+
+	// A new light doesn't move the others either
+	before = atlas.GetSlots();
+	lights.push_back(MakeSpot(10, 0.0f, 20.0f, 2.0f));
+	atlas.Update(config, camera, lights.data(), (uint32_t)lights.size());
+	CHECK(!atlas.WasFullyRepacked());
+	for (size_t i = 0; i < before.size(); i++)
+	{
+		const ShadowAtlasSlot* slot = atlas.FindSlot(before[i].LightId);
+		CHECK(slot && SameTiles(*slot, before[i]) && !slot->NeedsRender);
+	}
+	CHECK(atlas.FindSlot(10) && atlas.FindSlot(10)->NeedsRender);
+
+	// A light behind the camera keeps its tile, but isn't drawn
+	lights[0].Position[2] = -50.0f;
+	before = atlas.GetSlots();
+	atlas.Update(config, camera, lights.data(), (uint32_t)lights.size());
+	const ShadowAtlasSlot* hidden = atlas.FindSlot(0);
+	CHECK(hidden && !hidden->Visible && !hidden->NeedsRender);
+	CHECK(hidden && SameTiles(*hidden, before[0]));
+}
+
+static void TestFragmentedRepack()
+{
+	ShadowAtlasConfig config;
+	config.AtlasSize = 1024;
+	config.MinTileSize = 128;
+	config.MaxTileSize = 512;
+	ShadowCascadeCamera camera = MakeCamera(0.0f);
+	ShadowAtlas atlas;
+
+	// 64 of the smallest tiles fill the atlas exactly
+	std::vector<ShadowAtlasLight> lights;
+	for (uint32_t i = 0; i < 64; i++)
+		lights.push_back(MakeSpot(i, (float)(i % 8) - 4.0f, 50.0f + (float)(i / 8), 1.0f));
+	atlas.Update(config, camera, lights.data(), (uint32_t)lights.size());
+	CHECK(atlas.GetSlots().size() == 64);
+	CHECK(CheckLayout(atlas));
+
+	// Taking away every fourth leaves room for one big tile,
+	// but scattered, so it only fits after a repack
+	std::vector<ShadowAtlasLight> fewer;
+	for (uint32_t i = 0; i < 64; i++)
+	{
+		if (i % 4 != 0)
+			fewer.push_back(lights[i]);
+	}
+	fewer.push_back(MakeSpot(100, 0.0f, 3.0f, 2.5f));
+	atlas.Update(config, camera, fewer.data(), (uint32_t)fewer.size());
+
+	CHECK(atlas.WasFullyRepacked());
+	CHECK(atlas.GetSlots().size() == 49);
+	CHECK(CheckLayout(atlas));
+	const ShadowAtlasSlot* big = atlas.FindSlot(100);
+	CHECK(big && big->Faces[0].Size == 512);
+
+	// Everything was moved, so everything renders
+	for (const ShadowAtlasSlot& slot : atlas.GetSlots())
+		CHECK(slot.NeedsRender);
+}
+
+static void TestAllocator()
+{
+	ShadowAtlasAllocator allocator;
+	allocator.Reset(1024, 128);
+	CHECK(allocator.GetFreeArea() == 1024 * 1024);
+
+	// Sizes it can't make
+	ShadowAtlasTile tile;
+	CHECK(!allocator.Allocate(64, tile));
+	CHECK(!allocator.Allocate(2048, tile));
+	CHECK(!allocator.Allocate(300, tile));
+
+	// Splitting and merging back
+	ShadowAtlasTile a, b, c;
+	CHECK(allocator.Allocate(128, a));
+	CHECK(allocator.Allocate(512, b));
+	CHECK(allocator.Allocate(256, c));
+	CHECK(allocator.GetFreeArea() == 1024 * 1024 - 128 * 128 - 512 * 512 - 256 * 256);
+	allocator.Free(a);
+	allocator.Free(b);
+	allocator.Free(c);
+	CHECK(allocator.GetFreeArea() == 1024 * 1024);
+
+	// Merged all the way up - the whole atlas fits again
+	ShadowAtlasTile whole;
+	CHECK(allocator.Allocate(1024, whole));
+	CHECK(whole.X == 0 && whole.Y == 0);
+	CHECK(!allocator.Allocate(128, tile));
+	allocator.Free(whole);
+
+	// Filling with the smallest tiles, then freeing them,
+	// leaves it in one piece
+	std::vector<ShadowAtlasTile> tiles(64);
+	for (ShadowAtlasTile& t : tiles)
+		CHECK(allocator.Allocate(128, t));
+	CHECK(allocator.GetFreeArea() == 0);
+	CHECK(!allocator.Allocate(128, tile));
+	for (size_t i = 0; i < tiles.size(); i += 2)
+		allocator.Free(tiles[i]);
+	CHECK(!allocator.Allocate(256, tile));
+	for (size_t i = 1; i < tiles.size(); i += 2)
+		allocator.Free(tiles[i]);
+	CHECK(allocator.Allocate(1024, tile));
+}
+
+int main()
+{
+	TestAllocator();
+	TestIncremental();
+	TestFragmentedRepack();
+	TestStillFrames();
+	TestLongRun();
+	return TestResult();
+}
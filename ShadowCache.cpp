@@ -0,0 +1,312 @@
+#include "ShadowCache.h"
+
+#include <cmath>
+#include <string.h>
+
+// Extra texels around a caster's projected bounds, so the
+// rasterizer's coverage rules never leave it a texel short
+#define SHADOW_CACHE_RECT_PADDING 1.0f
+
+// --------------------------------------------------------
+// Rect helpers
+// --------------------------------------------------------
+bool ShadowCacheRect::Overlaps(const ShadowCacheRect& other) const
+{
+	return !IsEmpty() && !other.IsEmpty() &&
+		MinX < other.MaxX && other.MinX < MaxX &&
+		MinY < other.MaxY && other.MinY < MaxY;
+}
+
+ShadowCacheRect ShadowCacheRect::Union(const ShadowCacheRect& other) const
+{
+	if (IsEmpty()) return other;
+	if (other.IsEmpty()) return *this;
+
+	ShadowCacheRect result;
+	result.MinX = MinX < other.MinX ? MinX : other.MinX;
+	result.MinY = MinY < other.MinY ? MinY : other.MinY;
+	result.MaxX = MaxX > other.MaxX ? MaxX : other.MaxX;
+	result.MaxY = MaxY > other.MaxY ? MaxY : other.MaxY;
+	return result;
+}
+
+// Constructor
+ShadowCache::ShadowCache() :
+	frame(0)
+{
+}
+
+// Destructor
+ShadowCache::~ShadowCache()
+{
+}
+
+// --------------------------------------------------------
+// Diffs this frame's slices and casters against the last
+// frame's and builds the per-slice work lists
+// --------------------------------------------------------
+void ShadowCache::Update(const ShadowCacheView* views, uint32_t viewCount, const ShadowCaster* casters, uint32_t casterCount)
+{
+	frame++;
+
+	// Last frame's regions go first, as they're in the arena
+	for (ShadowCacheSliceWork& sliceWork : work)
+		sliceWork.Regions.clear();
+	scratch.Reset();
+
+	// Every bounding sphere that appeared, disappeared or moved,
+	// split by whether it affects the static or dynamic layer
+	// (a caster is in at most two lists, once as it was and
+	// once as it is, plus the ones that are gone)
+	size_t maxChanges = (size_t)casterCount * 2 + casterStates.size();
+	FrameVector<const ShadowCaster*> staticChanges(&scratch);
+	FrameVector<const ShadowCaster*> dynamicChanges(&scratch);
+	staticChanges.reserve(maxChanges);
+	dynamicChanges.reserve(maxChanges);
+
+	for (uint32_t i = 0; i < casterCount; i++)
+	{
+		const ShadowCaster& caster = casters[i];
+		auto it = casterStates.find(caster.Id);
+		if (it == casterStates.end())
+		{
+			(caster.Static ? staticChanges : dynamicChanges).push_back(&caster);
+			continue;
+		}
+
+		// Unchanged casters need nothing
+		const ShadowCaster& previous = it->second.Caster;
+		if (previous.Static == caster.Static && SameTransform(previous, caster))
+			continue;
+
+		// Otherwise both the old and new bounds are dirty, in
+		// whichever layer the caster was and now is
+		(previous.Static ? staticChanges : dynamicChanges).push_back(&previous);
+		(caster.Static ? staticChanges : dynamicChanges).push_back(&caster);
+	}
+
+	// Mark what's still around (after the diff, so the old
+	// states above stay valid), then find what was removed
+	for (uint32_t i = 0; i < casterCount; i++)
+		casterStates[casters[i].Id].Frame = frame;
+
+	for (auto& pair : casterStates)
+	{
+		if (pair.second.Frame != frame)
+			(pair.second.Caster.Static ? staticChanges : dynamicChanges).push_back(&pair.second.Caster);
+	}
+
+	// Per-slice work
+	slices.resize(viewCount);
+	work.resize(viewCount);
+	for (uint32_t s = 0; s < viewCount; s++)
+	{
+		const ShadowCacheView& view = views[s];
+		// Cleared rather than replaced, to keep the lists' memory
+		ShadowCacheSliceWork& sliceWork = work[s];
+		sliceWork.RebuildStatic = false;
+		sliceWork.StaticCasters.clear();
+		sliceWork.Regions.clear();
+
+		ShadowCacheRect fullRect;
+		fullRect.MaxX = view.Resolution;
+		fullRect.MaxY = view.Resolution;
+
+		// A new view, or a static caster changing anywhere in it,
+		// means rebuilding the static layer (and so everything)
+		sliceWork.RebuildStatic = !slices[s].Valid || !SameView(slices[s].View, view);
+		for (size_t i = 0; i < staticChanges.size() && !sliceWork.RebuildStatic; i++)
+		{
+			if (!ProjectSphere(view, staticChanges[i]->Center, staticChanges[i]->Radius).IsEmpty())
+				sliceWork.RebuildStatic = true;
+		}
+
+		if (sliceWork.RebuildStatic)
+		{
+			for (uint32_t i = 0; i < casterCount; i++)
+			{
+				if (casters[i].Static && !ProjectSphere(view, casters[i].Center, casters[i].Radius).IsEmpty())
+					sliceWork.StaticCasters.push_back(i);
+			}
+			AddRegion(sliceWork.Regions, fullRect);
+		}
+		else
+		{
+			// The view hasn't changed, so last frame's bounds
+			// project to the same texels they did then
+			for (size_t i = 0; i < dynamicChanges.size(); i++)
+				AddRegion(sliceWork.Regions, ProjectSphere(view, dynamicChanges[i]->Center, dynamicChanges[i]->Radius));
+			MergeRegions(sliceWork.Regions);
+		}
+
+		// Restoring a region wipes every dynamic caster in it,
+		// moved or not, so they all get redrawn
+		for (ShadowCacheRegion& region : sliceWork.Regions)
+		{
+			region.Casters.reserve(casterCount);
+			for (uint32_t i = 0; i < casterCount; i++)
+			{
+				if (!casters[i].Static && ProjectSphere(view, casters[i].Center, casters[i].Radius).Overlaps(region.Rect))
+					region.Casters.push_back(i);
+			}
+		}
+
+		slices[s].View = view;
+		slices[s].Valid = true;
+	}
+
+	// Remember this frame for the next diff
+	for (auto it = casterStates.begin(); it != casterStates.end();)
+	{
+		if (it->second.Frame != frame)
+			it = casterStates.erase(it);
+		else
+			++it;
+	}
+	for (uint32_t i = 0; i < casterCount; i++)
+		casterStates[casters[i].Id].Caster = casters[i];
+}
+
+// --------------------------------------------------------
+// Drops all cached state
+// --------------------------------------------------------
+void ShadowCache::Invalidate()
+{
+	for (SliceState& slice : slices)
+		slice.Valid = false;
+}
+
+// --------------------------------------------------------
+// True when the last Update found nothing to draw at all
+// --------------------------------------------------------
+bool ShadowCache::IsIdle() const
+{
+	for (const ShadowCacheSliceWork& sliceWork : work)
+	{
+		if (sliceWork.RebuildStatic || !sliceWork.Regions.empty())
+			return false;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Texel bounds of a sphere under an orthographic view, with
+// v running down the map like texture coordinates
+// --------------------------------------------------------
+ShadowCacheRect ShadowCache::ProjectSphere(const ShadowCacheView& view, const float center[3], float radius)
+{
+	const float* m = view.ViewProjection;
+	ShadowCacheRect rect;
+
+	// Clip space center (row vector times matrix)
+	float x = center[0] * m[0] + center[1] * m[4] + center[2] * m[8] + m[12];
+	float y = center[0] * m[1] + center[1] * m[5] + center[2] * m[9] + m[13];
+	float z = center[0] * m[2] + center[1] * m[6] + center[2] * m[10] + m[14];
+
+	// The radius scaled by each axis' column
+	float radiusX = radius * sqrtf(m[0] * m[0] + m[4] * m[4] + m[8] * m[8]);
+	float radiusY = radius * sqrtf(m[1] * m[1] + m[5] * m[5] + m[9] * m[9]);
+	float radiusZ = radius * sqrtf(m[2] * m[2] + m[6] * m[6] + m[10] * m[10]);
+
+	// Depth clipping removes anything entirely in front or behind
+	if (z + radiusZ < 0.0f || z - radiusZ > 1.0f)
+		return rect;
+
+	float res = (float)view.Resolution;
+	float minX = floorf(((x - radiusX) * 0.5f + 0.5f) * res - SHADOW_CACHE_RECT_PADDING);
+	float maxX = ceilf(((x + radiusX) * 0.5f + 0.5f) * res + SHADOW_CACHE_RECT_PADDING);
+	float minY = floorf((0.5f - (y + radiusY) * 0.5f) * res - SHADOW_CACHE_RECT_PADDING);
+	float maxY = ceilf((0.5f - (y - radiusY) * 0.5f) * res + SHADOW_CACHE_RECT_PADDING);
+
+	if (maxX <= 0.0f || maxY <= 0.0f || minX >= res || minY >= res)
+		return rect;
+
+	rect.MinX = minX < 0.0f ? 0 : (uint32_t)minX;
+	rect.MinY = minY < 0.0f ? 0 : (uint32_t)minY;
+	rect.MaxX = maxX > res ? view.Resolution : (uint32_t)maxX;
+	rect.MaxY = maxY > res ? view.Resolution : (uint32_t)maxY;
+	return rect;
+}
+
+// --------------------------------------------------------
+// Exact comparisons - anything that moves by any amount is
+// redrawn, and anything that doesn't is left alone
+// --------------------------------------------------------
+bool ShadowCache::SameView(const ShadowCacheView& a, const ShadowCacheView& b)
+{
+	return a.Resolution == b.Resolution && memcmp(a.ViewProjection, b.ViewProjection, sizeof(a.ViewProjection)) == 0;
+}
+
+bool ShadowCache::SameTransform(const ShadowCaster& a, const ShadowCaster& b)
+{
+	return
+		memcmp(a.World, b.World, sizeof(a.World)) == 0 &&
+		memcmp(a.Center, b.Center, sizeof(a.Center)) == 0 &&
+		a.Radius == b.Radius;
+}
+
+// Adds a (non-empty) dirty rect as its own region
+void ShadowCache::AddRegion(std::vector<ShadowCacheRegion>& regions, const ShadowCacheRect& rect)
+{
+	if (rect.IsEmpty())
+		return;
+
+	ShadowCacheRegion region(&scratch);
+	region.Rect = rect;
+	regions.push_back(region);
+}
+
+// --------------------------------------------------------
+// Merges overlapping regions, then keeps merging whichever
+// pair wastes the fewest texels until few enough are left
+// --------------------------------------------------------
+void ShadowCache::MergeRegions(std::vector<ShadowCacheRegion>& regions)
+{
+	// Overlaps first - a merge can create new overlaps, so repeat
+	bool merged = true;
+	while (merged)
+	{
+		merged = false;
+		for (size_t a = 0; a < regions.size() && !merged; a++)
+		{
+			for (size_t b = a + 1; b < regions.size(); b++)
+			{
+				if (regions[a].Rect.Overlaps(regions[b].Rect))
+				{
+					regions[a].Rect = regions[a].Rect.Union(regions[b].Rect);
+					regions.erase(regions.begin() + b);
+					merged = true;
+					break;
+				}
+			}
+		}
+	}
+
+	// Then the cheapest merges, to respect the region limit
+	while (regions.size() > SHADOW_CACHE_MAX_REGIONS)
+	{
+		size_t bestA = 0;
+		size_t bestB = 1;
+		uint64_t bestWaste = UINT64_MAX;
+		for (size_t a = 0; a < regions.size(); a++)
+		{
+			for (size_t b = a + 1; b < regions.size(); b++)
+			{
+				uint64_t unionArea = regions[a].Rect.Union(regions[b].Rect).GetArea();
+				uint64_t waste = unionArea - regions[a].Rect.GetArea() - regions[b].Rect.GetArea();
+				if (waste < bestWaste)
+				{
+					bestWaste = waste;
+					bestA = a;
+					bestB = b;
+				}
+			}
+		}
+
+		regions[bestA].Rect = regions[bestA].Rect.Union(regions[bestB].Rect);
+		regions.erase(regions.begin() + bestB);
+
+		// The bigger rect might now overlap others
+		MergeRegions(regions);
+	}
+}
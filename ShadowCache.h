@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "FrameArena.h"
+
+// Beyond this many dirty regions in one slice, the closest
+// ones are merged (each region costs a restore and a scissor)
+#define SHADOW_CACHE_MAX_REGIONS 8
+
+// --------------------------------------------------------
+// A rectangle of shadow map texels.  Max is exclusive.
+// --------------------------------------------------------
+struct ShadowCacheRect
+{
+	uint32_t MinX = 0;
+	uint32_t MinY = 0;
+	uint32_t MaxX = 0;
+	uint32_t MaxY = 0;
+
+	bool IsEmpty() const { return MinX >= MaxX || MinY >= MaxY; }
+	uint64_t GetArea() const { return IsEmpty() ? 0 : (uint64_t)(MaxX - MinX) * (MaxY - MinY); }
+	bool Overlaps(const ShadowCacheRect& other) const;
+	ShadowCacheRect Union(const ShadowCacheRect& other) const;
+};
+
+// --------------------------------------------------------
+// One shadow map slice (e.g. a cascade) as seen this frame.
+// The matrix is row-major, laid out like XMFLOAT4X4.
+// --------------------------------------------------------
+struct ShadowCacheView
+{
+	float ViewProjection[16] = {};
+	uint32_t Resolution = 0;
+};
+
+// --------------------------------------------------------
+// A shadow caster as seen this frame.  Id must stay the same
+// for a caster from frame to frame.
+// --------------------------------------------------------
+struct ShadowCaster
+{
+	uint32_t Id = 0;
+	bool Static = false;
+
+	// World matrix (any change means the shadow changed) and
+	// world space bounding sphere
+	float World[16] = {};
+	float Center[3] = { 0, 0, 0 };
+	float Radius = 0;
+};
+
+// A dirty region and the dynamic casters that touch it
+// (the list lives in the cache's arena, until the next Update)
+struct ShadowCacheRegion
+{
+	ShadowCacheRegion(LinearArena* arena) : Casters(arena) {}
+
+	ShadowCacheRect Rect;
+	FrameVector<uint32_t> Casters;	// Indices into this frame's caster array
+};
+
+// --------------------------------------------------------
+// What has to be drawn into one slice this frame:
+//
+//  - RebuildStatic : clear the static cache slice and draw
+//                    StaticCasters into it
+//  - Regions       : for each, restore the static depth into
+//                    the shadow map and redraw its casters,
+//                    scissored to the region
+//
+// A slice with neither is left exactly as it was.
+// --------------------------------------------------------
+struct ShadowCacheSliceWork
+{
+	bool RebuildStatic = false;
+	std::vector<uint32_t> StaticCasters;
+	std::vector<ShadowCacheRegion> Regions;
+};
+
+// --------------------------------------------------------
+// Tracks which parts of a set of shadow map slices are out
+// of date, so static casters are only drawn when the slice
+// itself (or a static caster) changes, and dynamic casters
+// only redraw the texels their old and new bounds cover.
+//
+// There's no Direct3D dependency here.
+// --------------------------------------------------------
+class ShadowCache
+{
+public:
+	ShadowCache();
+	~ShadowCache();
+
+	// Compares this frame against the last and works out what
+	// needs drawing - call once per frame, before the shadow pass
+	void Update(const ShadowCacheView* views, uint32_t viewCount, const ShadowCaster* casters, uint32_t casterCount);
+
+	// Forces a full rebuild next Update (e.g. the map was recreated)
+	void Invalidate();
+
+	// Results of the last Update
+	uint32_t GetSliceCount() const { return (uint32_t)work.size(); }
+	const ShadowCacheSliceWork& GetWork(uint32_t slice) const { return work[slice]; }
+	bool IsIdle() const;
+
+	// Texels covered by a sphere in a slice (empty if it's off the map)
+	static ShadowCacheRect ProjectSphere(const ShadowCacheView& view, const float center[3], float radius);
+
+private:
+	// Last frame's state of each slice and caster
+	struct SliceState
+	{
+		ShadowCacheView View;
+		bool Valid = false;
+	};
+
+	struct CasterState
+	{
+		ShadowCaster Caster;
+		uint64_t Frame = 0;
+	};
+
+	static bool SameView(const ShadowCacheView& a, const ShadowCacheView& b);
+	static bool SameTransform(const ShadowCaster& a, const ShadowCaster& b);
+	void AddRegion(std::vector<ShadowCacheRegion>& regions, const ShadowCacheRect& rect);
+	static void MergeRegions(std::vector<ShadowCacheRegion>& regions);
+
+	// Update()'s change lists and the regions' caster lists,
+	// emptied every Update() (first, so it outlives the work)
+	LinearArena scratch;
+
+	uint64_t frame;
+	std::vector<SliceState> slices;
+	std::unordered_map<uint32_t, CasterState> casterStates;
+	std::vector<ShadowCacheSliceWork> work;
+};
@@ -0,0 +1,361 @@
+// --------------------------------------------------------
+// Tests ShadowCache by drawing with it.  Spheres are drawn
+// into small depth maps on the CPU two ways every frame:
+//
+//  - full:   clear and draw every caster
+//  - cached: follow the cache's work - rebuild the static
+//            layer when told to, and for each region restore
+//            it from the static layer and redraw the region's
+//            casters, scissored
+//
+// Over 3000 frames of casters moving, stopping, appearing,
+// disappearing and turning static, the views moving now and
+// then, and an Invalidate(), both maps must match exactly
+// every frame.  Also checks still frames are idle, that
+// static casters are hardly ever redrawn, and that fewer
+// texels are drawn than redrawing it all.
+// --------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "ShadowCache.h"
+#include "TestCheck.h"
+
+// A depth map, and its static layer when cached
+struct DepthMap
+{
+	uint32_t Resolution = 0;
+	std::vector<float> Depth;
+	std::vector<float> StaticDepth;
+
+	void Resize(uint32_t resolution)
+	{
+		Resolution = resolution;
+		Depth.assign((size_t)resolution * resolution, 1.0f);
+		StaticDepth.assign((size_t)resolution * resolution, 1.0f);
+	}
+};
+
+// An orthographic view looking along "forward", laid out the
+// way ShadowCache expects (row vectors, like XMFLOAT4X4)
+static ShadowCacheView MakeView(float yaw, float pitch, float halfSize, float depthRange, uint32_t resolution)
+{
+	float forward[3] = { cosf(pitch) * sinf(yaw), -sinf(pitch), cosf(pitch) * cosf(yaw) };
+	float right[3] = { cosf(yaw), 0.0f, -sinf(yaw) };
+	float up[3] =
+	{
+		forward[1] * right[2] - forward[2] * right[1],
+		forward[2] * right[0] - forward[0] * right[2],
+		forward[0] * right[1] - forward[1] * right[0]
+	};
+
+	// The volume's near plane is depthRange / 2 back from the origin
+	float origin[3] = { -forward[0] * depthRange * 0.5f, -forward[1] * depthRange * 0.5f, -forward[2] * depthRange * 0.5f };
+
+	ShadowCacheView view;
+	view.Resolution = resolution;
+	float* m = view.ViewProjection;
+	for (int i = 0; i < 3; i++)
+	{
+		m[i * 4 + 0] = right[i] / halfSize;
+		m[i * 4 + 1] = up[i] / halfSize;
+		m[i * 4 + 2] = forward[i] / depthRange;
+		m[i * 4 + 3] = 0.0f;
+	}
+	m[12] = -(origin[0] * right[0] + origin[1] * right[1] + origin[2] * right[2]) / halfSize;
+	m[13] = -(origin[0] * up[0] + origin[1] * up[1] + origin[2] * up[2]) / halfSize;
+	m[14] = -(origin[0] * forward[0] + origin[1] * forward[1] + origin[2] * forward[2]) / depthRange;
+	m[15] = 1.0f;
+	return view;
+}
+
+// Draws a sphere's front depth into a map, within a scissor
+// rect, keeping the nearest depth (so draw order never
+// matters).  Returns the texels it touched.
+static uint64_t DrawSphere(const ShadowCacheView& view, const ShadowCaster& caster, const ShadowCacheRect& scissor, std::vector<float>& depth)
+{
+	const float* m = view.ViewProjection;
+	const float* c = caster.Center;
+	float x = c[0] * m[0] + c[1] * m[4] + c[2] * m[8] + m[12];
+	float y = c[0] * m[1] + c[1] * m[5] + c[2] * m[9] + m[13];
+	float z = c[0] * m[2] + c[1] * m[6] + c[2] * m[10] + m[14];
+	float radiusX = caster.Radius * sqrtf(m[0] * m[0] + m[4] * m[4] + m[8] * m[8]);
+	float radiusY = caster.Radius * sqrtf(m[1] * m[1] + m[5] * m[5] + m[9] * m[9]);
+	float radiusZ = caster.Radius * sqrtf(m[2] * m[2] + m[6] * m[6] + m[10] * m[10]);
+
+	// Only the texels around the sphere (a texel more each
+	// way than it can cover) within the scissor
+	float res = (float)view.Resolution;
+	float minX = floorf(((x - radiusX) * 0.5f + 0.5f) * res) - 1.0f;
+	float maxX = ceilf(((x + radiusX) * 0.5f + 0.5f) * res) + 1.0f;
+	float minY = floorf((0.5f - (y + radiusY) * 0.5f) * res) - 1.0f;
+	float maxY = ceilf((0.5f - (y - radiusY) * 0.5f) * res) + 1.0f;
+	uint32_t startX = minX > (float)scissor.MinX ? (uint32_t)minX : scissor.MinX;
+	uint32_t startY = minY > (float)scissor.MinY ? (uint32_t)minY : scissor.MinY;
+	uint32_t endX = maxX < (float)scissor.MaxX ? (uint32_t)std::max(maxX, 0.0f) : scissor.MaxX;
+	uint32_t endY = maxY < (float)scissor.MaxY ? (uint32_t)std::max(maxY, 0.0f) : scissor.MaxY;
+
+	uint64_t texels = 0;
+	for (uint32_t ty = startY; ty < endY; ty++)
+	{
+		for (uint32_t tx = startX; tx < endX; tx++)
+		{
+			texels++;
+
+			// Texel center in clip space (v runs down the map)
+			float dx = (((tx + 0.5f) / res) * 2.0f - 1.0f - x) / radiusX;
+			float dy = ((1.0f - ((ty + 0.5f) / res) * 2.0f) - y) / radiusY;
+			float d = dx * dx + dy * dy;
+			if (d > 1.0f)
+				continue;
+
+			float front = z - radiusZ * sqrtf(1.0f - d);
+			if (front < 0.0f || front > 1.0f)
+				continue;
+
+			float& texel = depth[(size_t)ty * view.Resolution + tx];
+			texel = front < texel ? front : texel;
+		}
+	}
+	return texels;
+}
+
+static ShadowCacheRect FullRect(uint32_t resolution)
+{
+	ShadowCacheRect rect;
+	rect.MaxX = resolution;
+	rect.MaxY = resolution;
+	return rect;
+}
+
+// The reference - everything, every frame
+static uint64_t DrawFull(const ShadowCacheView& view, const std::vector<ShadowCaster>& casters, DepthMap& map)
+{
+	std::fill(map.Depth.begin(), map.Depth.end(), 1.0f);
+	uint64_t texels = 0;
+	for (const ShadowCaster& caster : casters)
+		texels += DrawSphere(view, caster, FullRect(map.Resolution), map.Depth);
+	return texels;
+}
+
+// What the game does with the cache's work for one slice
+static uint64_t DrawCached(const ShadowCacheView& view, const std::vector<ShadowCaster>& casters, const ShadowCacheSliceWork& work, DepthMap& map)
+{
+	uint64_t texels = 0;
+	if (work.RebuildStatic)
+	{
+		std::fill(map.StaticDepth.begin(), map.StaticDepth.end(), 1.0f);
+		for (uint32_t i : work.StaticCasters)
+			texels += DrawSphere(view, casters[i], FullRect(map.Resolution), map.StaticDepth);
+	}
+
+	for (const ShadowCacheRegion& region : work.Regions)
+	{
+		const ShadowCacheRect& rect = region.Rect;
+		for (uint32_t ty = rect.MinY; ty < rect.MaxY; ty++)
+		{
+			size_t row = (size_t)ty * map.Resolution;
+			std::copy(map.StaticDepth.begin() + row + rect.MinX, map.StaticDepth.begin() + row + rect.MaxX, map.Depth.begin() + row + rect.MinX);
+		}
+		for (uint32_t i : region.Casters)
+			texels += DrawSphere(view, casters[i], rect, map.Depth);
+	}
+	return texels;
+}
+
+// One frame's casters, made from the frame number alone
+static void MakeCasters(uint32_t frame, std::vector<ShadowCaster>& casters)
+{
+	casters.clear();
+	for (uint32_t i = 0; i < 60; i++)
+	{
+		ShadowCaster caster;
+		caster.Id = 1000 + i;
+
+		// Every fifth caster is only around some of the time
+		if (i % 5 == 4 && (frame / (37 + i)) % 3 == 1)
+			continue;
+
+		// The first third are static, a few of which move (and
+		// one of which turns dynamic) every few hundred frames
+		float t = (float)frame;
+		if (i < 20)
+		{
+			caster.Static = !(i == 3 && (frame / 400) % 2 == 1);
+			float step = (i % 7 == 0) ? (float)(frame / 300) : 0.0f;
+			caster.Center[0] = -20.0f + (float)(i % 5) * 10.0f + step;
+			caster.Center[1] = 0.0f;
+			caster.Center[2] = -20.0f + (float)(i / 5) * 10.0f;
+			caster.Radius = 2.0f + (float)(i % 3);
+		}
+		else
+		{
+			// The rest move in circles, except when they're
+			// resting (everything rests between 1500 and 1600)
+			bool resting = (frame >= 1500 && frame < 1600) || ((frame / 50) % 4 == (i % 4) && i % 2 == 0);
+			float phase = resting ? (float)(i * 13) : t * (0.01f + 0.001f * i) + (float)(i * 13);
+			caster.Center[0] = cosf(phase) * (5.0f + (float)(i % 9) * 2.5f);
+			caster.Center[1] = 2.0f + sinf(phase * 0.7f) * 3.0f;
+			caster.Center[2] = sinf(phase) * (5.0f + (float)(i % 9) * 2.5f);
+			caster.Radius = 0.5f + (float)(i % 4) * 0.75f;
+		}
+
+		// The world matrix just carries the position here
+		caster.World[0] = caster.World[5] = caster.World[10] = caster.World[15] = 1.0f;
+		caster.World[12] = caster.Center[0];
+		caster.World[13] = caster.Center[1];
+		caster.World[14] = caster.Center[2];
+		casters.push_back(caster);
+	}
+}
+
+// Three cascades of different sizes, which swing round now and then
+static void MakeViews(uint32_t frame, std::vector<ShadowCacheView>& views)
+{
+	float yaw = 0.6f + (float)(frame / 700) * 0.2f;
+	views.clear();
+	views.push_back(MakeView(yaw, 1.0f, 12.0f, 80.0f, 64));
+	views.push_back(MakeView(yaw, 1.0f, 30.0f, 80.0f, 96));
+	views.push_back(MakeView(yaw, 1.0f, 60.0f, 80.0f, 128));
+}
+
+static void TestMatchesFullRedraw()
+{
+	const uint32_t frameCount = 3000;
+	ShadowCache cache;
+	std::vector<ShadowCacheView> views;
+	std::vector<ShadowCaster> casters;
+	std::vector<DepthMap> full(3);
+	std::vector<DepthMap> cached(3);
+
+	uint32_t mismatchedFrames = 0;
+	uint32_t firstMismatch = 0;
+	uint32_t busyStillFrames = 0;
+	size_t lastCasterCount = 0;
+	uint64_t fullTexels = 0;
+	uint64_t cachedTexels = 0;
+	uint64_t fullStaticDraws = 0;
+	uint64_t cachedStaticDraws = 0;
+	for (uint32_t frame = 0; frame < frameCount; frame++)
+	{
+		MakeViews(frame, views);
+		MakeCasters(frame, casters);
+
+		// As if the maps were recreated
+		if (frame == 2200)
+			cache.Invalidate();
+
+		cache.Update(views.data(), (uint32_t)views.size(), casters.data(), (uint32_t)casters.size());
+
+		bool same = cache.GetSliceCount() == views.size();
+		for (uint32_t s = 0; s < views.size() && same; s++)
+		{
+			if (frame == 0)
+			{
+				full[s].Resize(views[s].Resolution);
+				cached[s].Resize(views[s].Resolution);
+			}
+			fullTexels += DrawFull(views[s], casters, full[s]);
+			cachedTexels += DrawCached(views[s], casters, cache.GetWork(s), cached[s]);
+			fullStaticDraws += std::count_if(casters.begin(), casters.end(), [](const ShadowCaster& c) { return c.Static; });
+			cachedStaticDraws += cache.GetWork(s).StaticCasters.size();
+			same = full[s].Depth == cached[s].Depth;
+		}
+		if (!same && mismatchedFrames++ == 0)
+			firstMismatch = frame;
+
+		// Nothing moves between 1501 and 1600 (a caster that
+		// comes or goes is a change too, so only count frames
+		// where the set's the same as last frame's)
+		if (frame > 1501 && frame < 1600 && casters.size() == lastCasterCount && !cache.IsIdle())
+			busyStillFrames++;
+		lastCasterCount = casters.size();
+	}
+
+	if (mismatchedFrames > 0)
+		printf("%u frames differed from a full redraw, the first being frame %u\n", mismatchedFrames, firstMismatch);
+	CHECK(mismatchedFrames == 0);
+	CHECK(busyStillFrames == 0);
+
+	printf("Static casters drawn: %llu redrawing everything, %llu cached\n",
+		(unsigned long long)fullStaticDraws, (unsigned long long)cachedStaticDraws);
+	printf("Texels drawn: %llu redrawing everything, %llu cached (%.1f%%)\n",
+		(unsigned long long)fullTexels, (unsigned long long)cachedTexels, 100.0 * cachedTexels / fullTexels);
+	CHECK(cachedStaticDraws * 20 < fullStaticDraws);
+	CHECK(cachedTexels < fullTexels);
+}
+
+static void TestStillScene()
+{
+	ShadowCache cache;
+	std::vector<ShadowCacheView> views;
+	std::vector<ShadowCaster> casters;
+	MakeViews(0, views);
+	MakeCasters(1550, casters);
+
+	// The first frame draws everything...
+	cache.Update(views.data(), (uint32_t)views.size(), casters.data(), (uint32_t)casters.size());
+	CHECK(!cache.IsIdle());
+	for (uint32_t s = 0; s < cache.GetSliceCount(); s++)
+		CHECK(cache.GetWork(s).RebuildStatic);
+
+	// ...and then nothing, until something moves
+	for (int frame = 0; frame < 10; frame++)
+	{
+		cache.Update(views.data(), (uint32_t)views.size(), casters.data(), (uint32_t)casters.size());
+		CHECK(cache.IsIdle());
+	}
+
+	// One dynamic caster moving dirties only around it
+	casters.back().Center[0] += 0.5f;
+	casters.back().World[12] += 0.5f;
+	cache.Update(views.data(), (uint32_t)views.size(), casters.data(), (uint32_t)casters.size());
+	CHECK(!cache.IsIdle());
+	for (uint32_t s = 0; s < cache.GetSliceCount(); s++)
+	{
+		const ShadowCacheSliceWork& work = cache.GetWork(s);
+		CHECK(!work.RebuildStatic);
+		for (const ShadowCacheRegion& region : work.Regions)
+			CHECK(region.Rect.GetArea() < (uint64_t)views[s].Resolution * views[s].Resolution);
+	}
+
+	// A static caster moving rebuilds the slices it's in
+	casters[0].Center[1] += 1.0f;
+	casters[0].World[13] += 1.0f;
+	cache.Update(views.data(), (uint32_t)views.size(), casters.data(), (uint32_t)casters.size());
+	bool rebuilt = false;
+	for (uint32_t s = 0; s < cache.GetSliceCount(); s++)
+		rebuilt |= cache.GetWork(s).RebuildStatic;
+	CHECK(rebuilt);
+}
+
+static void TestRects()
+{
+	ShadowCacheRect a = { 0, 0, 10, 10 };
+	ShadowCacheRect b = { 5, 5, 20, 20 };
+	ShadowCacheRect c = { 10, 0, 20, 10 };
+	ShadowCacheRect empty;
+	CHECK(a.Overlaps(b));
+	CHECK(!a.Overlaps(c));		// Touching isn't overlapping
+	CHECK(!a.Overlaps(empty));
+	CHECK(a.Union(b).GetArea() == 400);
+	CHECK(a.Union(empty).GetArea() == a.GetArea());
+
+	// Off the map, or outside the depth range, is empty
+	ShadowCacheView view = MakeView(0.0f, 1.0f, 10.0f, 80.0f, 64);
+	float center[3] = { 0, 0, 0 };
+	CHECK(!ShadowCache::ProjectSphere(view, center, 1.0f).IsEmpty());
+	float farAway[3] = { 1000, 0, 0 };
+	CHECK(ShadowCache::ProjectSphere(view, farAway, 1.0f).IsEmpty());
+	float tooDeep[3] = { view.ViewProjection[2] * 100000, view.ViewProjection[6] * 100000, view.ViewProjection[10] * 100000 };
+	CHECK(ShadowCache::ProjectSphere(view, tooDeep, 1.0f).IsEmpty());
+}
+
+int main()
+{
+	TestRects();
+	TestStillScene();
+	TestMatchesFullRedraw();
+	return TestResult();
+}
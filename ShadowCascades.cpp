@@ -0,0 +1,250 @@
+#include "ShadowCascades.h"
+
+#include <cmath>
+#include <float.h>
+#include <string.h>
+
+// Small vector helpers
+static float Dot(const float a[3], const float b[3])
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void Cross(const float a[3], const float b[3], float out[3])
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static bool Normalize(float v[3])
+{
+	float length = sqrtf(Dot(v, v));
+	if (length <= 1e-6f)
+		return false;
+
+	v[0] /= length;
+	v[1] /= length;
+	v[2] /= length;
+	return true;
+}
+
+// Row-major 4x4 multiply (out = a * b, row vectors as in DirectXMath)
+static void Multiply(const float a[16], const float b[16], float out[16])
+{
+	for (int row = 0; row < 4; row++)
+	{
+		for (int col = 0; col < 4; col++)
+		{
+			out[row * 4 + col] =
+				a[row * 4 + 0] * b[0 * 4 + col] +
+				a[row * 4 + 1] * b[1 * 4 + col] +
+				a[row * 4 + 2] * b[2 * 4 + col] +
+				a[row * 4 + 3] * b[3 * 4 + col];
+		}
+	}
+}
+
+// Constructor
+ShadowCascades::ShadowCascades() :
+	cascadeCount(0),
+	cameraForward{ 0, 0, 1 },
+	lightRight{ 1, 0, 0 },
+	lightUp{ 0, 1, 0 },
+	lightForward{ 0, 0, 1 }
+{
+}
+
+// Destructor
+ShadowCascades::~ShadowCascades()
+{
+}
+
+// --------------------------------------------------------
+// Splits the camera's view and fits a snapped orthographic
+// projection around each slice
+// --------------------------------------------------------
+void ShadowCascades::Update(const ShadowCascadeConfig& _config, const ShadowCascadeCamera& camera, const float lightDirection[3])
+{
+	config = _config;
+	cascadeCount = config.CascadeCount;
+	if (cascadeCount < 1) cascadeCount = 1;
+	if (cascadeCount > MAX_SHADOW_CASCADES) cascadeCount = MAX_SHADOW_CASCADES;
+	memcpy(cameraForward, camera.Forward, sizeof(cameraForward));
+
+	// Light space basis, like XMMatrixLookToLH with world up
+	// (or world forward, if the light points straight up/down)
+	memcpy(lightForward, lightDirection, sizeof(lightForward));
+	if (!Normalize(lightForward))
+	{
+		lightForward[0] = 0;
+		lightForward[1] = -1;
+		lightForward[2] = 0;
+	}
+
+	float worldUp[3] = { 0, 1, 0 };
+	if (fabsf(lightForward[1]) > 0.999f)
+	{
+		worldUp[1] = 0;
+		worldUp[2] = 1;
+	}
+	Cross(worldUp, lightForward, lightRight);
+	Normalize(lightRight);
+	Cross(lightForward, lightRight, lightUp);
+
+	// Split distances
+	float farZ = fminf(camera.FarZ, config.MaxDistance);
+	if (farZ <= camera.NearZ)
+		farZ = camera.NearZ * 2.0f;
+
+	float splits[MAX_SHADOW_CASCADES + 1];
+	ComputeSplits(camera.NearZ, farZ, cascadeCount, config.SplitLambda, splits);
+
+	for (uint32_t i = 0; i < cascadeCount; i++)
+	{
+		ShadowCascade& cascade = cascades[i];
+		cascade.SplitNear = splits[i];
+		cascade.SplitFar = splits[i + 1];
+		FitSliceSphere(camera, cascade.SplitNear, cascade.SplitFar, cascade.Center, cascade.Radius);
+
+		// Snap the sphere's center to the texel grid in light space -
+		// the size never changes, so this keeps texels fixed in the world.
+		// The box gets a one texel border, as snapping moves it up to that far.
+		float resolution = (float)(config.Resolution > 2 ? config.Resolution : 3);
+		cascade.HalfSize = cascade.Radius * resolution / (resolution - 2.0f);
+		cascade.TexelSize = cascade.HalfSize * 2.0f / resolution;
+
+		float centerX = Dot(cascade.Center, lightRight);
+		float centerY = Dot(cascade.Center, lightUp);
+		float centerZ = Dot(cascade.Center, lightForward);
+		float snappedX = floorf(centerX / cascade.TexelSize) * cascade.TexelSize;
+		float snappedY = floorf(centerY / cascade.TexelSize) * cascade.TexelSize;
+
+		// The eye backs up past the sphere to catch casters outside the slice
+		float eyeZ = centerZ - cascade.HalfSize - config.CasterDistance;
+		cascade.LightSpaceOrigin[0] = snappedX;
+		cascade.LightSpaceOrigin[1] = snappedY;
+		cascade.LightSpaceOrigin[2] = eyeZ;
+
+		float eye[3];
+		for (int axis = 0; axis < 3; axis++)
+			eye[axis] = lightRight[axis] * snappedX + lightUp[axis] * snappedY + lightForward[axis] * eyeZ;
+
+		// View: rotation into light space, then translation
+		float* view = cascade.View;
+		memset(view, 0, sizeof(cascade.View));
+		for (int axis = 0; axis < 3; axis++)
+		{
+			view[axis * 4 + 0] = lightRight[axis];
+			view[axis * 4 + 1] = lightUp[axis];
+			view[axis * 4 + 2] = lightForward[axis];
+		}
+		view[12] = -Dot(lightRight, eye);
+		view[13] = -Dot(lightUp, eye);
+		view[14] = -Dot(lightForward, eye);
+		view[15] = 1.0f;
+
+		// Orthographic, like XMMatrixOrthographicLH
+		float nearPlane = 0.0f;
+		float farPlane = cascade.HalfSize * 2.0f + config.CasterDistance;
+		float* projection = cascade.Projection;
+		memset(projection, 0, sizeof(cascade.Projection));
+		projection[0] = 1.0f / cascade.HalfSize;
+		projection[5] = 1.0f / cascade.HalfSize;
+		projection[10] = 1.0f / (farPlane - nearPlane);
+		projection[14] = -nearPlane / (farPlane - nearPlane);
+		projection[15] = 1.0f;
+
+		Multiply(cascade.View, cascade.Projection, cascade.ViewProjection);
+	}
+}
+
+// --------------------------------------------------------
+// Packs the per-frame cascade data for the shaders
+// --------------------------------------------------------
+void ShadowCascades::GetShaderInfo(ShadowCascadeShaderInfo& info) const
+{
+	memset(&info, 0, sizeof(ShadowCascadeShaderInfo));
+	for (uint32_t i = 0; i < MAX_SHADOW_CASCADES; i++)
+	{
+		// Unused cascades never end, so the shader's count of
+		// "splits behind this pixel" only counts real ones
+		info.SplitFar[i] = FLT_MAX;
+		if (i >= cascadeCount)
+			continue;
+
+		memcpy(info.ViewProjection[i], cascades[i].ViewProjection, sizeof(info.ViewProjection[i]));
+		info.SplitFar[i] = cascades[i].SplitFar;
+	}
+
+	memcpy(info.CameraForward, cameraForward, sizeof(info.CameraForward));
+	info.CascadeCount = cascadeCount;
+}
+
+// --------------------------------------------------------
+// Tests a caster's bounding sphere against the cascade's
+// light space box (which reaches back towards the light)
+// --------------------------------------------------------
+bool ShadowCascades::IsCasterVisible(uint32_t index, const float center[3], float radius) const
+{
+	if (index >= cascadeCount)
+		return false;
+
+	const ShadowCascade& cascade = cascades[index];
+	float x = Dot(center, lightRight) - cascade.LightSpaceOrigin[0];
+	float y = Dot(center, lightUp) - cascade.LightSpaceOrigin[1];
+	float z = Dot(center, lightForward) - cascade.LightSpaceOrigin[2];
+	float farPlane = cascade.HalfSize * 2.0f + config.CasterDistance;
+
+	return
+		fabsf(x) <= cascade.HalfSize + radius &&
+		fabsf(y) <= cascade.HalfSize + radius &&
+		z + radius >= 0.0f &&
+		z - radius <= farPlane;
+}
+
+// --------------------------------------------------------
+// Practical split scheme (Zhang et al.):
+//   split_i = lerp(uniform_i, log_i, lambda)
+// Fills count + 1 distances, from nearZ to farZ
+// --------------------------------------------------------
+void ShadowCascades::ComputeSplits(float nearZ, float farZ, uint32_t count, float lambda, float* splits)
+{
+	splits[0] = nearZ;
+	for (uint32_t i = 1; i < count; i++)
+	{
+		float fraction = (float)i / count;
+		float logSplit = nearZ * powf(farZ / nearZ, fraction);
+		float uniformSplit = nearZ + (farZ - nearZ) * fraction;
+		splits[i] = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+	}
+	splits[count] = farZ;
+}
+
+// --------------------------------------------------------
+// Smallest sphere around a slice of the camera's frustum.
+// Its center lies on the view axis, and it only depends on
+// the slice & FOV, so rotating the camera never resizes it.
+// --------------------------------------------------------
+void ShadowCascades::FitSliceSphere(const ShadowCascadeCamera& camera, float sliceNear, float sliceFar, float center[3], float& radius)
+{
+	// Corner distance from the axis, per unit of depth
+	float cornerSlopeSq = camera.TanHalfFovX * camera.TanHalfFovX + camera.TanHalfFovY * camera.TanHalfFovY;
+	float nearRadiusSq = sliceNear * sliceNear * cornerSlopeSq;
+	float farRadiusSq = sliceFar * sliceFar * cornerSlopeSq;
+
+	// Equidistant from the near & far corners, kept within the slice
+	float centerZ = sliceFar;
+	if (sliceFar > sliceNear)
+	{
+		centerZ = (sliceFar * sliceFar + farRadiusSq - sliceNear * sliceNear - nearRadiusSq) / (2.0f * (sliceFar - sliceNear));
+		centerZ = fmaxf(sliceNear, fminf(centerZ, sliceFar));
+	}
+
+	float toNear = centerZ - sliceNear;
+	float toFar = sliceFar - centerZ;
+	radius = sqrtf(fmaxf(toNear * toNear + nearRadiusSq, toFar * toFar + farRadiusSq));
+
+	for (int axis = 0; axis < 3; axis++)
+		center[axis] = camera.Position[axis] + camera.Forward[axis] * centerZ;
+}
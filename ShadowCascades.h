@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdint.h>
+
+// Cascade count is fixed at compile time so the split
+// distances fit in one float4 on the shader side
+#define MAX_SHADOW_CASCADES 4
+
+// --------------------------------------------------------
+// The camera the cascades are fitted to, in world space
+// --------------------------------------------------------
+struct ShadowCascadeCamera
+{
+	float Position[3] = { 0, 0, 0 };
+	float Right[3] = { 1, 0, 0 };
+	float Up[3] = { 0, 1, 0 };
+	float Forward[3] = { 0, 0, 1 };
+
+	float NearZ = 0.1f;
+	float FarZ = 100.0f;
+
+	// From the projection matrix: 1/_11 and 1/_22
+	float TanHalfFovX = 1.0f;
+	float TanHalfFovY = 1.0f;
+};
+
+// --------------------------------------------------------
+// How the view is split between cascades
+// --------------------------------------------------------
+struct ShadowCascadeConfig
+{
+	uint32_t CascadeCount = MAX_SHADOW_CASCADES;
+	uint32_t Resolution = 2048;		// Per cascade
+
+	// Practical split scheme blend: 0 = uniform, 1 = logarithmic
+	float SplitLambda = 0.75f;
+
+	// Shadows end here (or at the camera's far clip, if closer)
+	float MaxDistance = 100.0f;
+
+	// How far towards the light, past a cascade's bounds,
+	// casters are still rendered
+	float CasterDistance = 50.0f;
+};
+
+// --------------------------------------------------------
+// One fitted cascade.  Matrices are row-major with D3D's
+// left handed conventions, laid out like XMFLOAT4X4.
+// --------------------------------------------------------
+struct ShadowCascade
+{
+	float SplitNear = 0;
+	float SplitFar = 0;
+
+	// Bounding sphere of the camera frustum slice
+	float Center[3] = { 0, 0, 0 };
+	float Radius = 0;
+
+	// Half the width of the projection (the radius plus a texel)
+	// and the world units per shadow map texel
+	float HalfSize = 0;
+	float TexelSize = 0;
+
+	float View[16] = {};
+	float Projection[16] = {};
+	float ViewProjection[16] = {};
+
+	// Light space origin of the (snapped) projection, for culling
+	float LightSpaceOrigin[3] = { 0, 0, 0 };
+};
+
+// --------------------------------------------------------
+// Everything the shaders need to pick and sample a cascade
+// (matches ShadowCascadeInfo in ShadowCascades.hlsli)
+// --------------------------------------------------------
+struct ShadowCascadeShaderInfo
+{
+	float ViewProjection[MAX_SHADOW_CASCADES][16];
+	float SplitFar[MAX_SHADOW_CASCADES];
+	float CameraForward[3];
+	uint32_t CascadeCount;
+};
+
+// --------------------------------------------------------
+// Cascaded shadow maps for a directional light.
+//
+// - Splits use the "practical" scheme: a blend between
+//   logarithmic and uniform split distances
+// - Each slice is bounded by a sphere, so the cascade's
+//   size doesn't change as the camera rotates
+// - Each projection is snapped to whole texels in light
+//   space, so shadow edges don't shimmer as it moves
+//
+// There's no Direct3D dependency here.
+// --------------------------------------------------------
+class ShadowCascades
+{
+public:
+	ShadowCascades();
+	~ShadowCascades();
+
+	// Refits every cascade - call once per frame
+	void Update(const ShadowCascadeConfig& config, const ShadowCascadeCamera& camera, const float lightDirection[3]);
+
+	// Getters
+	uint32_t GetCascadeCount() const { return cascadeCount; }
+	const ShadowCascade& GetCascade(uint32_t index) const { return cascades[index]; }
+	const ShadowCascadeConfig& GetConfig() const { return config; }
+	void GetShaderInfo(ShadowCascadeShaderInfo& info) const;
+
+	// Caster culling - could this world space sphere cast a
+	// shadow into the given cascade?
+	bool IsCasterVisible(uint32_t cascade, const float center[3], float radius) const;
+
+	// Split & fit math
+	static void ComputeSplits(float nearZ, float farZ, uint32_t count, float lambda, float* splits);
+	static void FitSliceSphere(const ShadowCascadeCamera& camera, float sliceNear, float sliceFar, float center[3], float& radius);
+
+private:
+	ShadowCascadeConfig config;
+	uint32_t cascadeCount;
+	ShadowCascade cascades[MAX_SHADOW_CASCADES];
+	float cameraForward[3];
+
+	// Light space basis (rows of the light's rotation)
+	float lightRight[3];
+	float lightUp[3];
+	float lightForward[3];
+};
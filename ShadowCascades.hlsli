@@ -0,0 +1,47 @@
+#ifndef __GGP__SHADOW__CASCADES__
+#define __GGP__SHADOW__CASCADES__
+
+// Must match MAX_SHADOW_CASCADES in ShadowCascades.h
+#define MAX_SHADOW_CASCADES 4
+
+// Per-frame cascade data - matches ShadowCascadeShaderInfo in ShadowCascades.h
+struct ShadowCascadeInfo
+{
+	matrix	ViewProjection[MAX_SHADOW_CASCADES];
+	float4	SplitFar;		// View depth where each cascade ends
+	float3	CameraForward;
+	uint	CascadeCount;
+};
+
+// --------------------------------------------------------
+// Picks the cascade for a pixel's view depth and returns
+// how lit it is (1 = fully lit).  Past the last cascade
+// nothing is shadowed.
+// --------------------------------------------------------
+float SampleShadowCascades(
+	Texture2DArray shadowMap,
+	SamplerComparisonState shadowSampler,
+	ShadowCascadeInfo info,
+	float3 worldPos,
+	float viewDepth)
+{
+	uint cascade = (uint)dot((float4)(viewDepth > info.SplitFar), 1.0f);
+	if (cascade >= info.CascadeCount)
+		return 1.0f;
+
+	// Perform the perspective divide (divide by W) ourselves
+	float4 shadowMapPos = mul(info.ViewProjection[cascade], float4(worldPos, 1));
+	shadowMapPos /= shadowMapPos.w;
+
+	// Convert the normalized device coordinates to UVs for sampling
+	float2 shadowUV = shadowMapPos.xy * 0.5f + 0.5f;
+	shadowUV.y = 1 - shadowUV.y; // Flip the Y
+
+	// Get a ratio of comparison results using SampleCmpLevelZero()
+	return shadowMap.SampleCmpLevelZero(
+		shadowSampler,
+		float3(shadowUV, cascade),
+		shadowMapPos.z).r;
+}
+
+#endif
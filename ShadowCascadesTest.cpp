@@ -0,0 +1,197 @@
+// --------------------------------------------------------
+// Tests ShadowCascades' split and fit math:
+//
+//  - splits run from near to far, always increasing, and
+//    lambda 0 and 1 give the uniform and logarithmic splits
+//  - a slice's bounding sphere holds every corner of the
+//    slice, and keeps its radius as the camera turns
+//  - cascades keep their size as the camera turns and
+//    moves, and their origins only move in whole texels
+// --------------------------------------------------------
+#include <cmath>
+
+#include "ShadowCascades.h"
+#include "TestCheck.h"
+
+static bool Near(float a, float b, float tolerance = 1e-4f)
+{
+	return fabsf(a - b) <= tolerance * (fabsf(b) > 1.0f ? fabsf(b) : 1.0f);
+}
+
+// How far value is from a whole number of steps, in steps
+static float OffGrid(float value, float step)
+{
+	float steps = value / step;
+	return fabsf(steps - roundf(steps));
+}
+
+// A camera at position, turned by yaw & pitch, with a 60
+// degree vertical FOV at 16:9
+static ShadowCascadeCamera MakeCamera(float yaw, float pitch, float x, float y, float z)
+{
+	ShadowCascadeCamera camera;
+	camera.Position[0] = x;
+	camera.Position[1] = y;
+	camera.Position[2] = z;
+
+	float forward[3] = { cosf(pitch) * sinf(yaw), -sinf(pitch), cosf(pitch) * cosf(yaw) };
+	float right[3] = { cosf(yaw), 0.0f, -sinf(yaw) };
+	for (int axis = 0; axis < 3; axis++)
+	{
+		camera.Forward[axis] = forward[axis];
+		camera.Right[axis] = right[axis];
+	}
+	camera.Up[0] = forward[1] * right[2] - forward[2] * right[1];
+	camera.Up[1] = forward[2] * right[0] - forward[0] * right[2];
+	camera.Up[2] = forward[0] * right[1] - forward[1] * right[0];
+
+	camera.NearZ = 0.1f;
+	camera.FarZ = 200.0f;
+	camera.TanHalfFovY = tanf(0.5236f);
+	camera.TanHalfFovX = camera.TanHalfFovY * 16.0f / 9.0f;
+	return camera;
+}
+
+static void TestSplits()
+{
+	const float lambdas[] = { 0.0f, 0.25f, 0.5f, 0.75f, 1.0f };
+	float splits[MAX_SHADOW_CASCADES + 1];
+
+	for (float lambda : lambdas)
+	{
+		for (uint32_t count = 1; count <= MAX_SHADOW_CASCADES; count++)
+		{
+			ShadowCascades::ComputeSplits(0.1f, 100.0f, count, lambda, splits);
+			CHECK(splits[0] == 0.1f);
+			CHECK(splits[count] == 100.0f);
+
+			bool increasing = true;
+			for (uint32_t i = 0; i < count; i++)
+				increasing &= splits[i + 1] > splits[i];
+			CHECK(increasing);
+		}
+	}
+
+	// Lambda 0 is uniform
+	ShadowCascades::ComputeSplits(1.0f, 101.0f, 4, 0.0f, splits);
+	CHECK(Near(splits[1], 26.0f) && Near(splits[2], 51.0f) && Near(splits[3], 76.0f));
+
+	// Lambda 1 is logarithmic - a constant ratio from one to the next
+	ShadowCascades::ComputeSplits(1.0f, 10000.0f, 4, 1.0f, splits);
+	CHECK(Near(splits[1], 10.0f) && Near(splits[2], 100.0f) && Near(splits[3], 1000.0f));
+
+	// Anything between lies between them
+	float uniform[MAX_SHADOW_CASCADES + 1];
+	float logarithmic[MAX_SHADOW_CASCADES + 1];
+	ShadowCascades::ComputeSplits(0.5f, 150.0f, 4, 0.0f, uniform);
+	ShadowCascades::ComputeSplits(0.5f, 150.0f, 4, 1.0f, logarithmic);
+	ShadowCascades::ComputeSplits(0.5f, 150.0f, 4, 0.6f, splits);
+	for (uint32_t i = 1; i < 4; i++)
+		CHECK(splits[i] < uniform[i] && splits[i] > logarithmic[i]);
+}
+
+static void TestSliceSphere()
+{
+	ShadowCascadeCamera reference = MakeCamera(0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+	float referenceCenter[3];
+	float referenceRadius;
+	ShadowCascades::FitSliceSphere(reference, 5.0f, 20.0f, referenceCenter, referenceRadius);
+	CHECK(referenceRadius > 0.0f);
+
+	for (int turn = 0; turn < 64; turn++)
+	{
+		ShadowCascadeCamera camera = MakeCamera(turn * 0.37f, sinf(turn * 0.61f) * 1.4f, 3.0f, -2.0f, 7.0f);
+		float center[3];
+		float radius;
+		ShadowCascades::FitSliceSphere(camera, 5.0f, 20.0f, center, radius);
+		CHECK(Near(radius, referenceRadius, 1e-5f));
+
+		// The center's on the view axis...
+		float along = 0;
+		for (int axis = 0; axis < 3; axis++)
+			along += (center[axis] - camera.Position[axis]) * camera.Forward[axis];
+		bool onAxis = true;
+		for (int axis = 0; axis < 3; axis++)
+			onAxis &= Near(center[axis], camera.Position[axis] + camera.Forward[axis] * along, 1e-4f);
+		CHECK(onAxis);
+		CHECK(along >= 5.0f - 1e-4f && along <= 20.0f + 1e-4f);
+
+		// ...and every corner of the slice is inside the sphere
+		bool inside = true;
+		for (int corner = 0; corner < 8; corner++)
+		{
+			float depth = corner & 1 ? 20.0f : 5.0f;
+			float x = (corner & 2 ? 1.0f : -1.0f) * camera.TanHalfFovX * depth;
+			float y = (corner & 4 ? 1.0f : -1.0f) * camera.TanHalfFovY * depth;
+			float distanceSq = 0;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float p = camera.Position[axis] + camera.Forward[axis] * depth + camera.Right[axis] * x + camera.Up[axis] * y;
+				distanceSq += (p - center[axis]) * (p - center[axis]);
+			}
+			inside &= sqrtf(distanceSq) <= radius * 1.0001f;
+		}
+		CHECK(inside);
+	}
+}
+
+static void TestTexelSnapping()
+{
+	ShadowCascadeConfig config;
+	config.CascadeCount = 3;
+	config.Resolution = 1024;
+	config.MaxDistance = 80.0f;
+	const float light[3] = { 0.4f, -1.0f, 0.3f };
+
+	ShadowCascades cascades;
+	cascades.Update(config, MakeCamera(0.0f, 0.2f, 0.0f, 2.0f, 0.0f), light);
+	CHECK(cascades.GetCascadeCount() == 3);
+	ShadowCascade first[3];
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		first[i] = cascades.GetCascade(i);
+		CHECK(Near(first[i].TexelSize, first[i].HalfSize * 2.0f / config.Resolution, 1e-5f));
+		CHECK(first[i].HalfSize > first[i].Radius);
+	}
+	CHECK(Near(first[2].SplitFar, 80.0f));
+
+	// Wander around, turning as we go
+	for (int frame = 1; frame < 200; frame++)
+	{
+		float t = frame * 0.05f;
+		ShadowCascadeCamera camera = MakeCamera(t * 0.7f, 0.2f + 0.3f * sinf(t), 13.7f * sinf(t * 0.3f), 2.0f + 0.1f * frame, 5.3f * t);
+		cascades.Update(config, camera, light);
+
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			const ShadowCascade& cascade = cascades.GetCascade(i);
+
+			// Same size, so the same texels
+			CHECK(Near(cascade.HalfSize, first[i].HalfSize, 1e-5f));
+			CHECK(Near(cascade.TexelSize, first[i].TexelSize, 1e-5f));
+
+			// The origin has only moved by whole texels
+			float movedX = cascade.LightSpaceOrigin[0] - first[i].LightSpaceOrigin[0];
+			float movedY = cascade.LightSpaceOrigin[1] - first[i].LightSpaceOrigin[1];
+			CHECK(OffGrid(movedX, cascade.TexelSize) < 0.01f);
+			CHECK(OffGrid(movedY, cascade.TexelSize) < 0.01f);
+
+			// The slice's sphere is still inside the box, and
+			// anything in it could cast a shadow
+			CHECK(cascades.IsCasterVisible(i, cascade.Center, cascade.Radius));
+		}
+	}
+
+	// Something far off to the side can't
+	const float away[3] = { 5000.0f, 0.0f, 5000.0f };
+	CHECK(!cascades.IsCasterVisible(0, away, 1.0f));
+	CHECK(!cascades.IsCasterVisible(3, away, 1.0f));
+}
+
+int main()
+{
+	TestSplits();
+	TestSliceSphere();
+	TestTexelSnapping();
+	return TestResult();
+}
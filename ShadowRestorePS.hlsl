@@ -0,0 +1,23 @@
+
+cbuffer externalData : register(b0)
+{
+	uint slice;
+}
+
+struct VertexToPixel
+{
+	float4 position : SV_POSITION;
+	float2 uv : TEXCOORD0;
+};
+
+// The static caster depth for every cascade
+Texture2DArray StaticShadowMap : register(t0);
+
+// --------------------------------------------------------
+// Copies cached static depth back into the shadow map,
+// under a scissor rect covering a dirty region
+// --------------------------------------------------------
+float main(VertexToPixel input) : SV_DEPTH
+{
+	return StaticShadowMap.Load(int4(input.position.xy, slice, 0)).r;
+}
@@ -49,6 +49,7 @@ void ISimpleShader::CleanUp()
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
 		delete[] constantBuffers[i].LocalDataBuffer;
+		delete[] constantBuffers[i].RingBlocks;
 	}
 
 	if (constantBuffers)
@@ -57,11 +58,8 @@ void ISimpleShader::CleanUp()
 		constantBufferCount = 0;
 	}
 
-	for (unsigned int i = 0; i < shaderResourceViews.size(); i++)
-		delete shaderResourceViews[i];
-	
-	for (unsigned int i = 0; i < samplerStates.size(); i++)
-		delete samplerStates[i];
+	shaderResourceViews.clear();
+	samplerStates.clear();
 
 	// Clean up tables
 	varTable.clear();
@@ -94,6 +92,35 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
+	// Reflection results are cached next to the .cso, keyed by a hash
+	// of the bytecode - only reflect if there's no valid cache yet
+	uint64_t bytecodeHash = ShaderReflectionCache::HashBytecode(
+		shaderBlob->GetBufferPointer(),
+		shaderBlob->GetBufferSize());
+	std::filesystem::path cacheFile = ShaderReflectionCache::GetCachePath(shaderFile);
+	if (!ShaderReflectionCache::Load(cacheFile, bytecodeHash, &reflection))
+	{
+		if (!ReflectShader(bytecodeHash))
+		{
+			if (ReportErrors)
+			{
+				LogError("SimpleShader::LoadShaderFile() - Error reflecting shader from file '");
+				LogW(shaderFile);
+				LogError("'.\n");
+			}
+
+			return false;
+		}
+
+		// Failing to write the cache isn't fatal (the folder may be read-only)
+		if (!ShaderReflectionCache::Save(cacheFile, reflection) && ReportWarnings)
+		{
+			LogWarning("SimpleShader::LoadShaderFile() - Unable to write reflection cache for '");
+			LogWarningW(shaderFile);
+			LogWarning("'.\n");
+		}
+	}
+
 	// Create the shader - Calls an overloaded version of this abstract
 	// method in the appropriate child class
 	shaderValid = CreateShader(shaderBlob);
@@ -109,23 +136,115 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
+	// Textures & samplers live in contiguous arrays, so reserve
+	// up front to keep the table pointers stable
+	shaderResourceViews.reserve(reflection.Textures.size());
+	samplerStates.reserve(reflection.Samplers.size());
+
+	for (auto& texture : reflection.Textures)
+	{
+		SimpleSRV srv = {};
+		srv.BindIndex = texture.BindIndex;							// Shader bind point
+		srv.Index = (unsigned int)shaderResourceViews.size();	// Raw index
+
+		shaderResourceViews.push_back(srv);
+		textureTable.insert(std::pair<std::string, SimpleSRV*>(texture.Name, &shaderResourceViews.back()));
+	}
+
+	for (auto& sampler : reflection.Samplers)
+	{
+		SimpleSampler samp = {};
+		samp.BindIndex = sampler.BindIndex;					// Shader bind point
+		samp.Index = (unsigned int)samplerStates.size();	// Raw index
+
+		samplerStates.push_back(samp);
+		samplerTable.insert(std::pair<std::string, SimpleSampler*>(sampler.Name, &samplerStates.back()));
+	}
+
+	// Create resource arrays
+	constantBufferCount = (unsigned int)reflection.ConstantBuffers.size();
+	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
+
+	// Loop through all constant buffers
+	for (unsigned int b = 0; b < constantBufferCount; b++)
+	{
+		const ShaderReflectionBuffer& bufferDesc = reflection.ConstantBuffers[b];
+
+		// Save the type, which we reference when setting these buffers
+		constantBuffers[b].Type = (D3D_CBUFFER_TYPE)bufferDesc.Type;
+
+		// Set up the buffer and put its pointer in the table
+		constantBuffers[b].BindIndex = bufferDesc.BindIndex;
+		constantBuffers[b].Name = bufferDesc.Name;
+		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
+
+		// Create this constant buffer
+		D3D11_BUFFER_DESC newBuffDesc = {};
+		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
+		newBuffDesc.ByteWidth = ((bufferDesc.Size + 15) / 16) * 16; // Quick and dirty 16-byte alignment using integer division
+		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		newBuffDesc.CPUAccessFlags = 0;
+		newBuffDesc.MiscFlags = 0;
+		newBuffDesc.StructureByteStride = 0;
+		device->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
+
+		// Set up the data buffer for this constant buffer (a copy per thread slot)
+		constantBuffers[b].Size = bufferDesc.Size;
+		constantBuffers[b].SlotCount = threadSlotCount;
+		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size * threadSlotCount];
+		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size * threadSlotCount);
+		constantBuffers[b].RingBlocks = new SimpleRingBlock[threadSlotCount];
+
+		// Loop through all variables in this buffer
+		constantBuffers[b].Variables.reserve(bufferDesc.Variables.size());
+		for (auto& varDesc : bufferDesc.Variables)
+		{
+			// Create the variable struct
+			SimpleShaderVariable varStruct = {};
+			varStruct.ConstantBufferIndex = b;
+			varStruct.ByteOffset = varDesc.ByteOffset;
+			varStruct.Size = varDesc.Size;
+
+			// Add this variable to the table and the constant buffer
+			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varDesc.Name, varStruct));
+			constantBuffers[b].Variables.push_back(varStruct);
+		}
+	}
+
+	// All set
+	return true;
+}
+
+// --------------------------------------------------------
+// Fills in the reflection data for the loaded shader blob
+// using D3DReflect.  This is the slow path - results are
+// cached by LoadShaderFile() so it only runs when a shader
+// has been recompiled.
+//
+// bytecodeHash - Hash of the blob, stored with the data
+//
+// Returns true if reflection succeeded, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::ReflectShader(uint64_t bytecodeHash)
+{
+	reflection = {};
+	reflection.BytecodeHash = bytecodeHash;
+
 	// Set up shader reflection to get information about
 	// this shader and its variables,  buffers, etc.
 	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
+	HRESULT hr = D3DReflect(
 		shaderBlob->GetBufferPointer(),
 		shaderBlob->GetBufferSize(),
 		IID_ID3D11ShaderReflection,
 		(void**)refl.GetAddressOf());
-	
+	if (FAILED(hr))
+		return false;
+
 	// Get the description of the shader
 	D3D11_SHADER_DESC shaderDesc;
 	refl->GetDesc(&shaderDesc);
 
-	// Create resource arrays
-	constantBufferCount = shaderDesc.ConstantBuffers;
-	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
-	
 	// Handle bound resources (like shaders and samplers)
 	unsigned int resourceCount = shaderDesc.BoundResources;
 	for (unsigned int r = 0; r < resourceCount; r++)
@@ -139,69 +258,46 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		{
 		case D3D_SIT_STRUCTURED: // Treat structured buffers as texture resources
 		case D3D_SIT_TEXTURE: // A texture resource
-		{
-			// Create the SRV wrapper
-			SimpleSRV* srv = new SimpleSRV();
-			srv->BindIndex = resourceDesc.BindPoint;				// Shader bind point
-			srv->Index = (unsigned int)shaderResourceViews.size();	// Raw index
-
-			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
-			shaderResourceViews.push_back(srv);
-		}
+			reflection.Textures.push_back({ resourceDesc.Name, resourceDesc.BindPoint });
 			break;
 
 		case D3D_SIT_SAMPLER: // A sampler resource
-		{
-			// Create the sampler wrapper
-			SimpleSampler* samp = new SimpleSampler();
-			samp->BindIndex = resourceDesc.BindPoint;			// Shader bind point
-			samp->Index = (unsigned int)samplerStates.size();	// Raw index
+			reflection.Samplers.push_back({ resourceDesc.Name, resourceDesc.BindPoint });
+			break;
 
-			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resourceDesc.Name, samp));
-			samplerStates.push_back(samp);
-		}
+		case D3D_SIT_UAV_APPEND_STRUCTURED: // Any kind of UAV
+		case D3D_SIT_UAV_CONSUME_STRUCTURED:
+		case D3D_SIT_UAV_RWBYTEADDRESS:
+		case D3D_SIT_UAV_RWSTRUCTURED:
+		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
+		case D3D_SIT_UAV_RWTYPED:
+			reflection.UnorderedAccessViews.push_back({ resourceDesc.Name, resourceDesc.BindPoint });
 			break;
 		}
 	}
 
 	// Loop through all constant buffers
-	for (unsigned int b = 0; b < constantBufferCount; b++)
+	reflection.ConstantBuffers.resize(shaderDesc.ConstantBuffers);
+	for (unsigned int b = 0; b < shaderDesc.ConstantBuffers; b++)
 	{
 		// Get this buffer
 		ID3D11ShaderReflectionConstantBuffer* cb =
 			refl->GetConstantBufferByIndex(b);
-		
+
 		// Get the description of this buffer
 		D3D11_SHADER_BUFFER_DESC bufferDesc;
 		cb->GetDesc(&bufferDesc);
 
-		// Save the type, which we reference when setting these buffers
-		constantBuffers[b].Type = bufferDesc.Type;
-		
 		// Get the description of the resource binding, so
 		// we know exactly how it's bound in the shader
 		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
 		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
-		
-		// Set up the buffer and put its pointer in the table
-		constantBuffers[b].BindIndex = bindDesc.BindPoint;
-		constantBuffers[b].Name = bufferDesc.Name;
-		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
 
-		// Create this constant buffer
-		D3D11_BUFFER_DESC newBuffDesc = {};
-		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
-		newBuffDesc.ByteWidth = ((bufferDesc.Size + 15) / 16) * 16; // Quick and dirty 16-byte alignment using integer division
-		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		newBuffDesc.CPUAccessFlags = 0;
-		newBuffDesc.MiscFlags = 0;
-		newBuffDesc.StructureByteStride = 0;
-		device->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
-
-		// Set up the data buffer for this constant buffer
-		constantBuffers[b].Size = bufferDesc.Size;
-		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
-		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
+		ShaderReflectionBuffer& buffer = reflection.ConstantBuffers[b];
+		buffer.Name = bufferDesc.Name;
+		buffer.Type = (uint32_t)bufferDesc.Type;
+		buffer.BindIndex = bindDesc.BindPoint;
+		buffer.Size = bufferDesc.Size;
 
 		// Loop through all variables in this buffer
 		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
@@ -209,27 +305,46 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 			// Get this variable
 			ID3D11ShaderReflectionVariable* var =
 				cb->GetVariableByIndex(v);
-			
-			// Get the description of the variable and its type
+
+			// Get the description of the variable
 			D3D11_SHADER_VARIABLE_DESC varDesc;
 			var->GetDesc(&varDesc);
 
-			// Create the variable struct
-			SimpleShaderVariable varStruct = {};
-			varStruct.ConstantBufferIndex = b;
-			varStruct.ByteOffset = varDesc.StartOffset;
-			varStruct.Size = varDesc.Size;
-			
-			// Get a string version
-			std::string varName(varDesc.Name);
-
-			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
-			constantBuffers[b].Variables.push_back(varStruct);
+			buffer.Variables.push_back({ varDesc.Name, varDesc.StartOffset, varDesc.Size });
 		}
 	}
 
-	// All set
+	// Input & output signatures (for input layouts and stream out)
+	for (unsigned int i = 0; i < shaderDesc.InputParameters; i++)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		refl->GetInputParameterDesc(i, &paramDesc);
+		reflection.InputElements.push_back({
+			paramDesc.SemanticName,
+			paramDesc.SemanticIndex,
+			paramDesc.Mask,
+			(uint32_t)paramDesc.ComponentType,
+			paramDesc.Stream });
+	}
+
+	for (unsigned int i = 0; i < shaderDesc.OutputParameters; i++)
+	{
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		refl->GetOutputParameterDesc(i, &paramDesc);
+		reflection.OutputElements.push_back({
+			paramDesc.SemanticName,
+			paramDesc.SemanticIndex,
+			paramDesc.Mask,
+			(uint32_t)paramDesc.ComponentType,
+			paramDesc.Stream });
+	}
+
+	// Thread group size (zero for anything but compute shaders)
+	refl->GetThreadGroupSize(
+		&reflection.ThreadsX,
+		&reflection.ThreadsY,
+		&reflection.ThreadsZ);
+
 	return true;
 }
 
@@ -240,11 +355,10 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 // name - the name of the variable to look for
 // size - the size of the variable (for verification), or -1 to bypass
 // --------------------------------------------------------
-SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
+SimpleShaderVariable* ISimpleShader::FindVariable(std::string_view name, int size)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleShaderVariable>::iterator result =
-		varTable.find(name);
+	auto result = varTable.find(name);
 
 	// Did we find the key?
 	if (result == varTable.end())
@@ -264,11 +378,10 @@ SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
 // --------------------------------------------------------
 // Helper for looking up a constant buffer by name
 // --------------------------------------------------------
-SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string name)
+SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string_view name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleConstantBuffer*>::iterator result =
-		cbTable.find(name);
+	auto result = cbTable.find(name);
 
 	// Did we find the key?
 	if (result == cbTable.end())
@@ -325,14 +438,14 @@ void ISimpleShader::LogWarningW(std::wstring message) { LogW(message, FOREGROUND
 // --------------------------------------------------------
 // Sets the shader and associated constant buffers in Direct3D
 // --------------------------------------------------------
-void ISimpleShader::SetShader()
+void ISimpleShader::SetShader(ID3D11DeviceContext* context)
 {
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
 	// Set the shader and any relevant constant buffers, which
 	// is an overloaded method in a subclass
-	SetShaderAndCBs();
+	SetShaderAndCBs(ResolveContext(context));
 }
 
 // --------------------------------------------------------
@@ -340,7 +453,7 @@ void ISimpleShader::SetShader()
 // shader's constant buffers.  To just copy one
 // buffer, use CopyBufferData()
 // --------------------------------------------------------
-void ISimpleShader::CopyAllBufferData()
+void ISimpleShader::CopyAllBufferData(ID3D11DeviceContext* context)
 {
 	// Ensure the shader is valid
 	if (!shaderValid) return;
@@ -349,9 +462,7 @@ void ISimpleShader::CopyAllBufferData()
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
 		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer.Get(), 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
+		UploadConstantBuffer(&constantBuffers[i], ResolveContext(context));
 	}
 }
 
@@ -366,7 +477,7 @@ void ISimpleShader::CopyAllBufferData()
 //       as its register, especially if you have buffers
 //       bound to non-sequential registers!
 // --------------------------------------------------------
-void ISimpleShader::CopyBufferData(unsigned int index)
+void ISimpleShader::CopyBufferData(unsigned int index, ID3D11DeviceContext* context)
 {
 	// Ensure the shader is valid
 	if (!shaderValid) return;
@@ -380,9 +491,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadConstantBuffer(cb, ResolveContext(context));
 }
 
 // --------------------------------------------------------
@@ -392,7 +501,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 //              Useful for updating more frequently-changing
 //              variables without having to re-copy all buffers.
 // --------------------------------------------------------
-void ISimpleShader::CopyBufferData(std::string bufferName)
+void ISimpleShader::CopyBufferData(std::string_view bufferName, ID3D11DeviceContext* context)
 {
 	// Ensure the shader is valid
 	if (!shaderValid) return;
@@ -402,12 +511,131 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadConstantBuffer(cb, ResolveContext(context));
+}
+
+// --------------------------------------------------------
+// Picks which copy of every shader's variables the calling
+// thread uses, so threads recording draws at the same time
+// (into their own contexts) don't overwrite each other's
+// --------------------------------------------------------
+thread_local unsigned int ISimpleShader::threadSlot = 0;
+unsigned int ISimpleShader::threadSlotCount = 1;
+
+void ISimpleShader::SetThreadSlot(unsigned int slot)
+{
+	threadSlot = slot;
+}
+
+unsigned int ISimpleShader::GetThreadSlot()
+{
+	return threadSlot;
+}
+
+void ISimpleShader::SetThreadSlotCount(unsigned int count)
+{
+	threadSlotCount = count > 0 ? count : 1;
+}
+
+unsigned int ISimpleShader::GetThreadSlotCount()
+{
+	return threadSlotCount;
 }
 
 
+// --------------------------------------------------------
+// Shares a constant buffer ring with this shader, so future
+// copies are written into the ring and bound at an offset
+// instead of updating this shader's own buffers
+//
+// ring - The ring to use, or null to go back to the shader's
+//        own buffers.  Ignored if the device doesn't support
+//        constant buffer offsets.
+// --------------------------------------------------------
+void ISimpleShader::SetConstantBufferRing(std::shared_ptr<ConstantBufferRing> ring)
+{
+	if (ring && ring->IsSupported())
+		constantBufferRing = ring;
+	else
+		constantBufferRing.reset();
+}
+
+// --------------------------------------------------------
+// The ring to upload through on a context: the shared one
+// on the shader's own context, or the ring attached to a
+// deferred context (see D3D11CommandBackend).  Null if
+// there's none, or the shader hasn't been given a ring.
+// --------------------------------------------------------
+ConstantBufferRing* ISimpleShader::GetRing(ID3D11DeviceContext* context)
+{
+	if (!constantBufferRing)
+		return 0;
+	if (context == deviceContext.Get())
+		return constantBufferRing.get();
+	return ConstantBufferRing::FromContext(context);
+}
+
+// --------------------------------------------------------
+// Copies a buffer's local data to the GPU.  If the context
+// has a ring, the data goes there and the new block is bound
+// to the buffer's register right away (which is why copies
+// should happen after SetShader(), as usual).  Otherwise the
+// shader's own buffer is updated.
+//
+// Each thread slot remembers its own block, so contexts
+// recording on different threads never share one.
+// --------------------------------------------------------
+void ISimpleShader::UploadConstantBuffer(SimpleConstantBuffer* cb, ID3D11DeviceContext* context)
+{
+	unsigned char* data = GetLocalData(cb);
+	SimpleRingBlock& block = GetRingBlock(cb);
+	ConstantBufferRing* ring = GetRing(context);
+
+	// Only true constant buffers can be bound at an offset
+	if (ring && cb->Type == D3D11_CT_CBUFFER &&
+		ring->Write(data, cb->Size, &block.FirstConstant, &block.ConstantCount))
+	{
+		block.Ring = ring;
+		block.Generation = ring->GetGeneration();
+		SetStageConstantBuffer(context, ring->GetContext1().Get(), cb->BindIndex, ring->GetBuffer(), &block.FirstConstant, &block.ConstantCount);
+		return;
+	}
+
+	// Fall back to our own buffer
+	context->UpdateSubresource(
+		cb->ConstantBuffer.Get(), 0, 0,
+		data, 0, 0);
+
+	// If the ring was bound last, swap our buffer back in
+	if (block.Ring)
+	{
+		block.Ring = 0;
+		SetStageConstantBuffer(context, 0, cb->BindIndex, cb->ConstantBuffer.Get(), 0, 0);
+	}
+}
+
+// --------------------------------------------------------
+// Binds a buffer to its register, wherever its data lives
+// --------------------------------------------------------
+void ISimpleShader::BindConstantBuffer(SimpleConstantBuffer* cb, ID3D11DeviceContext* context)
+{
+	SimpleRingBlock& block = GetRingBlock(cb);
+	if (!block.Ring)
+	{
+		SetStageConstantBuffer(context, 0, cb->BindIndex, cb->ConstantBuffer.Get(), 0, 0);
+		return;
+	}
+
+	// A block from another context's ring, an earlier frame or
+	// list, or from before a discard may be gone, so re-upload
+	// the local data in that case
+	ConstantBufferRing* ring = GetRing(context);
+	if (ring == block.Ring && block.Generation == ring->GetGeneration())
+		SetStageConstantBuffer(context, ring->GetContext1().Get(), cb->BindIndex, ring->GetBuffer(), &block.FirstConstant, &block.ConstantCount);
+	else
+		UploadConstantBuffer(cb, context);
+}
+
 // --------------------------------------------------------
 // Sets a variable by name with arbitrary data of the specified size
 //
@@ -417,7 +645,7 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 //
 // Returns true if data is copied, false if variable doesn't exist
 // --------------------------------------------------------
-bool ISimpleShader::SetData(std::string name, const void* data, unsigned int size)
+bool ISimpleShader::SetData(std::string_view name, const void* data, unsigned int size)
 {
 	// Look for the variable and verify
 	SimpleShaderVariable* var = FindVariable(name, -1);
@@ -426,7 +654,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleShader::SetData() - Shader variable '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' not found. Ensure the name is spelled correctly and that it exists in a constant buffer in the shader.\n");
 		}
 		return false;
@@ -439,7 +667,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleShader::SetData() - Shader variable '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' is smaller than the size of the data being set. Ensure the variable is large enough for the specified data.\n");
 		}
 		return false;
@@ -447,7 +675,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 
 	// Set the data in the local data buffer
 	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
+		GetLocalData(&constantBuffers[var->ConstantBufferIndex]) + var->ByteOffset,
 		data,
 		size);
 
@@ -458,7 +686,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 // --------------------------------------------------------
 // Sets INTEGER data
 // --------------------------------------------------------
-bool ISimpleShader::SetInt(std::string name, int data)
+bool ISimpleShader::SetInt(std::string_view name, int data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(int));
 }
@@ -466,7 +694,7 @@ bool ISimpleShader::SetInt(std::string name, int data)
 // --------------------------------------------------------
 // Sets a FLOAT variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat(std::string name, float data)
+bool ISimpleShader::SetFloat(std::string_view name, float data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(float));
 }
@@ -474,7 +702,7 @@ bool ISimpleShader::SetFloat(std::string name, float data)
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const float data[2])
+bool ISimpleShader::SetFloat2(std::string_view name, const float data[2])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 2);
 }
@@ -482,7 +710,7 @@ bool ISimpleShader::SetFloat2(std::string name, const float data[2])
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
+bool ISimpleShader::SetFloat2(std::string_view name, const DirectX::XMFLOAT2 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 2);
 }
@@ -490,7 +718,7 @@ bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const float data[3])
+bool ISimpleShader::SetFloat3(std::string_view name, const float data[3])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 3);
 }
@@ -498,7 +726,7 @@ bool ISimpleShader::SetFloat3(std::string name, const float data[3])
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
+bool ISimpleShader::SetFloat3(std::string_view name, const DirectX::XMFLOAT3 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 3);
 }
@@ -506,7 +734,7 @@ bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const float data[4])
+bool ISimpleShader::SetFloat4(std::string_view name, const float data[4])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 4);
 }
@@ -514,7 +742,7 @@ bool ISimpleShader::SetFloat4(std::string name, const float data[4])
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
+bool ISimpleShader::SetFloat4(std::string_view name, const DirectX::XMFLOAT4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 4);
 }
@@ -522,7 +750,7 @@ bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
+bool ISimpleShader::SetMatrix4x4(std::string_view name, const float data[16])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 16);
 }
@@ -530,16 +758,119 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data)
+bool ISimpleShader::SetMatrix4x4(std::string_view name, const DirectX::XMFLOAT4X4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
 
+// --------------------------------------------------------
+// Resolves a variable name to a handle that can be used
+// with the handle-based Set methods below.  Do this once
+// (at load time) rather than every frame.
+//
+// name - The name of the shader variable
+//
+// Returns an invalid handle if the variable doesn't exist
+// --------------------------------------------------------
+SimpleShaderHandle ISimpleShader::GetVariableHandle(std::string_view name)
+{
+	SimpleShaderHandle handle;
+
+	// Look for the variable
+	SimpleShaderVariable* var = FindVariable(name, -1);
+	if (var == 0)
+	{
+		if (ReportWarnings)
+		{
+			LogWarning("SimpleShader::GetVariableHandle() - Shader variable '");
+			Log(std::string(name));
+			LogWarning("' not found. Ensure the name is spelled correctly and that it exists in a constant buffer in the shader.\n");
+		}
+		return handle;
+	}
+
+	// Copy the location of the variable
+	handle.ConstantBufferIndex = var->ConstantBufferIndex;
+	handle.ByteOffset = var->ByteOffset;
+	handle.Size = var->Size;
+	return handle;
+}
+
+// --------------------------------------------------------
+// Sets a variable through a pre-resolved handle with
+// arbitrary data of the specified size
+//
+// handle - A handle from GetVariableHandle()
+// data - The data to set in the buffer
+// size - The size of the data (this must be less than or equal to the variable's size)
+//
+// Returns true if data is copied, false if the handle is invalid
+// or doesn't fit in this shader's buffer
+// --------------------------------------------------------
+bool ISimpleShader::SetData(const SimpleShaderHandle& handle, const void* data, unsigned int size)
+{
+	// Invalid handles are silently ignored, as the warning
+	// (if any) was already reported when resolving the name
+	if (!handle.IsValid() || handle.ConstantBufferIndex >= constantBufferCount)
+		return false;
+
+	// Ensure we're not trying to copy more data than the variable can hold
+	if (size > handle.Size)
+		return false;
+
+	// Handles aren't tied to a shader, so one from another
+	// shader could point past the end of this one's buffer
+	SimpleConstantBuffer* cb = &constantBuffers[handle.ConstantBufferIndex];
+	if ((unsigned long long)handle.ByteOffset + size > cb->Size)
+		return false;
+
+	// Set the data in the local data buffer
+	memcpy(
+		GetLocalData(cb) + handle.ByteOffset,
+		data,
+		size);
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Handle-based versions of the typed setters
+// --------------------------------------------------------
+bool ISimpleShader::SetInt(const SimpleShaderHandle& handle, int data)
+{
+	return this->SetData(handle, &data, sizeof(int));
+}
+
+bool ISimpleShader::SetFloat(const SimpleShaderHandle& handle, float data)
+{
+	return this->SetData(handle, &data, sizeof(float));
+}
+
+bool ISimpleShader::SetFloat2(const SimpleShaderHandle& handle, const DirectX::XMFLOAT2& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 2);
+}
+
+bool ISimpleShader::SetFloat3(const SimpleShaderHandle& handle, const DirectX::XMFLOAT3& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 3);
+}
+
+bool ISimpleShader::SetFloat4(const SimpleShaderHandle& handle, const DirectX::XMFLOAT4& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 4);
+}
+
+bool ISimpleShader::SetMatrix4x4(const SimpleShaderHandle& handle, const DirectX::XMFLOAT4X4& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 16);
+}
+
 // --------------------------------------------------------
 // Determines if the shader contains the specified
 // variable within one of its constant buffers
 // --------------------------------------------------------
-bool ISimpleShader::HasVariable(std::string name)
+bool ISimpleShader::HasVariable(std::string_view name)
 {
 	return FindVariable(name, -1) != 0;
 }
@@ -547,7 +878,7 @@ bool ISimpleShader::HasVariable(std::string name)
 // --------------------------------------------------------
 // Determines if the shader contains the specified SRV
 // --------------------------------------------------------
-bool ISimpleShader::HasShaderResourceView(std::string name)
+bool ISimpleShader::HasShaderResourceView(std::string_view name)
 {
 	return GetShaderResourceViewInfo(name) != 0;
 }
@@ -555,7 +886,7 @@ bool ISimpleShader::HasShaderResourceView(std::string name)
 // --------------------------------------------------------
 // Determines if the shader contains the specified sampler
 // --------------------------------------------------------
-bool ISimpleShader::HasSamplerState(std::string name)
+bool ISimpleShader::HasSamplerState(std::string_view name)
 {
 	return GetSamplerInfo(name) != 0;
 }
@@ -563,7 +894,7 @@ bool ISimpleShader::HasSamplerState(std::string name)
 // --------------------------------------------------------
 // Gets info about a shader variable, if it exists
 // --------------------------------------------------------
-const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
+const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string_view name)
 {
 	return FindVariable(name, -1);
 }
@@ -573,11 +904,10 @@ const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
 //
 // name - the name of the SRV
 // --------------------------------------------------------
-const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string name)
+const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string_view name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleSRV*>::iterator result =
-		textureTable.find(name);
+	auto result = textureTable.find(name);
 
 	// Did we find the key?
 	if (result == textureTable.end())
@@ -599,7 +929,7 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 	if (index >= shaderResourceViews.size()) return 0;
 
 	// Grab the bind index
-	return shaderResourceViews[index];
+	return &shaderResourceViews[index];
 }
 
 
@@ -608,11 +938,10 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 // 
 // name - the name of the sampler
 // --------------------------------------------------------
-const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string name)
+const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string_view name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleSampler*>::iterator result =
-		samplerTable.find(name);
+	auto result = samplerTable.find(name);
 
 	// Did we find the key?
 	if (result == samplerTable.end())
@@ -633,7 +962,7 @@ const SimpleSampler* ISimpleShader::GetSamplerInfo(unsigned int index)
 	if (index >= samplerStates.size()) return 0;
 
 	// Grab the bind index
-	return samplerStates[index];
+	return &samplerStates[index];
 }
 
 
@@ -661,7 +990,7 @@ unsigned int ISimpleShader::GetBufferSize(unsigned int index)
 // Gets info about a particular constant buffer 
 // by name, if it exists
 // --------------------------------------------------------
-const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(std::string name)
+const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(std::string_view name)
 {
 	return FindConstantBuffer(name);
 }
@@ -767,29 +1096,14 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 		return true;
 
 	// Vertex shader was created successfully, so we now use the
-	// shader code to re-reflect and create an input layout that 
+	// reflected input signature to create an input layout that 
 	// matches what the vertex shader expects.  Code adapted from:
 	// https://takinginitiative.wordpress.com/2011/12/11/directx-1011-basic-shader-reflection-automatic-input-layout-creation/
 
-	// Reflect shader info
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-	
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
 	// Read input layout description from shader info
 	std::vector<D3D11_INPUT_ELEMENT_DESC> inputLayoutDesc;
-	for (unsigned int i = 0; i< shaderDesc.InputParameters; i++)
+	for (auto& paramDesc : reflection.InputElements)
 	{
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetInputParameterDesc(i, &paramDesc);
-
 		// Check the semantic name for "_PER_INSTANCE"
 		std::string perInstanceStr = "_PER_INSTANCE";
 		std::string sem = paramDesc.SemanticName;
@@ -800,7 +1114,7 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 
 		// Fill out input element desc
 		D3D11_INPUT_ELEMENT_DESC elementDesc = {};
-		elementDesc.SemanticName = paramDesc.SemanticName;
+		elementDesc.SemanticName = paramDesc.SemanticName.c_str();
 		elementDesc.SemanticIndex = paramDesc.SemanticIndex;
 		elementDesc.InputSlot = 0;
 		elementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
@@ -863,14 +1177,14 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 // Sets the vertex shader, input layout and constant buffers
 // for future  Direct3D drawing
 // --------------------------------------------------------
-void SimpleVertexShader::SetShaderAndCBs()
+void SimpleVertexShader::SetShaderAndCBs(ID3D11DeviceContext* context)
 {
 	// Is shader valid?
 	if (!shaderValid) return;
 
 	// Set the shader and input layout
-	deviceContext->IASetInputLayout(inputLayout.Get());
-	deviceContext->VSSetShader(shader.Get(), 0, 0);
+	context->IASetInputLayout(inputLayout.Get());
+	context->VSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -880,22 +1194,32 @@ void SimpleVertexShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->VSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(&constantBuffers[i], context);
 	}
 }
 
+// --------------------------------------------------------
+// Binds a single constant buffer to the vertex shader stage,
+// optionally at an offset (in constants) for 11.1 devices
+// --------------------------------------------------------
+void SimpleVertexShader::SetStageConstantBuffer(ID3D11DeviceContext* context, ID3D11DeviceContext1* context1, unsigned int slot, ID3D11Buffer* buffer, const UINT* firstConstant, const UINT* constantCount)
+{
+	if (firstConstant && context1)
+		context1->VSSetConstantBuffers1(slot, 1, &buffer, firstConstant, constantCount);
+	else
+		context->VSSetConstantBuffers(slot, 1, &buffer);
+}
+
 // --------------------------------------------------------
 // Sets a shader resource view in the vertex shader stage
 //
 // name - The name of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
+// context - Where to bind it (null for the shader's own context)
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleVertexShader::SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, ID3D11DeviceContext* context)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -904,14 +1228,14 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleVertexShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	ResolveContext(context)->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -922,10 +1246,11 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 //
 // name - The name of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
+// context - Where to bind it (null for the shader's own context)
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleVertexShader::SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, ID3D11DeviceContext* context)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -934,14 +1259,14 @@ bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleVertexShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	ResolveContext(context)->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1006,13 +1331,13 @@ bool SimplePixelShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob
 // Sets the pixel shader and constant buffers for
 // future  Direct3D drawing
 // --------------------------------------------------------
-void SimplePixelShader::SetShaderAndCBs()
+void SimplePixelShader::SetShaderAndCBs(ID3D11DeviceContext* context)
 {
 	// Is shader valid?
 	if (!shaderValid) return;
 	
 	// Set the shader
-	deviceContext->PSSetShader(shader.Get(), 0, 0);
+	context->PSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1022,22 +1347,32 @@ void SimplePixelShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->PSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(&constantBuffers[i], context);
 	}
 }
 
+// --------------------------------------------------------
+// Binds a single constant buffer to the pixel shader stage,
+// optionally at an offset (in constants) for 11.1 devices
+// --------------------------------------------------------
+void SimplePixelShader::SetStageConstantBuffer(ID3D11DeviceContext* context, ID3D11DeviceContext1* context1, unsigned int slot, ID3D11Buffer* buffer, const UINT* firstConstant, const UINT* constantCount)
+{
+	if (firstConstant && context1)
+		context1->PSSetConstantBuffers1(slot, 1, &buffer, firstConstant, constantCount);
+	else
+		context->PSSetConstantBuffers(slot, 1, &buffer);
+}
+
 // --------------------------------------------------------
 // Sets a shader resource view in the pixel shader stage
 //
 // name - The name of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
+// context - Where to bind it (null for the shader's own context)
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimplePixelShader::SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, ID3D11DeviceContext* context)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1046,14 +1381,14 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::
 		if (ReportWarnings)
 		{
 			LogWarning("SimplePixelShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	ResolveContext(context)->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -1064,10 +1399,11 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::
 //
 // name - The name of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
+// context - Where to bind it (null for the shader's own context)
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimplePixelShader::SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, ID3D11DeviceContext* context)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1076,14 +1412,14 @@ bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr
 		if (ReportWarnings)
 		{
 			LogWarning("SimplePixelShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	ResolveContext(context)->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1150,13 +1486,13 @@ bool SimpleDomainShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 // Sets the domain shader and constant buffers for
 // future  Direct3D drawing
 // --------------------------------------------------------
-void SimpleDomainShader::SetShaderAndCBs()
+void SimpleDomainShader::SetShaderAndCBs(ID3D11DeviceContext* context)
 {
 	// Is shader valid?
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->DSSetShader(shader.Get(), 0, 0);
+	context->DSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1166,22 +1502,32 @@ void SimpleDomainShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->DSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(&constantBuffers[i], context);
 	}
 }
 
+// --------------------------------------------------------
+// Binds a single constant buffer to the domain shader stage,
+// optionally at an offset (in constants) for 11.1 devices
+// --------------------------------------------------------
+void SimpleDomainShader::SetStageConstantBuffer(ID3D11DeviceContext* context, ID3D11DeviceContext1* context1, unsigned int slot, ID3D11Buffer* buffer, const UINT* firstConstant, const UINT* constantCount)
+{
+	if (firstConstant && context1)
+		context1->DSSetConstantBuffers1(slot, 1, &buffer, firstConstant, constantCount);
+	else
+		context->DSSetConstantBuffers(slot, 1, &buffer);
+}
+
 // --------------------------------------------------------
 // Sets a shader resource view in the domain shader stage
 //
 // name - The name of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
+// context - Where to bind it (null for the shader's own context)
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleDomainShader::SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, ID3D11DeviceContext* context)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1190,14 +1536,14 @@ bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleDomainShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->DSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	ResolveContext(context)->DSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -1208,10 +1554,11 @@ bool SimpleDomainShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 //
 // name - The name of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
+// context - Where to bind it (null for the shader's own context)
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleDomainShader::SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, ID3D11DeviceContext* context)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1220,14 +1567,14 @@ bool SimpleDomainShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleDomainShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->DSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	ResolveContext(context)->DSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1293,13 +1640,13 @@ bool SimpleHullShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob)
 // Sets the hull shader and constant buffers for
 // future  Direct3D drawing
 // --------------------------------------------------------
-void SimpleHullShader::SetShaderAndCBs()
+void SimpleHullShader::SetShaderAndCBs(ID3D11DeviceContext* context)
 {
 	// Is shader valid?
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->HSSetShader(shader.Get(), 0, 0);
+	context->HSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1309,22 +1656,32 @@ void SimpleHullShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->HSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(&constantBuffers[i], context);
 	}
 }
 
+// --------------------------------------------------------
+// Binds a single constant buffer to the hull shader stage,
+// optionally at an offset (in constants) for 11.1 devices
+// --------------------------------------------------------
+void SimpleHullShader::SetStageConstantBuffer(ID3D11DeviceContext* context, ID3D11DeviceContext1* context1, unsigned int slot, ID3D11Buffer* buffer, const UINT* firstConstant, const UINT* constantCount)
+{
+	if (firstConstant && context1)
+		context1->HSSetConstantBuffers1(slot, 1, &buffer, firstConstant, constantCount);
+	else
+		context->HSSetConstantBuffers(slot, 1, &buffer);
+}
+
 // --------------------------------------------------------
 // Sets a shader resource view in the hull shader stage
 //
 // name - The name of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
+// context - Where to bind it (null for the shader's own context)
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleHullShader::SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, ID3D11DeviceContext* context)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1333,14 +1690,14 @@ bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::C
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleHullShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->HSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	ResolveContext(context)->HSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -1351,10 +1708,11 @@ bool SimpleHullShader::SetShaderResourceView(std::string name, Microsoft::WRL::C
 //
 // name - The name of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
+// context - Where to bind it (null for the shader's own context)
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleHullShader::SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, ID3D11DeviceContext* context)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1363,14 +1721,14 @@ bool SimpleHullShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleHullShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->HSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	ResolveContext(context)->HSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1455,32 +1813,16 @@ bool SimpleGeometryShader::CreateShaderWithStreamOut(Microsoft::WRL::ComPtr<ID3D
 	// called more than once on the same object
 	this->CleanUp();
 
-	// Reflect shader info
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
 	// Set up the output signature
 	streamOutVertexSize = 0;
 	std::vector<D3D11_SO_DECLARATION_ENTRY> soDecl;
-	for (unsigned int i = 0; i < shaderDesc.OutputParameters; i++)
+	for (auto& paramDesc : reflection.OutputElements)
 	{
-		// Get the info about this entry
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetOutputParameterDesc(i, &paramDesc);
-		
 		// Create the SO Declaration
 		D3D11_SO_DECLARATION_ENTRY entry = {};
 		entry.SemanticIndex  = paramDesc.SemanticIndex;
-		entry.SemanticName   = paramDesc.SemanticName;
-		entry.Stream         = paramDesc.Stream;
+		entry.SemanticName   = paramDesc.SemanticName.c_str();
+		entry.Stream         = (BYTE)paramDesc.Stream;
 		entry.StartComponent = 0; // Assume starting at 0
 		entry.OutputSlot     = 0; // Assume the first output slot
 
@@ -1567,13 +1909,13 @@ void SimpleGeometryShader::UnbindStreamOutStage(Microsoft::WRL::ComPtr<ID3D11Dev
 // Sets the geometry shader and constant buffers for
 // future  Direct3D drawing
 // --------------------------------------------------------
-void SimpleGeometryShader::SetShaderAndCBs()
+void SimpleGeometryShader::SetShaderAndCBs(ID3D11DeviceContext* context)
 {
 	// Is shader valid?
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->GSSetShader(shader.Get(), 0, 0);
+	context->GSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1583,22 +1925,32 @@ void SimpleGeometryShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->GSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(&constantBuffers[i], context);
 	}
 }
 
+// --------------------------------------------------------
+// Binds a single constant buffer to the geometry shader stage,
+// optionally at an offset (in constants) for 11.1 devices
+// --------------------------------------------------------
+void SimpleGeometryShader::SetStageConstantBuffer(ID3D11DeviceContext* context, ID3D11DeviceContext1* context1, unsigned int slot, ID3D11Buffer* buffer, const UINT* firstConstant, const UINT* constantCount)
+{
+	if (firstConstant && context1)
+		context1->GSSetConstantBuffers1(slot, 1, &buffer, firstConstant, constantCount);
+	else
+		context->GSSetConstantBuffers(slot, 1, &buffer);
+}
+
 // --------------------------------------------------------
 // Sets a shader resource view in the Geometry shader stage
 //
 // name - The name of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
+// context - Where to bind it (null for the shader's own context)
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleGeometryShader::SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, ID3D11DeviceContext* context)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1607,14 +1959,14 @@ bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WR
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleGeometryShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->GSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	ResolveContext(context)->GSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -1625,10 +1977,11 @@ bool SimpleGeometryShader::SetShaderResourceView(std::string name, Microsoft::WR
 //
 // name - The name of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
+// context - Where to bind it (null for the shader's own context)
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleGeometryShader::SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, ID3D11DeviceContext* context)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1637,14 +1990,14 @@ bool SimpleGeometryShader::SetSamplerState(std::string name, Microsoft::WRL::Com
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleGeometryShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->GSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	ResolveContext(context)->GSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1730,44 +2083,15 @@ bool SimpleComputeShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBl
 	if (result != S_OK)
 		return false;
 
-	// Set up shader reflection to get information about UAV's
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-
-	// Get the description of the shader
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-	
 	// Grab the thread info
-	threadsTotal = refl->GetThreadGroupSize(
-		&threadsX,
-		&threadsY,
-		&threadsZ);
-
-	// Loop and get all UAV resources
-	unsigned int resourceCount = shaderDesc.BoundResources;
-	for (unsigned int r = 0; r < resourceCount; r++)
-	{
-		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
+	threadsX = reflection.ThreadsX;
+	threadsY = reflection.ThreadsY;
+	threadsZ = reflection.ThreadsZ;
+	threadsTotal = threadsX * threadsY * threadsZ;
 
-		// Check the type, looking for any kind of UAV
-		switch (resourceDesc.Type)
-		{
-		case D3D_SIT_UAV_APPEND_STRUCTURED:
-		case D3D_SIT_UAV_CONSUME_STRUCTURED:
-		case D3D_SIT_UAV_RWBYTEADDRESS:
-		case D3D_SIT_UAV_RWSTRUCTURED:
-		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
-		case D3D_SIT_UAV_RWTYPED:
-			uavTable.insert(std::pair<std::string, unsigned int>(resourceDesc.Name, resourceDesc.BindPoint));
-		}
-	}
+	// Add all UAV resources
+	for (auto& uav : reflection.UnorderedAccessViews)
+		uavTable.insert(std::pair<std::string, unsigned int>(uav.Name, uav.BindIndex));
 
 	// All set
 	return true;
@@ -1777,13 +2101,13 @@ bool SimpleComputeShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBl
 // Sets the Compute shader and constant buffers for
 // future  Direct3D drawing
 // --------------------------------------------------------
-void SimpleComputeShader::SetShaderAndCBs()
+void SimpleComputeShader::SetShaderAndCBs(ID3D11DeviceContext* context)
 {
 	// Is shader valid?
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->CSSetShader(shader.Get(), 0, 0);
+	context->CSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1793,13 +2117,22 @@ void SimpleComputeShader::SetShaderAndCBs()
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->CSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(&constantBuffers[i], context);
 	}
 }
 
+// --------------------------------------------------------
+// Binds a single constant buffer to the compute shader stage,
+// optionally at an offset (in constants) for 11.1 devices
+// --------------------------------------------------------
+void SimpleComputeShader::SetStageConstantBuffer(ID3D11DeviceContext* context, ID3D11DeviceContext1* context1, unsigned int slot, ID3D11Buffer* buffer, const UINT* firstConstant, const UINT* constantCount)
+{
+	if (firstConstant && context1)
+		context1->CSSetConstantBuffers1(slot, 1, &buffer, firstConstant, constantCount);
+	else
+		context->CSSetConstantBuffers(slot, 1, &buffer);
+}
+
 // --------------------------------------------------------
 // Dispatches the compute shader with the specified amount 
 // of groups, using the number of threads per group
@@ -1856,7 +2189,7 @@ void SimpleComputeShader::DispatchByThreads(unsigned int threadsX, unsigned int
 // --------------------------------------------------------
 // Determines if this shader has the specified UAV
 // --------------------------------------------------------
-bool SimpleComputeShader::HasUnorderedAccessView(std::string name)
+bool SimpleComputeShader::HasUnorderedAccessView(std::string_view name)
 {
 	return GetUnorderedAccessViewIndex(name) != -1;
 }
@@ -1866,10 +2199,11 @@ bool SimpleComputeShader::HasUnorderedAccessView(std::string name)
 //
 // name - The name of the texture resource in the shader
 // srv - The shader resource view of the texture in GPU memory
+// context - Where to bind it (null for the shader's own context)
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+bool SimpleComputeShader::SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, ID3D11DeviceContext* context)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1878,14 +2212,14 @@ bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleComputeShader::SetShaderResourceView() - SRV named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->CSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	ResolveContext(context)->CSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -1896,10 +2230,11 @@ bool SimpleComputeShader::SetShaderResourceView(std::string name, Microsoft::WRL
 //
 // name - The name of the sampler state in the shader
 // samplerState - The sampler state in GPU memory
+// context - Where to bind it (null for the shader's own context)
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState)
+bool SimpleComputeShader::SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, ID3D11DeviceContext* context)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1908,14 +2243,14 @@ bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComP
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleComputeShader::SetSamplerState() - Sampler named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
 	}
 
 	// Set the shader resource view
-	deviceContext->CSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	ResolveContext(context)->CSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1930,7 +2265,7 @@ bool SimpleComputeShader::SetSamplerState(std::string name, Microsoft::WRL::ComP
 //
 // Returns true if a UAV of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetUnorderedAccessView(std::string name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset)
+bool SimpleComputeShader::SetUnorderedAccessView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset)
 {
 	// Look for the variable and verify
 	unsigned int bindIndex = GetUnorderedAccessViewIndex(name);
@@ -1939,7 +2274,7 @@ bool SimpleComputeShader::SetUnorderedAccessView(std::string name, Microsoft::WR
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleComputeShader::SetUnorderedAccessView() - UAV named '");
-			Log(name);
+			Log(std::string(name));
 			LogWarning("' was not found in the shader. Ensure the name is spelled correctly and that it exists in the shader.\n");
 		}
 		return false;
@@ -1955,11 +2290,10 @@ bool SimpleComputeShader::SetUnorderedAccessView(std::string name, Microsoft::WR
 // --------------------------------------------------------
 // Gets the index of the specified UAV (or -1)
 // --------------------------------------------------------
-int SimpleComputeShader::GetUnorderedAccessViewIndex(std::string name)
+int SimpleComputeShader::GetUnorderedAccessViewIndex(std::string_view name)
 {
 	// Look for the key
-	std::unordered_map<std::string, unsigned int>::iterator result =
-		uavTable.find(name);
+	auto result = uavTable.find(name);
 
 	// Did we find the key?
 	if (result == uavTable.end())
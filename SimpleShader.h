@@ -3,14 +3,19 @@
 #pragma comment(lib, "d3dcompiler.lib")
 
 #include <d3d11.h>
+#include <d3d11_1.h>
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
 #include <wrl/client.h>
 
 #include <unordered_map>
+#include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
 
+#include "ConstantBufferRing.h"
+#include "ShaderReflectionCache.h"
 
 // --------------------------------------------------------
 // Used by simple shaders to store information about
@@ -23,6 +28,46 @@ struct SimpleShaderVariable
 	unsigned int ConstantBufferIndex;
 };
 
+// --------------------------------------------------------
+// A pre-resolved location of a shader variable, used to
+// set data without looking the variable up by name.
+// Resolve once with GetVariableHandle() and reuse it for
+// every draw - it remains valid for the life of the shader
+// --------------------------------------------------------
+struct SimpleShaderHandle
+{
+	unsigned int ConstantBufferIndex = (unsigned int)-1;
+	unsigned int ByteOffset = 0;
+	unsigned int Size = 0;
+
+	bool IsValid() const { return ConstantBufferIndex != (unsigned int)-1; }
+};
+
+// --------------------------------------------------------
+// Transparent hash for the name tables, so lookups can be
+// done with a string_view without building a std::string
+// --------------------------------------------------------
+struct SimpleStringHash
+{
+	using is_transparent = void;
+	size_t operator()(std::string_view str) const { return std::hash<std::string_view>{}(str); }
+};
+
+template <typename T>
+using SimpleNameTable = std::unordered_map<std::string, T, SimpleStringHash, std::equal_to<>>;
+
+// --------------------------------------------------------
+// Where a thread slot's copy of a constant buffer was last
+// placed, if it went through a ConstantBufferRing
+// --------------------------------------------------------
+struct SimpleRingBlock
+{
+	ConstantBufferRing* Ring = 0;
+	unsigned long long Generation = 0;
+	unsigned int FirstConstant = 0;
+	unsigned int ConstantCount = 0;
+};
+
 // --------------------------------------------------------
 // Contains information about a specific
 // constant buffer in a shader, as well as
@@ -35,8 +80,11 @@ struct SimpleConstantBuffer
 	unsigned int Size = 0;
 	unsigned int BindIndex = 0;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer = 0;
-	unsigned char* LocalDataBuffer = 0;
+	unsigned char* LocalDataBuffer = 0;	// One copy per thread slot
+	unsigned int SlotCount = 0;			// Copies in LocalDataBuffer
 	std::vector<SimpleShaderVariable> Variables;
+
+	SimpleRingBlock* RingBlocks = 0;	// One per thread slot
 };
 
 // --------------------------------------------------------
@@ -69,50 +117,79 @@ public:
 	// Simple helpers
 	bool IsShaderValid() { return shaderValid; }
 
-	// Activating the shader and copying data
-	void SetShader();
-	void CopyAllBufferData();
-	void CopyBufferData(unsigned int index);
-	void CopyBufferData(std::string bufferName);
+	// Activating the shader and copying data.  These (and the
+	// resource setters) go through the shader's own context
+	// unless another one, like a deferred context, is given.
+	void SetShader(ID3D11DeviceContext* context = 0);
+	void CopyAllBufferData(ID3D11DeviceContext* context = 0);
+	void CopyBufferData(unsigned int index, ID3D11DeviceContext* context = 0);
+	void CopyBufferData(std::string_view bufferName, ID3D11DeviceContext* context = 0);
+
+	// Which copy of the variables the calling thread sets & uploads.
+	// Threads recording at the same time need different slots;
+	// the main thread uses slot 0.
+	static void SetThreadSlot(unsigned int slot);
+	static unsigned int GetThreadSlot();
+
+	// How many slots shaders have - one per thread that records
+	// (like a job system's thread count).  Set it before loading
+	// shaders, as each keeps the count it was made with; slots
+	// past that use slot 0.  Just the main thread's by default.
+	static void SetThreadSlotCount(unsigned int count);
+	static unsigned int GetThreadSlotCount();
+
+	// Optional shared ring for uploading constant data (requires D3D 11.1)
+	void SetConstantBufferRing(std::shared_ptr<ConstantBufferRing> ring);
 
 	// Sets arbitrary shader data
-	bool SetData(std::string name, const void* data, unsigned int size);
-
-	bool SetInt(std::string name, int data);
-	bool SetFloat(std::string name, float data);
-	bool SetFloat2(std::string name, const float data[2]);
-	bool SetFloat2(std::string name, const DirectX::XMFLOAT2 data);
-	bool SetFloat3(std::string name, const float data[3]);
-	bool SetFloat3(std::string name, const DirectX::XMFLOAT3 data);
-	bool SetFloat4(std::string name, const float data[4]);
-	bool SetFloat4(std::string name, const DirectX::XMFLOAT4 data);
-	bool SetMatrix4x4(std::string name, const float data[16]);
-	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
+	bool SetData(std::string_view name, const void* data, unsigned int size);
+
+	bool SetInt(std::string_view name, int data);
+	bool SetFloat(std::string_view name, float data);
+	bool SetFloat2(std::string_view name, const float data[2]);
+	bool SetFloat2(std::string_view name, const DirectX::XMFLOAT2 data);
+	bool SetFloat3(std::string_view name, const float data[3]);
+	bool SetFloat3(std::string_view name, const DirectX::XMFLOAT3 data);
+	bool SetFloat4(std::string_view name, const float data[4]);
+	bool SetFloat4(std::string_view name, const DirectX::XMFLOAT4 data);
+	bool SetMatrix4x4(std::string_view name, const float data[16]);
+	bool SetMatrix4x4(std::string_view name, const DirectX::XMFLOAT4X4 data);
+
+	// Sets shader data through a pre-resolved handle (no name lookup)
+	SimpleShaderHandle GetVariableHandle(std::string_view name);
+	bool SetData(const SimpleShaderHandle& handle, const void* data, unsigned int size);
+
+	bool SetInt(const SimpleShaderHandle& handle, int data);
+	bool SetFloat(const SimpleShaderHandle& handle, float data);
+	bool SetFloat2(const SimpleShaderHandle& handle, const DirectX::XMFLOAT2& data);
+	bool SetFloat3(const SimpleShaderHandle& handle, const DirectX::XMFLOAT3& data);
+	bool SetFloat4(const SimpleShaderHandle& handle, const DirectX::XMFLOAT4& data);
+	bool SetMatrix4x4(const SimpleShaderHandle& handle, const DirectX::XMFLOAT4X4& data);
 
 	// Setting shader resources
-	virtual bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) = 0;
-	virtual bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) = 0;
+	virtual bool SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, ID3D11DeviceContext* context = 0) = 0;
+	virtual bool SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, ID3D11DeviceContext* context = 0) = 0;
 
 	// Simple resource checking
-	bool HasVariable(std::string name);
-	bool HasShaderResourceView(std::string name);
-	bool HasSamplerState(std::string name);
+	bool HasVariable(std::string_view name);
+	bool HasShaderResourceView(std::string_view name);
+	bool HasSamplerState(std::string_view name);
 
 	// Getting data about variables and resources
-	const SimpleShaderVariable* GetVariableInfo(std::string name);
+	const SimpleShaderVariable* GetVariableInfo(std::string_view name);
 	
-	const SimpleSRV* GetShaderResourceViewInfo(std::string name);
+	const SimpleSRV* GetShaderResourceViewInfo(std::string_view name);
 	const SimpleSRV* GetShaderResourceViewInfo(unsigned int index);
 	size_t GetShaderResourceViewCount() { return textureTable.size(); }
 	
-	const SimpleSampler* GetSamplerInfo(std::string name);
+	const SimpleSampler* GetSamplerInfo(std::string_view name);
 	const SimpleSampler* GetSamplerInfo(unsigned int index);
 	size_t GetSamplerCount() { return samplerTable.size(); }
 
 	// Get data about constant buffers
 	unsigned int GetBufferCount();
 	unsigned int GetBufferSize(unsigned int index);
-	const SimpleConstantBuffer* GetBufferInfo(std::string name);
+	const SimpleConstantBuffer* GetBufferInfo(std::string_view name);
 	const SimpleConstantBuffer* GetBufferInfo(unsigned int index);
 	
 	// Misc getters
@@ -129,30 +206,51 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
 
+	// Ring for dynamic constant data on the shader's own context
+	std::shared_ptr<ConstantBufferRing> constantBufferRing;
+
 	// Resource counts
 	unsigned int constantBufferCount;
 	
 	// Maps for variables and buffers
 	SimpleConstantBuffer*		constantBuffers; // For index-based lookup
-	std::vector<SimpleSRV*>		shaderResourceViews;
-	std::vector<SimpleSampler*>	samplerStates;
-	std::unordered_map<std::string, SimpleConstantBuffer*> cbTable;
-	std::unordered_map<std::string, SimpleShaderVariable> varTable;
-	std::unordered_map<std::string, SimpleSRV*> textureTable;
-	std::unordered_map<std::string, SimpleSampler*> samplerTable;
-
-	// Initialization method
+	std::vector<SimpleSRV>		shaderResourceViews;
+	std::vector<SimpleSampler>	samplerStates;
+	SimpleNameTable<SimpleConstantBuffer*> cbTable;
+	SimpleNameTable<SimpleShaderVariable> varTable;
+	SimpleNameTable<SimpleSRV*> textureTable;
+	SimpleNameTable<SimpleSampler*> samplerTable;
+
+	// Reflection results, loaded from the cache when possible
+	ShaderReflectionData reflection;
+
+	// Initialization methods
 	bool LoadShaderFile(LPCWSTR shaderFile);
+	bool ReflectShader(uint64_t bytecodeHash);
 
 	// Pure virtual functions for dealing with shader types
 	virtual bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob) = 0;
-	virtual void SetShaderAndCBs() = 0;
+	virtual void SetShaderAndCBs(ID3D11DeviceContext* context) = 0;
+	virtual void SetStageConstantBuffer(ID3D11DeviceContext* context, ID3D11DeviceContext1* context1, unsigned int slot, ID3D11Buffer* buffer, const UINT* firstConstant, const UINT* constantCount) = 0;
 
 	virtual void CleanUp();
 
+	// Constant buffer upload & binding (ring or per-shader buffer)
+	void UploadConstantBuffer(SimpleConstantBuffer* cb, ID3D11DeviceContext* context);
+	void BindConstantBuffer(SimpleConstantBuffer* cb, ID3D11DeviceContext* context);
+	ConstantBufferRing* GetRing(ID3D11DeviceContext* context);
+
+	// The context to use when none is given, and the calling
+	// thread's copy of a buffer's variables
+	ID3D11DeviceContext* ResolveContext(ID3D11DeviceContext* context) { return context ? context : deviceContext.Get(); }
+	unsigned char* GetLocalData(SimpleConstantBuffer* cb) { return cb->LocalDataBuffer + (threadSlot < cb->SlotCount ? threadSlot : 0) * cb->Size; }
+	SimpleRingBlock& GetRingBlock(SimpleConstantBuffer* cb) { return cb->RingBlocks[threadSlot < cb->SlotCount ? threadSlot : 0]; }
+	static thread_local unsigned int threadSlot;
+	static unsigned int threadSlotCount;
+
 	// Helpers for finding data by name
-	SimpleShaderVariable* FindVariable(std::string name, int size);
-	SimpleConstantBuffer* FindConstantBuffer(std::string name);
+	SimpleShaderVariable* FindVariable(std::string_view name, int size);
+	SimpleConstantBuffer* FindConstantBuffer(std::string_view name);
 
 	// Error logging
 	void Log(std::string message, WORD color);
@@ -178,15 +276,16 @@ public:
 	Microsoft::WRL::ComPtr<ID3D11InputLayout> GetInputLayout() { return inputLayout; }
 	bool GetPerInstanceCompatible() { return perInstanceCompatible; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, ID3D11DeviceContext* context = 0);
+	bool SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, ID3D11DeviceContext* context = 0);
 
 protected:
 	bool perInstanceCompatible;
 	 Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
 	 Microsoft::WRL::ComPtr<ID3D11VertexShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
-	void SetShaderAndCBs();
+	void SetShaderAndCBs(ID3D11DeviceContext* context);
+	void SetStageConstantBuffer(ID3D11DeviceContext* context, ID3D11DeviceContext1* context1, unsigned int slot, ID3D11Buffer* buffer, const UINT* firstConstant, const UINT* constantCount);
 	void CleanUp();
 };
 
@@ -201,13 +300,14 @@ public:
 	~SimplePixelShader();
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, ID3D11DeviceContext* context = 0);
+	bool SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, ID3D11DeviceContext* context = 0);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
-	void SetShaderAndCBs();
+	void SetShaderAndCBs(ID3D11DeviceContext* context);
+	void SetStageConstantBuffer(ID3D11DeviceContext* context, ID3D11DeviceContext1* context1, unsigned int slot, ID3D11Buffer* buffer, const UINT* firstConstant, const UINT* constantCount);
 	void CleanUp();
 };
 
@@ -221,13 +321,14 @@ public:
 	~SimpleDomainShader();
 	Microsoft::WRL::ComPtr<ID3D11DomainShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, ID3D11DeviceContext* context = 0);
+	bool SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, ID3D11DeviceContext* context = 0);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11DomainShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
-	void SetShaderAndCBs();
+	void SetShaderAndCBs(ID3D11DeviceContext* context);
+	void SetStageConstantBuffer(ID3D11DeviceContext* context, ID3D11DeviceContext1* context1, unsigned int slot, ID3D11Buffer* buffer, const UINT* firstConstant, const UINT* constantCount);
 	void CleanUp();
 };
 
@@ -241,13 +342,14 @@ public:
 	~SimpleHullShader();
 	Microsoft::WRL::ComPtr<ID3D11HullShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, ID3D11DeviceContext* context = 0);
+	bool SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, ID3D11DeviceContext* context = 0);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11HullShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
-	void SetShaderAndCBs();
+	void SetShaderAndCBs(ID3D11DeviceContext* context);
+	void SetStageConstantBuffer(ID3D11DeviceContext* context, ID3D11DeviceContext1* context1, unsigned int slot, ID3D11Buffer* buffer, const UINT* firstConstant, const UINT* constantCount);
 	void CleanUp();
 };
 
@@ -261,8 +363,8 @@ public:
 	~SimpleGeometryShader();
 	Microsoft::WRL::ComPtr<ID3D11GeometryShader> GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
+	bool SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, ID3D11DeviceContext* context = 0);
+	bool SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, ID3D11DeviceContext* context = 0);
 
 	bool CreateCompatibleStreamOutBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer> buffer, int vertexCount);
 
@@ -279,7 +381,8 @@ protected:
 
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	bool CreateShaderWithStreamOut(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
-	void SetShaderAndCBs();
+	void SetShaderAndCBs(ID3D11DeviceContext* context);
+	void SetStageConstantBuffer(ID3D11DeviceContext* context, ID3D11DeviceContext1* context1, unsigned int slot, ID3D11Buffer* buffer, const UINT* firstConstant, const UINT* constantCount);
 	void CleanUp();
 
 	// Helpers
@@ -300,17 +403,17 @@ public:
 	void DispatchByGroups(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
 	void DispatchByThreads(unsigned int threadsX, unsigned int threadsY, unsigned int threadsZ);
 
-	bool HasUnorderedAccessView(std::string name);
+	bool HasUnorderedAccessView(std::string_view name);
 
-	bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState);
-	bool SetUnorderedAccessView(std::string name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset = -1);
+	bool SetShaderResourceView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, ID3D11DeviceContext* context = 0);
+	bool SetSamplerState(std::string_view name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState, ID3D11DeviceContext* context = 0);
+	bool SetUnorderedAccessView(std::string_view name, Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> uav, unsigned int appendConsumeOffset = -1);
 
-	int GetUnorderedAccessViewIndex(std::string name);
+	int GetUnorderedAccessViewIndex(std::string_view name);
 
 protected:
 	Microsoft::WRL::ComPtr<ID3D11ComputeShader> shader;
-	std::unordered_map<std::string, unsigned int> uavTable;
+	SimpleNameTable<unsigned int> uavTable;
 
 	unsigned int threadsX;
 	unsigned int threadsY;
@@ -318,6 +421,7 @@ protected:
 	unsigned int threadsTotal;
 
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
-	void SetShaderAndCBs();
+	void SetShaderAndCBs(ID3D11DeviceContext* context);
+	void SetStageConstantBuffer(ID3D11DeviceContext* context, ID3D11DeviceContext1* context1, unsigned int slot, ID3D11Buffer* buffer, const UINT* firstConstant, const UINT* constantCount);
 	void CleanUp();
 };
\ No newline at end of file
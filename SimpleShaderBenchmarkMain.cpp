@@ -0,0 +1,236 @@
+// --------------------------------------------------------
+// Times the CPU side of setting a draw's shader data - the
+// eight variables DrawEntity sets per entity - two ways:
+//
+//  - names:   SetMatrix4x4("world", ...) and friends, which
+//             hash each name to find the variable (how draws
+//             used to set data)
+//  - handles: the same calls through handles resolved once
+//             up front (how draws set data now)
+//
+// Each is timed on its own and followed by the upload
+// (CopyAllBufferData), which is what a draw really pays.
+// The buffers each way leaves behind are compared, so both
+// must set the same bytes.
+//
+// Needs a Direct3D 11 device (hardware, or WARP if there
+// isn't one) and the compiled game shaders, so it's only
+// built on Windows - by CMakeLists.txt:
+//
+//   SimpleShaderBenchmarkMain --shaders <folder with VertexShader.cso>
+//                             --draws 100000 --runs 10
+// --------------------------------------------------------
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Lights.h"
+#include "SimpleShader.h"
+
+#pragma comment(lib, "d3d11.lib")
+
+using namespace DirectX;
+typedef std::chrono::high_resolution_clock Clock;
+
+// What DrawEntity sets for one entity
+struct DrawData
+{
+	XMFLOAT4X4 World;
+	XMFLOAT4X4 WorldInvTranspose;
+	XMFLOAT4X4 View;
+	XMFLOAT4X4 Projection;
+	XMFLOAT3 ColorTint;
+	float Roughness;
+	XMFLOAT3 CameraPosition;
+	XMFLOAT3 AmbientColor;
+};
+
+// Fills a draw's data from its index, so every draw differs
+static void MakeDraw(unsigned int index, DrawData& draw)
+{
+	float f = (float)index;
+	XMStoreFloat4x4(&draw.World, XMMatrixTranslation(f, f * 0.5f, -f));
+	XMStoreFloat4x4(&draw.WorldInvTranspose, XMMatrixTranslation(-f, 0, f));
+	XMStoreFloat4x4(&draw.View, XMMatrixIdentity());
+	XMStoreFloat4x4(&draw.Projection, XMMatrixIdentity());
+	draw.ColorTint = XMFLOAT3(1.0f, 0.5f, f);
+	draw.Roughness = (float)(index % 100) / 100.0f;
+	draw.CameraPosition = XMFLOAT3(0, 0, -f);
+	draw.AmbientColor = XMFLOAT3(0.1f, 0.1f, 0.25f);
+}
+
+// The draw's variables, resolved once
+struct DrawHandles
+{
+	SimpleShaderHandle World;
+	SimpleShaderHandle WorldInvTranspose;
+	SimpleShaderHandle View;
+	SimpleShaderHandle Projection;
+	SimpleShaderHandle ColorTint;
+	SimpleShaderHandle Roughness;
+	SimpleShaderHandle CameraPosition;
+	SimpleShaderHandle AmbientColor;
+	SimpleShaderHandle Lights;
+};
+
+static void SetByName(SimpleVertexShader& vs, SimplePixelShader& ps, const DrawData& draw, const std::vector<Light>& lights)
+{
+	vs.SetMatrix4x4("world", draw.World);
+	vs.SetMatrix4x4("worldInvTranspose", draw.WorldInvTranspose);
+	vs.SetMatrix4x4("view", draw.View);
+	vs.SetMatrix4x4("projection", draw.Projection);
+	ps.SetFloat3("colorTint", draw.ColorTint);
+	ps.SetFloat("roughness", draw.Roughness);
+	ps.SetFloat3("cameraPosition", draw.CameraPosition);
+	ps.SetFloat3("ambientColor", draw.AmbientColor);
+	ps.SetData("lights", lights.data(), (unsigned int)(sizeof(Light) * lights.size()));
+}
+
+static void SetByHandle(SimpleVertexShader& vs, SimplePixelShader& ps, const DrawHandles& handles, const DrawData& draw, const std::vector<Light>& lights)
+{
+	vs.SetMatrix4x4(handles.World, draw.World);
+	vs.SetMatrix4x4(handles.WorldInvTranspose, draw.WorldInvTranspose);
+	vs.SetMatrix4x4(handles.View, draw.View);
+	vs.SetMatrix4x4(handles.Projection, draw.Projection);
+	ps.SetFloat3(handles.ColorTint, draw.ColorTint);
+	ps.SetFloat(handles.Roughness, draw.Roughness);
+	ps.SetFloat3(handles.CameraPosition, draw.CameraPosition);
+	ps.SetFloat3(handles.AmbientColor, draw.AmbientColor);
+	ps.SetData(handles.Lights, lights.data(), (unsigned int)(sizeof(Light) * lights.size()));
+}
+
+// Both shaders' local data, to compare the ways with
+static std::vector<unsigned char> ReadLocalData(ISimpleShader& shader)
+{
+	std::vector<unsigned char> data;
+	for (unsigned int i = 0; i < shader.GetBufferCount(); i++)
+	{
+		const SimpleConstantBuffer* cb = shader.GetBufferInfo(i);
+		data.insert(data.end(), cb->LocalDataBuffer, cb->LocalDataBuffer + cb->Size);
+	}
+	return data;
+}
+
+// Best nanoseconds per draw over the runs
+template<typename Run>
+static double Time(unsigned int runs, unsigned int draws, const Run& run)
+{
+	double best = 1e30;
+	for (unsigned int r = 0; r < runs; r++)
+	{
+		auto start = Clock::now();
+		run();
+		double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / draws;
+		best = ns < best ? ns : best;
+	}
+	return best;
+}
+
+int main(int argc, char* argv[])
+{
+	std::string shaders = ".";
+	unsigned int drawCount = 100000;
+	unsigned int runs = 10;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string name = argv[i];
+		if (name == "--shaders") shaders = argv[i + 1];
+		else if (name == "--draws") drawCount = (unsigned int)atoi(argv[i + 1]);
+		else if (name == "--runs") runs = (unsigned int)atoi(argv[i + 1]);
+	}
+	if (drawCount == 0 || runs == 0)
+	{
+		printf("Usage: SimpleShaderBenchmarkMain [--shaders folder] [--draws count] [--runs count]\n");
+		return 1;
+	}
+
+	// A device without a window - hardware if there's one
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	HRESULT hr = D3D11CreateDevice(0, D3D_DRIVER_TYPE_HARDWARE, 0, 0, 0, 0, D3D11_SDK_VERSION, device.GetAddressOf(), 0, context.GetAddressOf());
+	if (FAILED(hr))
+		hr = D3D11CreateDevice(0, D3D_DRIVER_TYPE_WARP, 0, 0, 0, 0, D3D11_SDK_VERSION, device.GetAddressOf(), 0, context.GetAddressOf());
+	if (FAILED(hr))
+	{
+		printf("Couldn't create a Direct3D 11 device (0x%08lx)\n", (unsigned long)hr);
+		return 1;
+	}
+
+	std::wstring folder(shaders.begin(), shaders.end());
+	SimpleVertexShader vs(device, context, (folder + L"/VertexShader.cso").c_str());
+	SimplePixelShader ps(device, context, (folder + L"/PixelShader.cso").c_str());
+	if (!vs.IsShaderValid() || !ps.IsShaderValid())
+	{
+		printf("Couldn't load VertexShader.cso and PixelShader.cso from %s\n", shaders.c_str());
+		return 1;
+	}
+
+	DrawHandles handles;
+	handles.World = vs.GetVariableHandle("world");
+	handles.WorldInvTranspose = vs.GetVariableHandle("worldInvTranspose");
+	handles.View = vs.GetVariableHandle("view");
+	handles.Projection = vs.GetVariableHandle("projection");
+	handles.ColorTint = ps.GetVariableHandle("colorTint");
+	handles.Roughness = ps.GetVariableHandle("roughness");
+	handles.CameraPosition = ps.GetVariableHandle("cameraPosition");
+	handles.AmbientColor = ps.GetVariableHandle("ambientColor");
+	handles.Lights = ps.GetVariableHandle("lights");
+
+	// As many lights as the shader has room for
+	std::vector<Light> lights(handles.Lights.Size / sizeof(Light));
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		lights[i] = {};
+		lights[i].Type = LIGHT_TYPE_POINT;
+		lights[i].Range = 10.0f;
+		lights[i].Intensity = 1.0f;
+		lights[i].Position = XMFLOAT3((float)i, 1.0f, 0.0f);
+		lights[i].Color = XMFLOAT3(1, 1, 1);
+	}
+
+	std::vector<DrawData> draws(drawCount);
+	for (unsigned int i = 0; i < drawCount; i++)
+		MakeDraw(i, draws[i]);
+
+	// Just setting
+	double namesNs = Time(runs, drawCount, [&]() {
+		for (const DrawData& draw : draws)
+			SetByName(vs, ps, draw, lights);
+	});
+	std::vector<unsigned char> namesVS = ReadLocalData(vs);
+	std::vector<unsigned char> namesPS = ReadLocalData(ps);
+
+	double handlesNs = Time(runs, drawCount, [&]() {
+		for (const DrawData& draw : draws)
+			SetByHandle(vs, ps, handles, draw, lights);
+	});
+	bool same = namesVS == ReadLocalData(vs) && namesPS == ReadLocalData(ps);
+
+	// Setting and uploading, as a draw does
+	double namesUploadNs = Time(runs, drawCount, [&]() {
+		for (const DrawData& draw : draws)
+		{
+			SetByName(vs, ps, draw, lights);
+			vs.CopyAllBufferData();
+			ps.CopyAllBufferData();
+		}
+	});
+	double handlesUploadNs = Time(runs, drawCount, [&]() {
+		for (const DrawData& draw : draws)
+		{
+			SetByHandle(vs, ps, handles, draw, lights);
+			vs.CopyAllBufferData();
+			ps.CopyAllBufferData();
+		}
+	});
+
+	printf("%u draws, %zu lights, best of %u runs\n\n", drawCount, lights.size(), runs);
+	printf("per draw     set ns  set+upload ns\n");
+	printf("names      %8.1f  %13.1f\n", namesNs, namesUploadNs);
+	printf("handles    %8.1f  %13.1f\n", handlesNs, handlesUploadNs);
+	printf("\nSetting is %.2fx faster through handles; buffers %s\n", namesNs / handlesNs, same ? "match" : "DIFFER");
+	return same ? 0 : 1;
+}
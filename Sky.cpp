@@ -13,45 +13,52 @@ Sky::Sky(
 	const wchar_t* front, 
 	const wchar_t* back, 
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerOptions, 
-	std::shared_ptr<Mesh> mesh, 
+	Mesh* mesh, 
 	std::shared_ptr<SimpleVertexShader> skyVS, 
 	std::shared_ptr<SimplePixelShader> skyPS, 
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, 
-	Microsoft::WRL::ComPtr<ID3D11Device> device)
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	std::shared_ptr<RHIDevice> rhiDevice)
 	:
 	samplerOptions(samplerOptions),
 	skyMesh(mesh),
 	skyVS(skyVS),
 	skyPS(skyPS),
 	context(context),
-	device(device)
+	device(device),
+	rhiDevice(rhiDevice)
 {
-	// Rasterizer to reverse the cull mode
-	D3D11_RASTERIZER_DESC rastDesc = {};
-	rastDesc.CullMode = D3D11_CULL_FRONT; // Draw the inside instead of the outside!
-	rastDesc.FillMode = D3D11_FILL_SOLID;
-	device->CreateRasterizerState(&rastDesc, skyRasterState.GetAddressOf());
-
-	// Depth state so that we ACCEPT pixels with a depth == 1
-	D3D11_DEPTH_STENCIL_DESC depthDesc = {};
-	depthDesc.DepthEnable = true;
-	depthDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
-	device->CreateDepthStencilState(&depthDesc, skyDepthState.GetAddressOf());
+	// Draw the inside instead of the outside, and ACCEPT
+	// pixels with a depth == 1 (without writing depth)
+	RHIPipelineStateDesc stateDesc = {};
+	stateDesc.CullMode = RHI_CULL_FRONT;
+	stateDesc.DepthFunc = RHI_COMPARISON_LESS_EQUAL;
+	stateDesc.DepthWrite = false;
+	rhiDevice->CreatePipelineState(stateDesc, skyState);
+
+	// Resolve the per-frame shader variables
+	skyViewHandle = skyVS->GetVariableHandle("view");
+	skyProjectionHandle = skyVS->GetVariableHandle("projection");
 
 	// Create the cube map 
 	skySRV = CreateCubemap(right, left, up, down, front, back);
 }
 
-void Sky::Draw(std::shared_ptr<Camera> camera)
+Sky::~Sky()
+{
+	rhiDevice->Destroy(skyState);
+}
+
+void Sky::Draw(Camera& camera)
 {
 	// Change the render states
-	context->RSSetState(skyRasterState.Get());
-	context->OMSetDepthStencilState(skyDepthState.Get(), 0);
+	RHIContext* rhiContext = rhiDevice->GetImmediateContext();
+	rhiContext->SetPipelineState(skyState);
 
 	// Prepare the vertex shader
 	skyVS->SetShader();
-	skyVS->SetMatrix4x4("view", camera->GetView());
-	skyVS->SetMatrix4x4("projection", camera->GetProjection());
+	skyVS->SetMatrix4x4(skyViewHandle, camera.GetView());
+	skyVS->SetMatrix4x4(skyProjectionHandle, camera.GetProjection());
 	skyVS->CopyAllBufferData();
 
 	// Prepare the pixel shader
@@ -61,11 +68,10 @@ void Sky::Draw(std::shared_ptr<Camera> camera)
 	skyPS->CopyAllBufferData();
 
 	// Draw the mesh
-	skyMesh->Draw();
+	skyMesh->Draw(rhiContext);
 
-	// Reset the rasterizer state
-	context->RSSetState(0);
-	context->OMSetDepthStencilState(0, 0);
+	// Reset the render states
+	rhiContext->SetPipelineState(RHIPipelineState());
 }
 
 // --------------------------------------------------------
@@ -20,15 +20,17 @@ public:
 		const wchar_t* front,
 		const wchar_t* back,
 		Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerOptions,
-		std::shared_ptr<Mesh> mesh,
+		Mesh* mesh,
 		std::shared_ptr<SimpleVertexShader> skyVS,
 		std::shared_ptr<SimplePixelShader> skyPS,
 		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
-		Microsoft::WRL::ComPtr<ID3D11Device> device
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		std::shared_ptr<RHIDevice> rhiDevice
 	);
+	~Sky();
 
 
-	void Draw(std::shared_ptr<Camera> camera);
+	void Draw(Camera& camera);
 
 private:
 
@@ -43,22 +45,24 @@ private:
 
 	// Resources
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerOptions;
-	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> skyDepthState;
-	Microsoft::WRL::ComPtr<ID3D11RasterizerState> skyRasterState;
+	RHIPipelineState skyState;
 
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> skySRV;
 
-	// Sky mesh
-	std::shared_ptr<Mesh> skyMesh;
+	// Sky mesh (not owned - it has to outlive the sky)
+	Mesh* skyMesh;
 
 	// Shaders
 	std::shared_ptr<SimpleVertexShader> skyVS;
 	std::shared_ptr<SimplePixelShader> skyPS;
+	SimpleShaderHandle skyViewHandle;
+	SimpleShaderHandle skyProjectionHandle;
 
 	// Context
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext>	context;
 
-	// Device
+	// Device (the cube map is still loaded through Direct3D)
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	std::shared_ptr<RHIDevice> rhiDevice;
 };
 
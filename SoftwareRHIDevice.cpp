@@ -0,0 +1,362 @@
+#include "SoftwareRHIDevice.h"
+
+#include <cstring>
+
+// Formats that can be drawn to (raw DXGI_FORMAT values)
+#define SOFTWARE_RHI_FORMAT_R32_TYPELESS		39
+#define SOFTWARE_RHI_FORMAT_D32_FLOAT			40
+#define SOFTWARE_RHI_FORMAT_R32_FLOAT			41
+
+// --------------------------------------------------------
+// Context
+// --------------------------------------------------------
+SoftwareRHIContext::SoftwareRHIContext(SoftwareRHIDevice* device, std::shared_ptr<JobSystem> jobs) :
+	device(device),
+	rasterizer(jobs),
+	colorTexture(0),
+	depthTexture(0),
+	vertexStride(0),
+	vertexOffset(0),
+	indexFormat(RHI_INDEX_UINT32)
+{
+}
+
+SoftwareRHIContext::~SoftwareRHIContext()
+{
+}
+
+void SoftwareRHIContext::SetPipelineState(RHIPipelineState state)
+{
+	RHIPipelineStateDesc defaults;
+	const RHIPipelineStateDesc* desc = device->GetPipelineState(state);
+	if (!desc)
+		desc = &defaults;
+
+	drawState.CullMode = desc->CullMode;
+	drawState.DepthEnable = desc->DepthEnable;
+	drawState.DepthWrite = desc->DepthWrite;
+	drawState.DepthFunc = desc->DepthFunc;
+}
+
+void SoftwareRHIContext::SetViewport(const RHIViewport& viewport)
+{
+	rasterizer.SetViewport(viewport.X, viewport.Y, viewport.Width, viewport.Height, viewport.MinDepth, viewport.MaxDepth);
+}
+
+// --------------------------------------------------------
+// Only the first color target is drawn to
+// --------------------------------------------------------
+void SoftwareRHIContext::SetRenderTargets(const RHIView* colors, uint32_t colorCount, RHIView depth)
+{
+	colorTexture = colorCount > 0 && colors ? device->GetViewTextureId(colors[0], RHI_VIEW_RENDER_TARGET) : 0;
+	depthTexture = device->GetViewTextureId(depth, RHI_VIEW_DEPTH_STENCIL);
+	SoftwareRHIDevice::Texture* color = device->GetTexture(colorTexture);
+	SoftwareRHIDevice::Texture* depthBuffer = device->GetTexture(depthTexture);
+
+	// Both have to be the same size
+	uint32_t width = color ? color->Desc.Width : (depthBuffer ? depthBuffer->Desc.Width : 0);
+	uint32_t height = color ? color->Desc.Height : (depthBuffer ? depthBuffer->Desc.Height : 0);
+	if (depthBuffer && (depthBuffer->Desc.Width != width || depthBuffer->Desc.Height != height))
+	{
+		depthBuffer = 0;
+		depthTexture = 0;
+	}
+
+	rasterizer.SetTarget(
+		color ? (uint32_t*)color->Pixels.data() : 0,
+		depthBuffer ? (float*)depthBuffer->Pixels.data() : 0,
+		width,
+		height);
+}
+
+void SoftwareRHIContext::SetVertexBuffer(RHIBuffer buffer, uint32_t stride, uint32_t offset)
+{
+	vertexBuffer = buffer;
+	vertexStride = stride;
+	vertexOffset = offset;
+}
+
+void SoftwareRHIContext::SetIndexBuffer(RHIBuffer buffer, uint32_t format)
+{
+	indexBuffer = buffer;
+	indexFormat = format;
+}
+
+void SoftwareRHIContext::ClearRenderTarget(RHIView view, const float color[4])
+{
+	SoftwareRHIDevice::Texture* texture = device->GetViewTexture(view, RHI_VIEW_RENDER_TARGET);
+	if (!texture)
+		return;
+
+	// Anything queued was drawn before the clear
+	rasterizer.Flush();
+
+	uint32_t packed = 0;
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		float value = color[c] < 0.0f ? 0.0f : (color[c] > 1.0f ? 1.0f : color[c]);
+		packed |= (uint32_t)(value * 255.0f + 0.5f) << (c * 8);
+	}
+
+	uint32_t* pixels = (uint32_t*)texture->Pixels.data();
+	size_t count = texture->Pixels.size() / 4;
+	for (size_t i = 0; i < count; i++)
+		pixels[i] = packed;
+}
+
+void SoftwareRHIContext::ClearDepthStencil(RHIView view, float depth)
+{
+	SoftwareRHIDevice::Texture* texture = device->GetViewTexture(view, RHI_VIEW_DEPTH_STENCIL);
+	if (!texture)
+		return;
+
+	rasterizer.Flush();
+
+	float* pixels = (float*)texture->Pixels.data();
+	size_t count = texture->Pixels.size() / 4;
+	for (size_t i = 0; i < count; i++)
+		pixels[i] = depth;
+}
+
+// --------------------------------------------------------
+// Vertices are shaded as they're drawn, so queued draws
+// don't see the new contents
+// --------------------------------------------------------
+void SoftwareRHIContext::UpdateBuffer(RHIBuffer buffer, const void* data, uint32_t size)
+{
+	std::vector<uint8_t>* contents = device->GetBuffer(buffer);
+	if (!contents || !data)
+		return;
+
+	memcpy(contents->data(), data, size < contents->size() ? size : contents->size());
+}
+
+void SoftwareRHIContext::Draw(uint32_t vertexCount, uint32_t firstVertex)
+{
+	DrawTriangles(0, vertexCount, firstVertex, 0);
+}
+
+void SoftwareRHIContext::DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex)
+{
+	std::vector<uint8_t>* indices = device->GetBuffer(indexBuffer);
+	if (!indices)
+		return;
+
+	if (indexFormat == RHI_INDEX_UINT16)
+	{
+		uint32_t available = (uint32_t)(indices->size() / sizeof(uint16_t));
+		if (firstIndex > available || indexCount > available - firstIndex)
+			return;
+
+		const uint16_t* narrow = (const uint16_t*)indices->data();
+		wideIndices.assign(narrow + firstIndex, narrow + firstIndex + indexCount);
+		DrawTriangles(wideIndices.data(), indexCount, 0, baseVertex);
+	}
+	else
+	{
+		uint32_t available = (uint32_t)(indices->size() / sizeof(uint32_t));
+		if (firstIndex > available || indexCount > available - firstIndex)
+			return;
+
+		DrawTriangles((const uint32_t*)indices->data(), indexCount, firstIndex, baseVertex);
+	}
+}
+
+void SoftwareRHIContext::DrawTriangles(const uint32_t* indices, uint32_t count, uint32_t first, int32_t baseVertex)
+{
+	std::vector<uint8_t>* vertices = device->GetBuffer(vertexBuffer);
+	if (!vertices || vertexStride == 0 || vertexOffset >= vertices->size())
+		return;
+
+	uint32_t vertexCount = (uint32_t)((vertices->size() - vertexOffset) / vertexStride);
+	rasterizer.Draw(drawState, vertices->data() + vertexOffset, vertexStride, vertexCount, indices, count, first, baseVertex);
+}
+
+void SoftwareRHIContext::SetShaders(
+	SoftwareVertexShader vertexShader,
+	const void* vertexConstants,
+	SoftwarePixelShader pixelShader,
+	const void* pixelConstants,
+	uint32_t pixelConstantsSize,
+	uint32_t varyingCount)
+{
+	drawState.VertexShader = vertexShader;
+	drawState.VertexConstants = vertexConstants;
+	drawState.PixelShader = pixelShader;
+	drawState.PixelConstants = pixelConstants;
+	drawState.PixelConstantsSize = pixelConstantsSize;
+	drawState.VaryingCount = varyingCount;
+}
+
+void SoftwareRHIContext::Flush()
+{
+	rasterizer.Flush();
+}
+
+void SoftwareRHIContext::Unbind(uint64_t texture)
+{
+	rasterizer.Flush();
+	if (texture != colorTexture && texture != depthTexture)
+		return;
+
+	colorTexture = 0;
+	depthTexture = 0;
+	rasterizer.SetTarget(0, 0, 0, 0);
+}
+
+// --------------------------------------------------------
+// Device
+// --------------------------------------------------------
+SoftwareRHIDevice::SoftwareRHIDevice(std::shared_ptr<JobSystem> jobs) :
+	nextId(1),
+	immediate(this, jobs)
+{
+}
+
+SoftwareRHIDevice::~SoftwareRHIDevice()
+{
+}
+
+bool SoftwareRHIDevice::CreateBuffer(const RHIBufferDesc& desc, const void* initialData, RHIBuffer& buffer)
+{
+	buffer = RHIBuffer();
+	if (desc.Size == 0 || (desc.Usage == RHI_USAGE_IMMUTABLE && !initialData))
+		return false;
+
+	std::vector<uint8_t>& contents = buffers[nextId];
+	if (initialData)
+		contents.assign((const uint8_t*)initialData, (const uint8_t*)initialData + desc.Size);
+	else
+		contents.assign(desc.Size, 0);
+
+	buffer.Id = nextId++;
+	return true;
+}
+
+bool SoftwareRHIDevice::CreateTexture(const RHITextureDesc& desc, const void* initialData, uint32_t rowPitch, RHITexture& texture)
+{
+	texture = RHITexture();
+	if (desc.Width == 0 || desc.Height == 0 || desc.MipLevels != 1 || desc.ArraySize != 1)
+		return false;
+	if (desc.Usage == RHI_USAGE_IMMUTABLE && !initialData)
+		return false;
+
+	Texture& created = textures[nextId];
+	created.Desc = desc;
+	created.Pixels.assign((size_t)desc.Width * desc.Height * 4, 0);
+	if (initialData)
+	{
+		uint32_t rowBytes = desc.Width * 4;
+		if (rowPitch == 0)
+			rowPitch = rowBytes;
+		for (uint32_t y = 0; y < desc.Height; y++)
+			memcpy(&created.Pixels[(size_t)y * rowBytes], (const uint8_t*)initialData + (size_t)y * rowPitch, rowBytes);
+	}
+
+	texture.Id = nextId++;
+	return true;
+}
+
+bool SoftwareRHIDevice::CreateView(RHITexture texture, uint32_t type, RHIView& view)
+{
+	view = RHIView();
+	Texture* target = GetTexture(texture.Id);
+	if (!target)
+		return false;
+
+	// Depth views need a 32 bit float format
+	uint32_t format = target->Desc.Format;
+	bool floatFormat =
+		format == SOFTWARE_RHI_FORMAT_R32_TYPELESS ||
+		format == SOFTWARE_RHI_FORMAT_D32_FLOAT ||
+		format == SOFTWARE_RHI_FORMAT_R32_FLOAT;
+	if (type == RHI_VIEW_DEPTH_STENCIL && !floatFormat)
+		return false;
+	if (type == RHI_VIEW_RENDER_TARGET && format == SOFTWARE_RHI_FORMAT_D32_FLOAT)
+		return false;
+
+	views[nextId] = View{ texture.Id, type };
+	view.Id = nextId++;
+	return true;
+}
+
+bool SoftwareRHIDevice::CreatePipelineState(const RHIPipelineStateDesc& desc, RHIPipelineState& state)
+{
+	pipelineStates[nextId] = desc;
+	state.Id = nextId++;
+	return true;
+}
+
+void SoftwareRHIDevice::Destroy(RHIBuffer buffer)
+{
+	buffers.erase(buffer.Id);
+}
+
+// --------------------------------------------------------
+// Views don't keep their texture alive.  Queued draws are
+// drawn first, and the targets are unbound if it's one.
+// --------------------------------------------------------
+void SoftwareRHIDevice::Destroy(RHITexture texture)
+{
+	if (textures.count(texture.Id) == 0)
+		return;
+
+	immediate.Unbind(texture.Id);
+	textures.erase(texture.Id);
+}
+
+void SoftwareRHIDevice::Destroy(RHIView view)
+{
+	views.erase(view.Id);
+}
+
+void SoftwareRHIDevice::Destroy(RHIPipelineState state)
+{
+	pipelineStates.erase(state.Id);
+}
+
+bool SoftwareRHIDevice::ReadTexture(RHITexture texture, std::vector<uint8_t>& pixels)
+{
+	Texture* source = GetTexture(texture.Id);
+	if (!source)
+		return false;
+
+	immediate.Flush();
+	pixels = source->Pixels;
+	return true;
+}
+
+// --------------------------------------------------------
+// Lookups
+// --------------------------------------------------------
+std::vector<uint8_t>* SoftwareRHIDevice::GetBuffer(RHIBuffer buffer)
+{
+	auto it = buffers.find(buffer.Id);
+	return it == buffers.end() ? 0 : &it->second;
+}
+
+SoftwareRHIDevice::Texture* SoftwareRHIDevice::GetTexture(uint64_t id)
+{
+	auto it = textures.find(id);
+	return it == textures.end() ? 0 : &it->second;
+}
+
+SoftwareRHIDevice::Texture* SoftwareRHIDevice::GetViewTexture(RHIView view, uint32_t type)
+{
+	return GetTexture(GetViewTextureId(view, type));
+}
+
+uint64_t SoftwareRHIDevice::GetViewTextureId(RHIView view, uint32_t type)
+{
+	auto it = views.find(view.Id);
+	if (it == views.end() || it->second.Type != type || textures.count(it->second.Texture) == 0)
+		return 0;
+
+	return it->second.Texture;
+}
+
+const RHIPipelineStateDesc* SoftwareRHIDevice::GetPipelineState(RHIPipelineState state)
+{
+	auto it = pipelineStates.find(state.Id);
+	return it == pipelineStates.end() ? 0 : &it->second;
+}
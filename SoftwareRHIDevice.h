@@ -0,0 +1,134 @@
+#pragma once
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "RHI.h"
+#include "SoftwareRasterizer.h"
+
+class SoftwareRHIDevice;
+
+// --------------------------------------------------------
+// Draws with the software rasterizer.  Shaders are C++
+// functions (see SoftwareShaders.h) set with SetShaders(),
+// since the RHI leaves shaders to the caller.
+//
+// Draws are queued, and drawn when the targets change, on a
+// clear, or on Flush().  Blending and wireframe aren't
+// supported - everything is drawn opaque and solid.
+// --------------------------------------------------------
+class SoftwareRHIContext : public RHIContext
+{
+public:
+	SoftwareRHIContext(SoftwareRHIDevice* device, std::shared_ptr<JobSystem> jobs);
+	~SoftwareRHIContext();
+
+	// RHIContext
+	void SetPipelineState(RHIPipelineState state);
+	void SetViewport(const RHIViewport& viewport);
+	void SetRenderTargets(const RHIView* colors, uint32_t colorCount, RHIView depth);
+	void SetVertexBuffer(RHIBuffer buffer, uint32_t stride, uint32_t offset = 0);
+	void SetIndexBuffer(RHIBuffer buffer, uint32_t format);
+	void ClearRenderTarget(RHIView view, const float color[4]);
+	void ClearDepthStencil(RHIView view, float depth);
+	void UpdateBuffer(RHIBuffer buffer, const void* data, uint32_t size);
+	void Draw(uint32_t vertexCount, uint32_t firstVertex = 0);
+	void DrawIndexed(uint32_t indexCount, uint32_t firstIndex = 0, int32_t baseVertex = 0);
+
+	// Shaders for the following draws.  Vertex constants are
+	// read during the draw, pixel constants are copied.
+	void SetShaders(
+		SoftwareVertexShader vertexShader,
+		const void* vertexConstants,
+		SoftwarePixelShader pixelShader,
+		const void* pixelConstants,
+		uint32_t pixelConstantsSize,
+		uint32_t varyingCount);
+
+	// Draws everything queued
+	void Flush();
+
+	SoftwareRasterizer& GetRasterizer() { return rasterizer; }
+
+private:
+	friend class SoftwareRHIDevice;
+
+	void DrawTriangles(const uint32_t* indices, uint32_t count, uint32_t first, int32_t baseVertex);
+
+	// Stops drawing to a texture that's being destroyed
+	void Unbind(uint64_t texture);
+
+	SoftwareRHIDevice* device;
+	SoftwareRasterizer rasterizer;
+	SoftwareDrawState drawState;
+
+	// Bound state
+	uint64_t colorTexture;
+	uint64_t depthTexture;
+	RHIBuffer vertexBuffer;
+	uint32_t vertexStride;
+	uint32_t vertexOffset;
+	RHIBuffer indexBuffer;
+	uint32_t indexFormat;
+
+	// 16 bit indices are widened here
+	std::vector<uint32_t> wideIndices;
+};
+
+// --------------------------------------------------------
+// A device whose resources live in system memory.  Textures
+// must be 4 bytes per pixel with one mip and one slice:
+// render targets are read as RGBA8, depth buffers as float.
+// --------------------------------------------------------
+class SoftwareRHIDevice : public RHIDevice
+{
+public:
+	SoftwareRHIDevice(std::shared_ptr<JobSystem> jobs);
+	~SoftwareRHIDevice();
+
+	// RHIDevice
+	bool CreateBuffer(const RHIBufferDesc& desc, const void* initialData, RHIBuffer& buffer);
+	bool CreateTexture(const RHITextureDesc& desc, const void* initialData, uint32_t rowPitch, RHITexture& texture);
+	bool CreateView(RHITexture texture, uint32_t type, RHIView& view);
+	bool CreatePipelineState(const RHIPipelineStateDesc& desc, RHIPipelineState& state);
+	void Destroy(RHIBuffer buffer);
+	void Destroy(RHITexture texture);
+	void Destroy(RHIView view);
+	void Destroy(RHIPipelineState state);
+	RHIContext* GetImmediateContext() { return &immediate; }
+	SoftwareRHIContext& GetSoftwareContext() { return immediate; }
+
+	// Draws anything queued, then copies the texture's rows out
+	bool ReadTexture(RHITexture texture, std::vector<uint8_t>& pixels);
+
+private:
+	friend class SoftwareRHIContext;
+
+	struct Texture
+	{
+		RHITextureDesc Desc;
+		std::vector<uint8_t> Pixels;
+	};
+
+	struct View
+	{
+		uint64_t Texture;
+		uint32_t Type;
+	};
+
+	// Lookups (null if the handle isn't live)
+	std::vector<uint8_t>* GetBuffer(RHIBuffer buffer);
+	Texture* GetTexture(uint64_t id);
+	Texture* GetViewTexture(RHIView view, uint32_t type);
+	uint64_t GetViewTextureId(RHIView view, uint32_t type);
+	const RHIPipelineStateDesc* GetPipelineState(RHIPipelineState state);
+
+	std::unordered_map<uint64_t, std::vector<uint8_t>> buffers;
+	std::unordered_map<uint64_t, Texture> textures;
+	std::unordered_map<uint64_t, View> views;
+	std::unordered_map<uint64_t, RHIPipelineStateDesc> pipelineStates;
+	uint64_t nextId;
+
+	SoftwareRHIContext immediate;
+};
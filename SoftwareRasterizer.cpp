@@ -0,0 +1,583 @@
+#include "SoftwareRasterizer.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SOFTWARE_RASTER_SSE2 1
+#else
+#define SOFTWARE_RASTER_SSE2 0
+#endif
+
+// How far outside the viewport (in pixels) vertices can be
+// before they're clipped, which keeps edge functions within
+// 64 bits and partially covered tiles within 32
+#define GUARD_BAND_PIXELS	8000.0f
+
+// Vertices per vertex shader job
+#define VERTEX_CHUNK_SIZE	256
+
+#define SUBPIXEL_SCALE		(1 << SOFTWARE_RASTER_SUBPIXEL_BITS)
+#define SUBPIXEL_HALF		(SUBPIXEL_SCALE / 2)
+
+SoftwareRasterizer::SoftwareRasterizer(std::shared_ptr<JobSystem> jobs) :
+	color(0),
+	depth(0),
+	width(0),
+	height(0),
+	tilesX(0),
+	tilesY(0),
+	guardBandX(1.0f),
+	guardBandY(1.0f),
+	drawCount(0),
+	jobs(jobs)
+{
+	memset(viewport, 0, sizeof(viewport));
+	ResetStats();
+
+	threadPixelCounts.assign(jobs->GetThreadCount() + 1, 0);
+}
+
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+}
+
+void SoftwareRasterizer::ResetStats()
+{
+	triangleCount = 0;
+	binnedCount = 0;
+	pixelCount = 0;
+	stolenCount = 0;
+}
+
+bool SoftwareRasterizer::HasSIMD()
+{
+	return SOFTWARE_RASTER_SSE2 != 0;
+}
+
+void SoftwareRasterizer::SetTarget(uint32_t* color, float* depth, uint32_t width, uint32_t height)
+{
+	Flush();
+
+	this->color = color;
+	this->depth = depth;
+	this->width = width;
+	this->height = height;
+	tilesX = (width + SOFTWARE_RASTER_TILE_SIZE - 1) / SOFTWARE_RASTER_TILE_SIZE;
+	tilesY = (height + SOFTWARE_RASTER_TILE_SIZE - 1) / SOFTWARE_RASTER_TILE_SIZE;
+	bins.resize((size_t)tilesX * tilesY);
+}
+
+// --------------------------------------------------------
+// Also works out the guard band: how many viewport widths
+// (in clip space) fit before GUARD_BAND_PIXELS on each side
+// --------------------------------------------------------
+void SoftwareRasterizer::SetViewport(float x, float y, float width, float height, float minDepth, float maxDepth)
+{
+	viewport[0] = x;
+	viewport[1] = y;
+	viewport[2] = width;
+	viewport[3] = height;
+	viewport[4] = minDepth;
+	viewport[5] = maxDepth;
+
+	guardBandX = 1.0f;
+	guardBandY = 1.0f;
+	if (width > 0.0f)
+	{
+		float right = 2.0f * (GUARD_BAND_PIXELS - x) / width - 1.0f;
+		float left = 2.0f * (GUARD_BAND_PIXELS + x) / width + 1.0f;
+		guardBandX = right < left ? right : left;
+	}
+	if (height > 0.0f)
+	{
+		float bottom = 2.0f * (GUARD_BAND_PIXELS - y) / height - 1.0f;
+		float top = 2.0f * (GUARD_BAND_PIXELS + y) / height + 1.0f;
+		guardBandY = bottom < top ? bottom : top;
+	}
+}
+
+void SoftwareRasterizer::Draw(
+	const SoftwareDrawState& state,
+	const uint8_t* vertices,
+	uint32_t stride,
+	uint32_t vertexCount,
+	const uint32_t* indices,
+	uint32_t count,
+	uint32_t first,
+	int32_t baseVertex)
+{
+	if (!state.VertexShader || !state.PixelShader || !vertices || count < 3 || width == 0 || height == 0 || viewport[2] <= 0.0f || viewport[3] <= 0.0f)
+		return;
+
+	uint32_t varyingCount = state.VaryingCount < SOFTWARE_RASTER_MAX_VARYINGS ? state.VaryingCount : SOFTWARE_RASTER_MAX_VARYINGS;
+
+	// Find the vertices this draw uses, so each is shaded once
+	int64_t lowest = INT64_MAX;
+	int64_t highest = -1;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		int64_t v = indices ? (int64_t)indices[first + i] + baseVertex : (int64_t)first + i;
+		if (v < 0 || v >= vertexCount)
+			continue;
+		if (v < lowest) lowest = v;
+		if (v > highest) highest = v;
+	}
+	if (highest < 0)
+		return;
+
+	uint32_t shadedCount = (uint32_t)(highest - lowest + 1);
+	shadedVertices.resize(shadedCount);
+
+	uint32_t chunkCount = (shadedCount + VERTEX_CHUNK_SIZE - 1) / VERTEX_CHUNK_SIZE;
+	ParallelFor(chunkCount, [&](uint32_t chunk, uint32_t thread)
+	{
+		uint32_t start = chunk * VERTEX_CHUNK_SIZE;
+		uint32_t end = start + VERTEX_CHUNK_SIZE < shadedCount ? start + VERTEX_CHUNK_SIZE : shadedCount;
+		for (uint32_t i = start; i < end; i++)
+		{
+			SoftwareVertexOutput& output = shadedVertices[i];
+			memset(&output, 0, sizeof(output));
+			state.VertexShader(state.VertexConstants, vertices + (size_t)(lowest + i) * stride, output);
+		}
+	});
+
+	// Keep what the pixel stage needs until the next Flush()
+	if (drawCount == draws.size())
+		draws.emplace_back();
+	DrawRecord& draw = draws[drawCount];
+	draw.PixelShader = state.PixelShader;
+	draw.Constants.assign((const uint8_t*)state.PixelConstants, (const uint8_t*)state.PixelConstants + (state.PixelConstants ? state.PixelConstantsSize : 0));
+	draw.VaryingCount = varyingCount;
+	draw.DepthEnable = state.DepthEnable;
+	draw.DepthWrite = state.DepthWrite;
+	draw.DepthFunc = state.DepthFunc;
+	draw.MinDepth = viewport[4];
+	draw.MaxDepth = viewport[5];
+	drawCount++;
+
+	for (uint32_t i = 0; i + 3 <= count; i += 3)
+	{
+		const SoftwareVertexOutput* corners[3];
+		bool valid = true;
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			int64_t v = indices ? (int64_t)indices[first + i + c] + baseVertex : (int64_t)first + i + c;
+			valid = valid && v >= lowest && v <= highest;
+			corners[c] = valid ? &shadedVertices[(size_t)(v - lowest)] : 0;
+		}
+
+		if (valid)
+			ClipTriangle(corners, state.CullMode, varyingCount);
+	}
+}
+
+// --------------------------------------------------------
+// Clipping happens against the near plane and the guard
+// band (and w > 0, for safety).  Most triangles are inside
+// all of them and go straight through.
+// --------------------------------------------------------
+#define CLIP_PLANE_COUNT 6
+
+static float ClipDistance(const float* p, uint32_t plane, float guardBandX, float guardBandY)
+{
+	switch (plane)
+	{
+	case 0: return p[2];
+	case 1: return guardBandX * p[3] - p[0];
+	case 2: return guardBandX * p[3] + p[0];
+	case 3: return guardBandY * p[3] - p[1];
+	case 4: return guardBandY * p[3] + p[1];
+	default: return p[3] - 0.00001f;
+	}
+}
+
+void SoftwareRasterizer::ClipTriangle(const SoftwareVertexOutput* vertices[3], uint32_t cullMode, uint32_t varyingCount)
+{
+	uint32_t outside[3] = {};
+	for (uint32_t v = 0; v < 3; v++)
+		for (uint32_t plane = 0; plane < CLIP_PLANE_COUNT; plane++)
+			if (ClipDistance(vertices[v]->Position, plane, guardBandX, guardBandY) < 0.0f)
+				outside[v] |= 1u << plane;
+
+	if ((outside[0] | outside[1] | outside[2]) == 0)
+	{
+		SetupTriangle(vertices, cullMode, varyingCount);
+		return;
+	}
+	if (outside[0] & outside[1] & outside[2])
+		return;
+
+	// Sutherland-Hodgman, one plane at a time (each plane adds
+	// at most one vertex)
+	SoftwareVertexOutput buffers[2][3 + CLIP_PLANE_COUNT];
+	uint32_t counts[2] = { 3, 0 };
+	for (uint32_t v = 0; v < 3; v++)
+		buffers[0][v] = *vertices[v];
+
+	uint32_t current = 0;
+	uint32_t floatCount = 4 + varyingCount;
+	for (uint32_t plane = 0; plane < CLIP_PLANE_COUNT; plane++)
+	{
+		if (((outside[0] | outside[1] | outside[2]) & (1u << plane)) == 0)
+			continue;
+
+		SoftwareVertexOutput* in = buffers[current];
+		SoftwareVertexOutput* out = buffers[current ^ 1];
+		uint32_t inCount = counts[current];
+		uint32_t outCount = 0;
+		for (uint32_t v = 0; v < inCount; v++)
+		{
+			const SoftwareVertexOutput& a = in[v];
+			const SoftwareVertexOutput& b = in[(v + 1) % inCount];
+			float da = ClipDistance(a.Position, plane, guardBandX, guardBandY);
+			float db = ClipDistance(b.Position, plane, guardBandX, guardBandY);
+
+			if (da >= 0.0f)
+				out[outCount++] = a;
+
+			if ((da >= 0.0f) != (db >= 0.0f))
+			{
+				// Position & varyings are contiguous floats
+				float t = da / (da - db);
+				const float* fa = a.Position;
+				const float* fb = b.Position;
+				SoftwareVertexOutput& split = out[outCount++];
+				float* fs = split.Position;
+				for (uint32_t f = 0; f < floatCount; f++)
+					fs[f] = fa[f] + (fb[f] - fa[f]) * t;
+			}
+		}
+
+		counts[current ^ 1] = outCount;
+		current ^= 1;
+		if (outCount < 3)
+			return;
+	}
+
+	// Fan out what's left
+	const SoftwareVertexOutput* polygon = buffers[current];
+	for (uint32_t v = 1; v + 1 < counts[current]; v++)
+	{
+		const SoftwareVertexOutput* corners[3] = { &polygon[0], &polygon[v], &polygon[v + 1] };
+		SetupTriangle(corners, cullMode, varyingCount);
+	}
+}
+
+// --------------------------------------------------------
+// Projects to the viewport, snaps to sub-pixels, culls, and
+// sorts the triangle into the tiles its bounds touch
+// --------------------------------------------------------
+void SoftwareRasterizer::SetupTriangle(const SoftwareVertexOutput* vertices[3], uint32_t cullMode, uint32_t varyingCount)
+{
+	Triangle tri;
+	float screenX[3], screenY[3];
+	for (uint32_t v = 0; v < 3; v++)
+	{
+		const float* p = vertices[v]->Position;
+		float invW = 1.0f / p[3];
+		screenX[v] = (p[0] * invW * 0.5f + 0.5f) * viewport[2] + viewport[0];
+		screenY[v] = (-p[1] * invW * 0.5f + 0.5f) * viewport[3] + viewport[1];
+		tri.X[v] = (int32_t)floorf(screenX[v] * SUBPIXEL_SCALE + 0.5f);
+		tri.Y[v] = (int32_t)floorf(screenY[v] * SUBPIXEL_SCALE + 0.5f);
+		tri.Z[v] = p[2] * invW * (viewport[5] - viewport[4]) + viewport[4];
+		tri.InvW[v] = invW;
+	}
+
+	// Clockwise on screen (y down) is front facing, like Direct3D's default
+	int64_t area =
+		(int64_t)(tri.X[1] - tri.X[0]) * (tri.Y[2] - tri.Y[0]) -
+		(int64_t)(tri.Y[1] - tri.Y[0]) * (tri.X[2] - tri.X[0]);
+	if (area == 0 || (area < 0 && cullMode == RHI_CULL_BACK) || (area > 0 && cullMode == RHI_CULL_FRONT))
+		return;
+
+	// Wind the rest clockwise, so the inside is positive
+	uint32_t order[3] = { 0, 1, 2 };
+	if (area < 0)
+	{
+		order[1] = 2;
+		order[2] = 1;
+		area = -area;
+		Triangle flipped = tri;
+		for (uint32_t v = 0; v < 3; v++)
+		{
+			tri.X[v] = flipped.X[order[v]];
+			tri.Y[v] = flipped.Y[order[v]];
+			tri.Z[v] = flipped.Z[order[v]];
+			tri.InvW[v] = flipped.InvW[order[v]];
+		}
+	}
+
+	// Pixels whose centers the bounds can contain, within the viewport
+	int32_t minX = tri.X[0], maxX = tri.X[0], minY = tri.Y[0], maxY = tri.Y[0];
+	for (uint32_t v = 1; v < 3; v++)
+	{
+		if (tri.X[v] < minX) minX = tri.X[v];
+		if (tri.X[v] > maxX) maxX = tri.X[v];
+		if (tri.Y[v] < minY) minY = tri.Y[v];
+		if (tri.Y[v] > maxY) maxY = tri.Y[v];
+	}
+	tri.MinX = (minX - SUBPIXEL_HALF + SUBPIXEL_SCALE - 1) >> SOFTWARE_RASTER_SUBPIXEL_BITS;
+	tri.MinY = (minY - SUBPIXEL_HALF + SUBPIXEL_SCALE - 1) >> SOFTWARE_RASTER_SUBPIXEL_BITS;
+	tri.MaxX = (maxX - SUBPIXEL_HALF) >> SOFTWARE_RASTER_SUBPIXEL_BITS;
+	tri.MaxY = (maxY - SUBPIXEL_HALF) >> SOFTWARE_RASTER_SUBPIXEL_BITS;
+
+	int32_t scissorMinX = (int32_t)ceilf(viewport[0] - 0.5f);
+	int32_t scissorMinY = (int32_t)ceilf(viewport[1] - 0.5f);
+	int32_t scissorMaxX = (int32_t)ceilf(viewport[0] + viewport[2] - 0.5f) - 1;
+	int32_t scissorMaxY = (int32_t)ceilf(viewport[1] + viewport[3] - 0.5f) - 1;
+	if (scissorMinX < 0) scissorMinX = 0;
+	if (scissorMinY < 0) scissorMinY = 0;
+	if (scissorMaxX > (int32_t)width - 1) scissorMaxX = (int32_t)width - 1;
+	if (scissorMaxY > (int32_t)height - 1) scissorMaxY = (int32_t)height - 1;
+	if (tri.MinX < scissorMinX) tri.MinX = scissorMinX;
+	if (tri.MinY < scissorMinY) tri.MinY = scissorMinY;
+	if (tri.MaxX > scissorMaxX) tri.MaxX = scissorMaxX;
+	if (tri.MaxY > scissorMaxY) tri.MaxY = scissorMaxY;
+	if (tri.MinX > tri.MaxX || tri.MinY > tri.MaxY)
+		return;
+
+	// Edge k runs between the other two vertices
+	for (uint32_t k = 0; k < 3; k++)
+	{
+		uint32_t a = (k + 1) % 3;
+		uint32_t b = (k + 2) % 3;
+		tri.A[k] = tri.Y[a] - tri.Y[b];
+		tri.B[k] = tri.X[b] - tri.X[a];
+		tri.C[k] = -((int64_t)tri.A[k] * tri.X[a] + (int64_t)tri.B[k] * tri.Y[a]);
+
+		// Top-left rule: pixel centers exactly on a left or top
+		// edge belong to this triangle, otherwise to its neighbor
+		bool topLeft = tri.A[k] > 0 || (tri.A[k] == 0 && tri.B[k] > 0);
+		tri.Threshold[k] = topLeft ? -1 : 0;
+	}
+	tri.InvArea = 1.0f / (float)area;
+
+	// Varyings, premultiplied for perspective correct interpolation
+	tri.VaryingOffset = (uint32_t)varyings.size();
+	for (uint32_t v = 0; v < 3; v++)
+	{
+		const float* source = vertices[order[v]]->Varyings;
+		for (uint32_t i = 0; i < varyingCount; i++)
+			varyings.push_back(source[i] * tri.InvW[v]);
+	}
+	tri.Draw = drawCount - 1;
+
+	uint32_t index = (uint32_t)triangles.size();
+	triangles.push_back(tri);
+	triangleCount++;
+
+	for (int32_t ty = tri.MinY / SOFTWARE_RASTER_TILE_SIZE; ty <= tri.MaxY / SOFTWARE_RASTER_TILE_SIZE; ty++)
+	{
+		for (int32_t tx = tri.MinX / SOFTWARE_RASTER_TILE_SIZE; tx <= tri.MaxX / SOFTWARE_RASTER_TILE_SIZE; tx++)
+		{
+			std::vector<uint32_t>& bin = bins[ty * tilesX + tx];
+			if (bin.empty())
+				activeTiles.push_back(ty * tilesX + tx);
+			bin.push_back(index);
+			binnedCount++;
+		}
+	}
+}
+
+void SoftwareRasterizer::Flush()
+{
+	if (activeTiles.empty())
+	{
+		triangles.clear();
+		varyings.clear();
+		drawCount = 0;
+		return;
+	}
+
+	ParallelFor((uint32_t)activeTiles.size(), [&](uint32_t item, uint32_t thread)
+	{
+		RasterizeTile(activeTiles[item], thread);
+	});
+
+	for (uint32_t tile : activeTiles)
+		bins[tile].clear();
+	activeTiles.clear();
+	triangles.clear();
+	varyings.clear();
+	drawCount = 0;
+
+	for (size_t t = 0; t < threadPixelCounts.size(); t++)
+	{
+		pixelCount += threadPixelCounts[t];
+		threadPixelCounts[t] = 0;
+	}
+}
+
+// --------------------------------------------------------
+// Walks each triangle over its part of the tile, four
+// pixels at a time.  An edge whose function can't change
+// sign within that area is skipped; the others fit in 32
+// bits there, so they're tested with SSE2.
+// --------------------------------------------------------
+void SoftwareRasterizer::RasterizeTile(uint32_t tile, uint32_t thread)
+{
+	int32_t tileMinX = (int32_t)(tile % tilesX) * SOFTWARE_RASTER_TILE_SIZE;
+	int32_t tileMinY = (int32_t)(tile / tilesX) * SOFTWARE_RASTER_TILE_SIZE;
+	int32_t tileMaxX = tileMinX + SOFTWARE_RASTER_TILE_SIZE - 1;
+	int32_t tileMaxY = tileMinY + SOFTWARE_RASTER_TILE_SIZE - 1;
+
+	for (uint32_t index : bins[tile])
+	{
+		const Triangle& tri = triangles[index];
+		const DrawRecord& draw = draws[tri.Draw];
+
+		int32_t minX = tri.MinX > tileMinX ? tri.MinX : tileMinX;
+		int32_t minY = tri.MinY > tileMinY ? tri.MinY : tileMinY;
+		int32_t maxX = tri.MaxX < tileMaxX ? tri.MaxX : tileMaxX;
+		int32_t maxY = tri.MaxY < tileMaxY ? tri.MaxY : tileMaxY;
+		if (minX > maxX || minY > maxY)
+			continue;
+
+		// Edge functions at the first pixel center, and per pixel steps
+		int64_t start[3];
+		int64_t stepX[3];
+		int64_t stepY[3];
+		uint32_t partial[3];
+		uint32_t partialCount = 0;
+		bool outside = false;
+		int64_t centerX = (int64_t)minX * SUBPIXEL_SCALE + SUBPIXEL_HALF;
+		int64_t centerY = (int64_t)minY * SUBPIXEL_SCALE + SUBPIXEL_HALF;
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			start[k] = tri.A[k] * centerX + tri.B[k] * centerY + tri.C[k];
+			stepX[k] = (int64_t)tri.A[k] * SUBPIXEL_SCALE;
+			stepY[k] = (int64_t)tri.B[k] * SUBPIXEL_SCALE;
+
+			int64_t spanX = stepX[k] * (maxX - minX);
+			int64_t spanY = stepY[k] * (maxY - minY);
+			int64_t lowest = start[k] + (spanX < 0 ? spanX : 0) + (spanY < 0 ? spanY : 0);
+			int64_t highest = start[k] + (spanX > 0 ? spanX : 0) + (spanY > 0 ? spanY : 0);
+			if (highest <= tri.Threshold[k])
+				outside = true;
+			else if (lowest <= tri.Threshold[k])
+				partial[partialCount++] = k;
+		}
+		if (outside)
+			continue;
+
+#if SOFTWARE_RASTER_SSE2
+		__m128i laneSteps[3];
+		__m128i thresholds[3];
+		for (uint32_t p = 0; p < partialCount; p++)
+		{
+			int32_t step = (int32_t)stepX[partial[p]];
+			laneSteps[p] = _mm_setr_epi32(0, step, step * 2, step * 3);
+			thresholds[p] = _mm_set1_epi32(tri.Threshold[partial[p]]);
+		}
+#endif
+
+		for (int32_t y = minY; y <= maxY; y++)
+		{
+			int64_t row[3];
+			for (uint32_t k = 0; k < 3; k++)
+				row[k] = start[k] + stepY[k] * (y - minY);
+
+			for (int32_t x = minX; x <= maxX; x += 4)
+			{
+				int64_t offset = x - minX;
+				uint32_t lanes = maxX - x >= 3 ? 0xF : (1u << (maxX - x + 1)) - 1;
+
+#if SOFTWARE_RASTER_SSE2
+				__m128i inside = _mm_set1_epi32(-1);
+				for (uint32_t p = 0; p < partialCount; p++)
+				{
+					uint32_t k = partial[p];
+					__m128i e = _mm_add_epi32(_mm_set1_epi32((int32_t)(row[k] + stepX[k] * offset)), laneSteps[p]);
+					inside = _mm_and_si128(inside, _mm_cmpgt_epi32(e, thresholds[p]));
+				}
+				lanes &= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(inside));
+#else
+				for (uint32_t p = 0; p < partialCount; p++)
+				{
+					uint32_t k = partial[p];
+					int32_t e = (int32_t)(row[k] + stepX[k] * offset);
+					for (uint32_t lane = 0; lane < 4; lane++)
+						if (e + (int32_t)stepX[k] * (int32_t)lane <= tri.Threshold[k])
+							lanes &= ~(1u << lane);
+				}
+#endif
+
+				for (uint32_t lane = 0; lane < 4; lane++)
+				{
+					if (!(lanes & (1u << lane)))
+						continue;
+
+					int64_t pixel = offset + lane;
+					ShadePixel(tri, draw, x + lane, y, row[1] + stepX[1] * pixel, row[2] + stepX[2] * pixel);
+					threadPixelCounts[thread]++;
+				}
+			}
+		}
+	}
+}
+
+static bool DepthPasses(uint32_t func, float z, float stored)
+{
+	switch (func)
+	{
+	case RHI_COMPARISON_NEVER: return false;
+	case RHI_COMPARISON_LESS: return z < stored;
+	case RHI_COMPARISON_EQUAL: return z == stored;
+	case RHI_COMPARISON_LESS_EQUAL: return z <= stored;
+	case RHI_COMPARISON_GREATER: return z > stored;
+	case RHI_COMPARISON_GREATER_EQUAL: return z >= stored;
+	default: return true;
+	}
+}
+
+static uint32_t PackColor(const float color[4])
+{
+	uint32_t packed = 0;
+	for (uint32_t c = 0; c < 4; c++)
+	{
+		float value = color[c] != color[c] ? 0.0f : color[c];	// NaN to black
+		value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+		packed |= (uint32_t)(value * 255.0f + 0.5f) << (c * 8);
+	}
+	return packed;
+}
+
+// --------------------------------------------------------
+// Depth test, then the pixel shader with perspective correct
+// varyings.  e1 and e2 are the edge functions opposite
+// vertices 1 and 2 (their weights, scaled by the area).
+// --------------------------------------------------------
+void SoftwareRasterizer::ShadePixel(const Triangle& tri, const DrawRecord& draw, int32_t x, int32_t y, int64_t e1, int64_t e2)
+{
+	float l1 = (float)e1 * tri.InvArea;
+	float l2 = (float)e2 * tri.InvArea;
+
+	float z = tri.Z[0] + (tri.Z[1] - tri.Z[0]) * l1 + (tri.Z[2] - tri.Z[0]) * l2;
+	if (z < draw.MinDepth || z > draw.MaxDepth)
+		return;
+
+	size_t pixel = (size_t)y * width + x;
+	if (depth && draw.DepthEnable && !DepthPasses(draw.DepthFunc, z, depth[pixel]))
+		return;
+
+	float invW = tri.InvW[0] + (tri.InvW[1] - tri.InvW[0]) * l1 + (tri.InvW[2] - tri.InvW[0]) * l2;
+	float w = 1.0f / invW;
+
+	float interpolated[SOFTWARE_RASTER_MAX_VARYINGS];
+	uint32_t n = draw.VaryingCount;
+	const float* v0 = &varyings[tri.VaryingOffset];
+	const float* v1 = v0 + n;
+	const float* v2 = v1 + n;
+	for (uint32_t i = 0; i < n; i++)
+		interpolated[i] = (v0[i] + (v1[i] - v0[i]) * l1 + (v2[i] - v0[i]) * l2) * w;
+
+	float result[4] = { 0, 0, 0, 1 };
+	draw.PixelShader(draw.Constants.data(), interpolated, result);
+
+	if (color)
+		color[pixel] = PackColor(result);
+	if (depth && draw.DepthEnable && draw.DepthWrite)
+		depth[pixel] = z;
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "JobSystem.h"
+#include "RHI.h"
+
+#define SOFTWARE_RASTER_TILE_SIZE		32
+#define SOFTWARE_RASTER_MAX_VARYINGS	16
+
+// Vertex positions snap to 1/16th of a pixel
+#define SOFTWARE_RASTER_SUBPIXEL_BITS	4
+
+// --------------------------------------------------------
+// What a vertex shader hands the rasterizer: a clip space
+// position, and the values to interpolate for the pixel
+// shader (the VertexToPixel struct, flattened to floats)
+// --------------------------------------------------------
+struct SoftwareVertexOutput
+{
+	float Position[4];
+	float Varyings[SOFTWARE_RASTER_MAX_VARYINGS];
+};
+
+// Shaders are plain functions, handed their constants like a cbuffer
+typedef void (*SoftwareVertexShader)(const void* constants, const uint8_t* vertex, SoftwareVertexOutput& output);
+typedef void (*SoftwarePixelShader)(const void* constants, const float* varyings, float color[4]);
+
+// --------------------------------------------------------
+// Everything a draw needs besides its vertices.  Pixel
+// shader constants are copied, so they can change as soon
+// as Draw() returns (vertex shaders run inside Draw()).
+// --------------------------------------------------------
+struct SoftwareDrawState
+{
+	SoftwareVertexShader VertexShader = 0;
+	const void* VertexConstants = 0;
+
+	SoftwarePixelShader PixelShader = 0;
+	const void* PixelConstants = 0;
+	uint32_t PixelConstantsSize = 0;
+
+	uint32_t VaryingCount = 0;
+
+	// Fixed function state (RHI_CULL_* and RHI_COMPARISON_*)
+	uint32_t CullMode = RHI_CULL_BACK;
+	bool DepthEnable = true;
+	bool DepthWrite = true;
+	uint32_t DepthFunc = RHI_COMPARISON_LESS;
+};
+
+// --------------------------------------------------------
+// Draws triangles on the CPU, into RGBA8 color and float
+// depth buffers.
+//
+// Draw() shades vertices, clips, and sorts the triangles
+// into 32x32 pixel tiles.  Flush() fills the tiles in as
+// jobs, spread over every thread in the job system (vertex
+// shading is split up the same way).  A tile's triangles
+// are always drawn in the order they were submitted by a
+// single thread, so the image doesn't depend on the thread
+// count or timing.
+//
+// Coverage uses fixed point edge functions (four pixels at
+// a time with SSE2) and the top-left fill rule, so shared
+// edges are never drawn twice or skipped.
+// --------------------------------------------------------
+class SoftwareRasterizer
+{
+public:
+	SoftwareRasterizer(std::shared_ptr<JobSystem> jobs);
+	~SoftwareRasterizer();
+
+	// Where triangles go (either buffer can be null).  Anything
+	// queued for the previous target is drawn first.
+	void SetTarget(uint32_t* color, float* depth, uint32_t width, uint32_t height);
+	void SetViewport(float x, float y, float width, float height, float minDepth = 0.0f, float maxDepth = 1.0f);
+
+	// Shades the vertices and queues the triangles.  With no
+	// indices, count vertices from first are drawn in order.
+	void Draw(
+		const SoftwareDrawState& state,
+		const uint8_t* vertices,
+		uint32_t stride,
+		uint32_t vertexCount,
+		const uint32_t* indices,
+		uint32_t count,
+		uint32_t first = 0,
+		int32_t baseVertex = 0);
+
+	// Draws everything queued
+	void Flush();
+
+	// Stats since the last ResetStats()
+	uint64_t GetTriangleCount() const { return triangleCount; }
+	uint64_t GetBinnedCount() const { return binnedCount; }
+	uint64_t GetPixelCount() const { return pixelCount; }
+	uint64_t GetStolenCount() const { return stolenCount; }	// Jobs that moved to another thread
+	void ResetStats();
+
+	uint32_t GetThreadCount() const { return jobs->GetThreadCount(); }
+
+	// Is coverage tested with SSE2 (otherwise it's scalar)?
+	static bool HasSIMD();
+
+private:
+	// A queued triangle, in 28.4 fixed point screen space
+	struct Triangle
+	{
+		int32_t X[3];
+		int32_t Y[3];
+		int32_t MinX, MinY, MaxX, MaxY;	// Pixels it can touch
+
+		// Edge functions: E(x, y) = A * x + B * y + C, with the
+		// edge opposite each vertex (its barycentric weight)
+		int32_t A[3];
+		int32_t B[3];
+		int64_t C[3];
+		int32_t Threshold[3];			// Fill rule: inside when E > threshold
+		float InvArea;
+
+		// Per vertex, divided by w for perspective correction
+		float Z[3];
+		float InvW[3];
+		uint32_t VaryingOffset;
+		uint32_t Draw;
+	};
+
+	// Per draw state the pixel stage needs
+	struct DrawRecord
+	{
+		SoftwarePixelShader PixelShader;
+		std::vector<uint8_t> Constants;
+		uint32_t VaryingCount;
+		bool DepthEnable;
+		bool DepthWrite;
+		uint32_t DepthFunc;
+		float MinDepth;
+		float MaxDepth;
+	};
+
+	void SetupTriangle(const SoftwareVertexOutput* vertices[3], uint32_t cullMode, uint32_t varyingCount);
+	void ClipTriangle(const SoftwareVertexOutput* vertices[3], uint32_t cullMode, uint32_t varyingCount);
+	void RasterizeTile(uint32_t tile, uint32_t thread);
+	void ShadePixel(const Triangle& tri, const DrawRecord& draw, int32_t x, int32_t y, int64_t e1, int64_t e2);
+
+	// Target
+	uint32_t* color;
+	float* depth;
+	uint32_t width;
+	uint32_t height;
+	uint32_t tilesX;
+	uint32_t tilesY;
+
+	// Viewport, and how far past it vertices can be before
+	// they're clipped (keeps the fixed point math in range)
+	float viewport[6];
+	float guardBandX;
+	float guardBandY;
+
+	// Queued work
+	std::vector<SoftwareVertexOutput> shadedVertices;
+	std::vector<Triangle> triangles;
+	std::vector<float> varyings;
+	std::vector<DrawRecord> draws;
+	uint32_t drawCount;
+	std::vector<std::vector<uint32_t>> bins;
+	std::vector<uint32_t> activeTiles;
+
+	// Stats
+	uint64_t triangleCount;
+	uint64_t binnedCount;
+	uint64_t pixelCount;
+	uint64_t stolenCount;
+	std::vector<uint64_t> threadPixelCounts;	// Plus one for a caller outside the pool
+
+	// Runs job(item, thread) for every item, as jobs.  The job
+	// is taken by reference, as wrapping a lambda with a few
+	// captures in a std::function goes to the heap every draw.
+	template<typename Function>
+	void ParallelFor(uint32_t count, const Function& job)
+	{
+		// A caller from outside the pool gets the last stats slot
+		uint32_t outsideSlot = jobs->GetThreadCount();
+		uint64_t stolenBefore = jobs->GetStolenCount();
+
+		jobs->ParallelFor(count, 1, [&](uint32_t first, uint32_t end, uint32_t thread)
+		{
+			uint32_t slot = thread == JOB_SYSTEM_NO_THREAD ? outsideSlot : thread;
+			for (uint32_t i = first; i < end; i++)
+				job(i, slot);
+		});
+
+		stolenCount += jobs->GetStolenCount() - stolenBefore;
+	}
+
+	std::shared_ptr<JobSystem> jobs;
+};
@@ -0,0 +1,272 @@
+#include "SoftwareShaders.h"
+
+#include <cmath>
+#include <cstring>
+
+// Just enough of HLSL's float3 for the ports below
+namespace
+{
+	struct float3
+	{
+		float x, y, z;
+
+		float3() : x(0), y(0), z(0) {}
+		float3(float s) : x(s), y(s), z(s) {}
+		float3(float x, float y, float z) : x(x), y(y), z(z) {}
+		explicit float3(const float* f) : x(f[0]), y(f[1]), z(f[2]) {}
+	};
+
+	float3 operator+(float3 a, float3 b) { return float3(a.x + b.x, a.y + b.y, a.z + b.z); }
+	float3 operator-(float3 a, float3 b) { return float3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	float3 operator*(float3 a, float3 b) { return float3(a.x * b.x, a.y * b.y, a.z * b.z); }
+	float3 operator/(float3 a, float b) { return float3(a.x / b, a.y / b, a.z / b); }
+
+	float dot(float3 a, float3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	float3 cross(float3 a, float3 b) { return float3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+	float3 normalize(float3 v) { return v / sqrtf(dot(v, v)); }
+	float3 pow(float3 v, float p) { return float3(powf(v.x, p), powf(v.y, p), powf(v.z, p)); }
+	float3 lerp(float3 a, float3 b, float t) { return a + (b - a) * float3(t); }
+
+	// mul(v, m) with the matrix stored row major, which is what
+	// HLSL's mul(m, v) does with an XMFLOAT4X4 uploaded as is
+	void Transform(const float v[4], const float* m, float result[4])
+	{
+		for (int c = 0; c < 4; c++)
+			result[c] = v[0] * m[c] + v[1] * m[4 + c] + v[2] * m[8 + c] + v[3] * m[12 + c];
+	}
+
+	float3 TransformNormal(float3 v, const float* m)
+	{
+		return float3(
+			v.x * m[0] + v.y * m[4] + v.z * m[8],
+			v.x * m[1] + v.y * m[5] + v.z * m[9],
+			v.x * m[2] + v.y * m[6] + v.z * m[10]);
+	}
+
+	void Multiply(const float* a, const float* b, float* result)
+	{
+		for (int r = 0; r < 4; r++)
+			Transform(&a[r * 4], b, &result[r * 4]);
+	}
+}
+
+// --------------------------------------------------------
+// Shaders
+// --------------------------------------------------------
+void SoftwareVertexShaderMain(const void* constants, const uint8_t* vertex, SoftwareVertexOutput& output)
+{
+	const SoftwareVertexConstants& c = *(const SoftwareVertexConstants*)constants;
+	float input[11];
+	memcpy(input, vertex, sizeof(input));
+
+	float worldView[16];
+	float wvp[16];
+	Multiply(c.World, c.View, worldView);
+	Multiply(worldView, c.Projection, wvp);
+
+	float position[4] = { input[0], input[1], input[2], 1.0f };
+	Transform(position, wvp, output.Position);
+
+	float worldPos[4];
+	Transform(position, c.World, worldPos);
+
+	float3 normal = TransformNormal(float3(&input[3]), c.WorldInvTranspose);
+	float3 tangent = TransformNormal(float3(&input[8]), c.World);
+
+	float* v = output.Varyings;
+	v[0] = normal.x; v[1] = normal.y; v[2] = normal.z;
+	v[3] = input[6]; v[4] = input[7];
+	v[5] = tangent.x; v[6] = tangent.y; v[7] = tangent.z;
+	v[8] = worldPos[0]; v[9] = worldPos[1]; v[10] = worldPos[2];
+}
+
+void SoftwareSkyBoxVSMain(const void* constants, const uint8_t* vertex, SoftwareVertexOutput& output)
+{
+	const SoftwareSkyVertexConstants& c = *(const SoftwareSkyVertexConstants*)constants;
+	float input[3];
+	memcpy(input, vertex, sizeof(input));
+
+	float viewNoTranslation[16];
+	memcpy(viewNoTranslation, c.View, sizeof(viewNoTranslation));
+	viewNoTranslation[12] = 0;
+	viewNoTranslation[13] = 0;
+	viewNoTranslation[14] = 0;
+
+	float viewProj[16];
+	Multiply(viewNoTranslation, c.Projection, viewProj);
+
+	float position[4] = { input[0], input[1], input[2], 1.0f };
+	Transform(position, viewProj, output.Position);
+
+	// On the far clip plane
+	output.Position[2] = output.Position[3];
+
+	output.Varyings[0] = input[0];
+	output.Varyings[1] = input[1];
+	output.Varyings[2] = input[2];
+}
+
+void SoftwareNormalPSMain(const void* constants, const float* varyings, float color[4])
+{
+	const SoftwareLitPixelConstants& c = *(const SoftwareLitPixelConstants*)constants;
+	float u = varyings[3];
+	float v = varyings[4];
+	float3 worldPos(&varyings[8]);
+
+	// Normal mapping
+	float sample[4];
+	SampleTexture(c.NormalMap, u, v, sample);
+	float3 unpackedNormal = normalize(float3(sample[0] * 2 - 1, sample[1] * 2 - 1, sample[2] * 2 - 1));
+
+	float3 N = normalize(float3(&varyings[0]));
+	float3 T = normalize(float3(&varyings[5]));
+	T = normalize(T - N * float3(dot(T, N)));
+	float3 B = cross(T, N);
+	float3 normal =
+		T * float3(unpackedNormal.x) +
+		B * float3(unpackedNormal.y) +
+		N * float3(unpackedNormal.z);
+
+	SampleTexture(c.Albedo, u, v, sample);
+	float3 surfaceColor = pow(float3(sample), 2.2f) * float3(c.ColorTint);
+
+	SampleTexture(c.RoughnessMap, u, v, sample);
+	float surfaceRoughness = sample[0];
+	SampleTexture(c.MetalnessMap, u, v, sample);
+	float metalness = sample[0];
+	float3 specularColor = lerp(float3(PBR_F0_NON_METAL), surfaceColor, metalness);
+
+	// One pixel at a time, so this uses the scalar reference
+	float3 total = surfaceColor * float3(c.AmbientColor);
+	float n[3] = { normal.x, normal.y, normal.z };
+	float p[3] = { worldPos.x, worldPos.y, worldPos.z };
+	float albedo[3] = { surfaceColor.x, surfaceColor.y, surfaceColor.z };
+	float f0[3] = { specularColor.x, specularColor.y, specularColor.z };
+
+	uint32_t lightCount = c.LightCount < SOFTWARE_MAX_LIGHTS ? c.LightCount : SOFTWARE_MAX_LIGHTS;
+	for (uint32_t i = 0; i < lightCount; i++)
+	{
+		float light[3];
+		PBRLighting::EvaluateLight(c.Lights[i], n, p, c.CameraPosition, surfaceRoughness, metalness, albedo, f0, light);
+		total = total + float3(light);
+	}
+
+	float3 result = pow(total, 1.0f / 2.2f);
+	color[0] = result.x;
+	color[1] = result.y;
+	color[2] = result.z;
+	color[3] = 1.0f;
+}
+
+void SoftwareSkyBoxPSMain(const void* constants, const float* varyings, float color[4])
+{
+	const SoftwareSkyPixelConstants& c = *(const SoftwareSkyPixelConstants*)constants;
+	SampleCubeMap(c.Sky, varyings, color);
+}
+
+// --------------------------------------------------------
+// Samplers
+// --------------------------------------------------------
+static void Bilinear(const PNGImage& image, float x, float y, bool wrap, float color[4])
+{
+	int32_t w = (int32_t)image.Width;
+	int32_t h = (int32_t)image.Height;
+
+	float fx = floorf(x);
+	float fy = floorf(y);
+	int32_t x0 = (int32_t)fx;
+	int32_t y0 = (int32_t)fy;
+	float tx = x - fx;
+	float ty = y - fy;
+
+	int32_t xs[2] = { x0, x0 + 1 };
+	int32_t ys[2] = { y0, y0 + 1 };
+	for (int i = 0; i < 2; i++)
+	{
+		if (wrap)
+		{
+			xs[i] = ((xs[i] % w) + w) % w;
+			ys[i] = ((ys[i] % h) + h) % h;
+		}
+		else
+		{
+			xs[i] = xs[i] < 0 ? 0 : (xs[i] >= w ? w - 1 : xs[i]);
+			ys[i] = ys[i] < 0 ? 0 : (ys[i] >= h ? h - 1 : ys[i]);
+		}
+	}
+
+	const uint8_t* p = image.Pixels.data();
+	for (int c = 0; c < 4; c++)
+	{
+		float top =
+			p[((size_t)ys[0] * w + xs[0]) * 4 + c] * (1 - tx) +
+			p[((size_t)ys[0] * w + xs[1]) * 4 + c] * tx;
+		float bottom =
+			p[((size_t)ys[1] * w + xs[0]) * 4 + c] * (1 - tx) +
+			p[((size_t)ys[1] * w + xs[1]) * 4 + c] * tx;
+		color[c] = (top * (1 - ty) + bottom * ty) / 255.0f;
+	}
+}
+
+void SampleTexture(const PNGImage* texture, float u, float v, float color[4])
+{
+	if (!texture || texture->Width == 0 || texture->Height == 0 || u != u || v != v)
+	{
+		color[0] = color[1] = color[2] = color[3] = 0.0f;
+		return;
+	}
+
+	// Wrap first, so huge coordinates stay in range
+	u -= floorf(u);
+	v -= floorf(v);
+	Bilinear(*texture, u * texture->Width - 0.5f, v * texture->Height - 0.5f, true, color);
+}
+
+// --------------------------------------------------------
+// Picks the face by the largest axis, then samples it with
+// clamping (the GPU filters across face edges, which only
+// matters for the outermost texels)
+// --------------------------------------------------------
+void SampleCubeMap(const SoftwareCubeMap* cube, const float direction[3], float color[4])
+{
+	color[0] = color[1] = color[2] = color[3] = 0.0f;
+	if (!cube)
+		return;
+
+	float x = direction[0], y = direction[1], z = direction[2];
+	float ax = fabsf(x), ay = fabsf(y), az = fabsf(z);
+
+	int face;
+	float sc, tc, ma;
+	if (ax >= ay && ax >= az)
+	{
+		face = x >= 0 ? 0 : 1;
+		sc = x >= 0 ? -z : z;
+		tc = -y;
+		ma = ax;
+	}
+	else if (ay >= az)
+	{
+		face = y >= 0 ? 2 : 3;
+		sc = x;
+		tc = y >= 0 ? z : -z;
+		ma = ay;
+	}
+	else
+	{
+		face = z >= 0 ? 4 : 5;
+		sc = z >= 0 ? x : -x;
+		tc = -y;
+		ma = az;
+	}
+	if (!(ma > 0.0f))
+		return;
+
+	const PNGImage& image = cube->Faces[face];
+	if (image.Width == 0 || image.Height == 0)
+		return;
+
+	float u = (sc / ma + 1.0f) * 0.5f;
+	float v = (tc / ma + 1.0f) * 0.5f;
+	Bilinear(image, u * image.Width - 0.5f, v * image.Height - 0.5f, false, color);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "PBRLighting.h"
+#include "PNGImage.h"
+#include "SoftwareRasterizer.h"
+
+// --------------------------------------------------------
+// C++ ports of the shaders the scene is drawn with, for the
+// software rasterizer.  Constants mirror the cbuffers, and
+// the matrices are stored the way DirectX::XMFLOAT4X4 stores
+// them, so they can be copied straight from Transform and
+// Camera.
+//
+// Textures are sampled bilinearly from the top mip with wrap
+// addressing (the GPU path uses anisotropic filtering), and
+// a missing texture reads as zero, like an unbound SRV.
+// --------------------------------------------------------
+
+// Floats each shader's VertexToPixel flattens to
+#define SOFTWARE_LIT_VARYING_COUNT	11	// normal, uv, tangent, worldPos
+#define SOFTWARE_SKY_VARYING_COUNT	3	// sampleDir
+
+#define SOFTWARE_MAX_LIGHTS 8
+
+// Six faces in Direct3D's order: +X, -X, +Y, -Y, +Z, -Z
+struct SoftwareCubeMap
+{
+	PNGImage Faces[6];
+};
+
+// VertexShader.hlsl
+struct SoftwareVertexConstants
+{
+	float World[16];
+	float WorldInvTranspose[16];
+	float View[16];
+	float Projection[16];
+};
+
+// SkyBoxVS.hlsl
+struct SoftwareSkyVertexConstants
+{
+	float View[16];
+	float Projection[16];
+};
+
+// NormalPS.hlsl, minus the shadow maps
+struct SoftwareLitPixelConstants
+{
+	float Roughness;
+	float ColorTint[3];
+	float AmbientColor[3];
+	float CameraPosition[3];
+	PBRLight Lights[SOFTWARE_MAX_LIGHTS];
+	uint32_t LightCount;
+
+	const PNGImage* Albedo;
+	const PNGImage* RoughnessMap;
+	const PNGImage* MetalnessMap;
+	const PNGImage* NormalMap;
+};
+
+// SkyBoxPS.hlsl
+struct SoftwareSkyPixelConstants
+{
+	const SoftwareCubeMap* Sky;
+};
+
+// Vertices are the Vertex struct from Vertex.h
+#define SOFTWARE_VERTEX_STRIDE (11 * sizeof(float))
+
+void SoftwareVertexShaderMain(const void* constants, const uint8_t* vertex, SoftwareVertexOutput& output);
+void SoftwareSkyBoxVSMain(const void* constants, const uint8_t* vertex, SoftwareVertexOutput& output);
+void SoftwareNormalPSMain(const void* constants, const float* varyings, float color[4]);
+void SoftwareSkyBoxPSMain(const void* constants, const float* varyings, float color[4]);
+
+// Samplers
+void SampleTexture(const PNGImage* texture, float u, float v, float color[4]);
+void SampleCubeMap(const SoftwareCubeMap* cube, const float direction[3], float color[4]);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdio>
+
+// --------------------------------------------------------
+// Checks for the tests (the *Test.cpp programs CTest runs).
+// A failed check prints where it is and the test carries
+// on, so one run shows every failure; main() returns
+// TestResult() at the end.
+// --------------------------------------------------------
+inline int testFailures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) \
+		{ \
+			printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			testFailures++; \
+		} \
+	} while (0)
+
+// Prints how it went, and returns what main() should
+inline int TestResult()
+{
+	if (testFailures > 0)
+		printf("%d check%s failed\n", testFailures, testFailures == 1 ? "" : "s");
+	else
+		printf("All checks passed\n");
+	return testFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,267 @@
+#include "TileLightCulling.h"
+
+#include <cmath>
+
+// Clamps to [low, high]
+static float Clamp(float value, float low, float high)
+{
+	return value < low ? low : (value > high ? high : value);
+}
+
+// --------------------------------------------------------
+// Finds the range of x/z (or y/z) slopes covered by a
+// sphere along one axis, using the tangent lines from the
+// eye.  The sphere must be entirely in front of the eye.
+// --------------------------------------------------------
+static void GetSphereSlopeRange(float axis, float z, float radius, float& minSlope, float& maxSlope)
+{
+	float distSq = axis * axis + z * z;
+	float tangent = sqrtf(distSq - radius * radius);
+
+	// Tangent directions are the center direction rotated either
+	// way by the sphere's half angle (both have positive z here)
+	float axisA = axis * tangent - z * radius;
+	float zA = z * tangent + axis * radius;
+	float axisB = axis * tangent + z * radius;
+	float zB = z * tangent - axis * radius;
+
+	minSlope = axisA / zA;
+	maxSlope = axisB / zB;
+}
+
+// Constructor
+TileLightCuller::TileLightCuller() :
+	globalLightCount(0)
+{
+}
+
+// Destructor
+TileLightCuller::~TileLightCuller()
+{
+}
+
+// --------------------------------------------------------
+// Tests each light against the tiles under its projected
+// bounds, then sorts the hits into per-tile lists
+// --------------------------------------------------------
+void TileLightCuller::Build(
+	const TileCullingConfig& _config,
+	const ClusterLight* lights,
+	unsigned int lightCount,
+	const float* tileMinZ,
+	const float* tileMaxZ)
+{
+	config = _config;
+	uint32_t tileCountX = config.GetTileCountX();
+	uint32_t tileCount = config.GetTileCount();
+
+	indices.clear();
+	pairTiles.clear();
+	pairLights.clear();
+	tileCounts.assign(tileCount, 0);
+	ranges.assign((size_t)tileCount * 2, 0);
+
+	// Global lights first
+	for (unsigned int i = 0; i < lightCount; i++)
+	{
+		if (lights[i].Global)
+			indices.push_back(i);
+	}
+	globalLightCount = (unsigned int)indices.size();
+
+	// Side planes only depend on the column or row
+	uint32_t tileCountY = config.GetTileCountY();
+	columnFrusta.resize(tileCountX);
+	rowFrusta.resize(tileCountY);
+	columnHits.resize(tileCountX);
+	rowHits.resize(tileCountY);
+	for (uint32_t x = 0; x < tileCountX; x++)
+		GetTileFrustum(config, x, 0, config.NearZ, config.FarZ, columnFrusta[x]);
+	for (uint32_t y = 0; y < tileCountY; y++)
+		GetTileFrustum(config, 0, y, config.NearZ, config.FarZ, rowFrusta[y]);
+
+	// Find every (tile, light) hit
+	for (unsigned int i = 0; i < lightCount; i++)
+	{
+		const ClusterLight& light = lights[i];
+		TileRect rect;
+		if (light.Global || !GetLightTileRect(config, light, rect))
+			continue;
+
+		// Same plane tests as SphereIntersectsTile(), split by axis
+		const float* center = light.Position;
+		float radius = light.Range;
+		bool anyColumn = false;
+		bool anyRow = false;
+		for (uint32_t x = rect.MinX; x <= rect.MaxX; x++)
+		{
+			const TileFrustum& column = columnFrusta[x];
+			columnHits[x] =
+				column.Planes[0][0] * center[0] + column.Planes[0][2] * center[2] >= -radius &&
+				column.Planes[1][0] * center[0] + column.Planes[1][2] * center[2] >= -radius;
+			anyColumn |= columnHits[x] != 0;
+		}
+		for (uint32_t y = rect.MinY; y <= rect.MaxY; y++)
+		{
+			const TileFrustum& row = rowFrusta[y];
+			rowHits[y] =
+				row.Planes[2][1] * center[1] + row.Planes[2][2] * center[2] >= -radius &&
+				row.Planes[3][1] * center[1] + row.Planes[3][2] * center[2] >= -radius;
+			anyRow |= rowHits[y] != 0;
+		}
+		if (!anyColumn || !anyRow)
+			continue;
+
+		for (uint32_t y = rect.MinY; y <= rect.MaxY; y++)
+		{
+			if (!rowHits[y])
+				continue;
+
+			for (uint32_t x = rect.MinX; x <= rect.MaxX; x++)
+			{
+				if (!columnHits[x])
+					continue;
+
+				// Depth bounds are per tile, when there are any
+				uint32_t tile = x + y * tileCountX;
+				if (tileMinZ && center[2] + radius < tileMinZ[tile])
+					continue;
+				if (tileMaxZ && center[2] - radius > tileMaxZ[tile])
+					continue;
+
+				pairTiles.push_back(tile);
+				pairLights.push_back(i);
+				tileCounts[tile]++;
+			}
+		}
+	}
+
+	// Counting sort by tile - lights stay in ascending order per tile
+	uint32_t offset = globalLightCount;
+	for (uint32_t tile = 0; tile < tileCount; tile++)
+	{
+		ranges[tile * 2] = offset;
+		ranges[tile * 2 + 1] = 0;
+		offset += tileCounts[tile];
+	}
+
+	indices.resize(offset);
+	for (size_t i = 0; i < pairTiles.size(); i++)
+	{
+		uint32_t tile = pairTiles[i];
+		indices[ranges[tile * 2] + ranges[tile * 2 + 1]] = pairLights[i];
+		ranges[tile * 2 + 1]++;
+	}
+}
+
+// --------------------------------------------------------
+// Builds the side planes of one tile.  Tile edges past the
+// screen's edge (the last row & column) are clamped to it.
+// --------------------------------------------------------
+void TileLightCuller::GetTileFrustum(const TileCullingConfig& config, uint32_t x, uint32_t y, float minZ, float maxZ, TileFrustum& frustum)
+{
+	float width = (float)config.ScreenWidth;
+	float height = (float)config.ScreenHeight;
+
+	// Tile edges in NDC (y flipped, as tile row 0 is the top)
+	float left = Clamp((float)(x * config.TileSize) / width, 0.0f, 1.0f) * 2.0f - 1.0f;
+	float right = Clamp((float)((x + 1) * config.TileSize) / width, 0.0f, 1.0f) * 2.0f - 1.0f;
+	float top = 1.0f - Clamp((float)(y * config.TileSize) / height, 0.0f, 1.0f) * 2.0f;
+	float bottom = 1.0f - Clamp((float)((y + 1) * config.TileSize) / height, 0.0f, 1.0f) * 2.0f;
+
+	// ...as view space slopes
+	float slopes[4] =
+	{
+		left * config.TanHalfFovX,
+		right * config.TanHalfFovX,
+		bottom * config.TanHalfFovY,
+		top * config.TanHalfFovY
+	};
+
+	// Inward facing normals: x - s*z >= 0 (left/bottom), s*z - x >= 0 (right/top)
+	for (int i = 0; i < 4; i++)
+	{
+		float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+		float invLength = 1.0f / sqrtf(1.0f + slopes[i] * slopes[i]);
+		int axis = i / 2;
+
+		frustum.Planes[i][0] = axis == 0 ? sign * invLength : 0.0f;
+		frustum.Planes[i][1] = axis == 1 ? sign * invLength : 0.0f;
+		frustum.Planes[i][2] = -sign * slopes[i] * invLength;
+	}
+
+	frustum.MinZ = minZ;
+	frustum.MaxZ = maxZ;
+}
+
+// --------------------------------------------------------
+// Sphere vs. tile frustum.  Like most plane-based tests it
+// can accept a sphere just outside a corner, but it never
+// rejects one that's actually inside.
+// --------------------------------------------------------
+bool TileLightCuller::SphereIntersectsTile(const TileFrustum& frustum, const float center[3], float radius)
+{
+	if (center[2] + radius < frustum.MinZ || center[2] - radius > frustum.MaxZ)
+		return false;
+
+	for (int i = 0; i < 4; i++)
+	{
+		float distance =
+			frustum.Planes[i][0] * center[0] +
+			frustum.Planes[i][1] * center[1] +
+			frustum.Planes[i][2] * center[2];
+
+		if (distance < -radius)
+			return false;
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Conservative screen space bounds of a light's sphere, in
+// tiles.  Returns false if it's entirely off screen or
+// outside the depth range.
+// --------------------------------------------------------
+bool TileLightCuller::GetLightTileRect(const TileCullingConfig& config, const ClusterLight& light, TileRect& rect)
+{
+	float x = light.Position[0];
+	float y = light.Position[1];
+	float z = light.Position[2];
+	float radius = light.Range;
+
+	if (z + radius < config.NearZ || z - radius > config.FarZ)
+		return false;
+
+	rect.MinX = 0;
+	rect.MinY = 0;
+	rect.MaxX = config.GetTileCountX() - 1;
+	rect.MaxY = config.GetTileCountY() - 1;
+
+	// Spheres that reach the near plane cover an unbounded slope
+	// range - keep the whole screen and let the per-tile test cull
+	if (z - radius <= config.NearZ)
+		return true;
+
+	float minSlopeX, maxSlopeX, minSlopeY, maxSlopeY;
+	GetSphereSlopeRange(x, z, radius, minSlopeX, maxSlopeX);
+	GetSphereSlopeRange(y, z, radius, minSlopeY, maxSlopeY);
+
+	// Slopes -> NDC -> pixels (y flipped)
+	float width = (float)config.ScreenWidth;
+	float height = (float)config.ScreenHeight;
+	float minPixelX = (minSlopeX / config.TanHalfFovX * 0.5f + 0.5f) * width;
+	float maxPixelX = (maxSlopeX / config.TanHalfFovX * 0.5f + 0.5f) * width;
+	float minPixelY = (0.5f - maxSlopeY / config.TanHalfFovY * 0.5f) * height;
+	float maxPixelY = (0.5f - minSlopeY / config.TanHalfFovY * 0.5f) * height;
+
+	if (maxPixelX < 0.0f || minPixelX >= width || maxPixelY < 0.0f || minPixelY >= height)
+		return false;
+
+	float tileSize = (float)config.TileSize;
+	rect.MinX = (uint32_t)(Clamp(minPixelX, 0.0f, width - 1.0f) / tileSize);
+	rect.MaxX = (uint32_t)(Clamp(maxPixelX, 0.0f, width - 1.0f) / tileSize);
+	rect.MinY = (uint32_t)(Clamp(minPixelY, 0.0f, height - 1.0f) / tileSize);
+	rect.MaxY = (uint32_t)(Clamp(maxPixelY, 0.0f, height - 1.0f) / tileSize);
+	return true;
+}
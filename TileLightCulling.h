@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "LightClusters.h"
+
+// --------------------------------------------------------
+// How the screen is split into tiles for the deferred
+// lighting pass
+// --------------------------------------------------------
+struct TileCullingConfig
+{
+	uint32_t TileSize = 16;		// In pixels
+	uint32_t ScreenWidth = 1;
+	uint32_t ScreenHeight = 1;
+
+	float NearZ = 0.1f;
+	float FarZ = 100.0f;
+
+	// From the projection matrix: 1/_11 and 1/_22
+	float TanHalfFovX = 1.0f;
+	float TanHalfFovY = 1.0f;
+
+	uint32_t GetTileCountX() const { return (ScreenWidth + TileSize - 1) / TileSize; }
+	uint32_t GetTileCountY() const { return (ScreenHeight + TileSize - 1) / TileSize; }
+	uint32_t GetTileCount() const { return GetTileCountX() * GetTileCountY(); }
+};
+
+// --------------------------------------------------------
+// A screen tile as a view space frustum: four planes
+// through the eye (normals point inwards) and a depth range
+// --------------------------------------------------------
+struct TileFrustum
+{
+	float Planes[4][3];	// Left, right, bottom, top - no distance term needed
+	float MinZ;
+	float MaxZ;
+};
+
+// Inclusive range of tiles a light might touch
+struct TileRect
+{
+	uint32_t MinX, MinY;
+	uint32_t MaxX, MaxY;
+};
+
+// --------------------------------------------------------
+// Builds per-tile light lists on the CPU, in the same
+// layout as LightClusterBuilder (and so the same shader
+// side lookups):
+//
+// - Ranges:  (offset, count) pairs, one per tile, into...
+// - Indices: light indices.  The global lights come first
+//            (GetGlobalLightCount() of them), followed by
+//            each tile's list.
+//
+// Tiles are indexed x + y * TileCountX, with y = 0 being
+// the TOP row of the screen.  Each light is only tested
+// against the tiles its projected bounds overlap, and as
+// the side planes are shared by a whole column (or row),
+// those tests run once per column and row, not per tile.
+//
+// There's no Direct3D dependency here.
+// --------------------------------------------------------
+class TileLightCuller
+{
+public:
+	TileLightCuller();
+	~TileLightCuller();
+
+	// Rebuilds every tile's light list.  Per-tile depth bounds
+	// are optional - without them each tile spans near to far.
+	void Build(
+		const TileCullingConfig& config,
+		const ClusterLight* lights,
+		unsigned int lightCount,
+		const float* tileMinZ = nullptr,
+		const float* tileMaxZ = nullptr);
+
+	// Results
+	const std::vector<uint32_t>& GetTileRanges() { return ranges; }
+	const std::vector<uint32_t>& GetLightIndices() { return indices; }
+	unsigned int GetGlobalLightCount() { return globalLightCount; }
+	const TileCullingConfig& GetConfig() { return config; }
+
+	// Tile geometry & intersection helpers (shared with the shader's math)
+	static void GetTileFrustum(const TileCullingConfig& config, uint32_t x, uint32_t y, float minZ, float maxZ, TileFrustum& frustum);
+	static bool SphereIntersectsTile(const TileFrustum& frustum, const float center[3], float radius);
+	static bool GetLightTileRect(const TileCullingConfig& config, const ClusterLight& light, TileRect& rect);
+
+private:
+	TileCullingConfig config;
+	unsigned int globalLightCount;
+
+	// Side planes for each column (left/right) and row (bottom/top)
+	std::vector<TileFrustum> columnFrusta;
+	std::vector<TileFrustum> rowFrusta;
+	std::vector<uint8_t> columnHits;
+	std::vector<uint8_t> rowHits;
+
+	// (tile, light) pairs found by the tests, before sorting by tile
+	std::vector<uint32_t> pairTiles;
+	std::vector<uint32_t> pairLights;
+	std::vector<uint32_t> tileCounts;
+
+	// Final packed results
+	std::vector<uint32_t> ranges;
+	std::vector<uint32_t> indices;
+};
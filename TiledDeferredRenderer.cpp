@@ -0,0 +1,223 @@
+#include "TiledDeferredRenderer.h"
+
+#include <cmath>
+
+using namespace DirectX;
+
+// Formats of each G-buffer target - see GBufferPacking.h
+static const DXGI_FORMAT GBufferFormats[GBUFFER_TARGET_COUNT] =
+{
+	DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,	// Albedo
+	DXGI_FORMAT_R16G16_SNORM,			// Octahedral normal
+	DXGI_FORMAT_R8G8_UNORM,				// Roughness, metalness
+	DXGI_FORMAT_R32_FLOAT				// Linear view depth
+};
+
+// Constructor
+TiledDeferredRenderer::TiledDeferredRenderer(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	std::shared_ptr<SimplePixelShader> gBufferPS,
+	std::shared_ptr<SimpleVertexShader> fullscreenVS,
+	std::shared_ptr<SimplePixelShader> lightingPS,
+	unsigned int tileSize)
+	:
+	device(device),
+	context(context),
+	gBufferPS(gBufferPS),
+	fullscreenVS(fullscreenVS),
+	lightingPS(lightingPS),
+	width(0),
+	height(0),
+	lightBuffer(device, context),
+	rangeBuffer(device, context),
+	indexBuffer(device, context)
+{
+	cullingConfig.TileSize = tileSize;
+
+	gBufferColorTint = gBufferPS->GetVariableHandle("colorTint");
+	gBufferCameraPosition = gBufferPS->GetVariableHandle("cameraPosition");
+	gBufferCameraForward = gBufferPS->GetVariableHandle("cameraForward");
+
+	lightingInvView = lightingPS->GetVariableHandle("invView");
+	lightingShadowCascades = lightingPS->GetVariableHandle("shadowCascades");
+	lightingCameraPosition = lightingPS->GetVariableHandle("cameraPosition");
+	lightingAmbientColor = lightingPS->GetVariableHandle("ambientColor");
+	lightingTileInfo = lightingPS->GetVariableHandle("tileInfo");
+}
+
+// Destructor
+TiledDeferredRenderer::~TiledDeferredRenderer()
+{
+}
+
+// --------------------------------------------------------
+// Recreates the G-buffer targets at the new size
+// --------------------------------------------------------
+void TiledDeferredRenderer::Resize(unsigned int _width, unsigned int _height)
+{
+	width = _width;
+	height = _height;
+
+	for (unsigned int i = 0; i < GBUFFER_TARGET_COUNT; i++)
+	{
+		gBufferRTVs[i].Reset();
+		gBufferSRVs[i].Reset();
+
+		D3D11_TEXTURE2D_DESC textureDesc = {};
+		textureDesc.Width = width;
+		textureDesc.Height = height;
+		textureDesc.ArraySize = 1;
+		textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+		textureDesc.Format = GBufferFormats[i];
+		textureDesc.MipLevels = 1;
+		textureDesc.SampleDesc.Count = 1;
+		textureDesc.Usage = D3D11_USAGE_DEFAULT;
+
+		// Create the resource (no need to track it after views created)
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+		if (FAILED(device->CreateTexture2D(&textureDesc, 0, texture.GetAddressOf())))
+			continue;
+
+		device->CreateRenderTargetView(texture.Get(), 0, gBufferRTVs[i].GetAddressOf());
+		device->CreateShaderResourceView(texture.Get(), 0, gBufferSRVs[i].GetAddressOf());
+	}
+}
+
+// --------------------------------------------------------
+// Draws every entity's surface data into the G-buffer
+// --------------------------------------------------------
+void TiledDeferredRenderer::RenderGBuffer(const std::vector<EntityDraw>& draws, Camera& camera, ID3D11DepthStencilView* depthStencil)
+{
+	// Zero depth marks pixels with nothing in them
+	const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	ID3D11RenderTargetView* targets[GBUFFER_TARGET_COUNT] = {};
+	for (unsigned int i = 0; i < GBUFFER_TARGET_COUNT; i++)
+	{
+		targets[i] = gBufferRTVs[i].Get();
+		if (targets[i])
+			context->ClearRenderTargetView(targets[i], clearColor);
+	}
+	context->OMSetRenderTargets(GBUFFER_TARGET_COUNT, targets, depthStencil);
+
+	XMFLOAT3 cameraPosition = camera.GetTransform().GetPosition();
+	XMFLOAT3 cameraForward = camera.GetTransform().GetForward();
+	gBufferPS->SetFloat3(gBufferCameraPosition, cameraPosition);
+	gBufferPS->SetFloat3(gBufferCameraForward, cameraForward);
+
+	for (const EntityDraw& draw : draws)
+	{
+		Material* material = draw.EntityMaterial;
+		const std::shared_ptr<SimpleVertexShader>& vs = material->GetVertexShader();
+		const MaterialShaderHandles& handles = material->GetShaderHandles();
+
+		vs->SetMatrix4x4(handles.world, draw.Entity->GetTransform().GetWorldMatrix());
+		vs->SetMatrix4x4(handles.worldInvTranspose, draw.Entity->GetTransform().GetWorldInverseTransposeMatrix());
+		vs->SetMatrix4x4(handles.view, camera.GetView());
+		vs->SetMatrix4x4(handles.projection, camera.GetProjection());
+		vs->CopyAllBufferData();
+		vs->SetShader();
+
+		// The material's own textures, through the G-buffer shader
+		gBufferPS->SetFloat3(gBufferColorTint, material->GetColorTint());
+		material->PrepareTextures(gBufferPS);
+		gBufferPS->CopyAllBufferData();
+		gBufferPS->SetShader();
+
+		draw.EntityMesh->Draw();
+	}
+}
+
+// --------------------------------------------------------
+// Culls the lights into tiles and shades the G-buffer
+// --------------------------------------------------------
+void TiledDeferredRenderer::RenderLighting(
+	const std::vector<Light>& lights,
+	Camera& camera,
+	DirectX::XMFLOAT3 ambientColor,
+	const DeferredShadowInputs& shadows,
+	ID3D11RenderTargetView* output,
+	ID3D11DepthStencilView* depthStencil)
+{
+	// Match the tiles to the camera & screen
+	XMFLOAT4X4 projection = camera.GetProjection();
+	cullingConfig.ScreenWidth = width;
+	cullingConfig.ScreenHeight = height;
+	cullingConfig.TanHalfFovX = 1.0f / projection._11;
+	cullingConfig.TanHalfFovY = 1.0f / projection._22;
+	cullingConfig.NearZ = camera.GetNearClip();
+	cullingConfig.FarZ = camera.GetFarClip();
+
+	// View space copies of the lights for the culler
+	XMFLOAT4X4 viewFloats = camera.GetView();
+	XMMATRIX view = XMLoadFloat4x4(&viewFloats);
+
+	viewSpaceLights.resize(lights.size());
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		ClusterLight& cullLight = viewSpaceLights[i];
+		cullLight = ClusterLight();
+		if (lights[i].Type == LIGHT_TYPE_DIRECTIONAL)
+		{
+			cullLight.Global = true;
+			continue;
+		}
+
+		XMFLOAT3 position;
+		XMStoreFloat3(&position, XMVector3TransformCoord(XMLoadFloat3(&lights[i].Position), view));
+		cullLight.Position[0] = position.x;
+		cullLight.Position[1] = position.y;
+		cullLight.Position[2] = position.z;
+		cullLight.Range = lights[i].Range;
+	}
+
+	culler.Build(cullingConfig, viewSpaceLights.data(), (unsigned int)viewSpaceLights.size());
+
+	const std::vector<uint32_t>& ranges = culler.GetTileRanges();
+	const std::vector<uint32_t>& indices = culler.GetLightIndices();
+	lightBuffer.Upload(lights.data(), (unsigned int)lights.size(), sizeof(Light));
+	rangeBuffer.Upload(ranges.data(), (unsigned int)ranges.size() / 2, sizeof(uint32_t) * 2);
+	indexBuffer.Upload(indices.data(), (unsigned int)indices.size(), sizeof(uint32_t));
+
+	// Shader inputs
+	TiledShaderInfo info = {};
+	info.ScreenSize = XMFLOAT2((float)width, (float)height);
+	info.TileSize = cullingConfig.TileSize;
+	info.TileCountX = cullingConfig.GetTileCountX();
+	info.TanHalfFov = XMFLOAT2(cullingConfig.TanHalfFovX, cullingConfig.TanHalfFovY);
+	info.GlobalLightCount = culler.GetGlobalLightCount();
+	info.ShadowLightIndex = shadows.ShadowLightIndex;
+
+	XMFLOAT4X4 invView;
+	XMStoreFloat4x4(&invView, XMMatrixInverse(0, view));
+
+	// No depth buffer bound - the fullscreen triangle would overwrite it
+	context->OMSetRenderTargets(1, &output, 0);
+
+	lightingPS->SetMatrix4x4(lightingInvView, invView);
+	lightingPS->SetData(lightingShadowCascades, &shadows.Cascades, sizeof(ShadowCascadeShaderInfo));
+	lightingPS->SetFloat3(lightingCameraPosition, camera.GetTransform().GetPosition());
+	lightingPS->SetFloat3(lightingAmbientColor, ambientColor);
+	lightingPS->SetData(lightingTileInfo, &info, sizeof(TiledShaderInfo));
+
+	lightingPS->SetShaderResourceView("GBufferAlbedo", gBufferSRVs[0]);
+	lightingPS->SetShaderResourceView("GBufferNormal", gBufferSRVs[1]);
+	lightingPS->SetShaderResourceView("GBufferMaterial", gBufferSRVs[2]);
+	lightingPS->SetShaderResourceView("GBufferDepth", gBufferSRVs[3]);
+	lightingPS->SetShaderResourceView("ShadowMap", shadows.ShadowMap);
+	lightingPS->SetShaderResourceView("Lights", lightBuffer.GetSRV());
+	lightingPS->SetShaderResourceView("TileRanges", rangeBuffer.GetSRV());
+	lightingPS->SetShaderResourceView("TileLightIndices", indexBuffer.GetSRV());
+	lightingPS->SetShaderResourceView("ShadowAtlasMap", shadows.AtlasMap);
+	lightingPS->SetShaderResourceView("ShadowAtlasFaces", shadows.AtlasFaces);
+	lightingPS->SetShaderResourceView("LightShadowFaces", shadows.LightShadowFaces);
+	lightingPS->SetSamplerState("ShadowSampler", shadows.ShadowSampler);
+	lightingPS->CopyAllBufferData();
+
+	fullscreenVS->SetShader();
+	lightingPS->SetShader();
+	context->Draw(3, 0);
+
+	// Ready for anything else forward rendered (like the sky)
+	context->OMSetRenderTargets(1, &output, depthStencil);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <DirectXMath.h>
+#include <memory>
+#include <vector>
+
+#include "Camera.h"
+#include "DynamicStructuredBuffer.h"
+#include "GameEntity.h"
+#include "GBufferPacking.h"
+#include "Lights.h"
+#include "ShadowCascades.h"
+#include "SimpleShader.h"
+#include "TileLightCulling.h"
+
+// Per-frame tile parameters, matching TileInfo in DeferredLightingPS.hlsl
+struct TiledShaderInfo
+{
+	DirectX::XMFLOAT2 ScreenSize;
+	unsigned int TileSize;
+	unsigned int TileCountX;
+
+	DirectX::XMFLOAT2 TanHalfFov;
+	unsigned int GlobalLightCount;
+	int ShadowLightIndex;
+};
+
+// Everything the lighting pass needs to apply the shadow map
+struct DeferredShadowInputs
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ShadowMap;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> ShadowSampler;
+	ShadowCascadeShaderInfo Cascades;
+	int ShadowLightIndex;
+
+	// Point & spot light shadows
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AtlasMap;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AtlasFaces;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> LightShadowFaces;
+};
+
+// --------------------------------------------------------
+// Tiled deferred rendering, as an alternative to the
+// forward path for scenes with lots of lights:
+//
+//  1. RenderGBuffer() draws every entity into the packed
+//     G-buffer (see GBufferPacking.h) with GBufferPS
+//  2. RenderLighting() culls the lights into screen tiles
+//     on the CPU (TileLightCulling) and shades the whole
+//     screen in one pass, each tile only with its lights
+// --------------------------------------------------------
+class TiledDeferredRenderer
+{
+public:
+	TiledDeferredRenderer(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		std::shared_ptr<SimplePixelShader> gBufferPS,
+		std::shared_ptr<SimpleVertexShader> fullscreenVS,
+		std::shared_ptr<SimplePixelShader> lightingPS,
+		unsigned int tileSize = 16);
+	~TiledDeferredRenderer();
+
+	// (Re)creates the G-buffer - call whenever the window changes size
+	void Resize(unsigned int width, unsigned int height);
+
+	// Pass 1: fill the G-buffer, using the given depth buffer
+	void RenderGBuffer(const std::vector<EntityDraw>& draws, Camera& camera, ID3D11DepthStencilView* depthStencil);
+
+	// Pass 2: light the G-buffer into the given target.  Leaves the
+	// output bound with the depth buffer, ready for the sky.
+	void RenderLighting(
+		const std::vector<Light>& lights,
+		Camera& camera,
+		DirectX::XMFLOAT3 ambientColor,
+		const DeferredShadowInputs& shadows,
+		ID3D11RenderTargetView* output,
+		ID3D11DepthStencilView* depthStencil);
+
+	// Getters
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetGBufferSRV(unsigned int index) { return gBufferSRVs[index]; }
+	TileLightCuller& GetCuller() { return culler; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+	// Shaders & pre-resolved handles
+	std::shared_ptr<SimplePixelShader> gBufferPS;
+	std::shared_ptr<SimpleVertexShader> fullscreenVS;
+	std::shared_ptr<SimplePixelShader> lightingPS;
+	SimpleShaderHandle gBufferColorTint;
+	SimpleShaderHandle gBufferCameraPosition;
+	SimpleShaderHandle gBufferCameraForward;
+	SimpleShaderHandle lightingInvView;
+	SimpleShaderHandle lightingShadowCascades;
+	SimpleShaderHandle lightingCameraPosition;
+	SimpleShaderHandle lightingAmbientColor;
+	SimpleShaderHandle lightingTileInfo;
+
+	// G-buffer targets
+	unsigned int width;
+	unsigned int height;
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> gBufferRTVs[GBUFFER_TARGET_COUNT];
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> gBufferSRVs[GBUFFER_TARGET_COUNT];
+
+	// Tile culling
+	TileCullingConfig cullingConfig;
+	TileLightCuller culler;
+	std::vector<ClusterLight> viewSpaceLights;
+	DynamicStructuredBuffer lightBuffer;
+	DynamicStructuredBuffer rangeBuffer;
+	DynamicStructuredBuffer indexBuffer;
+};
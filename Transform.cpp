@@ -71,6 +71,18 @@ void Transform::SetScale(DirectX::XMFLOAT3 _scale)
 	dirty = true;
 }
 
+// Setter blending two transforms (t from 0 to 1) - angles are
+// blended directly, which suits the small changes between
+// simulation steps
+void Transform::SetInterpolated(const Transform& from, const Transform& to, float t)
+{
+	XMStoreFloat3(&position, XMVectorLerp(XMLoadFloat3(&from.position), XMLoadFloat3(&to.position), t));
+	XMStoreFloat3(&rotation, XMVectorLerp(XMLoadFloat3(&from.rotation), XMLoadFloat3(&to.rotation), t));
+	XMStoreFloat3(&scale, XMVectorLerp(XMLoadFloat3(&from.scale), XMLoadFloat3(&to.scale), t));
+	dirty = true;
+	vectorsDirty = true;
+}
+
 // --= Getters =--
 
 // Getter right
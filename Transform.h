@@ -18,6 +18,7 @@ public:
 	void SetRotation(DirectX::XMFLOAT3 _rotation);
 	void SetScale(float x, float y, float z);
 	void SetScale(DirectX::XMFLOAT3 _scale);
+	void SetInterpolated(const Transform& from, const Transform& to, float t);
 
 	// Getters
 	DirectX::XMFLOAT3 GetRight();
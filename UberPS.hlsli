@@ -0,0 +1,259 @@
+#ifndef __GGP__UBER__PS__
+#define __GGP__UBER__PS__
+
+#include "ShaderIncludes.hlsli"
+#include "ShadowCascades.hlsli"
+#include "ShadowAtlas.hlsli"
+
+// --------------------------------------------------------
+// Shared pixel shader for all lit materials.
+//
+// Each permutation is compiled with these defines (see
+// ShaderFeatures.h), which default to the full feature set
+// when this file is compiled on its own:
+//
+//  FEATURE_NORMAL_MAP - Sample & apply a tangent space normal map
+//  FEATURE_SHADOWS    - Apply the cascaded shadow map to the shadow light,
+//                       and the shadow atlas to point & spot lights
+//  FEATURE_PBR        - Cook-Torrance with roughness/metalness maps,
+//                       otherwise Lambert + Phong with constant roughness
+//  FEATURE_CLUSTERED  - Read lights from structured buffers, using
+//                       the per-cluster lists from ClusteredLighting
+//  LIGHT_COUNT        - Size of the light array (when not clustered)
+// --------------------------------------------------------
+#ifndef FEATURE_NORMAL_MAP
+#define FEATURE_NORMAL_MAP 1
+#endif
+
+#ifndef FEATURE_SHADOWS
+#define FEATURE_SHADOWS 1
+#endif
+
+#ifndef FEATURE_PBR
+#define FEATURE_PBR 1
+#endif
+
+#ifndef FEATURE_CLUSTERED
+#define FEATURE_CLUSTERED 0
+#endif
+
+#ifndef LIGHT_COUNT
+#define LIGHT_COUNT 8
+#endif
+
+// The last light is the one that casts shadows
+#define SHADOW_LIGHT_INDEX (LIGHT_COUNT - 1)
+
+#if FEATURE_CLUSTERED
+// Per-frame cluster parameters - matches ClusterShaderInfo in ClusteredLighting.h
+struct ClusterInfo
+{
+	uint3	Counts;
+	float	NearZ;
+
+	float2	TileSize;
+	float	DepthScale;
+	float	DepthBias;
+
+	float3	CameraForward;
+	uint	GlobalLightCount;
+
+	int		ShadowLightIndex;
+	float3	Padding;
+};
+#endif
+
+// Buffer struct
+cbuffer ExternalData : register(b0)
+{
+	float roughness;
+	float3 colorTint;
+	float3 ambientColor;
+	float3 cameraPosition;
+#if FEATURE_SHADOWS
+	ShadowCascadeInfo shadowCascades;
+#endif
+#if FEATURE_CLUSTERED
+	ClusterInfo clusterInfo;
+#elif LIGHT_COUNT > 0
+	Light lights[LIGHT_COUNT];
+#endif
+}
+
+
+// Texture related resources
+Texture2D Albedo			: register(t0); // Textures use "t" registers
+#if FEATURE_PBR
+Texture2D RoughnessMap		: register(t1);
+Texture2D MetalnessMap		: register(t2);
+#endif
+#if FEATURE_NORMAL_MAP
+Texture2D NormalMap			: register(t3);
+#endif
+#if FEATURE_SHADOWS
+Texture2DArray ShadowMap	: register(t4);
+#endif
+
+#if FEATURE_SHADOWS
+Texture2D ShadowAtlasMap							: register(t8);
+StructuredBuffer<ShadowAtlasFace> ShadowAtlasFaces	: register(t9);
+StructuredBuffer<int2> LightShadowFaces				: register(t10); // (first face, count) per light
+#endif
+
+#if FEATURE_CLUSTERED
+StructuredBuffer<Light> Lights				: register(t5);
+StructuredBuffer<uint2> ClusterRanges		: register(t6); // (offset, count)
+StructuredBuffer<uint> ClusterLightIndices	: register(t7);
+#endif
+
+SamplerState BasicSampler				: register(s0); // Samplers use "s" registers
+#if FEATURE_SHADOWS
+SamplerComparisonState ShadowSampler	: register(s1);
+#endif
+
+
+// Non-PBR light evaluation: Lambert diffuse + Phong specular
+float3 CalcLightPhong(Light light, float3 normal, float3 worldPos, float3 camPos, float roughness, float3 surfaceColor)
+{
+	float3 V = normalize(camPos - worldPos);
+
+	float3 toLight;
+	float atten = 1.0f;
+	switch (light.Type)
+	{
+	case LIGHT_TYPE_POINT:
+		toLight = normalize(light.Position - worldPos);
+		atten = Attenuate(light, worldPos);
+		break;
+	default:
+		toLight = normalize(-light.Direction);
+		break;
+	}
+
+	float diff = Diffuse(normal, toLight);
+
+	// Don't let specular show through the back of a surface
+	float spec = SpecularPhong(normal, toLight, V, roughness) * any(diff);
+
+	return (diff * surfaceColor + spec) * light.Intensity * light.Color * atten;
+}
+
+// Lighting for a single light, using whichever model this permutation was built with
+float3 EvaluateLight(Light light, float3 normal, float3 worldPos, float surfaceRoughness, float metalness, float3 surfaceColor, float3 specularColor)
+{
+	light.Direction = normalize(light.Direction);
+
+#if FEATURE_PBR
+	return CalcLight(light, normal, worldPos, cameraPosition, surfaceRoughness, metalness, surfaceColor, specularColor);
+#else
+	return CalcLightPhong(light, normal, worldPos, cameraPosition, surfaceRoughness, surfaceColor);
+#endif
+}
+
+#if FEATURE_CLUSTERED
+// Finds the cluster containing this pixel
+uint GetClusterIndex(float2 pixel, float3 worldPos)
+{
+	// Slices are spaced logarithmically in view depth
+	float viewZ = dot(worldPos - cameraPosition, clusterInfo.CameraForward);
+	int slice = (int)floor(log(max(viewZ, clusterInfo.NearZ)) * clusterInfo.DepthScale - clusterInfo.DepthBias);
+	uint z = (uint)clamp(slice, 0, (int)clusterInfo.Counts.z - 1);
+
+	uint2 tile = min((uint2)(pixel / clusterInfo.TileSize), clusterInfo.Counts.xy - 1);
+	return tile.x + tile.y * clusterInfo.Counts.x + z * clusterInfo.Counts.x * clusterInfo.Counts.y;
+}
+#endif
+
+// --------------------------------------------------------
+// The entry point (main method) for our pixel shader
+// --------------------------------------------------------
+float4 main(VertexToPixel input) : SV_TARGET
+{
+#if FEATURE_SHADOWS
+	// Cascaded shadow mapping
+	float viewDepth = dot(input.worldPos - cameraPosition, shadowCascades.CameraForward);
+	float shadowAmount = SampleShadowCascades(ShadowMap, ShadowSampler, shadowCascades, input.worldPos, viewDepth);
+#endif
+
+#if FEATURE_NORMAL_MAP
+	// Normal mapping
+	float3 unpackedNormal = NormalMap.Sample(BasicSampler, input.uv).rgb * 2 - 1;
+	unpackedNormal = normalize(unpackedNormal);
+
+	// Create TBN matrix
+	float3 N = normalize(input.normal);
+	float3 T = normalize(input.tangent);
+	T = normalize(T - N * dot(T, N));
+	float3 B = cross(T, N);
+	float3x3 TBN = float3x3(T, B, N);
+
+	// Remap normal
+	input.normal = mul(unpackedNormal, TBN);
+#else
+	input.normal = normalize(input.normal);
+#endif
+
+	float3 surfaceColor = pow(Albedo.Sample(BasicSampler, input.uv).rgb, 2.2f);
+	surfaceColor *= colorTint;
+
+#if FEATURE_PBR
+	float surfaceRoughness = RoughnessMap.Sample(BasicSampler, input.uv).r;
+	float metalness = MetalnessMap.Sample(BasicSampler, input.uv).r;
+	float3 specularColor = lerp(F0_NON_METAL, surfaceColor.rgb, metalness);
+#else
+	float surfaceRoughness = roughness;
+	float metalness = 0;
+	float3 specularColor = 0;
+#endif
+
+	float3 total = surfaceColor * ambientColor;
+
+#if FEATURE_CLUSTERED
+	// Global (directional) lights are always at the front of the index list,
+	// followed by only the lights that can reach this pixel's cluster
+	uint2 range = ClusterRanges[GetClusterIndex(input.screenPosition.xy, input.worldPos)];
+	uint globalCount = clusterInfo.GlobalLightCount;
+
+	for (uint i = 0; i < globalCount + range.y; i++)
+	{
+		uint lightIndex = ClusterLightIndices[i < globalCount ? i : range.x + (i - globalCount)];
+		float3 lightResult = EvaluateLight(Lights[lightIndex], input.normal, input.worldPos, surfaceRoughness, metalness, surfaceColor, specularColor);
+
+#if FEATURE_SHADOWS
+		if ((int)lightIndex == clusterInfo.ShadowLightIndex)
+		{
+			lightResult *= shadowAmount;
+		}
+		else if (any(lightResult))
+		{
+			lightResult *= SampleShadowAtlas(ShadowAtlasMap, ShadowSampler, ShadowAtlasFaces, LightShadowFaces[lightIndex], Lights[lightIndex], input.worldPos);
+		}
+#endif
+
+		total += lightResult;
+	}
+#elif LIGHT_COUNT > 0
+	[unroll]
+	for (int i = 0; i < LIGHT_COUNT; i++)
+	{
+		float3 lightResult = EvaluateLight(lights[i], input.normal, input.worldPos, surfaceRoughness, metalness, surfaceColor, specularColor);
+
+#if FEATURE_SHADOWS
+		if (i == SHADOW_LIGHT_INDEX)	// The directional shadow emitting light
+		{
+			lightResult *= shadowAmount;
+		}
+		else if (any(lightResult))
+		{
+			lightResult *= SampleShadowAtlas(ShadowAtlasMap, ShadowSampler, ShadowAtlasFaces, LightShadowFaces[i], lights[i], input.worldPos);
+		}
+#endif
+
+		total += lightResult;
+	}
+#endif
+
+	return float4(pow(total, 1.0f / 2.2f), 1);
+}
+
+#endif
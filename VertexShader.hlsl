@@ -7,9 +7,6 @@ cbuffer ExternalData : register(b0)
 	matrix worldInvTranspose;
 	matrix view;
 	matrix projection;
-
-	matrix lightView;
-	matrix lightProjection;
 }
 
 // --------------------------------------------------------
@@ -44,10 +41,6 @@ VertexToPixel main( VertexShaderInput input )
 	//		passed through regardless as it can be safely ignored in the PS
 	output.tangent = mul((float3x3)world, input.tangent);
 
-	// Shadow position calculations
-	matrix shadowWVP = mul(lightProjection, mul(lightView, world));
-	output.shadowMapPos = mul(shadowWVP, float4(input.localPosition, 1.0f));
-
 	// Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)
 	return output;
@@ -0,0 +1,458 @@
+#include "WorldStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace DirectX;
+
+// Cells are found by their grid position, packed into one key
+static uint64_t GetCellKey(int64_t x, int64_t z)
+{
+	return ((uint64_t)(uint32_t)x << 32) | (uint32_t)z;
+}
+
+WorldStreamer::WorldStreamer(std::shared_ptr<JobSystem> jobSystem) :
+	jobSystem(jobSystem),
+	entitiesOffset(0),
+#ifdef _WIN32
+	fileHandle(INVALID_HANDLE_VALUE),
+#else
+	fileHandle(-1),
+#endif
+	cellCount(0),
+	updateCount(0),
+	diskFreeTime(0.0)
+{
+}
+
+WorldStreamer::~WorldStreamer()
+{
+	// Reads write into the cells, so they have to finish first
+	for (uint32_t i = 0; i < cellCount; i++)
+	{
+		if (jobSystem && !cells[i].Reading.IsDone())
+			jobSystem->Wait(cells[i].Reading);
+	}
+
+#ifdef _WIN32
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+#else
+	if (fileHandle >= 0)
+		close(fileHandle);
+#endif
+}
+
+bool WorldStreamer::Open(const std::string& path, WorldStreamCreate create)
+{
+	if (IsOpen())
+	{
+		error = "already open";
+		return false;
+	}
+	if (!scene.Load(path))
+	{
+		error = scene.GetError();
+		return false;
+	}
+
+	const SceneFileHeader& header = scene.GetHeader();
+	if (header.Cells.Count == 0)
+	{
+		error = "the scene has no cells to stream";
+		scene.Close();
+		return false;
+	}
+
+	// Every cell needs its own grid square
+	std::unordered_map<uint64_t, uint32_t> grid;
+	for (uint32_t i = 0; i < header.Cells.Count; i++)
+	{
+		if (!grid.emplace(GetCellKey(header.Cells[i].X, header.Cells[i].Z), i).second)
+		{
+			error = "two cells are in the same place";
+			scene.Close();
+			return false;
+		}
+	}
+
+	// Cells' entities are read by offset from a handle of our
+	// own, rather than through the mapping
+#ifdef _WIN32
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, 0);
+	bool opened = fileHandle != INVALID_HANDLE_VALUE;
+#else
+	fileHandle = open(path.c_str(), O_RDONLY);
+	bool opened = fileHandle >= 0;
+#endif
+	if (!opened)
+	{
+		error = "can't open the scene to read cells";
+		scene.Close();
+		return false;
+	}
+
+	this->create = create;
+	entitiesOffset = (uint64_t)((const uint8_t*)header.Entities.Get() - (const uint8_t*)&header);
+	cellGrid.swap(grid);
+	cells.reset(new Cell[header.Cells.Count]);
+	cellCount = header.Cells.Count;
+	stats = WorldStreamStats();
+	stats.CellCount = cellCount;
+	updateCount = 0;
+	diskFreeTime = 0.0;
+	error.clear();
+	return true;
+}
+
+void WorldStreamer::Close(SceneWorld& world)
+{
+	for (uint32_t i = 0; i < cellCount; i++)
+	{
+		if (jobSystem && !cells[i].Reading.IsDone())
+			jobSystem->Wait(cells[i].Reading);
+	}
+	while (!charged.empty())
+		Evict(world, charged.back());
+
+#ifdef _WIN32
+	if (fileHandle != INVALID_HANDLE_VALUE)
+		CloseHandle(fileHandle);
+	fileHandle = INVALID_HANDLE_VALUE;
+#else
+	if (fileHandle >= 0)
+		close(fileHandle);
+	fileHandle = -1;
+#endif
+
+	cells.reset();
+	cellCount = 0;
+	cellGrid.clear();
+	wanted.clear();
+	scene.Close();
+}
+
+// --------------------------------------------------------
+// Streams for one frame: finishes reads, starts new ones
+// for the wanted cells nearest first, then adds entities
+// from the cells that have been read.  Reads are started
+// before entities are added, so the disk is busy while the
+// world grows.
+// --------------------------------------------------------
+void WorldStreamer::Update(SceneWorld& world, XMFLOAT3 cameraPosition, XMFLOAT3 cameraVelocity, double time)
+{
+	if (!IsOpen())
+		return;
+
+	updateCount++;
+	stats.EntitiesAdded = 0;
+	stats.OverBudget = false;
+
+	FindWantedCells(cameraPosition, cameraVelocity);
+	FinishReads(time);
+
+	// Without retention, cells go as soon as they're unwanted
+	// (unless they're still being read), and with it they go
+	// once they're over the budget (if it's been lowered)
+	if (!config.RetainUnwanted)
+	{
+		for (size_t i = charged.size(); i-- > 0;)
+		{
+			const Cell& cell = cells[charged[i]];
+			if (cell.LastWanted != updateCount && cell.State != WORLD_CELL_LOADING)
+				Evict(world, charged[i]);
+		}
+	}
+	stats.OverBudget = !MakeRoom(world, 0);
+
+	StartReads(world, time);
+	AddEntities(world);
+	CountResident();
+}
+
+// --------------------------------------------------------
+// Wants every cell whose center is within LoadRadius of the
+// line from the camera to where it's predicted to be, and
+// sorts them nearest the camera first
+// --------------------------------------------------------
+void WorldStreamer::FindWantedCells(XMFLOAT3 position, XMFLOAT3 velocity)
+{
+	const SceneFileHeader& header = scene.GetHeader();
+	float size = header.CellSize;
+	float radius = config.LoadRadius;
+
+	// On the XZ plane, from p to q
+	float px = position.x;
+	float pz = position.z;
+	float dx = velocity.x * config.PredictSeconds;
+	float dz = velocity.z * config.PredictSeconds;
+	float lengthSquared = dx * dx + dz * dz;
+
+	wanted.clear();
+	auto consider = [&](uint32_t index) {
+		const SceneFileCell& cell = header.Cells[index];
+		float cx = ((float)cell.X + 0.5f) * size - px;
+		float cz = ((float)cell.Z + 0.5f) * size - pz;
+
+		// Closest point on the line to the cell's center
+		float t = lengthSquared > 0.0f ? (cx * dx + cz * dz) / lengthSquared : 0.0f;
+		t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+		float ox = cx - t * dx;
+		float oz = cz - t * dz;
+		if (ox * ox + oz * oz > radius * radius)
+			return;
+
+		cells[index].LastWanted = updateCount;
+		wanted.push_back(std::make_pair(cx * cx + cz * cz, index));
+	};
+
+	// Look up the squares around the line, unless there are
+	// more of them than cells (when the camera's very fast)
+	double x0 = floor(((double)std::min(px, px + dx) - radius) / size);
+	double x1 = floor(((double)std::max(px, px + dx) + radius) / size);
+	double z0 = floor(((double)std::min(pz, pz + dz) - radius) / size);
+	double z1 = floor(((double)std::max(pz, pz + dz) + radius) / size);
+	if ((x1 - x0 + 1.0) * (z1 - z0 + 1.0) < (double)cellCount)
+	{
+		for (int64_t z = (int64_t)z0; z <= (int64_t)z1; z++)
+		{
+			for (int64_t x = (int64_t)x0; x <= (int64_t)x1; x++)
+			{
+				auto it = cellGrid.find(GetCellKey(x, z));
+				if (it != cellGrid.end())
+					consider(it->second);
+			}
+		}
+	}
+	else
+	{
+		for (uint32_t i = 0; i < cellCount; i++)
+			consider(i);
+	}
+
+	std::sort(wanted.begin(), wanted.end());
+}
+
+void WorldStreamer::FinishReads(double time)
+{
+	bool async = jobSystem && config.SimulatedBandwidth <= 0.0;
+	for (size_t i = charged.size(); i-- > 0;)
+	{
+		uint32_t index = charged[i];
+		Cell& cell = cells[index];
+		if (cell.State != WORLD_CELL_LOADING || (async ? !cell.Reading.IsDone() : time < cell.ReadyTime))
+			continue;
+
+		stats.BytesRead += cell.Entities.size() * sizeof(SceneFileEntity);
+		if (cell.ReadOk)
+		{
+			cell.State = WORLD_CELL_READY;
+			continue;
+		}
+
+		// A bad cell gives its memory back, and stays out
+		stats.ResidentBytes -= cell.Cost;
+		stats.CellsFailed++;
+		cell.Cost = 0;
+		cell.State = WORLD_CELL_FAILED;
+		std::vector<SceneFileEntity>().swap(cell.Entities);
+		charged[i] = charged.back();
+		charged.pop_back();
+	}
+}
+
+void WorldStreamer::StartReads(SceneWorld& world, double time)
+{
+	const SceneFileHeader& header = scene.GetHeader();
+	uint32_t inFlight = 0;
+	for (uint32_t index : charged)
+		inFlight += cells[index].State == WORLD_CELL_LOADING ? 1 : 0;
+
+	// The first read each frame is let through whatever its
+	// size, so a cell bigger than the per frame budget still loads
+	uint64_t bytesStarted = 0;
+	for (const std::pair<float, uint32_t>& want : wanted)
+	{
+		uint32_t index = want.second;
+		if (cells[index].State != WORLD_CELL_UNLOADED)
+			continue;
+
+		uint32_t entityCount = header.Cells[index].EntityCount;
+		uint64_t readBytes = (uint64_t)entityCount * sizeof(SceneFileEntity);
+		if (inFlight >= config.MaxReadsInFlight || (bytesStarted > 0 && bytesStarted + readBytes > config.ReadBytesPerFrame))
+			break;
+
+		uint64_t cost = std::max(readBytes, (uint64_t)entityCount * config.ResidentBytesPerEntity);
+		if (!MakeRoom(world, cost))
+		{
+			stats.OverBudget = true;
+			break;
+		}
+
+		cells[index].Cost = cost;
+		StartRead(index, time);
+		inFlight++;
+		bytesStarted += readBytes;
+	}
+}
+
+// Evicts the least recently wanted cells until cost fits in
+// the budget (false if it can't, when only wanted cells are left)
+bool WorldStreamer::MakeRoom(SceneWorld& world, uint64_t cost)
+{
+	while (stats.ResidentBytes + cost > config.MemoryBudget)
+	{
+		uint32_t oldest = cellCount;
+		for (uint32_t index : charged)
+		{
+			const Cell& cell = cells[index];
+			if (cell.LastWanted != updateCount && cell.State != WORLD_CELL_LOADING &&
+				(oldest == cellCount || cell.LastWanted < cells[oldest].LastWanted))
+				oldest = index;
+		}
+		if (oldest == cellCount)
+			return false;
+
+		Evict(world, oldest);
+	}
+	return true;
+}
+
+void WorldStreamer::StartRead(uint32_t index, double time)
+{
+	const SceneFileCell& fileCell = scene.GetHeader().Cells[index];
+	Cell& cell = cells[index];
+	cell.State = WORLD_CELL_LOADING;
+	cell.Entities.resize(fileCell.EntityCount);
+	cell.ReadOk = false;
+	charged.push_back(index);
+
+	stats.ResidentBytes += cell.Cost;
+	stats.PeakResidentBytes = std::max(stats.PeakResidentBytes, stats.ResidentBytes);
+	stats.CellsLoaded++;
+	stats.CellsReloaded += cell.LoadCount > 0 ? 1 : 0;
+	cell.LoadCount++;
+
+	if (jobSystem && config.SimulatedBandwidth <= 0.0)
+	{
+		jobSystem->Run([this, index](uint32_t thread) { cells[index].ReadOk = ReadCell(index); }, &cell.Reading);
+		return;
+	}
+
+	// Read now, but only hand it over once the simulated disk
+	// (which reads one cell at a time) would have
+	cell.ReadOk = ReadCell(index);
+	cell.ReadyTime = time;
+	if (config.SimulatedBandwidth > 0.0)
+	{
+		diskFreeTime = std::max(diskFreeTime, time) + (double)cell.Entities.size() * sizeof(SceneFileEntity) / config.SimulatedBandwidth;
+		cell.ReadyTime = diskFreeTime + config.SimulatedLatency;
+	}
+}
+
+// Reads a cell's entities into it, and checks them (on a job
+// thread, unless reads are simulated)
+bool WorldStreamer::ReadCell(uint32_t index)
+{
+	const SceneFileCell& fileCell = scene.GetHeader().Cells[index];
+	Cell& cell = cells[index];
+	uint8_t* buffer = (uint8_t*)cell.Entities.data();
+	uint64_t offset = entitiesOffset + (uint64_t)fileCell.FirstEntity * sizeof(SceneFileEntity);
+	uint64_t remaining = (uint64_t)fileCell.EntityCount * sizeof(SceneFileEntity);
+
+	while (remaining > 0)
+	{
+#ifdef _WIN32
+		OVERLAPPED position = {};
+		position.Offset = (DWORD)offset;
+		position.OffsetHigh = (DWORD)(offset >> 32);
+		DWORD read = 0;
+		if (!ReadFile(fileHandle, buffer, (DWORD)remaining, &read, &position) || read == 0)
+			return false;
+#else
+		ssize_t read = pread(fileHandle, buffer, (size_t)remaining, (off_t)offset);
+		if (read <= 0)
+			return false;
+#endif
+		buffer += read;
+		offset += (uint64_t)read;
+		remaining -= (uint64_t)read;
+	}
+
+	return scene.CheckEntities(cell.Entities.data(), fileCell.EntityCount);
+}
+
+// Adds entities from read cells, nearest first, up to the
+// frame's budget.  A cell is resident once they're all in.
+void WorldStreamer::AddEntities(SceneWorld& world)
+{
+	uint32_t budget = config.AddsPerFrame;
+	for (const std::pair<float, uint32_t>& want : wanted)
+	{
+		Cell& cell = cells[want.second];
+		if (cell.State != WORLD_CELL_READY)
+			continue;
+		if (budget == 0)
+			break;
+
+		cell.Added.reserve(cell.Entities.size());
+		size_t end = std::min(cell.Entities.size(), cell.Added.size() + budget);
+		budget -= (uint32_t)(end - cell.Added.size());
+		for (size_t i = cell.Added.size(); i < end; i++)
+			cell.Added.push_back(create(world, cell.Entities[i]));
+
+		if (cell.Added.size() == cell.Entities.size())
+		{
+			cell.State = WORLD_CELL_RESIDENT;
+			std::vector<SceneFileEntity>().swap(cell.Entities);
+		}
+	}
+
+	stats.EntitiesAdded = config.AddsPerFrame - budget;
+}
+
+void WorldStreamer::Evict(SceneWorld& world, uint32_t index)
+{
+	Cell& cell = cells[index];
+	for (SceneEntity entity : cell.Added)
+		world.Destroy(entity);
+
+	std::vector<SceneEntity>().swap(cell.Added);
+	std::vector<SceneFileEntity>().swap(cell.Entities);
+	stats.ResidentBytes -= cell.Cost;
+	stats.CellsEvicted++;
+	cell.Cost = 0;
+	cell.State = WORLD_CELL_UNLOADED;
+
+	charged.erase(std::find(charged.begin(), charged.end(), index));
+}
+
+void WorldStreamer::CountResident()
+{
+	stats.WantedCells = (uint32_t)wanted.size();
+	stats.ResidentCells = 0;
+	stats.ReadsInFlight = 0;
+	for (uint32_t index : charged)
+	{
+		stats.ResidentCells += cells[index].State == WORLD_CELL_RESIDENT ? 1 : 0;
+		stats.ReadsInFlight += cells[index].State == WORLD_CELL_LOADING ? 1 : 0;
+	}
+
+	// Required cells are the nearest wanted ones (as long as
+	// RequiredRadius is within LoadRadius)
+	stats.MissingCells = 0;
+	float required = config.RequiredRadius * config.RequiredRadius;
+	for (const std::pair<float, uint32_t>& want : wanted)
+	{
+		if (want.first > required)
+			break;
+		stats.MissingCells += cells[want.second].State != WORLD_CELL_RESIDENT ? 1 : 0;
+	}
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "JobSystem.h"
+#include "SceneFile.h"
+#include "SceneWorld.h"
+
+// Where a cell is in streaming
+#define WORLD_CELL_UNLOADED	0
+#define WORLD_CELL_LOADING	1	// Its entities are being read
+#define WORLD_CELL_READY	2	// Read, and being added to the world
+#define WORLD_CELL_RESIDENT	3	// Every entity is in the world
+#define WORLD_CELL_FAILED	4	// Unreadable, and never tried again
+
+// --------------------------------------------------------
+// How far around the camera cells are kept, and what
+// loading them is allowed to cost.  Distances are on the
+// XZ plane, to cell centers.
+// --------------------------------------------------------
+struct WorldStreamConfig
+{
+	// Cells this close to the camera - now, or where it's
+	// predicted to be - are wanted
+	float LoadRadius = 150.0f;
+
+	// Cells this close to the camera must be in the world to
+	// draw it properly; a frame where one isn't is a hitch
+	float RequiredRadius = 75.0f;
+
+	// How far ahead the camera's velocity is followed (0 only
+	// loads around where it is)
+	float PredictSeconds = 2.0f;
+
+	// Reads started per frame, and at once
+	uint32_t ReadBytesPerFrame = 1024 * 1024;
+	uint32_t MaxReadsInFlight = 8;
+
+	// Entities added to the world per frame, so big cells are
+	// spread over frames instead of stalling one
+	uint32_t AddsPerFrame = 4096;
+
+	// Memory cells may take, counting each from when its read
+	// starts until it's evicted.  A cell costs its records
+	// while they're read, or ResidentBytesPerEntity for each
+	// entity once in the world, whichever is more.
+	uint64_t MemoryBudget = 64 * 1024 * 1024;
+	uint32_t ResidentBytesPerEntity = 512;
+
+	// Keep cells the camera's left until the budget needs their
+	// memory (least recently wanted go first), so turning back
+	// doesn't reload them; otherwise they go right away
+	bool RetainUnwanted = true;
+
+	// Above 0, reads finish when a disk with this bandwidth (in
+	// bytes per second) and latency would have, by the time
+	// given to Update(), rather than when they really do - so a
+	// run plays out the same on any machine
+	double SimulatedBandwidth = 0.0;
+	double SimulatedLatency = 0.0;
+};
+
+// --------------------------------------------------------
+// What streaming's doing.  Counts are since Open(), and the
+// rest are as of the last Update().
+// --------------------------------------------------------
+struct WorldStreamStats
+{
+	uint32_t CellCount = 0;
+	uint32_t WantedCells = 0;
+	uint32_t ResidentCells = 0;
+	uint32_t ReadsInFlight = 0;
+	uint32_t MissingCells = 0;		// Required, but not resident
+	uint32_t EntitiesAdded = 0;		// This update
+	uint64_t ResidentBytes = 0;		// Charged to the budget
+	uint64_t PeakResidentBytes = 0;
+	bool OverBudget = false;		// A wanted cell didn't fit
+
+	uint64_t BytesRead = 0;
+	uint64_t CellsLoaded = 0;
+	uint64_t CellsReloaded = 0;		// Loaded again after being evicted
+	uint64_t CellsEvicted = 0;
+	uint64_t CellsFailed = 0;
+};
+
+// Makes a streamed entity in the world (and returns it, so
+// it can be destroyed when its cell goes)
+typedef std::function<SceneEntity(SceneWorld& world, const SceneFileEntity& entity)> WorldStreamCreate;
+
+// --------------------------------------------------------
+// Streams a scene's cells (see SceneFileCell) in and out of
+// the world around the camera.
+//
+// Each update wants the cells within LoadRadius of the line
+// from the camera to where its velocity will take it in
+// PredictSeconds, starts reading the nearest ones that
+// aren't in yet (as jobs, within the read and memory
+// budgets), and adds entities from cells that have been read.
+// Cells nobody wants are evicted least recently wanted first
+// when the budget needs room.
+//
+// The scene file stays mapped for its small tables, and
+// each cell's entities are read from the file on their own,
+// so only the cells that are in take memory.
+// --------------------------------------------------------
+class WorldStreamer
+{
+public:
+	WorldStreamer(std::shared_ptr<JobSystem> jobSystem);
+	~WorldStreamer();
+
+	WorldStreamer(const WorldStreamer&) = delete;
+	WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+	// False if the scene can't be loaded or has no cells
+	bool Open(const std::string& path, WorldStreamCreate create);
+
+	// Waits for reads and takes every streamed entity out
+	void Close(SceneWorld& world);
+
+	// Once a frame, from the thread that owns the world
+	void Update(SceneWorld& world, DirectX::XMFLOAT3 cameraPosition, DirectX::XMFLOAT3 cameraVelocity, double time);
+
+	// Getters & setters
+	bool IsOpen() const { return cellCount > 0; }
+	const SceneFile& GetScene() const { return scene; }
+	const WorldStreamStats& GetStats() const { return stats; }
+	WorldStreamConfig& GetConfig() { return config; }
+	uint32_t GetCellState(uint32_t cell) const { return cells[cell].State; }
+	const std::string& GetError() const { return error; }
+
+private:
+	struct Cell
+	{
+		uint32_t State = WORLD_CELL_UNLOADED;
+		uint64_t Cost = 0;
+		uint64_t LastWanted = 0;		// Update it was last wanted in
+		uint32_t LoadCount = 0;
+
+		// Read by a job (or, when simulated, up front and
+		// handed over at ReadyTime)
+		std::vector<SceneFileEntity> Entities;
+		JobCounter Reading;
+		bool ReadOk = false;
+		double ReadyTime = 0.0;
+
+		// What's in the world so far
+		std::vector<SceneEntity> Added;
+	};
+
+	void FindWantedCells(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 velocity);
+	void FinishReads(double time);
+	void AddEntities(SceneWorld& world);
+	void StartReads(SceneWorld& world, double time);
+	bool MakeRoom(SceneWorld& world, uint64_t cost);
+	void StartRead(uint32_t index, double time);
+	bool ReadCell(uint32_t index);
+	void Evict(SceneWorld& world, uint32_t index);
+	void CountResident();
+
+	std::shared_ptr<JobSystem> jobSystem;
+	WorldStreamConfig config;
+	WorldStreamStats stats;
+	WorldStreamCreate create;
+
+	// The scene's tables, and a handle its cells are read with
+	SceneFile scene;
+	uint64_t entitiesOffset;
+#ifdef _WIN32
+	void* fileHandle;
+#else
+	int fileHandle;
+#endif
+
+	// Cells by index, and found by grid position
+	std::unique_ptr<Cell[]> cells;
+	uint32_t cellCount;
+	std::unordered_map<uint64_t, uint32_t> cellGrid;
+
+	// This update's wanted cells (nearest first), and every
+	// cell with memory charged to it
+	std::vector<std::pair<float, uint32_t>> wanted;
+	std::vector<uint32_t> charged;
+	uint64_t updateCount;
+	double diskFreeTime;
+
+	std::string error;
+};
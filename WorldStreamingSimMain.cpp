@@ -0,0 +1,345 @@
+// --------------------------------------------------------
+// Flies a camera through a big streamed world along a fixed
+// path, one 60 Hz frame at a time, and reports how well a
+// WorldStreamer kept up:
+//
+//  - hitches:  frames where a cell within RequiredRadius of
+//              the camera wasn't in the world yet (after the
+//              first frame where everything was), and the
+//              longest run of them
+//  - memory:   bytes charged to the budget, average and peak,
+//              and frames where a wanted cell didn't fit
+//  - reads:    cells & bytes read, and cells read again after
+//              being evicted (thrash)
+//  - update:   the slowest WorldStreamer::Update() calls, in
+//              real milliseconds
+//
+// The world is generated, written out as a scene file with
+// cells and streamed back from it.  Reads go through a
+// simulated disk (bandwidth plus a latency per read) timed
+// in frame time, so every run streams exactly the same way
+// (the checksum of each frame's state shows it) - apart
+// from the update times, which are the machine's.
+//
+// The path crosses the world slowly, turns back over where
+// it's been, then races diagonally back across it and along
+// a row it hasn't seen.  It's flown
+// with the streamer set up three ways:
+//
+//  - nearby:    only cells around the camera, dropped as
+//               soon as they're out of range
+//  - predicted: cells along the camera's velocity too
+//  - retained:  predicted, and cells the camera's left kept
+//               (least recently wanted evicted first) until
+//               the memory budget needs the room
+//
+// Built by CMakeLists.txt:
+//
+//   WorldStreamingSimMain --cells 64 --entities 200 --bandwidth 8 --latency 50
+//                         --radius 100 --speed 600 --budget 32 --dir /tmp
+// --------------------------------------------------------
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "SceneFileWriter.h"
+#include "SceneWorld.h"
+#include "WorldStreamer.h"
+
+using namespace DirectX;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+#define SIM_FRAME_TIME (1.0 / 60.0)
+#define SIM_CELL_SIZE 32.0f
+
+// What the simulated world's entities hold
+struct SimEntity
+{
+	XMFLOAT3 Position;
+	uint32_t Mesh;
+	uint32_t Material;
+};
+
+// Where the camera heads next, and how fast it gets there
+struct SimWaypoint
+{
+	float X;
+	float Z;
+	float Speed;
+};
+
+struct SimReport
+{
+	uint32_t Frames = 0;
+	uint32_t FirstFullFrame = 0;	// First frame nothing was missing
+	uint32_t HitchFrames = 0;
+	uint32_t LongestHitch = 0;
+	uint32_t MostMissing = 0;
+	uint32_t OverBudgetFrames = 0;
+	double AverageResidentBytes = 0;
+	double WorstUpdateMs = 0;
+	double UpdateMs99 = 0;
+	uint64_t Checksum = 14695981039346656037ull;
+	WorldStreamStats Stats;
+};
+
+// The same numbers from the same seed, on any machine
+static uint32_t NextRandom(uint32_t& state)
+{
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+// Folds a value into a checksum (FNV-1a, a byte at a time)
+static uint64_t Mix(uint64_t checksum, uint64_t value)
+{
+	for (int i = 0; i < 8; i++)
+		checksum = (checksum ^ ((value >> (i * 8)) & 0xFF)) * 1099511628211ull;
+	return checksum;
+}
+
+// A square world of cells, each with a varying number of
+// entities using the demo scene's meshes & materials
+static bool WriteWorld(const std::string& path, uint32_t cellsAcross, uint32_t averageEntities)
+{
+	SceneFileWriter writer;
+	static const char* meshNames[] = { "sphere", "cube", "helix", "cylinder", "torus", "quad" };
+	for (const char* mesh : meshNames)
+	{
+		writer.AddMesh(std::string("Models/") + mesh + ".obj");
+		SceneFileMaterial material = { XMFLOAT3(1, 1, 1), 1.0f, { SCENE_FILE_NONE, SCENE_FILE_NONE, SCENE_FILE_NONE, SCENE_FILE_NONE } };
+		writer.AddMaterial(material);
+	}
+	writer.SetCellSize(SIM_CELL_SIZE);
+
+	// Scenes need a light and a camera to load
+	Light sun = {};
+	sun.Type = LIGHT_TYPE_DIRECTIONAL;
+	sun.Direction = XMFLOAT3(-0.5f, -0.5f, 0.5f);
+	sun.Color = XMFLOAT3(1, 1, 1);
+	sun.Intensity = 1.0f;
+	writer.AddLight(sun);
+	SceneFileCamera camera = { XMFLOAT3(0, 2, 0), XMFLOAT3(0, 0, 0), 5.0f, 0.002f, XM_PIDIV4, 0.01f, 300.0f };
+	writer.AddCamera(camera);
+
+	uint32_t random = 12345;
+	for (uint32_t cz = 0; cz < cellsAcross; cz++)
+	{
+		for (uint32_t cx = 0; cx < cellsAcross; cx++)
+		{
+			uint32_t count = averageEntities / 2 + NextRandom(random) % (averageEntities + 1);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				SceneFileEntity entity = {};
+				entity.Mesh = NextRandom(random) % 6;
+				entity.Material = entity.Mesh;
+				entity.Flags = SCENE_FILE_ENTITY_STATIC;
+				entity.Position = XMFLOAT3(
+					(cx + (NextRandom(random) % 1000) / 1000.0f) * SIM_CELL_SIZE,
+					0.0f,
+					(cz + (NextRandom(random) % 1000) / 1000.0f) * SIM_CELL_SIZE);
+				entity.Scale = XMFLOAT3(1, 1, 1);
+				writer.AddEntity(entity);
+			}
+		}
+	}
+	return writer.Write(path);
+}
+
+// Flies the path with the streamer set up one way
+static SimReport Fly(const std::string& path, const WorldStreamConfig& config, const std::vector<SimWaypoint>& waypoints)
+{
+	SimReport report;
+	SceneWorld world;
+	WorldStreamer streamer(0);
+	if (!streamer.Open(path, [](SceneWorld& world, const SceneFileEntity& entity) {
+		return world.Create(SimEntity{ entity.Position, entity.Mesh, entity.Material });
+	}))
+	{
+		printf("Couldn't stream %s: %s\n", path.c_str(), streamer.GetError().c_str());
+		return report;
+	}
+	streamer.GetConfig() = config;
+
+	std::vector<double> updateTimes;
+	XMFLOAT3 position(waypoints[0].X, 10.0f, waypoints[0].Z);
+	uint32_t hitch = 0;
+	for (size_t next = 1; next < waypoints.size();)
+	{
+		// Move along the path, turning at waypoints (so the
+		// velocity is what the camera really did, like Camera's)
+		XMFLOAT3 start = position;
+		float step = waypoints[next].Speed * (float)SIM_FRAME_TIME;
+		while (step > 0.0f && next < waypoints.size())
+		{
+			float dx = waypoints[next].X - position.x;
+			float dz = waypoints[next].Z - position.z;
+			float distance = sqrtf(dx * dx + dz * dz);
+			if (distance > step)
+			{
+				position.x += dx / distance * step;
+				position.z += dz / distance * step;
+				break;
+			}
+			position.x = waypoints[next].X;
+			position.z = waypoints[next].Z;
+			step -= distance;
+			next++;
+		}
+		XMFLOAT3 velocity(
+			(position.x - start.x) / (float)SIM_FRAME_TIME,
+			0.0f,
+			(position.z - start.z) / (float)SIM_FRAME_TIME);
+
+		auto updateStart = Clock::now();
+		streamer.Update(world, position, velocity, report.Frames * SIM_FRAME_TIME);
+		updateTimes.push_back(std::chrono::duration<double, std::milli>(Clock::now() - updateStart).count());
+
+		// What the frame saw
+		const WorldStreamStats& stats = streamer.GetStats();
+		report.Frames++;
+		report.AverageResidentBytes += (double)stats.ResidentBytes;
+		report.OverBudgetFrames += stats.OverBudget ? 1 : 0;
+		report.Checksum = Mix(Mix(Mix(report.Checksum, stats.MissingCells), stats.ResidentCells), stats.ResidentBytes);
+		if (report.FirstFullFrame == 0 && stats.MissingCells == 0)
+			report.FirstFullFrame = report.Frames;
+		else if (report.FirstFullFrame > 0 && stats.MissingCells > 0)
+		{
+			report.HitchFrames++;
+			report.MostMissing = std::max(report.MostMissing, stats.MissingCells);
+			report.LongestHitch = std::max(report.LongestHitch, ++hitch);
+			continue;
+		}
+		hitch = 0;
+	}
+
+	report.Stats = streamer.GetStats();
+	report.AverageResidentBytes /= report.Frames > 0 ? report.Frames : 1;
+	if (!updateTimes.empty())
+	{
+		std::sort(updateTimes.begin(), updateTimes.end());
+		report.WorstUpdateMs = updateTimes.back();
+		report.UpdateMs99 = updateTimes[updateTimes.size() * 99 / 100];
+	}
+
+	// Everything streamed comes back out
+	streamer.Close(world);
+	if (world.GetEntityCount() != 0)
+		printf("%u entities were left in the world\n", world.GetEntityCount());
+	return report;
+}
+
+static void PrintReport(const char* name, const SimReport& report)
+{
+	const double megabyte = 1024.0 * 1024.0;
+	printf("%-10s %6u  %6u  %7u  %7u  %6.1f  %6.1f  %5u  %6llu  %6llu  %6llu  %7.1f  %6.2f  %6.2f  %016llx\n",
+		name,
+		report.FirstFullFrame,
+		report.HitchFrames,
+		report.LongestHitch,
+		report.MostMissing,
+		report.AverageResidentBytes / megabyte,
+		report.Stats.PeakResidentBytes / megabyte,
+		report.OverBudgetFrames,
+		(unsigned long long)report.Stats.CellsLoaded,
+		(unsigned long long)report.Stats.CellsReloaded,
+		(unsigned long long)report.Stats.CellsEvicted,
+		report.Stats.BytesRead / megabyte,
+		report.UpdateMs99,
+		report.WorstUpdateMs,
+		(unsigned long long)report.Checksum);
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t cellsAcross = 64;
+	uint32_t averageEntities = 200;
+	double bandwidth = 8.0;
+	double latency = 50.0;
+	uint32_t budget = 32;
+	float fastSpeed = 600.0f;
+	float radius = 100.0f;
+	std::string dir = ".";
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string name = argv[i];
+		if (name == "--cells") cellsAcross = (uint32_t)atoi(argv[i + 1]);
+		else if (name == "--entities") averageEntities = (uint32_t)atoi(argv[i + 1]);
+		else if (name == "--bandwidth") bandwidth = atof(argv[i + 1]);
+		else if (name == "--latency") latency = atof(argv[i + 1]);
+		else if (name == "--budget") budget = (uint32_t)atoi(argv[i + 1]);
+		else if (name == "--speed") fastSpeed = (float)atof(argv[i + 1]);
+		else if (name == "--radius") radius = (float)atof(argv[i + 1]);
+		else if (name == "--dir") dir = argv[i + 1];
+	}
+	if (cellsAcross < 16 || averageEntities == 0 || bandwidth <= 0.0 || budget == 0)
+	{
+		printf("Usage: WorldStreamingSimMain [--cells across (16+)] [--entities per cell] [--bandwidth MB/s]\n");
+		printf("                             [--latency ms] [--radius load] [--speed fast] [--budget MB] [--dir scratch]\n");
+		return 1;
+	}
+
+	std::string path = dir + "/WorldStreamingSim.scene";
+	if (!WriteWorld(path, cellsAcross, averageEntities))
+	{
+		printf("Couldn't write %s\n", path.c_str());
+		return 1;
+	}
+
+	// Across slowly, back over the same ground, then fast across
+	// it all and over new ground (a fifth of the way in from
+	// the edges)
+	float edge = cellsAcross * SIM_CELL_SIZE;
+	float near = edge * 0.2f;
+	float far = edge * 0.8f;
+	std::vector<SimWaypoint> waypoints =
+	{
+		{ near, near, 0.0f },
+		{ far, near, 40.0f },
+		{ far, edge * 0.5f, 40.0f },
+		{ near, edge * 0.5f, 40.0f },
+		{ far, edge * 0.5f, 40.0f },
+		{ far, near, 40.0f },
+		{ near, far, fastSpeed },
+		{ far, far, fastSpeed },
+	};
+
+	WorldStreamConfig nearby;
+	nearby.LoadRadius = radius;
+	nearby.PredictSeconds = 0.0f;
+	nearby.RetainUnwanted = false;
+	nearby.MemoryBudget = (uint64_t)budget * 1024 * 1024;
+	nearby.SimulatedBandwidth = bandwidth * 1024 * 1024;
+	nearby.SimulatedLatency = latency / 1000.0;
+	WorldStreamConfig predicted = nearby;
+	predicted.PredictSeconds = 2.0f;
+	WorldStreamConfig retained = predicted;
+	retained.RetainUnwanted = true;
+
+	SimReport reports[4] =
+	{
+		Fly(path, nearby, waypoints),
+		Fly(path, predicted, waypoints),
+		Fly(path, retained, waypoints),
+		Fly(path, retained, waypoints),
+	};
+
+	printf("%u x %u cells of %.0f units, about %u entities each; disk %.1f MB/s + %.1f ms a read; %u MB budget; %u frames\n\n",
+		cellsAcross, cellsAcross, SIM_CELL_SIZE, averageEntities, bandwidth, latency, budget, reports[0].Frames);
+
+	printf("           first  hitch   longest  most     avg MB  peak MB  over  loads  reload  evict   read MB  99%% ms  max ms  checksum\n");
+	PrintReport("nearby", reports[0]);
+	PrintReport("predicted", reports[1]);
+	PrintReport("retained", reports[2]);
+
+	bool same = reports[2].Checksum == reports[3].Checksum && reports[2].HitchFrames == reports[3].HitchFrames;
+	printf("\nA second retained run %s\n", same ? "matches" : "DIFFERS");
+
+	remove(path.c_str());
+	return same ? 0 : 1;
+}